@@ -4,9 +4,19 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "transport.h"
+#include "nonce_tree.h"
+#include "attestor_log.h"
+#include "log_dictionary.h"
 
 // Constants
 #define TPM_PCR_COUNT 24  /**< TPM 2.0 typically has 24 PCR registers */
+#define ATTESTOR_ID "attestor456"  /**< Identity reported in every response */
+#define ATTESTOR_MAX_EVENTS 64  /**< Socket events handled per epoll_wait() */
+#define ATTESTOR_AK_HANDLE 0x81010002  /**< Default persistent handle of the attestation key */
+#define ATTESTOR_MAX_COALESCED 256  /**< Most requests answered by one coalesced quote */
+#define ATTESTOR_PROTOCOL_V2 2  /**< Raw log sent in chunks with an event offset index; version 1 sends it whole */
+#define ATTESTOR_LOG_CHUNK_SIZE (64 * 1024)  /**< Largest log chunk of a version 2 response */
 
 // Enumerations
 
@@ -32,29 +42,108 @@ typedef enum {
 typedef struct {
     uint8_t *value;  /**< Pointer to the PCR value data */
     size_t size;     /**< Size of the PCR value data */
+    uint32_t index;  /**< PCR number */
 } PCR_Data;
 
+/**
+ * @struct AttestorDevice
+ * @brief A source of attestation data other than this platform's TPM and logs, such as a simulated device.
+ *
+ * Each callback has the contract of the collect_*() function it stands in for, and receives device as its first
+ * argument.
+ */
+typedef struct {
+    const char *attestor_id;      /**< Identity reported in the device's responses */
+    int (*collect_pcrs)(void *device, PCR_Data **pcr_data_array, size_t *num_pcrs);
+    int (*collect_quote)(void *device, const uint8_t *nonce, size_t nonce_size, uint8_t **quote, size_t *quote_size);
+    int (*collect_log)(void *device, const LogPosition *known, AttestorLogDelta *delta);
+    void *device;                 /**< State of the device */
+} AttestorDevice;
+
 /**
  * @struct AttestationContext
  * @brief Context structure for the attestation protocol state machine.
  */
 typedef struct {
     AttestationState state;       /**< Current state of the attestation protocol */
+    TransportConnection *connection; /**< Connection the request arrived on and the response is queued on */
     uint8_t *request_buffer;      /**< Buffer containing the attestation request */
     size_t request_size;          /**< Size of the request buffer */
+    uint8_t *nonce;               /**< Nonce of the request, echoed in the response */
+    size_t nonce_size;            /**< Size of the nonce */
     PCR_Data *pcr_data_array;     /**< Array of PCR_Data structures */
     size_t num_pcrs;              /**< Number of PCRs collected */
-    uint8_t *measurement_log;     /**< Buffer containing the measurement logs */
-    size_t log_size;              /**< Size of the measurement log buffer */
+    uint8_t *quote;               /**< Marshaled quote over the nonce, or NULL without a TPM */
+    size_t quote_size;            /**< Size of the quote */
+    LogPosition known;            /**< Log prefix the verifier already holds; event_count is 0 if none */
+    uint32_t log_dictionary_id;   /**< Dictionary the verifier can decompress the log with; 0 if none */
+    uint32_t protocol_version;    /**< Highest protocol version the verifier accepts; 0 means version 1 */
+    AttestorLogDelta log;         /**< Part of the measurement log the response carries */
+    const AttestorDevice *device; /**< Device the data is collected from, or NULL for this platform */
 } AttestationContext;
 
 // Function Prototypes
 
+/**
+ * @brief Opens the TPM the attestation data is collected from. Until it is opened, dummy data is served.
+ *
+ * @param[in] tcti_conf  TCTI loader configuration, e.g. "swtpm:host=localhost,port=2321"; NULL for the default.
+ * @param[in] ak_handle  Persistent handle of the attestation key, e.g. ATTESTOR_AK_HANDLE.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_tpm_open(const char *tcti_conf, uint32_t ak_handle);
+
+/**
+ * @brief Closes the TPM opened by attestor_tpm_open().
+ */
+void attestor_tpm_close(void);
+
+/**
+ * @brief Opens the measurement log served to verifiers. Until it is opened, a dummy log is served.
+ *
+ * The boot log is read once; the runtime log is read incrementally, only its new records on every round.
+ *
+ * @param[in] boot_path     Boot event log, e.g. ATTESTOR_BOOT_LOG_PATH.
+ * @param[in] runtime_path  Runtime log of TCG records continuing the boot log, or NULL.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_event_log_open(const char *boot_path, const char *runtime_path);
+
+/**
+ * @brief Opens the measurement log served to verifiers as one CEL-TLV stream of the boot log and the IMA log.
+ *
+ * The boot log is encoded once; the IMA log's new entries are encoded on every round. Verifiers parse and replay
+ * the stream as they do a PC Client log.
+ *
+ * @param[in] boot_path  Boot event log, e.g. ATTESTOR_BOOT_LOG_PATH.
+ * @param[in] ima_path   IMA runtime measurement log, e.g. ATTESTOR_IMA_LOG_PATH, or NULL.
+ * @param[in] ima_bank   Bank of the IMA log, e.g. TPM2_ALG_SHA1 for binary_runtime_measurements.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_event_log_open_cel(const char *boot_path, const char *ima_path, TPM2_ALG_ID ima_bank);
+
+/**
+ * @brief Closes the measurement log opened by attestor_event_log_open() or attestor_event_log_open_cel().
+ */
+void attestor_event_log_close(void);
+
+/**
+ * @brief Makes responses carry the measurement log compressed, to verifiers whose request advertises the
+ * dictionary's ID. Other verifiers, and logs that do not shrink, are sent the log uncompressed.
+ *
+ * @param[in] dictionary  Log dictionary shared with the verifiers; must outlive the attestor. NULL compresses none.
+ */
+void attestor_set_log_dictionary(const LogDictionary *dictionary);
+
 /**
  * @brief Collects all PCR values from the TPM.
  *
- * This function reads all Platform Configuration Register (PCR) values from the TPM and stores them in an array of
- * PCR_Data structures. Each PCR_Data structure contains a pointer to the PCR value data and its size.
+ * This function reads every PCR of every active bank from the TPM in batches of eight per TPM2_PCR_Read and stores
+ * the SHA-256 values in an array of PCR_Data structures. The array and the values it points to share one
+ * allocation, released with a single free().
  *
  * @param[out] pcr_data_array  Pointer to the array where PCR_Data structures will be stored.
  * @param[out] num_pcrs        Pointer to a size_t variable where the number of PCRs collected will be stored.
@@ -63,57 +152,119 @@ typedef struct {
  */
 int collect_all_pcr_values(PCR_Data **pcr_data_array, size_t *num_pcrs);
 
+/**
+ * @brief Quotes every PCR of every active bank with one TPM2_Quote.
+ *
+ * @param[in]  nonce       Nonce of the verifier's request, quoted as qualifying data.
+ * @param[in]  nonce_size  Size of the nonce.
+ * @param[out] quote       Pointer where the marshaled TPM2B_ATTEST and TPMT_SIGNATURE will be stored; NULL when
+ *                         no TPM is open. The caller frees it.
+ * @param[out] quote_size  Pointer to a size_t variable where the size of the quote will be stored.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int collect_quote(const uint8_t *nonce, size_t nonce_size, uint8_t **quote, size_t *quote_size);
+
 /**
  * @brief Collects measurement logs from the platform.
  *
- * This function retrieves the measurement logs from the platform, which may include logs from the boot process and
- * other measurements that are critical for attestation.
+ * This function brings the cached measurement log up to date with the records appended to the runtime log, as
+ * CEL records when the log is a CEL stream (see attestor_event_log_open_cel()), and selects what the response
+ * carries: only the records after the verifier's position when the attestor served that position recently, or the
+ * whole log otherwise.
  *
- * @param[out] measurement_log Pointer to the buffer where the measurement log will be stored.
- * @param[out] log_size        Pointer to a size_t variable where the size of the measurement log will be stored.
+ * @param[in]  known  Log prefix the verifier already holds, or NULL.
+ * @param[out] delta  Part of the log to send; its views stay valid until the next collection.
  *
  * @return Returns 0 on success, or -1 on failure.
  */
-int collect_measurement_logs(uint8_t **measurement_log, size_t *log_size);
+int collect_measurement_logs(const LogPosition *known, AttestorLogDelta *delta);
 
 /**
  * @brief Processes the attestation request received from the verifier.
  *
  * This function deserializes the attestation request using Protocol Buffers and extracts necessary information,
- * such as the nonce provided by the verifier.
+ * such as the nonce provided by the verifier, the part of the measurement log it already holds, the dictionary
+ * it can decompress the log with and the protocol version it speaks.
  *
- * @param[in] request_buffer   Pointer to the buffer containing the serialized attestation request.
- * @param[in] request_size     Size of the request buffer.
+ * @param[in]  request_buffer     Pointer to the buffer containing the serialized attestation request.
+ * @param[in]  request_size       Size of the request buffer.
+ * @param[out] nonce              Pointer where a copy of the nonce will be stored; the caller frees it.
+ * @param[out] nonce_size         Pointer to a size_t variable where the size of the nonce will be stored.
+ * @param[out] known              Log prefix the verifier holds; event_count is 0 if it holds none.
+ * @param[out] log_dictionary_id  Dictionary the verifier advertises, or LOG_DICTIONARY_NONE.
+ * @param[out] protocol_version   Highest protocol version the verifier accepts; 0 means version 1.
  *
  * @return Returns 0 on success, or -1 on failure.
  */
-int process_attestation_request(uint8_t *request_buffer, size_t request_size);
+int process_attestation_request(uint8_t *request_buffer, size_t request_size, uint8_t **nonce, size_t *nonce_size,
+                                LogPosition *known, uint32_t *log_dictionary_id, uint32_t *protocol_version);
 
 /**
  * @brief Sends the attestation response back to the verifier.
  *
  * This function serializes the attestation response, including the collected PCR values and measurement logs,
- * and sends it back to the verifier. The response is constructed using Protocol Buffers.
+ * straight into a frame buffer and queues it on the connection. The nonce lets a verifier with several requests in
+ * flight match the response to its request. The log is compressed when the verifier advertised the dictionary set
+ * with attestor_set_log_dictionary(). A verifier that speaks ATTESTOR_PROTOCOL_V2 gets a version 2 response: the
+ * log in chunks of at most ATTESTOR_LOG_CHUNK_SIZE, with the offset of each record in it; an older one gets the
+ * log in one piece.
  *
- * @param[in] pcr_data_array   Array of PCR_Data structures containing the PCR values.
- * @param[in] num_pcrs         Number of PCRs in the pcr_data_array.
- * @param[in] measurement_log  Buffer containing the measurement logs.
- * @param[in] log_size         Size of the measurement log buffer.
+ * @param[in] connection         Connection the response is queued on.
+ * @param[in] attestor_id        Identity reported in the response, e.g. ATTESTOR_ID.
+ * @param[in] nonce              Nonce of the request being answered.
+ * @param[in] nonce_size         Size of the nonce.
+ * @param[in] pcr_data_array     Array of PCR_Data structures containing the PCR values.
+ * @param[in] num_pcrs           Number of PCRs in the pcr_data_array.
+ * @param[in] quote              Marshaled quote, or NULL.
+ * @param[in] quote_size         Size of the quote.
+ * @param[in] log                Whole measurement log, or the records after the verifier's position.
+ * @param[in] log_dictionary_id  Dictionary the verifier advertised, or LOG_DICTIONARY_NONE.
+ * @param[in] protocol_version   Highest protocol version the verifier accepts; 0 means version 1.
+ * @param[in] proof              Inclusion proof of the nonce when the quote answers a batch of requests, or NULL.
  *
  * @return Returns 0 on success, or -1 on failure.
  */
-int send_attestation_response(PCR_Data *pcr_data_array, size_t num_pcrs,
-                              uint8_t *measurement_log, size_t log_size);
+int send_attestation_response(TransportConnection *connection, const char *attestor_id, const uint8_t *nonce,
+                              size_t nonce_size, PCR_Data *pcr_data_array, size_t num_pcrs, const uint8_t *quote,
+                              size_t quote_size, const AttestorLogDelta *log, uint32_t log_dictionary_id,
+                              uint32_t protocol_version, const NonceProof *proof);
 
 /**
  * @brief Runs the attestation protocol using a state machine.
  *
  * This function manages the attestation protocol by transitioning through different states,
  * from initializing the context to processing the request, collecting data, sending the response,
- * and handling errors. It uses the AttestationContext structure to maintain state.
+ * and handling errors. It uses the AttestationContext structure to maintain state. The data comes from ctx->device
+ * when one is set, and from this platform's TPM and logs otherwise.
  *
  * @param[in,out] ctx  Pointer to the AttestationContext structure.
  */
 void run_attestation_protocol(AttestationContext *ctx);
 
+/**
+ * @brief Makes attestor_serve() answer concurrent requests with one shared quote.
+ *
+ * The TPM produces about one quote at a time, so requests from several verifiers would otherwise queue behind it.
+ * With coalescing, the nonces arriving within window_ms of the first are collected, the TPM quotes the Merkle root
+ * of them once, and every verifier receives the shared quote with the inclusion proof of its own nonce.
+ *
+ * @param[in] window_ms  How long a batch stays open; 0 quotes every request on its own.
+ * @param[in] max_batch  Requests that close a batch early; 0 or more than ATTESTOR_MAX_COALESCED means that limit.
+ */
+void attestor_set_coalescing(uint32_t window_ms, uint32_t max_batch);
+
+/**
+ * @brief Serves attestation requests until an error occurs.
+ *
+ * Accepts verifier connections on the address and answers every request with run_attestation_protocol(). A
+ * verifier may pipeline requests on one connection; they are answered in order, and the responses written
+ * together whenever the socket allows.
+ *
+ * @param[in] address  "unix:<path>" or "<host>:<port>" to listen on.
+ *
+ * @return Returns -1 on failure; does not return otherwise.
+ */
+int attestor_serve(const char *address);
+
 #endif // ATTESTOR_H
\ No newline at end of file
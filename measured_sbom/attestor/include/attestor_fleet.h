@@ -0,0 +1,112 @@
+// attestor_fleet.h
+#ifndef ATTESTOR_FLEET_H
+#define ATTESTOR_FLEET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "log_generator.h"
+#include "manifest.h"
+
+// Constants
+
+#define ATTESTOR_FLEET_ID_PREFIX "sim"          /**< Default prefix of the simulated attestors' IDs */
+#define ATTESTOR_FLEET_TICK_MS 100              /**< Interval at which log growth and reboots are applied */
+
+// Structures
+
+/**
+ * @struct AttestorFleetConfig
+ * @brief What the simulated devices of a fleet look like and how they change over time.
+ */
+typedef struct {
+    size_t device_count;            /**< Simulated attestors */
+    const char *id_prefix;          /**< Attestor IDs are "<prefix>-<number>"; NULL for ATTESTOR_FLEET_ID_PREFIX */
+    LogGeneratorConfig boot_log;    /**< Boot logs: mix, banks and length; the seed picks the first firmware build */
+    uint32_t firmware_builds;       /**< Distinct boot logs, shared by the devices running the same build */
+    size_t catalog_size;            /**< Distinct runtime measurements the devices' runtime logs draw from */
+    double growth_rate;             /**< Runtime records each device appends per second, on average */
+    double reboot_rate;             /**< Reboots per device per hour, on average; a reboot restarts the log */
+    double rogue_fraction;          /**< Share of appended records the RIM does not know, so attestation fails */
+} AttestorFleetConfig;
+
+/**
+ * @struct AttestorFleetStats
+ * @brief Counters of a fleet.
+ */
+typedef struct {
+    uint64_t requests;              /**< Attestation requests answered */
+    uint64_t records_appended;      /**< Runtime records appended across all devices */
+    uint64_t rogue_records;         /**< Appended records unknown to the RIM */
+    uint64_t reboots;               /**< Device reboots */
+} AttestorFleetStats;
+
+/**
+ * @struct AttestorFleet
+ * @brief Simulated attestors answering real attestation requests, for load-testing verifiers on one machine.
+ *
+ * Each device has its own attestor ID, software attestation key (see soft_ak.h), event log and PCR state, and
+ * answers on its own connection through run_attestation_protocol(), like an attestor with a TPM. Its log is the
+ * boot log of its firmware build followed by runtime records drawn from a shared catalog, appended at random as the
+ * fleet runs; a reboot restarts it from the boot log. PCRs always equal the replay of the current log, so every
+ * answer verifies unless it carries a rogue record. One thread serves every device.
+ */
+typedef struct AttestorFleet AttestorFleet;
+
+// Function Prototypes
+
+/**
+ * @brief Fills a configuration with defaults: 16 firmware builds with boot logs of the "boot" mix, a catalog of 4096
+ * runtime measurements, one appended record per device per minute, one reboot per device per day, no rogue records.
+ *
+ * @param[out] config        Configuration to fill.
+ * @param[in]  device_count  Simulated attestors.
+ * @param[in]  seed          Seed of everything the fleet generates.
+ */
+void attestor_fleet_config_init(AttestorFleetConfig *config, size_t device_count, uint64_t seed);
+
+/**
+ * @brief Creates a fleet and connects every device to a socketpair. The devices do not answer until started.
+ *
+ * @param[in]  config        What to simulate.
+ * @param[out] verifier_fds  Array of config->device_count entries receiving the verifier end of each device's
+ *                           connection, for verifier_daemon_add_attestor_fd().
+ *
+ * @return Pointer to the fleet, or NULL on failure.
+ */
+AttestorFleet *attestor_fleet_create(const AttestorFleetConfig *config, int *verifier_fds);
+
+/**
+ * @brief Adds the entries every device's log verifies against (boot logs and catalog) to a RIM index.
+ *
+ * Rogue records are left out on purpose.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_fleet_fill_rim(const AttestorFleet *fleet, RIM_Index *rim_index);
+
+/**
+ * @brief Returns the marshaled TPM2B_PUBLIC of one device's attestation key, for ak_cache_add().
+ *
+ * @return Returns 0 on success, or -1 if the index is out of range.
+ */
+int attestor_fleet_ak_public(const AttestorFleet *fleet, size_t index, const uint8_t **public_blob,
+                             size_t *public_size);
+
+/**
+ * @brief Starts the thread that answers requests and grows and reboots the devices.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_fleet_start(AttestorFleet *fleet);
+
+/**
+ * @brief Reads the fleet's counters. May be called while the fleet runs.
+ */
+void attestor_fleet_get_stats(const AttestorFleet *fleet, AttestorFleetStats *stats);
+
+/**
+ * @brief Stops the fleet, closes the devices' ends of the connections and releases it.
+ */
+void attestor_fleet_destroy(AttestorFleet *fleet);
+
+#endif // ATTESTOR_FLEET_H
@@ -0,0 +1,140 @@
+// attestor_log.h
+#ifndef ATTESTOR_LOG_H
+#define ATTESTOR_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "pcr.h"
+#include "cel_encoder.h"
+
+// Constants
+
+#define ATTESTOR_BOOT_LOG_PATH "/sys/kernel/security/tpm0/binary_bios_measurements"  /**< Default boot event log */
+#define ATTESTOR_IMA_LOG_PATH "/sys/kernel/security/ima/binary_runtime_measurements"  /**< Default IMA log */
+#define ATTESTOR_LOG_MARKS 16  /**< Past log ends a verifier may resume from */
+
+// Structures
+
+/**
+ * @struct LogPosition
+ * @brief A prefix of the measurement log: the records a verifier already holds, or a point the attestor served.
+ */
+typedef struct {
+    uint64_t event_count;                           /**< Records in the prefix, the header record included */
+    uint64_t size;                                  /**< Size of the prefix in bytes */
+    uint8_t digest[PCR_LOG_DIGEST_SIZE];            /**< Rolling digest of the prefix, see pcr_log_digest_update() */
+} LogPosition;
+
+/**
+ * @struct AttestorLog
+ * @brief The attestor's copy of its measurement log: the boot log, read once, followed by the runtime log records
+ * appended since.
+ *
+ * The boot log cannot change after boot and the runtime log only grows, so each refresh reads just the bytes
+ * appended since the previous one. The ends of the last ATTESTOR_LOG_MARKS refreshes are kept with their rolling
+ * digests; a verifier whose checkpoint sits at one of them is sent only the records after it.
+ *
+ * A log opened with attestor_log_open_cel() holds a CEL-TLV stream instead: the boot log's records re-encoded,
+ * followed by the IMA log's entries, encoded as each refresh reads them.
+ */
+typedef struct {
+    uint8_t *data;                                  /**< Boot log followed by the runtime records read so far */
+    size_t size;                                    /**< Bytes of complete records in data */
+    size_t capacity;                                /**< Allocated size of data */
+    size_t header_size;                             /**< Size of the first record, which describes the digest banks */
+    char *runtime_path;                             /**< Runtime log, or NULL for a boot log only */
+    off_t runtime_offset;                           /**< Bytes of the runtime log appended to data */
+    bool cel;                                       /**< data is a CEL-TLV stream and the runtime log an IMA log */
+    TPM2_ALG_ID ima_bank;                           /**< Bank of the IMA log */
+    CEL_Encoder encoder;                            /**< Encodes boot records and IMA entries of a CEL stream */
+    LogPosition end;                                /**< Current end of the log */
+    LogPosition marks[ATTESTOR_LOG_MARKS];          /**< Recent ends, oldest overwritten first */
+    uint32_t mark_count;                            /**< Valid entries in marks */
+    uint32_t mark_next;                             /**< Entry the next end is recorded in */
+} AttestorLog;
+
+/**
+ * @struct AttestorLogDelta
+ * @brief The part of the log a response carries: the whole log, or the records after a verifier's position.
+ */
+typedef struct {
+    const uint8_t *records;                         /**< First record sent; a view into the log */
+    size_t size;                                    /**< Bytes sent */
+    const LogPosition *base;                        /**< Position the records follow, or NULL for the whole log */
+    const uint8_t *header;                          /**< Header record, which a delta needs to be parsed; the start
+                                                         of the log, so records lies header_size or more after it */
+    size_t header_size;                             /**< Size of the header record */
+} AttestorLogDelta;
+
+// Function Prototypes
+
+/**
+ * @brief Reads the boot log and the runtime log as it is now.
+ *
+ * @param[out] log           Log to initialize; release it with attestor_log_close().
+ * @param[in]  boot_path     Boot event log in TCG format, e.g. ATTESTOR_BOOT_LOG_PATH.
+ * @param[in]  runtime_path  Runtime log of TCG_PCR_EVENT2 records continuing the boot log, or NULL.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_log_open(AttestorLog *log, const char *boot_path, const char *runtime_path);
+
+/**
+ * @brief Reads the boot log and the IMA log as they are now into one CEL-TLV stream.
+ *
+ * @param[out] log       Log to initialize; release it with attestor_log_close().
+ * @param[in]  boot_path Boot event log in TCG format, e.g. ATTESTOR_BOOT_LOG_PATH.
+ * @param[in]  ima_path  IMA runtime measurement log, e.g. ATTESTOR_IMA_LOG_PATH, or NULL.
+ * @param[in]  ima_bank  Bank of the IMA log: TPM2_ALG_SHA1 for binary_runtime_measurements, or the algorithm of a
+ *                       binary_runtime_measurements_<alg> log.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_log_open_cel(AttestorLog *log, const char *boot_path, const char *ima_path, TPM2_ALG_ID ima_bank);
+
+/**
+ * @brief Starts a log from a boot log held in memory rather than read from a file, as simulated attestors do.
+ *
+ * @param[out] log        Log to initialize; release it with attestor_log_close().
+ * @param[in]  boot_log   Boot event log in TCG format; copied.
+ * @param[in]  boot_size  Size of the boot log.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_log_open_buffer(AttestorLog *log, const uint8_t *boot_log, size_t boot_size);
+
+/**
+ * @brief Releases a log. Safe on a log that failed to open.
+ */
+void attestor_log_close(AttestorLog *log);
+
+/**
+ * @brief Appends the records added to the runtime log since the last refresh.
+ *
+ * Only complete records are appended; one still being written is picked up by the next refresh. The entries of an
+ * IMA log are encoded as CEL records first. Views handed out by attestor_log_delta() are invalidated.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int attestor_log_refresh(AttestorLog *log);
+
+/**
+ * @brief Appends runtime records held in memory, as attestor_log_refresh() appends those read from the runtime log.
+ *
+ * Views handed out by attestor_log_delta() are invalidated.
+ *
+ * @return Returns 0 on success, or -1 if the records are malformed or end in a partial record.
+ */
+int attestor_log_append(AttestorLog *log, const uint8_t *records, size_t size);
+
+/**
+ * @brief Selects what a response to a verifier holding a given position carries.
+ *
+ * @param[in]  log    Open log.
+ * @param[in]  known  Position of the verifier, or NULL if it holds nothing.
+ * @param[out] delta  The records after known if it is a recent end of this log, or the whole log otherwise.
+ */
+void attestor_log_delta(const AttestorLog *log, const LogPosition *known, AttestorLogDelta *delta);
+
+#endif // ATTESTOR_LOG_H
@@ -0,0 +1,113 @@
+// tpm_collect.h
+#ifndef TPM_COLLECT_H
+#define TPM_COLLECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tss2/tss2_sys.h>
+
+// Constants
+
+#ifndef TPM_PCR_COUNT
+#define TPM_PCR_COUNT 24  /**< TPM 2.0 typically has 24 PCR registers */
+#endif
+
+#define TPM_DIGESTS_PER_READ 8  /**< Most digests a TPM2_PCR_Read response carries (TPML_DIGEST) */
+#define TPM_PCR_READ_RETRIES 4  /**< Times a snapshot is restarted when a PCR is extended while it is read */
+#define TPM_QUOTE_MAX_SIZE (sizeof(TPM2B_ATTEST) + sizeof(TPMT_SIGNATURE))  /**< Bound on a marshaled quote */
+
+// Structures
+
+/**
+ * @struct TPM_Collector
+ * @brief An open TPM and the PCR selection every collection covers.
+ *
+ * The TPM is reached through the TCTI loader, so the same code runs against a hardware TPM, the resource manager
+ * or swtpm. The selection is every allocated PCR of every active bank, discovered once when the collector is opened.
+ */
+typedef struct {
+    TSS2_TCTI_CONTEXT *tcti;        /**< Transmission interface */
+    TSS2_SYS_CONTEXT *sys;          /**< System API context */
+    TPMI_DH_OBJECT ak_handle;       /**< Persistent attestation key quotes are signed with */
+    TPML_PCR_SELECTION selection;   /**< Every allocated PCR of every active bank */
+    size_t snapshot_size;           /**< Bytes of digests a snapshot of the selection needs */
+} TPM_Collector;
+
+/**
+ * @struct TPM_PcrBank
+ * @brief PCR values of one bank in a snapshot.
+ */
+typedef struct {
+    TPM2_ALG_ID alg;                /**< Hash algorithm of the bank */
+    uint16_t digest_size;           /**< Digest size in bytes */
+    uint32_t pcr_mask;              /**< Bit n set if PCR n was read */
+    uint8_t *digests;               /**< TPM_PCR_COUNT digests indexed by PCR number; a view into the snapshot buffer */
+} TPM_PcrBank;
+
+/**
+ * @struct TPM_PcrSnapshot
+ * @brief PCR values of every active bank, read with the fewest TPM2_PCR_Read commands.
+ */
+typedef struct {
+    uint32_t bank_count;                    /**< Number of valid banks */
+    TPM_PcrBank banks[TPM2_NUM_PCR_BANKS];  /**< Banks, in selection order */
+    uint32_t update_counter;                /**< pcrUpdateCounter the whole snapshot was read under */
+    uint32_t read_commands;                 /**< TPM2_PCR_Read commands issued, retries included */
+} TPM_PcrSnapshot;
+
+// Function Prototypes
+
+/**
+ * @brief Opens a TPM and discovers its active PCR banks.
+ *
+ * @param[out] collector  Collector to initialize.
+ * @param[in]  tcti_conf  TCTI loader configuration, e.g. "swtpm:host=localhost,port=2321" or "device:/dev/tpmrm0";
+ *                        NULL tries the loader's defaults.
+ * @param[in]  ak_handle  Persistent handle of the attestation key.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int tpm_collector_open(TPM_Collector *collector, const char *tcti_conf, TPMI_DH_OBJECT ak_handle);
+
+/**
+ * @brief Closes the TPM. Safe on a collector that failed to open.
+ */
+void tpm_collector_close(TPM_Collector *collector);
+
+/**
+ * @brief Reads every selected PCR of every active bank into one buffer.
+ *
+ * Each TPM2_PCR_Read is sent the whole remaining selection and returns up to TPM_DIGESTS_PER_READ digests, so n
+ * PCR values cost ceil(n / 8) commands whatever banks they fall in. If the pcrUpdateCounter changes between
+ * commands the snapshot would mix two PCR states, and it is read again.
+ *
+ * @param[in]  collector    Open collector.
+ * @param[out] buffer       Buffer of at least collector->snapshot_size bytes receiving the digests.
+ * @param[in]  buffer_size  Size of the buffer.
+ * @param[out] snapshot     Snapshot whose banks point into buffer.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int tpm_read_pcrs(TPM_Collector *collector, uint8_t *buffer, size_t buffer_size, TPM_PcrSnapshot *snapshot);
+
+/**
+ * @brief Issues one TPM2_Quote over the full selection with the nonce as qualifying data.
+ *
+ * @param[in]  collector       Open collector.
+ * @param[in]  nonce           Nonce of the verifier's request.
+ * @param[in]  nonce_size      Size of the nonce.
+ * @param[out] quote           Buffer receiving the marshaled TPM2B_ATTEST followed by the marshaled TPMT_SIGNATURE.
+ * @param[in]  quote_capacity  Size of the buffer; TPM_QUOTE_MAX_SIZE always suffices.
+ * @param[out] quote_size      Size of the marshaled quote.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int tpm_quote(TPM_Collector *collector, const uint8_t *nonce, size_t nonce_size, uint8_t *quote,
+              size_t quote_capacity, size_t *quote_size);
+
+/**
+ * @brief Returns the bank of a snapshot with the given algorithm, or NULL.
+ */
+const TPM_PcrBank *tpm_snapshot_bank(const TPM_PcrSnapshot *snapshot, TPM2_ALG_ID alg);
+
+#endif // TPM_COLLECT_H
@@ -1,154 +1,415 @@
-// Implement a simple state machine to run attestor side of the attestation protocol. This code reads the one or more 
-// PCR value from TPM and measurement logs from the platform. The attestation data is sent to the verifier. 
+// Implement a simple state machine to run attestor side of the attestation protocol. This code reads the one or more
+// PCR value from TPM and measurement logs from the platform. The attestation data is sent to the verifier.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
 #include "attestation.pb-c.h"  // Protobuf definitions for attestation
 #include "attestor.h"
+#include "event_log_parser.h"
+#include "tpm_collect.h"
 
+// TPM the attestation data is collected from; dummy data is served until one is opened
+static TPM_Collector attestor_tpm;
+static bool attestor_tpm_ready = false;
 
+int attestor_tpm_open(const char *tcti_conf, uint32_t ak_handle) {
+    attestor_tpm_close();
+    if (tpm_collector_open(&attestor_tpm, tcti_conf, ak_handle) != 0) {
+        return -1;
+    }
+    attestor_tpm_ready = true;
+    return 0;
+}
 
-// Structure to hold PCR value and its size
-typedef struct {
-    uint8_t *value;
-    size_t size;
-} PCR_Data;
+void attestor_tpm_close(void) {
+    if (attestor_tpm_ready) {
+        tpm_collector_close(&attestor_tpm);
+        attestor_tpm_ready = false;
+    }
+}
 
-// Read all PCR values from TPM
-int collect_all_pcr_values(PCR_Data **pcr_data_array, size_t *num_pcrs) {
-    // For demonstration purposes, we'll use dummy data
-    // In a real use case, this function would collect data from the TPM
+// Measurement log served to verifiers; a dummy log is served until one is opened
+static AttestorLog attestor_log;
+static bool attestor_log_ready = false;
 
-    *num_pcrs = 24; // TPM 2.0 typically has 24 PCR registers
+int attestor_event_log_open(const char *boot_path, const char *runtime_path) {
+    attestor_event_log_close();
+    if (attestor_log_open(&attestor_log, boot_path, runtime_path) != 0) {
+        return -1;
+    }
+    attestor_log_ready = true;
+    return 0;
+}
 
-    // Allocate memory for the array of PCR_Data structures
-    *pcr_data_array = malloc(*num_pcrs * sizeof(PCR_Data));
-    if (*pcr_data_array == NULL) {
-        fprintf(stderr, "Error allocating memory for PCR data array\n");
+int attestor_event_log_open_cel(const char *boot_path, const char *ima_path, TPM2_ALG_ID ima_bank) {
+    attestor_event_log_close();
+    if (attestor_log_open_cel(&attestor_log, boot_path, ima_path, ima_bank) != 0) {
         return -1;
     }
+    attestor_log_ready = true;
+    return 0;
+}
+
+void attestor_event_log_close(void) {
+    if (attestor_log_ready) {
+        attestor_log_close(&attestor_log);
+        attestor_log_ready = false;
+    }
+}
 
-    for (size_t i = 0; i < *num_pcrs; i++) {
-        // Dummy PCR value for each PCR
-        const char *dummy_pcr = "dummy_pcr_value";
-        size_t pcr_size = strlen(dummy_pcr);
+// Dictionary logs are compressed with for verifiers that share it; NULL sends every log uncompressed
+static const LogDictionary *attestor_dictionary = NULL;
 
-        // Allocate memory for each PCR value
-        (*pcr_data_array)[i].value = malloc(pcr_size);
-        if ((*pcr_data_array)[i].value == NULL) {
-            fprintf(stderr, "Error allocating memory for PCR value %zu\n", i);
+void attestor_set_log_dictionary(const LogDictionary *dictionary) {
+    attestor_dictionary = dictionary;
+}
 
-            // Free previously allocated memory
-            for (size_t j = 0; j < i; j++) {
-                free((*pcr_data_array)[j].value);
-            }
-            free(*pcr_data_array);
-            return -1;
+// Read all PCR values from TPM
+int collect_all_pcr_values(PCR_Data **pcr_data_array, size_t *num_pcrs) {
+    size_t digest_bytes = attestor_tpm_ready ? attestor_tpm.snapshot_size : 0;
+    const char *dummy_pcr = "dummy_pcr_value";
+    size_t dummy_size = strlen(dummy_pcr);
+    if (!attestor_tpm_ready) {
+        digest_bytes = TPM_PCR_COUNT * dummy_size;
+    }
+
+    // One allocation holds the array and every digest it points to
+    *num_pcrs = 0;
+    *pcr_data_array = malloc(TPM_PCR_COUNT * sizeof(PCR_Data) + digest_bytes);
+    if (*pcr_data_array == NULL) {
+        fprintf(stderr, "Error allocating memory for PCR data array\n");
+        return -1;
+    }
+    uint8_t *digests = (uint8_t *)(*pcr_data_array + TPM_PCR_COUNT);
+
+    if (!attestor_tpm_ready) {
+        // For demonstration purposes, we'll use dummy data
+        for (size_t i = 0; i < TPM_PCR_COUNT; i++) {
+            (*pcr_data_array)[i].value = digests + i * dummy_size;
+            (*pcr_data_array)[i].size = dummy_size;
+            (*pcr_data_array)[i].index = (uint32_t)i;
+            memcpy((*pcr_data_array)[i].value, dummy_pcr, dummy_size);
         }
+        *num_pcrs = TPM_PCR_COUNT;
+        return 0;
+    }
 
-        // Copy the dummy PCR value
-        memcpy((*pcr_data_array)[i].value, dummy_pcr, pcr_size);
-        (*pcr_data_array)[i].size = pcr_size;
+    // All banks are read, and quoted, but the response reports the SHA-256 bank the verifier compares against
+    TPM_PcrSnapshot snapshot;
+    const TPM_PcrBank *bank;
+    if (tpm_read_pcrs(&attestor_tpm, digests, digest_bytes, &snapshot) != 0 ||
+        (bank = tpm_snapshot_bank(&snapshot, TPM2_ALG_SHA256)) == NULL) {
+        fprintf(stderr, "Error reading PCR values from the TPM\n");
+        free(*pcr_data_array);
+        *pcr_data_array = NULL;
+        return -1;
+    }
+    for (size_t i = 0; i < TPM_PCR_COUNT; i++) {
+        if (bank->pcr_mask & (1u << i)) {
+            (*pcr_data_array)[*num_pcrs].value = bank->digests + i * bank->digest_size;
+            (*pcr_data_array)[*num_pcrs].size = bank->digest_size;
+            (*pcr_data_array)[*num_pcrs].index = (uint32_t)i;
+            (*num_pcrs)++;
+        }
     }
 
     return 0;  // Success
 }
 
-// Read measurement logs from the platform
-int collect_measurement_logs(uint8_t **measurement_log, size_t *log_size) {
-    // For demonstration purposes, we'll use dummy data
-    // In a real use case, this function would collect data from the system
-
-    // Dummy measurement log
-    const char *dummy_log = "dummy_measurement_log";
-    *log_size = strlen(dummy_log);
+// Quote the PCRs over the verifier's nonce
+int collect_quote(const uint8_t *nonce, size_t nonce_size, uint8_t **quote, size_t *quote_size) {
+    *quote = NULL;
+    *quote_size = 0;
+    if (!attestor_tpm_ready) {
+        return 0;  // Dummy data carries no quote
+    }
 
-    *measurement_log = malloc(*log_size);
-    if (*measurement_log == NULL) {
-        fprintf(stderr, "Error allocating memory for measurement log\n");
+    *quote = malloc(TPM_QUOTE_MAX_SIZE);
+    if (*quote == NULL) {
+        fprintf(stderr, "Error allocating memory for quote\n");
         return -1;
     }
-    memcpy(*measurement_log, dummy_log, *log_size);
+    if (tpm_quote(&attestor_tpm, nonce, nonce_size, *quote, TPM_QUOTE_MAX_SIZE, quote_size) != 0) {
+        free(*quote);
+        *quote = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Selects the part of the cached log a verifier at a given position is sent.
+ */
+static void measurement_log_delta(const LogPosition *known, AttestorLogDelta *delta) {
+    if (!attestor_log_ready) {
+        // For demonstration purposes, we'll use dummy data
+        static const char dummy_log[] = "dummy_measurement_log";
+        memset(delta, 0, sizeof(*delta));
+        delta->records = (const uint8_t *)dummy_log;
+        delta->size = strlen(dummy_log);
+        return;
+    }
+    attestor_log_delta(&attestor_log, known, delta);
+}
 
+// Read measurement logs from the platform
+int collect_measurement_logs(const LogPosition *known, AttestorLogDelta *delta) {
+    // Only the records appended to the runtime log since the last round are read
+    if (attestor_log_ready && attestor_log_refresh(&attestor_log) != 0) {
+        fprintf(stderr, "Error reading the runtime measurement log\n");
+        return -1;
+    }
+    measurement_log_delta(known, delta);
     return 0;  // Success
 }
-void process_attestation_request(uint8_t *request_buffer, size_t request_size) {
+
+int process_attestation_request(uint8_t *request_buffer, size_t request_size, uint8_t **nonce, size_t *nonce_size,
+                                LogPosition *known, uint32_t *log_dictionary_id, uint32_t *protocol_version) {
     AttestationRequest *request = attestation_request__unpack(NULL, request_size, request_buffer);
     if (!request) {
         fprintf(stderr, "Error unpacking AttestationRequest\n");
-        return;
+        return -1;
+    }
+
+    // Keep the nonce; the response echoes it so pipelined responses can be matched to their requests
+    *nonce_size = request->nonce.len;
+    *nonce = malloc(*nonce_size ? *nonce_size : 1);
+    if (*nonce == NULL) {
+        fprintf(stderr, "Error allocating memory for nonce\n");
+        attestation_request__free_unpacked(request, NULL);
+        return -1;
+    }
+    if (*nonce_size > 0) {
+        memcpy(*nonce, request->nonce.data, *nonce_size);
     }
 
-    // Print received nonce (for demo purposes)
-    printf("Received nonce: ");
-    for (size_t i = 0; i < request->nonce.len; i++) {
-        printf("%02x", request->nonce.data[i]);
+    // A verifier with a checkpoint of this log asks only for the records after it
+    memset(known, 0, sizeof(*known));
+    if (request->known_events > 0 && request->known_log_digest.len == PCR_LOG_DIGEST_SIZE) {
+        known->event_count = request->known_events;
+        known->size = request->known_log_size;
+        memcpy(known->digest, request->known_log_digest.data, PCR_LOG_DIGEST_SIZE);
     }
-    printf("\n");
+    *log_dictionary_id = request->log_dictionary_id;
+    *protocol_version = request->protocol_version;
 
     // Free memory
     attestation_request__free_unpacked(request, NULL);
+    return 0;
 }
 
-void send_attestation_response() {
-    AttestationResponse response = ATTESTATION_RESPONSE__INIT;  // Init response struct
-    response.attestor_id = "attestor456";
+/**
+ * @brief Indexes the records a response carries: the offset of each one from the first.
+ *
+ * The records are walked from the header at the start of the log, which a delta needs to be parsed. The dummy log
+ * has no header and gets no index.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+static int log_event_offsets(const AttestorLogDelta *log, uint32_t **offsets, size_t *count) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    size_t start = log->header ? (size_t)(log->records - log->header) : 0;
+    size_t capacity = 0;
+
+    *offsets = NULL;
+    *count = 0;
+    if (!log->header || log->size == 0) {
+        return 0;
+    }
+    if (tcg_log_cursor_init(&cursor, log->header, start + log->size) != TCG_LOG_OK ||
+        (start > 0 && tcg_log_cursor_seek(&cursor, start, log->base ? log->base->event_count : 1) != TCG_LOG_OK)) {
+        fprintf(stderr, "Error indexing the measurement log\n");
+        return -1;
+    }
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        if (*count == capacity) {
+            capacity = capacity ? 2 * capacity : 256;
+            uint32_t *grown = realloc(*offsets, capacity * sizeof(**offsets));
+            if (!grown) {
+                fprintf(stderr, "Error allocating memory for the event offset index\n");
+                free(*offsets);
+                *offsets = NULL;
+                return -1;
+            }
+            *offsets = grown;
+        }
+        (*offsets)[(*count)++] = (uint32_t)(event.offset - start);
+    }
+    if (status != TCG_LOG_END) {
+        fprintf(stderr, "Error indexing the measurement log\n");
+        free(*offsets);
+        *offsets = NULL;
+        return -1;
+    }
+    return 0;
+}
 
-    
-    // Serialize the response
-    size_t response_size = attestation_response__get_packed_size(&response);
-    uint8_t *response_buffer = malloc(response_size);
-    attestation_response__pack(&response, response_buffer);
+int send_attestation_response(TransportConnection *connection, const char *attestor_id, const uint8_t *nonce,
+                              size_t nonce_size, PCR_Data *pcr_data_array, size_t num_pcrs, const uint8_t *quote,
+                              size_t quote_size, const AttestorLogDelta *log, uint32_t log_dictionary_id,
+                              uint32_t protocol_version, const NonceProof *proof) {
+    AttestationResponse response = ATTESTATION_RESPONSE__INIT;  // Init response struct
+    NonceInclusionProof nonce_proof = NONCE_INCLUSION_PROOF__INIT;
+    ProtobufCBinaryData siblings[NONCE_TREE_MAX_DEPTH];
+    PCR pcrs[TPM_PCR_COUNT];
+    PCR *pcr_pointers[TPM_PCR_COUNT];
+    uint8_t *compressed_log = NULL;
+    LogChunk *chunks = NULL;
+    LogChunk **chunk_pointers = NULL;
+    uint32_t *event_offsets = NULL;
+    size_t event_count = 0;
+
+    if (num_pcrs > TPM_PCR_COUNT) {
+        fprintf(stderr, "Too many PCR values: %zu\n", num_pcrs);
+        return -1;
+    }
+    for (size_t i = 0; i < num_pcrs; i++) {
+        PCR pcr = PCR__INIT;
+        pcr.index = (int32_t)pcr_data_array[i].index;
+        pcr.value.data = pcr_data_array[i].value;
+        pcr.value.len = pcr_data_array[i].size;
+        pcrs[i] = pcr;
+        pcr_pointers[i] = &pcrs[i];
+    }
 
-    printf("Serialized AttestationResponse (size: %zu):\n", response_size);
-    for (size_t i = 0; i < response_size; i++) {
-        printf("%02x ", response_buffer[i]);
+    response.attestor_id = (char *)attestor_id;
+    response.n_pcrs = num_pcrs;
+    response.pcrs = pcr_pointers;
+    response.nonce.data = (uint8_t *)nonce;
+    response.nonce.len = nonce_size;
+    response.quote.data = (uint8_t *)quote;
+    response.quote.len = quote_size;
+    response.measurement_log.data = (uint8_t *)log->records;
+    response.measurement_log.len = log->size;
+    if (attestor_dictionary && log_dictionary_id == attestor_dictionary->id && log->size > 0) {
+        // Most of a fleet's log is in the shared dictionary; send the frame instead when it is smaller
+        size_t bound = log_dictionary_compress_bound(log->size);
+        size_t compressed_size;
+        compressed_log = malloc(bound);
+        if (compressed_log &&
+            log_dictionary_compress(attestor_dictionary, log->records, log->size, compressed_log, bound,
+                                    &compressed_size) == 0 &&
+            compressed_size < log->size) {
+            response.measurement_log.data = NULL;
+            response.measurement_log.len = 0;
+            response.log_dictionary_id = attestor_dictionary->id;
+            response.compressed_log.data = compressed_log;
+            response.compressed_log.len = compressed_size;
+        }
+    }
+    if (protocol_version >= ATTESTOR_PROTOCOL_V2) {
+        // The raw log in chunks, each a view into the log, with the offset of every record in it
+        size_t chunk_count = response.compressed_log.len > 0 ? 0 :
+                             (log->size + ATTESTOR_LOG_CHUNK_SIZE - 1) / ATTESTOR_LOG_CHUNK_SIZE;
+        chunks = malloc((chunk_count ? chunk_count : 1) * sizeof(*chunks));
+        chunk_pointers = malloc((chunk_count ? chunk_count : 1) * sizeof(*chunk_pointers));
+        if (!chunks || !chunk_pointers || log_event_offsets(log, &event_offsets, &event_count) != 0) {
+            fprintf(stderr, "Error encoding the measurement log\n");
+            free(chunks);
+            free(chunk_pointers);
+            free(compressed_log);
+            return -1;
+        }
+        for (size_t i = 0; i < chunk_count; i++) {
+            LogChunk chunk = LOG_CHUNK__INIT;
+            chunk.offset = i * ATTESTOR_LOG_CHUNK_SIZE;
+            chunk.data.data = (uint8_t *)log->records + chunk.offset;
+            chunk.data.len = log->size - chunk.offset < ATTESTOR_LOG_CHUNK_SIZE ? log->size - chunk.offset
+                                                                                 : ATTESTOR_LOG_CHUNK_SIZE;
+            chunks[i] = chunk;
+            chunk_pointers[i] = &chunks[i];
+        }
+        response.protocol_version = ATTESTOR_PROTOCOL_V2;
+        response.measurement_log.data = NULL;
+        response.measurement_log.len = 0;
+        response.n_log_chunks = chunk_count;
+        response.log_chunks = chunk_pointers;
+        response.n_event_offsets = event_count;
+        response.event_offsets = event_offsets;
+    }
+    if (log->base) {
+        // Only the records after the verifier's position, with the header it needs to parse them
+        response.log_base_events = log->base->event_count;
+        response.log_base_size = log->base->size;
+        response.log_base_digest.data = (uint8_t *)log->base->digest;
+        response.log_base_digest.len = PCR_LOG_DIGEST_SIZE;
+        response.log_header.data = (uint8_t *)log->header;
+        response.log_header.len = log->header_size;
+    }
+    if (proof) {
+        // The quote is over the root of a batch of nonces; show where this request's nonce sits in it
+        for (uint32_t i = 0; i < proof->sibling_count; i++) {
+            siblings[i].data = (uint8_t *)proof->siblings[i];
+            siblings[i].len = NONCE_TREE_DIGEST_SIZE;
+        }
+        nonce_proof.leaf_index = proof->leaf_index;
+        nonce_proof.leaf_count = proof->leaf_count;
+        nonce_proof.n_siblings = proof->sibling_count;
+        nonce_proof.siblings = siblings;
+        response.nonce_proof = &nonce_proof;
     }
-    printf("\n");
 
-    // Simulate sending response (in real use case, send over network)
+    // Serialize the response straight into a frame buffer
+    size_t response_size = attestation_response__get_packed_size(&response);
+    uint8_t *response_buffer = transport_frame_get(connection->pool, response_size);
+    if (response_buffer == NULL) {
+        fprintf(stderr, "Error allocating memory for response buffer\n");
+        free(compressed_log);
+        free(chunks);
+        free(chunk_pointers);
+        free(event_offsets);
+        return -1;
+    }
+    attestation_response__pack(&response, response_buffer);
+    transport_queue_frame(connection, response_buffer, response_size);
+    free(compressed_log);
+    free(chunks);
+    free(chunk_pointers);
+    free(event_offsets);
 
-    // Free the allocated memory
-    free(response_buffer);
+    return 0;
 }
 
-
-typedef enum {
-    STATE_INIT,
-    STATE_PROCESS_REQUEST,
-    STATE_COLLECT_DATA,
-    STATE_SEND_RESPONSE,
-    STATE_DONE,
-    STATE_ERROR
-} AttestationState;
-
-typedef struct {
-    AttestationState state;
-    uint8_t *request_buffer;
-    size_t request_size;
-    uint8_t *pcr_value;
-    size_t pcr_size;
-    uint8_t *measurement_log;
-    size_t log_size;
-} AttestationContext;
-
 void run_attestation_protocol(AttestationContext *ctx) {
-    while (ctx->state != STATE_DONE && ctx->state != STATE_ERROR) {
+    const AttestorDevice *device = ctx->device;
+    while (ctx->state != STATE_DONE) {
         switch (ctx->state) {
             case STATE_INIT:
                 // Initialize context
-                ctx->pcr_value = NULL;
-                ctx->measurement_log = NULL;
+                ctx->nonce = NULL;
+                ctx->pcr_data_array = NULL;
+                ctx->num_pcrs = 0;
+                ctx->quote = NULL;
+                ctx->quote_size = 0;
                 ctx->state = STATE_PROCESS_REQUEST;
                 break;
 
             case STATE_PROCESS_REQUEST:
-                process_attestation_request(ctx->request_buffer, ctx->request_size);
-                ctx->state = STATE_COLLECT_DATA;
+                if (process_attestation_request(ctx->request_buffer, ctx->request_size, &ctx->nonce,
+                                                &ctx->nonce_size, &ctx->known, &ctx->log_dictionary_id,
+                                                &ctx->protocol_version) == 0) {
+                    ctx->state = STATE_COLLECT_DATA;
+                } else {
+                    ctx->state = STATE_ERROR;
+                }
                 break;
 
             case STATE_COLLECT_DATA:
-                if (collect_attestation_data(&ctx->pcr_value, &ctx->pcr_size, &ctx->measurement_log, &ctx->log_size) == 0) {
+                if (device ? device->collect_pcrs(device->device, &ctx->pcr_data_array, &ctx->num_pcrs) == 0 &&
+                             device->collect_quote(device->device, ctx->nonce, ctx->nonce_size, &ctx->quote,
+                                                   &ctx->quote_size) == 0 &&
+                             device->collect_log(device->device, &ctx->known, &ctx->log) == 0
+                           : collect_all_pcr_values(&ctx->pcr_data_array, &ctx->num_pcrs) == 0 &&
+                             collect_quote(ctx->nonce, ctx->nonce_size, &ctx->quote, &ctx->quote_size) == 0 &&
+                             collect_measurement_logs(&ctx->known, &ctx->log) == 0) {
                     ctx->state = STATE_SEND_RESPONSE;
                 } else {
                     ctx->state = STATE_ERROR;
@@ -156,8 +417,14 @@ void run_attestation_protocol(AttestationContext *ctx) {
                 break;
 
             case STATE_SEND_RESPONSE:
-                send_attestation_response();
-                ctx->state = STATE_DONE;
+                if (send_attestation_response(ctx->connection, device ? device->attestor_id : ATTESTOR_ID,
+                                              ctx->nonce, ctx->nonce_size, ctx->pcr_data_array, ctx->num_pcrs,
+                                              ctx->quote, ctx->quote_size, &ctx->log, ctx->log_dictionary_id,
+                                              ctx->protocol_version, NULL) == 0) {
+                    ctx->state = STATE_DONE;
+                } else {
+                    ctx->state = STATE_ERROR;
+                }
                 break;
 
             case STATE_ERROR:
@@ -173,11 +440,284 @@ void run_attestation_protocol(AttestationContext *ctx) {
     }
 
     // Clean up
-    if (ctx->pcr_value) {
-        free(ctx->pcr_value);
+    free(ctx->nonce);
+    ctx->nonce = NULL;
+    free(ctx->pcr_data_array);  // The PCR values share its allocation
+    ctx->pcr_data_array = NULL;
+    free(ctx->quote);
+    ctx->quote = NULL;
+}
+
+// Coalescing
+
+/**
+ * @struct PendingRequest
+ * @brief A request waiting for the coalesced quote of its batch.
+ */
+typedef struct {
+    TransportConnection *connection;    /**< Connection the response is queued on */
+    uint8_t *nonce;                     /**< Nonce of the request */
+    size_t nonce_size;                  /**< Size of the nonce */
+    LogPosition known;                  /**< Log prefix the verifier already holds */
+    uint32_t log_dictionary_id;         /**< Dictionary the verifier can decompress the log with */
+    uint32_t protocol_version;          /**< Highest protocol version the verifier accepts */
+} PendingRequest;
+
+// Requests collected since the batch window opened; the server is single-threaded
+static uint32_t coalesce_window_ms = 0;
+static uint32_t coalesce_max = ATTESTOR_MAX_COALESCED;
+static PendingRequest pending[ATTESTOR_MAX_COALESCED];
+static uint32_t pending_count = 0;
+static uint64_t pending_deadline_ms = 0;
+
+void attestor_set_coalescing(uint32_t window_ms, uint32_t max_batch) {
+    coalesce_window_ms = window_ms;
+    coalesce_max = max_batch == 0 || max_batch > ATTESTOR_MAX_COALESCED ? ATTESTOR_MAX_COALESCED : max_batch;
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Writes queued responses, waiting for the socket to become writable only while some remain.
+ *
+ * @return Returns 0 if the connection stays open, or -1 if it must be closed.
+ */
+static int attestor_flush(int epoll_fd, TransportConnection *connection) {
+    TransportStatus status = transport_flush(connection);
+    if (status == TRANSPORT_ERROR) {
+        return -1;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+    if (status == TRANSPORT_AGAIN) {
+        event.events |= EPOLLOUT;
+    }
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/**
+ * @brief Answers every pending request with one PCR read, one quote and one log refresh.
+ *
+ * A lone request is quoted over its own nonce, exactly as without coalescing. A batch is quoted over the root of
+ * the tree of its nonces, and each response carries the inclusion proof of its nonce.
+ */
+static void attestor_answer_batch(int epoll_fd) {
+    const uint8_t *nonces[ATTESTOR_MAX_COALESCED];
+    size_t nonce_sizes[ATTESTOR_MAX_COALESCED];
+    NonceTree tree = { 0 };
+    PCR_Data *pcr_data_array = NULL;
+    size_t num_pcrs = 0;
+    uint8_t *quote = NULL;
+    size_t quote_size = 0;
+    AttestorLogDelta log;
+    bool shared = pending_count > 1;
+
+    for (uint32_t i = 0; i < pending_count; i++) {
+        nonces[i] = pending[i].nonce;
+        nonce_sizes[i] = pending[i].nonce_size;
+    }
+    bool collected = (!shared || nonce_tree_build(&tree, nonces, nonce_sizes, pending_count) == 0) &&
+                     collect_all_pcr_values(&pcr_data_array, &num_pcrs) == 0 &&
+                     (shared ? collect_quote(nonce_tree_root(&tree), NONCE_TREE_DIGEST_SIZE, &quote, &quote_size)
+                             : collect_quote(nonces[0], nonce_sizes[0], &quote, &quote_size)) == 0 &&
+                     collect_measurement_logs(&pending[0].known, &log) == 0;
+    if (!collected) {
+        fprintf(stderr, "An error occurred collecting attestation data for %u requests\n", pending_count);
+    }
+
+    for (uint32_t i = 0; i < pending_count; i++) {
+        NonceProof proof;
+        if (collected && i > 0) {
+            measurement_log_delta(&pending[i].known, &log);  // Same log state, this verifier's position
+        }
+        if (collected && (!shared || nonce_tree_proof(&tree, i, &proof) == 0) &&
+            send_attestation_response(pending[i].connection, ATTESTOR_ID, pending[i].nonce, pending[i].nonce_size,
+                                      pcr_data_array, num_pcrs, quote, quote_size, &log,
+                                      pending[i].log_dictionary_id, pending[i].protocol_version,
+                                      shared ? &proof : NULL) != 0) {
+            fprintf(stderr, "An error occurred during the attestation protocol\n");
+        }
+    }
+
+    // Write to each connection once; one that fails is closed by the event loop when it reports the error
+    for (uint32_t i = 0; i < pending_count; i++) {
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) {
+            seen = pending[j].connection == pending[i].connection;
+        }
+        if (!seen && attestor_flush(epoll_fd, pending[i].connection) != 0) {
+            struct epoll_event event = { .events = EPOLLIN | EPOLLOUT, .data.ptr = pending[i].connection };
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, pending[i].connection->fd, &event);
+        }
+    }
+    for (uint32_t i = 0; i < pending_count; i++) {
+        free(pending[i].nonce);
+    }
+    pending_count = 0;
+
+    nonce_tree_free(&tree);
+    free(pcr_data_array);  // The PCR values share its allocation
+    free(quote);
+}
+
+/**
+ * @brief Adds a request to the open batch, opening one if needed, and answers the batch once it is full.
+ *
+ * @return Returns 0 on success, or -1 if the request is malformed.
+ */
+static int attestor_coalesce(int epoll_fd, TransportConnection *connection, uint8_t *request, size_t request_size) {
+    PendingRequest *entry = &pending[pending_count];
+    if (process_attestation_request(request, request_size, &entry->nonce, &entry->nonce_size, &entry->known,
+                                    &entry->log_dictionary_id, &entry->protocol_version) != 0) {
+        return -1;
     }
-    if (ctx->measurement_log) {
-        free(ctx->measurement_log);
+    entry->connection = connection;
+    if (pending_count++ == 0) {
+        pending_deadline_ms = monotonic_ms() + coalesce_window_ms;
+    }
+    if (pending_count == coalesce_max) {
+        attestor_answer_batch(epoll_fd);
+    }
+    return 0;
+}
+
+/**
+ * @brief Drops the pending requests of a connection that is about to close.
+ */
+static void attestor_forget(TransportConnection *connection) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < pending_count; i++) {
+        if (pending[i].connection == connection) {
+            free(pending[i].nonce);
+        } else {
+            pending[kept++] = pending[i];
+        }
+    }
+    pending_count = kept;
+}
+
+// Server
+
+/**
+ * @brief Answers every request that has fully arrived on a connection, or adds it to the open batch when
+ * coalescing.
+ *
+ * @return Returns 0 if the connection stays open, or -1 if it must be closed.
+ */
+static int attestor_on_readable(int epoll_fd, TransportConnection *connection) {
+    uint8_t *request;
+    size_t request_size;
+    TransportStatus status;
+
+    while ((status = transport_read_frame(connection, &request, &request_size)) == TRANSPORT_OK) {
+        if (coalesce_window_ms > 0) {
+            attestor_coalesce(epoll_fd, connection, request, request_size);
+        } else {
+            AttestationContext ctx = { .state = STATE_INIT, .connection = connection };
+            ctx.request_buffer = request;
+            ctx.request_size = request_size;
+            run_attestation_protocol(&ctx);
+        }
+        transport_frame_put(connection->pool, request);
+    }
+    if (status != TRANSPORT_AGAIN) {
+        return -1;
+    }
+    return 0;
+}
+
+static void attestor_close(int epoll_fd, TransportConnection *connection) {
+    attestor_forget(connection);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+    transport_connection_close(connection);
+    free(connection);
+}
+
+static void attestor_accept(int epoll_fd, int listen_fd, BufferPool *pool) {
+    int fd;
+    while ((fd = transport_accept(listen_fd)) >= 0) {
+        TransportConnection *connection = malloc(sizeof(*connection));
+        if (connection == NULL) {
+            fprintf(stderr, "Error allocating memory for connection\n");
+            close(fd);
+            continue;
+        }
+        transport_connection_init(connection, fd, pool);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            transport_connection_close(connection);
+            free(connection);
+        }
     }
 }
 
+int attestor_serve(const char *address) {
+    BufferPool *pool = buffer_pool_create();
+    if (pool == NULL) {
+        fprintf(stderr, "Error allocating memory for buffer pool\n");
+        return -1;
+    }
+    int listen_fd = transport_listen(address);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Error listening on %s\n", address);
+        buffer_pool_destroy(pool);
+        return -1;
+    }
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) != 0) {
+        fprintf(stderr, "Error creating epoll instance\n");
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+        close(listen_fd);
+        buffer_pool_destroy(pool);
+        return -1;
+    }
+
+    struct epoll_event events[ATTESTOR_MAX_EVENTS];
+    for (;;) {
+        // While a batch is open, wake up when its window closes
+        int timeout = -1;
+        if (pending_count > 0) {
+            uint64_t now = monotonic_ms();
+            timeout = pending_deadline_ms > now ? (int)(pending_deadline_ms - now) : 0;
+        }
+        int count = epoll_wait(epoll_fd, events, ATTESTOR_MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error waiting for connections\n");
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            TransportConnection *connection = events[i].data.ptr;
+            if (connection == NULL) {
+                attestor_accept(epoll_fd, listen_fd, pool);
+                continue;
+            }
+            int status = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                status = attestor_on_readable(epoll_fd, connection);
+            }
+            if (status == 0) {
+                status = attestor_flush(epoll_fd, connection);
+            }
+            if (status != 0) {
+                attestor_close(epoll_fd, connection);
+            }
+        }
+        if (pending_count > 0 && monotonic_ms() >= pending_deadline_ms) {
+            attestor_answer_batch(epoll_fd);
+        }
+    }
+
+    // Connections still open are reclaimed by the process exit
+    close(epoll_fd);
+    close(listen_fd);
+    return -1;
+}
@@ -0,0 +1,557 @@
+// attestor_fleet.c
+// Simulated attestors, each with its own identity, attestation key and growing event log, answering requests
+// through run_attestation_protocol() so that one machine can put a verifier under the load of a fleet.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "attestor.h"
+#include "attestor_fleet.h"
+#include "soft_ak.h"
+
+#define FLEET_MAX_EVENTS 256
+#define FLEET_ID_SIZE 48
+#define FLEET_ROGUE_CATALOG 256             // Distinct rogue records
+#define FLEET_MAX_APPEND_PER_TICK 64        // Records one device appends per tick at most
+
+// Structures
+
+/**
+ * @struct FleetCatalog
+ * @brief Generated records that runtime logs are assembled from.
+ */
+typedef struct {
+    uint8_t *log;                           /**< Generated log; its header record is not used */
+    size_t log_size;
+    uint32_t *offsets;                      /**< Offset of each record after the header */
+    uint32_t *lengths;                      /**< Length of each record after the header */
+    size_t count;
+    size_t max_length;                      /**< Longest record */
+} FleetCatalog;
+
+/**
+ * @struct FleetFirmware
+ * @brief A firmware build: its boot log and the PCR state it boots into.
+ */
+typedef struct {
+    uint8_t *boot_log;
+    size_t boot_size;
+    PCR_BankSet pcrs;
+    SoftQuoteState quoted;
+} FleetFirmware;
+
+/**
+ * @struct FleetDevice
+ * @brief One simulated attestor.
+ */
+typedef struct {
+    AttestorFleet *fleet;
+    TransportConnection connection;         /**< Device end of the connection */
+    char attestor_id[FLEET_ID_SIZE];
+    AttestorDevice source;                  /**< Callbacks run_attestation_protocol() collects from */
+    SoftAK ak;
+    uint32_t firmware;                      /**< Index of the device's firmware build */
+    AttestorLog log;                        /**< Boot log and runtime records since the last reboot */
+    PCR_BankSet pcrs;                       /**< Replay of log */
+    SoftQuoteState quoted;                  /**< SHA-256 PCRs of pcrs as a quote covers them */
+    uint64_t random;                        /**< PRNG state of the device's growth and reboots */
+} FleetDevice;
+
+struct AttestorFleet {
+    AttestorFleetConfig config;
+    FleetDevice *devices;
+    FleetFirmware *firmware;
+    FleetCatalog catalog;                   /**< Runtime measurements the RIM knows */
+    FleetCatalog rogue;                     /**< Runtime measurements it does not */
+    BufferPool *buffers;
+    uint8_t *append_buffer;                 /**< Scratch space for the records of one tick */
+    size_t append_capacity;
+    int epoll_fd;
+    int stop_fd;
+    pthread_t thread;
+    bool thread_started;
+    atomic_uint_fast64_t requests;
+    atomic_uint_fast64_t records_appended;
+    atomic_uint_fast64_t rogue_records;
+    atomic_uint_fast64_t reboots;
+};
+
+// Random numbers
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double next_uniform(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / 9007199254740992.0;
+}
+
+/**
+ * @brief Draws from a Poisson distribution; large means are rounded instead, which is close enough for load.
+ */
+static uint32_t next_poisson(uint64_t *state, double mean) {
+    if (mean > 30) {
+        return (uint32_t)(mean + 0.5);
+    }
+    double limit = exp(-mean);
+    double product = next_uniform(state);
+    uint32_t count = 0;
+    while (product > limit) {
+        count++;
+        product *= next_uniform(state);
+    }
+    return count;
+}
+
+// Generated logs
+
+static void catalog_free(FleetCatalog *catalog) {
+    free(catalog->log);
+    free(catalog->offsets);
+    free(catalog->lengths);
+    memset(catalog, 0, sizeof(*catalog));
+}
+
+/**
+ * @brief Generates count runtime records with the banks of the boot logs.
+ */
+static int catalog_build(FleetCatalog *catalog, const AttestorFleetConfig *config, size_t count, uint64_t seed) {
+    LogGeneratorConfig generator;
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+
+    memset(catalog, 0, sizeof(*catalog));
+    log_generator_preset(&generator, "runtime", count, seed);
+    generator.bank_count = config->boot_log.bank_count;
+    memcpy(generator.banks, config->boot_log.banks, sizeof(generator.banks));
+    catalog->offsets = malloc(count * sizeof(*catalog->offsets));
+    catalog->lengths = malloc(count * sizeof(*catalog->lengths));
+    if (!catalog->offsets || !catalog->lengths ||
+        log_generator_generate(&generator, &catalog->log, &catalog->log_size) != 0 ||
+        tcg_log_cursor_init(&cursor, catalog->log, catalog->log_size) != TCG_LOG_OK ||
+        tcg_log_cursor_next(&cursor, &event) != TCG_LOG_OK) {
+        fprintf(stderr, "Error generating runtime measurement catalog\n");
+        catalog_free(catalog);
+        return -1;
+    }
+    while (catalog->count < count && tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+        catalog->offsets[catalog->count] = (uint32_t)event.offset;
+        catalog->lengths[catalog->count++] = (uint32_t)event.length;
+        if (event.length > catalog->max_length) {
+            catalog->max_length = event.length;
+        }
+    }
+    return 0;
+}
+
+static int firmware_build(FleetFirmware *firmware, const AttestorFleetConfig *config, uint32_t build) {
+    LogGeneratorConfig generator = config->boot_log;
+    generator.seed = config->boot_log.seed + build;
+    if (log_generator_generate(&generator, &firmware->boot_log, &firmware->boot_size) != 0 ||
+        pcr_replay_log(firmware->boot_log, firmware->boot_size, &firmware->pcrs) != 0) {
+        fprintf(stderr, "Error generating the boot log of firmware build %u\n", build);
+        return -1;
+    }
+    if (!pcr_bankset_find(&firmware->pcrs, TPM2_ALG_SHA256) ||
+        soft_quote_state_init(&firmware->quoted, &firmware->pcrs) != 0) {
+        fprintf(stderr, "Boot logs need a SHA-256 bank\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Devices
+
+/**
+ * @brief Restarts a device's log from its firmware's boot log, as a reboot does.
+ */
+static int device_boot(FleetDevice *device) {
+    const FleetFirmware *firmware = &device->fleet->firmware[device->firmware];
+    attestor_log_close(&device->log);
+    if (attestor_log_open_buffer(&device->log, firmware->boot_log, firmware->boot_size) != 0) {
+        return -1;
+    }
+    device->pcrs = firmware->pcrs;
+    device->quoted = firmware->quoted;
+    return 0;
+}
+
+/**
+ * @brief Appends records drawn from the catalogs to a device's log and extends its PCRs with them.
+ */
+static int device_grow(FleetDevice *device, uint32_t count) {
+    AttestorFleet *fleet = device->fleet;
+    size_t size = 0;
+    uint32_t appended = 0;
+    uint32_t rogue = 0;
+    for (; appended < count; appended++) {
+        bool is_rogue = fleet->config.rogue_fraction > 0 && next_uniform(&device->random) <
+                        fleet->config.rogue_fraction;
+        const FleetCatalog *catalog = is_rogue ? &fleet->rogue : &fleet->catalog;
+        size_t pick = next_random(&device->random) % catalog->count;
+        if (size + catalog->lengths[pick] > fleet->append_capacity) {
+            break;
+        }
+        memcpy(fleet->append_buffer + size, catalog->log + catalog->offsets[pick], catalog->lengths[pick]);
+        size += catalog->lengths[pick];
+        rogue += is_rogue;
+    }
+
+    // Replay only the new records on top of the device's PCR state
+    TCG_EventLogCursor cursor;
+    size_t old_size = device->log.size;
+    uint64_t old_count = device->log.end.event_count;
+    if (attestor_log_append(&device->log, fleet->append_buffer, size) != 0 ||
+        tcg_log_cursor_init(&cursor, device->log.data, device->log.size) != TCG_LOG_OK ||
+        tcg_log_cursor_seek(&cursor, old_size, old_count) != TCG_LOG_OK ||
+        pcr_replay_events(&device->pcrs, &cursor, NULL) != 0 ||
+        soft_quote_state_init(&device->quoted, &device->pcrs) != 0) {
+        fprintf(stderr, "Device %s: error appending runtime records\n", device->attestor_id);
+        return -1;
+    }
+    atomic_fetch_add(&fleet->records_appended, appended);
+    atomic_fetch_add(&fleet->rogue_records, rogue);
+    return 0;
+}
+
+static int device_collect_pcrs(void *arg, PCR_Data **pcr_data_array, size_t *num_pcrs) {
+    FleetDevice *device = arg;
+    const PCR_Bank *bank = pcr_bankset_find(&device->pcrs, TPM2_ALG_SHA256);
+
+    // One allocation holds the array and every digest it points to, as collect_all_pcr_values() does
+    *num_pcrs = 0;
+    *pcr_data_array = bank ? malloc(TPM_PCR_COUNT * (sizeof(PCR_Data) + bank->digest_size)) : NULL;
+    if (*pcr_data_array == NULL) {
+        fprintf(stderr, "Error allocating memory for PCR data array\n");
+        return -1;
+    }
+    uint8_t *digests = (uint8_t *)(*pcr_data_array + TPM_PCR_COUNT);
+    for (size_t i = 0; i < TPM_PCR_COUNT; i++) {
+        (*pcr_data_array)[i].value = digests + i * bank->digest_size;
+        (*pcr_data_array)[i].size = bank->digest_size;
+        (*pcr_data_array)[i].index = (uint32_t)i;
+        memcpy((*pcr_data_array)[i].value, bank->pcrs[i].buffer, bank->digest_size);
+    }
+    *num_pcrs = TPM_PCR_COUNT;
+    return 0;
+}
+
+static int device_collect_quote(void *arg, const uint8_t *nonce, size_t nonce_size, uint8_t **quote,
+                                size_t *quote_size) {
+    FleetDevice *device = arg;
+    *quote = malloc(SOFT_AK_QUOTE_MAX_SIZE);
+    if (*quote == NULL) {
+        fprintf(stderr, "Error allocating memory for quote\n");
+        return -1;
+    }
+    *quote_size = soft_ak_quote(&device->ak, &device->quoted, nonce, nonce_size, *quote, SOFT_AK_QUOTE_MAX_SIZE);
+    if (*quote_size == 0) {
+        fprintf(stderr, "Device %s: error signing quote\n", device->attestor_id);
+        free(*quote);
+        *quote = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int device_collect_log(void *arg, const LogPosition *known, AttestorLogDelta *delta) {
+    FleetDevice *device = arg;
+    attestor_log_delta(&device->log, known, delta);
+    return 0;
+}
+
+// Serving
+
+/**
+ * @brief Writes queued responses, waiting for the socket to become writable only while some remain.
+ *
+ * @return Returns 0 while the device is connected, or -1 if its connection must be closed.
+ */
+static int device_flush(FleetDevice *device) {
+    TransportStatus status = transport_flush(&device->connection);
+    if (status == TRANSPORT_ERROR) {
+        return -1;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = device };
+    if (status == TRANSPORT_AGAIN) {
+        event.events |= EPOLLOUT;
+    }
+    return epoll_ctl(device->fleet->epoll_fd, EPOLL_CTL_MOD, device->connection.fd, &event);
+}
+
+/**
+ * @brief Answers every request that has fully arrived, in order.
+ *
+ * @return Returns 0 while the device is connected, or -1 if its connection must be closed.
+ */
+static int device_on_readable(FleetDevice *device) {
+    uint8_t *request;
+    size_t request_size;
+    TransportStatus status;
+    while ((status = transport_read_frame(&device->connection, &request, &request_size)) == TRANSPORT_OK) {
+        AttestationContext ctx = { .state = STATE_INIT, .connection = &device->connection,
+                                   .device = &device->source };
+        ctx.request_buffer = request;
+        ctx.request_size = request_size;
+        run_attestation_protocol(&ctx);
+        transport_frame_put(device->fleet->buffers, request);
+        atomic_fetch_add(&device->fleet->requests, 1);
+    }
+    return status == TRANSPORT_AGAIN ? 0 : -1;
+}
+
+static void device_close(FleetDevice *device) {
+    if (device->connection.fd >= 0) {
+        epoll_ctl(device->fleet->epoll_fd, EPOLL_CTL_DEL, device->connection.fd, NULL);
+    }
+    transport_connection_close(&device->connection);
+}
+
+/**
+ * @brief Applies one tick of log growth and reboots to every device.
+ */
+static void fleet_tick(AttestorFleet *fleet) {
+    double tick_s = ATTESTOR_FLEET_TICK_MS / 1000.0;
+    double growth = fleet->config.growth_rate * tick_s;
+    double reboot_probability = fleet->config.reboot_rate / 3600.0 * tick_s;
+
+    for (size_t i = 0; i < fleet->config.device_count; i++) {
+        FleetDevice *device = &fleet->devices[i];
+        if (reboot_probability > 0 && next_uniform(&device->random) < reboot_probability) {
+            if (device_boot(device) == 0) {
+                atomic_fetch_add(&fleet->reboots, 1);
+            }
+            continue;
+        }
+        uint32_t count = growth > 0 ? next_poisson(&device->random, growth) : 0;
+        if (count > 0) {
+            device_grow(device, count < FLEET_MAX_APPEND_PER_TICK ? count : FLEET_MAX_APPEND_PER_TICK);
+        }
+    }
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+static void *fleet_main(void *arg) {
+    AttestorFleet *fleet = arg;
+    struct epoll_event events[FLEET_MAX_EVENTS];
+    uint64_t next_tick = monotonic_ms() + ATTESTOR_FLEET_TICK_MS;
+
+    for (;;) {
+        uint64_t now = monotonic_ms();
+        if (now >= next_tick) {
+            fleet_tick(fleet);
+            next_tick += ATTESTOR_FLEET_TICK_MS;
+            if (next_tick <= now) {
+                next_tick = now + ATTESTOR_FLEET_TICK_MS;  // Ticks that took too long are not made up
+            }
+        }
+        int count = epoll_wait(fleet->epoll_fd, events, FLEET_MAX_EVENTS, (int)(next_tick - now));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            FleetDevice *device = events[i].data.ptr;
+            if (!device) {
+                return NULL;
+            }
+            if (device->connection.fd < 0) {
+                continue;
+            }
+            int status = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                status = device_on_readable(device);
+            }
+            if (status == 0) {
+                status = device_flush(device);
+            }
+            if (status != 0) {
+                device_close(device);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Function Implementations
+
+void attestor_fleet_config_init(AttestorFleetConfig *config, size_t device_count, uint64_t seed) {
+    memset(config, 0, sizeof(*config));
+    config->device_count = device_count;
+    log_generator_preset(&config->boot_log, "boot", 100, seed);
+    config->firmware_builds = 16;
+    config->catalog_size = 4096;
+    config->growth_rate = 1.0 / 60;
+    config->reboot_rate = 1.0 / 24;
+}
+
+AttestorFleet *attestor_fleet_create(const AttestorFleetConfig *config, int *verifier_fds) {
+    if (!config || config->device_count == 0 || config->firmware_builds == 0 || config->catalog_size == 0 ||
+        !verifier_fds) {
+        return NULL;
+    }
+    AttestorFleet *fleet = calloc(1, sizeof(*fleet));
+    if (!fleet) {
+        fprintf(stderr, "Error allocating memory for attestor fleet\n");
+        return NULL;
+    }
+    fleet->config = *config;
+    fleet->epoll_fd = -1;
+    fleet->stop_fd = -1;
+    fleet->devices = calloc(config->device_count, sizeof(*fleet->devices));
+    fleet->firmware = calloc(config->firmware_builds, sizeof(*fleet->firmware));
+    fleet->buffers = buffer_pool_create();
+    for (size_t i = 0; fleet->devices && i < config->device_count; i++) {
+        fleet->devices[i].fleet = fleet;
+        transport_connection_init(&fleet->devices[i].connection, -1, fleet->buffers);
+    }
+    if (!fleet->devices || !fleet->firmware || !fleet->buffers) {
+        fprintf(stderr, "Error allocating memory for attestor fleet\n");
+        attestor_fleet_destroy(fleet);
+        return NULL;
+    }
+
+    // Generated data shared by the devices
+    for (uint32_t i = 0; i < config->firmware_builds; i++) {
+        if (firmware_build(&fleet->firmware[i], config, i) != 0) {
+            attestor_fleet_destroy(fleet);
+            return NULL;
+        }
+    }
+    uint64_t seed = config->boot_log.seed;
+    if (catalog_build(&fleet->catalog, config, config->catalog_size, seed ^ 0xC47A106ULL) != 0 ||
+        catalog_build(&fleet->rogue, config, FLEET_ROGUE_CATALOG, seed ^ 0x2067E5ULL) != 0) {
+        attestor_fleet_destroy(fleet);
+        return NULL;
+    }
+    fleet->append_capacity = FLEET_MAX_APPEND_PER_TICK * (fleet->catalog.max_length > fleet->rogue.max_length ?
+                                                          fleet->catalog.max_length : fleet->rogue.max_length);
+    fleet->append_buffer = malloc(fleet->append_capacity);
+
+    fleet->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    fleet->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct epoll_event stop_event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (!fleet->append_buffer || fleet->epoll_fd < 0 || fleet->stop_fd < 0 ||
+        epoll_ctl(fleet->epoll_fd, EPOLL_CTL_ADD, fleet->stop_fd, &stop_event) != 0) {
+        fprintf(stderr, "Error creating attestor fleet\n");
+        attestor_fleet_destroy(fleet);
+        return NULL;
+    }
+
+    const char *prefix = config->id_prefix ? config->id_prefix : ATTESTOR_FLEET_ID_PREFIX;
+    for (size_t i = 0; i < config->device_count; i++) {
+        FleetDevice *device = &fleet->devices[i];
+        snprintf(device->attestor_id, sizeof(device->attestor_id), "%s-%06zu", prefix, i);
+        device->source.attestor_id = device->attestor_id;
+        device->source.collect_pcrs = device_collect_pcrs;
+        device->source.collect_quote = device_collect_quote;
+        device->source.collect_log = device_collect_log;
+        device->source.device = device;
+        device->firmware = (uint32_t)(i % config->firmware_builds);
+        device->random = seed + i * 0x9E3779B97F4A7C15ULL;
+
+        int fds[2];
+        if (soft_ak_create(&device->ak) != 0 || device_boot(device) != 0 ||
+            socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+            fprintf(stderr, "Error creating simulated attestor %s\n", device->attestor_id);
+            for (size_t j = 0; j < i; j++) {
+                close(verifier_fds[j]);
+            }
+            attestor_fleet_destroy(fleet);
+            return NULL;
+        }
+        transport_connection_init(&device->connection, fds[0], fleet->buffers);
+        verifier_fds[i] = fds[1];
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = device };
+        epoll_ctl(fleet->epoll_fd, EPOLL_CTL_ADD, fds[0], &event);
+    }
+    return fleet;
+}
+
+int attestor_fleet_fill_rim(const AttestorFleet *fleet, RIM_Index *rim_index) {
+    for (uint32_t i = 0; i < fleet->config.firmware_builds; i++) {
+        if (log_generator_fill_rim(fleet->firmware[i].boot_log, fleet->firmware[i].boot_size, rim_index) != 0) {
+            return -1;
+        }
+    }
+    return log_generator_fill_rim(fleet->catalog.log, fleet->catalog.log_size, rim_index);
+}
+
+int attestor_fleet_ak_public(const AttestorFleet *fleet, size_t index, const uint8_t **public_blob,
+                             size_t *public_size) {
+    if (!fleet || index >= fleet->config.device_count) {
+        return -1;
+    }
+    *public_blob = fleet->devices[index].ak.public_blob;
+    *public_size = fleet->devices[index].ak.public_size;
+    return 0;
+}
+
+int attestor_fleet_start(AttestorFleet *fleet) {
+    if (pthread_create(&fleet->thread, NULL, fleet_main, fleet) != 0) {
+        fprintf(stderr, "Error starting attestor fleet thread\n");
+        return -1;
+    }
+    fleet->thread_started = true;
+    return 0;
+}
+
+void attestor_fleet_get_stats(const AttestorFleet *fleet, AttestorFleetStats *stats) {
+    stats->requests = atomic_load(&fleet->requests);
+    stats->records_appended = atomic_load(&fleet->records_appended);
+    stats->rogue_records = atomic_load(&fleet->rogue_records);
+    stats->reboots = atomic_load(&fleet->reboots);
+}
+
+void attestor_fleet_destroy(AttestorFleet *fleet) {
+    if (!fleet) {
+        return;
+    }
+    if (fleet->thread_started) {
+        uint64_t one = 1;
+        (void)!write(fleet->stop_fd, &one, sizeof(one));
+        pthread_join(fleet->thread, NULL);
+    }
+    for (size_t i = 0; fleet->devices && i < fleet->config.device_count; i++) {
+        device_close(&fleet->devices[i]);
+        attestor_log_close(&fleet->devices[i].log);
+        soft_ak_free(&fleet->devices[i].ak);
+    }
+    for (uint32_t i = 0; fleet->firmware && i < fleet->config.firmware_builds; i++) {
+        free(fleet->firmware[i].boot_log);
+    }
+    catalog_free(&fleet->catalog);
+    catalog_free(&fleet->rogue);
+    if (fleet->epoll_fd >= 0) {
+        close(fleet->epoll_fd);
+    }
+    if (fleet->stop_fd >= 0) {
+        close(fleet->stop_fd);
+    }
+    buffer_pool_destroy(fleet->buffers);
+    free(fleet->append_buffer);
+    free(fleet->devices);
+    free(fleet->firmware);
+    free(fleet);
+}
@@ -0,0 +1,363 @@
+// attestor_log.c
+// Keeps the attestor's measurement log in memory so each attestation round reads only what the runtime log gained,
+// and sends verifiers that are already up to date only the records they have not seen. The log is the TCG boot and
+// runtime logs as read, or one CEL-TLV stream encoded from the boot log and the IMA log.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "event_log_parser.h"
+#include "ima_log_parser.h"
+#include "attestor_log.h"
+
+#define ATTESTOR_LOG_READ_SIZE 65536  /**< Bytes the log buffer grows by while a file is read */
+
+/**
+ * @brief Grows the log buffer until it has room for at least extra bytes after its complete records.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+static int reserve(AttestorLog *log, size_t extra) {
+    if (log->capacity - log->size >= extra) {
+        return 0;
+    }
+    size_t capacity = log->capacity ? log->capacity : ATTESTOR_LOG_READ_SIZE;
+    while (capacity - log->size < extra) {
+        capacity *= 2;
+    }
+    uint8_t *data = realloc(log->data, capacity);
+    if (!data) {
+        fprintf(stderr, "Error allocating memory for measurement log\n");
+        return -1;
+    }
+    log->data = data;
+    log->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Reads a file from an offset to its end into the log buffer, after its complete records.
+ *
+ * securityfs files report no size, so the file is read until EOF rather than sized up front.
+ *
+ * @return Returns the number of bytes read, or -1 on failure.
+ */
+static ssize_t read_appended(AttestorLog *log, const char *path, off_t offset) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    size_t total = 0;
+    for (;;) {
+        if (reserve(log, total + ATTESTOR_LOG_READ_SIZE) != 0) {
+            close(fd);
+            return -1;
+        }
+        ssize_t count = pread(fd, log->data + log->size + total, log->capacity - log->size - total,
+                              offset + (off_t)total);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            fprintf(stderr, "Error reading %s: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        if (count == 0) {
+            break;
+        }
+        total += (size_t)count;
+    }
+    close(fd);
+    return (ssize_t)total;
+}
+
+/**
+ * @brief Records the current end of the log as a position verifiers may resume from.
+ */
+static void push_mark(AttestorLog *log) {
+    log->marks[log->mark_next] = log->end;
+    log->mark_next = (log->mark_next + 1) % ATTESTOR_LOG_MARKS;
+    if (log->mark_count < ATTESTOR_LOG_MARKS) {
+        log->mark_count++;
+    }
+}
+
+/**
+ * @brief Takes the complete records among the bytes read after the end of the log into the log.
+ *
+ * @param[in,out] log        Log whose buffer holds the new bytes after log->size.
+ * @param[in]     available  Bytes read after log->size.
+ * @param[out]    taken      Bytes of complete records appended.
+ *
+ * @return Returns 0 on success, or -1 if the new bytes are not valid records.
+ */
+static int take_records(AttestorLog *log, size_t available, size_t *taken) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    size_t end = log->size;
+
+    // A record still being written ends the walk; it is taken by a later refresh
+    if (tcg_log_cursor_init(&cursor, log->data, log->size + available) != TCG_LOG_OK ||
+        tcg_log_cursor_seek(&cursor, log->size, log->end.event_count) != TCG_LOG_OK) {
+        fprintf(stderr, "Measurement log header is malformed\n");
+        return -1;
+    }
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        end = cursor.offset;
+    }
+    if (status != TCG_LOG_END && status != TCG_LOG_ERR_TRUNCATED) {
+        fprintf(stderr, "Event %zu at offset %zu: %s\n", cursor.record_num + 1, cursor.offset,
+                tcg_log_status_str(status));
+        return -1;
+    }
+
+    // Fold exactly the complete records into the rolling digest
+    if (tcg_log_cursor_init(&cursor, log->data, end) != TCG_LOG_OK ||
+        tcg_log_cursor_seek(&cursor, log->size, log->end.event_count) != TCG_LOG_OK ||
+        pcr_log_digest_update(log->end.digest, &cursor) != 0) {
+        return -1;
+    }
+    *taken = end - log->size;
+    log->size = end;
+    log->end.size = end;
+    log->end.event_count = cursor.record_num;
+    return 0;
+}
+
+/**
+ * @brief Takes a whole boot log, already in the log buffer, as the start of the log.
+ *
+ * @return Returns 0 on success, or -1 if the boot log is empty or has a partial or malformed record.
+ */
+static int take_boot_log(AttestorLog *log, size_t boot_size) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView header;
+    size_t taken;
+    if (boot_size == 0 || take_records(log, boot_size, &taken) != 0 || taken != boot_size ||
+        tcg_log_cursor_init(&cursor, log->data, log->size) != TCG_LOG_OK ||
+        tcg_log_cursor_next(&cursor, &header) != TCG_LOG_OK) {
+        return -1;
+    }
+    log->header_size = header.length;
+    push_mark(log);
+    return 0;
+}
+
+int attestor_log_open(AttestorLog *log, const char *boot_path, const char *runtime_path) {
+    memset(log, 0, sizeof(*log));
+
+    ssize_t boot_size = read_appended(log, boot_path, 0);
+    if (boot_size < 0 || take_boot_log(log, (size_t)boot_size) != 0) {
+        fprintf(stderr, "Boot event log %s is empty or malformed\n", boot_path);
+        attestor_log_close(log);
+        return -1;
+    }
+
+    if (runtime_path) {
+        log->runtime_path = strdup(runtime_path);
+        if (!log->runtime_path) {
+            fprintf(stderr, "Error allocating memory for runtime log path\n");
+            attestor_log_close(log);
+            return -1;
+        }
+        if (attestor_log_refresh(log) != 0) {
+            attestor_log_close(log);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Replaces the bytes read after the end of the log with the records the encoder holds, and takes them.
+ *
+ * @return Returns 0 on success, or -1 if the encoded records are not valid.
+ */
+static int take_encoded(AttestorLog *log, size_t *taken) {
+    CEL_Encoder *encoder = &log->encoder;
+    *taken = 0;
+    if (encoder->size == 0) {
+        return 0;
+    }
+    int rc = reserve(log, encoder->size);
+    if (rc == 0) {
+        memcpy(log->data + log->size, encoder->data, encoder->size);
+        rc = take_records(log, encoder->size, taken) == 0 && *taken == encoder->size ? 0 : -1;
+    }
+    encoder->size = 0;
+    return rc;
+}
+
+/**
+ * @brief Encodes the whole IMA entries among the bytes read after the end of the log, and takes them.
+ *
+ * @param[out] consumed  Bytes of the IMA log encoded; an entry still being written is left for the next refresh.
+ *
+ * @return Returns 0 on success, or -1 if the IMA log is malformed.
+ */
+static int take_ima_entries(AttestorLog *log, size_t available, size_t *consumed) {
+    IMA_LogReader reader;
+    IMA_EventView entry;
+    IMA_LogStatus status;
+    size_t taken;
+
+    // Entries are numbered on from the records already in the stream, whatever happened to a failed refresh
+    log->encoder.next_recnum = log->end.event_count;
+    log->encoder.size = 0;
+    if (ima_log_reader_init_buffer(&reader, log->data + log->size, available, log->ima_bank) != IMA_LOG_OK) {
+        return -1;
+    }
+    while ((status = ima_log_reader_next(&reader, &entry)) == IMA_LOG_OK) {
+        if (cel_encode_ima_event(&log->encoder, &entry, log->ima_bank) != 0) {
+            return -1;
+        }
+    }
+    if (status != IMA_LOG_END && status != IMA_LOG_ERR_TRUNCATED) {
+        fprintf(stderr, "IMA entry %zu at offset %llu: %s\n", reader.record_num + 1,
+                (unsigned long long)reader.offset, ima_log_status_str(status));
+        return -1;
+    }
+    *consumed = (size_t)reader.offset;
+    return take_encoded(log, &taken);
+}
+
+int attestor_log_open_cel(AttestorLog *log, const char *boot_path, const char *ima_path, TPM2_ALG_ID ima_bank) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    memset(log, 0, sizeof(*log));
+    log->cel = true;
+    log->ima_bank = ima_bank;
+
+    // The boot log is read after the (empty) log and re-encoded record by record
+    ssize_t boot_size = read_appended(log, boot_path, 0);
+    if (boot_size <= 0 || tcg_log_cursor_init(&cursor, log->data, (size_t)boot_size) != TCG_LOG_OK ||
+        cursor.cel || cel_encoder_init(&log->encoder, &cursor) != 0) {
+        fprintf(stderr, "Boot event log %s is empty or malformed\n", boot_path);
+        attestor_log_close(log);
+        return -1;
+    }
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        if (cel_encode_tcg_event(&log->encoder, &event) != 0) {
+            break;
+        }
+    }
+    size_t cel_size = log->encoder.size;
+    if (status != TCG_LOG_END || reserve(log, cel_size) != 0) {
+        fprintf(stderr, "Boot event log %s is empty or malformed\n", boot_path);
+        attestor_log_close(log);
+        return -1;
+    }
+    memcpy(log->data, log->encoder.data, cel_size);
+    log->encoder.size = 0;
+    if (take_boot_log(log, cel_size) != 0) {
+        fprintf(stderr, "Boot event log %s could not be encoded\n", boot_path);
+        attestor_log_close(log);
+        return -1;
+    }
+
+    if (ima_path) {
+        log->runtime_path = strdup(ima_path);
+        if (!log->runtime_path) {
+            fprintf(stderr, "Error allocating memory for runtime log path\n");
+            attestor_log_close(log);
+            return -1;
+        }
+        if (attestor_log_refresh(log) != 0) {
+            attestor_log_close(log);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int attestor_log_open_buffer(AttestorLog *log, const uint8_t *boot_log, size_t boot_size) {
+    memset(log, 0, sizeof(*log));
+    if (reserve(log, boot_size) != 0) {
+        return -1;
+    }
+    memcpy(log->data, boot_log, boot_size);
+    if (take_boot_log(log, boot_size) != 0) {
+        fprintf(stderr, "Boot event log is empty or malformed\n");
+        attestor_log_close(log);
+        return -1;
+    }
+    return 0;
+}
+
+void attestor_log_close(AttestorLog *log) {
+    free(log->data);
+    free(log->runtime_path);
+    cel_encoder_free(&log->encoder);
+    memset(log, 0, sizeof(*log));
+}
+
+int attestor_log_refresh(AttestorLog *log) {
+    if (!log->runtime_path) {
+        return 0;
+    }
+
+    ssize_t available = read_appended(log, log->runtime_path, log->runtime_offset);
+    size_t taken;
+    if (available < 0) {
+        return -1;
+    }
+    if (log->cel) {
+        if (take_ima_entries(log, (size_t)available, &taken) != 0) {
+            return -1;
+        }
+    } else if (take_records(log, (size_t)available, &taken) != 0) {
+        return -1;
+    }
+    if (taken > 0) {
+        log->runtime_offset += (off_t)taken;
+        push_mark(log);
+    }
+    return 0;
+}
+
+int attestor_log_append(AttestorLog *log, const uint8_t *records, size_t size) {
+    size_t taken;
+    if (size == 0) {
+        return 0;
+    }
+    if (reserve(log, size) != 0) {
+        return -1;
+    }
+    memcpy(log->data + log->size, records, size);
+    if (take_records(log, size, &taken) != 0 || taken != size) {
+        fprintf(stderr, "Appended measurement log records are partial or malformed\n");
+        return -1;
+    }
+    push_mark(log);
+    return 0;
+}
+
+void attestor_log_delta(const AttestorLog *log, const LogPosition *known, AttestorLogDelta *delta) {
+    delta->records = log->data;
+    delta->size = log->size;
+    delta->base = NULL;
+    delta->header = log->data;
+    delta->header_size = log->header_size;
+    if (!known || known->event_count == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < log->mark_count; i++) {
+        const LogPosition *mark = &log->marks[i];
+        if (mark->event_count == known->event_count && mark->size == known->size &&
+            memcmp(mark->digest, known->digest, PCR_LOG_DIGEST_SIZE) == 0) {
+            delta->records = log->data + mark->size;
+            delta->size = log->size - mark->size;
+            delta->base = mark;
+            return;
+        }
+    }
+}
@@ -0,0 +1,282 @@
+// tpm_collect.c
+// Reads PCR values and quotes from a TPM through the TCTI loader, using as few TPM commands as the selection allows:
+// every round trip to the TPM adds directly to the time an attestation takes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <tss2/tss2_tctildr.h>
+#include <tss2/tss2_mu.h>
+#include "tpm_collect.h"
+
+/**
+ * @brief Returns the digest size of a PCR bank algorithm, or 0 if it is not supported.
+ */
+static uint16_t bank_digest_size(TPM2_ALG_ID alg) {
+    switch (alg) {
+        case TPM2_ALG_SHA1:
+            return TPM2_SHA1_DIGEST_SIZE;
+        case TPM2_ALG_SHA256:
+            return TPM2_SHA256_DIGEST_SIZE;
+        case TPM2_ALG_SHA384:
+            return TPM2_SHA384_DIGEST_SIZE;
+        case TPM2_ALG_SHA512:
+            return TPM2_SHA512_DIGEST_SIZE;
+        case TPM2_ALG_SM3_256:
+            return TPM2_SM3_256_DIGEST_SIZE;
+        default:
+            return 0;
+    }
+}
+
+static bool selection_is_empty(const TPML_PCR_SELECTION *selection) {
+    for (uint32_t i = 0; i < selection->count; i++) {
+        for (uint8_t j = 0; j < selection->pcrSelections[i].sizeofSelect; j++) {
+            if (selection->pcrSelections[i].pcrSelect[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static TPMS_PCR_SELECTION *selection_find(TPML_PCR_SELECTION *selection, TPM2_ALG_ID alg) {
+    for (uint32_t i = 0; i < selection->count; i++) {
+        if (selection->pcrSelections[i].hash == alg) {
+            return &selection->pcrSelections[i];
+        }
+    }
+    return NULL;
+}
+
+static TPM_PcrBank *snapshot_find(TPM_PcrSnapshot *snapshot, TPM2_ALG_ID alg) {
+    for (uint32_t i = 0; i < snapshot->bank_count; i++) {
+        if (snapshot->banks[i].alg == alg) {
+            return &snapshot->banks[i];
+        }
+    }
+    return NULL;
+}
+
+const TPM_PcrBank *tpm_snapshot_bank(const TPM_PcrSnapshot *snapshot, TPM2_ALG_ID alg) {
+    return snapshot_find((TPM_PcrSnapshot *)snapshot, alg);
+}
+
+// Collector
+
+/**
+ * @brief Selects every allocated PCR, up to TPM_PCR_COUNT, of every active bank with a supported algorithm.
+ */
+static int collector_discover_banks(TPM_Collector *collector) {
+    TPMI_YES_NO more_data;
+    TPMS_CAPABILITY_DATA capability;
+    TSS2_RC rc = Tss2_Sys_GetCapability(collector->sys, NULL, TPM2_CAP_PCRS, 0, 1, &more_data, &capability, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Error reading PCR banks: 0x%x\n", rc);
+        return -1;
+    }
+
+    const TPML_PCR_SELECTION *assigned = &capability.data.assignedPCR;
+    memset(&collector->selection, 0, sizeof(collector->selection));
+    collector->snapshot_size = 0;
+    for (uint32_t i = 0; i < assigned->count && i < TPM2_NUM_PCR_BANKS; i++) {
+        const TPMS_PCR_SELECTION *bank = &assigned->pcrSelections[i];
+        uint16_t digest_size = bank_digest_size(bank->hash);
+        if (digest_size == 0) {
+            continue;
+        }
+
+        TPMS_PCR_SELECTION selected = { .hash = bank->hash, .sizeofSelect = (TPM_PCR_COUNT + 7) / 8 };
+        for (uint8_t j = 0; j < selected.sizeofSelect && j < bank->sizeofSelect; j++) {
+            selected.pcrSelect[j] = bank->pcrSelect[j];
+        }
+        TPML_PCR_SELECTION single = { .count = 1, .pcrSelections = { selected } };
+        if (selection_is_empty(&single)) {
+            continue;  // Bank present but not active
+        }
+        collector->selection.pcrSelections[collector->selection.count++] = selected;
+        collector->snapshot_size += (size_t)TPM_PCR_COUNT * digest_size;
+    }
+    if (collector->selection.count == 0) {
+        fprintf(stderr, "TPM has no active PCR bank\n");
+        return -1;
+    }
+    return 0;
+}
+
+int tpm_collector_open(TPM_Collector *collector, const char *tcti_conf, TPMI_DH_OBJECT ak_handle) {
+    TSS2_ABI_VERSION abi_version = TSS2_ABI_VERSION_CURRENT;
+
+    memset(collector, 0, sizeof(*collector));
+    collector->ak_handle = ak_handle;
+
+    TSS2_RC rc = Tss2_TctiLdr_Initialize(tcti_conf, &collector->tcti);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Error initializing TCTI: 0x%x\n", rc);
+        collector->tcti = NULL;
+        return -1;
+    }
+
+    size_t context_size = Tss2_Sys_GetContextSize(0);
+    collector->sys = calloc(1, context_size);
+    if (!collector->sys) {
+        fprintf(stderr, "Error allocating memory for TPM SYS context\n");
+        tpm_collector_close(collector);
+        return -1;
+    }
+    rc = Tss2_Sys_Initialize(collector->sys, context_size, collector->tcti, &abi_version);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Error initializing TPM SYS context: 0x%x\n", rc);
+        free(collector->sys);
+        collector->sys = NULL;
+        tpm_collector_close(collector);
+        return -1;
+    }
+
+    if (collector_discover_banks(collector) != 0) {
+        tpm_collector_close(collector);
+        return -1;
+    }
+    return 0;
+}
+
+void tpm_collector_close(TPM_Collector *collector) {
+    if (collector->sys) {
+        Tss2_Sys_Finalize(collector->sys);
+        free(collector->sys);
+        collector->sys = NULL;
+    }
+    if (collector->tcti) {
+        Tss2_TctiLdr_Finalize(&collector->tcti);
+        collector->tcti = NULL;
+    }
+}
+
+// PCR reads
+
+/**
+ * @brief Stores the digests of one TPM2_PCR_Read response and removes their PCRs from the remaining selection.
+ *
+ * Digests come in the order of the returned selection: bank by bank, lowest PCR first.
+ *
+ * @return Returns 0 on success, or -1 if the response does not match the request.
+ */
+static int store_read(TPM_PcrSnapshot *snapshot, TPML_PCR_SELECTION *remaining, const TPML_PCR_SELECTION *read,
+                      const TPML_DIGEST *values) {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < read->count; i++) {
+        const TPMS_PCR_SELECTION *selection = &read->pcrSelections[i];
+        TPM_PcrBank *bank = snapshot_find(snapshot, selection->hash);
+        TPMS_PCR_SELECTION *pending = selection_find(remaining, selection->hash);
+        for (uint32_t pcr = 0; pcr < (uint32_t)selection->sizeofSelect * 8; pcr++) {
+            if (!(selection->pcrSelect[pcr / 8] & (1u << (pcr % 8)))) {
+                continue;
+            }
+            if (!bank || !pending || pcr >= TPM_PCR_COUNT || used >= values->count ||
+                values->digests[used].size != bank->digest_size) {
+                fprintf(stderr, "TPM2_PCR_Read returned values that were not requested\n");
+                return -1;
+            }
+            memcpy(bank->digests + (size_t)pcr * bank->digest_size, values->digests[used].buffer, bank->digest_size);
+            bank->pcr_mask |= 1u << pcr;
+            pending->pcrSelect[pcr / 8] &= (uint8_t)~(1u << (pcr % 8));
+            used++;
+        }
+    }
+    if (used == 0 || used != values->count) {
+        fprintf(stderr, "TPM2_PCR_Read returned %u values for %u PCRs\n", values->count, used);
+        return -1;
+    }
+    return 0;
+}
+
+int tpm_read_pcrs(TPM_Collector *collector, uint8_t *buffer, size_t buffer_size, TPM_PcrSnapshot *snapshot) {
+    if (!collector->sys || buffer_size < collector->snapshot_size) {
+        return -1;
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    size_t offset = 0;
+    for (uint32_t i = 0; i < collector->selection.count; i++) {
+        TPM_PcrBank *bank = &snapshot->banks[snapshot->bank_count++];
+        bank->alg = collector->selection.pcrSelections[i].hash;
+        bank->digest_size = bank_digest_size(bank->alg);
+        bank->digests = buffer + offset;
+        offset += (size_t)TPM_PCR_COUNT * bank->digest_size;
+    }
+
+    for (int attempt = 0; attempt < TPM_PCR_READ_RETRIES; attempt++) {
+        TPML_PCR_SELECTION remaining = collector->selection;
+        bool consistent = true;
+        memset(buffer, 0, collector->snapshot_size);
+        for (uint32_t i = 0; i < snapshot->bank_count; i++) {
+            snapshot->banks[i].pcr_mask = 0;
+        }
+
+        // Ask for everything still missing; the TPM answers with as many digests as fit in one response
+        for (bool first = true; !selection_is_empty(&remaining); first = false) {
+            uint32_t update_counter;
+            TPML_PCR_SELECTION read;
+            TPML_DIGEST values;
+            TSS2_RC rc = Tss2_Sys_PCR_Read(collector->sys, NULL, &remaining, &update_counter, &read, &values, NULL);
+            snapshot->read_commands++;
+            if (rc != TSS2_RC_SUCCESS) {
+                fprintf(stderr, "Error reading PCRs: 0x%x\n", rc);
+                return -1;
+            }
+            if (first) {
+                snapshot->update_counter = update_counter;
+            } else if (update_counter != snapshot->update_counter) {
+                consistent = false;
+                break;
+            }
+            if (store_read(snapshot, &remaining, &read, &values) != 0) {
+                return -1;
+            }
+        }
+        if (consistent) {
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "PCRs kept changing while being read\n");
+    return -1;
+}
+
+// Quotes
+
+int tpm_quote(TPM_Collector *collector, const uint8_t *nonce, size_t nonce_size, uint8_t *quote,
+              size_t quote_capacity, size_t *quote_size) {
+    TSS2L_SYS_AUTH_COMMAND auths = { .count = 1, .auths = { { .sessionHandle = TPM2_RS_PW } } };
+    TPMT_SIG_SCHEME scheme = { .scheme = TPM2_ALG_NULL };  // Use the attestation key's own scheme
+    TPM2B_DATA qualifying_data = { .size = 0 };
+    TPM2B_ATTEST quoted = { .size = 0 };
+    TPMT_SIGNATURE signature;
+
+    if (!collector->sys) {
+        return -1;
+    }
+    if (nonce_size > sizeof(qualifying_data.buffer)) {
+        fprintf(stderr, "Nonce of %zu bytes is too large for a quote\n", nonce_size);
+        return -1;
+    }
+    qualifying_data.size = (UINT16)nonce_size;
+    memcpy(qualifying_data.buffer, nonce, nonce_size);
+
+    TSS2_RC rc = Tss2_Sys_Quote(collector->sys, collector->ak_handle, &auths, &qualifying_data, &scheme,
+                                &collector->selection, &quoted, &signature, NULL);
+    if (rc != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Error getting PCR quote: 0x%x\n", rc);
+        return -1;
+    }
+
+    size_t offset = 0;
+    if (Tss2_MU_TPM2B_ATTEST_Marshal(&quoted, quote, quote_capacity, &offset) != TSS2_RC_SUCCESS ||
+        Tss2_MU_TPMT_SIGNATURE_Marshal(&signature, quote, quote_capacity, &offset) != TSS2_RC_SUCCESS) {
+        fprintf(stderr, "Error marshaling quote\n");
+        return -1;
+    }
+    *quote_size = offset;
+    return 0;
+}
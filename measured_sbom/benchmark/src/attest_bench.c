@@ -0,0 +1,1041 @@
+// attest_bench.c
+// Benchmarks the verification pipeline stage by stage on generated event logs: parsing, RIM checks, PCR replay,
+// parallel replay and RIM checks, RIM lookups, protobuf encoding, dictionary compression of the log in transit and IMA
+// runtime log verification. Results can be saved as a baseline and later runs compared against it, so a slowdown
+// shows up as a number. Before timing anything, IMA logs damaged in known ways are checked to still be rejected.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "attestation.pb-c.h"  // Protobuf definitions for attestation
+#include "attestation_decode.h"
+#include "event_log_verifier.h"
+#include "ima_log_verifier.h"
+#include "log_dictionary.h"
+#include "log_generator.h"
+#include "log_pipeline.h"
+#include "pcr.h"
+
+#define BENCH_DEFAULT_SIZES "100,10000,1000000"
+#define BENCH_DEFAULT_SEED 1
+#define BENCH_TARGET_EVENTS 2000000     // Events each stage processes per size when -i is not given
+#define BENCH_MIN_ITERATIONS 5
+#define BENCH_MAX_ITERATIONS 1000
+#define BENCH_MAX_SIZES 16
+#define BENCH_MAX_RESULTS 256
+#define BENCH_DEFAULT_TOLERANCE 10      // Percent a result may be worse than its baseline
+#define BENCH_BASELINE_HEADER "# attest_bench baseline v1"
+#define BENCH_DICTIONARY_LOGS 16        // Logs the in-process dictionary is trained on, as fleet_sim's firmware builds
+#define BENCH_DICTIONARY_EVENTS 1000    // Largest of those logs; the dictionary only holds what logs repeat
+#define BENCH_IMA_CHECK_ENTRIES 2000    // Measurements in the IMA log of the failure checks, past one reader chunk
+
+// Allocation counting
+
+// glibc lets a program replace malloc and reach the real one through __libc_malloc; sanitizers replace it too
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(BENCH_NO_ALLOCATION_COUNT)
+#define BENCH_COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void __libc_free(void *pointer);
+
+static uint64_t allocation_count = 0;
+static uint64_t allocation_bytes = 0;
+
+void *malloc(size_t size) {
+    allocation_count++;
+    allocation_bytes += size;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocation_count++;
+    allocation_bytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    allocation_count++;
+    allocation_bytes += size;
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) {
+    __libc_free(pointer);
+}
+#else
+static uint64_t allocation_count = 0;
+static uint64_t allocation_bytes = 0;
+#endif
+
+// Structures
+
+/**
+ * @struct BenchInput
+ * @brief One generated log and everything the stages run on, prepared before any timing starts.
+ */
+typedef struct {
+    const char *mix_name;           /**< Event mix, as given on the command line */
+    const char *bank_names;         /**< Digest banks, as given on the command line */
+    uint8_t *log;                   /**< Generated event log */
+    size_t log_size;                /**< Size of the log */
+    size_t event_count;             /**< Records in the log, the header included */
+    char log_path[64];              /**< The log written to a file, for parse_event_log_from_file() */
+    RIM_Index rim;                  /**< Index every extended event of the log verifies against */
+    const char **names;             /**< Payload name of every extended event, for the lookup stage */
+    size_t *name_lengths;           /**< Length of each name */
+    size_t name_count;              /**< Extended events */
+    PCR_BankSet pcrs;               /**< Replayed PCRs, reported in the packed response */
+    PCR pcr_values[TPM_PCR_COUNT];
+    PCR *pcr_list[TPM_PCR_COUNT];
+    uint8_t *packed;                /**< AttestationResponse carrying the log */
+    size_t packed_size;             /**< Size of the packed response */
+    Arena arena;                    /**< Arena of the zero-copy decode stage */
+    uint8_t *ima_log;               /**< Generated IMA log with as many measurements as the event log has events */
+    size_t ima_log_size;            /**< Size of the IMA log */
+    size_t ima_entry_count;         /**< Entries in the IMA log, boot_aggregate included */
+    char ima_log_path[64];          /**< The IMA log written to a file, for the streaming stage */
+    RIM_Index ima_rim;              /**< Index every file measured in the IMA log verifies against */
+    LogPipeline *pipeline;          /**< Pipeline of the parallel stage, taking logs of any size */
+    const LogDictionary *dictionary; /**< Dictionary of the compression stages */
+    uint8_t *frame;                 /**< The log compressed with the dictionary */
+    size_t frame_size;              /**< Size of the compressed log */
+    size_t frame_capacity;          /**< Size of the frame buffer */
+    uint8_t *decompressed;          /**< Buffer the decompression stage writes the log to */
+} BenchInput;
+
+/**
+ * @struct BenchResult
+ * @brief Measurements of one stage on one log.
+ */
+typedef struct {
+    char stage[24];                 /**< Stage name */
+    char mix[32];                   /**< Event mix */
+    char banks[48];                 /**< Digest banks */
+    size_t events;                  /**< Records in the log */
+    size_t bytes;                   /**< Size of the log */
+    size_t iterations;              /**< Timed runs */
+    double events_per_sec;          /**< Events over mean run time */
+    double bytes_per_sec;           /**< Log bytes over mean run time */
+    uint64_t p50_ns;                /**< Median run time */
+    uint64_t p99_ns;                /**< 99th percentile run time */
+    double allocations;             /**< Heap allocations per run */
+    double allocated_bytes;         /**< Heap bytes requested per run */
+} BenchResult;
+
+typedef bool (*BenchStageFunction)(BenchInput *input);
+
+/**
+ * @struct BenchStage
+ * @brief A measured stage of the pipeline.
+ */
+typedef struct {
+    const char *name;
+    BenchStageFunction run;
+    bool ima;                       /**< Runs on the IMA log rather than the event log */
+} BenchStage;
+
+// Stages
+
+static bool stage_cursor(BenchInput *input) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    size_t count = 0;
+    if (tcg_log_cursor_init(&cursor, input->log, input->log_size) != TCG_LOG_OK) {
+        return false;
+    }
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        count++;
+    }
+    return status == TCG_LOG_END && count == input->event_count;
+}
+
+static bool stage_parse_file(BenchInput *input) {
+    return parse_event_log_from_file(input->log_path, &input->rim);
+}
+
+static bool stage_process(BenchInput *input) {
+    return process_event_log(input->log, input->log_size, &input->rim);
+}
+
+static bool stage_replay(BenchInput *input) {
+    PCR_BankSet replayed;
+    return pcr_replay_log(input->log, input->log_size, &replayed) == 0;
+}
+
+// Replay and RIM check together, against process + replay run one after the other
+static bool stage_pipeline(BenchInput *input) {
+    PCR_BankSet replayed;
+    bool accepted = false;
+    return log_pipeline_verify(input->pipeline, input->log, input->log_size, &input->rim, &replayed, NULL,
+                               &accepted) == 0 && accepted;
+}
+
+static bool stage_rim_lookup(BenchInput *input) {
+    for (size_t i = 0; i < input->name_count; i++) {
+        if (!rim_index_find_by_name(&input->rim, input->names[i], input->name_lengths[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool stage_pack(BenchInput *input) {
+    AttestationResponse response = ATTESTATION_RESPONSE__INIT;
+    response.attestor_id = "bench";
+    response.n_pcrs = TPM_PCR_COUNT;
+    response.pcrs = input->pcr_list;
+    response.measurement_log.data = input->log;
+    response.measurement_log.len = input->log_size;
+    return attestation_response__get_packed_size(&response) == input->packed_size &&
+           attestation_response__pack(&response, input->packed) == input->packed_size;
+}
+
+static bool stage_unpack(BenchInput *input) {
+    AttestationResponse *response = attestation_response__unpack(NULL, input->packed_size, input->packed);
+    bool ok = response && response->measurement_log.len == input->log_size;
+    if (response) {
+        attestation_response__free_unpacked(response, NULL);
+    }
+    return ok;
+}
+
+static bool stage_decode(BenchInput *input) {
+    AttestationResponse *response = attestation_response_decode(&input->arena, input->packed, input->packed_size);
+    bool ok = response && response->measurement_log.len == input->log_size;
+    arena_reset(&input->arena);
+    return ok;
+}
+
+static bool stage_compress(BenchInput *input) {
+    size_t frame_size;
+    return log_dictionary_compress(input->dictionary, input->log, input->log_size, input->frame,
+                                   input->frame_capacity, &frame_size) == 0 && frame_size == input->frame_size;
+}
+
+static bool stage_decompress(BenchInput *input) {
+    return log_dictionary_decompress(input->dictionary, input->frame, input->frame_size, input->decompressed,
+                                     input->log_size) == 0;
+}
+
+static bool stage_ima_process(BenchInput *input) {
+    IMA_VerifyResult result;
+    return process_ima_log(input->ima_log, input->ima_log_size, TPM2_ALG_SHA1, &input->ima_rim, &result, NULL) &&
+           result.entries == input->ima_entry_count;
+}
+
+static bool stage_ima_stream(BenchInput *input) {
+    return parse_ima_log_from_file(input->ima_log_path, TPM2_ALG_SHA1, &input->ima_rim);
+}
+
+static const BenchStage bench_stages[] = {
+    { "cursor", stage_cursor, false },
+    { "parse_file", stage_parse_file, false },
+    { "process", stage_process, false },
+    { "replay", stage_replay, false },
+    { "pipeline", stage_pipeline, false },
+    { "rim_lookup", stage_rim_lookup, false },
+    { "pack", stage_pack, false },
+    { "unpack", stage_unpack, false },
+    { "decode", stage_decode, false },
+    { "compress", stage_compress, false },
+    { "decompress", stage_decompress, false },
+    { "ima_process", stage_ima_process, true },
+    { "ima_stream", stage_ima_stream, true },
+};
+
+// Inputs
+
+static void bench_input_free(BenchInput *input) {
+    if (input->log_path[0]) {
+        unlink(input->log_path);
+    }
+    if (input->ima_log_path[0]) {
+        unlink(input->ima_log_path);
+    }
+    free(input->log);
+    free(input->ima_log);
+    free(input->names);
+    free(input->name_lengths);
+    free(input->packed);
+    free(input->frame);
+    free(input->decompressed);
+    rim_index_free(&input->rim);
+    rim_index_free(&input->ima_rim);
+    arena_free(&input->arena);
+    log_pipeline_destroy(input->pipeline);
+    memset(input, 0, sizeof(*input));
+}
+
+static int write_file(const char *filename, const uint8_t *data, size_t size) {
+    FILE *file = fopen(filename, "wb");
+    int rc = file && fwrite(data, 1, size, file) == size ? 0 : -1;
+    if (file && fclose(file) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error writing %s\n", filename);
+    }
+    return rc;
+}
+
+/**
+ * @brief Generates an event log and an IMA log, and prepares every stage's input from them.
+ */
+static int bench_input_prepare(BenchInput *input, const LogGeneratorConfig *config,
+                               const LogGeneratorImaConfig *ima_config, const LogDictionary *dictionary) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+
+    if (log_generator_generate(config, &input->log, &input->log_size) != 0 ||
+        rim_index_init(&input->rim, config->event_count * config->bank_count) != 0) {
+        return -1;
+    }
+    arena_init(&input->arena, 0);
+    input->pipeline = log_pipeline_create(0, 1);
+    if (!input->pipeline) {
+        return -1;
+    }
+    if (log_generator_fill_rim(input->log, input->log_size, &input->rim) != 0) {
+        fprintf(stderr, "Error indexing the generated log\n");
+        return -1;
+    }
+
+    input->names = malloc((config->event_count + 1) * sizeof(*input->names));
+    input->name_lengths = malloc((config->event_count + 1) * sizeof(*input->name_lengths));
+    if (!input->names || !input->name_lengths) {
+        fprintf(stderr, "Error allocating memory for payload names\n");
+        return -1;
+    }
+    tcg_log_cursor_init(&cursor, input->log, input->log_size);
+    while (tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+        input->event_count++;
+        if (event.event_type != TCG_EV_NO_ACTION) {
+            input->names[input->name_count] = (const char *)event.event_data;
+            input->name_lengths[input->name_count++] = strnlen((const char *)event.event_data, event.event_size);
+        }
+    }
+
+    // The file stages read the logs back from disk on every run
+    snprintf(input->log_path, sizeof(input->log_path), "/tmp/attest_bench_%d.bin", (int)getpid());
+    if (write_file(input->log_path, input->log, input->log_size) != 0) {
+        return -1;
+    }
+
+    if (log_generator_generate_ima(ima_config, &input->ima_log, &input->ima_log_size) != 0 ||
+        rim_index_init(&input->ima_rim, ima_config->entry_count + 1) != 0 ||
+        log_generator_fill_rim_ima(input->ima_log, input->ima_log_size, ima_config->bank, &input->ima_rim) != 0) {
+        fprintf(stderr, "Error generating the IMA log\n");
+        return -1;
+    }
+    input->ima_entry_count = ima_config->entry_count + 1;
+    snprintf(input->ima_log_path, sizeof(input->ima_log_path), "/tmp/attest_bench_%d.ima", (int)getpid());
+    if (write_file(input->ima_log_path, input->ima_log, input->ima_log_size) != 0) {
+        return -1;
+    }
+
+    // Report the replayed PCRs in the packed response, as an attestor would
+    if (pcr_replay_log(input->log, input->log_size, &input->pcrs) != 0) {
+        fprintf(stderr, "Generated log does not replay\n");
+        return -1;
+    }
+    const PCR_Bank *bank = pcr_bankset_find(&input->pcrs, TPM2_ALG_SHA256);
+    for (int i = 0; i < TPM_PCR_COUNT; i++) {
+        PCR pcr = PCR__INIT;
+        pcr.index = i;
+        pcr.value.data = bank ? (uint8_t *)bank->pcrs[i].buffer : input->log;
+        pcr.value.len = bank ? bank->pcrs[i].size : 0;
+        input->pcr_values[i] = pcr;
+        input->pcr_list[i] = &input->pcr_values[i];
+    }
+    AttestationResponse response = ATTESTATION_RESPONSE__INIT;
+    response.attestor_id = "bench";
+    response.n_pcrs = TPM_PCR_COUNT;
+    response.pcrs = input->pcr_list;
+    response.measurement_log.data = input->log;
+    response.measurement_log.len = input->log_size;
+    input->packed_size = attestation_response__get_packed_size(&response);
+    input->packed = malloc(input->packed_size);
+    if (!input->packed) {
+        fprintf(stderr, "Error allocating memory for packed response\n");
+        return -1;
+    }
+    attestation_response__pack(&response, input->packed);
+
+    // The compression stages check every run against the frame compressed here
+    input->dictionary = dictionary;
+    input->frame_capacity = log_dictionary_compress_bound(input->log_size);
+    input->frame = malloc(input->frame_capacity);
+    input->decompressed = malloc(input->log_size);
+    if (!input->frame || !input->decompressed) {
+        fprintf(stderr, "Error allocating memory for the compressed log\n");
+        return -1;
+    }
+    if (log_dictionary_compress(dictionary, input->log, input->log_size, input->frame, input->frame_capacity,
+                                &input->frame_size) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Trains a dictionary on logs generated like the measured ones but with other seeds, as a fleet's
+ *        dictionary is trained on other devices' logs than the ones it later compresses.
+ */
+static int bench_train_dictionary(const LogGeneratorConfig *config, LogDictionary *dictionary) {
+    LogGeneratorConfig train_config = *config;
+    uint8_t *logs[BENCH_DICTIONARY_LOGS] = { 0 };
+    size_t log_sizes[BENCH_DICTIONARY_LOGS];
+    uint8_t *trained = NULL;
+    size_t trained_size = 0;
+    int rc = 0;
+
+    if (train_config.event_count > BENCH_DICTIONARY_EVENTS) {
+        train_config.event_count = BENCH_DICTIONARY_EVENTS;
+    }
+    for (size_t i = 0; rc == 0 && i < BENCH_DICTIONARY_LOGS; i++) {
+        train_config.seed = config->seed + 1 + i;
+        rc = log_generator_generate(&train_config, &logs[i], &log_sizes[i]);
+    }
+    if (rc == 0) {
+        rc = log_dictionary_train((const uint8_t *const *)logs, log_sizes, BENCH_DICTIONARY_LOGS,
+                                  LOG_DICTIONARY_DEFAULT_SIZE, 0, LOG_DICTIONARY_DEFAULT_LEVEL, &trained,
+                                  &trained_size);
+    }
+    if (rc == 0) {
+        rc = log_dictionary_init(dictionary, trained, trained_size, LOG_DICTIONARY_DEFAULT_LEVEL);
+    }
+    free(trained);
+    for (size_t i = 0; i < BENCH_DICTIONARY_LOGS; i++) {
+        free(logs[i]);
+    }
+    return rc;
+}
+
+// IMA failure checks
+
+/**
+ * @struct ImaCheckInput
+ * @brief A generated IMA log that verifies, which each check damages in a copy of its own.
+ */
+typedef struct {
+    uint8_t *log;                   /**< Generated IMA log, longer than a streaming reader's buffer */
+    size_t log_size;                /**< Size of the log */
+    TPM2_ALG_ID bank;               /**< Bank of the log's template digests */
+    RIM_Index rim;                  /**< Index every file measured in the log verifies against */
+    TPM2B_DIGEST pcr;               /**< PCR 10 replayed from the intact log, standing in for the quoted value */
+    size_t target;                  /**< Entry the checks damage, away from boot_aggregate and the log's ends */
+} ImaCheckInput;
+
+typedef bool (*ImaCheckFunction)(const ImaCheckInput *input);
+
+/**
+ * @struct ImaCheck
+ * @brief A damaged IMA log and whether verification noticed the damage.
+ */
+typedef struct {
+    const char *name;
+    ImaCheckFunction detected;      /**< Returns true if verification reported the failure */
+} ImaCheck;
+
+/**
+ * @brief Finds the entry with a record number or, if record_num is 0, the entry that spans a byte offset.
+ *
+ * @return Returns 0 on success, or -1 if the log has no such entry.
+ */
+static int ima_find_entry(const ImaCheckInput *input, size_t record_num, uint64_t offset, IMA_EventView *event) {
+    IMA_LogReader reader;
+    if (ima_log_reader_init_buffer(&reader, input->log, input->log_size, input->bank) != IMA_LOG_OK) {
+        return -1;
+    }
+    while (ima_log_reader_next(&reader, event) == IMA_LOG_OK) {
+        if (record_num ? event->record_num == record_num
+                       : event->offset < offset && event->offset + event->length > offset) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Verifies a log in memory against a RIM, with failures going to a report rather than stderr.
+ *
+ * @return Whether every entry verified.
+ */
+static bool ima_check_verify(const ImaCheckInput *input, const uint8_t *log, size_t log_size, const RIM_Index *rim,
+                             IMA_VerifyResult *result, RIM_CheckReport *report) {
+    rim_check_report_reset(report, EVENT_DETAIL_NONE);
+    return process_ima_log(log, log_size, input->bank, rim, result, report);
+}
+
+static bool ima_pcr_matches(const ImaCheckInput *input, const IMA_VerifyResult *result) {
+    const TPM2B_DIGEST *pcr = &result->pcrs.pcrs[IMA_PCR_INDEX];
+    return pcr->size == input->pcr.size && memcmp(pcr->buffer, input->pcr.buffer, pcr->size) == 0;
+}
+
+static uint8_t *ima_copy_log(const ImaCheckInput *input) {
+    uint8_t *copy = malloc(input->log_size);
+    if (copy) {
+        memcpy(copy, input->log, input->log_size);
+    }
+    return copy;
+}
+
+// A template digest that no longer hashes the template data
+static bool check_ima_template_digest(const ImaCheckInput *input) {
+    IMA_EventView event;
+    uint8_t *log = ima_copy_log(input);
+    if (!log || ima_find_entry(input, input->target, 0, &event) != 0) {
+        free(log);
+        return false;
+    }
+    log[event.template_digest - input->log] ^= 0x01;
+
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    bool verified = ima_check_verify(input, log, input->log_size, &input->rim, &result, &report);
+    bool detected = !verified && result.template_mismatches == 1 &&
+                    report.first_failure.record_num == input->target &&
+                    report.first_failure.status == EVENT_STATUS_MISMATCH;
+    rim_check_report_free(&report);
+    free(log);
+    return detected;
+}
+
+// An entry left out: every remaining entry verifies, and only PCR 10 no longer matches the quote
+static bool check_ima_pcr_replay(const ImaCheckInput *input) {
+    IMA_EventView event;
+    uint8_t *log = ima_copy_log(input);
+    if (!log || ima_find_entry(input, input->target, 0, &event) != 0) {
+        free(log);
+        return false;
+    }
+    memmove(log + event.offset, log + event.offset + event.length, input->log_size - event.offset - event.length);
+
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    bool verified = ima_check_verify(input, log, input->log_size - event.length, &input->rim, &result, &report);
+    bool detected = verified && !ima_pcr_matches(input, &result);
+    rim_check_report_free(&report);
+    free(log);
+    return detected;
+}
+
+// A measured file the RIM does not list
+static bool check_ima_missing_file(const ImaCheckInput *input) {
+    IMA_LogReader reader;
+    IMA_EventView event;
+    RIM_Index rim;
+    if (rim_index_init(&rim, input->rim.entry_count) != 0) {
+        return false;
+    }
+    bool built = ima_log_reader_init_buffer(&reader, input->log, input->log_size, input->bank) == IMA_LOG_OK;
+    while (built && ima_log_reader_next(&reader, &event) == IMA_LOG_OK) {
+        if (event.record_num != input->target && event.file_digest) {
+            built = rim_index_add(&rim, event.file_name, event.file_name_len, event.file_digest_alg,
+                                  event.file_digest, event.file_digest_size) == 0;
+        }
+    }
+
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    bool verified = built && ima_check_verify(input, input->log, input->log_size, &rim, &result, &report);
+    bool detected = built && !verified && report.status_counts[EVENT_STATUS_UNKNOWN] == 1 &&
+                    report.first_failure.record_num == input->target;
+    rim_check_report_free(&report);
+    rim_index_free(&rim);
+    return detected;
+}
+
+// A log that ends inside the entry the streaming reader has to carry over from one 64 KiB chunk to the next
+static bool check_ima_truncated_chunk(const ImaCheckInput *input) {
+    IMA_EventView event;
+    if (ima_find_entry(input, 0, IMA_LOG_READER_BUFFER_SIZE, &event) != 0) {
+        return false;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/attest_bench_%d.truncated.ima", (int)getpid());
+    if (write_file(path, input->log, event.offset + event.length - 1) != 0) {
+        return false;
+    }
+
+    IMA_LogReader reader;
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    bool detected = false;
+    if (ima_log_reader_open(&reader, path, input->bank) == IMA_LOG_OK) {
+        rim_check_report_reset(&report, EVENT_DETAIL_NONE);
+        bool verified = verify_ima_log_reader(&reader, input->bank, &input->rim, &result, &report);
+        detected = !verified && result.status == IMA_LOG_ERR_TRUNCATED && result.entries == event.record_num - 1;
+        ima_log_reader_close(&reader);
+    }
+    rim_check_report_free(&report);
+    unlink(path);
+    return detected;
+}
+
+// A ToMToU/open-writers violation: logged with a zero digest, extended as all ones
+static bool check_ima_violation(const ImaCheckInput *input) {
+    IMA_EventView event;
+    uint8_t *log = ima_copy_log(input);
+    if (!log || ima_find_entry(input, input->target, 0, &event) != 0) {
+        free(log);
+        return false;
+    }
+    memset(log + (event.template_digest - input->log), 0, event.template_digest_size);
+
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    ima_check_verify(input, log, input->log_size, &input->rim, &result, &report);
+    bool detected = result.violations == 1 && report.status_counts[EVENT_STATUS_SKIPPED] >= 1 &&
+                    !ima_pcr_matches(input, &result);
+    rim_check_report_free(&report);
+    free(log);
+    return detected;
+}
+
+static const ImaCheck ima_checks[] = {
+    { "template_digest", check_ima_template_digest },
+    { "pcr_replay", check_ima_pcr_replay },
+    { "missing_file", check_ima_missing_file },
+    { "truncated_chunk", check_ima_truncated_chunk },
+    { "violation", check_ima_violation },
+};
+
+/**
+ * @brief Damages a generated IMA log in each way of ima_checks and checks that verification reports it.
+ *
+ * @return Number of checks whose damage went unnoticed, or -1 if the log could not be prepared.
+ */
+static int run_ima_checks(const LogGeneratorImaConfig *ima_config) {
+    ImaCheckInput input = { .bank = ima_config->bank };
+    LogGeneratorImaConfig config = *ima_config;
+    config.entry_count = BENCH_IMA_CHECK_ENTRIES;
+
+    IMA_VerifyResult result;
+    RIM_CheckReport report = { 0 };
+    int rc = -1;
+    if (log_generator_generate_ima(&config, &input.log, &input.log_size) != 0 ||
+        rim_index_init(&input.rim, config.entry_count + 1) != 0 ||
+        log_generator_fill_rim_ima(input.log, input.log_size, config.bank, &input.rim) != 0) {
+        fprintf(stderr, "Error generating the IMA log of the checks\n");
+    } else if (input.log_size <= IMA_LOG_READER_BUFFER_SIZE ||
+               !ima_check_verify(&input, input.log, input.log_size, &input.rim, &result, &report)) {
+        fprintf(stderr, "IMA log of the checks is too short or does not verify\n");
+    } else {
+        input.pcr = result.pcrs.pcrs[IMA_PCR_INDEX];
+        input.target = config.entry_count / 2;
+        rc = 0;
+        for (size_t i = 0; i < sizeof(ima_checks) / sizeof(ima_checks[0]); i++) {
+            bool detected = ima_checks[i].detected(&input);
+            printf("%-12s %-16s %s\n", "ima_check", ima_checks[i].name, detected ? "detected" : "NOT DETECTED");
+            rc += !detected;
+        }
+    }
+    rim_check_report_free(&report);
+    rim_index_free(&input.rim);
+    free(input.log);
+    return rc;
+}
+
+// Measurement
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Runs a stage once untimed, then iterations times, and summarizes the run times.
+ *
+ * The stages log every event to stdout, which would measure the terminal rather than the code; stdout goes to
+ * /dev/null while they run.
+ *
+ * @return Returns 0 on success, or -1 if the stage failed on its input.
+ */
+static int bench_run_stage(const BenchStage *stage, BenchInput *input, size_t iterations, BenchResult *result) {
+    uint64_t *samples = malloc(iterations * sizeof(*samples));
+    if (!samples) {
+        fprintf(stderr, "Error allocating memory for samples\n");
+        return -1;
+    }
+
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "Error redirecting stdout\n");
+        free(samples);
+        return -1;
+    }
+    close(null_fd);
+
+    bool ok = stage->run(input);
+    uint64_t total_ns = 0;
+    uint64_t allocations_before = allocation_count;
+    uint64_t bytes_before = allocation_bytes;
+    for (size_t i = 0; ok && i < iterations; i++) {
+        uint64_t start = now_ns();
+        ok = stage->run(input);
+        samples[i] = now_ns() - start;
+        total_ns += samples[i];
+    }
+    uint64_t allocations = allocation_count - allocations_before;
+    uint64_t allocated = allocation_bytes - bytes_before;
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    if (!ok) {
+        fprintf(stderr, "Stage %s failed on the generated log\n", stage->name);
+        free(samples);
+        return -1;
+    }
+
+    qsort(samples, iterations, sizeof(*samples), compare_u64);
+    double mean_s = (double)total_ns / (double)iterations / 1e9;
+    snprintf(result->stage, sizeof(result->stage), "%s", stage->name);
+    snprintf(result->mix, sizeof(result->mix), "%s", input->mix_name);
+    snprintf(result->banks, sizeof(result->banks), "%s", input->bank_names);
+    result->events = stage->ima ? input->ima_entry_count : input->event_count;
+    result->bytes = stage->ima ? input->ima_log_size : input->log_size;
+    result->iterations = iterations;
+    result->events_per_sec = mean_s > 0 ? (double)result->events / mean_s : 0;
+    result->bytes_per_sec = mean_s > 0 ? (double)result->bytes / mean_s : 0;
+    result->p50_ns = samples[(iterations - 1) / 2];
+    result->p99_ns = samples[(iterations * 99 + 99) / 100 - 1];
+    result->allocations = (double)allocations / (double)iterations;
+    result->allocated_bytes = (double)allocated / (double)iterations;
+    free(samples);
+    return 0;
+}
+
+// Baselines
+
+static bool same_case(const BenchResult *a, const BenchResult *b) {
+    return strcmp(a->stage, b->stage) == 0 && strcmp(a->mix, b->mix) == 0 && strcmp(a->banks, b->banks) == 0 &&
+           a->events == b->events;
+}
+
+static int baseline_save(const char *filename, const BenchResult *results, size_t count) {
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return -1;
+    }
+    fprintf(file, "%s\n# stage mix banks events events_per_sec p50_ns p99_ns allocations\n", BENCH_BASELINE_HEADER);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(file, "%s %s %s %zu %.0f %llu %llu %.2f\n", results[i].stage, results[i].mix, results[i].banks,
+                results[i].events, results[i].events_per_sec, (unsigned long long)results[i].p50_ns,
+                (unsigned long long)results[i].p99_ns, results[i].allocations);
+    }
+    int rc = fclose(file) == 0 ? 0 : -1;
+    if (rc == 0) {
+        printf("Saved %zu results to %s\n", count, filename);
+    }
+    return rc;
+}
+
+static int baseline_load(const char *filename, BenchResult *baseline, size_t capacity, size_t *count) {
+    FILE *file = fopen(filename, "r");
+    char line[256];
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return -1;
+    }
+    if (!fgets(line, sizeof(line), file) || strncmp(line, BENCH_BASELINE_HEADER, strlen(BENCH_BASELINE_HEADER)) != 0) {
+        fprintf(stderr, "%s is not an attest_bench baseline\n", filename);
+        fclose(file);
+        return -1;
+    }
+    *count = 0;
+    while (*count < capacity && fgets(line, sizeof(line), file)) {
+        BenchResult *entry = &baseline[*count];
+        unsigned long long p50, p99;
+        memset(entry, 0, sizeof(*entry));
+        if (line[0] == '#') {
+            continue;
+        }
+        if (sscanf(line, "%23s %31s %47s %zu %lf %llu %llu %lf", entry->stage, entry->mix, entry->banks,
+                   &entry->events, &entry->events_per_sec, &p50, &p99, &entry->allocations) != 8) {
+            fprintf(stderr, "Malformed baseline line: %s", line);
+            fclose(file);
+            return -1;
+        }
+        entry->p50_ns = p50;
+        entry->p99_ns = p99;
+        (*count)++;
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Compares results with a baseline and prints the change of each.
+ *
+ * A result regresses when its throughput or median time is worse than the baseline's by more than the tolerance,
+ * or when it allocates more per run. p99 is reported but not judged: on a shared machine it is mostly noise.
+ *
+ * @return Returns the number of regressions.
+ */
+static size_t baseline_compare(const BenchResult *results, size_t count, const BenchResult *baseline,
+                               size_t baseline_count, double tolerance) {
+    size_t regressions = 0;
+    printf("\n%-12s %-8s %10s %10s %10s %10s  %s\n", "stage", "mix", "events", "ev/s", "p50", "p99", "verdict");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult *base = NULL;
+        for (size_t j = 0; j < baseline_count && !base; j++) {
+            if (same_case(&results[i], &baseline[j])) {
+                base = &baseline[j];
+            }
+        }
+        if (!base) {
+            printf("%-12s %-8s %10zu %10s %10s %10s  new\n", results[i].stage, results[i].mix, results[i].events,
+                   "-", "-", "-");
+            continue;
+        }
+
+        double throughput = base->events_per_sec > 0 ? results[i].events_per_sec / base->events_per_sec - 1 : 0;
+        double p50 = base->p50_ns > 0 ? (double)results[i].p50_ns / (double)base->p50_ns - 1 : 0;
+        double p99 = base->p99_ns > 0 ? (double)results[i].p99_ns / (double)base->p99_ns - 1 : 0;
+        bool regressed = throughput < -tolerance || p50 > tolerance ||
+                         results[i].allocations > base->allocations + 0.5;
+        regressions += regressed;
+        printf("%-12s %-8s %10zu %+9.1f%% %+9.1f%% %+9.1f%%  %s\n", results[i].stage, results[i].mix,
+               results[i].events, throughput * 100, p50 * 100, p99 * 100, regressed ? "REGRESSION" : "ok");
+    }
+    return regressions;
+}
+
+// Command line
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n <sizes>  Comma-separated event counts to generate (default: " BENCH_DEFAULT_SIZES ")\n"
+            "  -m <mix>    Event mix: boot, runtime, uniform, or <type>:<pcr>:<weight>:<data size>,... "
+            "(default: boot)\n"
+            "  -b <banks>  Digest banks: sha1,sha256,sha384,sha512,sm3_256 (default: sha1,sha256)\n"
+            "  -s <seed>   Generator seed (default: %d)\n"
+            "  -i <count>  Timed runs per stage (default: enough for %d events, %d to %d runs)\n"
+            "  -S <file>   Save the results as a baseline\n"
+            "  -B <file>   Compare the results with a baseline; exits with 2 on a regression\n"
+            "  -t <pct>    Tolerance of the comparison in percent (default: %d)\n"
+            "  -D <file>   Dictionary of the compression stages (default: one trained on logs of the next %d seeds)\n"
+            "  -o <file>   Write the generated log of the last size to <file> and exit\n"
+            "  -I <file>   Write a generated IMA log with the last size's entries to <file> and exit\n"
+            "  -C          Run the IMA failure checks only; they also run before every benchmark\n",
+            program, BENCH_DEFAULT_SEED, BENCH_TARGET_EVENTS, BENCH_MIN_ITERATIONS, BENCH_MAX_ITERATIONS,
+            BENCH_DEFAULT_TOLERANCE, BENCH_DICTIONARY_LOGS);
+}
+
+static size_t parse_sizes(const char *text, size_t *sizes, size_t capacity) {
+    size_t count = 0;
+    const char *p = text;
+    while (*p && count < capacity) {
+        char *end;
+        unsigned long long size = strtoull(p, &end, 10);
+        if (end == p || size == 0 || (*end != ',' && *end != '\0')) {
+            return 0;
+        }
+        sizes[count++] = (size_t)size;
+        p = end + (*end == ',');
+    }
+    return *p ? 0 : count;
+}
+
+static size_t iterations_for(size_t events, size_t fixed) {
+    if (fixed) {
+        return fixed;
+    }
+    size_t iterations = BENCH_TARGET_EVENTS / (events ? events : 1);
+    if (iterations < BENCH_MIN_ITERATIONS) {
+        return BENCH_MIN_ITERATIONS;
+    }
+    return iterations > BENCH_MAX_ITERATIONS ? BENCH_MAX_ITERATIONS : iterations;
+}
+
+static int write_log(const LogGeneratorConfig *config, const char *filename) {
+    uint8_t *log;
+    size_t log_size;
+    if (log_generator_generate(config, &log, &log_size) != 0) {
+        return -1;
+    }
+    int rc = write_file(filename, log, log_size);
+    free(log);
+    if (rc != 0) {
+        return -1;
+    }
+    printf("Wrote %zu events (%zu bytes) to %s\n", config->event_count, log_size, filename);
+    return 0;
+}
+
+static int write_ima_log(const LogGeneratorImaConfig *config, const char *filename) {
+    uint8_t *log;
+    size_t log_size;
+    if (log_generator_generate_ima(config, &log, &log_size) != 0) {
+        return -1;
+    }
+    int rc = write_file(filename, log, log_size);
+    free(log);
+    if (rc != 0) {
+        return -1;
+    }
+    printf("Wrote %zu IMA entries (%zu bytes) to %s\n", config->entry_count + 1, log_size, filename);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *size_list = BENCH_DEFAULT_SIZES;
+    const char *mix = "boot";
+    const char *banks = "sha1,sha256";
+    const char *save_file = NULL;
+    const char *baseline_file = NULL;
+    const char *output_file = NULL;
+    const char *ima_output_file = NULL;
+    const char *dictionary_file = NULL;
+    bool checks_only = false;
+    uint64_t seed = BENCH_DEFAULT_SEED;
+    size_t fixed_iterations = 0;
+    double tolerance = BENCH_DEFAULT_TOLERANCE / 100.0;
+    size_t sizes[BENCH_MAX_SIZES];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:b:s:i:S:B:t:o:I:D:Ch")) != -1) {
+        switch (opt) {
+            case 'n': size_list = optarg; break;
+            case 'm': mix = optarg; break;
+            case 'b': banks = optarg; break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'i': fixed_iterations = strtoul(optarg, NULL, 10); break;
+            case 'S': save_file = optarg; break;
+            case 'B': baseline_file = optarg; break;
+            case 't': tolerance = strtod(optarg, NULL) / 100.0; break;
+            case 'o': output_file = optarg; break;
+            case 'I': ima_output_file = optarg; break;
+            case 'D': dictionary_file = optarg; break;
+            case 'C': checks_only = true; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    size_t size_count = parse_sizes(size_list, sizes, BENCH_MAX_SIZES);
+    if (size_count == 0) {
+        fprintf(stderr, "Malformed event counts: %s\n", size_list);
+        return EXIT_FAILURE;
+    }
+
+    // Custom mixes contain ':'; the preset only provides the defaults they override
+    LogGeneratorConfig config;
+    bool custom_mix = strchr(mix, ':') != NULL;
+    if (log_generator_preset(&config, custom_mix ? "boot" : mix, sizes[0], seed) != 0 ||
+        (custom_mix && log_generator_parse_mix(&config, mix) != 0) ||
+        log_generator_parse_banks(&config, banks) != 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    LogGeneratorImaConfig ima_config;
+    log_generator_ima_preset(&ima_config, sizes[0], seed);
+    if (output_file || ima_output_file) {
+        config.event_count = sizes[size_count - 1];
+        ima_config.entry_count = sizes[size_count - 1];
+        if ((output_file && write_log(&config, output_file) != 0) ||
+            (ima_output_file && write_ima_log(&ima_config, ima_output_file) != 0)) {
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // A fast verifier is only worth measuring if it still rejects what it must
+    int missed = run_ima_checks(&ima_config);
+    if (missed != 0) {
+        if (missed > 0) {
+            printf("%d IMA failure checks not detected\n", missed);
+        }
+        return EXIT_FAILURE;
+    }
+    if (checks_only) {
+        return EXIT_SUCCESS;
+    }
+
+    LogDictionary dictionary;
+    if ((dictionary_file ? log_dictionary_load(&dictionary, dictionary_file, LOG_DICTIONARY_DEFAULT_LEVEL)
+                         : bench_train_dictionary(&config, &dictionary)) != 0) {
+        fprintf(stderr, "Error preparing the log dictionary\n");
+        return EXIT_FAILURE;
+    }
+
+    static BenchResult results[BENCH_MAX_RESULTS];
+    size_t result_count = 0;
+    size_t stage_count = sizeof(bench_stages) / sizeof(bench_stages[0]);
+    printf("SHA-256 replay kernel: %s%s\n", pcr_sha256_kernel_name(pcr_sha256_kernel()),
+#ifdef BENCH_COUNT_ALLOCATIONS
+           ""
+#else
+           "; allocations not counted in this build"
+#endif
+    );
+    printf("%-12s %-8s %10s %12s %10s %12s %12s %12s %10s\n", "stage", "mix", "events", "bytes", "runs", "ev/s",
+           "MB/s", "p50 us", "p99 us");
+
+    for (size_t s = 0; s < size_count; s++) {
+        BenchInput input = { .mix_name = custom_mix ? "custom" : mix, .bank_names = banks };
+        config.event_count = sizes[s];
+        ima_config.entry_count = sizes[s];
+        if (bench_input_prepare(&input, &config, &ima_config, &dictionary) != 0) {
+            bench_input_free(&input);
+            log_dictionary_free(&dictionary);
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = 0; i < stage_count && result_count < BENCH_MAX_RESULTS; i++) {
+            BenchResult *result = &results[result_count];
+            if (bench_run_stage(&bench_stages[i], &input, iterations_for(input.event_count, fixed_iterations),
+                                result) != 0) {
+                bench_input_free(&input);
+                log_dictionary_free(&dictionary);
+                return EXIT_FAILURE;
+            }
+            printf("%-12s %-8s %10zu %12zu %10zu %12.0f %12.1f %12.1f %10.1f  %.1f allocs/run\n", result->stage,
+                   result->mix, result->events, result->bytes, result->iterations, result->events_per_sec,
+                   result->bytes_per_sec / 1e6, result->p50_ns / 1e3, result->p99_ns / 1e3, result->allocations);
+            result_count++;
+        }
+        printf("%-12s %-8s %10zu %12zu -> %zu bytes with dictionary %u (ratio %.1fx)\n", "compressed", input.mix_name,
+               input.event_count, input.log_size, input.frame_size, dictionary.id,
+               (double)input.log_size / (double)input.frame_size);
+        bench_input_free(&input);
+    }
+    log_dictionary_free(&dictionary);
+
+    if (save_file && baseline_save(save_file, results, result_count) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (baseline_file) {
+        static BenchResult baseline[BENCH_MAX_RESULTS];
+        size_t baseline_count;
+        if (baseline_load(baseline_file, baseline, BENCH_MAX_RESULTS, &baseline_count) != 0) {
+            return EXIT_FAILURE;
+        }
+        size_t regressions = baseline_compare(results, result_count, baseline, baseline_count, tolerance);
+        if (regressions > 0) {
+            printf("%zu regressions against %s\n", regressions, baseline_file);
+            return 2;
+        }
+    }
+    return EXIT_SUCCESS;
+}
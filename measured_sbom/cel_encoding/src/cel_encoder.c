@@ -0,0 +1,254 @@
+// cel_encoder.c
+// Canonical Event Log TLV encoder. Re-encodes PC Client records and IMA runtime measurements into one stream per
+// device, which the verifier parses with the same cursor and replays with the same engine as a PC Client log.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cel_encoder.h"
+
+#define CEL_ENCODER_INITIAL_CAPACITY 65536
+
+static const uint8_t zero_padding[IMA_LEGACY_NAME_SIZE];
+
+static EVP_MD *fetch_bank_md(TPM2_ALG_ID alg) {
+    switch (alg) {
+        case TPM2_ALG_SHA1:   return EVP_MD_fetch(NULL, "SHA1", NULL);
+        case TPM2_ALG_SHA256: return EVP_MD_fetch(NULL, "SHA256", NULL);
+        case TPM2_ALG_SHA384: return EVP_MD_fetch(NULL, "SHA384", NULL);
+        case TPM2_ALG_SHA512: return EVP_MD_fetch(NULL, "SHA512", NULL);
+        case TPM2_ALG_SM3_256: return EVP_MD_fetch(NULL, "SM3", NULL);
+        default:              return NULL;
+    }
+}
+
+static inline void write_be32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static inline uint8_t *put_tlv_header(uint8_t *p, uint8_t type, size_t length) {
+    p[0] = type;
+    write_be32(p + 1, (uint32_t)length);
+    return p + TCG_CEL_TLV_HEADER_SIZE;
+}
+
+static inline uint8_t *put_tlv(uint8_t *p, uint8_t type, const void *value, size_t length) {
+    p = put_tlv_header(p, type, length);
+    memcpy(p, value, length);
+    return p + length;
+}
+
+int cel_encoder_init(CEL_Encoder *encoder, const TCG_EventLogCursor *cursor) {
+    memset(encoder, 0, sizeof(*encoder));
+    if (!cursor || cursor->bank_count == 0) {
+        fprintf(stderr, "CEL encoder init failed: Invalid input\n");
+        return -1;
+    }
+
+    encoder->bank_count = cursor->bank_count;
+    memcpy(encoder->banks, cursor->banks, cursor->bank_count * sizeof(*cursor->banks));
+    for (uint32_t b = 0; b < encoder->bank_count; b++) {
+        encoder->mds[b] = fetch_bank_md(encoder->banks[b].alg);
+        if (!encoder->mds[b] || (size_t)EVP_MD_get_size(encoder->mds[b]) != encoder->banks[b].size) {
+            fprintf(stderr, "Unsupported PCR bank algorithm 0x%04x\n", encoder->banks[b].alg);
+            cel_encoder_free(encoder);
+            return -1;
+        }
+    }
+    encoder->ctx = EVP_MD_CTX_new();
+    if (!encoder->ctx) {
+        fprintf(stderr, "Error creating digest context for CEL encoder\n");
+        cel_encoder_free(encoder);
+        return -1;
+    }
+    return 0;
+}
+
+void cel_encoder_free(CEL_Encoder *encoder) {
+    if (!encoder) {
+        return;
+    }
+    for (uint32_t b = 0; b < TCG_MAX_DIGEST_BANKS; b++) {
+        EVP_MD_free(encoder->mds[b]);
+    }
+    EVP_MD_CTX_free(encoder->ctx);
+    free(encoder->data);
+    memset(encoder, 0, sizeof(*encoder));
+}
+
+/**
+ * @brief Grows the output until it has room for extra more bytes.
+ */
+static int reserve(CEL_Encoder *encoder, size_t extra) {
+    if (encoder->capacity - encoder->size >= extra) {
+        return 0;
+    }
+    size_t capacity = encoder->capacity ? encoder->capacity : CEL_ENCODER_INITIAL_CAPACITY;
+    while (capacity - encoder->size < extra) {
+        capacity *= 2;
+    }
+    uint8_t *data = realloc(encoder->data, capacity);
+    if (!data) {
+        fprintf(stderr, "Error allocating memory for CEL records\n");
+        return -1;
+    }
+    encoder->data = data;
+    encoder->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Appends one record; digests[b] is the digest of bank b. Content fields are (type, value) TLV pairs.
+ */
+static int put_record(CEL_Encoder *encoder, uint32_t pcr_index, const uint8_t *const *digests, uint8_t content_type,
+                      uint8_t first_type, const void *first, size_t first_size, uint8_t second_type,
+                      const void *second, size_t second_size) {
+    size_t digests_size = 0;
+    for (uint32_t b = 0; b < encoder->bank_count; b++) {
+        digests_size += TCG_CEL_TLV_HEADER_SIZE + encoder->banks[b].size;
+    }
+    size_t content_size = 2 * TCG_CEL_TLV_HEADER_SIZE + first_size + second_size;
+    if (second_size > UINT32_MAX - 2 * TCG_CEL_TLV_HEADER_SIZE - first_size) {
+        fprintf(stderr, "Event data too large for a CEL record\n");
+        return -1;
+    }
+    size_t record_size = 4 * TCG_CEL_TLV_HEADER_SIZE + TCG_CEL_RECNUM_SIZE + 4 + digests_size + content_size;
+    if (reserve(encoder, record_size) != 0) {
+        return -1;
+    }
+
+    uint8_t *p = encoder->data + encoder->size;
+    p = put_tlv_header(p, TCG_CEL_TYPE_RECNUM, TCG_CEL_RECNUM_SIZE);
+    write_be32(p, (uint32_t)(encoder->next_recnum >> 32));
+    write_be32(p + 4, (uint32_t)encoder->next_recnum);
+    p += TCG_CEL_RECNUM_SIZE;
+    p = put_tlv_header(p, TCG_CEL_TYPE_PCR, 4);
+    write_be32(p, pcr_index);
+    p += 4;
+    p = put_tlv_header(p, TCG_CEL_TYPE_DIGESTS, digests_size);
+    for (uint32_t b = 0; b < encoder->bank_count; b++) {
+        p = put_tlv(p, (uint8_t)encoder->banks[b].alg, digests[b], encoder->banks[b].size);
+    }
+    p = put_tlv_header(p, content_type, content_size);
+    p = put_tlv(p, first_type, first, first_size);
+    put_tlv(p, second_type, second, second_size);
+
+    encoder->size += record_size;
+    encoder->next_recnum++;
+    return 0;
+}
+
+int cel_encode_tcg_event(CEL_Encoder *encoder, const TCG_EventView *event) {
+    static const uint8_t zeros[sizeof(TPMU_HA)];
+    const uint8_t *digests[TCG_MAX_DIGEST_BANKS];
+    if (!encoder || !event || event->content != TCG_CONTENT_PCCLIENT) {
+        fprintf(stderr, "CEL encoding failed: Invalid input\n");
+        return -1;
+    }
+
+    for (uint32_t b = 0; b < encoder->bank_count; b++) {
+        const TCG_DigestView *digest = tcg_event_find_digest(event, encoder->banks[b].alg);
+        if (event->event_type == TCG_EV_NO_ACTION) {
+            digests[b] = zeros;
+        } else if (digest && digest->size == encoder->banks[b].size) {
+            digests[b] = digest->digest;
+        } else {
+            fprintf(stderr, "Event %zu has no digest for bank 0x%04x\n", event->record_num, encoder->banks[b].alg);
+            return -1;
+        }
+    }
+
+    uint8_t event_type[4];
+    write_be32(event_type, event->event_type);
+    return put_record(encoder, event->pcr_index, digests, TCG_CEL_TYPE_PCCLIENT_STD, TCG_CEL_PCCLIENT_EVENT_TYPE,
+                      event_type, sizeof(event_type), TCG_CEL_PCCLIENT_EVENT_DATA, event->event_data,
+                      event->event_size);
+}
+
+/**
+ * @brief Computes an entry's template digest in another bank. The "ima" template hashes the file digest and the
+ * name NUL-padded to IMA_LEGACY_NAME_SIZE bytes; the other templates hash their data as logged.
+ */
+static int template_digest(CEL_Encoder *encoder, const EVP_MD *md, const IMA_EventView *event, uint8_t *digest) {
+    if (EVP_DigestInit_ex(encoder->ctx, md, NULL) != 1) {
+        return -1;
+    }
+    if (event->template_kind == IMA_TEMPLATE_IMA) {
+        if (EVP_DigestUpdate(encoder->ctx, event->file_digest, event->file_digest_size) != 1 ||
+            EVP_DigestUpdate(encoder->ctx, event->file_name, event->file_name_len) != 1 ||
+            EVP_DigestUpdate(encoder->ctx, zero_padding, IMA_LEGACY_NAME_SIZE - event->file_name_len) != 1) {
+            return -1;
+        }
+    } else if (EVP_DigestUpdate(encoder->ctx, event->template_data, event->template_data_size) != 1) {
+        return -1;
+    }
+    return EVP_DigestFinal_ex(encoder->ctx, digest, NULL) == 1 ? 0 : -1;
+}
+
+int cel_encode_ima_event(CEL_Encoder *encoder, const IMA_EventView *event, TPM2_ALG_ID ima_bank) {
+    uint8_t computed[TCG_MAX_DIGEST_BANKS][sizeof(TPMU_HA)];
+    const uint8_t *digests[TCG_MAX_DIGEST_BANKS];
+    if (!encoder || !event || !event->template_digest) {
+        fprintf(stderr, "CEL encoding failed: Invalid input\n");
+        return -1;
+    }
+
+    bool violation = true;
+    for (uint16_t i = 0; i < event->template_digest_size && violation; i++) {
+        violation = event->template_digest[i] == 0;
+    }
+    for (uint32_t b = 0; b < encoder->bank_count; b++) {
+        if (violation) {
+            memset(computed[b], 0xff, encoder->banks[b].size);
+            digests[b] = computed[b];
+        } else if (encoder->banks[b].alg == ima_bank && encoder->banks[b].size == event->template_digest_size) {
+            digests[b] = event->template_digest;
+        } else if (template_digest(encoder, encoder->mds[b], event, computed[b]) == 0) {
+            digests[b] = computed[b];
+        } else {
+            fprintf(stderr, "Digest computation failed for IMA entry %zu\n", event->record_num);
+            return -1;
+        }
+    }
+
+    return put_record(encoder, event->pcr_index, digests, TCG_CEL_TYPE_IMA_TEMPLATE, TCG_CEL_IMA_TEMPLATE_NAME,
+                      event->template_name, event->template_name_len, TCG_CEL_IMA_TEMPLATE_DATA,
+                      event->template_data, event->template_data_size);
+}
+
+int cel_encode_log(const uint8_t *log, size_t log_size, uint8_t **cel, size_t *cel_size) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    CEL_Encoder encoder;
+    TCG_LogStatus status = tcg_log_cursor_init(&cursor, log, log_size);
+    if (status != TCG_LOG_OK) {
+        fprintf(stderr, "Invalid event log header: %s\n", tcg_log_status_str(status));
+        return -1;
+    }
+    if (cursor.cel || cel_encoder_init(&encoder, &cursor) != 0) {
+        return -1;
+    }
+
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        if (cel_encode_tcg_event(&encoder, &event) != 0) {
+            cel_encoder_free(&encoder);
+            return -1;
+        }
+    }
+    if (status != TCG_LOG_END) {
+        fprintf(stderr, "Event %zu at offset %zu: %s\n", cursor.record_num + 1, cursor.offset,
+                tcg_log_status_str(status));
+        cel_encoder_free(&encoder);
+        return -1;
+    }
+
+    // The records become the caller's buffer
+    *cel = encoder.data;
+    *cel_size = encoder.size;
+    encoder.data = NULL;
+    cel_encoder_free(&encoder);
+    return 0;
+}
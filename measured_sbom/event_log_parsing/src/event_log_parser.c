@@ -0,0 +1,442 @@
+// event_log_parser.c
+// Zero-copy parser for TCG PC Client event logs. Supports crypto-agile logs (Spec ID Event03 header followed by
+// TCG_PCR_EVENT2 records), legacy SHA-1 logs (TCG_PCR_EVENT records only) and Canonical Event Log TLV streams. The
+// parser never allocates: every view it returns points into the caller's buffer.
+
+#include <string.h>
+#include "event_log_parser.h"
+
+#define TCG_PCR_EVENT_HEADER_SIZE 32    // pcrIndex + eventType + SHA-1 digest + eventDataSize
+#define TCG_SPEC_ID_FIXED_SIZE 28       // signature[16] + platformClass + versions + uintnSize + numberOfAlgorithms
+
+// Little-endian readers; the log is not guaranteed to be aligned.
+static inline uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CEL-TLV integers are big-endian.
+static inline uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t read_be64(const uint8_t *p) {
+    return ((uint64_t)read_be32(p) << 32) | read_be32(p + 4);
+}
+
+/**
+ * @brief Decodes a legacy TCG_PCR_EVENT record at the given offset.
+ */
+static TCG_LogStatus read_legacy_event(const uint8_t *log, size_t log_size, size_t offset, TCG_EventView *view) {
+    if (log_size - offset < TCG_PCR_EVENT_HEADER_SIZE) {
+        return TCG_LOG_ERR_TRUNCATED;
+    }
+
+    const uint8_t *p = log + offset;
+    uint32_t event_size = read_le32(p + 28);
+    if (log_size - offset - TCG_PCR_EVENT_HEADER_SIZE < event_size) {
+        return TCG_LOG_ERR_TRUNCATED;
+    }
+
+    view->offset = offset;
+    view->length = TCG_PCR_EVENT_HEADER_SIZE + (size_t)event_size;
+    view->pcr_index = read_le32(p);
+    view->event_type = read_le32(p + 4);
+    view->digest_count = 1;
+    view->digests[0].alg = TPM2_ALG_SHA1;
+    view->digests[0].size = TPM2_SHA1_DIGEST_SIZE;
+    view->digests[0].digest = p + 8;
+    view->event_data = p + TCG_PCR_EVENT_HEADER_SIZE;
+    view->event_size = event_size;
+    view->content = TCG_CONTENT_PCCLIENT;
+    view->template_name = NULL;
+    view->template_name_len = 0;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Decodes a TCG_PCR_EVENT2 record at the given offset using the cursor's digest size table.
+ */
+static TCG_LogStatus read_event2(const TCG_EventLogCursor *cursor, size_t offset, TCG_EventView *view) {
+    const uint8_t *log = cursor->log;
+    size_t remaining = cursor->log_size - offset;
+
+    // pcrIndex + eventType + TPML_DIGEST_VALUES.count
+    if (remaining < 12) {
+        return TCG_LOG_ERR_TRUNCATED;
+    }
+
+    const uint8_t *p = log + offset;
+    uint32_t digest_count = read_le32(p + 8);
+    if (digest_count > TCG_MAX_DIGEST_BANKS) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+
+    size_t pos = 12;
+    for (uint32_t i = 0; i < digest_count; i++) {
+        if (remaining - pos < 2) {
+            return TCG_LOG_ERR_TRUNCATED;
+        }
+        TPM2_ALG_ID alg = read_le16(p + pos);
+        uint16_t size = tcg_log_digest_size(cursor, alg);
+        if (size == 0) {
+            return TCG_LOG_ERR_UNKNOWN_ALG;
+        }
+        pos += 2;
+        if (remaining - pos < size) {
+            return TCG_LOG_ERR_TRUNCATED;
+        }
+        view->digests[i].alg = alg;
+        view->digests[i].size = size;
+        view->digests[i].digest = p + pos;
+        pos += size;
+    }
+
+    if (remaining - pos < 4) {
+        return TCG_LOG_ERR_TRUNCATED;
+    }
+    uint32_t event_size = read_le32(p + pos);
+    pos += 4;
+    if (remaining - pos < event_size) {
+        return TCG_LOG_ERR_TRUNCATED;
+    }
+
+    view->offset = offset;
+    view->length = pos + event_size;
+    view->pcr_index = read_le32(p);
+    view->event_type = read_le32(p + 4);
+    view->digest_count = digest_count;
+    view->event_data = p + pos;
+    view->event_size = event_size;
+    view->content = TCG_CONTENT_PCCLIENT;
+    view->template_name = NULL;
+    view->template_name_len = 0;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Reads one TLV of a CEL stream.
+ *
+ * A top-level TLV running past the end of the log is truncated, as a record still being written is; a nested TLV
+ * running past the value it is nested in is malformed.
+ */
+static TCG_LogStatus read_tlv(const uint8_t **p, const uint8_t *end, bool nested, uint8_t *type,
+                              const uint8_t **value, uint32_t *length) {
+    TCG_LogStatus short_status = nested ? TCG_LOG_ERR_FORMAT : TCG_LOG_ERR_TRUNCATED;
+    if ((size_t)(end - *p) < TCG_CEL_TLV_HEADER_SIZE) {
+        return short_status;
+    }
+    *type = (*p)[0];
+    *length = read_be32(*p + 1);
+    if ((size_t)(end - *p) - TCG_CEL_TLV_HEADER_SIZE < *length) {
+        return short_status;
+    }
+    *value = *p + TCG_CEL_TLV_HEADER_SIZE;
+    *p = *value + *length;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Reads a nested TLV of an expected type.
+ */
+static TCG_LogStatus read_nested(const uint8_t **p, const uint8_t *end, uint8_t expected_type, const uint8_t **value,
+                                 uint32_t *length) {
+    uint8_t type;
+    if (read_tlv(p, end, true, &type, value, length) != TCG_LOG_OK || type != expected_type) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Decodes the digests TLV of a CEL record: one nested TLV per bank, typed by its algorithm.
+ *
+ * Until the cursor has banks (while tcg_log_cursor_init() reads the first record), any supported digest size is
+ * accepted; afterwards every digest must be of a bank of the first record, and of its size.
+ */
+static TCG_LogStatus read_cel_digests(const TCG_EventLogCursor *cursor, const uint8_t *p, const uint8_t *end,
+                                      TCG_EventView *view) {
+    uint32_t count = 0;
+    while (p < end) {
+        uint8_t type;
+        const uint8_t *digest;
+        uint32_t size;
+        if (count == TCG_MAX_DIGEST_BANKS || read_tlv(&p, end, true, &type, &digest, &size) != TCG_LOG_OK ||
+            size == 0 || size > sizeof(TPMU_HA)) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        if (cursor->bank_count > 0) {
+            uint16_t bank_size = tcg_log_digest_size(cursor, type);
+            if (bank_size == 0) {
+                return TCG_LOG_ERR_UNKNOWN_ALG;
+            }
+            if (bank_size != size) {
+                return TCG_LOG_ERR_FORMAT;
+            }
+        }
+        view->digests[count].alg = type;
+        view->digests[count].size = (uint16_t)size;
+        view->digests[count].digest = digest;
+        count++;
+    }
+    view->digest_count = count;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Decodes a CEL-TLV record at the given offset: recnum, pcr, digests and content TLVs.
+ *
+ * The recnum must be the record's position in the stream, so records cannot be dropped or reordered unnoticed.
+ * Records extending NV indices and management records are not accepted.
+ */
+static TCG_LogStatus read_cel_event(const TCG_EventLogCursor *cursor, size_t offset, TCG_EventView *view) {
+    const uint8_t *start = cursor->log + offset;
+    const uint8_t *end = cursor->log + cursor->log_size;
+    const uint8_t *p = start;
+    const uint8_t *value;
+    uint32_t length;
+    uint8_t type;
+    TCG_LogStatus status;
+
+    if ((status = read_tlv(&p, end, false, &type, &value, &length)) != TCG_LOG_OK) {
+        return status;
+    }
+    if (type != TCG_CEL_TYPE_RECNUM || length != TCG_CEL_RECNUM_SIZE || read_be64(value) != cursor->record_num) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    if ((status = read_tlv(&p, end, false, &type, &value, &length)) != TCG_LOG_OK) {
+        return status;
+    }
+    if (type != TCG_CEL_TYPE_PCR || length != 4) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    view->pcr_index = read_be32(value);
+
+    if ((status = read_tlv(&p, end, false, &type, &value, &length)) != TCG_LOG_OK) {
+        return status;
+    }
+    if (type != TCG_CEL_TYPE_DIGESTS) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    if ((status = read_cel_digests(cursor, value, value + length, view)) != TCG_LOG_OK) {
+        return status;
+    }
+
+    if ((status = read_tlv(&p, end, false, &type, &value, &length)) != TCG_LOG_OK) {
+        return status;
+    }
+    const uint8_t *content_end = value + length;
+    const uint8_t *field;
+    uint32_t field_size;
+    if (type == TCG_CEL_TYPE_PCCLIENT_STD) {
+        if (read_nested(&value, content_end, TCG_CEL_PCCLIENT_EVENT_TYPE, &field, &field_size) != TCG_LOG_OK ||
+            field_size != 4) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        view->event_type = read_be32(field);
+        if (read_nested(&value, content_end, TCG_CEL_PCCLIENT_EVENT_DATA, &field, &field_size) != TCG_LOG_OK) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        view->content = TCG_CONTENT_PCCLIENT;
+        view->template_name = NULL;
+        view->template_name_len = 0;
+    } else if (type == TCG_CEL_TYPE_IMA_TEMPLATE) {
+        if (read_nested(&value, content_end, TCG_CEL_IMA_TEMPLATE_NAME, &field, &field_size) != TCG_LOG_OK) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        view->template_name = (const char *)field;
+        view->template_name_len = field_size;
+        if (read_nested(&value, content_end, TCG_CEL_IMA_TEMPLATE_DATA, &field, &field_size) != TCG_LOG_OK) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        view->event_type = 0;
+        view->content = TCG_CONTENT_IMA_TEMPLATE;
+    } else {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    if (value != content_end) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+
+    view->offset = offset;
+    view->length = (size_t)(p - start);
+    view->event_data = field;
+    view->event_size = field_size;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Tells a CEL-TLV stream from a PC Client log by its first bytes.
+ *
+ * Both start with a zero byte. A CEL stream continues with a recnum length of 8, a recnum of 0 and a pcr TLV; a
+ * PC Client log would need a first event type of 8 and a digest starting with 00 00 00 00 00 01 00 00 00 04.
+ */
+static bool is_cel_stream(const uint8_t *log, size_t log_size) {
+    static const uint8_t pcr_tlv[] = { TCG_CEL_TYPE_PCR, 0, 0, 0, 4 };
+    size_t recnum_size = TCG_CEL_TLV_HEADER_SIZE + TCG_CEL_RECNUM_SIZE;
+    if (log_size < recnum_size + sizeof(pcr_tlv) || log[0] != TCG_CEL_TYPE_RECNUM ||
+        read_be32(log + 1) != TCG_CEL_RECNUM_SIZE || read_be64(log + TCG_CEL_TLV_HEADER_SIZE) != 0) {
+        return false;
+    }
+    return memcmp(log + recnum_size, pcr_tlv, sizeof(pcr_tlv)) == 0;
+}
+
+/**
+ * @brief Takes the banks of a CEL stream from the digests of its first record.
+ */
+static TCG_LogStatus read_cel_header(TCG_EventLogCursor *cursor) {
+    TCG_EventView header;
+    cursor->bank_count = 0;
+    TCG_LogStatus status = read_cel_event(cursor, 0, &header);
+    if (status != TCG_LOG_OK) {
+        return status;
+    }
+    if (header.digest_count == 0) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+    for (uint32_t i = 0; i < header.digest_count; i++) {
+        if (tcg_log_digest_size(cursor, header.digests[i].alg) != 0) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+        cursor->banks[i].alg = header.digests[i].alg;
+        cursor->banks[i].size = header.digests[i].size;
+        cursor->bank_count = i + 1;
+    }
+    cursor->crypto_agile = true;
+    cursor->cel = true;
+    return TCG_LOG_OK;
+}
+
+/**
+ * @brief Parses the Spec ID Event03 structure carried in the first event's data.
+ *
+ * @return TCG_LOG_OK if the header was found and loaded, TCG_LOG_END if the event is not a Spec ID event,
+ *         or a negative TCG_LogStatus if the header is malformed.
+ */
+static TCG_LogStatus read_spec_id_event(TCG_EventLogCursor *cursor, const TCG_EventView *header) {
+    const uint8_t *data = header->event_data;
+    size_t size = header->event_size;
+
+    if (header->event_type != TCG_EV_NO_ACTION || size < sizeof(TCG_SPEC_ID_SIGNATURE) ||
+        memcmp(data, TCG_SPEC_ID_SIGNATURE, sizeof(TCG_SPEC_ID_SIGNATURE)) != 0) {
+        return TCG_LOG_END;
+    }
+    if (size < TCG_SPEC_ID_FIXED_SIZE) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+
+    uint32_t alg_count = read_le32(data + 24);
+    if (alg_count == 0 || alg_count > TCG_MAX_DIGEST_BANKS ||
+        (size - TCG_SPEC_ID_FIXED_SIZE) / 4 < alg_count) {
+        return TCG_LOG_ERR_FORMAT;
+    }
+
+    const uint8_t *entry = data + TCG_SPEC_ID_FIXED_SIZE;
+    for (uint32_t i = 0; i < alg_count; i++, entry += 4) {
+        cursor->banks[i].alg = read_le16(entry);
+        cursor->banks[i].size = read_le16(entry + 2);
+        if (cursor->banks[i].size == 0 || cursor->banks[i].size > sizeof(TPMU_HA)) {
+            return TCG_LOG_ERR_FORMAT;
+        }
+    }
+    cursor->bank_count = alg_count;
+    cursor->crypto_agile = true;
+    return TCG_LOG_OK;
+}
+
+TCG_LogStatus tcg_log_cursor_init(TCG_EventLogCursor *cursor, const uint8_t *log, size_t log_size) {
+    if (!cursor || (!log && log_size != 0)) {
+        return TCG_LOG_ERR_INVALID;
+    }
+
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->log = log;
+    cursor->log_size = log_size;
+
+    // Both formats start with a legacy TCG_PCR_EVENT; whether it is a Spec ID header decides the rest.
+    cursor->bank_count = 1;
+    cursor->banks[0].alg = TPM2_ALG_SHA1;
+    cursor->banks[0].size = TPM2_SHA1_DIGEST_SIZE;
+    if (log_size == 0) {
+        return TCG_LOG_OK;
+    }
+    if (is_cel_stream(log, log_size)) {
+        return read_cel_header(cursor);
+    }
+
+    TCG_EventView header;
+    TCG_LogStatus status = read_legacy_event(log, log_size, 0, &header);
+    if (status != TCG_LOG_OK) {
+        return status;
+    }
+
+    status = read_spec_id_event(cursor, &header);
+    return status == TCG_LOG_END ? TCG_LOG_OK : status;
+}
+
+TCG_LogStatus tcg_log_cursor_next(TCG_EventLogCursor *cursor, TCG_EventView *view) {
+    if (!cursor || !view) {
+        return TCG_LOG_ERR_INVALID;
+    }
+    if (cursor->offset >= cursor->log_size) {
+        return TCG_LOG_END;
+    }
+
+    TCG_LogStatus status;
+    if (cursor->cel) {
+        status = read_cel_event(cursor, cursor->offset, view);
+    } else if (!cursor->crypto_agile || cursor->record_num == 0) {
+        status = read_legacy_event(cursor->log, cursor->log_size, cursor->offset, view);
+    } else {
+        status = read_event2(cursor, cursor->offset, view);
+    }
+    if (status != TCG_LOG_OK) {
+        return status;
+    }
+
+    cursor->offset += view->length;
+    view->record_num = ++cursor->record_num;
+    return TCG_LOG_OK;
+}
+
+TCG_LogStatus tcg_log_cursor_seek(TCG_EventLogCursor *cursor, size_t offset, size_t record_num) {
+    if (!cursor || offset > cursor->log_size || (offset == 0) != (record_num == 0)) {
+        return TCG_LOG_ERR_INVALID;
+    }
+    cursor->offset = offset;
+    cursor->record_num = record_num;
+    return TCG_LOG_OK;
+}
+
+uint16_t tcg_log_digest_size(const TCG_EventLogCursor *cursor, TPM2_ALG_ID alg) {
+    for (uint32_t i = 0; i < cursor->bank_count; i++) {
+        if (cursor->banks[i].alg == alg) {
+            return cursor->banks[i].size;
+        }
+    }
+    return 0;
+}
+
+const TCG_DigestView *tcg_event_find_digest(const TCG_EventView *view, TPM2_ALG_ID alg) {
+    for (uint32_t i = 0; i < view->digest_count; i++) {
+        if (view->digests[i].alg == alg) {
+            return &view->digests[i];
+        }
+    }
+    return NULL;
+}
+
+const char *tcg_log_status_str(TCG_LogStatus status) {
+    switch (status) {
+        case TCG_LOG_OK:              return "ok";
+        case TCG_LOG_END:             return "end of log";
+        case TCG_LOG_ERR_INVALID:     return "invalid argument";
+        case TCG_LOG_ERR_TRUNCATED:   return "truncated record";
+        case TCG_LOG_ERR_FORMAT:      return "malformed record";
+        case TCG_LOG_ERR_UNKNOWN_ALG: return "digest algorithm not in log header";
+        default:                      return "unknown status";
+    }
+}
@@ -0,0 +1,346 @@
+// ima_log_parser.c
+// Streaming parser for Linux IMA runtime measurement logs (binary_runtime_measurements). A file is read through a
+// fixed chunk buffer, so memory does not grow with the log; a log in memory is parsed in place.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ima_log_parser.h"
+
+#define IMA_LEGACY_DIGEST_SIZE 20       // "d" field of the "ima" template: a SHA-1 file digest
+
+// Little-endian reader; the kernel writes the binary log in the host's byte order, which every supported target
+// shares.
+static inline uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t ima_digest_size(TPM2_ALG_ID bank) {
+    switch (bank) {
+        case TPM2_ALG_SHA1:   return TPM2_SHA1_DIGEST_SIZE;
+        case TPM2_ALG_SHA256: return TPM2_SHA256_DIGEST_SIZE;
+        case TPM2_ALG_SHA384: return TPM2_SHA384_DIGEST_SIZE;
+        case TPM2_ALG_SHA512: return TPM2_SHA512_DIGEST_SIZE;
+        default:              return 0;
+    }
+}
+
+/**
+ * @brief Maps the hash name the kernel prefixes to a d-ng digest ("sha256:") to its TPM algorithm.
+ */
+static TPM2_ALG_ID file_digest_alg(const char *name, size_t name_len) {
+    static const struct {
+        const char *name;
+        TPM2_ALG_ID alg;
+    } algs[] = {
+        { "sha1", TPM2_ALG_SHA1 },
+        { "sha256", TPM2_ALG_SHA256 },
+        { "sha384", TPM2_ALG_SHA384 },
+        { "sha512", TPM2_ALG_SHA512 },
+        { "sm3", TPM2_ALG_SM3_256 },
+        { "sm3-256", TPM2_ALG_SM3_256 },
+    };
+    for (size_t i = 0; i < sizeof(algs) / sizeof(algs[0]); i++) {
+        if (strlen(algs[i].name) == name_len && memcmp(algs[i].name, name, name_len) == 0) {
+            return algs[i].alg;
+        }
+    }
+    return TPM2_ALG_ERROR;
+}
+
+static IMA_Template template_kind(const char *name, uint32_t name_len) {
+    static const struct {
+        const char *name;
+        IMA_Template kind;
+    } templates[] = {
+        { "ima", IMA_TEMPLATE_IMA },
+        { "ima-ng", IMA_TEMPLATE_IMA_NG },
+        { "ima-sig", IMA_TEMPLATE_IMA_SIG },
+        { "ima-buf", IMA_TEMPLATE_IMA_BUF },
+        { "ima-modsig", IMA_TEMPLATE_IMA_MODSIG },
+    };
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        if (strlen(templates[i].name) == name_len && memcmp(templates[i].name, name, name_len) == 0) {
+            return templates[i].kind;
+        }
+    }
+    return IMA_TEMPLATE_OTHER;
+}
+
+/**
+ * @brief Reads the next length-prefixed field of ng template data.
+ */
+static IMA_LogStatus next_field(const uint8_t **p, const uint8_t *end, const uint8_t **field, uint32_t *field_size) {
+    if (end - *p < 4) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    uint32_t size = read_le32(*p);
+    if ((size_t)(end - *p - 4) < size) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    *field = *p + 4;
+    *field_size = size;
+    *p += 4 + (size_t)size;
+    return IMA_LOG_OK;
+}
+
+/**
+ * @brief Decodes the file digest, name and signature of a known template.
+ */
+static IMA_LogStatus decode_template_data(IMA_EventView *event) {
+    const uint8_t *data = event->template_data;
+
+    if (event->template_kind == IMA_TEMPLATE_IMA) {
+        // Sized by ima_log_reader_next(): digest, name length, name without terminator
+        event->file_digest_alg = TPM2_ALG_SHA1;
+        event->file_digest = data;
+        event->file_digest_size = IMA_LEGACY_DIGEST_SIZE;
+        event->file_name = (const char *)data + IMA_LEGACY_DIGEST_SIZE + 4;
+        event->file_name_len = event->template_data_size - IMA_LEGACY_DIGEST_SIZE - 4;
+        return IMA_LOG_OK;
+    }
+    if (event->template_kind == IMA_TEMPLATE_OTHER) {
+        return IMA_LOG_OK;
+    }
+
+    const uint8_t *p = data;
+    const uint8_t *end = data + event->template_data_size;
+    const uint8_t *field;
+    uint32_t field_size;
+
+    // d-ng: "<hash name>:\0" followed by the digest
+    if (next_field(&p, end, &field, &field_size) != IMA_LOG_OK) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    const uint8_t *colon = memchr(field, ':', field_size);
+    if (!colon || (size_t)(field + field_size - colon) < 2 || colon[1] != '\0') {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    event->file_digest_alg = file_digest_alg((const char *)field, (size_t)(colon - field));
+    event->file_digest = colon + 2;
+    event->file_digest_size = (uint16_t)(field + field_size - event->file_digest);
+
+    // n-ng: the name with its terminator
+    if (next_field(&p, end, &field, &field_size) != IMA_LOG_OK) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    event->file_name = (const char *)field;
+    event->file_name_len = (uint32_t)strnlen(event->file_name, field_size);
+
+    if (event->template_kind == IMA_TEMPLATE_IMA_SIG || event->template_kind == IMA_TEMPLATE_IMA_MODSIG) {
+        if (next_field(&p, end, &field, &field_size) != IMA_LOG_OK) {
+            return IMA_LOG_ERR_FORMAT;
+        }
+        event->signature = field_size ? field : NULL;
+        event->signature_size = field_size;
+    }
+    return IMA_LOG_OK;
+}
+
+IMA_LogStatus ima_template_decode(IMA_EventView *event) {
+    if (!event || (!event->template_data && event->template_data_size != 0)) {
+        return IMA_LOG_ERR_INVALID;
+    }
+    event->template_kind = template_kind(event->template_name, event->template_name_len);
+    event->file_digest_alg = TPM2_ALG_ERROR;
+    event->file_digest = NULL;
+    event->file_digest_size = 0;
+    event->file_name = NULL;
+    event->file_name_len = 0;
+    event->signature = NULL;
+    event->signature_size = 0;
+
+    // The "ima" template data is sized by its name length, which the reader checks as it reads the entry
+    if (event->template_kind == IMA_TEMPLATE_IMA &&
+        (event->template_data_size < IMA_LEGACY_DIGEST_SIZE + 4 ||
+         read_le32(event->template_data + IMA_LEGACY_DIGEST_SIZE) !=
+             event->template_data_size - IMA_LEGACY_DIGEST_SIZE - 4 ||
+         event->template_data_size - IMA_LEGACY_DIGEST_SIZE - 4 >= IMA_LEGACY_NAME_SIZE)) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+    return decode_template_data(event);
+}
+
+/**
+ * @brief Makes at least needed bytes available, reading more of the file if the reader has one.
+ *
+ * Unparsed bytes are moved to the start of the buffer first, so pointers into the buffer taken before the call
+ * are invalid after it.
+ */
+static IMA_LogStatus ensure_available(IMA_LogReader *reader, size_t needed) {
+    if (reader->available >= needed) {
+        return IMA_LOG_OK;
+    }
+    if (reader->fd < 0 || reader->eof) {
+        return IMA_LOG_ERR_TRUNCATED;
+    }
+    if (needed > IMA_LOG_READER_BUFFER_SIZE) {
+        return IMA_LOG_ERR_TOO_LARGE;
+    }
+
+    if (reader->data != reader->buffer) {
+        memmove(reader->buffer, reader->data, reader->available);
+        reader->data = reader->buffer;
+    }
+    while (reader->available < needed) {
+        ssize_t n = read(reader->fd, reader->buffer + reader->available,
+                         IMA_LOG_READER_BUFFER_SIZE - reader->available);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return IMA_LOG_ERR_IO;
+        }
+        if (n == 0) {
+            reader->eof = true;
+            return IMA_LOG_ERR_TRUNCATED;
+        }
+        reader->available += (size_t)n;
+    }
+    return IMA_LOG_OK;
+}
+
+IMA_LogStatus ima_log_reader_open(IMA_LogReader *reader, const char *filename, TPM2_ALG_ID bank) {
+    if (!reader || !filename || ima_digest_size(bank) == 0) {
+        return IMA_LOG_ERR_INVALID;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    reader->digest_size = ima_digest_size(bank);
+    reader->buffer = malloc(IMA_LOG_READER_BUFFER_SIZE);
+    if (!reader->buffer) {
+        fprintf(stderr, "Error allocating memory for IMA log buffer\n");
+        return IMA_LOG_ERR_IO;
+    }
+    reader->fd = open(filename, O_RDONLY);
+    if (reader->fd < 0) {
+        free(reader->buffer);
+        reader->buffer = NULL;
+        return IMA_LOG_ERR_IO;
+    }
+    reader->owns_fd = true;
+    reader->data = reader->buffer;
+    return IMA_LOG_OK;
+}
+
+IMA_LogStatus ima_log_reader_init_buffer(IMA_LogReader *reader, const uint8_t *log, size_t log_size,
+                                         TPM2_ALG_ID bank) {
+    if (!reader || (!log && log_size > 0) || ima_digest_size(bank) == 0) {
+        return IMA_LOG_ERR_INVALID;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    reader->eof = true;
+    reader->digest_size = ima_digest_size(bank);
+    reader->data = log;
+    reader->available = log_size;
+    return IMA_LOG_OK;
+}
+
+IMA_LogStatus ima_log_reader_next(IMA_LogReader *reader, IMA_EventView *event) {
+    if (!reader || !event) {
+        return IMA_LOG_ERR_INVALID;
+    }
+
+    // A log ends cleanly only between entries.
+    IMA_LogStatus status = ensure_available(reader, 1);
+    if (status == IMA_LOG_ERR_TRUNCATED && reader->available == 0) {
+        return IMA_LOG_END;
+    }
+    if (status != IMA_LOG_OK) {
+        return status;
+    }
+
+    // pcr, template digest, template name length
+    size_t digest_size = reader->digest_size;
+    size_t header_size = 4 + digest_size + 4;
+    if ((status = ensure_available(reader, header_size)) != IMA_LOG_OK) {
+        return status;
+    }
+    uint32_t name_len = read_le32(reader->data + 4 + digest_size);
+    if (name_len == 0 || name_len > IMA_TEMPLATE_NAME_MAX) {
+        return IMA_LOG_ERR_FORMAT;
+    }
+
+    // The data of the "ima" template has no overall length: a SHA-1 digest, then a length-prefixed name.
+    // The other templates prefix their data with its length.
+    size_t length = header_size + name_len;
+    if ((status = ensure_available(reader, length + 4)) != IMA_LOG_OK) {
+        return status;
+    }
+    IMA_Template kind = template_kind((const char *)reader->data + header_size, name_len);
+    size_t data_size;
+    if (kind == IMA_TEMPLATE_IMA) {
+        if ((status = ensure_available(reader, length + IMA_LEGACY_DIGEST_SIZE + 4)) != IMA_LOG_OK) {
+            return status;
+        }
+        uint32_t file_name_len = read_le32(reader->data + length + IMA_LEGACY_DIGEST_SIZE);
+        if (file_name_len >= IMA_LEGACY_NAME_SIZE) {
+            return IMA_LOG_ERR_FORMAT;
+        }
+        data_size = IMA_LEGACY_DIGEST_SIZE + 4 + (size_t)file_name_len;
+    } else {
+        data_size = read_le32(reader->data + length);
+        length += 4;
+    }
+    if (data_size > IMA_LOG_READER_BUFFER_SIZE) {
+        return IMA_LOG_ERR_TOO_LARGE;
+    }
+    if ((status = ensure_available(reader, length + data_size)) != IMA_LOG_OK) {
+        return status;
+    }
+
+    const uint8_t *p = reader->data;
+    memset(event, 0, sizeof(*event));
+    event->record_num = reader->record_num + 1;
+    event->offset = reader->offset;
+    event->length = length + data_size;
+    event->pcr_index = read_le32(p);
+    event->template_digest = p + 4;
+    event->template_digest_size = (uint16_t)digest_size;
+    event->template_name = (const char *)p + header_size;
+    event->template_name_len = name_len;
+    event->template_kind = kind;
+    event->template_data = p + length;
+    event->template_data_size = (uint32_t)data_size;
+    event->file_digest_alg = TPM2_ALG_ERROR;
+    if ((status = decode_template_data(event)) != IMA_LOG_OK) {
+        return status;
+    }
+
+    reader->data += event->length;
+    reader->available -= event->length;
+    reader->offset += event->length;
+    reader->record_num++;
+    return IMA_LOG_OK;
+}
+
+void ima_log_reader_close(IMA_LogReader *reader) {
+    if (!reader) {
+        return;
+    }
+    if (reader->owns_fd && reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+const char *ima_log_status_str(IMA_LogStatus status) {
+    switch (status) {
+        case IMA_LOG_OK:            return "ok";
+        case IMA_LOG_END:           return "end of log";
+        case IMA_LOG_ERR_INVALID:   return "invalid argument";
+        case IMA_LOG_ERR_TRUNCATED: return "truncated entry";
+        case IMA_LOG_ERR_FORMAT:    return "malformed entry";
+        case IMA_LOG_ERR_TOO_LARGE: return "entry larger than the read buffer";
+        case IMA_LOG_ERR_IO:        return "read error";
+        default:                    return "unknown status";
+    }
+}
@@ -0,0 +1,90 @@
+// cel_encoder.h
+#ifndef CEL_ENCODER_H
+#define CEL_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/evp.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "event_log_parser.h"
+#include "ima_log_parser.h"
+
+// Structures
+
+/**
+ * @struct CEL_Encoder
+ * @brief Encodes firmware and IMA measurements into one Canonical Event Log TLV stream.
+ *
+ * PC Client records keep their event type and data (pcclient_std content), IMA entries their template name and
+ * data (ima_template content). Every record carries a digest for each bank of the stream, the value the TPM
+ * extended, so tcg_log_cursor_next() and the PCR replay engine read the stream as they read the PC Client log it
+ * started from. Records are numbered from 0 across both sources, in the order they are encoded.
+ *
+ * Encoded records accumulate in data; the caller consumes data[0 .. size) and sets size back to 0.
+ */
+typedef struct {
+    uint8_t *data;                                  /**< Encoded records not yet consumed */
+    size_t size;                                    /**< Bytes in data */
+    size_t capacity;                                /**< Allocated size of data */
+    uint64_t next_recnum;                           /**< recnum of the next record */
+    uint32_t bank_count;                            /**< Banks every record carries a digest for */
+    TCG_DigestSize banks[TCG_MAX_DIGEST_BANKS];     /**< Banks, in the order of the PC Client log's header */
+    EVP_MD *mds[TCG_MAX_DIGEST_BANKS];              /**< Digest of each bank, for IMA template digests */
+    EVP_MD_CTX *ctx;                                /**< Context the template digests are computed with */
+} CEL_Encoder;
+
+// Function Prototypes
+
+/**
+ * @brief Prepares an encoder for the banks of a PC Client log.
+ *
+ * @param[out] encoder  Encoder to initialize; release it with cel_encoder_free().
+ * @param[in]  cursor   Cursor initialized over the PC Client log whose banks the stream keeps.
+ *
+ * @return Returns 0 on success, or -1 if a bank's algorithm is not supported.
+ */
+int cel_encoder_init(CEL_Encoder *encoder, const TCG_EventLogCursor *cursor);
+
+/**
+ * @brief Releases an encoder. Safe on an encoder that failed to initialize.
+ */
+void cel_encoder_free(CEL_Encoder *encoder);
+
+/**
+ * @brief Appends a PC Client record.
+ *
+ * EV_NO_ACTION events are not extended and get zero digests in every bank; the Spec ID event that starts a PC
+ * Client log thereby becomes a first record declaring every bank of the stream.
+ *
+ * @return Returns 0 on success, or -1 if an extended event lacks a digest for one of the banks.
+ */
+int cel_encode_tcg_event(CEL_Encoder *encoder, const TCG_EventView *event);
+
+/**
+ * @brief Appends an IMA entry.
+ *
+ * The template digest of the IMA log's bank is taken from the entry; those of the other banks are computed from
+ * the template data, as the kernel computes them. A violation gets all-ones digests, the value the kernel extends
+ * in place of the zeros it logs.
+ *
+ * @param[in,out] encoder   Encoder.
+ * @param[in]     event     Entry read from the IMA log.
+ * @param[in]     ima_bank  Bank of the IMA log the entry was read from.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int cel_encode_ima_event(CEL_Encoder *encoder, const IMA_EventView *event, TPM2_ALG_ID ima_bank);
+
+/**
+ * @brief Encodes a whole PC Client log as a CEL-TLV stream.
+ *
+ * @param[in]  log       PC Client event log.
+ * @param[in]  log_size  Size of the log.
+ * @param[out] cel       Encoded stream; the caller frees it.
+ * @param[out] cel_size  Size of the stream.
+ *
+ * @return Returns 0 on success, or -1 if the log is malformed or cannot be encoded.
+ */
+int cel_encode_log(const uint8_t *log, size_t log_size, uint8_t **cel, size_t *cel_size);
+
+#endif // CEL_ENCODER_H
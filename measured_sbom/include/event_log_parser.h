@@ -0,0 +1,195 @@
+// event_log_parser.h
+#ifndef EVENT_LOG_PARSER_H
+#define EVENT_LOG_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+// Constants
+
+#define TCG_MAX_DIGEST_BANKS 8          /**< Maximum number of digest banks tracked per log */
+#define TCG_SPEC_ID_SIGNATURE "Spec ID Event03"
+
+// Event types used by the parser and its consumers (TCG PC Client PFP, section 10.4.1)
+#define TCG_EV_POST_CODE            0x00000001
+#define TCG_EV_NO_ACTION            0x00000003
+#define TCG_EV_SEPARATOR            0x00000004
+#define TCG_EV_ACTION               0x00000005
+#define TCG_EV_EVENT_TAG            0x00000006
+#define TCG_EV_S_CRTM_CONTENTS      0x00000007
+#define TCG_EV_IPL                  0x0000000D
+#define TCG_EV_EFI_VARIABLE_DRIVER_CONFIG 0x80000001
+#define TCG_EV_EFI_VARIABLE_BOOT    0x80000002
+#define TCG_EV_EFI_BOOT_SERVICES_APPLICATION 0x80000003
+#define TCG_EV_EFI_ACTION           0x80000007
+
+// Canonical Event Log TLV encoding (TCG CEL 1.0): a 1-byte type, a 4-byte big-endian length and the value. A record
+// is a recnum, a pcr, a digests and a content TLV, in that order; integers are big-endian.
+#define TCG_CEL_TLV_HEADER_SIZE     5
+#define TCG_CEL_RECNUM_SIZE         8   /**< recnum is a UINT64, counted from 0 */
+#define TCG_CEL_TYPE_RECNUM         0
+#define TCG_CEL_TYPE_PCR            1
+#define TCG_CEL_TYPE_NV_INDEX       2
+#define TCG_CEL_TYPE_DIGESTS        3   /**< Nested TLVs typed by TPM_ALG_ID, one per bank */
+#define TCG_CEL_TYPE_MGMT           4
+#define TCG_CEL_TYPE_PCCLIENT_STD   5   /**< Nested event_type (UINT32) and event_data */
+#define TCG_CEL_TYPE_IMA_TEMPLATE   7   /**< Nested template_name and template_data */
+#define TCG_CEL_PCCLIENT_EVENT_TYPE 0
+#define TCG_CEL_PCCLIENT_EVENT_DATA 1
+#define TCG_CEL_IMA_TEMPLATE_NAME   0
+#define TCG_CEL_IMA_TEMPLATE_DATA   1
+
+// Enumerations
+
+/**
+ * @enum TCG_LogStatus
+ * @brief Result of a cursor operation.
+ */
+typedef enum {
+    TCG_LOG_OK = 0,                 /**< A record was decoded into the view */
+    TCG_LOG_END = 1,                /**< No more records in the log */
+    TCG_LOG_ERR_INVALID = -1,       /**< NULL or otherwise invalid argument */
+    TCG_LOG_ERR_TRUNCATED = -2,     /**< A record runs past the end of the buffer */
+    TCG_LOG_ERR_FORMAT = -3,        /**< Malformed Spec ID header or record */
+    TCG_LOG_ERR_UNKNOWN_ALG = -4    /**< Digest algorithm not listed in the Spec ID header or first CEL record */
+} TCG_LogStatus;
+
+/**
+ * @enum TCG_EventContent
+ * @brief What the event data of a view holds.
+ */
+typedef enum {
+    TCG_CONTENT_PCCLIENT = 0,       /**< PC Client event data of event_type */
+    TCG_CONTENT_IMA_TEMPLATE = 1    /**< IMA template data of a CEL record, as in binary_runtime_measurements */
+} TCG_EventContent;
+
+// Structures
+
+/**
+ * @struct TCG_DigestSize
+ * @brief One entry of the Spec ID Event03 digest size table.
+ */
+typedef struct {
+    TPM2_ALG_ID alg;                /**< TPM2_ALG_SHA1, TPM2_ALG_SHA256, ... */
+    uint16_t size;                  /**< Digest size in bytes */
+} TCG_DigestSize;
+
+/**
+ * @struct TCG_DigestView
+ * @brief A digest of one bank, pointing into the log buffer.
+ */
+typedef struct {
+    TPM2_ALG_ID alg;                /**< Hash algorithm of this digest */
+    uint16_t size;                  /**< Digest size in bytes */
+    const uint8_t *digest;          /**< Digest bytes inside the log buffer */
+} TCG_DigestView;
+
+/**
+ * @struct TCG_EventView
+ * @brief Bounds-checked view of a single TCG_PCR_EVENT2 (or legacy TCG_PCR_EVENT, or CEL-TLV) record.
+ *
+ * All pointers reference the buffer the cursor was initialized with; nothing is copied or allocated.
+ * A view is valid for as long as that buffer is.
+ */
+typedef struct {
+    size_t record_num;              /**< 1-based record number, the Spec ID event is record 1 */
+    size_t offset;                  /**< Byte offset of the record in the log */
+    size_t length;                  /**< Total length of the record in bytes */
+    uint32_t pcr_index;             /**< PCR extended by this event */
+    uint32_t event_type;            /**< TCG event type; 0 for IMA template content */
+    uint32_t digest_count;          /**< Number of valid entries in digests */
+    TCG_DigestView digests[TCG_MAX_DIGEST_BANKS]; /**< Per-bank digests */
+    const uint8_t *event_data;      /**< Event data inside the log buffer */
+    uint32_t event_size;            /**< Size of the event data in bytes */
+    TCG_EventContent content;       /**< Kind of event data */
+    const char *template_name;      /**< IMA template name, not NUL-terminated; NULL for PC Client content */
+    uint32_t template_name_len;     /**< Length of the template name */
+} TCG_EventView;
+
+/**
+ * @struct TCG_EventLogCursor
+ * @brief Streaming cursor over an in-memory PC Client event log or CEL-TLV stream.
+ *
+ * The Spec ID digest size table is read once by tcg_log_cursor_init(); subsequent calls to
+ * tcg_log_cursor_next() walk the records in a single linear pass. A CEL-TLV stream has no Spec ID header: its
+ * banks are those its first record carries digests for, and every record is decoded from its own TLVs without
+ * looking ahead.
+ */
+typedef struct {
+    const uint8_t *log;             /**< Start of the event log */
+    size_t log_size;                /**< Size of the event log in bytes */
+    size_t offset;                  /**< Offset of the next record */
+    size_t record_num;              /**< Number of records returned so far */
+    bool crypto_agile;              /**< true for TCG_PCR_EVENT2 logs and CEL streams, false for legacy SHA-1 logs */
+    bool cel;                       /**< true for a CEL-TLV stream */
+    uint32_t bank_count;            /**< Number of entries in banks */
+    TCG_DigestSize banks[TCG_MAX_DIGEST_BANKS]; /**< Digest sizes from the Spec ID header */
+} TCG_EventLogCursor;
+
+// Function Prototypes
+
+/**
+ * @brief Initializes a cursor over an event log buffer.
+ *
+ * Reads the leading TCG_PCR_EVENT and, if it carries a Spec ID Event03 header, the digest size table that
+ * describes the TCG_PCR_EVENT2 records which follow. Logs without that header are treated as legacy SHA-1 logs.
+ * A log starting with a CEL recnum TLV of 0 followed by a pcr TLV is a CEL-TLV stream, whose digest sizes come
+ * from the digests of its first record. The header record itself is returned as the first event by
+ * tcg_log_cursor_next().
+ *
+ * @param[out] cursor    Cursor to initialize.
+ * @param[in]  log       Event log buffer. Must outlive the cursor and every view it hands out.
+ * @param[in]  log_size  Size of the event log buffer.
+ *
+ * @return TCG_LOG_OK on success, or a negative TCG_LogStatus on failure.
+ */
+TCG_LogStatus tcg_log_cursor_init(TCG_EventLogCursor *cursor, const uint8_t *log, size_t log_size);
+
+/**
+ * @brief Decodes the next record of the log into a view.
+ *
+ * @param[in,out] cursor  Cursor positioned at the next record.
+ * @param[out]    view    View to fill.
+ *
+ * @return TCG_LOG_OK if a record was decoded, TCG_LOG_END at the end of the log,
+ *         or a negative TCG_LogStatus if the record is malformed. The cursor does not advance on error.
+ */
+TCG_LogStatus tcg_log_cursor_next(TCG_EventLogCursor *cursor, TCG_EventView *view);
+
+/**
+ * @brief Repositions an initialized cursor at a record boundary.
+ *
+ * Used to resume a log at a point recorded earlier (for example a verifier checkpoint) without re-walking the
+ * records before it. The offset must be one a previous pass over the same log reached; the record after it is
+ * decoded and bounds-checked as usual by tcg_log_cursor_next().
+ *
+ * @param[in,out] cursor      Cursor initialized over the log.
+ * @param[in]     offset      Byte offset of the next record to read.
+ * @param[in]     record_num  Number of records before that offset.
+ *
+ * @return TCG_LOG_OK on success, or TCG_LOG_ERR_INVALID if the position is outside the log.
+ */
+TCG_LogStatus tcg_log_cursor_seek(TCG_EventLogCursor *cursor, size_t offset, size_t record_num);
+
+/**
+ * @brief Returns the digest size for an algorithm listed in the cursor's Spec ID header.
+ *
+ * @return Digest size in bytes, or 0 if the algorithm is not present in the log.
+ */
+uint16_t tcg_log_digest_size(const TCG_EventLogCursor *cursor, TPM2_ALG_ID alg);
+
+/**
+ * @brief Finds the digest of a given bank in an event view.
+ *
+ * @return Pointer to the digest view, or NULL if the event carries no digest for that algorithm.
+ */
+const TCG_DigestView *tcg_event_find_digest(const TCG_EventView *view, TPM2_ALG_ID alg);
+
+/**
+ * @brief Returns a human-readable string for a TCG_LogStatus value.
+ */
+const char *tcg_log_status_str(TCG_LogStatus status);
+
+#endif // EVENT_LOG_PARSER_H
@@ -0,0 +1,148 @@
+// ima_log_parser.h
+#ifndef IMA_LOG_PARSER_H
+#define IMA_LOG_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+// Constants
+
+#define IMA_TEMPLATE_NAME_MAX 15            /**< Longest template name (IMA_TEMPLATE_NAME_LEN_MAX) */
+#define IMA_LEGACY_NAME_SIZE 256            /**< Name field the "ima" template hash covers, NUL-padded */
+#define IMA_LOG_READER_BUFFER_SIZE 65536    /**< Bytes a streaming reader holds; the largest entry it accepts */
+#define IMA_BOOT_AGGREGATE_NAME "boot_aggregate"
+
+// Enumerations
+
+/**
+ * @enum IMA_LogStatus
+ * @brief Result of a reader operation.
+ */
+typedef enum {
+    IMA_LOG_OK = 0,                 /**< An entry was decoded into the view */
+    IMA_LOG_END = 1,                /**< No more entries in the log */
+    IMA_LOG_ERR_INVALID = -1,       /**< NULL or otherwise invalid argument */
+    IMA_LOG_ERR_TRUNCATED = -2,     /**< The log ends inside an entry */
+    IMA_LOG_ERR_FORMAT = -3,        /**< Malformed entry or template data */
+    IMA_LOG_ERR_TOO_LARGE = -4,     /**< An entry does not fit in the reader's buffer */
+    IMA_LOG_ERR_IO = -5             /**< Reading the log failed */
+} IMA_LogStatus;
+
+/**
+ * @enum IMA_Template
+ * @brief Templates whose fields the parser decodes.
+ */
+typedef enum {
+    IMA_TEMPLATE_IMA,               /**< d|n: SHA-1 file digest and name, without an overall data length */
+    IMA_TEMPLATE_IMA_NG,            /**< d-ng|n-ng */
+    IMA_TEMPLATE_IMA_SIG,           /**< d-ng|n-ng|sig */
+    IMA_TEMPLATE_IMA_BUF,           /**< d-ng|n-ng|buf */
+    IMA_TEMPLATE_IMA_MODSIG,        /**< d-ng|n-ng|sig|d-modsig|modsig */
+    IMA_TEMPLATE_OTHER              /**< Custom template; only its template hash can be checked */
+} IMA_Template;
+
+// Structures
+
+/**
+ * @struct IMA_EventView
+ * @brief One entry of a binary_runtime_measurements log, pointing into the reader's buffer.
+ *
+ * The entry is the template digest, PCR and template name the kernel extended with, followed by the template data
+ * that template digest is the hash of. File fields are decoded for the known templates.
+ */
+typedef struct {
+    size_t record_num;              /**< 1-based entry number */
+    uint64_t offset;                /**< Byte offset of the entry in the log */
+    size_t length;                  /**< Total length of the entry in bytes */
+    uint32_t pcr_index;             /**< PCR extended by this entry, normally 10 */
+    const uint8_t *template_digest; /**< Digest the PCR was extended with; all zeros for a violation */
+    uint16_t template_digest_size;  /**< Size of the template digest (the reader's digest size) */
+    const char *template_name;      /**< Template name, not NUL-terminated */
+    uint32_t template_name_len;     /**< Length of the template name */
+    IMA_Template template_kind;     /**< Decoded template */
+    const uint8_t *template_data;   /**< Template fields; the "ima" template hashes its name NUL-padded */
+    uint32_t template_data_size;    /**< Size of the template data */
+    TPM2_ALG_ID file_digest_alg;    /**< Algorithm of the file digest, TPM2_ALG_ERROR if unknown */
+    const uint8_t *file_digest;     /**< Measured file digest, or NULL for IMA_TEMPLATE_OTHER */
+    uint16_t file_digest_size;      /**< Size of the file digest */
+    const char *file_name;          /**< Measured path (or buffer name), not NUL-terminated */
+    uint32_t file_name_len;         /**< Length of the name without its terminator */
+    const uint8_t *signature;       /**< File signature of ima-sig/ima-modsig entries, or NULL */
+    uint32_t signature_size;        /**< Size of the signature; 0 for unsigned files */
+} IMA_EventView;
+
+/**
+ * @struct IMA_LogReader
+ * @brief Streaming reader of a binary_runtime_measurements log, from a file descriptor or a memory buffer.
+ *
+ * A file is read in chunks into a buffer of IMA_LOG_READER_BUFFER_SIZE bytes, so logs of any length are parsed in
+ * constant memory. A view returned by ima_log_reader_next() is valid until the next call. A memory buffer is
+ * parsed in place.
+ */
+typedef struct {
+    int fd;                         /**< Log file, or -1 for a memory buffer */
+    bool owns_fd;                   /**< fd was opened by ima_log_reader_open() */
+    bool eof;                       /**< fd has no more bytes */
+    uint8_t *buffer;                /**< Chunk buffer of a file reader */
+    const uint8_t *data;            /**< Unparsed bytes */
+    size_t available;               /**< Number of unparsed bytes */
+    uint16_t digest_size;           /**< Template digest size: 20 for the SHA-1 log, 32 for SHA-256, ... */
+    size_t record_num;              /**< Entries returned so far */
+    uint64_t offset;                /**< Offset of the next entry */
+} IMA_LogReader;
+
+// Function Prototypes
+
+/**
+ * @brief Returns the template digest size of the log of a PCR bank: binary_runtime_measurements is SHA-1,
+ * binary_runtime_measurements_<alg> uses the bank's algorithm.
+ *
+ * @return Digest size, or 0 if the algorithm is not supported.
+ */
+uint16_t ima_digest_size(TPM2_ALG_ID bank);
+
+/**
+ * @brief Opens a log file for streaming.
+ *
+ * @return IMA_LOG_OK, or IMA_LOG_ERR_IO / IMA_LOG_ERR_INVALID.
+ */
+IMA_LogStatus ima_log_reader_open(IMA_LogReader *reader, const char *filename, TPM2_ALG_ID bank);
+
+/**
+ * @brief Prepares a reader over a log already in memory. Nothing is copied.
+ *
+ * @return IMA_LOG_OK, or IMA_LOG_ERR_INVALID.
+ */
+IMA_LogStatus ima_log_reader_init_buffer(IMA_LogReader *reader, const uint8_t *log, size_t log_size,
+                                         TPM2_ALG_ID bank);
+
+/**
+ * @brief Decodes the next entry.
+ *
+ * @return IMA_LOG_OK with the entry in event, IMA_LOG_END after the last entry, or an error.
+ */
+IMA_LogStatus ima_log_reader_next(IMA_LogReader *reader, IMA_EventView *event);
+
+/**
+ * @brief Decodes the template kind and file fields of an entry whose template name and data are set, as when the
+ * entry comes from a CEL ima_template record rather than a reader.
+ *
+ * @param[in,out] event  Entry with template_name, template_name_len, template_data and template_data_size set.
+ *
+ * @return IMA_LOG_OK, or IMA_LOG_ERR_FORMAT if the template data does not hold the template's fields.
+ */
+IMA_LogStatus ima_template_decode(IMA_EventView *event);
+
+/**
+ * @brief Releases a reader, closing the file it opened.
+ */
+void ima_log_reader_close(IMA_LogReader *reader);
+
+/**
+ * @brief Returns a short description of a status.
+ */
+const char *ima_log_status_str(IMA_LogStatus status);
+
+#endif // IMA_LOG_PARSER_H
@@ -0,0 +1,124 @@
+// log_dictionary.h
+#ifndef LOG_DICTIONARY_H
+#define LOG_DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <zstd.h>
+
+// Constants
+
+#define LOG_DICTIONARY_NONE 0                   /**< Dictionary ID of a verifier that takes uncompressed logs only */
+#define LOG_DICTIONARY_DEFAULT_LEVEL 9          /**< zstd level logs are compressed at; cheap enough for devices */
+#define LOG_DICTIONARY_DEFAULT_SIZE (112 * 1024) /**< Size of a trained dictionary, as zstd's trainer defaults to */
+#define LOG_DICTIONARY_SAMPLE_SIZE (16 * 1024)  /**< Largest training sample cut from a log */
+
+// Structures
+
+/**
+ * @struct LogDictionary
+ * @brief A zstd dictionary shared by attestors and verifiers, trained offline on a corpus of fleet logs.
+ *
+ * Event logs of one fleet repeat the same firmware events, UEFI variables and bootloader measurements, so most of
+ * a log is found in the dictionary and compresses to a few references. The dictionary is digested once for either
+ * direction; compressing and decompressing use a context per calling thread, so one dictionary serves every
+ * thread. Frames carry the dictionary's ID and the size of the log they hold.
+ */
+typedef struct {
+    uint32_t id;                    /**< ID in the dictionary's header, advertised in AttestationRequest */
+    int level;                      /**< Compression level */
+    ZSTD_CDict *cdict;              /**< Dictionary digested for compression */
+    ZSTD_DDict *ddict;              /**< Dictionary digested for decompression */
+} LogDictionary;
+
+// Function Prototypes
+
+/**
+ * @brief Prepares a dictionary from its serialized form, as written by log_dictionary_train().
+ *
+ * @param[out] dictionary  Dictionary to initialize; release it with log_dictionary_free().
+ * @param[in]  data        Serialized dictionary; it is copied.
+ * @param[in]  size        Size of the serialized dictionary.
+ * @param[in]  level       Compression level, e.g. LOG_DICTIONARY_DEFAULT_LEVEL.
+ *
+ * @return Returns 0 on success, or -1 if the data is not a zstd dictionary with an ID.
+ */
+int log_dictionary_init(LogDictionary *dictionary, const void *data, size_t size, int level);
+
+/**
+ * @brief Reads a dictionary from a file and prepares it with log_dictionary_init().
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_dictionary_load(LogDictionary *dictionary, const char *filename, int level);
+
+/**
+ * @brief Releases a dictionary. Safe on a dictionary that failed to initialize.
+ */
+void log_dictionary_free(LogDictionary *dictionary);
+
+/**
+ * @brief Returns the largest frame log_dictionary_compress() can produce from a log of the given size.
+ */
+size_t log_dictionary_compress_bound(size_t log_size);
+
+/**
+ * @brief Compresses a log, or part of one, into a single frame.
+ *
+ * @param[in]  dictionary  Dictionary.
+ * @param[in]  log         Log bytes.
+ * @param[in]  log_size    Size of the log.
+ * @param[out] frame       Buffer receiving the frame.
+ * @param[in]  capacity    Size of the buffer; log_dictionary_compress_bound() always suffices.
+ * @param[out] frame_size  Size of the frame.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_dictionary_compress(const LogDictionary *dictionary, const uint8_t *log, size_t log_size, uint8_t *frame,
+                            size_t capacity, size_t *frame_size);
+
+/**
+ * @brief Reads the size of the log a frame holds from its header, so the buffer it is decompressed into can be
+ *        sized before decompressing.
+ *
+ * @return Returns 0 on success, or -1 if the frame is malformed or does not record the size.
+ */
+int log_dictionary_frame_size(const uint8_t *frame, size_t frame_size, uint64_t *log_size);
+
+/**
+ * @brief Decompresses a frame straight into the buffer the log is parsed from.
+ *
+ * @param[in]  dictionary  Dictionary the frame was compressed with.
+ * @param[in]  frame       Frame.
+ * @param[in]  frame_size  Size of the frame.
+ * @param[out] log         Buffer receiving the log.
+ * @param[in]  log_size    Size of the log, as given by log_dictionary_frame_size(); the frame must hold exactly
+ *                         that many bytes.
+ *
+ * @return Returns 0 on success, or -1 if the frame is corrupt or was compressed with another dictionary.
+ */
+int log_dictionary_decompress(const LogDictionary *dictionary, const uint8_t *frame, size_t frame_size, uint8_t *log,
+                              size_t log_size);
+
+/**
+ * @brief Trains a dictionary on a corpus of logs.
+ *
+ * Logs are cut into samples of at most LOG_DICTIONARY_SAMPLE_SIZE bytes at record boundaries, where the deltas
+ * attestors send start, so the dictionary serves whole logs and runs of appended records alike. Data that does
+ * not parse as an event log is cut at fixed sizes.
+ *
+ * @param[in]  logs        Logs of the corpus.
+ * @param[in]  log_sizes   Size of each log.
+ * @param[in]  count       Number of logs.
+ * @param[in]  capacity    Largest dictionary to produce, e.g. LOG_DICTIONARY_DEFAULT_SIZE.
+ * @param[in]  id          ID to give the dictionary, or 0 for one derived from its content.
+ * @param[in]  level       Level the dictionary's statistics are tuned for.
+ * @param[out] dictionary  Serialized dictionary; the caller frees it.
+ * @param[out] size        Size of the serialized dictionary.
+ *
+ * @return Returns 0 on success, or -1 if the corpus is too small or training fails.
+ */
+int log_dictionary_train(const uint8_t *const *logs, const size_t *log_sizes, size_t count, size_t capacity,
+                         uint32_t id, int level, uint8_t **dictionary, size_t *size);
+
+#endif // LOG_DICTIONARY_H
@@ -0,0 +1,138 @@
+// log_generator.h
+#ifndef LOG_GENERATOR_H
+#define LOG_GENERATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "event_log_parser.h"
+#include "manifest.h"
+
+// Constants
+
+#define LOG_GENERATOR_MAX_MIX 16            /**< Most event kinds in one mix */
+#define LOG_GENERATOR_NAME_MAX 64           /**< Longest generated payload name, terminator included */
+#define LOG_GENERATOR_IMA_SIGNATURE_SIZE 265 /**< Bytes of a generated ima-sig signature (digsig v2, RSA-2048) */
+
+// Structures
+
+/**
+ * @struct LogGeneratorEventKind
+ * @brief One kind of event in a generated log, and how often it appears.
+ */
+typedef struct {
+    uint32_t event_type;                    /**< TCG event type, e.g. TCG_EV_EFI_BOOT_SERVICES_APPLICATION */
+    uint32_t pcr_index;                     /**< PCR the event extends */
+    uint32_t weight;                        /**< Relative frequency among the kinds of the mix */
+    uint32_t data_size;                     /**< Event data bytes, the payload name included */
+} LogGeneratorEventKind;
+
+/**
+ * @struct LogGeneratorConfig
+ * @brief What to generate. The same configuration and seed always produce the same log, byte for byte.
+ */
+typedef struct {
+    uint64_t seed;                                  /**< Seed of the generator's PRNG */
+    size_t event_count;                             /**< Records after the Spec ID header */
+    uint32_t bank_count;                            /**< Digest banks every event carries */
+    TPM2_ALG_ID banks[TCG_MAX_DIGEST_BANKS];        /**< Bank algorithms, in header order */
+    uint32_t mix_count;                             /**< Event kinds in the mix */
+    LogGeneratorEventKind mix[LOG_GENERATOR_MAX_MIX]; /**< Event kinds, drawn by weight */
+} LogGeneratorConfig;
+
+/**
+ * @struct LogGeneratorImaConfig
+ * @brief What to generate as an IMA runtime measurement log. The same configuration always produces the same log.
+ */
+typedef struct {
+    uint64_t seed;                                  /**< Seed of the generator's PRNG */
+    size_t entry_count;                             /**< File measurements after the boot_aggregate entry */
+    TPM2_ALG_ID bank;                               /**< Template digest algorithm: TPM2_ALG_SHA1 for the default log */
+    TPM2_ALG_ID file_alg;                           /**< File digest algorithm of the d-ng field */
+    uint32_t signed_percent;                        /**< Share of entries logged with ima-sig and a signature */
+} LogGeneratorImaConfig;
+
+// Function Prototypes
+
+/**
+ * @brief Fills a configuration with one of the built-in event mixes and the SHA-1 and SHA-256 banks.
+ *
+ * "boot" resembles a UEFI boot log: EFI applications, variables, actions, separators and IPL events on PCRs 0-9.
+ * "runtime" resembles a runtime measurement log: file measurements on PCR 10 with longer path names.
+ * "uniform" gives every kind of both mixes the same weight.
+ *
+ * @return Returns 0 on success, or -1 if the mix name is unknown.
+ */
+int log_generator_preset(LogGeneratorConfig *config, const char *mix_name, size_t event_count, uint64_t seed);
+
+/**
+ * @brief Replaces the mix of a configuration with one given as "<type>:<pcr>:<weight>:<data size>,...".
+ *
+ * The type is a number (e.g. 0x80000003). Data sizes are at least LOG_GENERATOR_NAME_MAX so that every event names
+ * its payload.
+ *
+ * @return Returns 0 on success, or -1 if the mix is malformed.
+ */
+int log_generator_parse_mix(LogGeneratorConfig *config, const char *mix);
+
+/**
+ * @brief Replaces the banks of a configuration with a comma-separated list of "sha1", "sha256", "sha384",
+ * "sha512" and "sm3_256".
+ *
+ * @return Returns 0 on success, or -1 if an algorithm is unknown.
+ */
+int log_generator_parse_banks(LogGeneratorConfig *config, const char *banks);
+
+/**
+ * @brief Generates a crypto-agile event log.
+ *
+ * The log starts with a Spec ID Event03 header listing the configured banks, followed by event_count
+ * TCG_PCR_EVENT2 records. Each event's data starts with a unique payload name ("gen-<kind>-<number>") and its
+ * digests are hashes of pseudo-random payload bytes, so no two events match.
+ *
+ * @param[in]  config    What to generate.
+ * @param[out] log       Generated log; the caller frees it.
+ * @param[out] log_size  Size of the log.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_generator_generate(const LogGeneratorConfig *config, uint8_t **log, size_t *log_size);
+
+/**
+ * @brief Adds the payload name and every digest of each extended event of a log to a RIM index, so that the log
+ * verifies against it.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_generator_fill_rim(const uint8_t *log, size_t log_size, RIM_Index *rim_index);
+
+/**
+ * @brief Fills an IMA configuration with the kernel defaults: a SHA-1 log of SHA-256 file digests, a tenth of the
+ * files signed.
+ */
+void log_generator_ima_preset(LogGeneratorImaConfig *config, size_t entry_count, uint64_t seed);
+
+/**
+ * @brief Generates an IMA log in the binary_runtime_measurements format.
+ *
+ * The log starts with a boot_aggregate entry, followed by entry_count ima-ng and ima-sig measurements of files
+ * under /usr/lib/gen on PCR 10. File digests are hashes of pseudo-random bytes and every template digest is the
+ * hash of its template data, so the log verifies.
+ *
+ * @param[in]  config    What to generate.
+ * @param[out] log       Generated log; the caller frees it.
+ * @param[out] log_size  Size of the log.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_generator_generate_ima(const LogGeneratorImaConfig *config, uint8_t **log, size_t *log_size);
+
+/**
+ * @brief Adds the path and file digest of every measurement of an IMA log to a RIM index, so that the log
+ * verifies against it.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int log_generator_fill_rim_ima(const uint8_t *log, size_t log_size, TPM2_ALG_ID bank, RIM_Index *rim_index);
+
+#endif // LOG_GENERATOR_H
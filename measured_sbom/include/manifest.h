@@ -0,0 +1,157 @@
+// manifest.h
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+// Constants
+
+#define RIM_INDEX_NONE UINT32_MAX       /**< Marks an empty slot or the end of a same-name chain */
+#define RIM_INDEX_MIN_SLOTS 16          /**< Smallest hash table size; tables are always a power of two */
+#define RIM_INDEX_DIGEST_SIZE 32        /**< Size of RIM_Index.content_digest (SHA-256) */
+
+// Structures
+
+/**
+ * @struct RIM_Entry
+ * @brief A reference measurement: an interned payload name and one digest of that payload.
+ *
+ * Entries only hold offsets and indexes, never pointers, so an index can be relocated as a single block.
+ */
+typedef struct {
+    uint32_t name_offset;           /**< Offset of the name in the string pool */
+    uint32_t name_len;              /**< Length of the name in bytes, excluding the terminator */
+    uint32_t next_same_name;        /**< Index of the next entry with the same name, or RIM_INDEX_NONE */
+    TPM2_ALG_ID alg;                /**< Hash algorithm of digest */
+    uint16_t digest_size;           /**< Size of digest in bytes */
+    uint8_t digest[sizeof(TPMU_HA)];/**< Reference digest */
+} RIM_Entry;
+
+/**
+ * @struct RIM_Slot
+ * @brief One slot of an open-addressing hash table.
+ *
+ * The full key hash is kept next to the entry index so that probing only touches the slot array until a
+ * candidate with a matching hash is found.
+ */
+typedef struct {
+    uint32_t hash;                  /**< Hash of the key stored in this slot */
+    uint32_t entry;                 /**< Index into RIM_Index.entries, or RIM_INDEX_NONE if empty */
+} RIM_Slot;
+
+/**
+ * @struct RIM_Index
+ * @brief Reference integrity manifest index, built once per manifest.
+ *
+ * Provides O(1) lookup by payload name and by (algorithm, digest) through two linear-probing tables.
+ * Names are interned into one string pool; every entry sharing a name is reachable from the name table
+ * through next_same_name. An index is read-only once built and may then be shared between threads. An index
+ * mapped from a compiled image (rim_index_map_image) is read-only from the start.
+ */
+typedef struct {
+    RIM_Entry *entries;             /**< Entry array */
+    uint32_t entry_count;           /**< Number of entries */
+    uint32_t entry_capacity;        /**< Allocated entries */
+    char *strings;                  /**< String pool of NUL-terminated names */
+    uint32_t strings_size;          /**< Bytes used in the string pool */
+    uint32_t strings_capacity;      /**< Bytes allocated for the string pool */
+    RIM_Slot *name_slots;           /**< Name table, keyed by interned name */
+    uint32_t name_slot_count;       /**< Size of the name table (power of two) */
+    uint32_t name_count;            /**< Number of distinct names */
+    RIM_Slot *digest_slots;         /**< Digest table, keyed by (algorithm, digest) */
+    uint32_t digest_slot_count;     /**< Size of the digest table (power of two) */
+    uint32_t digest_count;          /**< Number of distinct (algorithm, digest) keys */
+    uint8_t content_digest[RIM_INDEX_DIGEST_SIZE];/**< Rolling digest of every entry added; names the RIM version */
+    void *image;                    /**< Read-only mapping the tables live in (see rim_image.h), or NULL */
+    size_t image_size;              /**< Size of the mapping */
+} RIM_Index;
+
+// Function Prototypes
+
+/**
+ * @brief Initializes an empty RIM index.
+ *
+ * @param[out] index             Index to initialize.
+ * @param[in]  expected_entries  Number of entries to size the tables for; the index grows past it as needed.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int rim_index_init(RIM_Index *index, size_t expected_entries);
+
+/**
+ * @brief Releases all memory held by a RIM index, or unmaps its image.
+ */
+void rim_index_free(RIM_Index *index);
+
+/**
+ * @brief Adds a reference digest for a payload name.
+ *
+ * Adding an identical (name, algorithm, digest) triple twice is a no-op. Every new entry is folded into
+ * content_digest, so two indexes have the same content digest only if they were built from the same entries in
+ * the same order; results computed against one index stay valid for the other.
+ *
+ * @param[in,out] index        Index to add to.
+ * @param[in]     name         Payload name; need not be NUL-terminated.
+ * @param[in]     name_len     Length of the name in bytes.
+ * @param[in]     alg          Hash algorithm of the digest.
+ * @param[in]     digest       Digest bytes.
+ * @param[in]     digest_size  Digest size in bytes.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int rim_index_add(RIM_Index *index, const char *name, size_t name_len,
+                  TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size);
+
+/**
+ * @brief Looks up the first entry for a payload name.
+ *
+ * Use rim_index_next_same_name() to walk the remaining entries (other algorithms or versions) for that name.
+ *
+ * @return Pointer to the entry, or NULL if the name is not in the manifest.
+ */
+const RIM_Entry *rim_index_find_by_name(const RIM_Index *index, const char *name, size_t name_len);
+
+/**
+ * @brief Returns the next entry sharing the name of the given entry, or NULL at the end of the chain.
+ */
+const RIM_Entry *rim_index_next_same_name(const RIM_Index *index, const RIM_Entry *entry);
+
+/**
+ * @brief Looks up an entry by (algorithm, digest).
+ *
+ * @return Pointer to the first entry added with that digest, or NULL if none.
+ */
+const RIM_Entry *rim_index_find_by_digest(const RIM_Index *index, TPM2_ALG_ID alg,
+                                          const uint8_t *digest, size_t digest_size);
+
+/**
+ * @brief Returns the NUL-terminated interned name of an entry.
+ */
+const char *rim_entry_name(const RIM_Index *index, const RIM_Entry *entry);
+
+/**
+ * @brief Fills a RIM index from a serialized RIMManifest protobuf (RIM_builder/proto/rim.proto).
+ *
+ * Every PayloadElement becomes one SHA-256 entry keyed by its name; the hex hash string is decoded.
+ * Elements with a missing name or malformed hash are skipped with a warning, and elements already in the index
+ * (duplicates in the manifest included) are not counted.
+ *
+ * @param[in,out] index          Initialized index to add to.
+ * @param[in]     manifest       Serialized RIMManifest.
+ * @param[in]     manifest_size  Size of the serialized manifest.
+ *
+ * @return Returns the number of entries added, or -1 on failure.
+ */
+int rim_index_load_manifest(RIM_Index *index, const uint8_t *manifest, size_t manifest_size);
+
+/**
+ * @brief Reads a serialized RIMManifest from a file and adds its payload to a RIM index.
+ *
+ * @return Returns the number of entries added, or -1 on failure.
+ */
+int rim_index_load_manifest_file(RIM_Index *index, const char *filename);
+
+#endif // MANIFEST_H
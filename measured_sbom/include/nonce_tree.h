@@ -0,0 +1,90 @@
+// nonce_tree.h
+#ifndef NONCE_TREE_H
+#define NONCE_TREE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Constants
+
+#define NONCE_TREE_DIGEST_SIZE 32       /**< SHA-256 node size, and the qualifying data a coalesced quote carries */
+#define NONCE_TREE_MAX_LEAVES 65536     /**< Most nonces one tree commits to */
+#define NONCE_TREE_MAX_DEPTH 16         /**< Levels above the leaves in the largest tree */
+
+// Structures
+
+/**
+ * @struct NonceTree
+ * @brief A Merkle tree over the nonces answered by one coalesced quote.
+ *
+ * Leaves are SHA-256(0x00 || nonce) and inner nodes SHA-256(0x01 || left || right), so a leaf can never pass for an
+ * inner node. A node without a sibling is carried up to the next level unchanged. The TPM quotes the root as
+ * qualifyingData, and each verifier receives an inclusion proof of its own nonce.
+ */
+typedef struct {
+    uint32_t leaf_count;                            /**< Number of nonces */
+    uint32_t level_count;                           /**< Levels, leaves included */
+    uint8_t (*nodes)[NONCE_TREE_DIGEST_SIZE];       /**< Every level, leaves first */
+    size_t level_offset[NONCE_TREE_MAX_DEPTH + 1];  /**< Index in nodes of the first node of each level */
+    uint32_t level_size[NONCE_TREE_MAX_DEPTH + 1];  /**< Nodes in each level */
+} NonceTree;
+
+/**
+ * @struct NonceProof
+ * @brief Inclusion proof of one nonce, with sibling hashes viewing into the tree or a received message.
+ */
+typedef struct {
+    uint32_t leaf_index;                            /**< Position of the nonce among the leaves */
+    uint32_t leaf_count;                            /**< Number of leaves in the tree */
+    uint32_t sibling_count;                         /**< Sibling hashes, from the leaf up; promoted levels have none */
+    const uint8_t *siblings[NONCE_TREE_MAX_DEPTH];  /**< NONCE_TREE_DIGEST_SIZE bytes each */
+} NonceProof;
+
+// Function Prototypes
+
+/**
+ * @brief Builds the tree over a batch of nonces.
+ *
+ * @param[out] tree         Tree to build; release it with nonce_tree_free().
+ * @param[in]  nonces       Nonces, in leaf order.
+ * @param[in]  nonce_sizes  Size of each nonce.
+ * @param[in]  count        Number of nonces, 1 to NONCE_TREE_MAX_LEAVES.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int nonce_tree_build(NonceTree *tree, const uint8_t *const *nonces, const size_t *nonce_sizes, uint32_t count);
+
+/**
+ * @brief Releases the nodes of a tree. Safe on a tree that failed to build.
+ */
+void nonce_tree_free(NonceTree *tree);
+
+/**
+ * @brief Returns the root of a built tree.
+ */
+const uint8_t *nonce_tree_root(const NonceTree *tree);
+
+/**
+ * @brief Fills the inclusion proof of one leaf; the siblings point into the tree.
+ *
+ * @return Returns 0 on success, or -1 if the index is out of range.
+ */
+int nonce_tree_proof(const NonceTree *tree, uint32_t leaf_index, NonceProof *proof);
+
+/**
+ * @brief Computes the root a proof leads to from a nonce.
+ *
+ * The verifier compares the result with the quote's qualifyingData: it matches only if the tree the TPM quoted
+ * contains this nonce.
+ *
+ * @param[in]  nonce       Nonce the verifier sent.
+ * @param[in]  nonce_size  Size of the nonce.
+ * @param[in]  proof       Proof received with the quote.
+ * @param[out] root        Root the proof leads to.
+ *
+ * @return Returns 0 on success, or -1 if the proof is malformed for its leaf index and count.
+ */
+int nonce_proof_root(const uint8_t *nonce, size_t nonce_size, const NonceProof *proof,
+                     uint8_t root[NONCE_TREE_DIGEST_SIZE]);
+
+#endif // NONCE_TREE_H
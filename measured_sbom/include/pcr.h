@@ -0,0 +1,191 @@
+// pcr.h
+#ifndef PCR_H
+#define PCR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "event_log_parser.h"
+
+// Constants
+
+#ifndef TPM_PCR_COUNT
+#define TPM_PCR_COUNT 24  /**< TPM 2.0 typically has 24 PCR registers */
+#endif
+
+#define PCR_DIGESTS_PER_READ 8  /**< Digests returned per TPML_DIGEST, as with TPM2_PCR_Read */
+#define PCR_LOG_DIGEST_SIZE TPM2_SHA256_DIGEST_SIZE  /**< Size of the rolling event log prefix digest */
+#define PCR_ALL_PCRS ((uint32_t)((1ULL << TPM_PCR_COUNT) - 1))  /**< PCR mask selecting every PCR */
+
+// Enumerations
+
+/**
+ * @enum PCR_Sha256Kernel
+ * @brief SHA-256 extend kernels available to the replay engine, selected at runtime by CPUID.
+ */
+typedef enum {
+    PCR_SHA256_KERNEL_SCALAR,       /**< Portable C, one chain at a time */
+    PCR_SHA256_KERNEL_SHANI,        /**< Intel SHA extensions, one chain at a time */
+    PCR_SHA256_KERNEL_AVX2          /**< AVX2 multi-buffer, eight chains at a time */
+} PCR_Sha256Kernel;
+
+// Structures
+
+/**
+ * @struct PCR_Bank
+ * @brief Replayed values of all PCRs in one hash bank.
+ */
+typedef struct {
+    TPM2_ALG_ID alg;                        /**< Hash algorithm of the bank */
+    uint16_t digest_size;                   /**< Digest size in bytes */
+    TPM2B_DIGEST pcrs[TPM_PCR_COUNT];       /**< PCR values, indexed by PCR number */
+} PCR_Bank;
+
+/**
+ * @struct PCR_BankSet
+ * @brief Replayed PCR state for every bank listed in an event log's Spec ID header.
+ */
+typedef struct {
+    uint32_t bank_count;                    /**< Number of valid banks */
+    PCR_Bank banks[TCG_MAX_DIGEST_BANKS];   /**< Banks, in Spec ID header order */
+    uint32_t extended_mask;                 /**< PCRs a replayed event extended; events extend every bank */
+} PCR_BankSet;
+
+/**
+ * @struct PCR_ReplaySchedule
+ * @brief Event digests of a replay range, grouped by PCR with a counting sort.
+ *
+ * digests[bank * event_count + slot] is the bank's digest for the event in that slot; the events of PCR p occupy
+ * slots start[p] .. start[p + 1] - 1 in log order. Every (bank, PCR) pair is an independent extend chain, so
+ * chains can be replayed separately and on different threads.
+ */
+typedef struct {
+    const uint8_t **digests;                /**< Digest pointers into the log, by bank then slot */
+    size_t event_count;                     /**< Events extended into a PCR */
+    size_t start[TPM_PCR_COUNT + 1];        /**< First slot of each PCR's chain */
+    uint32_t bank_count;                    /**< Banks the digests were gathered for */
+} PCR_ReplaySchedule;
+
+// Function Prototypes
+
+/**
+ * @brief Resets a bank set to the power-on PCR values for the banks of an event log.
+ *
+ * PCRs 17-22 start as all ones and every other PCR as all zeros. Banks whose algorithm the engine cannot
+ * compute are rejected.
+ *
+ * @param[out] set     Bank set to initialize.
+ * @param[in]  cursor  Initialized cursor whose Spec ID header lists the banks.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int pcr_replay_init(PCR_BankSet *set, const TCG_EventLogCursor *cursor);
+
+/**
+ * @brief Replays the remaining events of a cursor into a bank set.
+ *
+ * Extends every bank of the set with the matching digest of each event. Events on different PCRs form independent
+ * chains, so SHA-256 chains are replayed side by side with the widest kernel available. EV_NO_ACTION events are not
+ * extended; a StartupLocality event sets the initial locality of PCR 0.
+ *
+ * @param[in,out] set              Bank set holding the PCR state to extend.
+ * @param[in,out] cursor           Cursor positioned at the first event to replay; at the end of the log on success.
+ * @param[out]    events_replayed  Optional; number of events extended into a PCR.
+ *
+ * @return Returns 0 on success, or -1 on a malformed log or an event lacking a digest for one of the banks.
+ */
+int pcr_replay_events(PCR_BankSet *set, TCG_EventLogCursor *cursor, size_t *events_replayed);
+
+/**
+ * @brief Groups the remaining events of a cursor into per-PCR extend chains without extending anything.
+ *
+ * Validates the range as pcr_replay_events() does and applies a StartupLocality event to the set. The schedule
+ * points into the log, which must outlive it.
+ *
+ * @param[in,out] set       Bank set the chains will extend.
+ * @param[in,out] cursor    Cursor positioned at the first event to replay; at the end of the log on success.
+ * @param[out]    schedule  Chains of the range; release with pcr_replay_schedule_free().
+ *
+ * @return Returns 0 on success, or -1 on a malformed log or an event lacking a digest for one of the banks.
+ */
+int pcr_replay_schedule(PCR_BankSet *set, TCG_EventLogCursor *cursor, PCR_ReplaySchedule *schedule);
+
+/**
+ * @brief Replays the chains of the selected PCRs of one bank.
+ *
+ * Calls for different banks, or for disjoint PCR masks of one bank, touch different PCR values and may run
+ * concurrently.
+ *
+ * @param[in,out] set         Bank set holding the PCR state to extend.
+ * @param[in]     schedule    Schedule built for set by pcr_replay_schedule().
+ * @param[in]     bank_index  Index of the bank in set.
+ * @param[in]     pcr_mask    Bitmask of PCRs to replay; PCR_ALL_PCRS for all of them.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int pcr_replay_schedule_run(PCR_BankSet *set, const PCR_ReplaySchedule *schedule, uint32_t bank_index,
+                            uint32_t pcr_mask);
+
+/**
+ * @brief Releases the digest table of a schedule.
+ */
+void pcr_replay_schedule_free(PCR_ReplaySchedule *schedule);
+
+/**
+ * @brief Replays a complete event log from power-on state.
+ *
+ * @param[in]  event_log  Event log buffer.
+ * @param[in]  log_size   Size of the event log buffer.
+ * @param[out] set        Replayed PCR state.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int pcr_replay_log(const uint8_t *event_log, size_t log_size, PCR_BankSet *set);
+
+/**
+ * @brief Folds the remaining records of a cursor into a rolling digest of the log prefix.
+ *
+ * For every record, digest = SHA-256(digest || record bytes). The chain is per record, so the digest of the first
+ * N records is the same however the log was split between rounds, and it can be advanced in O(new records).
+ * An empty log has an all-zero digest.
+ *
+ * @param[in,out] digest   Rolling digest of the records before the cursor position.
+ * @param[in,out] cursor   Cursor positioned at the first record to fold; at the end of the log on success.
+ *
+ * @return Returns 0 on success, or -1 on a malformed log.
+ */
+int pcr_log_digest_update(uint8_t digest[PCR_LOG_DIGEST_SIZE], TCG_EventLogCursor *cursor);
+
+/**
+ * @brief Finds the bank for a hash algorithm.
+ *
+ * @return Pointer to the bank, or NULL if the set has no bank for that algorithm.
+ */
+const PCR_Bank *pcr_bankset_find(const PCR_BankSet *set, TPM2_ALG_ID alg);
+
+/**
+ * @brief Copies selected PCRs of one bank into a TPML_DIGEST, as TPM2_PCR_Read would return them.
+ *
+ * At most PCR_DIGESTS_PER_READ PCRs are copied, lowest index first. Bits for copied PCRs are cleared from
+ * pcr_mask so the caller can loop until the mask is empty.
+ *
+ * @param[in]     set       Replayed PCR state.
+ * @param[in]     alg       Bank to read.
+ * @param[in,out] pcr_mask  Bitmask of PCRs still to read.
+ * @param[out]    digests   Digests of the PCRs copied in this call.
+ *
+ * @return Returns 0 on success, or -1 if the bank does not exist.
+ */
+int pcr_bankset_read(const PCR_BankSet *set, TPM2_ALG_ID alg, uint32_t *pcr_mask, TPML_DIGEST *digests);
+
+/**
+ * @brief Returns the SHA-256 kernel the replay engine selected for this CPU.
+ */
+PCR_Sha256Kernel pcr_sha256_kernel(void);
+
+/**
+ * @brief Returns a printable name for a SHA-256 kernel.
+ */
+const char *pcr_sha256_kernel_name(PCR_Sha256Kernel kernel);
+
+#endif // PCR_H
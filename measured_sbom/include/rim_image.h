@@ -0,0 +1,98 @@
+// rim_image.h
+#ifndef RIM_IMAGE_H
+#define RIM_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <openssl/evp.h>
+#include "manifest.h"
+
+// Constants
+
+#define RIM_IMAGE_MAGIC 0x49524156u         /**< "AVRI" in the byte order of the host that wrote the image */
+#define RIM_IMAGE_FORMAT_VERSION 1
+#define RIM_IMAGE_ALIGNMENT 64              /**< Alignment of every section within the image */
+#define RIM_IMAGE_SIGNATURE_MAX 8192        /**< Largest serialized Signature message accepted */
+#define RIM_IMAGE_SIG_ECDSA_SHA256 "ECDSA-SHA256"
+#define RIM_IMAGE_SIG_RSA_SHA256 "RSA-SHA256"
+
+// Structures
+
+/**
+ * @struct RIM_ImageHeader
+ * @brief Header of a compiled RIM image.
+ *
+ * An image is a RIM_Index laid out flat: the header, then the entry array, string pool, name table and digest
+ * table, each at a RIM_IMAGE_ALIGNMENT-aligned offset and in the layout of this host. The first signed_size bytes
+ * are followed by a serialized Signature message (rim.proto) over them: algorithm is RIM_IMAGE_SIG_*,
+ * key_info_reference the hex SHA-256 of the signer's DER SubjectPublicKeyInfo, digest the hex SHA-256 of the signed
+ * bytes, and signature_value the hex DER signature.
+ */
+typedef struct {
+    uint32_t magic;                     /**< RIM_IMAGE_MAGIC */
+    uint16_t format_version;            /**< RIM_IMAGE_FORMAT_VERSION */
+    uint16_t header_size;               /**< sizeof(RIM_ImageHeader) */
+    uint16_t entry_size;                /**< sizeof(RIM_Entry) */
+    uint16_t slot_size;                 /**< sizeof(RIM_Slot) */
+    uint32_t entry_count;               /**< Number of entries */
+    uint32_t name_count;                /**< Number of distinct names */
+    uint32_t digest_count;              /**< Number of distinct (algorithm, digest) keys */
+    uint32_t strings_size;              /**< Bytes in the string pool */
+    uint32_t name_slot_count;           /**< Size of the name table (power of two) */
+    uint32_t digest_slot_count;         /**< Size of the digest table (power of two) */
+    uint64_t serial;                    /**< Image serial number chosen by the compiler; newer images are larger */
+    uint64_t entries_offset;            /**< Offset of the entry array */
+    uint64_t strings_offset;            /**< Offset of the string pool */
+    uint64_t name_slots_offset;         /**< Offset of the name table */
+    uint64_t digest_slots_offset;       /**< Offset of the digest table */
+    uint64_t signed_size;               /**< Bytes covered by the signature; the Signature message follows */
+    uint8_t content_digest[RIM_INDEX_DIGEST_SIZE];/**< RIM_Index.content_digest of the compiled index */
+} RIM_ImageHeader;
+
+// Function Prototypes
+
+/**
+ * @brief Compiles a RIM index into a signed image file.
+ *
+ * The image is written to a temporary file next to filename and renamed over it, so a verifier reloading the
+ * image never sees a partial one.
+ *
+ * @param[in] index        Index to compile.
+ * @param[in] serial       Serial number recorded in the image.
+ * @param[in] signing_key  Private key signing the image (ECDSA or RSA).
+ * @param[in] filename     Image file to write.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int rim_image_write(const RIM_Index *index, uint64_t serial, EVP_PKEY *signing_key, const char *filename);
+
+/**
+ * @brief Maps a compiled RIM image and makes a read-only RIM index of it.
+ *
+ * The signature is checked against trusted_key and the section bounds and table links are validated once; the
+ * index then points straight into the mapping, so opening an image costs one pass over its bytes with no parsing
+ * and no allocation. rim_index_add() fails on a mapped index and rim_index_free() unmaps it.
+ *
+ * @param[out] index        Index to fill.
+ * @param[in]  filename     Image file.
+ * @param[in]  trusted_key  Public key the image must be signed with.
+ * @param[out] header       Copy of the image header; may be NULL.
+ *
+ * @return Returns 0 on success, or -1 if the image cannot be read, is malformed or is not signed by trusted_key.
+ */
+int rim_index_map_image(RIM_Index *index, const char *filename, EVP_PKEY *trusted_key, RIM_ImageHeader *header);
+
+/**
+ * @brief Checks whether a file starts like a compiled RIM image rather than a RIMManifest protobuf.
+ */
+bool rim_image_probe(const char *filename);
+
+/**
+ * @brief Reads a PEM key for signing (private_key) or checking RIM images.
+ *
+ * @return Key, to be released with EVP_PKEY_free(), or NULL on failure.
+ */
+EVP_PKEY *rim_image_read_key(const char *filename, bool private_key);
+
+#endif // RIM_IMAGE_H
@@ -0,0 +1,80 @@
+// soft_ak.h
+#ifndef SOFT_AK_H
+#define SOFT_AK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/evp.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "pcr.h"
+
+// Constants
+
+#define SOFT_AK_QUOTE_MAX_SIZE (sizeof(TPM2B_ATTEST) + sizeof(TPMT_SIGNATURE))  /**< Largest marshaled quote */
+
+// Structures
+
+/**
+ * @struct SoftAK
+ * @brief Software ECDSA P-256 attestation key, with the TPM2B_PUBLIC and names a TPM-resident AK would have.
+ *
+ * The key stands in for a primary key of the endorsement hierarchy, which is what ak_cache_add() assumes when it
+ * is given no parent, and its quotes carry the qualified name that key would have. Quotes signed with it are
+ * marshaled exactly like TPM2_Quote output, so a verifier checks them with the code it uses for real TPMs. Used by
+ * simulated attestors to load-test verifiers without TPMs.
+ */
+typedef struct {
+    EVP_PKEY *key;                                  /**< Private key */
+    TPM2B_NAME name;                                /**< nameAlg || SHA-256 of the public area */
+    TPM2B_NAME qualified_name;                      /**< nameAlg || SHA-256 of TPM2_RH_ENDORSEMENT || name */
+    uint8_t public_blob[sizeof(TPM2B_PUBLIC)];      /**< Marshaled TPM2B_PUBLIC, for ak_cache_add() */
+    size_t public_size;                             /**< Size of the marshaled TPM2B_PUBLIC */
+} SoftAK;
+
+/**
+ * @struct SoftQuoteState
+ * @brief The PCR selection a quote covers and the digest TPM2_Quote computes over it.
+ */
+typedef struct {
+    TPML_PCR_SELECTION selection;                   /**< Every PCR of every bank */
+    TPM2B_DIGEST digest;                            /**< SHA-256 of the selected PCR values, in PCR order */
+} SoftQuoteState;
+
+// Function Prototypes
+
+/**
+ * @brief Generates a key and its TPM2B_PUBLIC, name and qualified name.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int soft_ak_create(SoftAK *ak);
+
+/**
+ * @brief Releases a key created by soft_ak_create().
+ */
+void soft_ak_free(SoftAK *ak);
+
+/**
+ * @brief Selects every PCR of every replayed bank and hashes their values with SHA-256, the hash of the key's
+ * signing scheme, as TPM2_Quote does.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int soft_quote_state_init(SoftQuoteState *state, const PCR_BankSet *pcrs);
+
+/**
+ * @brief Signs a quote over PCR state and a nonce, marshaled as TPM2B_ATTEST || TPMT_SIGNATURE.
+ *
+ * @param[in]  ak          Signing key.
+ * @param[in]  state       Quoted PCR selection and digest.
+ * @param[in]  nonce       Qualifying data.
+ * @param[in]  nonce_size  Size of the qualifying data.
+ * @param[out] quote       Buffer of at least SOFT_AK_QUOTE_MAX_SIZE bytes.
+ * @param[in]  capacity    Size of the buffer.
+ *
+ * @return Size of the quote, or 0 on failure.
+ */
+size_t soft_ak_quote(const SoftAK *ak, const SoftQuoteState *state, const uint8_t *nonce, size_t nonce_size,
+                     uint8_t *quote, size_t capacity);
+
+#endif // SOFT_AK_H
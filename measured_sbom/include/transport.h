@@ -0,0 +1,184 @@
+// transport.h
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+
+// Constants
+
+#define TRANSPORT_FRAME_HEADER_SIZE 4                   /**< Big-endian length prefix of every message */
+#define TRANSPORT_MAX_FRAME_SIZE (64u * 1024 * 1024)    /**< Largest message accepted from a peer */
+#define TRANSPORT_POOL_MIN_SIZE 256                     /**< Capacity of the smallest pooled frame */
+#define TRANSPORT_POOL_CLASSES 16                       /**< Power-of-two size classes; larger frames are not pooled */
+#define TRANSPORT_POOL_MAX_CACHED 64                    /**< Free frames kept per size class */
+#define TRANSPORT_MAX_IOV 64                            /**< Queued frames written per writev() */
+
+// Enumerations
+
+/**
+ * @enum TransportStatus
+ * @brief Result of a transport read or flush.
+ */
+typedef enum {
+    TRANSPORT_OK = 0,               /**< A frame was read, or every queued frame was written */
+    TRANSPORT_AGAIN = 1,            /**< The socket would block; wait for it to become ready */
+    TRANSPORT_CLOSED = -1,          /**< The peer closed the connection */
+    TRANSPORT_ERROR = -2            /**< Socket error, oversized frame or allocation failure */
+} TransportStatus;
+
+// Structures
+
+/**
+ * @struct BufferPool
+ * @brief Free lists of frame buffers in power-of-two size classes, shared by the connections of one process.
+ *
+ * Every frame a connection reads or queues comes from the pool with room for its length prefix in front, so a
+ * message is serialized in place, written with its header in one gather, and its buffer reused by the next one.
+ * Thread-safe.
+ */
+typedef struct BufferPool BufferPool;
+
+/**
+ * @struct TransportFrame
+ * @brief Pool bookkeeping in front of every frame buffer.
+ */
+typedef struct TransportFrame {
+    struct TransportFrame *next;    /**< Link on a write queue or a free list */
+    uint32_t size_class;            /**< Size class, or TRANSPORT_POOL_CLASSES if not pooled */
+    uint32_t size;                  /**< Length of the message */
+    uint8_t header[TRANSPORT_FRAME_HEADER_SIZE]; /**< Length prefix; the message follows */
+} TransportFrame;
+
+/**
+ * @struct TransportConnection
+ * @brief A non-blocking stream socket carrying length-prefixed frames in both directions.
+ *
+ * Any number of frames may be queued before earlier ones are written or answered, so a peer can keep many
+ * requests outstanding on one connection. The connection does no polling itself: the owner's event loop calls
+ * transport_read_frame() when the socket is readable and transport_flush() when it is writable.
+ */
+typedef struct {
+    int fd;                         /**< Socket, or -1 */
+    BufferPool *pool;               /**< Pool frames are taken from and returned to */
+    uint8_t header[TRANSPORT_FRAME_HEADER_SIZE]; /**< Length prefix of the frame being read */
+    size_t read_offset;             /**< Bytes of the current frame read so far */
+    TransportFrame *reading;        /**< Frame being read, once its length is known */
+    TransportFrame *write_head;     /**< Oldest queued frame */
+    TransportFrame *write_tail;     /**< Newest queued frame */
+    size_t write_offset;            /**< Bytes of the oldest frame already written, header included */
+    size_t queued;                  /**< Frames on the write queue */
+} TransportConnection;
+
+// Function Prototypes
+
+/**
+ * @brief Creates an empty buffer pool.
+ *
+ * @return Pointer to the pool, or NULL on failure.
+ */
+BufferPool *buffer_pool_create(void);
+
+/**
+ * @brief Releases a pool and the free frames it holds. Frames still in use must not be released into it later.
+ */
+void buffer_pool_destroy(BufferPool *pool);
+
+/**
+ * @brief Takes a frame buffer of at least size bytes from the pool.
+ *
+ * @return Pointer to the message area, or NULL on failure.
+ */
+uint8_t *transport_frame_get(BufferPool *pool, size_t size);
+
+/**
+ * @brief Returns a frame buffer obtained from transport_frame_get() or transport_read_frame(). NULL is ignored.
+ */
+void transport_frame_put(BufferPool *pool, uint8_t *message);
+
+/**
+ * @brief Parses "unix:<path>" or "<host>:<port>" into a socket address.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int transport_parse_address(const char *address, struct sockaddr_storage *addr, socklen_t *addr_len);
+
+/**
+ * @brief Opens a non-blocking listening socket on an address. A stale Unix socket file is replaced.
+ *
+ * @return Listening socket, or -1 on failure.
+ */
+int transport_listen(const char *address);
+
+/**
+ * @brief Accepts a connection on a listening socket as a non-blocking socket.
+ *
+ * @return Accepted socket, or -1 (errno EAGAIN when no connection is pending).
+ */
+int transport_accept(int listen_fd);
+
+/**
+ * @brief Starts a non-blocking connect to a socket address.
+ *
+ * @param[out] in_progress  Set if the connection completes later; wait for the socket to become writable and
+ *                          check it with transport_connect_result().
+ *
+ * @return Connected (or connecting) socket, or -1 on failure.
+ */
+int transport_connect(const struct sockaddr_storage *addr, socklen_t addr_len, bool *in_progress);
+
+/**
+ * @brief Returns 0 if a non-blocking connect has succeeded, or -1 if it failed.
+ */
+int transport_connect_result(int fd);
+
+/**
+ * @brief Prepares a connection over a non-blocking socket. The connection takes ownership of fd.
+ */
+void transport_connection_init(TransportConnection *connection, int fd, BufferPool *pool);
+
+/**
+ * @brief Closes the socket and returns every buffered frame to the pool.
+ */
+void transport_connection_close(TransportConnection *connection);
+
+/**
+ * @brief Reads until one whole frame has arrived or the socket would block.
+ *
+ * @param[out] message  Message of the frame, a pool buffer the caller returns with transport_frame_put().
+ * @param[out] size     Size of the message.
+ *
+ * @return TRANSPORT_OK with a frame, TRANSPORT_AGAIN if the frame is incomplete, or TRANSPORT_CLOSED or
+ *         TRANSPORT_ERROR if the connection must be closed.
+ */
+TransportStatus transport_read_frame(TransportConnection *connection, uint8_t **message, size_t *size);
+
+/**
+ * @brief Queues a message obtained from transport_frame_get(); the connection takes ownership of it.
+ *
+ * Nothing is written until transport_flush(), so several frames queued back to back go out in one writev().
+ */
+void transport_queue_frame(TransportConnection *connection, uint8_t *message, size_t size);
+
+/**
+ * @brief Copies a message into a pool buffer and queues it.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int transport_queue_copy(TransportConnection *connection, const uint8_t *message, size_t size);
+
+/**
+ * @brief Writes queued frames until the queue is empty or the socket would block.
+ *
+ * @return TRANSPORT_OK if the queue is empty, TRANSPORT_AGAIN if frames remain, or TRANSPORT_ERROR.
+ */
+TransportStatus transport_flush(TransportConnection *connection);
+
+/**
+ * @brief Returns true if queued frames are waiting to be written.
+ */
+bool transport_has_pending_writes(const TransportConnection *connection);
+
+#endif // TRANSPORT_H
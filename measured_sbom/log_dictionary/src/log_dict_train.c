@@ -0,0 +1,190 @@
+// log_dict_train.c
+// Trains the zstd dictionary attestors and verifiers compress event logs with, from a corpus of logs collected
+// across the fleet or generated like the simulated fleet's boot logs, and reports how well it compresses them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "log_dictionary.h"
+#include "log_generator.h"
+
+#define TRAIN_DEFAULT_EVENTS 100        // Events of each generated log, as attestor_fleet_config_init() uses
+#define TRAIN_DEFAULT_SEED 1
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s -o <dictionary> [options] [log...]\n"
+            "  -o <file>    Write the trained dictionary to <file>\n"
+            "  -i <id>      Dictionary ID advertised by verifiers (default: derived from the content)\n"
+            "  -S <bytes>   Largest dictionary to produce (default: %d)\n"
+            "  -l <level>   Compression level the dictionary is tuned for (default: %d)\n"
+            "  -g <count>   Also train on <count> generated boot logs, as the simulated fleet's firmware builds\n"
+            "  -n <events>  Events of each generated log (default: %d)\n"
+            "  -s <seed>    Seed of the first generated log (default: %d)\n"
+            "Logs are raw TCG event logs or CEL streams, e.g. /sys/kernel/security/tpm0/binary_bios_measurements\n"
+            "collected from the fleet.\n",
+            program, LOG_DICTIONARY_DEFAULT_SIZE, LOG_DICTIONARY_DEFAULT_LEVEL, TRAIN_DEFAULT_EVENTS,
+            TRAIN_DEFAULT_SEED);
+}
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+
+    uint8_t *buffer = file_size > 0 ? malloc((size_t)file_size) : NULL;
+    if (!buffer || fread(buffer, 1, (size_t)file_size, file) != (size_t)file_size) {
+        fprintf(stderr, "Error reading file: %s\n", filename);
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *size = (size_t)file_size;
+    return buffer;
+}
+
+static int write_file(const char *filename, const uint8_t *data, size_t size) {
+    FILE *file = fopen(filename, "wb");
+    int rc = file && fwrite(data, 1, size, file) == size ? 0 : -1;
+    if (file && fclose(file) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error writing %s\n", filename);
+    }
+    return rc;
+}
+
+static double monotonic_s(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Compresses every log of the corpus with the dictionary and prints the ratio and throughput.
+ */
+static int report_corpus(const LogDictionary *dictionary, uint8_t *const *logs, const size_t *log_sizes,
+                         size_t count) {
+    size_t total = 0;
+    size_t compressed = 0;
+    double compress_s = 0;
+    double decompress_s = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t bound = log_dictionary_compress_bound(log_sizes[i]);
+        uint8_t *frame = malloc(bound);
+        uint8_t *copy = malloc(log_sizes[i]);
+        size_t frame_size;
+        if (!frame || !copy) {
+            fprintf(stderr, "Error allocating memory for compression\n");
+            free(frame);
+            free(copy);
+            return -1;
+        }
+        double start = monotonic_s();
+        int rc = log_dictionary_compress(dictionary, logs[i], log_sizes[i], frame, bound, &frame_size);
+        double middle = monotonic_s();
+        rc = rc != 0 ? rc : log_dictionary_decompress(dictionary, frame, frame_size, copy, log_sizes[i]);
+        double end = monotonic_s();
+        if (rc == 0 && memcmp(copy, logs[i], log_sizes[i]) != 0) {
+            fprintf(stderr, "Log %zu does not survive a round trip\n", i);
+            rc = -1;
+        }
+        free(frame);
+        free(copy);
+        if (rc != 0) {
+            return -1;
+        }
+        total += log_sizes[i];
+        compressed += frame_size;
+        compress_s += middle - start;
+        decompress_s += end - middle;
+    }
+
+    printf("Corpus: %zu logs, %zu bytes -> %zu bytes compressed (ratio %.1fx)\n", count, total, compressed,
+           compressed ? (double)total / (double)compressed : 0.0);
+    printf("Throughput: compress %.1f MB/s, decompress %.1f MB/s\n",
+           compress_s > 0 ? (double)total / compress_s / 1e6 : 0.0,
+           decompress_s > 0 ? (double)total / decompress_s / 1e6 : 0.0);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output_file = NULL;
+    uint32_t id = 0;
+    size_t capacity = LOG_DICTIONARY_DEFAULT_SIZE;
+    int level = LOG_DICTIONARY_DEFAULT_LEVEL;
+    size_t generated = 0;
+    size_t events = TRAIN_DEFAULT_EVENTS;
+    uint64_t seed = TRAIN_DEFAULT_SEED;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:i:S:l:g:n:s:h")) != -1) {
+        switch (opt) {
+            case 'o': output_file = optarg; break;
+            case 'i': id = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'S': capacity = strtoul(optarg, NULL, 0); break;
+            case 'l': level = atoi(optarg); break;
+            case 'g': generated = strtoul(optarg, NULL, 10); break;
+            case 'n': events = strtoul(optarg, NULL, 10); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    size_t count = (size_t)(argc - optind) + generated;
+    if (!output_file || count == 0 || capacity == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint8_t **logs = calloc(count, sizeof(*logs));
+    size_t *log_sizes = calloc(count, sizeof(*log_sizes));
+    int rc = logs && log_sizes ? 0 : -1;
+    for (size_t i = 0; rc == 0 && i < (size_t)(argc - optind); i++) {
+        logs[i] = read_file(argv[optind + i], &log_sizes[i]);
+        rc = logs[i] ? 0 : -1;
+    }
+    LogGeneratorConfig config;
+    if (rc == 0 && generated > 0 && log_generator_preset(&config, "boot", events, seed) != 0) {
+        rc = -1;
+    }
+    for (size_t i = count - generated; rc == 0 && i < count; i++) {
+        rc = log_generator_generate(&config, &logs[i], &log_sizes[i]);
+        config.seed++;
+    }
+
+    uint8_t *dictionary = NULL;
+    size_t dictionary_size = 0;
+    LogDictionary loaded = { 0 };
+    if (rc == 0) {
+        rc = log_dictionary_train((const uint8_t *const *)logs, log_sizes, count, capacity, id, level, &dictionary,
+                                  &dictionary_size);
+    }
+    if (rc == 0 && (rc = log_dictionary_init(&loaded, dictionary, dictionary_size, level)) == 0) {
+        printf("Trained dictionary %u: %zu bytes\n", loaded.id, dictionary_size);
+        rc = report_corpus(&loaded, logs, log_sizes, count);
+    }
+    if (rc == 0 && (rc = write_file(output_file, dictionary, dictionary_size)) == 0) {
+        printf("Wrote %s\n", output_file);
+    }
+
+    log_dictionary_free(&loaded);
+    free(dictionary);
+    for (size_t i = 0; logs && i < count; i++) {
+        free(logs[i]);
+    }
+    free(logs);
+    free(log_sizes);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,274 @@
+// log_dictionary.c
+// zstd dictionary compression of event logs for the attestation transport, and training of the shared dictionary
+// from a corpus of fleet logs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zdict.h>
+#include "log_dictionary.h"
+#include "event_log_parser.h"
+
+// Per-thread compression and decompression contexts; a context is reused for every frame of its thread
+static pthread_key_t cctx_key;
+static pthread_key_t dctx_key;
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+
+static void cctx_destroy(void *cctx) {
+    ZSTD_freeCCtx(cctx);
+}
+
+static void dctx_destroy(void *dctx) {
+    ZSTD_freeDCtx(dctx);
+}
+
+static void context_keys_create(void) {
+    pthread_key_create(&cctx_key, cctx_destroy);
+    pthread_key_create(&dctx_key, dctx_destroy);
+}
+
+static ZSTD_CCtx *thread_cctx(void) {
+    pthread_once(&context_once, context_keys_create);
+    ZSTD_CCtx *cctx = pthread_getspecific(cctx_key);
+    if (!cctx) {
+        cctx = ZSTD_createCCtx();
+        if (!cctx || pthread_setspecific(cctx_key, cctx) != 0) {
+            fprintf(stderr, "Error creating compression context\n");
+            ZSTD_freeCCtx(cctx);
+            return NULL;
+        }
+    }
+    return cctx;
+}
+
+static ZSTD_DCtx *thread_dctx(void) {
+    pthread_once(&context_once, context_keys_create);
+    ZSTD_DCtx *dctx = pthread_getspecific(dctx_key);
+    if (!dctx) {
+        dctx = ZSTD_createDCtx();
+        if (!dctx || pthread_setspecific(dctx_key, dctx) != 0) {
+            fprintf(stderr, "Error creating decompression context\n");
+            ZSTD_freeDCtx(dctx);
+            return NULL;
+        }
+    }
+    return dctx;
+}
+
+int log_dictionary_init(LogDictionary *dictionary, const void *data, size_t size, int level) {
+    memset(dictionary, 0, sizeof(*dictionary));
+    if (!data || size == 0) {
+        fprintf(stderr, "Log dictionary init failed: Invalid input\n");
+        return -1;
+    }
+
+    // Responses name their dictionary by ID; a raw-content dictionary has none
+    dictionary->id = ZSTD_getDictID_fromDict(data, size);
+    if (dictionary->id == LOG_DICTIONARY_NONE) {
+        fprintf(stderr, "Not a zstd dictionary, or one without an ID\n");
+        return -1;
+    }
+    dictionary->level = level;
+    dictionary->cdict = ZSTD_createCDict(data, size, level);
+    dictionary->ddict = ZSTD_createDDict(data, size);
+    if (!dictionary->cdict || !dictionary->ddict) {
+        fprintf(stderr, "Error loading log dictionary %u\n", dictionary->id);
+        log_dictionary_free(dictionary);
+        return -1;
+    }
+    return 0;
+}
+
+int log_dictionary_load(LogDictionary *dictionary, const char *filename, int level) {
+    memset(dictionary, 0, sizeof(*dictionary));
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening log dictionary: %s\n", filename);
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    uint8_t *buffer = file_size > 0 ? malloc((size_t)file_size) : NULL;
+    if (!buffer || fread(buffer, 1, (size_t)file_size, file) != (size_t)file_size) {
+        fprintf(stderr, "Error reading log dictionary: %s\n", filename);
+        free(buffer);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    int rc = log_dictionary_init(dictionary, buffer, (size_t)file_size, level);
+    free(buffer);
+    return rc;
+}
+
+void log_dictionary_free(LogDictionary *dictionary) {
+    if (!dictionary) {
+        return;
+    }
+    ZSTD_freeCDict(dictionary->cdict);
+    ZSTD_freeDDict(dictionary->ddict);
+    memset(dictionary, 0, sizeof(*dictionary));
+}
+
+size_t log_dictionary_compress_bound(size_t log_size) {
+    return ZSTD_compressBound(log_size);
+}
+
+int log_dictionary_compress(const LogDictionary *dictionary, const uint8_t *log, size_t log_size, uint8_t *frame,
+                            size_t capacity, size_t *frame_size) {
+    if (!dictionary || !dictionary->cdict || (!log && log_size > 0) || !frame || !frame_size) {
+        fprintf(stderr, "Log compression failed: Invalid input\n");
+        return -1;
+    }
+    ZSTD_CCtx *cctx = thread_cctx();
+    if (!cctx) {
+        return -1;
+    }
+
+    // The frame header records the dictionary ID and the log size, which the verifier sizes its buffer from
+    size_t size = ZSTD_compress_usingCDict(cctx, frame, capacity, log, log_size, dictionary->cdict);
+    if (ZSTD_isError(size)) {
+        fprintf(stderr, "Error compressing log: %s\n", ZSTD_getErrorName(size));
+        return -1;
+    }
+    *frame_size = size;
+    return 0;
+}
+
+int log_dictionary_frame_size(const uint8_t *frame, size_t frame_size, uint64_t *log_size) {
+    if (!frame || !log_size) {
+        return -1;
+    }
+    unsigned long long size = ZSTD_getFrameContentSize(frame, frame_size);
+    if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+        fprintf(stderr, "Compressed log does not record its size\n");
+        return -1;
+    }
+    *log_size = size;
+    return 0;
+}
+
+int log_dictionary_decompress(const LogDictionary *dictionary, const uint8_t *frame, size_t frame_size, uint8_t *log,
+                              size_t log_size) {
+    if (!dictionary || !dictionary->ddict || !frame || (!log && log_size > 0)) {
+        fprintf(stderr, "Log decompression failed: Invalid input\n");
+        return -1;
+    }
+    unsigned frame_id = ZSTD_getDictID_fromFrame(frame, frame_size);
+    if (frame_id != dictionary->id) {
+        fprintf(stderr, "Log was compressed with dictionary %u, not %u\n", frame_id, dictionary->id);
+        return -1;
+    }
+    ZSTD_DCtx *dctx = thread_dctx();
+    if (!dctx) {
+        return -1;
+    }
+
+    size_t size = ZSTD_decompress_usingDDict(dctx, log, log_size, frame, frame_size, dictionary->ddict);
+    if (ZSTD_isError(size) || size != log_size) {
+        fprintf(stderr, "Error decompressing log: %s\n",
+                ZSTD_isError(size) ? ZSTD_getErrorName(size) : "size does not match the frame header");
+        return -1;
+    }
+    return 0;
+}
+
+// Training
+
+/**
+ * @brief Cuts one log into samples: runs of whole records, or fixed-size pieces past the part that parses.
+ *
+ * @return Number of samples, written to sizes; the samples tile the log in order.
+ */
+static size_t cut_samples(const uint8_t *log, size_t log_size, size_t *sizes) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    size_t count = 0;
+    size_t start = 0;
+    size_t end = 0;
+
+    if (tcg_log_cursor_init(&cursor, log, log_size) == TCG_LOG_OK) {
+        end = cursor.offset;
+        while (tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+            if (cursor.offset - start > LOG_DICTIONARY_SAMPLE_SIZE && end > start) {
+                sizes[count++] = end - start;
+                start = end;
+            }
+            end = cursor.offset;
+        }
+        if (end > start) {
+            sizes[count++] = end - start;
+            start = end;
+        }
+    }
+    while (start < log_size) {
+        size_t size = log_size - start < LOG_DICTIONARY_SAMPLE_SIZE ? log_size - start : LOG_DICTIONARY_SAMPLE_SIZE;
+        sizes[count++] = size;
+        start += size;
+    }
+    return count;
+}
+
+int log_dictionary_train(const uint8_t *const *logs, const size_t *log_sizes, size_t count, size_t capacity,
+                         uint32_t id, int level, uint8_t **dictionary, size_t *size) {
+    if (!logs || !log_sizes || count == 0 || capacity == 0 || !dictionary || !size) {
+        fprintf(stderr, "Log dictionary training failed: Invalid input\n");
+        return -1;
+    }
+
+    // The trainer takes the samples back to back. Two consecutive runs of records hold more than a sample's worth,
+    // so a log of n bytes is cut into at most n / (LOG_DICTIONARY_SAMPLE_SIZE / 2) + 3 samples.
+    size_t total = 0;
+    size_t max_samples = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += log_sizes[i];
+        max_samples += log_sizes[i] / (LOG_DICTIONARY_SAMPLE_SIZE / 2) + 3;
+    }
+    uint8_t *samples = malloc(total ? total : 1);
+    size_t *sample_sizes = malloc(max_samples * sizeof(*sample_sizes));
+    uint8_t *content = malloc(capacity);
+    uint8_t *buffer = malloc(capacity);
+    if (!samples || !sample_sizes || !content || !buffer) {
+        fprintf(stderr, "Error allocating memory for dictionary training\n");
+        free(samples);
+        free(sample_sizes);
+        free(content);
+        free(buffer);
+        return -1;
+    }
+    size_t sample_count = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(samples + offset, logs[i], log_sizes[i]);
+        sample_count += cut_samples(samples + offset, log_sizes[i], sample_sizes + sample_count);
+        offset += log_sizes[i];
+    }
+
+    // Train the content, then rewrite the statistics for the level and the header for the ID
+    size_t trained = ZDICT_trainFromBuffer(content, capacity, samples, sample_sizes, (unsigned)sample_count);
+    if (!ZDICT_isError(trained)) {
+        size_t header_size = ZDICT_getDictHeaderSize(content, trained);
+        ZDICT_params_t params = { .compressionLevel = level, .notificationLevel = 0, .dictID = id };
+        trained = ZDICT_isError(header_size)
+                      ? header_size
+                      : ZDICT_finalizeDictionary(buffer, capacity, content + header_size, trained - header_size,
+                                                 samples, sample_sizes, (unsigned)sample_count, params);
+    }
+    free(samples);
+    free(sample_sizes);
+    free(content);
+    if (ZDICT_isError(trained)) {
+        fprintf(stderr, "Error training log dictionary on %zu samples: %s\n", sample_count,
+                ZDICT_getErrorName(trained));
+        free(buffer);
+        return -1;
+    }
+
+    *dictionary = buffer;
+    *size = trained;
+    return 0;
+}
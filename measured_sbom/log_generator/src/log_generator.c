@@ -0,0 +1,472 @@
+// log_generator.c
+// Generates valid crypto-agile TCG event logs of any size, deterministically from a seed, so benchmarks and load
+// tests run on reproducible inputs from tens of events to millions.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <openssl/evp.h>
+#include "ima_log_parser.h"
+#include "log_generator.h"
+#include "pcr.h"
+
+#define SPEC_ID_EVENT_FIXED_SIZE 29     // Spec ID Event03 without its algorithm table
+#define LEGACY_HEADER_FIXED_SIZE 32     // TCG_PCR_EVENT before its event data
+#define EVENT2_FIXED_SIZE 16            // TCG_PCR_EVENT2 without digests and event data
+#define PAYLOAD_SIZE 32                 // Pseudo-random bytes each event's digests are computed over
+#define IMA_PCR 10                      // PCR generated IMA entries extend
+#define IMA_DATA_MAX_SIZE (4 + 16 + EVP_MAX_MD_SIZE + 4 + LOG_GENERATOR_NAME_MAX + 4 + \
+                           LOG_GENERATOR_IMA_SIGNATURE_SIZE)   // d-ng, n-ng and sig fields
+
+/**
+ * @struct GeneratorBank
+ * @brief A bank of the generated log and the OpenSSL digest that fills it.
+ */
+typedef struct {
+    TPM2_ALG_ID alg;
+    uint16_t size;
+    const EVP_MD *md;
+} GeneratorBank;
+
+static const struct {
+    const char *name;
+    TPM2_ALG_ID alg;
+    uint16_t size;
+    const char *md_name;
+} bank_names[] = {
+    { "sha1", TPM2_ALG_SHA1, TPM2_SHA1_DIGEST_SIZE, "SHA1" },
+    { "sha256", TPM2_ALG_SHA256, TPM2_SHA256_DIGEST_SIZE, "SHA256" },
+    { "sha384", TPM2_ALG_SHA384, TPM2_SHA384_DIGEST_SIZE, "SHA384" },
+    { "sha512", TPM2_ALG_SHA512, TPM2_SHA512_DIGEST_SIZE, "SHA512" },
+    { "sm3_256", TPM2_ALG_SM3_256, TPM2_SM3_256_DIGEST_SIZE, "SM3" },
+};
+
+// Built-in mixes
+static const LogGeneratorEventKind boot_mix[] = {
+    { TCG_EV_POST_CODE, 0, 2, 64 },
+    { TCG_EV_EFI_VARIABLE_DRIVER_CONFIG, 7, 3, 96 },
+    { TCG_EV_EFI_VARIABLE_BOOT, 1, 3, 96 },
+    { TCG_EV_EFI_BOOT_SERVICES_APPLICATION, 4, 4, 160 },
+    { TCG_EV_EFI_ACTION, 5, 2, 64 },
+    { TCG_EV_SEPARATOR, 0, 1, 64 },
+    { TCG_EV_IPL, 8, 6, 128 },
+    { TCG_EV_IPL, 9, 4, 96 },
+    { TCG_EV_NO_ACTION, 0, 1, 64 },
+};
+
+static const LogGeneratorEventKind runtime_mix[] = {
+    { TCG_EV_IPL, 10, 1, 200 },
+};
+
+// splitmix64: fast, and the same sequence on every platform
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint8_t *put_le16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_le32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+static void set_mix(LogGeneratorConfig *config, const LogGeneratorEventKind *mix, size_t count) {
+    memcpy(config->mix, mix, count * sizeof(*mix));
+    config->mix_count = (uint32_t)count;
+}
+
+int log_generator_preset(LogGeneratorConfig *config, const char *mix_name, size_t event_count, uint64_t seed) {
+    memset(config, 0, sizeof(*config));
+    config->seed = seed;
+    config->event_count = event_count;
+    config->bank_count = 2;
+    config->banks[0] = TPM2_ALG_SHA1;
+    config->banks[1] = TPM2_ALG_SHA256;
+
+    size_t boot_count = sizeof(boot_mix) / sizeof(boot_mix[0]);
+    size_t runtime_count = sizeof(runtime_mix) / sizeof(runtime_mix[0]);
+    if (strcmp(mix_name, "boot") == 0) {
+        set_mix(config, boot_mix, boot_count);
+    } else if (strcmp(mix_name, "runtime") == 0) {
+        set_mix(config, runtime_mix, runtime_count);
+    } else if (strcmp(mix_name, "uniform") == 0) {
+        set_mix(config, boot_mix, boot_count);
+        memcpy(config->mix + boot_count, runtime_mix, runtime_count * sizeof(runtime_mix[0]));
+        config->mix_count += (uint32_t)runtime_count;
+        for (uint32_t i = 0; i < config->mix_count; i++) {
+            config->mix[i].weight = 1;
+        }
+    } else {
+        fprintf(stderr, "Unknown event mix: %s\n", mix_name);
+        return -1;
+    }
+    return 0;
+}
+
+int log_generator_parse_mix(LogGeneratorConfig *config, const char *mix) {
+    uint32_t count = 0;
+    const char *p = mix;
+    while (*p) {
+        LogGeneratorEventKind kind;
+        char *end;
+        unsigned long fields[4];
+        for (int i = 0; i < 4; i++) {
+            fields[i] = strtoul(p, &end, 0);
+            if (end == p || fields[i] > UINT32_MAX || (i < 3 && *end != ':')) {
+                fprintf(stderr, "Malformed event mix: %s\n", mix);
+                return -1;
+            }
+            p = i < 3 ? end + 1 : end;
+        }
+        kind.event_type = (uint32_t)fields[0];
+        kind.pcr_index = (uint32_t)fields[1];
+        kind.weight = (uint32_t)fields[2];
+        kind.data_size = fields[3] < LOG_GENERATOR_NAME_MAX ? LOG_GENERATOR_NAME_MAX : (uint32_t)fields[3];
+        if (count == LOG_GENERATOR_MAX_MIX || kind.pcr_index >= TPM_PCR_COUNT || kind.weight == 0 ||
+            (*p != ',' && *p != '\0')) {
+            fprintf(stderr, "Malformed event mix: %s\n", mix);
+            return -1;
+        }
+        config->mix[count++] = kind;
+        p += *p == ',';
+    }
+    if (count == 0) {
+        fprintf(stderr, "Empty event mix\n");
+        return -1;
+    }
+    config->mix_count = count;
+    return 0;
+}
+
+int log_generator_parse_banks(LogGeneratorConfig *config, const char *banks) {
+    uint32_t count = 0;
+    const char *p = banks;
+    while (*p) {
+        size_t length = strcspn(p, ",");
+        size_t i;
+        for (i = 0; i < sizeof(bank_names) / sizeof(bank_names[0]); i++) {
+            if (strlen(bank_names[i].name) == length && strncasecmp(p, bank_names[i].name, length) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof(bank_names) / sizeof(bank_names[0]) || count == TCG_MAX_DIGEST_BANKS) {
+            fprintf(stderr, "Unknown or too many digest banks: %s\n", banks);
+            return -1;
+        }
+        config->banks[count++] = bank_names[i].alg;
+        p += length + (p[length] == ',');
+    }
+    if (count == 0) {
+        fprintf(stderr, "No digest banks\n");
+        return -1;
+    }
+    config->bank_count = count;
+    return 0;
+}
+
+/**
+ * @brief Draws the index of an event kind by weight.
+ */
+static uint32_t draw_kind(const LogGeneratorConfig *config, uint64_t total_weight, uint64_t *state) {
+    uint64_t pick = next_random(state) % total_weight;
+    for (uint32_t i = 0; i < config->mix_count; i++) {
+        if (pick < config->mix[i].weight) {
+            return i;
+        }
+        pick -= config->mix[i].weight;
+    }
+    return config->mix_count - 1;
+}
+
+static int resolve_bank(TPM2_ALG_ID alg, GeneratorBank *bank) {
+    for (size_t i = 0; i < sizeof(bank_names) / sizeof(bank_names[0]); i++) {
+        if (bank_names[i].alg == alg) {
+            bank->alg = alg;
+            bank->size = bank_names[i].size;
+            bank->md = EVP_get_digestbyname(bank_names[i].md_name);
+            return bank->md ? 0 : -1;
+        }
+    }
+    return -1;
+}
+
+static int resolve_banks(const LogGeneratorConfig *config, GeneratorBank *banks, size_t *digests_size) {
+    *digests_size = 0;
+    for (uint32_t i = 0; i < config->bank_count; i++) {
+        if (resolve_bank(config->banks[i], &banks[i]) != 0) {
+            fprintf(stderr, "Digest bank 0x%04x is not supported\n", config->banks[i]);
+            return -1;
+        }
+        *digests_size += sizeof(TPM2_ALG_ID) + banks[i].size;
+    }
+    return 0;
+}
+
+int log_generator_generate(const LogGeneratorConfig *config, uint8_t **log, size_t *log_size) {
+    GeneratorBank banks[TCG_MAX_DIGEST_BANKS];
+    size_t digests_size;
+    uint64_t total_weight = 0;
+
+    *log = NULL;
+    *log_size = 0;
+    if (config->bank_count == 0 || config->bank_count > TCG_MAX_DIGEST_BANKS || config->mix_count == 0 ||
+        config->mix_count > LOG_GENERATOR_MAX_MIX || resolve_banks(config, banks, &digests_size) != 0) {
+        fprintf(stderr, "Invalid log generator configuration\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < config->mix_count; i++) {
+        total_weight += config->mix[i].weight;
+    }
+    if (total_weight == 0) {
+        fprintf(stderr, "Event mix has no weight\n");
+        return -1;
+    }
+
+    // Size the log with a first pass over the kind draws; payloads come from a separate stream
+    uint32_t spec_id_size = SPEC_ID_EVENT_FIXED_SIZE + 4 * config->bank_count;
+    size_t size = LEGACY_HEADER_FIXED_SIZE + spec_id_size;
+    uint64_t kind_state = config->seed;
+    for (size_t i = 0; i < config->event_count; i++) {
+        const LogGeneratorEventKind *kind = &config->mix[draw_kind(config, total_weight, &kind_state)];
+        uint32_t data_size = kind->data_size < LOG_GENERATOR_NAME_MAX ? LOG_GENERATOR_NAME_MAX : kind->data_size;
+        size += EVENT2_FIXED_SIZE + digests_size + data_size;
+    }
+
+    uint8_t *buffer = malloc(size);
+    if (!buffer) {
+        fprintf(stderr, "Error allocating memory for generated event log\n");
+        return -1;
+    }
+
+    // TCG_PCR_EVENT header: PCR 0, EV_NO_ACTION, zero SHA-1 digest, Spec ID Event03 data
+    uint8_t *p = put_le32(buffer, 0);
+    p = put_le32(p, TCG_EV_NO_ACTION);
+    memset(p, 0, TPM2_SHA1_DIGEST_SIZE);
+    p = put_le32(p + TPM2_SHA1_DIGEST_SIZE, spec_id_size);
+    memcpy(p, TCG_SPEC_ID_SIGNATURE, sizeof(TCG_SPEC_ID_SIGNATURE));
+    p += sizeof(TCG_SPEC_ID_SIGNATURE);
+    p = put_le32(p, 0);                 // platformClass
+    *p++ = 0;                           // specVersionMinor
+    *p++ = 2;                           // specVersionMajor
+    *p++ = 0;                           // specErrata
+    *p++ = 2;                           // uintnSize
+    p = put_le32(p, config->bank_count);
+    for (uint32_t i = 0; i < config->bank_count; i++) {
+        p = put_le16(p, banks[i].alg);
+        p = put_le16(p, banks[i].size);
+    }
+    *p++ = 0;                           // vendorInfoSize
+
+    kind_state = config->seed;
+    uint64_t payload_state = config->seed ^ 0x5DEECE66DULL;
+    for (size_t i = 0; i < config->event_count; i++) {
+        uint32_t kind_index = draw_kind(config, total_weight, &kind_state);
+        const LogGeneratorEventKind *kind = &config->mix[kind_index];
+        uint32_t data_size = kind->data_size < LOG_GENERATOR_NAME_MAX ? LOG_GENERATOR_NAME_MAX : kind->data_size;
+
+        uint64_t payload[PAYLOAD_SIZE / sizeof(uint64_t)];
+        for (size_t j = 0; j < PAYLOAD_SIZE / sizeof(uint64_t); j++) {
+            payload[j] = next_random(&payload_state);
+        }
+
+        p = put_le32(p, kind->pcr_index);
+        p = put_le32(p, kind->event_type);
+        p = put_le32(p, config->bank_count);
+        for (uint32_t j = 0; j < config->bank_count; j++) {
+            p = put_le16(p, banks[j].alg);
+            if (EVP_Digest(payload, sizeof(payload), p, NULL, banks[j].md, NULL) != 1) {
+                fprintf(stderr, "Error hashing generated payload\n");
+                free(buffer);
+                return -1;
+            }
+            p += banks[j].size;
+        }
+
+        // Event data: the payload name, its terminator, then filler
+        p = put_le32(p, data_size);
+        memset(p, 0, data_size);
+        snprintf((char *)p, LOG_GENERATOR_NAME_MAX, "gen-%02u-%zu", kind_index, i);
+        uint64_t filler = payload[0];
+        for (size_t j = strlen((char *)p) + 1; j < data_size; j++) {
+            p[j] = (uint8_t)(filler >> (8 * (j % 8)));
+        }
+        p += data_size;
+    }
+
+    *log = buffer;
+    *log_size = size;
+    return 0;
+}
+
+int log_generator_fill_rim(const uint8_t *log, size_t log_size, RIM_Index *rim_index) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    if (tcg_log_cursor_init(&cursor, log, log_size) != TCG_LOG_OK) {
+        return -1;
+    }
+    while ((status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        if (event.event_type == TCG_EV_NO_ACTION) {
+            continue;
+        }
+        const char *name = (const char *)event.event_data;
+        size_t name_len = strnlen(name, event.event_size);
+        for (uint32_t i = 0; i < event.digest_count; i++) {
+            if (rim_index_add(rim_index, name, name_len, event.digests[i].alg, event.digests[i].digest,
+                              event.digests[i].size) != 0) {
+                return -1;
+            }
+        }
+    }
+    return status == TCG_LOG_END ? 0 : -1;
+}
+
+void log_generator_ima_preset(LogGeneratorImaConfig *config, size_t entry_count, uint64_t seed) {
+    memset(config, 0, sizeof(*config));
+    config->seed = seed;
+    config->entry_count = entry_count;
+    config->bank = TPM2_ALG_SHA1;
+    config->file_alg = TPM2_ALG_SHA256;
+    config->signed_percent = 10;
+}
+
+/**
+ * @brief Writes one ima-ng entry, or an ima-sig entry if there is a signature, and returns the end of it.
+ */
+static uint8_t *put_ima_entry(uint8_t *p, const GeneratorBank *bank, const char *alg_name, const uint8_t *file_digest,
+                              uint16_t file_digest_size, const char *path, const uint8_t *signature) {
+    const char *template_name = signature ? "ima-sig" : "ima-ng";
+    size_t template_name_len = strlen(template_name);
+    size_t alg_name_len = strlen(alg_name);
+    size_t path_size = strlen(path) + 1;
+
+    p = put_le32(p, IMA_PCR);
+    uint8_t *template_digest = p;
+    p = put_le32(p + bank->size, (uint32_t)template_name_len);
+    memcpy(p, template_name, template_name_len);
+    p += template_name_len;
+    uint8_t *data = p + 4;
+
+    // d-ng: "<alg>:\0" then the digest; n-ng: the path with its terminator; sig
+    uint8_t *q = put_le32(data, (uint32_t)(alg_name_len + 2 + file_digest_size));
+    memcpy(q, alg_name, alg_name_len);
+    q[alg_name_len] = ':';
+    q[alg_name_len + 1] = '\0';
+    memcpy(q + alg_name_len + 2, file_digest, file_digest_size);
+    q = put_le32(q + alg_name_len + 2 + file_digest_size, (uint32_t)path_size);
+    memcpy(q, path, path_size);
+    q += path_size;
+    if (signature) {
+        q = put_le32(q, LOG_GENERATOR_IMA_SIGNATURE_SIZE);
+        memcpy(q, signature, LOG_GENERATOR_IMA_SIGNATURE_SIZE);
+        q += LOG_GENERATOR_IMA_SIGNATURE_SIZE;
+    }
+
+    put_le32(p, (uint32_t)(q - data));
+    if (EVP_Digest(data, (size_t)(q - data), template_digest, NULL, bank->md, NULL) != 1) {
+        return NULL;
+    }
+    return q;
+}
+
+int log_generator_generate_ima(const LogGeneratorImaConfig *config, uint8_t **log, size_t *log_size) {
+    GeneratorBank bank;
+    GeneratorBank file_bank;
+
+    *log = NULL;
+    *log_size = 0;
+    if (resolve_bank(config->bank, &bank) != 0 || ima_digest_size(config->bank) != bank.size ||
+        resolve_bank(config->file_alg, &file_bank) != 0 || config->signed_percent > 100) {
+        fprintf(stderr, "Invalid IMA log generator configuration\n");
+        return -1;
+    }
+    const char *alg_name = "";
+    for (size_t i = 0; i < sizeof(bank_names) / sizeof(bank_names[0]); i++) {
+        if (bank_names[i].alg == file_bank.alg) {
+            // The kernel names SM3 "sm3" in d-ng
+            alg_name = file_bank.alg == TPM2_ALG_SM3_256 ? "sm3" : bank_names[i].name;
+        }
+    }
+
+    // Entries are sized by their path; allocate for the longest and trim
+    size_t max_entry_size = 4 + bank.size + 4 + IMA_TEMPLATE_NAME_MAX + 4 + IMA_DATA_MAX_SIZE;
+    uint8_t *buffer = malloc((config->entry_count + 1) * max_entry_size);
+    if (!buffer) {
+        fprintf(stderr, "Error allocating memory for generated IMA log\n");
+        return -1;
+    }
+
+    uint64_t state = config->seed;
+    uint8_t file_digest[EVP_MAX_MD_SIZE];
+    uint8_t signature[LOG_GENERATOR_IMA_SIGNATURE_SIZE];
+    char path[LOG_GENERATOR_NAME_MAX];
+    uint8_t *p = buffer;
+    for (size_t i = 0; i <= config->entry_count && p; i++) {
+        uint64_t payload[PAYLOAD_SIZE / sizeof(uint64_t)];
+        for (size_t j = 0; j < PAYLOAD_SIZE / sizeof(uint64_t); j++) {
+            payload[j] = next_random(&state);
+        }
+        if (EVP_Digest(payload, sizeof(payload), file_digest, NULL, file_bank.md, NULL) != 1) {
+            p = NULL;
+            break;
+        }
+
+        // The first entry stands for boot_aggregate, whose digest is not derived from generated PCRs
+        const uint8_t *entry_signature = NULL;
+        if (i == 0) {
+            snprintf(path, sizeof(path), "%s", IMA_BOOT_AGGREGATE_NAME);
+        } else {
+            snprintf(path, sizeof(path), "/usr/lib/gen/%02x/file-%zu", (unsigned int)(payload[0] & 0xff), i);
+            if (payload[1] % 100 < config->signed_percent) {
+                signature[0] = 0x03;    // EVM_IMA_XATTR_DIGSIG
+                signature[1] = 0x02;    // DIGSIG_VERSION_2
+                for (size_t j = 2; j < sizeof(signature); j++) {
+                    signature[j] = (uint8_t)(payload[j % (PAYLOAD_SIZE / sizeof(uint64_t))] >> (8 * (j % 8)));
+                }
+                entry_signature = signature;
+            }
+        }
+        p = put_ima_entry(p, &bank, alg_name, file_digest, file_bank.size, path, entry_signature);
+    }
+    if (!p) {
+        fprintf(stderr, "Error hashing generated IMA entry\n");
+        free(buffer);
+        return -1;
+    }
+
+    size_t size = (size_t)(p - buffer);
+    uint8_t *trimmed = realloc(buffer, size ? size : 1);
+    *log = trimmed ? trimmed : buffer;
+    *log_size = size;
+    return 0;
+}
+
+int log_generator_fill_rim_ima(const uint8_t *log, size_t log_size, TPM2_ALG_ID bank, RIM_Index *rim_index) {
+    IMA_LogReader reader;
+    IMA_EventView event;
+    IMA_LogStatus status;
+    if (ima_log_reader_init_buffer(&reader, log, log_size, bank) != IMA_LOG_OK) {
+        return -1;
+    }
+    while ((status = ima_log_reader_next(&reader, &event)) == IMA_LOG_OK) {
+        if (!event.file_digest) {
+            continue;
+        }
+        if (rim_index_add(rim_index, event.file_name, event.file_name_len, event.file_digest_alg, event.file_digest,
+                          event.file_digest_size) != 0) {
+            return -1;
+        }
+    }
+    return status == IMA_LOG_END ? 0 : -1;
+}
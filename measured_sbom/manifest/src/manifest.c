@@ -0,0 +1,438 @@
+// manifest.c
+// Hash-indexed store of reference integrity manifest (RIM) entries. The index is built once per manifest and then
+// answers name and digest lookups for every event in O(1), replacing a linear scan over a fixed-size array.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <openssl/evp.h>
+#include "rim.pb-c.h"  // Protobuf definitions for the RIM (RIM_builder/proto/rim.proto)
+#include "manifest.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+// Hashing
+
+static uint32_t hash_name(const char *name, size_t name_len) {
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < name_len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint32_t hash_digest(TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size) {
+    // Digests are already uniformly distributed, so their leading bytes make a good hash on their own.
+    uint32_t hash = (uint32_t)alg * 0x9E3779B9u;
+    for (size_t i = 0; i < digest_size && i < 8; i++) {
+        hash = (hash ^ digest[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint32_t slot_count_for(size_t keys) {
+    uint32_t slots = RIM_INDEX_MIN_SLOTS;
+    while (slots / 2 < keys) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+static RIM_Slot *alloc_slots(uint32_t slot_count) {
+    RIM_Slot *slots = malloc(slot_count * sizeof(RIM_Slot));
+    if (slots) {
+        for (uint32_t i = 0; i < slot_count; i++) {
+            slots[i].entry = RIM_INDEX_NONE;
+        }
+    }
+    return slots;
+}
+
+/**
+ * @brief Doubles a table and reinserts its occupied slots using the stored hashes.
+ */
+static int grow_table(RIM_Slot **slots, uint32_t *slot_count) {
+    uint32_t new_count = *slot_count * 2;
+    RIM_Slot *new_slots = alloc_slots(new_count);
+    if (!new_slots) {
+        fprintf(stderr, "Error allocating memory for RIM hash table\n");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < *slot_count; i++) {
+        RIM_Slot slot = (*slots)[i];
+        if (slot.entry == RIM_INDEX_NONE) {
+            continue;
+        }
+        uint32_t pos = slot.hash & (new_count - 1);
+        while (new_slots[pos].entry != RIM_INDEX_NONE) {
+            pos = (pos + 1) & (new_count - 1);
+        }
+        new_slots[pos] = slot;
+    }
+
+    free(*slots);
+    *slots = new_slots;
+    *slot_count = new_count;
+    return 0;
+}
+
+// Probing
+
+static bool name_equals(const RIM_Index *index, const RIM_Entry *entry, const char *name, size_t name_len) {
+    return entry->name_len == name_len && memcmp(index->strings + entry->name_offset, name, name_len) == 0;
+}
+
+static bool digest_equals(const RIM_Entry *entry, TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size) {
+    return entry->alg == alg && entry->digest_size == digest_size && memcmp(entry->digest, digest, digest_size) == 0;
+}
+
+/**
+ * @brief Finds the slot holding a name, or the empty slot where it would be inserted.
+ */
+static uint32_t probe_name(const RIM_Index *index, uint32_t hash, const char *name, size_t name_len) {
+    uint32_t mask = index->name_slot_count - 1;
+    uint32_t pos = hash & mask;
+    for (;;) {
+        const RIM_Slot *slot = &index->name_slots[pos];
+        if (slot->entry == RIM_INDEX_NONE ||
+            (slot->hash == hash && name_equals(index, &index->entries[slot->entry], name, name_len))) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+/**
+ * @brief Finds the slot holding an (algorithm, digest) key, or the empty slot where it would be inserted.
+ */
+static uint32_t probe_digest(const RIM_Index *index, uint32_t hash, TPM2_ALG_ID alg,
+                             const uint8_t *digest, size_t digest_size) {
+    uint32_t mask = index->digest_slot_count - 1;
+    uint32_t pos = hash & mask;
+    for (;;) {
+        const RIM_Slot *slot = &index->digest_slots[pos];
+        if (slot->entry == RIM_INDEX_NONE ||
+            (slot->hash == hash && digest_equals(&index->entries[slot->entry], alg, digest, digest_size))) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+}
+
+// Construction
+
+int rim_index_init(RIM_Index *index, size_t expected_entries) {
+    if (!index || expected_entries >= RIM_INDEX_NONE / 2) {
+        return -1;
+    }
+
+    memset(index, 0, sizeof(*index));
+    index->entry_capacity = expected_entries > 0 ? (uint32_t)expected_entries : RIM_INDEX_MIN_SLOTS;
+    index->entries = malloc(index->entry_capacity * sizeof(RIM_Entry));
+    index->strings_capacity = index->entry_capacity * 32;
+    index->strings = malloc(index->strings_capacity);
+    index->name_slot_count = slot_count_for(index->entry_capacity);
+    index->name_slots = alloc_slots(index->name_slot_count);
+    index->digest_slot_count = slot_count_for(index->entry_capacity);
+    index->digest_slots = alloc_slots(index->digest_slot_count);
+
+    if (!index->entries || !index->strings || !index->name_slots || !index->digest_slots) {
+        fprintf(stderr, "Error allocating memory for RIM index\n");
+        rim_index_free(index);
+        return -1;
+    }
+    return 0;
+}
+
+void rim_index_free(RIM_Index *index) {
+    if (!index) {
+        return;
+    }
+    if (index->image) {
+        munmap(index->image, index->image_size);
+        memset(index, 0, sizeof(*index));
+        return;
+    }
+    free(index->entries);
+    free(index->strings);
+    free(index->name_slots);
+    free(index->digest_slots);
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Folds a new entry into the index's content digest: digest = SHA-256(digest || alg || name || entry digest).
+ */
+static int fold_content_digest(RIM_Index *index, const char *name, size_t name_len,
+                               TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size) {
+    uint8_t header[2 + 4 + 2] = {
+        (uint8_t)(alg >> 8), (uint8_t)alg,
+        (uint8_t)(name_len >> 24), (uint8_t)(name_len >> 16), (uint8_t)(name_len >> 8), (uint8_t)name_len,
+        (uint8_t)(digest_size >> 8), (uint8_t)digest_size
+    };
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    int ok = ctx && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) == 1 &&
+             EVP_DigestUpdate(ctx, index->content_digest, sizeof(index->content_digest)) == 1 &&
+             EVP_DigestUpdate(ctx, header, sizeof(header)) == 1 &&
+             EVP_DigestUpdate(ctx, name, name_len) == 1 &&
+             EVP_DigestUpdate(ctx, digest, digest_size) == 1 &&
+             EVP_DigestFinal_ex(ctx, index->content_digest, NULL) == 1;
+    EVP_MD_CTX_free(ctx);
+    if (!ok) {
+        fprintf(stderr, "Error updating RIM content digest\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies a name into the string pool and returns its offset.
+ */
+static int intern_name(RIM_Index *index, const char *name, size_t name_len, uint32_t *offset) {
+    size_t needed = (size_t)index->strings_size + name_len + 1;
+    if (needed > UINT32_MAX) {
+        return -1;
+    }
+    if (needed > index->strings_capacity) {
+        size_t capacity = index->strings_capacity;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        char *strings = realloc(index->strings, capacity);
+        if (!strings) {
+            fprintf(stderr, "Error allocating memory for RIM string pool\n");
+            return -1;
+        }
+        index->strings = strings;
+        index->strings_capacity = (uint32_t)(capacity > UINT32_MAX ? UINT32_MAX : capacity);
+    }
+
+    *offset = index->strings_size;
+    memcpy(index->strings + index->strings_size, name, name_len);
+    index->strings[index->strings_size + name_len] = '\0';
+    index->strings_size += (uint32_t)name_len + 1;
+    return 0;
+}
+
+int rim_index_add(RIM_Index *index, const char *name, size_t name_len,
+                  TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size) {
+    if (!index || !name || !digest || digest_size == 0 || digest_size > sizeof(TPMU_HA) ||
+        name_len >= UINT32_MAX) {
+        fprintf(stderr, "RIM index add failed: Invalid input\n");
+        return -1;
+    }
+    if (index->image) {
+        fprintf(stderr, "RIM index add failed: Index is mapped from a read-only image\n");
+        return -1;
+    }
+
+    // Keep both tables at most half full so probe sequences stay short.
+    if ((index->name_count + 1) * 2 > index->name_slot_count &&
+        grow_table(&index->name_slots, &index->name_slot_count) != 0) {
+        return -1;
+    }
+    if ((index->digest_count + 1) * 2 > index->digest_slot_count &&
+        grow_table(&index->digest_slots, &index->digest_slot_count) != 0) {
+        return -1;
+    }
+    if (index->entry_count == index->entry_capacity) {
+        if (index->entry_capacity >= RIM_INDEX_NONE / 2) {
+            return -1;
+        }
+        RIM_Entry *entries = realloc(index->entries, 2 * index->entry_capacity * sizeof(RIM_Entry));
+        if (!entries) {
+            fprintf(stderr, "Error allocating memory for RIM entries\n");
+            return -1;
+        }
+        index->entries = entries;
+        index->entry_capacity *= 2;
+    }
+
+    uint32_t name_hash = hash_name(name, name_len);
+    uint32_t name_pos = probe_name(index, name_hash, name, name_len);
+    RIM_Slot *name_slot = &index->name_slots[name_pos];
+
+    uint32_t digest_hash = hash_digest(alg, digest, digest_size);
+    uint32_t digest_pos = probe_digest(index, digest_hash, alg, digest, digest_size);
+    RIM_Slot *digest_slot = &index->digest_slots[digest_pos];
+
+    uint32_t new_index = index->entry_count;
+    RIM_Entry *entry = &index->entries[new_index];
+
+    if (name_slot->entry != RIM_INDEX_NONE) {
+        // Name already interned: skip exact duplicates, otherwise append to the same-name chain.
+        uint32_t last = name_slot->entry;
+        for (uint32_t i = last; i != RIM_INDEX_NONE; i = index->entries[i].next_same_name) {
+            if (digest_equals(&index->entries[i], alg, digest, digest_size)) {
+                return 0;
+            }
+            last = i;
+        }
+        const RIM_Entry *first = &index->entries[name_slot->entry];
+        entry->name_offset = first->name_offset;
+        entry->name_len = first->name_len;
+        index->entries[last].next_same_name = new_index;
+    } else {
+        if (intern_name(index, name, name_len, &entry->name_offset) != 0) {
+            return -1;
+        }
+        entry->name_len = (uint32_t)name_len;
+        name_slot->hash = name_hash;
+        name_slot->entry = new_index;
+        index->name_count++;
+    }
+
+    entry->next_same_name = RIM_INDEX_NONE;
+    entry->alg = alg;
+    entry->digest_size = (uint16_t)digest_size;
+    memset(entry->digest, 0, sizeof(entry->digest));
+    memcpy(entry->digest, digest, digest_size);
+
+    // The digest table keeps the first entry for a digest; identical payloads under other names share it.
+    if (digest_slot->entry == RIM_INDEX_NONE) {
+        digest_slot->hash = digest_hash;
+        digest_slot->entry = new_index;
+        index->digest_count++;
+    }
+
+    index->entry_count++;
+    return fold_content_digest(index, name, name_len, alg, digest, digest_size);
+}
+
+// Lookup
+
+const RIM_Entry *rim_index_find_by_name(const RIM_Index *index, const char *name, size_t name_len) {
+    if (!index || !name || index->name_slot_count == 0) {
+        return NULL;
+    }
+    uint32_t pos = probe_name(index, hash_name(name, name_len), name, name_len);
+    uint32_t entry = index->name_slots[pos].entry;
+    return entry == RIM_INDEX_NONE ? NULL : &index->entries[entry];
+}
+
+const RIM_Entry *rim_index_next_same_name(const RIM_Index *index, const RIM_Entry *entry) {
+    if (!index || !entry || entry->next_same_name == RIM_INDEX_NONE) {
+        return NULL;
+    }
+    return &index->entries[entry->next_same_name];
+}
+
+const RIM_Entry *rim_index_find_by_digest(const RIM_Index *index, TPM2_ALG_ID alg,
+                                          const uint8_t *digest, size_t digest_size) {
+    if (!index || !digest || index->digest_slot_count == 0) {
+        return NULL;
+    }
+    uint32_t pos = probe_digest(index, hash_digest(alg, digest, digest_size), alg, digest, digest_size);
+    uint32_t entry = index->digest_slots[pos].entry;
+    return entry == RIM_INDEX_NONE ? NULL : &index->entries[entry];
+}
+
+const char *rim_entry_name(const RIM_Index *index, const RIM_Entry *entry) {
+    return index->strings + entry->name_offset;
+}
+
+// Loading
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief Decodes a hex string of exactly 2 * size characters.
+ */
+static int decode_hex(const char *hex, uint8_t *out, size_t size) {
+    if (!hex || strlen(hex) != 2 * size) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+int rim_index_load_manifest(RIM_Index *index, const uint8_t *manifest, size_t manifest_size) {
+    if (!index || !manifest) {
+        fprintf(stderr, "RIM manifest load failed: Invalid input\n");
+        return -1;
+    }
+
+    RIMManifest *rim = rimmanifest__unpack(NULL, manifest_size, manifest);
+    if (!rim) {
+        fprintf(stderr, "Error unpacking RIMManifest\n");
+        return -1;
+    }
+
+    int added = 0;
+    for (size_t i = 0; i < rim->n_payload; i++) {
+        const PayloadElement *payload = rim->payload[i];
+        uint8_t digest[TPM2_SHA256_DIGEST_SIZE];
+
+        if (!payload->name || payload->name[0] == '\0' ||
+            decode_hex(payload->hash, digest, sizeof(digest)) != 0) {
+            fprintf(stderr, "Skipping malformed RIM payload element %zu\n", i);
+            continue;
+        }
+        uint32_t entry_count = index->entry_count;
+        if (rim_index_add(index, payload->name, strlen(payload->name),
+                          TPM2_ALG_SHA256, digest, sizeof(digest)) != 0) {
+            rimmanifest__free_unpacked(rim, NULL);
+            return -1;
+        }
+        // An element the index already holds adds nothing
+        added += index->entry_count != entry_count;
+    }
+
+    rimmanifest__free_unpacked(rim, NULL);
+    return added;
+}
+
+int rim_index_load_manifest_file(RIM_Index *index, const char *filename) {
+    if (!index || !filename) {
+        fprintf(stderr, "RIM manifest load failed: Invalid input\n");
+        return -1;
+    }
+
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening RIM manifest: %s\n", filename);
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    if (file_size < 0) {
+        fclose(file);
+        return -1;
+    }
+
+    uint8_t *buffer = malloc(file_size > 0 ? (size_t)file_size : 1);
+    if (!buffer) {
+        fprintf(stderr, "Error allocating memory for RIM manifest\n");
+        fclose(file);
+        return -1;
+    }
+    if (fread(buffer, 1, (size_t)file_size, file) != (size_t)file_size) {
+        fprintf(stderr, "Error reading RIM manifest: %s\n", filename);
+        free(buffer);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    int added = rim_index_load_manifest(index, buffer, (size_t)file_size);
+    free(buffer);
+    return added;
+}
@@ -0,0 +1,74 @@
+// rim_compile.c
+// Compiles serialized RIMManifest protobufs (as written by RIM_builder/SBOM2RIM.py) into one signed RIM image that
+// the verifier maps at startup; see rim_image.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "manifest.h"
+#include "rim_image.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s -k <signing key> -o <image> [-s <serial>] <manifest> [manifest ...]\n"
+            "  -k <file>   PEM private key (ECDSA or RSA) the image is signed with\n"
+            "  -o <file>   Image to write\n"
+            "  -s <num>    Serial number of the image (default: current time)\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *key_file = NULL;
+    const char *output_file = NULL;
+    uint64_t serial = (uint64_t)time(NULL);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:o:s:h")) != -1) {
+        switch (opt) {
+            case 'k': key_file = optarg; break;
+            case 'o': output_file = optarg; break;
+            case 's': serial = strtoull(optarg, NULL, 10); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!key_file || !output_file || optind == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    EVP_PKEY *signing_key = rim_image_read_key(key_file, true);
+    if (!signing_key) {
+        return EXIT_FAILURE;
+    }
+
+    RIM_Index index;
+    if (rim_index_init(&index, 0) != 0) {
+        EVP_PKEY_free(signing_key);
+        return EXIT_FAILURE;
+    }
+
+    int rc = EXIT_FAILURE;
+    for (int i = optind; i < argc; i++) {
+        int added = rim_index_load_manifest_file(&index, argv[i]);
+        if (added < 0) {
+            fprintf(stderr, "Error loading RIM manifest: %s\n", argv[i]);
+            goto cleanup;
+        }
+        printf("%s: %d payload elements\n", argv[i], added);
+    }
+
+    if (rim_image_write(&index, serial, signing_key, output_file) == 0) {
+        printf("Wrote %s: %u entries, %u names, serial %llu\n", output_file, index.entry_count, index.name_count,
+               (unsigned long long)serial);
+        rc = EXIT_SUCCESS;
+    }
+
+cleanup:
+    rim_index_free(&index);
+    EVP_PKEY_free(signing_key);
+    return rc;
+}
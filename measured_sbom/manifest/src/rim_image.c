@@ -0,0 +1,396 @@
+// rim_image.c
+// Compiled RIM images: a RIM index written out flat and signed, so a verifier maps it and uses it in place instead
+// of unpacking and indexing manifests at every start or reload.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include "rim.pb-c.h"  // Protobuf definitions for the RIM (RIM_builder/proto/rim.proto)
+#include "rim_image.h"
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + RIM_IMAGE_ALIGNMENT - 1) & ~(uint64_t)(RIM_IMAGE_ALIGNMENT - 1);
+}
+
+static void encode_hex(const uint8_t *data, size_t size, char *hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; i++) {
+        hex[2 * i] = digits[data[i] >> 4];
+        hex[2 * i + 1] = digits[data[i] & 0x0f];
+    }
+    hex[2 * size] = '\0';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * @brief Decodes a hex string into a newly allocated buffer.
+ */
+static uint8_t *decode_hex_alloc(const char *hex, size_t *size) {
+    size_t len = hex ? strlen(hex) : 0;
+    if (len == 0 || len % 2 != 0) {
+        return NULL;
+    }
+    uint8_t *out = malloc(len / 2);
+    if (!out) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len / 2; i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            free(out);
+            return NULL;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    *size = len / 2;
+    return out;
+}
+
+static const char *signature_algorithm(EVP_PKEY *key) {
+    switch (EVP_PKEY_get_base_id(key)) {
+        case EVP_PKEY_EC: return RIM_IMAGE_SIG_ECDSA_SHA256;
+        case EVP_PKEY_RSA: return RIM_IMAGE_SIG_RSA_SHA256;
+        default: return NULL;
+    }
+}
+
+/**
+ * @brief Computes the key_info_reference of a key: the hex SHA-256 of its DER SubjectPublicKeyInfo.
+ */
+static int key_reference(EVP_PKEY *key, char hex[2 * EVP_MAX_MD_SIZE + 1]) {
+    uint8_t *der = NULL;
+    int der_size = i2d_PUBKEY(key, &der);
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    int ok = der_size > 0 && EVP_Digest(der, (size_t)der_size, digest, &digest_size, EVP_sha256(), NULL) == 1;
+    OPENSSL_free(der);
+    if (!ok) {
+        return -1;
+    }
+    encode_hex(digest, digest_size, hex);
+    return 0;
+}
+
+// Writing
+
+int rim_image_write(const RIM_Index *index, uint64_t serial, EVP_PKEY *signing_key, const char *filename) {
+    if (!index || !signing_key || !filename || !signature_algorithm(signing_key)) {
+        fprintf(stderr, "RIM image write failed: Invalid input\n");
+        return -1;
+    }
+
+    RIM_ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = RIM_IMAGE_MAGIC;
+    header.format_version = RIM_IMAGE_FORMAT_VERSION;
+    header.header_size = sizeof(RIM_ImageHeader);
+    header.entry_size = sizeof(RIM_Entry);
+    header.slot_size = sizeof(RIM_Slot);
+    header.entry_count = index->entry_count;
+    header.name_count = index->name_count;
+    header.digest_count = index->digest_count;
+    header.strings_size = index->strings_size;
+    header.name_slot_count = index->name_slot_count;
+    header.digest_slot_count = index->digest_slot_count;
+    header.serial = serial;
+    header.entries_offset = align_up(sizeof(RIM_ImageHeader));
+    header.strings_offset = align_up(header.entries_offset + (uint64_t)index->entry_count * sizeof(RIM_Entry));
+    header.name_slots_offset = align_up(header.strings_offset + index->strings_size);
+    header.digest_slots_offset = align_up(header.name_slots_offset +
+                                          (uint64_t)index->name_slot_count * sizeof(RIM_Slot));
+    header.signed_size = header.digest_slots_offset + (uint64_t)index->digest_slot_count * sizeof(RIM_Slot);
+    memcpy(header.content_digest, index->content_digest, sizeof(header.content_digest));
+
+    uint8_t *image = calloc(1, header.signed_size);
+    if (!image) {
+        fprintf(stderr, "Error allocating memory for RIM image\n");
+        return -1;
+    }
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.entries_offset, index->entries, (size_t)index->entry_count * sizeof(RIM_Entry));
+    memcpy(image + header.strings_offset, index->strings, index->strings_size);
+    memcpy(image + header.name_slots_offset, index->name_slots, (size_t)index->name_slot_count * sizeof(RIM_Slot));
+    memcpy(image + header.digest_slots_offset, index->digest_slots,
+           (size_t)index->digest_slot_count * sizeof(RIM_Slot));
+
+    // Sign the image and describe the signature with the RIM's own Signature message.
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    uint8_t *signature = NULL;
+    size_t signature_size = 0;
+    char digest_hex[2 * EVP_MAX_MD_SIZE + 1];
+    char key_hex[2 * EVP_MAX_MD_SIZE + 1];
+    char *signature_hex = NULL;
+    uint8_t *packed = NULL;
+    int rc = -1;
+
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(signing_key, NULL);
+    if (!ctx || EVP_Digest(image, header.signed_size, digest, &digest_size, EVP_sha256(), NULL) != 1 ||
+        EVP_PKEY_sign_init(ctx) != 1 || EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()) != 1 ||
+        EVP_PKEY_sign(ctx, NULL, &signature_size, digest, digest_size) != 1 ||
+        !(signature = malloc(signature_size)) ||
+        EVP_PKEY_sign(ctx, signature, &signature_size, digest, digest_size) != 1 ||
+        key_reference(signing_key, key_hex) != 0 ||
+        !(signature_hex = malloc(2 * signature_size + 1))) {
+        fprintf(stderr, "Error signing RIM image\n");
+        goto cleanup;
+    }
+    encode_hex(digest, digest_size, digest_hex);
+    encode_hex(signature, signature_size, signature_hex);
+
+    Signature message = SIGNATURE__INIT;
+    message.algorithm = (char *)signature_algorithm(signing_key);
+    message.key_info_reference = key_hex;
+    message.digest = digest_hex;
+    message.signature_value = signature_hex;
+    size_t packed_size = signature__get_packed_size(&message);
+    packed = malloc(packed_size);
+    if (!packed) {
+        goto cleanup;
+    }
+    signature__pack(&message, packed);
+
+    // Write next to the target and rename, so readers see either the old image or the whole new one.
+    char temp_name[4096];
+    int len = snprintf(temp_name, sizeof(temp_name), "%s.tmp", filename);
+    if (len < 0 || (size_t)len >= sizeof(temp_name)) {
+        goto cleanup;
+    }
+    FILE *file = fopen(temp_name, "wb");
+    if (!file) {
+        fprintf(stderr, "Error creating RIM image: %s\n", temp_name);
+        goto cleanup;
+    }
+    bool written = fwrite(image, 1, header.signed_size, file) == header.signed_size &&
+                   fwrite(packed, 1, packed_size, file) == packed_size &&
+                   fflush(file) == 0 && fsync(fileno(file)) == 0;
+    if (fclose(file) != 0 || !written || rename(temp_name, filename) != 0) {
+        fprintf(stderr, "Error writing RIM image: %s\n", filename);
+        unlink(temp_name);
+        goto cleanup;
+    }
+    rc = 0;
+
+cleanup:
+    EVP_PKEY_CTX_free(ctx);
+    free(signature);
+    free(signature_hex);
+    free(packed);
+    free(image);
+    return rc;
+}
+
+// Loading
+
+/**
+ * @brief Checks the Signature message at the end of an image against the trusted key.
+ */
+static int check_image_signature(const uint8_t *image, size_t image_size, uint64_t signed_size,
+                                 EVP_PKEY *trusted_key) {
+    size_t packed_size = image_size - signed_size;
+    if (packed_size == 0 || packed_size > RIM_IMAGE_SIGNATURE_MAX) {
+        fprintf(stderr, "RIM image has no valid signature block\n");
+        return -1;
+    }
+    Signature *message = signature__unpack(NULL, packed_size, image + signed_size);
+    if (!message) {
+        fprintf(stderr, "Error unpacking RIM image signature\n");
+        return -1;
+    }
+
+    const char *algorithm = signature_algorithm(trusted_key);
+    char key_hex[2 * EVP_MAX_MD_SIZE + 1];
+    char digest_hex[2 * EVP_MAX_MD_SIZE + 1];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    uint8_t *signature = NULL;
+    size_t signature_size = 0;
+    int rc = -1;
+
+    bool digest_ok = EVP_Digest(image, signed_size, digest, &digest_size, EVP_sha256(), NULL) == 1;
+    if (digest_ok) {
+        encode_hex(digest, digest_size, digest_hex);
+    }
+    if (!algorithm || !message->algorithm || strcmp(message->algorithm, algorithm) != 0) {
+        fprintf(stderr, "RIM image signature algorithm does not match the trusted key\n");
+    } else if (key_reference(trusted_key, key_hex) != 0 || !message->key_info_reference ||
+               strcasecmp(message->key_info_reference, key_hex) != 0) {
+        fprintf(stderr, "RIM image is signed by an untrusted key\n");
+    } else if (!digest_ok || !message->digest || strcasecmp(message->digest, digest_hex) != 0) {
+        fprintf(stderr, "RIM image digest does not match its contents\n");
+    } else if (!(signature = decode_hex_alloc(message->signature_value, &signature_size))) {
+        fprintf(stderr, "Malformed RIM image signature value\n");
+    } else {
+        // The image is hashed once; the signature is checked over that digest.
+        EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(trusted_key, NULL);
+        if (ctx && EVP_PKEY_verify_init(ctx) == 1 && EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()) == 1 &&
+            EVP_PKEY_verify(ctx, signature, signature_size, digest, digest_size) == 1) {
+            rc = 0;
+        } else {
+            fprintf(stderr, "RIM image signature is invalid\n");
+        }
+        EVP_PKEY_CTX_free(ctx);
+    }
+
+    free(signature);
+    signature__free_unpacked(message, NULL);
+    return rc;
+}
+
+static bool section_fits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t limit) {
+    return offset % RIM_IMAGE_ALIGNMENT == 0 && offset <= limit && count <= (limit - offset) / element_size;
+}
+
+/**
+ * @brief Validates the header and every link in the tables, so lookups on the mapped index stay in bounds.
+ */
+static int check_image_layout(const uint8_t *image, size_t image_size, const RIM_ImageHeader *header) {
+    if (header->magic != RIM_IMAGE_MAGIC || header->format_version != RIM_IMAGE_FORMAT_VERSION ||
+        header->header_size != sizeof(RIM_ImageHeader) || header->entry_size != sizeof(RIM_Entry) ||
+        header->slot_size != sizeof(RIM_Slot)) {
+        fprintf(stderr, "RIM image was built for another format version or host\n");
+        return -1;
+    }
+
+    uint64_t limit = header->signed_size;
+    uint32_t name_slots = header->name_slot_count;
+    uint32_t digest_slots = header->digest_slot_count;
+    if (limit >= image_size || limit < sizeof(RIM_ImageHeader) ||
+        name_slots == 0 || (name_slots & (name_slots - 1)) != 0 || header->name_count >= name_slots ||
+        digest_slots == 0 || (digest_slots & (digest_slots - 1)) != 0 || header->digest_count >= digest_slots ||
+        header->entry_count >= RIM_INDEX_NONE ||
+        !section_fits(header->entries_offset, header->entry_count, sizeof(RIM_Entry), limit) ||
+        !section_fits(header->strings_offset, header->strings_size, 1, limit) ||
+        !section_fits(header->name_slots_offset, name_slots, sizeof(RIM_Slot), limit) ||
+        !section_fits(header->digest_slots_offset, digest_slots, sizeof(RIM_Slot), limit)) {
+        fprintf(stderr, "RIM image header is malformed\n");
+        return -1;
+    }
+
+    const RIM_Entry *entries = (const RIM_Entry *)(image + header->entries_offset);
+    const char *strings = (const char *)(image + header->strings_offset);
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        const RIM_Entry *entry = &entries[i];
+        if ((uint64_t)entry->name_offset + entry->name_len >= header->strings_size ||
+            strings[entry->name_offset + entry->name_len] != '\0' ||
+            entry->digest_size == 0 || entry->digest_size > sizeof(entry->digest) ||
+            (entry->next_same_name != RIM_INDEX_NONE && entry->next_same_name >= header->entry_count)) {
+            fprintf(stderr, "RIM image entry %u is malformed\n", i);
+            return -1;
+        }
+    }
+
+    const RIM_Slot *tables[2] = {
+        (const RIM_Slot *)(image + header->name_slots_offset),
+        (const RIM_Slot *)(image + header->digest_slots_offset)
+    };
+    const uint32_t table_sizes[2] = { name_slots, digest_slots };
+    for (int t = 0; t < 2; t++) {
+        for (uint32_t i = 0; i < table_sizes[t]; i++) {
+            if (tables[t][i].entry != RIM_INDEX_NONE && tables[t][i].entry >= header->entry_count) {
+                fprintf(stderr, "RIM image hash table is malformed\n");
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int rim_index_map_image(RIM_Index *index, const char *filename, EVP_PKEY *trusted_key, RIM_ImageHeader *header) {
+    if (!index || !filename || !trusted_key) {
+        fprintf(stderr, "RIM image load failed: Invalid input\n");
+        return -1;
+    }
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening RIM image: %s\n", filename);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(RIM_ImageHeader)) {
+        fprintf(stderr, "RIM image is truncated: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+    size_t image_size = (size_t)st.st_size;
+    uint8_t *image = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        fprintf(stderr, "Error mapping RIM image %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    const RIM_ImageHeader *image_header = (const RIM_ImageHeader *)image;
+    if (check_image_layout(image, image_size, image_header) != 0 ||
+        check_image_signature(image, image_size, image_header->signed_size, trusted_key) != 0) {
+        fprintf(stderr, "Rejecting RIM image: %s\n", filename);
+        munmap(image, image_size);
+        return -1;
+    }
+
+    // The tables are used in place; the mapping is read-only, and rim_index_add() refuses mapped indexes.
+    memset(index, 0, sizeof(*index));
+    index->entries = (RIM_Entry *)(image + image_header->entries_offset);
+    index->entry_count = image_header->entry_count;
+    index->entry_capacity = image_header->entry_count;
+    index->strings = (char *)(image + image_header->strings_offset);
+    index->strings_size = image_header->strings_size;
+    index->strings_capacity = image_header->strings_size;
+    index->name_slots = (RIM_Slot *)(image + image_header->name_slots_offset);
+    index->name_slot_count = image_header->name_slot_count;
+    index->name_count = image_header->name_count;
+    index->digest_slots = (RIM_Slot *)(image + image_header->digest_slots_offset);
+    index->digest_slot_count = image_header->digest_slot_count;
+    index->digest_count = image_header->digest_count;
+    memcpy(index->content_digest, image_header->content_digest, sizeof(index->content_digest));
+    index->image = image;
+    index->image_size = image_size;
+    if (header) {
+        *header = *image_header;
+    }
+    return 0;
+}
+
+bool rim_image_probe(const char *filename) {
+    uint32_t magic = 0;
+    FILE *file = filename ? fopen(filename, "rb") : NULL;
+    if (!file) {
+        return false;
+    }
+    bool is_image = fread(&magic, sizeof(magic), 1, file) == 1 && magic == RIM_IMAGE_MAGIC;
+    fclose(file);
+    return is_image;
+}
+
+EVP_PKEY *rim_image_read_key(const char *filename, bool private_key) {
+    FILE *file = filename ? fopen(filename, "r") : NULL;
+    if (!file) {
+        fprintf(stderr, "Error opening key file: %s\n", filename ? filename : "(null)");
+        return NULL;
+    }
+    EVP_PKEY *key = private_key ? PEM_read_PrivateKey(file, NULL, NULL, NULL) : PEM_read_PUBKEY(file, NULL, NULL, NULL);
+    fclose(file);
+    if (!key || !signature_algorithm(key)) {
+        fprintf(stderr, "Error reading %s key (ECDSA or RSA): %s\n", private_key ? "private" : "public", filename);
+        EVP_PKEY_free(key);
+        return NULL;
+    }
+    return key;
+}
@@ -0,0 +1,139 @@
+// nonce_tree.c
+// Merkle tree over the nonces one coalesced TPM quote answers, and the inclusion proofs verifiers check them with.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+#include "nonce_tree.h"
+
+#define NONCE_TREE_LEAF_PREFIX 0x00
+#define NONCE_TREE_NODE_PREFIX 0x01
+
+static int hash_leaf(const uint8_t *nonce, size_t nonce_size, uint8_t out[NONCE_TREE_DIGEST_SIZE]) {
+    static const uint8_t prefix = NONCE_TREE_LEAF_PREFIX;
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    int ok = ctx && EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) == 1 &&
+             EVP_DigestUpdate(ctx, &prefix, 1) == 1 &&
+             EVP_DigestUpdate(ctx, nonce, nonce_size) == 1 &&
+             EVP_DigestFinal_ex(ctx, out, NULL) == 1;
+    EVP_MD_CTX_free(ctx);
+    return ok ? 0 : -1;
+}
+
+static int hash_node(const uint8_t *left, const uint8_t *right, uint8_t out[NONCE_TREE_DIGEST_SIZE]) {
+    uint8_t message[1 + 2 * NONCE_TREE_DIGEST_SIZE];
+    unsigned int digest_size = NONCE_TREE_DIGEST_SIZE;
+    message[0] = NONCE_TREE_NODE_PREFIX;
+    memcpy(message + 1, left, NONCE_TREE_DIGEST_SIZE);
+    memcpy(message + 1 + NONCE_TREE_DIGEST_SIZE, right, NONCE_TREE_DIGEST_SIZE);
+    return EVP_Digest(message, sizeof(message), out, &digest_size, EVP_sha256(), NULL) == 1 ? 0 : -1;
+}
+
+int nonce_tree_build(NonceTree *tree, const uint8_t *const *nonces, const size_t *nonce_sizes, uint32_t count) {
+    memset(tree, 0, sizeof(*tree));
+    if (count == 0 || count > NONCE_TREE_MAX_LEAVES) {
+        fprintf(stderr, "Nonce tree of %u leaves is not supported\n", count);
+        return -1;
+    }
+
+    // Lay out the levels: each has half the nodes of the one below, rounded up
+    size_t total = 0;
+    for (uint32_t size = count;; size = (size + 1) / 2) {
+        tree->level_offset[tree->level_count] = total;
+        tree->level_size[tree->level_count++] = size;
+        total += size;
+        if (size == 1) {
+            break;
+        }
+    }
+
+    tree->nodes = malloc(total * sizeof(*tree->nodes));
+    if (!tree->nodes) {
+        fprintf(stderr, "Error allocating memory for nonce tree\n");
+        return -1;
+    }
+    tree->leaf_count = count;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (hash_leaf(nonces[i], nonce_sizes[i], tree->nodes[i]) != 0) {
+            nonce_tree_free(tree);
+            return -1;
+        }
+    }
+    for (uint32_t level = 1; level < tree->level_count; level++) {
+        const uint8_t (*below)[NONCE_TREE_DIGEST_SIZE] = tree->nodes + tree->level_offset[level - 1];
+        uint8_t (*nodes)[NONCE_TREE_DIGEST_SIZE] = tree->nodes + tree->level_offset[level];
+        uint32_t below_size = tree->level_size[level - 1];
+        for (uint32_t i = 0; i < tree->level_size[level]; i++) {
+            if (2 * i + 1 < below_size) {
+                if (hash_node(below[2 * i], below[2 * i + 1], nodes[i]) != 0) {
+                    nonce_tree_free(tree);
+                    return -1;
+                }
+            } else {
+                memcpy(nodes[i], below[2 * i], NONCE_TREE_DIGEST_SIZE);  // No sibling: promoted unchanged
+            }
+        }
+    }
+    return 0;
+}
+
+void nonce_tree_free(NonceTree *tree) {
+    free(tree->nodes);
+    tree->nodes = NULL;
+    tree->leaf_count = 0;
+    tree->level_count = 0;
+}
+
+const uint8_t *nonce_tree_root(const NonceTree *tree) {
+    return tree->nodes[tree->level_offset[tree->level_count - 1]];
+}
+
+int nonce_tree_proof(const NonceTree *tree, uint32_t leaf_index, NonceProof *proof) {
+    if (leaf_index >= tree->leaf_count) {
+        return -1;
+    }
+
+    proof->leaf_index = leaf_index;
+    proof->leaf_count = tree->leaf_count;
+    proof->sibling_count = 0;
+    uint32_t index = leaf_index;
+    for (uint32_t level = 0; level + 1 < tree->level_count; level++, index /= 2) {
+        uint32_t sibling = index ^ 1;
+        if (sibling < tree->level_size[level]) {
+            proof->siblings[proof->sibling_count++] = tree->nodes[tree->level_offset[level] + sibling];
+        }
+    }
+    return 0;
+}
+
+int nonce_proof_root(const uint8_t *nonce, size_t nonce_size, const NonceProof *proof,
+                     uint8_t root[NONCE_TREE_DIGEST_SIZE]) {
+    if (proof->leaf_count == 0 || proof->leaf_count > NONCE_TREE_MAX_LEAVES ||
+        proof->leaf_index >= proof->leaf_count) {
+        return -1;
+    }
+    if (hash_leaf(nonce, nonce_size, root) != 0) {
+        return -1;
+    }
+
+    // Walk up the same level shapes the tree was built with; the index says on which side each sibling sits
+    uint32_t used = 0;
+    uint32_t index = proof->leaf_index;
+    for (uint32_t size = proof->leaf_count; size > 1; size = (size + 1) / 2, index /= 2) {
+        uint32_t sibling = index ^ 1;
+        if (sibling >= size) {
+            continue;
+        }
+        if (used == proof->sibling_count) {
+            return -1;
+        }
+        const uint8_t *other = proof->siblings[used++];
+        int status = index & 1 ? hash_node(other, root, root) : hash_node(root, other, root);
+        if (status != 0) {
+            return -1;
+        }
+    }
+    return used == proof->sibling_count ? 0 : -1;
+}
@@ -0,0 +1,440 @@
+// pcr.c
+// Multi-bank PCR replay engine. Replays a TCG event log into every bank listed in its Spec ID header and produces the
+// PCR values a TPM would report. Events on different PCRs are independent extend chains: the SHA-256 bank replays
+// them side by side with the multi-buffer kernel while enough chains are active, other banks go through OpenSSL.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include "pcr.h"
+#include "sha256_extend.h"
+
+#define STARTUP_LOCALITY_SIGNATURE "StartupLocality"
+
+// Active chains needed before the multi-buffer kernel beats the single-chain kernel.
+#define AVX2_MIN_CHAINS_WITH_SHANI SHA256_EXTEND_LANES
+#define AVX2_MIN_CHAINS_SCALAR 2
+
+/**
+ * @struct Sha256Chain
+ * @brief A SHA-256 PCR being replayed, with its value as big-endian words.
+ */
+typedef struct {
+    uint32_t state[8];
+    size_t next;
+    size_t end;
+} Sha256Chain;
+
+static PCR_Sha256Kernel selected_kernel = PCR_SHA256_KERNEL_SCALAR;
+static bool avx2_available = false;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void select_kernel(void) {
+    avx2_available = sha256_cpu_has_avx2();
+    if (sha256_cpu_has_shani()) {
+        selected_kernel = PCR_SHA256_KERNEL_SHANI;
+    } else if (avx2_available) {
+        selected_kernel = PCR_SHA256_KERNEL_AVX2;
+    }
+}
+
+PCR_Sha256Kernel pcr_sha256_kernel(void) {
+    pthread_once(&kernel_once, select_kernel);
+    return selected_kernel;
+}
+
+const char *pcr_sha256_kernel_name(PCR_Sha256Kernel kernel) {
+    switch (kernel) {
+        case PCR_SHA256_KERNEL_SCALAR: return "scalar";
+        case PCR_SHA256_KERNEL_SHANI:  return "sha-ni";
+        case PCR_SHA256_KERNEL_AVX2:   return "avx2-x8";
+        default:                       return "unknown";
+    }
+}
+
+static const EVP_MD *bank_md(TPM2_ALG_ID alg) {
+    switch (alg) {
+        case TPM2_ALG_SHA1:   return EVP_sha1();
+        case TPM2_ALG_SHA256: return EVP_sha256();
+        case TPM2_ALG_SHA384: return EVP_sha384();
+        case TPM2_ALG_SHA512: return EVP_sha512();
+        default:              return NULL;
+    }
+}
+
+int pcr_replay_init(PCR_BankSet *set, const TCG_EventLogCursor *cursor) {
+    if (!set || !cursor) {
+        fprintf(stderr, "PCR replay init failed: Invalid input\n");
+        return -1;
+    }
+
+    memset(set, 0, sizeof(*set));
+    for (uint32_t b = 0; b < cursor->bank_count; b++) {
+        const TCG_DigestSize *spec = &cursor->banks[b];
+        const EVP_MD *md = bank_md(spec->alg);
+        if (!md || (size_t)EVP_MD_get_size(md) != spec->size) {
+            fprintf(stderr, "Unsupported PCR bank algorithm 0x%04x\n", spec->alg);
+            return -1;
+        }
+
+        PCR_Bank *bank = &set->banks[b];
+        bank->alg = spec->alg;
+        bank->digest_size = spec->size;
+        for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+            bank->pcrs[pcr].size = spec->size;
+            // PCRs 17-22 are reset to all ones until a dynamic launch.
+            memset(bank->pcrs[pcr].buffer, (pcr >= 17 && pcr <= 22) ? 0xFF : 0x00, spec->size);
+        }
+    }
+    set->bank_count = cursor->bank_count;
+    return 0;
+}
+
+/**
+ * @brief Applies a StartupLocality event: PCR 0 starts with the locality in its last byte.
+ */
+static void apply_startup_locality(PCR_BankSet *set, const TCG_EventView *event) {
+    if (event->event_size < sizeof(STARTUP_LOCALITY_SIGNATURE) + 1 ||
+        memcmp(event->event_data, STARTUP_LOCALITY_SIGNATURE, sizeof(STARTUP_LOCALITY_SIGNATURE)) != 0) {
+        return;
+    }
+    uint8_t locality = event->event_data[sizeof(STARTUP_LOCALITY_SIGNATURE)];
+    for (uint32_t b = 0; b < set->bank_count; b++) {
+        PCR_Bank *bank = &set->banks[b];
+        bank->pcrs[0].buffer[bank->digest_size - 1] = locality;
+    }
+}
+
+/**
+ * @brief First pass: validates the replay range and counts the events of each PCR.
+ */
+static int count_events(PCR_BankSet *set, TCG_EventLogCursor scan, PCR_ReplaySchedule *schedule) {
+    size_t counts[TPM_PCR_COUNT] = {0};
+    TCG_EventView event;
+    TCG_LogStatus status;
+
+    while ((status = tcg_log_cursor_next(&scan, &event)) == TCG_LOG_OK) {
+        if (event.event_type == TCG_EV_NO_ACTION) {
+            if (event.pcr_index == 0 && counts[0] == 0) {
+                apply_startup_locality(set, &event);
+            }
+            continue;
+        }
+        if (event.pcr_index >= TPM_PCR_COUNT) {
+            fprintf(stderr, "Event %zu extends invalid PCR %u\n", event.record_num, event.pcr_index);
+            return -1;
+        }
+        for (uint32_t b = 0; b < set->bank_count; b++) {
+            if (!tcg_event_find_digest(&event, set->banks[b].alg)) {
+                fprintf(stderr, "Event %zu has no digest for bank 0x%04x\n", event.record_num, set->banks[b].alg);
+                return -1;
+            }
+        }
+        counts[event.pcr_index]++;
+    }
+    if (status != TCG_LOG_END) {
+        fprintf(stderr, "Event %zu at offset %zu: %s\n", scan.record_num + 1, scan.offset, tcg_log_status_str(status));
+        return -1;
+    }
+    for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        if (counts[pcr] > 0) {
+            set->extended_mask |= 1u << pcr;
+        }
+    }
+
+    schedule->start[0] = 0;
+    for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        schedule->start[pcr + 1] = schedule->start[pcr] + counts[pcr];
+    }
+    schedule->event_count = schedule->start[TPM_PCR_COUNT];
+    return 0;
+}
+
+/**
+ * @brief Second pass: places each event's digest pointers in its PCR's slot range.
+ */
+static int build_schedule(const PCR_BankSet *set, TCG_EventLogCursor *cursor, PCR_ReplaySchedule *schedule) {
+    size_t total = schedule->event_count * set->bank_count;
+    schedule->digests = malloc((total > 0 ? total : 1) * sizeof(*schedule->digests));
+    if (!schedule->digests) {
+        fprintf(stderr, "Error allocating memory for PCR replay schedule\n");
+        return -1;
+    }
+
+    size_t fill[TPM_PCR_COUNT];
+    memcpy(fill, schedule->start, sizeof(fill));
+
+    TCG_EventView event;
+    while (tcg_log_cursor_next(cursor, &event) == TCG_LOG_OK) {
+        if (event.event_type == TCG_EV_NO_ACTION) {
+            continue;
+        }
+        size_t slot = fill[event.pcr_index]++;
+        for (uint32_t b = 0; b < set->bank_count; b++) {
+            schedule->digests[b * schedule->event_count + slot] =
+                tcg_event_find_digest(&event, set->banks[b].alg)->digest;
+        }
+    }
+    return 0;
+}
+
+static void sha256_extend_single(PCR_Sha256Kernel kernel, uint32_t state[8], const uint8_t *digest) {
+    if (kernel == PCR_SHA256_KERNEL_SHANI) {
+        sha256_extend_shani(state, digest);
+    } else {
+        sha256_extend_scalar(state, digest);
+    }
+}
+
+/**
+ * @brief Replays the SHA-256 bank, running up to eight PCR chains per multi-buffer call.
+ */
+static void replay_sha256_bank(PCR_Bank *bank, const uint8_t **digests, const PCR_ReplaySchedule *schedule,
+                               uint32_t pcr_mask) {
+    Sha256Chain chains[TPM_PCR_COUNT];
+    uint32_t chain_pcr[TPM_PCR_COUNT];
+    uint32_t active[TPM_PCR_COUNT];
+    uint32_t chain_count = 0;
+
+    PCR_Sha256Kernel kernel = pcr_sha256_kernel();
+    if (kernel == PCR_SHA256_KERNEL_AVX2) {
+        kernel = PCR_SHA256_KERNEL_SCALAR;  // single-chain fallback once too few chains remain
+    }
+
+    for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        if (schedule->start[pcr] == schedule->start[pcr + 1] || !(pcr_mask & (1u << pcr))) {
+            continue;
+        }
+        Sha256Chain *chain = &chains[chain_count];
+        for (int i = 0; i < 8; i++) {
+            const uint8_t *p = bank->pcrs[pcr].buffer + 4 * i;
+            chain->state[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        chain->next = schedule->start[pcr];
+        chain->end = schedule->start[pcr + 1];
+        chain_pcr[chain_count] = pcr;
+        active[chain_count] = chain_count;
+        chain_count++;
+    }
+
+    uint32_t active_count = chain_count;
+    uint32_t min_chains = kernel == PCR_SHA256_KERNEL_SHANI ? AVX2_MIN_CHAINS_WITH_SHANI : AVX2_MIN_CHAINS_SCALAR;
+    if (avx2_available) {
+        while (active_count >= min_chains) {
+            uint32_t *states[SHA256_EXTEND_LANES];
+            const uint8_t *lane_digests[SHA256_EXTEND_LANES];
+            uint32_t lanes = active_count < SHA256_EXTEND_LANES ? active_count : SHA256_EXTEND_LANES;
+
+            for (uint32_t lane = 0; lane < SHA256_EXTEND_LANES; lane++) {
+                // Idle lanes repeat lane 0's work on a scratch copy so every lane reads valid memory.
+                Sha256Chain *chain = &chains[active[lane < lanes ? lane : 0]];
+                states[lane] = chain->state;
+                lane_digests[lane] = digests[chain->next];
+            }
+            uint32_t scratch[SHA256_EXTEND_LANES - 1][8];
+            for (uint32_t lane = lanes; lane < SHA256_EXTEND_LANES; lane++) {
+                memcpy(scratch[lane - 1], states[0], sizeof(scratch[0]));
+                states[lane] = scratch[lane - 1];
+            }
+            sha256_extend_avx2_x8(states, lane_digests);
+
+            // Advance the chains that ran and drop the ones that are done.
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < active_count; i++) {
+                Sha256Chain *chain = &chains[active[i]];
+                if (i < lanes) {
+                    chain->next++;
+                }
+                if (chain->next < chain->end) {
+                    active[kept++] = active[i];
+                }
+            }
+            active_count = kept;
+        }
+    }
+
+    for (uint32_t i = 0; i < active_count; i++) {
+        Sha256Chain *chain = &chains[active[i]];
+        for (; chain->next < chain->end; chain->next++) {
+            sha256_extend_single(kernel, chain->state, digests[chain->next]);
+        }
+    }
+
+    for (uint32_t c = 0; c < chain_count; c++) {
+        uint8_t *p = bank->pcrs[chain_pcr[c]].buffer;
+        for (int i = 0; i < 8; i++) {
+            uint32_t word = chains[c].state[i];
+            p[4 * i] = (uint8_t)(word >> 24);
+            p[4 * i + 1] = (uint8_t)(word >> 16);
+            p[4 * i + 2] = (uint8_t)(word >> 8);
+            p[4 * i + 3] = (uint8_t)word;
+        }
+    }
+}
+
+/**
+ * @brief Replays a bank with OpenSSL, one chain at a time.
+ */
+static int replay_generic_bank(PCR_Bank *bank, const uint8_t **digests, const PCR_ReplaySchedule *schedule,
+                               uint32_t pcr_mask) {
+    const EVP_MD *md = bank_md(bank->alg);
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (!md || !ctx) {
+        fprintf(stderr, "Error creating digest context for bank 0x%04x\n", bank->alg);
+        EVP_MD_CTX_free(ctx);
+        return -1;
+    }
+
+    int rc = 0;
+    for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT && rc == 0; pcr++) {
+        if (!(pcr_mask & (1u << pcr))) {
+            continue;
+        }
+        uint8_t *value = bank->pcrs[pcr].buffer;
+        for (size_t slot = schedule->start[pcr]; slot < schedule->start[pcr + 1]; slot++) {
+            if (EVP_DigestInit_ex(ctx, md, NULL) != 1 ||
+                EVP_DigestUpdate(ctx, value, bank->digest_size) != 1 ||
+                EVP_DigestUpdate(ctx, digests[slot], bank->digest_size) != 1 ||
+                EVP_DigestFinal_ex(ctx, value, NULL) != 1) {
+                fprintf(stderr, "Error extending PCR %u in bank 0x%04x\n", pcr, bank->alg);
+                rc = -1;
+                break;
+            }
+        }
+    }
+
+    EVP_MD_CTX_free(ctx);
+    return rc;
+}
+
+int pcr_replay_schedule(PCR_BankSet *set, TCG_EventLogCursor *cursor, PCR_ReplaySchedule *schedule) {
+    if (!set || !cursor || !schedule) {
+        fprintf(stderr, "PCR replay failed: Invalid input\n");
+        return -1;
+    }
+
+    memset(schedule, 0, sizeof(*schedule));
+    if (count_events(set, *cursor, schedule) != 0 || build_schedule(set, cursor, schedule) != 0) {
+        pcr_replay_schedule_free(schedule);
+        return -1;
+    }
+    schedule->bank_count = set->bank_count;
+    return 0;
+}
+
+int pcr_replay_schedule_run(PCR_BankSet *set, const PCR_ReplaySchedule *schedule, uint32_t bank_index,
+                            uint32_t pcr_mask) {
+    if (!set || !schedule || bank_index >= set->bank_count || bank_index >= schedule->bank_count) {
+        fprintf(stderr, "PCR replay failed: Invalid input\n");
+        return -1;
+    }
+
+    PCR_Bank *bank = &set->banks[bank_index];
+    const uint8_t **digests = schedule->digests + bank_index * schedule->event_count;
+    if (bank->alg == TPM2_ALG_SHA256) {
+        replay_sha256_bank(bank, digests, schedule, pcr_mask);
+        return 0;
+    }
+    return replay_generic_bank(bank, digests, schedule, pcr_mask);
+}
+
+void pcr_replay_schedule_free(PCR_ReplaySchedule *schedule) {
+    if (schedule) {
+        free(schedule->digests);
+        schedule->digests = NULL;
+    }
+}
+
+int pcr_replay_events(PCR_BankSet *set, TCG_EventLogCursor *cursor, size_t *events_replayed) {
+    PCR_ReplaySchedule schedule;
+    if (pcr_replay_schedule(set, cursor, &schedule) != 0) {
+        return -1;
+    }
+
+    int rc = 0;
+    for (uint32_t b = 0; b < set->bank_count && rc == 0; b++) {
+        rc = pcr_replay_schedule_run(set, &schedule, b, PCR_ALL_PCRS);
+    }
+
+    if (rc == 0 && events_replayed) {
+        *events_replayed = schedule.event_count;
+    }
+    pcr_replay_schedule_free(&schedule);
+    return rc;
+}
+
+int pcr_replay_log(const uint8_t *event_log, size_t log_size, PCR_BankSet *set) {
+    TCG_EventLogCursor cursor;
+    TCG_LogStatus status = tcg_log_cursor_init(&cursor, event_log, log_size);
+    if (status != TCG_LOG_OK) {
+        fprintf(stderr, "Invalid event log header: %s\n", tcg_log_status_str(status));
+        return -1;
+    }
+    if (pcr_replay_init(set, &cursor) != 0) {
+        return -1;
+    }
+    return pcr_replay_events(set, &cursor, NULL);
+}
+
+int pcr_log_digest_update(uint8_t digest[PCR_LOG_DIGEST_SIZE], TCG_EventLogCursor *cursor) {
+    if (!digest || !cursor) {
+        return -1;
+    }
+
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (!ctx) {
+        fprintf(stderr, "Error creating digest context for log digest\n");
+        return -1;
+    }
+
+    int rc = 0;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    while ((status = tcg_log_cursor_next(cursor, &event)) == TCG_LOG_OK) {
+        if (EVP_DigestInit_ex(ctx, EVP_sha256(), NULL) != 1 ||
+            EVP_DigestUpdate(ctx, digest, PCR_LOG_DIGEST_SIZE) != 1 ||
+            EVP_DigestUpdate(ctx, cursor->log + event.offset, event.length) != 1 ||
+            EVP_DigestFinal_ex(ctx, digest, NULL) != 1) {
+            rc = -1;
+            break;
+        }
+    }
+    if (rc == 0 && status != TCG_LOG_END) {
+        fprintf(stderr, "Event %zu at offset %zu: %s\n", cursor->record_num + 1, cursor->offset,
+                tcg_log_status_str(status));
+        rc = -1;
+    }
+
+    EVP_MD_CTX_free(ctx);
+    return rc;
+}
+
+const PCR_Bank *pcr_bankset_find(const PCR_BankSet *set, TPM2_ALG_ID alg) {
+    if (!set) {
+        return NULL;
+    }
+    for (uint32_t b = 0; b < set->bank_count; b++) {
+        if (set->banks[b].alg == alg) {
+            return &set->banks[b];
+        }
+    }
+    return NULL;
+}
+
+int pcr_bankset_read(const PCR_BankSet *set, TPM2_ALG_ID alg, uint32_t *pcr_mask, TPML_DIGEST *digests) {
+    const PCR_Bank *bank = pcr_bankset_find(set, alg);
+    if (!bank || !pcr_mask || !digests) {
+        return -1;
+    }
+
+    digests->count = 0;
+    for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT && digests->count < PCR_DIGESTS_PER_READ; pcr++) {
+        if (*pcr_mask & (1u << pcr)) {
+            digests->digests[digests->count++] = bank->pcrs[pcr];
+            *pcr_mask &= ~(1u << pcr);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+// sha256_extend.c
+// SHA-256 PCR extend kernels: portable scalar, Intel SHA extensions (SHA-NI) and an AVX2 kernel that extends eight
+// independent chains at once. The x86 kernels are compiled with per-function target attributes so the file builds
+// without special flags; callers pick a kernel at runtime with sha256_cpu_has_shani()/sha256_cpu_has_avx2().
+
+#include <string.h>
+#include "sha256_extend.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA256_EXTEND_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// K[t] + W[t] for the padding block of a 64-byte message (0x80, zeros, bit length 512). The block is the same for
+// every extend, so its message schedule is folded into the round constants once.
+static const uint32_t SHA256_PAD_KW[64] = {
+    0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf374,
+    0x649b69c1, 0xf0fe4786, 0x0fe1edc6, 0x240cf254, 0x4fe9346f, 0x6cc984be, 0x61b9411e, 0x16f988fa,
+    0xf2c65152, 0xa88e5a6d, 0xb019fc65, 0xb9d99ec7, 0x9a1231c3, 0xe70eeaa0, 0xfdb1232b, 0xc7353eb0,
+    0x3069bad5, 0xcb976d5f, 0x5a0f118f, 0xdc1eeefd, 0x0a35b689, 0xde0b7a04, 0x58f4ca9d, 0xe15d5b16,
+    0x007f3e86, 0x37088980, 0xa507ea32, 0x6fab9537, 0x17406110, 0x0d8cd6f1, 0xcdaa3b6d, 0xc0bbbe37,
+    0x83613bda, 0xdb48a363, 0x0b02e931, 0x6fd15ca7, 0x521afaca, 0x31338431, 0x6ed41a95, 0x6d437890,
+    0xc39c91f2, 0x9eccabbd, 0xb5c9a0e6, 0x532fb63c, 0xd2c741c6, 0x07237ea3, 0xa4954b68, 0x4c191d76
+};
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+// Scalar kernel
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x) (ROTR32(x, 2) ^ ROTR32(x, 13) ^ ROTR32(x, 22))
+#define BSIG1(x) (ROTR32(x, 6) ^ ROTR32(x, 11) ^ ROTR32(x, 25))
+#define SSIG0(x) (ROTR32(x, 7) ^ ROTR32(x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROTR32(x, 17) ^ ROTR32(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+/**
+ * @brief Runs the 64 rounds over a precomputed K[t] + W[t] schedule and adds the result into the state.
+ */
+static void sha256_rounds_scalar(uint32_t h[8], const uint32_t kw[64]) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    for (int t = 0; t < 64; t++) {
+        uint32_t t1 = hh + BSIG1(e) + CH(e, f, g) + kw[t];
+        uint32_t t2 = BSIG0(a) + MAJ(a, b, c);
+        hh = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+void sha256_extend_scalar(uint32_t state[8], const uint8_t digest[32]) {
+    uint32_t w[64];
+    uint32_t kw[64];
+
+    // Message block: the current PCR value followed by the event digest.
+    for (int t = 0; t < 8; t++) {
+        w[t] = state[t];
+        w[t + 8] = load_be32(digest + 4 * t);
+    }
+    for (int t = 16; t < 64; t++) {
+        w[t] = SSIG1(w[t - 2]) + w[t - 7] + SSIG0(w[t - 15]) + w[t - 16];
+    }
+    for (int t = 0; t < 64; t++) {
+        kw[t] = SHA256_K[t] + w[t];
+    }
+
+    uint32_t h[8];
+    memcpy(h, SHA256_IV, sizeof(h));
+    sha256_rounds_scalar(h, kw);
+    sha256_rounds_scalar(h, SHA256_PAD_KW);
+    memcpy(state, h, sizeof(h));
+}
+
+#ifdef SHA256_EXTEND_X86
+
+// SHA-NI kernel
+
+#define SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+/**
+ * @brief Four rounds with the SHA-NI round instruction; kw holds K[t] + W[t] for those rounds.
+ */
+SHANI_TARGET static inline void shani_rounds4(__m128i *state0, __m128i *state1, __m128i kw) {
+    *state1 = _mm_sha256rnds2_epu32(*state1, *state0, kw);
+    kw = _mm_shuffle_epi32(kw, 0x0E);
+    *state0 = _mm_sha256rnds2_epu32(*state0, *state1, kw);
+}
+
+SHANI_TARGET void sha256_extend_shani(uint32_t state[8], const uint8_t digest[32]) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // ABEF/CDGH register layout of the initial state.
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&SHA256_IV[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&SHA256_IV[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    __m128i iv0 = state0;
+    __m128i iv1 = state1;
+
+    // First block: the PCR words are already in schedule order, only the digest needs byte swapping.
+    __m128i msg[4];
+    msg[0] = _mm_loadu_si128((const __m128i *)&state[0]);
+    msg[1] = _mm_loadu_si128((const __m128i *)&state[4]);
+    msg[2] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)digest), byte_swap);
+    msg[3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(digest + 16)), byte_swap);
+
+    for (int i = 0; i < 16; i++) {
+        if (i >= 4) {
+            // W[4i..4i+3] from the previous four schedule groups; msg[i & 3] holds group i - 4.
+            __m128i w = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+            w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+            msg[i & 3] = _mm_sha256msg2_epu32(w, msg[(i + 3) & 3]);
+        }
+        __m128i kw = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *)&SHA256_K[4 * i]));
+        shani_rounds4(&state0, &state1, kw);
+    }
+    state0 = _mm_add_epi32(state0, iv0);
+    state1 = _mm_add_epi32(state1, iv1);
+
+    // Padding block with its precomputed schedule.
+    __m128i save0 = state0;
+    __m128i save1 = state1;
+    for (int i = 0; i < 16; i++) {
+        shani_rounds4(&state0, &state1, _mm_loadu_si128((const __m128i *)&SHA256_PAD_KW[4 * i]));
+    }
+    state0 = _mm_add_epi32(state0, save0);
+    state1 = _mm_add_epi32(state1, save1);
+
+    // Back from ABEF/CDGH to A..H.
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+// AVX2 multi-buffer kernel
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+#define V_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define V_BSIG0(x) _mm256_xor_si256(_mm256_xor_si256(V_ROTR(x, 2), V_ROTR(x, 13)), V_ROTR(x, 22))
+#define V_BSIG1(x) _mm256_xor_si256(_mm256_xor_si256(V_ROTR(x, 6), V_ROTR(x, 11)), V_ROTR(x, 25))
+#define V_SSIG0(x) _mm256_xor_si256(_mm256_xor_si256(V_ROTR(x, 7), V_ROTR(x, 18)), _mm256_srli_epi32((x), 3))
+#define V_SSIG1(x) _mm256_xor_si256(_mm256_xor_si256(V_ROTR(x, 17), V_ROTR(x, 19)), _mm256_srli_epi32((x), 10))
+#define V_CH(x, y, z) _mm256_xor_si256(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define V_MAJ(x, y, z) _mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256(_mm256_or_si256((x), (y)), (z)))
+
+/**
+ * @brief Runs the 64 rounds for eight lanes and adds the result into the state.
+ *
+ * @param h   Per-word state vectors, lane i holding chain i.
+ * @param w   Message schedule vectors, or NULL for the padding block.
+ */
+AVX2_TARGET static void sha256_rounds_avx2(__m256i h[8], const __m256i *w) {
+    __m256i a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+
+    for (int t = 0; t < 64; t++) {
+        __m256i kw = w ? _mm256_add_epi32(w[t], _mm256_set1_epi32((int)SHA256_K[t]))
+                       : _mm256_set1_epi32((int)SHA256_PAD_KW[t]);
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(hh, V_BSIG1(e)), _mm256_add_epi32(V_CH(e, f, g), kw));
+        __m256i t2 = _mm256_add_epi32(V_BSIG0(a), V_MAJ(a, b, c));
+        hh = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+
+    h[0] = _mm256_add_epi32(h[0], a); h[1] = _mm256_add_epi32(h[1], b);
+    h[2] = _mm256_add_epi32(h[2], c); h[3] = _mm256_add_epi32(h[3], d);
+    h[4] = _mm256_add_epi32(h[4], e); h[5] = _mm256_add_epi32(h[5], f);
+    h[6] = _mm256_add_epi32(h[6], g); h[7] = _mm256_add_epi32(h[7], hh);
+}
+
+AVX2_TARGET void sha256_extend_avx2_x8(uint32_t *states[SHA256_EXTEND_LANES],
+                                       const uint8_t *digests[SHA256_EXTEND_LANES]) {
+    __m256i w[64];
+
+    // Transpose the eight message blocks into per-word vectors.
+    for (int t = 0; t < 8; t++) {
+        w[t] = _mm256_set_epi32((int)states[7][t], (int)states[6][t], (int)states[5][t], (int)states[4][t],
+                                (int)states[3][t], (int)states[2][t], (int)states[1][t], (int)states[0][t]);
+        w[t + 8] = _mm256_set_epi32((int)load_be32(digests[7] + 4 * t), (int)load_be32(digests[6] + 4 * t),
+                                    (int)load_be32(digests[5] + 4 * t), (int)load_be32(digests[4] + 4 * t),
+                                    (int)load_be32(digests[3] + 4 * t), (int)load_be32(digests[2] + 4 * t),
+                                    (int)load_be32(digests[1] + 4 * t), (int)load_be32(digests[0] + 4 * t));
+    }
+    for (int t = 16; t < 64; t++) {
+        w[t] = _mm256_add_epi32(_mm256_add_epi32(V_SSIG1(w[t - 2]), w[t - 7]),
+                                _mm256_add_epi32(V_SSIG0(w[t - 15]), w[t - 16]));
+    }
+
+    __m256i h[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = _mm256_set1_epi32((int)SHA256_IV[i]);
+    }
+    sha256_rounds_avx2(h, w);
+    sha256_rounds_avx2(h, NULL);
+
+    // Transpose back into the per-chain states.
+    uint32_t out[8][SHA256_EXTEND_LANES];
+    for (int i = 0; i < 8; i++) {
+        _mm256_storeu_si256((__m256i *)out[i], h[i]);
+    }
+    for (int lane = 0; lane < SHA256_EXTEND_LANES; lane++) {
+        for (int i = 0; i < 8; i++) {
+            states[lane][i] = out[i][lane];
+        }
+    }
+}
+
+// CPU feature detection
+
+bool sha256_cpu_has_shani(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & bit_SHA) != 0;
+}
+
+bool sha256_cpu_has_avx2(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+        return false;
+    }
+    // The OS must save the YMM state across context switches.
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6) != 0x6) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & bit_AVX2) != 0;
+}
+
+#else // !SHA256_EXTEND_X86
+
+void sha256_extend_shani(uint32_t state[8], const uint8_t digest[32]) {
+    sha256_extend_scalar(state, digest);
+}
+
+void sha256_extend_avx2_x8(uint32_t *states[SHA256_EXTEND_LANES], const uint8_t *digests[SHA256_EXTEND_LANES]) {
+    for (int lane = 0; lane < SHA256_EXTEND_LANES; lane++) {
+        sha256_extend_scalar(states[lane], digests[lane]);
+    }
+}
+
+bool sha256_cpu_has_shani(void) {
+    return false;
+}
+
+bool sha256_cpu_has_avx2(void) {
+    return false;
+}
+
+#endif // SHA256_EXTEND_X86
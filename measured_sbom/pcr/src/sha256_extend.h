@@ -0,0 +1,23 @@
+// sha256_extend.h
+// SHA-256 PCR extend kernels used by the replay engine. Not part of the public pcr.h API.
+#ifndef SHA256_EXTEND_H
+#define SHA256_EXTEND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SHA256_EXTEND_LANES 8   /**< Chains processed per call of the multi-buffer kernel */
+
+/*
+ * Every kernel computes state = SHA-256(state || digest) for a 32-byte digest. The PCR value is kept as eight
+ * big-endian words between extends, so it is fed to the compression function as message words without byte
+ * swapping. The 64-byte message always needs exactly one padding block whose schedule is a constant.
+ */
+void sha256_extend_scalar(uint32_t state[8], const uint8_t digest[32]);
+void sha256_extend_shani(uint32_t state[8], const uint8_t digest[32]);
+void sha256_extend_avx2_x8(uint32_t *states[SHA256_EXTEND_LANES], const uint8_t *digests[SHA256_EXTEND_LANES]);
+
+bool sha256_cpu_has_shani(void);
+bool sha256_cpu_has_avx2(void);
+
+#endif // SHA256_EXTEND_H
@@ -0,0 +1,401 @@
+// fleet_sim.c
+// Fleet load simulator. Runs thousands of simulated attestors against the real verifier in one process, at an
+// open-loop arrival rate, and reports sustained attestations per second, tail latency and failures.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "verifier.h"
+#include "verifier_daemon.h"
+#include "attestor.h"
+#include "attestor_fleet.h"
+
+#define FLEET_SIM_DEFAULT_DEVICES 1000
+#define FLEET_SIM_DEFAULT_RATE 500
+#define FLEET_SIM_DEFAULT_DURATION 60
+#define FLEET_SIM_DEFAULT_TIMEOUT_MS 10000
+#define FLEET_SIM_DEFAULT_REPORT_S 5
+
+static VerifierDaemon *running_daemon = NULL;
+
+static void handle_stop_signal(int signum) {
+    (void)signum;
+    if (running_daemon) {
+        verifier_daemon_stop(running_daemon);
+    }
+}
+
+/**
+ * @struct SimReporter
+ * @brief Prints progress while the daemon runs.
+ */
+typedef struct {
+    FILE *out;
+    const VerifierDaemon *daemon;
+    const AttestorFleet *fleet;
+    unsigned int interval_s;
+    atomic_bool done;
+} SimReporter;
+
+static double monotonic_s(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *reporter_main(void *arg) {
+    SimReporter *reporter = arg;
+    struct timespec tick = { .tv_sec = 0, .tv_nsec = 100000000 };
+    double start = monotonic_s();
+    double last = start;
+    uint64_t last_count = 0;
+
+    while (!atomic_load(&reporter->done)) {
+        nanosleep(&tick, NULL);
+        double now = monotonic_s();
+        if (now - last < reporter->interval_s) {
+            continue;
+        }
+        VerifierDaemonStats stats;
+        AttestorFleetStats fleet_stats;
+        verifier_daemon_get_stats(reporter->daemon, &stats);
+        attestor_fleet_get_stats(reporter->fleet, &fleet_stats);
+        fprintf(reporter->out,
+                "%6.0fs  %8.1f att/s  p50 %7.2f ms  p99 %7.2f ms  failed %llu  I/O errors %llu  dropped %llu  "
+                "reboots %llu\n",
+                now - start, (double)(stats.attestations - last_count) / (now - last), stats.latency_p50_us / 1e3,
+                stats.latency_p99_us / 1e3, (unsigned long long)stats.failed, (unsigned long long)stats.io_errors,
+                (unsigned long long)stats.dropped, (unsigned long long)fleet_stats.reboots);
+        fflush(reporter->out);
+        last = now;
+        last_count = stats.attestations;
+    }
+    return NULL;
+}
+
+/**
+ * @struct SimRimUpdater
+ * @brief Publishes a new version of the fleet's RIM periodically while the daemon runs, as a firmware rollout would.
+ */
+typedef struct {
+    RimStore *store;
+    const AttestorFleet *fleet;
+    unsigned int interval_s;
+    atomic_bool done;
+} SimRimUpdater;
+
+/**
+ * @brief Builds the fleet's RIM and publishes it. A marker entry names the update, so every version has its own
+ * content digest and the verifier treats it as a new RIM.
+ */
+static int publish_fleet_rim(RimStore *store, const AttestorFleet *fleet, uint64_t update) {
+    RIM_Index rim_index;
+    char marker[64];
+    uint8_t marker_digest[TPM2_SHA256_DIGEST_SIZE] = { 0 };
+    if (rim_index_init(&rim_index, 0) != 0) {
+        return -1;
+    }
+    int name_len = snprintf(marker, sizeof(marker), "fleet_sim-rim-update-%llu", (unsigned long long)update);
+    memcpy(marker_digest, &update, sizeof(update));
+    if (attestor_fleet_fill_rim(fleet, &rim_index) != 0 ||
+        rim_index_add(&rim_index, marker, (size_t)name_len, TPM2_ALG_SHA256, marker_digest,
+                      sizeof(marker_digest)) != 0 ||
+        rim_store_publish(store, &rim_index, 0, NULL) != 0) {
+        rim_index_free(&rim_index);
+        return -1;
+    }
+    return 0;
+}
+
+static void *rim_updater_main(void *arg) {
+    SimRimUpdater *updater = arg;
+    struct timespec tick = { .tv_sec = 0, .tv_nsec = 100000000 };
+    double last = monotonic_s();
+    uint64_t update = 0;
+
+    while (!atomic_load(&updater->done)) {
+        nanosleep(&tick, NULL);
+        rim_store_reclaim(updater->store);
+        double now = monotonic_s();
+        if (now - last >= updater->interval_s) {
+            publish_fleet_rim(updater->store, updater->fleet, ++update);
+            last = now;
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -N <count>  Simulated attestors (default: %d)\n"
+            "  -r <rate>   Attestations started per second across the fleet, open loop (default: %d)\n"
+            "  -d <secs>   Duration of the run (default: %d)\n"
+            "  -w <count>  Verification threads (default: one per CPU)\n"
+            "  -t <ms>     Response timeout (default: %d)\n"
+            "  -g <rate>   Runtime records each attestor appends per minute (default: 1)\n"
+            "  -R <rate>   Reboots per attestor per hour (default: 1/24)\n"
+            "  -x <frac>   Share of appended records unknown to the RIM, failing their attestors (default: 0)\n"
+            "  -E <count>  Events in each boot log (default: 100)\n"
+            "  -F <count>  Firmware builds, i.e. distinct boot logs (default: 16)\n"
+            "  -C <count>  Distinct runtime measurements (default: 4096)\n"
+            "  -b <banks>  Digest banks of the logs (default: sha1,sha256)\n"
+            "  -V <count>  Log verdicts cached across attestors (default: 0, disabled)\n"
+            "  -D <file>   Compress logs in transit with this zstd dictionary, e.g. log_dict_train -g <builds>\n"
+            "  -A <dir>    Archive every verified log in <dir> and report how well it deduplicates\n"
+            "  -U <secs>   Publish a new RIM version every <secs> while the fleet runs (default: 0, never)\n"
+            "  -s <seed>   Seed of the fleet and the arrivals (default: 1)\n"
+            "  -i <secs>   Seconds between progress reports (default: %d, 0 disables them)\n"
+            "  -v          Keep the verifier's per-event output on stdout\n",
+            program, FLEET_SIM_DEFAULT_DEVICES, FLEET_SIM_DEFAULT_RATE, FLEET_SIM_DEFAULT_DURATION,
+            FLEET_SIM_DEFAULT_TIMEOUT_MS, FLEET_SIM_DEFAULT_REPORT_S);
+}
+
+int main(int argc, char *argv[]) {
+    VerifierDaemonConfig config = { .timeout_ms = FLEET_SIM_DEFAULT_TIMEOUT_MS,
+                                    .arrival_rate = FLEET_SIM_DEFAULT_RATE };
+    AttestorFleetConfig fleet_config;
+    size_t device_count = FLEET_SIM_DEFAULT_DEVICES;
+    unsigned int duration_s = FLEET_SIM_DEFAULT_DURATION;
+    unsigned int report_s = FLEET_SIM_DEFAULT_REPORT_S;
+    double growth_per_minute = 1;
+    double reboot_rate = 1.0 / 24;
+    double rogue_fraction = 0;
+    size_t boot_events = 100;
+    uint32_t firmware_builds = 16;
+    size_t catalog_size = 4096;
+    const char *banks = "sha1,sha256";
+    size_t verdict_capacity = 0;
+    const char *dictionary_file = NULL;
+    const char *archive_dir = NULL;
+    unsigned int rim_update_s = 0;
+    uint64_t seed = 1;
+    bool verbose = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "N:r:d:w:t:g:R:x:E:F:C:b:V:D:A:U:s:i:vh")) != -1) {
+        switch (opt) {
+            case 'N': device_count = strtoul(optarg, NULL, 10); break;
+            case 'r': config.arrival_rate = strtod(optarg, NULL); break;
+            case 'd': duration_s = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'w': config.num_workers = strtoul(optarg, NULL, 10); break;
+            case 't': config.timeout_ms = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'g': growth_per_minute = strtod(optarg, NULL); break;
+            case 'R': reboot_rate = strtod(optarg, NULL); break;
+            case 'x': rogue_fraction = strtod(optarg, NULL); break;
+            case 'E': boot_events = strtoul(optarg, NULL, 10); break;
+            case 'F': firmware_builds = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'C': catalog_size = strtoul(optarg, NULL, 10); break;
+            case 'b': banks = optarg; break;
+            case 'V': verdict_capacity = strtoul(optarg, NULL, 10); break;
+            case 'D': dictionary_file = optarg; break;
+            case 'A': archive_dir = optarg; break;
+            case 'U': rim_update_s = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'i': report_s = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'v': verbose = true; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (device_count == 0 || config.arrival_rate <= 0 || duration_s == 0 || firmware_builds == 0 ||
+        catalog_size == 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    attestor_fleet_config_init(&fleet_config, device_count, seed);
+    fleet_config.boot_log.event_count = boot_events;
+    fleet_config.firmware_builds = firmware_builds;
+    fleet_config.catalog_size = catalog_size;
+    fleet_config.growth_rate = growth_per_minute / 60;
+    fleet_config.reboot_rate = reboot_rate;
+    fleet_config.rogue_fraction = rogue_fraction;
+    if (log_generator_parse_banks(&fleet_config.boot_log, banks) != 0) {
+        return EXIT_FAILURE;
+    }
+    config.arrival_seed = seed;
+
+    // The verifier logs every event it checks; the report goes to the original stdout
+    FILE *out = stdout;
+    if (!verbose) {
+        int report_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        out = report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+        if (!out || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+            fprintf(stderr, "Error redirecting stdout\n");
+            return EXIT_FAILURE;
+        }
+        close(null_fd);
+    }
+
+    int rc = EXIT_FAILURE;
+    int *fds = calloc(device_count, sizeof(*fds));
+    AttestorFleet *fleet = NULL;
+    CheckpointStore *checkpoints = NULL;
+    AK_Cache *ak_cache = NULL;
+    VerdictCache *verdicts = NULL;
+    VerifierDaemon *daemon = NULL;
+    LogDictionary dictionary = { 0 };
+    EventArchive *archive = NULL;
+    RimStore *rim_store = NULL;
+    size_t added = 0;
+
+    fprintf(out, "Creating %zu simulated attestors\n", device_count);
+    fflush(out);
+    fleet = fds ? attestor_fleet_create(&fleet_config, fds) : NULL;
+    rim_store = fleet ? rim_store_create() : NULL;
+    if (!rim_store || publish_fleet_rim(rim_store, fleet, 0) != 0) {
+        goto cleanup;
+    }
+    checkpoints = checkpoint_store_create(NULL);
+    ak_cache = ak_cache_create(NULL);
+    if (!checkpoints || !ak_cache) {
+        goto cleanup;
+    }
+    for (size_t i = 0; i < device_count; i++) {
+        const uint8_t *ak_public;
+        size_t ak_public_size;
+        if (attestor_fleet_ak_public(fleet, i, &ak_public, &ak_public_size) != 0 ||
+            ak_cache_add(ak_cache, ak_public, ak_public_size, NULL, NULL) != 0) {
+            goto cleanup;
+        }
+    }
+    verifier_set_rim_store(rim_store);
+    verifier_set_checkpoint_store(checkpoints);
+    verifier_set_ak_cache(ak_cache);
+    if (verdict_capacity > 0) {
+        verdicts = verdict_cache_create(verdict_capacity);
+        if (!verdicts) {
+            goto cleanup;
+        }
+        verifier_set_verdict_cache(verdicts, 0);
+    }
+    if (dictionary_file) {
+        // Both ends of every simulated connection share the dictionary
+        if (log_dictionary_load(&dictionary, dictionary_file, LOG_DICTIONARY_DEFAULT_LEVEL) != 0) {
+            goto cleanup;
+        }
+        attestor_set_log_dictionary(&dictionary);
+        verifier_set_log_dictionary(&dictionary);
+    }
+    if (archive_dir) {
+        archive = event_archive_open(archive_dir);
+        if (!archive) {
+            goto cleanup;
+        }
+        verifier_set_event_archive(archive);
+    }
+
+    daemon = verifier_daemon_create(&config);
+    if (!daemon) {
+        goto cleanup;
+    }
+    for (; added < device_count; added++) {
+        if (verifier_daemon_add_attestor_fd(daemon, fds[added]) != 0) {
+            goto cleanup;
+        }
+    }
+    if (attestor_fleet_start(fleet) != 0) {
+        goto cleanup;
+    }
+
+    running_daemon = daemon;
+    struct sigaction action = { .sa_handler = handle_stop_signal };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGALRM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    SimReporter reporter = { .out = out, .daemon = daemon, .fleet = fleet, .interval_s = report_s };
+    pthread_t reporter_thread;
+    bool reporting = report_s > 0 && pthread_create(&reporter_thread, NULL, reporter_main, &reporter) == 0;
+    SimRimUpdater updater = { .store = rim_store, .fleet = fleet, .interval_s = rim_update_s };
+    pthread_t updater_thread;
+    bool updating = rim_update_s > 0 && pthread_create(&updater_thread, NULL, rim_updater_main, &updater) == 0;
+    fprintf(out, "Offering %.0f attestations/s for %u s\n", config.arrival_rate, duration_s);
+    fflush(out);
+
+    double start = monotonic_s();
+    alarm(duration_s);
+    int run_rc = verifier_daemon_run(daemon);
+    double elapsed = monotonic_s() - start;
+    running_daemon = NULL;
+    if (reporting) {
+        atomic_store(&reporter.done, true);
+        pthread_join(reporter_thread, NULL);
+    }
+    if (updating) {
+        atomic_store(&updater.done, true);
+        pthread_join(updater_thread, NULL);
+    }
+
+    VerifierDaemonStats stats;
+    AttestorFleetStats fleet_stats;
+    verifier_daemon_get_stats(daemon, &stats);
+    attestor_fleet_get_stats(fleet, &fleet_stats);
+    fprintf(out, "\nAttestors:            %zu\n", device_count);
+    fprintf(out, "Offered rate:         %.1f/s\n", config.arrival_rate);
+    fprintf(out, "Sustained rate:       %.1f/s over %.1f s\n", (double)stats.attestations / elapsed, elapsed);
+    fprintf(out, "Attestations:         %llu (%llu passed, %llu failed)\n", (unsigned long long)stats.attestations,
+            (unsigned long long)stats.passed, (unsigned long long)stats.failed);
+    fprintf(out, "I/O errors:           %llu\n", (unsigned long long)stats.io_errors);
+    fprintf(out, "Dropped arrivals:     %llu\n", (unsigned long long)stats.dropped);
+    fprintf(out, "Latency p50/p99/p999: %.2f / %.2f / %.2f ms, max %.2f ms\n", stats.latency_p50_us / 1e3,
+            stats.latency_p99_us / 1e3, stats.latency_p999_us / 1e3, stats.latency_max_us / 1e3);
+    fprintf(out, "Fleet:                %llu requests answered, %llu records appended (%llu rogue), %llu reboots\n",
+            (unsigned long long)fleet_stats.requests, (unsigned long long)fleet_stats.records_appended,
+            (unsigned long long)fleet_stats.rogue_records, (unsigned long long)fleet_stats.reboots);
+    if (updating) {
+        RimStoreStats rim_stats;
+        rim_store_get_stats(rim_store, &rim_stats);
+        fprintf(out, "RIM:                  %llu versions published, %llu reclaimed, %llu awaiting readers\n",
+                (unsigned long long)rim_stats.published, (unsigned long long)rim_stats.reclaimed,
+                (unsigned long long)rim_stats.retired);
+    }
+    if (archive) {
+        ArchiveStats archive_stats;
+        event_archive_get_stats(archive, &archive_stats);
+        fprintf(out, "Archive:              %llu attestations, %.1f MB of logs in %.1f MB of new chunks (%.0fx), "
+                "%llu chunks, %.1f MB on disk\n",
+                (unsigned long long)archive_stats.appended, archive_stats.log_bytes / 1e6,
+                archive_stats.chunk_bytes / 1e6,
+                archive_stats.chunk_bytes ? (double)archive_stats.log_bytes / (double)archive_stats.chunk_bytes : 0.0,
+                (unsigned long long)archive_stats.chunks, archive_stats.stored_bytes / 1e6);
+    }
+    rc = run_rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+cleanup:
+    // The daemon owns the descriptors it accepted
+    for (size_t i = added; fds && fleet && i < device_count; i++) {
+        close(fds[i]);
+    }
+    verifier_daemon_destroy(daemon);
+    attestor_fleet_destroy(fleet);
+    attestor_set_log_dictionary(NULL);
+    verifier_set_log_dictionary(NULL);
+    log_dictionary_free(&dictionary);
+    verifier_set_event_archive(NULL);
+    event_archive_close(archive);
+    verifier_set_verdict_cache(NULL, 0);
+    verdict_cache_destroy(verdicts);
+    verifier_set_ak_cache(NULL);
+    ak_cache_destroy(ak_cache);
+    checkpoint_store_destroy(checkpoints);
+    verifier_set_rim_store(NULL);
+    rim_store_destroy(rim_store);
+    free(fds);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return rc;
+}
@@ -0,0 +1,167 @@
+// soft_ak.c
+// Software attestation key that signs TPM-format quotes, for simulated attestors that load-test a verifier.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_names.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <tss2/tss2_mu.h>
+#include "soft_ak.h"
+
+#define SOFT_AK_ATTRIBUTES (TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_FIXEDPARENT | TPMA_OBJECT_SENSITIVEDATAORIGIN | \
+                            TPMA_OBJECT_USERWITHAUTH | TPMA_OBJECT_RESTRICTED | TPMA_OBJECT_SIGN_ENCRYPT)
+
+int soft_ak_create(SoftAK *ak) {
+    TPMT_PUBLIC public_area;
+    BIGNUM *x = NULL;
+    BIGNUM *y = NULL;
+    memset(ak, 0, sizeof(*ak));
+    memset(&public_area, 0, sizeof(public_area));
+
+    ak->key = EVP_PKEY_Q_keygen(NULL, NULL, "EC", "P-256");
+    if (!ak->key || EVP_PKEY_get_bn_param(ak->key, OSSL_PKEY_PARAM_EC_PUB_X, &x) != 1 ||
+        EVP_PKEY_get_bn_param(ak->key, OSSL_PKEY_PARAM_EC_PUB_Y, &y) != 1) {
+        BN_free(x);
+        fprintf(stderr, "Error creating software attestation key\n");
+        soft_ak_free(ak);
+        return -1;
+    }
+    public_area.type = TPM2_ALG_ECC;
+    public_area.nameAlg = TPM2_ALG_SHA256;
+    public_area.objectAttributes = SOFT_AK_ATTRIBUTES;
+    public_area.parameters.eccDetail.symmetric.algorithm = TPM2_ALG_NULL;
+    public_area.parameters.eccDetail.scheme.scheme = TPM2_ALG_ECDSA;
+    public_area.parameters.eccDetail.scheme.details.ecdsa.hashAlg = TPM2_ALG_SHA256;
+    public_area.parameters.eccDetail.curveID = TPM2_ECC_NIST_P256;
+    public_area.parameters.eccDetail.kdf.scheme = TPM2_ALG_NULL;
+    public_area.unique.ecc.x.size = 32;
+    public_area.unique.ecc.y.size = 32;
+    BN_bn2binpad(x, public_area.unique.ecc.x.buffer, 32);
+    BN_bn2binpad(y, public_area.unique.ecc.y.buffer, 32);
+    BN_free(x);
+    BN_free(y);
+
+    size_t offset = sizeof(UINT16);
+    if (Tss2_MU_TPMT_PUBLIC_Marshal(&public_area, ak->public_blob, sizeof(ak->public_blob), &offset) !=
+        TSS2_RC_SUCCESS) {
+        soft_ak_free(ak);
+        return -1;
+    }
+    size_t area_size = offset - sizeof(UINT16);
+    ak->public_blob[0] = (uint8_t)(area_size >> 8);
+    ak->public_blob[1] = (uint8_t)area_size;
+    ak->public_size = offset;
+
+    unsigned int digest_size = 0;
+    ak->name.name[0] = (uint8_t)(TPM2_ALG_SHA256 >> 8);
+    ak->name.name[1] = (uint8_t)TPM2_ALG_SHA256;
+    if (EVP_Digest(ak->public_blob + sizeof(UINT16), area_size, ak->name.name + 2, &digest_size, EVP_sha256(),
+                   NULL) != 1) {
+        soft_ak_free(ak);
+        return -1;
+    }
+    ak->name.size = (UINT16)(2 + digest_size);
+
+    // A hierarchy's qualified name is its handle
+    const uint8_t endorsement[sizeof(TPM2_HANDLE)] = {
+        (uint8_t)(TPM2_RH_ENDORSEMENT >> 24), (uint8_t)(TPM2_RH_ENDORSEMENT >> 16),
+        (uint8_t)(TPM2_RH_ENDORSEMENT >> 8), (uint8_t)TPM2_RH_ENDORSEMENT,
+    };
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    ak->qualified_name.name[0] = ak->name.name[0];
+    ak->qualified_name.name[1] = ak->name.name[1];
+    int ok = md_ctx && EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) == 1 &&
+             EVP_DigestUpdate(md_ctx, endorsement, sizeof(endorsement)) == 1 &&
+             EVP_DigestUpdate(md_ctx, ak->name.name, ak->name.size) == 1 &&
+             EVP_DigestFinal_ex(md_ctx, ak->qualified_name.name + 2, &digest_size) == 1;
+    EVP_MD_CTX_free(md_ctx);
+    if (!ok) {
+        soft_ak_free(ak);
+        return -1;
+    }
+    ak->qualified_name.size = (UINT16)(2 + digest_size);
+    return 0;
+}
+
+void soft_ak_free(SoftAK *ak) {
+    EVP_PKEY_free(ak->key);
+    ak->key = NULL;
+}
+
+int soft_quote_state_init(SoftQuoteState *state, const PCR_BankSet *pcrs) {
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    unsigned int digest_size = 0;
+    int ok = md_ctx && EVP_DigestInit_ex(md_ctx, EVP_sha256(), NULL) == 1 && pcrs->bank_count > 0 &&
+             pcrs->bank_count <= TPM2_NUM_PCR_BANKS;
+
+    memset(state, 0, sizeof(*state));
+    for (uint32_t b = 0; ok && b < pcrs->bank_count; b++) {
+        const PCR_Bank *bank = &pcrs->banks[b];
+        TPMS_PCR_SELECTION *selection = &state->selection.pcrSelections[state->selection.count++];
+        selection->hash = bank->alg;
+        selection->sizeofSelect = TPM_PCR_COUNT / 8;
+        for (int i = 0; i < TPM_PCR_COUNT; i++) {
+            selection->pcrSelect[i / 8] |= (BYTE)(1u << (i % 8));
+            ok = ok && EVP_DigestUpdate(md_ctx, bank->pcrs[i].buffer, bank->pcrs[i].size) == 1;
+        }
+    }
+    ok = ok && EVP_DigestFinal_ex(md_ctx, state->digest.buffer, &digest_size) == 1;
+    EVP_MD_CTX_free(md_ctx);
+    state->digest.size = (UINT16)digest_size;
+    return ok ? 0 : -1;
+}
+
+size_t soft_ak_quote(const SoftAK *ak, const SoftQuoteState *state, const uint8_t *nonce, size_t nonce_size,
+                     uint8_t *quote, size_t capacity) {
+    TPMS_ATTEST attest;
+    memset(&attest, 0, sizeof(attest));
+    if (nonce_size > sizeof(attest.extraData.buffer)) {
+        return 0;
+    }
+    attest.magic = TPM2_GENERATED_VALUE;
+    attest.type = TPM2_ST_ATTEST_QUOTE;
+    attest.qualifiedSigner = ak->qualified_name;
+    attest.extraData.size = (UINT16)nonce_size;
+    memcpy(attest.extraData.buffer, nonce, nonce_size);
+    attest.clockInfo.safe = 1;
+    attest.attested.quote.pcrSelect = state->selection;
+    attest.attested.quote.pcrDigest = state->digest;
+
+    // TPM2B_ATTEST: the size is written once the TPMS_ATTEST is marshaled behind it.
+    size_t offset = sizeof(UINT16);
+    if (Tss2_MU_TPMS_ATTEST_Marshal(&attest, quote, capacity, &offset) != TSS2_RC_SUCCESS) {
+        return 0;
+    }
+    size_t attest_size = offset - sizeof(UINT16);
+    quote[0] = (uint8_t)(attest_size >> 8);
+    quote[1] = (uint8_t)attest_size;
+
+    uint8_t der[160];
+    size_t der_size = sizeof(der);
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    int signed_ok = md_ctx && EVP_DigestSignInit(md_ctx, NULL, EVP_sha256(), NULL, ak->key) == 1 &&
+                    EVP_DigestSign(md_ctx, der, &der_size, quote + sizeof(UINT16), attest_size) == 1;
+    EVP_MD_CTX_free(md_ctx);
+    const uint8_t *der_cursor = der;
+    ECDSA_SIG *sig = signed_ok ? d2i_ECDSA_SIG(NULL, &der_cursor, (long)der_size) : NULL;
+    if (!sig) {
+        return 0;
+    }
+
+    TPMT_SIGNATURE signature;
+    memset(&signature, 0, sizeof(signature));
+    signature.sigAlg = TPM2_ALG_ECDSA;
+    signature.signature.ecdsa.hash = TPM2_ALG_SHA256;
+    signature.signature.ecdsa.signatureR.size = 32;
+    signature.signature.ecdsa.signatureS.size = 32;
+    BN_bn2binpad(ECDSA_SIG_get0_r(sig), signature.signature.ecdsa.signatureR.buffer, 32);
+    BN_bn2binpad(ECDSA_SIG_get0_s(sig), signature.signature.ecdsa.signatureS.buffer, 32);
+    ECDSA_SIG_free(sig);
+
+    if (Tss2_MU_TPMT_SIGNATURE_Marshal(&signature, quote, capacity, &offset) != TSS2_RC_SUCCESS) {
+        return 0;
+    }
+    return offset;
+}
@@ -0,0 +1,386 @@
+// transport.c
+// Length-prefixed framing over non-blocking stream sockets (TCP or Unix), with pooled frame buffers and write
+// queues that let many requests be outstanding on one connection. Used by both the verifier and the attestor.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "transport.h"
+
+// Bytes in front of every message: the pool bookkeeping and the length prefix, which directly precedes the message
+// so that a frame goes out as one iovec.
+#define FRAME_OVERHEAD (offsetof(TransportFrame, header) + TRANSPORT_FRAME_HEADER_SIZE)
+
+struct BufferPool {
+    pthread_mutex_t lock;
+    TransportFrame *free_lists[TRANSPORT_POOL_CLASSES];
+    size_t free_counts[TRANSPORT_POOL_CLASSES];
+};
+
+static uint8_t *frame_message(TransportFrame *frame) {
+    return (uint8_t *)frame + FRAME_OVERHEAD;
+}
+
+static TransportFrame *frame_of(uint8_t *message) {
+    return (TransportFrame *)(message - FRAME_OVERHEAD);
+}
+
+// Buffer pool
+
+BufferPool *buffer_pool_create(void) {
+    BufferPool *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        fprintf(stderr, "Error allocating memory for buffer pool\n");
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+void buffer_pool_destroy(BufferPool *pool) {
+    if (!pool) {
+        return;
+    }
+    for (size_t i = 0; i < TRANSPORT_POOL_CLASSES; i++) {
+        TransportFrame *frame = pool->free_lists[i];
+        while (frame) {
+            TransportFrame *next = frame->next;
+            free(frame);
+            frame = next;
+        }
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+static TransportFrame *frame_get(BufferPool *pool, size_t size) {
+    uint32_t size_class = 0;
+    while (size_class < TRANSPORT_POOL_CLASSES && ((size_t)TRANSPORT_POOL_MIN_SIZE << size_class) < size) {
+        size_class++;
+    }
+
+    TransportFrame *frame = NULL;
+    if (size_class < TRANSPORT_POOL_CLASSES) {
+        pthread_mutex_lock(&pool->lock);
+        frame = pool->free_lists[size_class];
+        if (frame) {
+            pool->free_lists[size_class] = frame->next;
+            pool->free_counts[size_class]--;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (!frame) {
+        size_t capacity = size_class < TRANSPORT_POOL_CLASSES ? (size_t)TRANSPORT_POOL_MIN_SIZE << size_class : size;
+        frame = malloc(FRAME_OVERHEAD + capacity);
+        if (!frame) {
+            fprintf(stderr, "Error allocating memory for frame buffer\n");
+            return NULL;
+        }
+        frame->size_class = size_class;
+    }
+    frame->next = NULL;
+    frame->size = (uint32_t)size;
+    return frame;
+}
+
+static void frame_put(BufferPool *pool, TransportFrame *frame) {
+    uint32_t size_class = frame->size_class;
+    if (size_class < TRANSPORT_POOL_CLASSES) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->free_counts[size_class] < TRANSPORT_POOL_MAX_CACHED) {
+            frame->next = pool->free_lists[size_class];
+            pool->free_lists[size_class] = frame;
+            pool->free_counts[size_class]++;
+            frame = NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    free(frame);
+}
+
+uint8_t *transport_frame_get(BufferPool *pool, size_t size) {
+    if (!pool || size > TRANSPORT_MAX_FRAME_SIZE) {
+        return NULL;
+    }
+    TransportFrame *frame = frame_get(pool, size);
+    return frame ? frame_message(frame) : NULL;
+}
+
+void transport_frame_put(BufferPool *pool, uint8_t *message) {
+    if (pool && message) {
+        frame_put(pool, frame_of(message));
+    }
+}
+
+// Sockets
+
+int transport_parse_address(const char *address, struct sockaddr_storage *addr, socklen_t *addr_len) {
+    memset(addr, 0, sizeof(*addr));
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un *un = (struct sockaddr_un *)addr;
+        const char *path = address + 5;
+        if (strlen(path) >= sizeof(un->sun_path)) {
+            fprintf(stderr, "Socket path too long: %s\n", path);
+            return -1;
+        }
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        *addr_len = sizeof(*un);
+        return 0;
+    }
+
+    const char *colon = strrchr(address, ':');
+    if (!colon || colon == address || colon[1] == '\0') {
+        fprintf(stderr, "Invalid address: %s\n", address);
+        return -1;
+    }
+    char host[256];
+    size_t host_len = (size_t)(colon - address);
+    if (host_len >= sizeof(host)) {
+        fprintf(stderr, "Invalid address: %s\n", address);
+        return -1;
+    }
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *result;
+    int rc = getaddrinfo(host, colon + 1, &hints, &result);
+    if (rc != 0) {
+        fprintf(stderr, "Cannot resolve address %s: %s\n", address, gai_strerror(rc));
+        return -1;
+    }
+    memcpy(addr, result->ai_addr, result->ai_addrlen);
+    *addr_len = result->ai_addrlen;
+    freeaddrinfo(result);
+    return 0;
+}
+
+// Requests and responses are small and latency-bound; do not let Nagle hold them back.
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int transport_listen(const char *address) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    if (!address || transport_parse_address(address, &addr, &addr_len) != 0) {
+        return -1;
+    }
+
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (addr.ss_family == AF_UNIX) {
+        unlink(((struct sockaddr_un *)&addr)->sun_path);
+    } else {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, (struct sockaddr *)&addr, addr_len) != 0 || listen(fd, SOMAXCONN) != 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", address, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int transport_accept(int listen_fd) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+        close(fd);
+        return -1;
+    }
+    set_nodelay(fd);
+    return fd;
+}
+
+int transport_connect(const struct sockaddr_storage *addr, socklen_t addr_len, bool *in_progress) {
+    int fd = socket(addr->ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (addr->ss_family != AF_UNIX) {
+        set_nodelay(fd);
+    }
+    *in_progress = false;
+    if (connect(fd, (const struct sockaddr *)addr, addr_len) != 0) {
+        if (errno != EINPROGRESS) {
+            close(fd);
+            return -1;
+        }
+        *in_progress = true;
+    }
+    return fd;
+}
+
+int transport_connect_result(int fd) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0 ? 0 : -1;
+}
+
+// Connections
+
+void transport_connection_init(TransportConnection *connection, int fd, BufferPool *pool) {
+    memset(connection, 0, sizeof(*connection));
+    connection->fd = fd;
+    connection->pool = pool;
+}
+
+void transport_connection_close(TransportConnection *connection) {
+    if (connection->fd >= 0) {
+        close(connection->fd);
+        connection->fd = -1;
+    }
+    if (connection->reading) {
+        frame_put(connection->pool, connection->reading);
+        connection->reading = NULL;
+    }
+    while (connection->write_head) {
+        TransportFrame *next = connection->write_head->next;
+        frame_put(connection->pool, connection->write_head);
+        connection->write_head = next;
+    }
+    connection->write_tail = NULL;
+    connection->read_offset = 0;
+    connection->write_offset = 0;
+    connection->queued = 0;
+}
+
+TransportStatus transport_read_frame(TransportConnection *connection, uint8_t **message, size_t *size) {
+    for (;;) {
+        uint8_t *target;
+        size_t remaining;
+        if (connection->read_offset < TRANSPORT_FRAME_HEADER_SIZE) {
+            target = connection->header + connection->read_offset;
+            remaining = TRANSPORT_FRAME_HEADER_SIZE - connection->read_offset;
+        } else {
+            size_t body_offset = connection->read_offset - TRANSPORT_FRAME_HEADER_SIZE;
+            target = frame_message(connection->reading) + body_offset;
+            remaining = connection->reading->size - body_offset;
+        }
+
+        ssize_t received = read(connection->fd, target, remaining);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return TRANSPORT_AGAIN;
+        }
+        if (received < 0) {
+            return TRANSPORT_ERROR;
+        }
+        if (received == 0) {
+            return TRANSPORT_CLOSED;
+        }
+        connection->read_offset += (size_t)received;
+
+        if (connection->read_offset == TRANSPORT_FRAME_HEADER_SIZE) {
+            uint32_t length = (uint32_t)connection->header[0] << 24 | (uint32_t)connection->header[1] << 16 |
+                              (uint32_t)connection->header[2] << 8 | connection->header[3];
+            if (length == 0 || length > TRANSPORT_MAX_FRAME_SIZE) {
+                fprintf(stderr, "Invalid frame size: %u\n", length);
+                return TRANSPORT_ERROR;
+            }
+            connection->reading = frame_get(connection->pool, length);
+            if (!connection->reading) {
+                return TRANSPORT_ERROR;
+            }
+        } else if (connection->read_offset > TRANSPORT_FRAME_HEADER_SIZE &&
+                   connection->read_offset == TRANSPORT_FRAME_HEADER_SIZE + connection->reading->size) {
+            *message = frame_message(connection->reading);
+            *size = connection->reading->size;
+            connection->reading = NULL;
+            connection->read_offset = 0;
+            return TRANSPORT_OK;
+        }
+    }
+}
+
+void transport_queue_frame(TransportConnection *connection, uint8_t *message, size_t size) {
+    TransportFrame *frame = frame_of(message);
+    frame->size = (uint32_t)size;
+    frame->header[0] = (uint8_t)(size >> 24);
+    frame->header[1] = (uint8_t)(size >> 16);
+    frame->header[2] = (uint8_t)(size >> 8);
+    frame->header[3] = (uint8_t)size;
+    frame->next = NULL;
+    if (connection->write_tail) {
+        connection->write_tail->next = frame;
+    } else {
+        connection->write_head = frame;
+    }
+    connection->write_tail = frame;
+    connection->queued++;
+}
+
+int transport_queue_copy(TransportConnection *connection, const uint8_t *message, size_t size) {
+    uint8_t *copy = transport_frame_get(connection->pool, size);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, message, size);
+    transport_queue_frame(connection, copy, size);
+    return 0;
+}
+
+TransportStatus transport_flush(TransportConnection *connection) {
+    while (connection->write_head) {
+        struct iovec iov[TRANSPORT_MAX_IOV];
+        int iov_count = 0;
+        size_t skip = connection->write_offset;
+        for (TransportFrame *frame = connection->write_head; frame && iov_count < TRANSPORT_MAX_IOV;
+             frame = frame->next) {
+            iov[iov_count].iov_base = frame->header + skip;
+            iov[iov_count++].iov_len = TRANSPORT_FRAME_HEADER_SIZE + frame->size - skip;
+            skip = 0;
+        }
+
+        ssize_t sent = writev(connection->fd, iov, iov_count);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return TRANSPORT_AGAIN;
+        }
+        if (sent < 0) {
+            return TRANSPORT_ERROR;
+        }
+
+        // Release every frame that went out completely.
+        size_t written = connection->write_offset + (size_t)sent;
+        while (connection->write_head &&
+               written >= TRANSPORT_FRAME_HEADER_SIZE + connection->write_head->size) {
+            TransportFrame *frame = connection->write_head;
+            written -= TRANSPORT_FRAME_HEADER_SIZE + frame->size;
+            connection->write_head = frame->next;
+            connection->queued--;
+            frame_put(connection->pool, frame);
+        }
+        if (!connection->write_head) {
+            connection->write_tail = NULL;
+        }
+        connection->write_offset = written;
+    }
+    return TRANSPORT_OK;
+}
+
+bool transport_has_pending_writes(const TransportConnection *connection) {
+    return connection->write_head != NULL;
+}
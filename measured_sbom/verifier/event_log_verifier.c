@@ -1,4 +1,5 @@
 #include "event_log_verifier.h"
+#include "ima_log_verifier.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,130 +9,272 @@
 #define LOG_INFO(fmt, ...) fprintf(stdout, "[INFO] " fmt "\n", ##__VA_ARGS__)
 
 /**
- * Initializes the RIM payload with test data.
- * This function should be modified to initialize real RIM data in production.
+ * Checks an event's digests against the RIM entries for a payload name.
+ * Every entry for the name is tried, using the event digest of the entry's bank.
  */
-void initialize_rim_payload(RIM_Payload *rim_payload) {
-    if (!rim_payload) {
-        LOG_ERR("RIM payload initialization failed: NULL pointer");
-        return;
+static bool match_rim_entries(const TCG_EventView *event, const RIM_Index *rim_index, const RIM_Entry *rim_entry) {
+    for (; rim_entry; rim_entry = rim_index_next_same_name(rim_index, rim_entry)) {
+        const TCG_DigestView *digest = tcg_event_find_digest(event, rim_entry->alg);
+        if (digest && digest->size == rim_entry->digest_size &&
+            memcmp(digest->digest, rim_entry->digest, digest->size) == 0) {
+            return true;
+        }
     }
+    return false;
+}
 
-    rim_payload->file_count = 2;
+/**
+ * Finds a RIM entry for an event that does not name its payload by matching any of its digests.
+ */
+static const RIM_Entry* find_rim_entry_by_digest(const TCG_EventView *event, const RIM_Index *rim_index) {
+    for (uint32_t i = 0; i < event->digest_count; i++) {
+        const RIM_Entry *rim_entry = rim_index_find_by_digest(rim_index, event->digests[i].alg,
+                                                              event->digests[i].digest, event->digests[i].size);
+        if (rim_entry) {
+            return rim_entry;
+        }
+    }
+    return NULL;
+}
 
-    // Initialize RIM entry for iotBase
-    strncpy(rim_payload->files[0].name, "Example.com.iotBase.bin", sizeof(rim_payload->files[0].name) - 1);
-    const uint8_t hash1[HASH_SIZE] = { /* SHA-256 hash for file 1 */ };
-    memcpy(rim_payload->files[0].digest, hash1, HASH_SIZE);
+static const char *const event_status_names[EVENT_STATUS_COUNT] = {
+    "matched", "matched_by_digest", "skipped", "unknown", "mismatch", "malformed",
+};
 
-    // Initialize RIM entry for iotExec
-    strncpy(rim_payload->files[1].name, "iotExec.bin", sizeof(rim_payload->files[1].name) - 1);
-    const uint8_t hash2[HASH_SIZE] = { /* SHA-256 hash for file 2 */ };
-    memcpy(rim_payload->files[1].digest, hash2, HASH_SIZE);
+const char *event_status_str(EventStatus status) {
+    return status < EVENT_STATUS_COUNT ? event_status_names[status] : "invalid";
 }
 
 /**
- * Finds a matching RIM file entry by name.
- * Returns a pointer to the RIM_File if found, otherwise NULL.
+ * Empties a report for a new check; the event detail buffer is kept for reuse.
  */
-static const RIM_File* find_rim_file(const RIM_Payload *rim_payload, const char *event_name) {
-    if (!rim_payload || !event_name) {
-        LOG_ERR("RIM file lookup failed: NULL parameter");
-        return NULL;
+void rim_check_report_reset(RIM_CheckReport *report, EventDetail detail) {
+    EventRecordStatus *events = report->events;
+    size_t event_capacity = report->event_capacity;
+    memset(report, 0, sizeof(*report));
+    report->detail = detail;
+    report->events = events;
+    report->event_capacity = event_capacity;
+}
+
+void rim_check_report_free(RIM_CheckReport *report) {
+    free(report->events);
+    report->events = NULL;
+    report->event_count = 0;
+    report->event_capacity = 0;
+}
+
+/**
+ * Adds a checked event to a report. Detail that cannot be allocated is dropped; the counts stay exact.
+ */
+void rim_check_report_add(RIM_CheckReport *report, const EventRecordStatus *record, const char *name,
+                          size_t name_len) {
+    EventStatus status = (EventStatus)record->status;
+    bool failed = status == EVENT_STATUS_UNKNOWN || status == EVENT_STATUS_MISMATCH;
+
+    report->events_checked++;
+    report->status_counts[status]++;
+    if (status != EVENT_STATUS_SKIPPED && record->pcr_index < TPM_PCR_COUNT) {
+        report->pcr_events[record->pcr_index]++;
+        report->pcr_failures[record->pcr_index] += failed;
+    }
+    if (failed && !report->has_failure) {
+        report->has_failure = true;
+        report->first_failure = *record;
+        report->first_failure_name_len = (uint32_t)(name_len < RIM_CHECK_NAME_MAX ? name_len : RIM_CHECK_NAME_MAX);
+        memcpy(report->first_failure_name, name, report->first_failure_name_len);
     }
 
-    for (size_t i = 0; i < rim_payload->file_count; i++) {
-        if (strcmp(rim_payload->files[i].name, event_name) == 0) {
-            return &rim_payload->files[i];
+    if (report->detail == EVENT_DETAIL_NONE || (report->detail == EVENT_DETAIL_FAILURES && !failed)) {
+        return;
+    }
+    if (report->event_count == report->event_capacity) {
+        size_t capacity = report->event_capacity ? report->event_capacity * 2 : 64;
+        EventRecordStatus *events = realloc(report->events, capacity * sizeof(*events));
+        if (!events) {
+            return;
         }
+        report->events = events;
+        report->event_capacity = capacity;
     }
-    return NULL;
+    report->events[report->event_count++] = *record;
+}
+
+static void report_event(RIM_CheckReport *report, const TCG_EventView *event, EventStatus status,
+                         const char *name, size_t name_len) {
+    EventRecordStatus record = {
+        .record_num = (uint32_t)event->record_num,
+        .event_type = event->event_type,
+        .pcr_index = event->pcr_index,
+        .status = status,
+    };
+    rim_check_report_add(report, &record, name, name_len);
 }
 
 /**
- * Interprets a single event and verifies its digest against the RIM entry.
- * Logs verification success or failure for each event.
+ * Interprets a single event and verifies its digests against the RIM.
+ * The event data is looked up as a payload name first; events whose data is not a known name
+ * are matched by digest instead. Events that are not extended into a PCR (EV_NO_ACTION) are not checked.
+ * IMA entries of a CEL stream are checked by file path and digest, as in an IMA log.
+ * Nothing is printed per event; the outcome goes into the report, if there is one.
  */
-static bool interpret_event(const TCG_EVENT *event, const RIM_Payload *rim_payload, size_t event_num) {
-    if (!event || !rim_payload) {
+static bool interpret_event(const TCG_EventView *event, const RIM_Index *rim_index, RIM_CheckReport *report) {
+    if (!event || !rim_index) {
         LOG_ERR("Event interpretation failed: NULL parameter");
         return false;
     }
 
-    const char *event_name = (const char*)event->Event;
-    const RIM_File *rim_entry = find_rim_file(rim_payload, event_name);
+    EventStatus status;
+    const char *event_name = (const char*)event->event_data;
+    size_t name_len = 0;
+    if (event->content == TCG_CONTENT_IMA_TEMPLATE) {
+        // An IMA entry of a CEL stream, checked as the IMA log verifier checks it
+        status = ima_check_cel_event(event, rim_index, &event_name, &name_len);
+    } else if (event->event_type == TCG_EV_NO_ACTION) {
+        status = EVENT_STATUS_SKIPPED;
+    } else {
+        // The event data names the measured object; drop the terminator(s) some firmware includes.
+        name_len = strnlen(event_name, event->event_size);
+        const RIM_Entry *rim_entry = rim_index_find_by_name(rim_index, event_name, name_len);
+        if (rim_entry) {
+            status = match_rim_entries(event, rim_index, rim_entry) ? EVENT_STATUS_MATCHED : EVENT_STATUS_MISMATCH;
+        } else {
+            status = find_rim_entry_by_digest(event, rim_index) ? EVENT_STATUS_MATCHED_BY_DIGEST
+                                                                : EVENT_STATUS_UNKNOWN;
+        }
+    }
 
-    if (!rim_entry) {
-        LOG_WARN("Event %zu: No matching RIM entry for '%s'", event_num, event_name);
-        return false;
+    if (report) {
+        report_event(report, event, status, event_name, name_len);
     }
+    return status != EVENT_STATUS_UNKNOWN && status != EVENT_STATUS_MISMATCH;
+}
 
-    bool digest_match = (memcmp(event->digest, rim_entry->digest, HASH_SIZE) == 0);
-    if (digest_match) {
-        LOG_INFO("Event %zu: Digest verification succeeded for '%s'", event_num, event_name);
-    } else {
-        LOG_ERR("Event %zu: Digest mismatch for '%s'", event_num, event_name);
+/**
+ * Appends a report covering the events after those of another, as when a log is checked in consecutive ranges.
+ * The merged report is the one a single check of the whole range would have produced.
+ */
+void rim_check_report_merge(RIM_CheckReport *report, const RIM_CheckReport *part) {
+    report->events_checked += part->events_checked;
+    for (int i = 0; i < EVENT_STATUS_COUNT; i++) {
+        report->status_counts[i] += part->status_counts[i];
+    }
+    for (int i = 0; i < TPM_PCR_COUNT; i++) {
+        report->pcr_events[i] += part->pcr_events[i];
+        report->pcr_failures[i] += part->pcr_failures[i];
+    }
+    if (part->has_failure && !report->has_failure) {
+        report->has_failure = true;
+        report->first_failure = part->first_failure;
+        report->first_failure_name_len = part->first_failure_name_len;
+        memcpy(report->first_failure_name, part->first_failure_name, part->first_failure_name_len);
     }
 
-    return digest_match;
+    if (part->event_count == 0) {
+        return;
+    }
+    if (report->event_capacity - report->event_count < part->event_count) {
+        size_t capacity = report->event_count + part->event_count;
+        EventRecordStatus *events = realloc(report->events, capacity * sizeof(*events));
+        if (!events) {
+            return;
+        }
+        report->events = events;
+        report->event_capacity = capacity;
+    }
+    memcpy(report->events + report->event_count, part->events, part->event_count * sizeof(*part->events));
+    report->event_count += part->event_count;
 }
 
 /**
- * Cast an event type on to event log and keep shifting to find more events. 
- * TODO: Need to study possbility extra bytes and how this logic is resiliant to it.
+ * Verifies at most max_events events of a cursor against the RIM, filling a report if one is given.
+ * Stopping after max_events leaves the cursor on the next event, so a log can be checked in ranges.
  * Returns true if all events are successfully verified, false otherwise.
  */
-static bool process_event_log(const BYTE *event_log, size_t log_size, const RIM_Payload *rim_payload) {
-    if (!event_log || log_size == 0 || !rim_payload) {
+bool process_event_log_range(TCG_EventLogCursor *cursor, const RIM_Index *rim_index, size_t max_events,
+                             RIM_CheckReport *report) {
+    if (!cursor || !rim_index) {
         LOG_ERR("Event log processing failed: Invalid input");
         return false;
     }
 
-    size_t offset = 0;
-    size_t event_num = 1;
     bool all_verified = true;
-
-    while (offset < log_size) {
-        // Ensure there's enough space for an event structure
-        if (log_size - offset < sizeof(TCG_EVENT)) {
-            LOG_ERR("Incomplete event header at offset %zu", offset);
+    TCG_EventView event;
+    TCG_LogStatus status = TCG_LOG_END;
+    for (size_t checked = 0; checked < max_events &&
+                             (status = tcg_log_cursor_next(cursor, &event)) == TCG_LOG_OK; checked++) {
+        // At this point we have isolated an event and will be send to this function
+        // for verification against the RIM.
+        if (!interpret_event(&event, rim_index, report)) {
             all_verified = false;
-            break;
         }
+    }
 
-        const TCG_EVENT *event = (const TCG_EVENT *)(event_log + offset);
-        // Event size is not known from type of event. there is a field that needs to be
-        // raed to determine that. 
-        size_t event_size = sizeof(TCG_EVENT) + event->eventDataSize;
-
-        // Validate event size
-        if (log_size - offset < event_size) {
-            LOG_ERR("Incomplete event data at offset %zu", offset);
-            all_verified = false;
-            break;
+    if (status != TCG_LOG_END && status != TCG_LOG_OK) {
+        if (report) {
+            report->status_counts[EVENT_STATUS_MALFORMED]++;
+            if (!report->has_failure) {
+                report->has_failure = true;
+                report->first_failure = (EventRecordStatus){ .record_num = (uint32_t)(cursor->record_num + 1),
+                                                             .status = EVENT_STATUS_MALFORMED };
+            }
+        } else {
+            LOG_ERR("Event %zu at offset %zu: %s", cursor->record_num + 1, cursor->offset,
+                    tcg_log_status_str(status));
         }
+        all_verified = false;
+    }
 
-        // At this point we have isolated an event and will be send to this function 
-        // for verification against the RIM. 
-        if (!interpret_event(event, rim_payload, event_num)) {
-            all_verified = false;
-        }
+    return all_verified;
+}
+
+/**
+ * Verifies the remaining events of a cursor against the RIM, filling a report if one is given.
+ * Lets a caller resume from a checkpoint and check only the records appended since.
+ * Returns true if all events are successfully verified, false otherwise.
+ */
+bool process_event_log_report(TCG_EventLogCursor *cursor, const RIM_Index *rim_index, RIM_CheckReport *report) {
+    return process_event_log_range(cursor, rim_index, SIZE_MAX, report);
+}
+
+/**
+ * Verifies the remaining events of a cursor against the RIM.
+ * Returns true if all events are successfully verified, false otherwise.
+ */
+bool process_event_log_from(TCG_EventLogCursor *cursor, const RIM_Index *rim_index) {
+    return process_event_log_report(cursor, rim_index, NULL);
+}
+
+/**
+ * Walks the event log with a TCG_EventLogCursor and verifies every event against the RIM.
+ * Handles both crypto-agile (TCG_PCR_EVENT2) and legacy SHA-1 logs; records are bounds-checked by the cursor
+ * and handed out as views into event_log, so nothing is copied.
+ * Returns true if all events are successfully verified, false otherwise.
+ */
+bool process_event_log(const BYTE *event_log, size_t log_size, const RIM_Index *rim_index) {
+    if (!event_log || log_size == 0 || !rim_index) {
+        LOG_ERR("Event log processing failed: Invalid input");
+        return false;
+    }
 
-        // Advance to the next event
-        offset += event_size;
-        event_num++;
+    TCG_EventLogCursor cursor;
+    TCG_LogStatus status = tcg_log_cursor_init(&cursor, event_log, log_size);
+    if (status != TCG_LOG_OK) {
+        LOG_ERR("Invalid event log header: %s", tcg_log_status_str(status));
+        return false;
     }
 
-    return all_verified;
+    return process_event_log_from(&cursor, rim_index);
 }
 
 /**
  * Loads an event log from a binary file, processes each event, and verifies digests.
  * Returns true if all events pass verification, false otherwise.
- * This is expecting event log in PC STD format, not Canoncial Event Log (CEL).
+ * The file may hold a PC Client log (crypto-agile or legacy SHA-1) or a Canonical Event Log in CEL-TLV encoding;
+ * tcg_log_cursor_init() tells them apart. CEL-JSON is not supported.
  */
-bool parse_event_log_from_file(const char *filename, const RIM_Payload *rim_payload) {
-    if (!filename || !rim_payload) {
+bool parse_event_log_from_file(const char *filename, const RIM_Index *rim_index) {
+    if (!filename || !rim_index) {
         LOG_ERR("Event log parsing failed: Invalid input");
         return false;
     }
@@ -165,9 +308,22 @@ bool parse_event_log_from_file(const char *filename, const RIM_Payload *rim_payl
     fclose(file);
 
     // Process and verify each event in the log
-    bool result = process_event_log(event_log, file_size, rim_payload);
-    LOG_INFO("Event log verification %s", result ? "succeeded" : "failed");
+    RIM_CheckReport report = { 0 };
+    TCG_EventLogCursor cursor;
+    TCG_LogStatus status = tcg_log_cursor_init(&cursor, event_log, file_size);
+    bool result = status == TCG_LOG_OK && process_event_log_report(&cursor, rim_index, &report);
+    if (status != TCG_LOG_OK) {
+        LOG_ERR("Invalid event log header: %s", tcg_log_status_str(status));
+    } else if (report.has_failure) {
+        LOG_WARN("Event %u (PCR %u): %s '%.*s'", report.first_failure.record_num, report.first_failure.pcr_index,
+                 event_status_str((EventStatus)report.first_failure.status), (int)report.first_failure_name_len,
+                 report.first_failure_name);
+    }
+    LOG_INFO("Event log verification %s: %u events, %u unknown, %u mismatched", result ? "succeeded" : "failed",
+             report.events_checked, report.status_counts[EVENT_STATUS_UNKNOWN],
+             report.status_counts[EVENT_STATUS_MISMATCH]);
 
+    rim_check_report_free(&report);
     free(event_log);
     return result;
 }
\ No newline at end of file
@@ -5,24 +5,68 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <tss2/tss2_tpm2_types.h>
+#include "event_log_parser.h"
+#include "manifest.h"
+#include "pcr.h"
 
-#define HASH_SIZE 32          // SHA-256 hash size in bytes
-#define MAX_RIM_FILES 10      // Maximum number of RIM files supported
+#define RIM_CHECK_NAME_MAX 64   // Bytes of the first mismatching event's name kept in a report
 
-// Structure to store RIM file data (reference digests)
+// Outcome of checking one event against the RIM
+typedef enum {
+    EVENT_STATUS_MATCHED,           // Named payload found and a digest matched
+    EVENT_STATUS_MATCHED_BY_DIGEST, // Unnamed payload whose digest is in the RIM
+    EVENT_STATUS_SKIPPED,           // Not extended into a PCR (EV_NO_ACTION)
+    EVENT_STATUS_UNKNOWN,           // No RIM entry for the payload
+    EVENT_STATUS_MISMATCH,          // RIM entries for the payload, none with this digest
+    EVENT_STATUS_MALFORMED,         // Record could not be parsed; the check stops there
+    EVENT_STATUS_COUNT
+} EventStatus;
+
+// One checked event, as kept in a report's event detail
 typedef struct {
-    char name[100];           // Name of the file in the RIM entry
-    uint8_t digest[HASH_SIZE];// SHA-256 digest for verification
-} RIM_File;
+    uint32_t record_num;            // 1-based record number in the log
+    uint32_t event_type;            // TCG event type; 0 for IMA entries
+    uint32_t pcr_index;             // PCR the event extends
+    uint32_t status;                // EventStatus
+} EventRecordStatus;
+
+// Which events a report keeps individually
+typedef enum {
+    EVENT_DETAIL_NONE,              // Counts and the first mismatch only
+    EVENT_DETAIL_FAILURES,          // Also every event that failed
+    EVENT_DETAIL_ALL                // Also every event
+} EventDetail;
 
-// Structure for holding multiple RIM file entries
+// Structured result of a RIM check, filled instead of printing a line per event
 typedef struct {
-    RIM_File files[MAX_RIM_FILES]; // Array of RIM files
-    size_t file_count;             // Count of valid RIM files
-} RIM_Payload;
+    EventDetail detail;                         // Events kept in events
+    uint32_t events_checked;                    // Records looked at, including skipped ones
+    uint32_t status_counts[EVENT_STATUS_COUNT]; // Events per EventStatus
+    uint32_t pcr_events[TPM_PCR_COUNT];         // Events extended into each PCR
+    uint32_t pcr_failures[TPM_PCR_COUNT];       // Unknown or mismatching events per PCR
+    bool has_failure;                           // first_failure is set
+    EventRecordStatus first_failure;            // First event that was unknown, mismatched or malformed
+    char first_failure_name[RIM_CHECK_NAME_MAX];// Its payload name, truncated, not NUL-terminated
+    uint32_t first_failure_name_len;            // Length of first_failure_name
+    EventRecordStatus *events;                  // Event detail; the buffer is reused across resets
+    size_t event_count;                         // Entries in events
+    size_t event_capacity;                      // Allocated entries
+} RIM_CheckReport;
+
+const char *event_status_str(EventStatus status);
+void rim_check_report_reset(RIM_CheckReport *report, EventDetail detail);
+void rim_check_report_free(RIM_CheckReport *report);
+void rim_check_report_add(RIM_CheckReport *report, const EventRecordStatus *record, const char *name,
+                          size_t name_len);
+void rim_check_report_merge(RIM_CheckReport *report, const RIM_CheckReport *part);
 
 // Main API functions
-void initialize_rim_payload(RIM_Payload *rim_payload);
-bool parse_event_log_from_file(const char *filename, const RIM_Payload *rim_payload);
+// The RIM index is built once per manifest (see rim_index_load_manifest) and shared across logs.
+bool parse_event_log_from_file(const char *filename, const RIM_Index *rim_index);
+bool process_event_log(const BYTE *event_log, size_t log_size, const RIM_Index *rim_index);
+bool process_event_log_from(TCG_EventLogCursor *cursor, const RIM_Index *rim_index);
+bool process_event_log_report(TCG_EventLogCursor *cursor, const RIM_Index *rim_index, RIM_CheckReport *report);
+bool process_event_log_range(TCG_EventLogCursor *cursor, const RIM_Index *rim_index, size_t max_events,
+                             RIM_CheckReport *report);
 
 #endif // EVENT_LOG_VERIFIER_H
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "ima_log_verifier.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/evp.h>
+
+#define LOG_ERR(fmt, ...) fprintf(stderr, "[ERROR] " fmt "\n", ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) fprintf(stdout, "[WARN] " fmt "\n", ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) fprintf(stdout, "[INFO] " fmt "\n", ##__VA_ARGS__)
+
+/**
+ * Fetches the digest of a bank once per log; initializing with the EVP_sha1() style constants fetches it again on
+ * every entry.
+ */
+static EVP_MD *ima_bank_md(TPM2_ALG_ID bank) {
+    switch (bank) {
+        case TPM2_ALG_SHA1:   return EVP_MD_fetch(NULL, "SHA1", NULL);
+        case TPM2_ALG_SHA256: return EVP_MD_fetch(NULL, "SHA256", NULL);
+        case TPM2_ALG_SHA384: return EVP_MD_fetch(NULL, "SHA384", NULL);
+        case TPM2_ALG_SHA512: return EVP_MD_fetch(NULL, "SHA512", NULL);
+        default:              return NULL;
+    }
+}
+
+static bool is_zero(const uint8_t *p, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Recomputes an entry's template digest from its template data.
+ * The "ima" template hashes the file digest and the name NUL-padded to IMA_LEGACY_NAME_SIZE bytes, without the
+ * name length the log stores; every other template hashes its data as logged.
+ */
+static bool template_digest_matches(EVP_MD_CTX *ctx, const EVP_MD *md, const IMA_EventView *event) {
+    static const uint8_t padding[IMA_LEGACY_NAME_SIZE];
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+
+    if (EVP_DigestInit_ex(ctx, md, NULL) != 1) {
+        return false;
+    }
+    if (event->template_kind == IMA_TEMPLATE_IMA) {
+        if (EVP_DigestUpdate(ctx, event->file_digest, event->file_digest_size) != 1 ||
+            EVP_DigestUpdate(ctx, event->file_name, event->file_name_len) != 1 ||
+            EVP_DigestUpdate(ctx, padding, IMA_LEGACY_NAME_SIZE - event->file_name_len) != 1) {
+            return false;
+        }
+    } else if (EVP_DigestUpdate(ctx, event->template_data, event->template_data_size) != 1) {
+        return false;
+    }
+    return EVP_DigestFinal_ex(ctx, digest, &digest_size) == 1 && digest_size == event->template_digest_size &&
+           memcmp(digest, event->template_digest, digest_size) == 0;
+}
+
+/**
+ * Extends a replayed PCR with an entry. A violation is logged with an all-zero template digest but extended as
+ * all ones, as the kernel does.
+ */
+static bool extend_pcr(EVP_MD_CTX *ctx, const EVP_MD *md, PCR_Bank *pcrs, const IMA_EventView *event,
+                       bool violation) {
+    uint8_t ones[EVP_MAX_MD_SIZE];
+    const uint8_t *digest = event->template_digest;
+    if (violation) {
+        memset(ones, 0xff, event->template_digest_size);
+        digest = ones;
+    }
+
+    TPM2B_DIGEST *pcr = &pcrs->pcrs[event->pcr_index];
+    return EVP_DigestInit_ex(ctx, md, NULL) == 1 &&
+           EVP_DigestUpdate(ctx, pcr->buffer, pcr->size) == 1 &&
+           EVP_DigestUpdate(ctx, digest, event->template_digest_size) == 1 &&
+           EVP_DigestFinal_ex(ctx, pcr->buffer, NULL) == 1;
+}
+
+/**
+ * Checks an entry's file digest against the RIM: every entry for the path is tried, then the digest alone, for
+ * files the RIM knows under another path.
+ */
+static EventStatus match_file(const IMA_EventView *event, const RIM_Index *rim_index) {
+    if (!event->file_digest) {
+        return EVENT_STATUS_UNKNOWN;
+    }
+
+    const RIM_Entry *rim_entry = rim_index_find_by_name(rim_index, event->file_name, event->file_name_len);
+    if (rim_entry) {
+        for (; rim_entry; rim_entry = rim_index_next_same_name(rim_index, rim_entry)) {
+            if (rim_entry->alg == event->file_digest_alg && rim_entry->digest_size == event->file_digest_size &&
+                memcmp(rim_entry->digest, event->file_digest, event->file_digest_size) == 0) {
+                return EVENT_STATUS_MATCHED;
+            }
+        }
+        return EVENT_STATUS_MISMATCH;
+    }
+    return rim_index_find_by_digest(rim_index, event->file_digest_alg, event->file_digest, event->file_digest_size)
+               ? EVENT_STATUS_MATCHED_BY_DIGEST : EVENT_STATUS_UNKNOWN;
+}
+
+/**
+ * Verifies every remaining entry of a reader: the template digest against the template data, the file digest
+ * against the RIM, and the replay of the template digests into the PCRs.
+ * Memory use is the reader's buffer whatever the length of the log.
+ * Returns true if the whole log was read and every entry verified, false otherwise.
+ */
+bool verify_ima_log_reader(IMA_LogReader *reader, TPM2_ALG_ID bank, const RIM_Index *rim_index,
+                           IMA_VerifyResult *result, RIM_CheckReport *report) {
+    if (!result) {
+        LOG_ERR("IMA log verification failed: Invalid input");
+        return false;
+    }
+    memset(result, 0, sizeof(*result));
+    result->status = IMA_LOG_ERR_INVALID;
+
+    EVP_MD *md = reader ? ima_bank_md(bank) : NULL;
+    if (!md || (uint16_t)EVP_MD_get_size(md) != reader->digest_size) {
+        LOG_ERR("IMA log verification failed: Invalid input");
+        EVP_MD_free(md);
+        return false;
+    }
+
+    result->pcrs.alg = bank;
+    result->pcrs.digest_size = reader->digest_size;
+    for (uint32_t i = 0; i < TPM_PCR_COUNT; i++) {
+        result->pcrs.pcrs[i].size = reader->digest_size;
+    }
+
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (!ctx) {
+        LOG_ERR("Memory allocation failed for digest context");
+        EVP_MD_free(md);
+        return false;
+    }
+
+    bool all_verified = true;
+    IMA_EventView event;
+    while ((result->status = ima_log_reader_next(reader, &event)) == IMA_LOG_OK) {
+        result->entries++;
+        if (event.pcr_index >= TPM_PCR_COUNT) {
+            result->status = IMA_LOG_ERR_FORMAT;
+            break;
+        }
+
+        EventStatus status;
+        bool violation = is_zero(event.template_digest, event.template_digest_size);
+        if (violation) {
+            // The file was measured while open for writing (or written while open for measurement):
+            // there is nothing to check, only a violation to count.
+            result->violations++;
+            status = EVENT_STATUS_SKIPPED;
+        } else if (!template_digest_matches(ctx, md, &event)) {
+            result->template_mismatches++;
+            status = EVENT_STATUS_MISMATCH;
+        } else if (!rim_index || (event.file_name_len == strlen(IMA_BOOT_AGGREGATE_NAME) &&
+                                  memcmp(event.file_name, IMA_BOOT_AGGREGATE_NAME, event.file_name_len) == 0)) {
+            // boot_aggregate digests PCRs 0-9 and is checked by the boot event log, not the RIM.
+            status = EVENT_STATUS_SKIPPED;
+        } else {
+            status = match_file(&event, rim_index);
+        }
+
+        if (!extend_pcr(ctx, md, &result->pcrs, &event, violation)) {
+            LOG_ERR("Digest computation failed for IMA entry %zu", event.record_num);
+            all_verified = false;
+            break;
+        }
+        if (status == EVENT_STATUS_UNKNOWN || status == EVENT_STATUS_MISMATCH) {
+            all_verified = false;
+        }
+        if (report) {
+            EventRecordStatus record = {
+                .record_num = (uint32_t)event.record_num,
+                .pcr_index = event.pcr_index,
+                .status = status,
+            };
+            // Custom templates carry no file name; their template name stands in.
+            if (event.file_name) {
+                rim_check_report_add(report, &record, event.file_name, event.file_name_len);
+            } else {
+                rim_check_report_add(report, &record, event.template_name, event.template_name_len);
+            }
+        }
+    }
+
+    if (result->status != IMA_LOG_END) {
+        if (report) {
+            report->status_counts[EVENT_STATUS_MALFORMED]++;
+            if (!report->has_failure) {
+                report->has_failure = true;
+                report->first_failure = (EventRecordStatus){ .record_num = (uint32_t)(reader->record_num + 1),
+                                                             .status = EVENT_STATUS_MALFORMED };
+            }
+        } else {
+            LOG_ERR("IMA entry %zu at offset %llu: %s", reader->record_num + 1,
+                    (unsigned long long)reader->offset, ima_log_status_str(result->status));
+        }
+        all_verified = false;
+    }
+
+    EVP_MD_CTX_free(ctx);
+    EVP_MD_free(md);
+    return all_verified;
+}
+
+/**
+ * Checks an IMA entry carried in a CEL record. The encoder gives a violation all-ones digests in every bank, the
+ * value the kernel extends; otherwise every bank's digest must be the hash of the template data, since the PCR
+ * replay trusts them.
+ */
+EventStatus ima_check_cel_event(const TCG_EventView *event, const RIM_Index *rim_index, const char **name,
+                                size_t *name_len) {
+    IMA_EventView entry = {
+        .record_num = event->record_num,
+        .pcr_index = event->pcr_index,
+        .template_name = event->template_name,
+        .template_name_len = event->template_name_len,
+        .template_data = event->event_data,
+        .template_data_size = event->event_size,
+    };
+    *name = event->template_name;
+    *name_len = event->template_name_len;
+    if (ima_template_decode(&entry) != IMA_LOG_OK || event->digest_count == 0) {
+        return EVENT_STATUS_MISMATCH;
+    }
+    if (entry.file_name) {
+        *name = entry.file_name;
+        *name_len = entry.file_name_len;
+    }
+
+    bool violation = true;
+    for (uint32_t i = 0; i < event->digest_count && violation; i++) {
+        for (uint16_t j = 0; j < event->digests[i].size && violation; j++) {
+            violation = event->digests[i].digest[j] == 0xff;
+        }
+    }
+    if (violation) {
+        return EVENT_STATUS_SKIPPED;
+    }
+
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    if (!ctx) {
+        LOG_ERR("Memory allocation failed for digest context");
+        return EVENT_STATUS_MISMATCH;
+    }
+    bool matches = true;
+    for (uint32_t i = 0; i < event->digest_count && matches; i++) {
+        EVP_MD *md = ima_bank_md(event->digests[i].alg);
+        entry.template_digest = event->digests[i].digest;
+        entry.template_digest_size = event->digests[i].size;
+        matches = md && template_digest_matches(ctx, md, &entry);
+        EVP_MD_free(md);
+    }
+    EVP_MD_CTX_free(ctx);
+    if (!matches) {
+        return EVENT_STATUS_MISMATCH;
+    }
+
+    if (entry.file_name_len == strlen(IMA_BOOT_AGGREGATE_NAME) &&
+        memcmp(entry.file_name, IMA_BOOT_AGGREGATE_NAME, entry.file_name_len) == 0) {
+        return EVENT_STATUS_SKIPPED;
+    }
+    return match_file(&entry, rim_index);
+}
+
+/**
+ * Verifies an IMA log held in memory, in place.
+ * Returns true if every entry verified, false otherwise.
+ */
+bool process_ima_log(const BYTE *ima_log, size_t log_size, TPM2_ALG_ID bank, const RIM_Index *rim_index,
+                     IMA_VerifyResult *result, RIM_CheckReport *report) {
+    IMA_LogReader reader;
+    if (ima_log_reader_init_buffer(&reader, ima_log, log_size, bank) != IMA_LOG_OK) {
+        LOG_ERR("IMA log processing failed: Invalid input");
+        return false;
+    }
+    return verify_ima_log_reader(&reader, bank, rim_index, result, report);
+}
+
+/**
+ * Streams an IMA log from a file (e.g. /sys/kernel/security/ima/binary_runtime_measurements) and verifies it,
+ * printing the first failure, a summary and the replayed PCR 10.
+ * Returns true if every entry verified, false otherwise.
+ */
+bool parse_ima_log_from_file(const char *filename, TPM2_ALG_ID bank, const RIM_Index *rim_index) {
+    if (!filename) {
+        LOG_ERR("IMA log parsing failed: Invalid input");
+        return false;
+    }
+
+    IMA_LogReader reader;
+    IMA_LogStatus status = ima_log_reader_open(&reader, filename, bank);
+    if (status != IMA_LOG_OK) {
+        LOG_ERR("Error opening IMA log %s: %s", filename, ima_log_status_str(status));
+        return false;
+    }
+
+    RIM_CheckReport report = { 0 };
+    IMA_VerifyResult result;
+    bool verified = verify_ima_log_reader(&reader, bank, rim_index, &result, &report);
+    ima_log_reader_close(&reader);
+
+    if (result.status != IMA_LOG_END) {
+        LOG_ERR("IMA entry %u: %s", result.entries + 1, ima_log_status_str(result.status));
+    } else if (report.has_failure) {
+        LOG_WARN("IMA entry %u: %s '%.*s'", report.first_failure.record_num,
+                 event_status_str((EventStatus)report.first_failure.status), (int)report.first_failure_name_len,
+                 report.first_failure_name);
+    }
+    LOG_INFO("IMA log verification %s: %u entries, %u template mismatches, %u violations, %u unknown, "
+             "%u mismatched", verified ? "succeeded" : "failed", result.entries, result.template_mismatches,
+             result.violations, report.status_counts[EVENT_STATUS_UNKNOWN],
+             report.status_counts[EVENT_STATUS_MISMATCH]);
+
+    const TPM2B_DIGEST *pcr = &result.pcrs.pcrs[IMA_PCR_INDEX];
+    printf("[INFO] Replayed PCR %d: ", IMA_PCR_INDEX);
+    for (uint16_t i = 0; i < pcr->size; i++) {
+        printf("%02x", pcr->buffer[i]);
+    }
+    printf("\n");
+
+    rim_check_report_free(&report);
+    return verified;
+}
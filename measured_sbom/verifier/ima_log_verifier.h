@@ -0,0 +1,36 @@
+#ifndef IMA_LOG_VERIFIER_H
+#define IMA_LOG_VERIFIER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "event_log_verifier.h"
+#include "ima_log_parser.h"
+
+#define IMA_PCR_INDEX 10    // PCR the kernel extends by default (CONFIG_IMA_MEASURE_PCR_IDX)
+
+// Outcome of walking an IMA runtime measurement log
+typedef struct {
+    PCR_Bank pcrs;                  // PCRs replayed from the template digests, starting from zero
+    uint32_t entries;               // Entries read
+    uint32_t template_mismatches;   // Entries whose template data does not hash to their template digest
+    uint32_t violations;            // ToMToU/open-writers violations (all-zero template digest)
+    IMA_LogStatus status;           // IMA_LOG_END if the whole log was read, otherwise the error that stopped it
+} IMA_VerifyResult;
+
+// Main API functions
+// bank selects the log: TPM2_ALG_SHA1 for binary_runtime_measurements, or the algorithm of a
+// binary_runtime_measurements_<alg> log. rim_index may be NULL to check only template digests and replay PCRs.
+// Entries are checked against the RIM by file path and digest; the report, if any, gets one record per entry.
+bool verify_ima_log_reader(IMA_LogReader *reader, TPM2_ALG_ID bank, const RIM_Index *rim_index,
+                           IMA_VerifyResult *result, RIM_CheckReport *report);
+bool process_ima_log(const BYTE *ima_log, size_t log_size, TPM2_ALG_ID bank, const RIM_Index *rim_index,
+                     IMA_VerifyResult *result, RIM_CheckReport *report);
+bool parse_ima_log_from_file(const char *filename, TPM2_ALG_ID bank, const RIM_Index *rim_index);
+// Checks the ima_template record of a CEL stream: each bank's digest against the template data, then the file
+// against the RIM. name is set to the file (or template) name for the report.
+EventStatus ima_check_cel_event(const TCG_EventView *event, const RIM_Index *rim_index, const char **name,
+                                size_t *name_len);
+
+#endif // IMA_LOG_VERIFIER_H
@@ -0,0 +1,74 @@
+// arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Constants
+
+#define ARENA_ALIGNMENT 16                      /**< Alignment of every allocation */
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)    /**< Chunk size used when arena_init() is given 0 */
+#define ARENA_MAX_RETAINED (4 * 1024 * 1024)    /**< Most memory an arena keeps across arena_reset() */
+
+// Structures
+
+/**
+ * @struct ArenaChunk
+ * @brief One block of arena memory.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;        /**< Previously filled chunk */
+    size_t size;                    /**< Usable bytes in data */
+    size_t used;                    /**< Bytes handed out */
+    uint8_t data[];                 /**< Memory handed out by arena_alloc() */
+} ArenaChunk;
+
+/**
+ * @struct Arena
+ * @brief Bump allocator whose allocations are all released at once by arena_reset().
+ *
+ * An arena is used by one thread at a time. After a reset it keeps one chunk large enough for everything the
+ * previous cycle allocated (up to ARENA_MAX_RETAINED), so a steady stream of similar requests allocates nothing
+ * from the heap.
+ */
+typedef struct {
+    ArenaChunk *head;               /**< Chunk allocations are served from; older chunks follow */
+    size_t chunk_size;              /**< Minimum size of a new chunk */
+} Arena;
+
+// Function Prototypes
+
+/**
+ * @brief Initializes an empty arena.
+ *
+ * @param[out] arena       Arena to initialize.
+ * @param[in]  chunk_size  Minimum chunk size; 0 selects ARENA_DEFAULT_CHUNK_SIZE.
+ */
+void arena_init(Arena *arena, size_t chunk_size);
+
+/**
+ * @brief Allocates ARENA_ALIGNMENT-aligned memory that lives until the next arena_reset().
+ *
+ * @return Pointer to the memory, or NULL on failure.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copies size bytes into the arena and appends a NUL terminator.
+ *
+ * @return Pointer to the copy, or NULL on failure.
+ */
+char *arena_strndup(Arena *arena, const char *data, size_t size);
+
+/**
+ * @brief Releases every allocation at once, keeping memory for the next cycle.
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * @brief Returns all memory of an arena to the heap.
+ */
+void arena_free(Arena *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,112 @@
+// attestation_decode.h
+#ifndef ATTESTATION_DECODE_H
+#define ATTESTATION_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "attestation.pb-c.h"  // Protobuf definitions for attestation
+#include "arena.h"
+#include "event_log_parser.h"
+#include "log_dictionary.h"
+
+// Constants
+
+// Protocol versions, negotiated through AttestationRequest.protocol_version
+#define ATTESTATION_PROTOCOL_V1 1                       /**< Log sent as repeated TCGEvent */
+#define ATTESTATION_PROTOCOL_V2 2                       /**< Raw log sent in chunks, with an event offset index */
+#define ATTESTATION_PROTOCOL_VERSION ATTESTATION_PROTOCOL_V2 /**< Highest version this code speaks */
+#define ATTESTATION_LOG_CHUNK_SIZE (64 * 1024)          /**< Largest log chunk an attestor sends */
+#define ATTESTATION_MAX_LOG_SIZE (64u * 1024 * 1024)    /**< Largest log a compressed_log may decompress to */
+
+// Field numbers of AttestationResponse and its submessages (proto/attestation.proto)
+#define ATTESTATION_RESPONSE_ATTESTOR_ID 1
+#define ATTESTATION_RESPONSE_PCRS 2
+#define ATTESTATION_RESPONSE_EVENT_LOG 3
+#define ATTESTATION_RESPONSE_NONCE 4
+#define ATTESTATION_RESPONSE_QUOTE 5
+#define ATTESTATION_RESPONSE_MEASUREMENT_LOG 6
+#define ATTESTATION_RESPONSE_PROTOCOL_VERSION 7
+#define ATTESTATION_RESPONSE_LOG_CHUNKS 8
+#define ATTESTATION_RESPONSE_EVENT_OFFSETS 9
+#define ATTESTATION_RESPONSE_NONCE_PROOF 10
+#define ATTESTATION_RESPONSE_LOG_BASE_EVENTS 11
+#define ATTESTATION_RESPONSE_LOG_BASE_SIZE 12
+#define ATTESTATION_RESPONSE_LOG_BASE_DIGEST 13
+#define ATTESTATION_RESPONSE_LOG_HEADER 14
+#define ATTESTATION_RESPONSE_LOG_DICTIONARY_ID 15
+#define ATTESTATION_RESPONSE_COMPRESSED_LOG 16
+#define LOG_CHUNK_OFFSET 1
+#define LOG_CHUNK_DATA 2
+#define NONCE_INCLUSION_PROOF_LEAF_INDEX 1
+#define NONCE_INCLUSION_PROOF_LEAF_COUNT 2
+#define NONCE_INCLUSION_PROOF_SIBLINGS 3
+#define PCR_INDEX 1
+#define PCR_VALUE 2
+#define TCG_EVENT_LOG_EVENTS 1
+#define TCG_EVENT_RECNUM 1
+#define TCG_EVENT_PCR_INDEX 2
+#define TCG_EVENT_DIGEST 3
+#define TCG_EVENT_EVENT_CONTENT 4
+
+// Function Prototypes
+
+/**
+ * @brief Decodes a serialized AttestationResponse without copying its payload.
+ *
+ * Produces the same structure as attestation_response__unpack(), but every message, array and string is carved
+ * from the arena and every bytes field (nonce, quote, measurement log, PCR values, event digests) points into the
+ * buffer. A response therefore costs a few arena allocations however long its log is. The result is valid until
+ * the arena is reset or the buffer is released, and must not be passed to attestation_response__free_unpacked().
+ * Unknown fields are skipped, as protobuf-c does.
+ *
+ * @param[in] arena   Arena the decoded structure is allocated from.
+ * @param[in] buffer  Serialized response.
+ * @param[in] size    Size of the serialized response.
+ *
+ * @return Decoded response, or NULL if the buffer is not a valid AttestationResponse.
+ */
+AttestationResponse *attestation_response_decode(Arena *arena, const uint8_t *buffer, size_t size);
+
+/**
+ * @brief Finds the nonce of a serialized AttestationResponse without decoding the rest, so that pipelined responses
+ * can be matched to their requests.
+ *
+ * @param[in]  buffer      Serialized response.
+ * @param[in]  size        Size of the serialized response.
+ * @param[out] nonce       Nonce inside the buffer.
+ * @param[out] nonce_size  Size of the nonce.
+ *
+ * @return Returns 0 on success, or -1 if the buffer is malformed or carries no nonce.
+ */
+int attestation_response_peek_nonce(const uint8_t *buffer, size_t size, const uint8_t **nonce, size_t *nonce_size);
+
+/**
+ * @brief Copies the attestor_id of a serialized AttestationResponse without decoding the rest.
+ *
+ * @return Returns 0 on success, or -1 if the buffer is malformed, carries no ID, or the ID does not fit.
+ */
+int attestation_response_peek_attestor_id(const uint8_t *buffer, size_t size, char *attestor_id,
+                                          size_t id_capacity);
+
+/**
+ * @brief Returns the raw TCG event log a response carries, whichever protocol version it was sent in.
+ *
+ * A version 2 log sent in one chunk, or as measurement_log, is returned in place. Several chunks are joined in the
+ * arena; they must tile the log in order from offset 0. A compressed_log is decompressed straight into the arena,
+ * with the dictionary the request advertised. A version 1 list of TCGEvents is rebuilt into a crypto-agile log
+ * with a single SHA-256 bank, so replay and the RIM check see the same format either way. If the response has an
+ * event offset index, it must be strictly increasing from 0 and lie within the log. A delta response
+ * (log_base_events set) returns only the records after its base, without the header record, and may return none.
+ *
+ * @param[in]  arena       Arena joined, decompressed or rebuilt logs are allocated from.
+ * @param[in]  response    Decoded response.
+ * @param[in]  dictionary  Dictionary a compressed_log must have been compressed with, or NULL to accept none.
+ * @param[out] log         Start of the log; valid as long as the response is.
+ * @param[out] log_size    Size of the log.
+ *
+ * @return Returns 0 on success, or -1 if the response carries no log or an inconsistent one.
+ */
+int attestation_response_log(Arena *arena, const AttestationResponse *response, const LogDictionary *dictionary,
+                             const uint8_t **log, size_t *log_size);
+
+#endif // ATTESTATION_DECODE_H
@@ -0,0 +1,167 @@
+// checkpoint.h
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pcr.h"
+#include "manifest.h"
+
+// Constants
+
+#define CHECKPOINT_ID_MAX 128           /**< Maximum attestor ID length, including the terminator */
+#define CHECKPOINT_KEY_MAX (2 * (2 + sizeof(TPMU_HA)) + 1) /**< Hex qualified name (nameAlg || digest), with NUL */
+#define CHECKPOINT_FILE_SUFFIX ".ckpt"
+
+// Structures
+
+/**
+ * @struct VerifierCheckpoint
+ * @brief Replay state of the accepted prefix of one attestor's measurement log.
+ *
+ * Runtime logs only grow by appending, so a later response whose log extends this prefix only needs its new
+ * suffix replayed on top of pcrs. The suffix alone is also all that is checked against the RIM, as long as the RIM
+ * is still the one the prefix was checked against.
+ *
+ * Checkpoints are keyed by the qualified name of the attestation key whose verified quotes vouched for the prefix,
+ * never by the attestor ID a response claims, so a device cannot reach another device's checkpoint. The attestor ID
+ * last seen with the key is kept only to tell the attestor, in the next request, which prefix the verifier holds.
+ */
+typedef struct {
+    char key[CHECKPOINT_KEY_MAX];                   /**< Hex qualified name of the key it belongs to */
+    char attestor_id[CHECKPOINT_ID_MAX];            /**< Attestor ID last presented with the key; may be empty */
+    uint64_t event_count;                           /**< Records in the accepted prefix */
+    uint64_t byte_offset;                           /**< Size of the accepted prefix in bytes */
+    uint64_t last_record_offset;                    /**< Offset of the last accepted record */
+    uint8_t last_record_digest[PCR_LOG_DIGEST_SIZE];/**< SHA-256 of the last accepted record's bytes */
+    uint8_t prefix_digest[PCR_LOG_DIGEST_SIZE];     /**< Rolling digest of the accepted prefix */
+    PCR_BankSet pcrs;                               /**< PCR state after replaying the accepted prefix */
+    uint8_t rim_digest[RIM_INDEX_DIGEST_SIZE];      /**< Content digest of the RIM the prefix was checked against */
+} VerifierCheckpoint;
+
+/**
+ * @struct CheckpointStore
+ * @brief Per-attestor checkpoints, cached in memory and optionally persisted to a directory.
+ */
+typedef struct CheckpointStore CheckpointStore;
+
+// Function Prototypes
+
+/**
+ * @brief Creates a checkpoint store.
+ *
+ * @param[in] directory  Directory to persist checkpoints in, one file per attestor; NULL keeps them in memory only.
+ *
+ * @return Pointer to the store, or NULL on failure.
+ */
+CheckpointStore *checkpoint_store_create(const char *directory);
+
+/**
+ * @brief Releases a checkpoint store. Persisted checkpoints are kept on disk.
+ */
+void checkpoint_store_destroy(CheckpointStore *store);
+
+/**
+ * @brief Looks up the checkpoint of an attestation key, loading it from disk on first use.
+ *
+ * @param[in]  store        Checkpoint store.
+ * @param[in]  key          Hex name of the attestation key, from a verified quote.
+ * @param[out] checkpoint   Copy of the checkpoint.
+ *
+ * @return Returns 0 if a checkpoint was found, or -1 otherwise.
+ */
+int checkpoint_store_get(CheckpointStore *store, const char *key, VerifierCheckpoint *checkpoint);
+
+/**
+ * @brief Looks up the checkpoint last stored with an attestor ID, among the checkpoints held in memory.
+ *
+ * The ID is not authenticated, so the result is only a hint for building a request; a response is always checked
+ * against the checkpoint of the key that signed its quote.
+ *
+ * @return Returns 0 if a checkpoint was found, or -1 otherwise.
+ */
+int checkpoint_store_find_attestor(CheckpointStore *store, const char *attestor_id, VerifierCheckpoint *checkpoint);
+
+/**
+ * @brief Stores (and persists) the checkpoint of an attestation key, replacing any previous one.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int checkpoint_store_put(CheckpointStore *store, const VerifierCheckpoint *checkpoint);
+
+/**
+ * @brief Drops the checkpoint of an attestation key, for example after a failed attestation.
+ */
+void checkpoint_store_remove(CheckpointStore *store, const char *key);
+
+/**
+ * @brief Checks whether a measurement log extends the prefix recorded in a checkpoint.
+ *
+ * Only the last accepted record is compared, which keeps the check O(1); the other bytes of the prefix are not
+ * authenticated. The verdict rests on the PCR values instead: replaying the new suffix from the checkpoint's PCR
+ * state only matches the quote if the device really extended that state. A log that was reset (reboot) and happens
+ * to pass this check fails the PCR comparison, and the caller falls back to a full replay.
+ *
+ * Callers on the incremental path must therefore read nothing of the sent prefix but its header record, and walk
+ * the suffix only through checkpoint_seek_suffix(), which holds the header to the checkpoint's banks. Anything that
+ * needs the prefix bytes themselves must first check them with checkpoint_verify_prefix().
+ *
+ * @return Returns non-zero (e.g., 1) if the log extends the checkpoint, or 0 otherwise.
+ */
+int checkpoint_matches_log(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size);
+
+/**
+ * @brief Checks the whole prefix of a log against a checkpoint's rolling prefix digest.
+ *
+ * Unlike checkpoint_matches_log() this hashes every record before byte_offset, so it costs O(prefix); callers
+ * that read the prefix bytes, rather than only extend the PCR state past them, must pass it first.
+ *
+ * @return Returns non-zero (e.g., 1) if the first event_count records of the log are the accepted prefix, or 0
+ *         otherwise.
+ */
+int checkpoint_verify_prefix(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size);
+
+/**
+ * @brief Positions a cursor on the first record after a checkpoint's prefix.
+ *
+ * The buffer's header record must list the same digest banks, in the same order, as the checkpoint's PCR state, so
+ * the suffix is parsed exactly as the accepted prefix was, whatever else a resent header holds.
+ *
+ * @param[in]  checkpoint       Checkpoint the buffer extends.
+ * @param[in]  measurement_log  Whole log, or header record and new records of a delta.
+ * @param[in]  log_size         Size of the buffer.
+ * @param[in]  base_offset      Offset in the buffer of the first record after the prefix.
+ * @param[out] cursor           Cursor over the suffix.
+ *
+ * @return Returns 0 on success, or -1 if the header does not match the checkpoint or the offset is not a record.
+ */
+int checkpoint_seek_suffix(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size,
+                           size_t base_offset, TCG_EventLogCursor *cursor);
+
+/**
+ * @brief Advances a checkpoint over the records of a log after its current prefix.
+ *
+ * Updates event_count, byte_offset, the last record anchor and the rolling prefix digest. pcrs is left to the
+ * caller, which already holds the replayed state.
+ *
+ * @return Returns 0 on success, or -1 on a malformed log.
+ */
+int checkpoint_advance(VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size);
+
+/**
+ * @brief Advances a checkpoint over a buffer holding only part of the log, such as the suffix of a delta response.
+ *
+ * The buffer must start with the log's header record, which describes the digest banks, and hold the records after
+ * the checkpoint's prefix from base_offset on. Offsets stored in the checkpoint stay offsets in the whole log.
+ *
+ * @param[in,out] checkpoint       Checkpoint to advance.
+ * @param[in]     measurement_log  Buffer holding the header and the new records.
+ * @param[in]     log_size         Size of the buffer.
+ * @param[in]     base_offset      Offset in the buffer of the first record after the checkpoint's prefix.
+ *
+ * @return Returns 0 on success, or -1 on a malformed log.
+ */
+int checkpoint_advance_from(VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size,
+                            size_t base_offset);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,173 @@
+// event_archive.h
+#ifndef EVENT_ARCHIVE_H
+#define EVENT_ARCHIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+
+// Constants
+
+#define EVENT_ARCHIVE_ID_MAX 128                /**< Bytes of an attestor ID kept in a record, NUL included */
+#define EVENT_ARCHIVE_NONE UINT64_MAX           /**< Record ID of no record */
+#define EVENT_ARCHIVE_CHUNK_AVERAGE_EVENTS 16   /**< Mean events of a chunk; a power of two */
+#define EVENT_ARCHIVE_CHUNK_MAX_EVENTS 64       /**< Most events of a chunk */
+#define EVENT_ARCHIVE_CHUNK_MAX_SIZE (64 * 1024) /**< A chunk ends once it holds this many bytes */
+#define EVENT_ARCHIVE_MAX_DEPTH 64              /**< Longest chain of delta records before one lists every chunk */
+#define EVENT_ARCHIVE_CHUNK_FILE "chunks.dat"
+#define EVENT_ARCHIVE_DIGEST_FILE "digests.idx"
+#define EVENT_ARCHIVE_RECORD_FILE "records.dat"
+
+// Structures
+
+/**
+ * @struct ArchiveAttestation
+ * @brief A verified attestation as handed to the archive.
+ *
+ * A whole log has base_events 0. A delta, as a verifier holds it after a checkpoint, is the log's header record
+ * followed by the records after the first base_events ones, which took base_size bytes of the whole log.
+ */
+typedef struct {
+    const char *attestor_id;        /**< Attestor the log came from */
+    const uint8_t *log;             /**< Measurement log, or header and delta records */
+    size_t log_size;                /**< Size of the buffer */
+    size_t base_offset;             /**< Offset in the buffer of the first record after the base; 0 for a whole log */
+    uint64_t base_events;           /**< Records of the whole log before the delta, the header included */
+    uint64_t base_size;             /**< Bytes of the whole log before the delta */
+    const uint8_t *quote;           /**< Quote the log was verified against */
+    size_t quote_size;              /**< Size of the quote */
+    int result;                     /**< 0 = pass, -1 = fail */
+    uint64_t timestamp_ns;          /**< Wall-clock time of the verdict (CLOCK_REALTIME) */
+} ArchiveAttestation;
+
+/**
+ * @struct ArchiveRecord
+ * @brief An archived attestation, as read back.
+ */
+typedef struct {
+    uint64_t id;                    /**< Record ID: its offset in the record file, in order of archiving */
+    uint64_t parent;                /**< Record holding the log's first records, or EVENT_ARCHIVE_NONE */
+    uint64_t timestamp_ns;          /**< Wall-clock time of the verdict */
+    int result;                     /**< 0 = pass, -1 = fail */
+    uint64_t event_count;           /**< Records of the whole log, the header included */
+    uint64_t log_size;              /**< Size of the whole log */
+    uint32_t chunk_count;           /**< Chunks this record references itself */
+    char attestor_id[EVENT_ARCHIVE_ID_MAX]; /**< Attestor */
+    const uint8_t *quote;           /**< Quote; valid until the visitor returns */
+    size_t quote_size;              /**< Size of the quote */
+} ArchiveRecord;
+
+/**
+ * @struct ArchiveStats
+ * @brief Size of an archive against the logs it holds.
+ */
+typedef struct {
+    uint64_t records;               /**< Attestations archived */
+    uint64_t appended;              /**< Attestations archived this session */
+    uint64_t chunks;                /**< Unique chunks stored */
+    uint64_t digests;               /**< Unique event digests indexed, across banks */
+    uint64_t log_bytes;             /**< Bytes of the whole logs archived this session, as if each were kept */
+    uint64_t chunk_bytes;           /**< Bytes of chunks stored this session */
+    uint64_t stored_bytes;          /**< Size of the archive files */
+} ArchiveStats;
+
+/**
+ * @struct EventArchive
+ * @brief Append-only, content-addressed archive of verified measurement logs.
+ *
+ * Logs are split at event boundaries into chunks: the header record alone, then runs of events that end where an
+ * event's first digest has its low bits clear, so that the same events produce the same runs in every log that
+ * holds them. Each unique chunk is stored once, keyed by its SHA-256, and every digest of its events is indexed.
+ * An attestation is stored as a record: the attestor, the quote and the list of chunks its log is made of. A delta
+ * that extends the attestor's previous record references it as its parent instead of listing the chunks again;
+ * every EVENT_ARCHIVE_MAX_DEPTH records of a chain, a record lists all of its chunks so a log is rebuilt from a
+ * bounded number of records.
+ *
+ * The archive is a directory of three append-only files: the chunks, the digest index and the records. Nothing is
+ * rewritten, so a crash only leaves a torn tail, which opening truncates. The chunk table, the digest index and
+ * each attestor's last record are held in memory and rebuilt when the archive is opened. One archive is shared by
+ * every verification thread.
+ */
+typedef struct EventArchive EventArchive;
+
+/**
+ * @brief Visits an archived record.
+ *
+ * @return Returns 0 to continue, or non-zero to stop the walk.
+ */
+typedef int (*ArchiveRecordVisitor)(const ArchiveRecord *record, void *context);
+
+// Function Prototypes
+
+/**
+ * @brief Opens an archive, creating the directory and its files if needed.
+ *
+ * @param[in] directory  Directory of the archive.
+ *
+ * @return Pointer to the archive, or NULL on failure.
+ */
+EventArchive *event_archive_open(const char *directory);
+
+/**
+ * @brief Closes an archive. Everything appended is already in its files.
+ */
+void event_archive_close(EventArchive *archive);
+
+/**
+ * @brief Archives a verified attestation.
+ *
+ * The log is walked with the event log cursor. Chunks not stored yet are appended with their digests, then the
+ * record. A delta whose base is the attestor's last record becomes its child; one whose base was never archived
+ * is stored with no parent, and its log cannot be rebuilt.
+ *
+ * @param[in]  archive      Archive.
+ * @param[in]  attestation  Attestation to archive.
+ * @param[out] record_id    ID of the new record, or NULL.
+ *
+ * @return Returns 0 on success, or -1 if the log does not parse or the archive cannot be written.
+ */
+int event_archive_append(EventArchive *archive, const ArchiveAttestation *attestation, uint64_t *record_id);
+
+/**
+ * @brief Rebuilds the whole log of an archived attestation.
+ *
+ * @param[in]  archive    Archive.
+ * @param[in]  record_id  Record to rebuild.
+ * @param[out] log        Log, byte for byte as the attestor sent it; the caller frees it.
+ * @param[out] log_size   Size of the log.
+ *
+ * @return Returns 0 on success, or -1 if there is no such record or its chain does not reach a whole log.
+ */
+int event_archive_read_log(EventArchive *archive, uint64_t record_id, uint8_t **log, size_t *log_size);
+
+/**
+ * @brief Visits every record in the order it was archived.
+ *
+ * @return Returns 0 on success, or -1 if the record file cannot be read.
+ */
+int event_archive_scan(EventArchive *archive, ArchiveRecordVisitor visitor, void *context);
+
+/**
+ * @brief Visits every record whose log holds an event with a given digest.
+ *
+ * The digest index names the chunks that hold the digest; one pass over the record file then finds the records
+ * referencing them, and the descendants of those records, whose logs hold the same events.
+ *
+ * @param[in] archive      Archive.
+ * @param[in] alg          Hash algorithm of the digest.
+ * @param[in] digest       Digest.
+ * @param[in] digest_size  Size of the digest.
+ * @param[in] visitor      Called for each matching record, in order.
+ * @param[in] context      Passed to the visitor.
+ *
+ * @return Number of records visited, or -1 on failure.
+ */
+int64_t event_archive_find_digest(EventArchive *archive, TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size,
+                                  ArchiveRecordVisitor visitor, void *context);
+
+/**
+ * @brief Reads the sizes of an archive.
+ */
+void event_archive_get_stats(EventArchive *archive, ArchiveStats *stats);
+
+#endif // EVENT_ARCHIVE_H
@@ -0,0 +1,70 @@
+// log_pipeline.h
+#ifndef LOG_PIPELINE_H
+#define LOG_PIPELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "event_log_verifier.h"
+#include "pcr.h"
+
+// Constants
+
+#define LOG_PIPELINE_DEFAULT_MIN_LOG_SIZE (1u << 20)   /**< Smaller logs are verified on the calling thread */
+#define LOG_PIPELINE_CHUNK_EVENTS 4096                 /**< Events per RIM matching task */
+
+// Structures
+
+/**
+ * @struct LogPipeline
+ * @brief Verifies one large event log on several threads: PCR replay and RIM matching.
+ *
+ * The calling thread scans the log and cuts it into chunks of LOG_PIPELINE_CHUNK_EVENTS events. Pool threads start
+ * matching chunks against the RIM while the scan is still going, each into its own partial report. The caller then
+ * groups the digests into per-PCR extend chains, and every (bank, PCR) chain is replayed as its own task, longest
+ * first and ahead of any waiting chunk. The calling thread runs tasks too, so a verification never waits on a pool
+ * thread that has not started. Partial reports are merged in log order, so the result is the one sequential
+ * verification gives.
+ */
+typedef struct LogPipeline LogPipeline;
+
+// Function Prototypes
+
+/**
+ * @brief Creates a pipeline and its pool of helper threads.
+ *
+ * @param[in] num_workers    Helper threads; 0 uses one per online CPU.
+ * @param[in] min_log_size   Logs smaller than this are left to sequential verification (see log_pipeline_accepts());
+ *                           0 for LOG_PIPELINE_DEFAULT_MIN_LOG_SIZE.
+ *
+ * @return Pointer to the pipeline, or NULL on failure.
+ */
+LogPipeline *log_pipeline_create(size_t num_workers, size_t min_log_size);
+
+/**
+ * @brief Waits for every helper task and releases the pipeline.
+ */
+void log_pipeline_destroy(LogPipeline *pipeline);
+
+/**
+ * @brief Returns whether a log is large enough for the pipeline to pay off.
+ */
+bool log_pipeline_accepts(const LogPipeline *pipeline, size_t log_size);
+
+/**
+ * @brief Replays a whole event log and checks every event against the RIM, in parallel.
+ *
+ * @param[in]  pipeline      Pipeline to run on.
+ * @param[in]  event_log     Event log buffer.
+ * @param[in]  log_size      Size of the event log buffer.
+ * @param[in]  rim_index     RIM the events are checked against.
+ * @param[out] replayed      Replayed PCR state.
+ * @param[out] report        Optional; filled as process_event_log_report() would.
+ * @param[out] rim_accepted  Whether every event matched the RIM.
+ *
+ * @return Returns 0 on success, or -1 if the log is malformed or could not be replayed.
+ */
+int log_pipeline_verify(LogPipeline *pipeline, const uint8_t *event_log, size_t log_size, const RIM_Index *rim_index,
+                        PCR_BankSet *replayed, RIM_CheckReport *report, bool *rim_accepted);
+
+#endif // LOG_PIPELINE_H
@@ -0,0 +1,133 @@
+// quote.h
+#ifndef QUOTE_H
+#define QUOTE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+#include "pcr.h"
+#include "nonce_tree.h"
+
+// Constants
+
+#define AK_CACHE_MIN_RSA_BITS 2048  /**< Smallest RSA attestation key accepted */
+
+// Structures
+
+/**
+ * @struct TPM_Quote
+ * @brief A TPM2_Quote result as carried in AttestationResponse.quote: a marshaled TPM2B_ATTEST followed by a
+ * marshaled TPMT_SIGNATURE.
+ */
+typedef struct {
+    TPMS_ATTEST attest;             /**< Parsed attestation structure */
+    TPMT_SIGNATURE signature;       /**< Signature over attest_data */
+    const uint8_t *attest_data;     /**< Signed bytes of the TPMS_ATTEST; a view into the quote buffer */
+    size_t attest_size;             /**< Size of attest_data */
+} TPM_Quote;
+
+/**
+ * @struct AK_Cache
+ * @brief Attestation keys the verifier trusts, keyed by TPM qualified name.
+ *
+ * Keys are decoded into OpenSSL keys and validated once, when they are added: they must be restricted, fixedTPM
+ * signing keys, RSA of at least AK_CACHE_MIN_RSA_BITS or ECC on NIST P-256/P-384, and, if the cache has a CA
+ * bundle, certified by a chain to it. A quote then finds its key by the qualified name it carries in
+ * qualifiedSigner, which the TPM derives from the key's name and its parent's qualified name, so no key is decoded
+ * and no certificate chain is built per request. Lookups may run concurrently with each other and with additions.
+ */
+typedef struct AK_Cache AK_Cache;
+
+// Function Prototypes
+
+/**
+ * @brief Creates an attestation key cache.
+ *
+ * @param[in] ca_file  PEM bundle of CAs that must certify every key; NULL trusts keys as they are enrolled.
+ *
+ * @return Pointer to the cache, or NULL on failure.
+ */
+AK_Cache *ak_cache_create(const char *ca_file);
+
+/**
+ * @brief Releases an attestation key cache.
+ */
+void ak_cache_destroy(AK_Cache *cache);
+
+/**
+ * @brief Validates an attestation key and adds it to the cache.
+ *
+ * @param[in] cache        Attestation key cache.
+ * @param[in] public_blob  Marshaled TPM2B_PUBLIC of the key, as returned by TPM2_ReadPublic.
+ * @param[in] public_size  Size of public_blob.
+ * @param[in] parent       Qualified name of the key's parent, as TPM2_ReadPublic returns it for the parent; NULL
+ *                         for a primary key of the endorsement hierarchy.
+ * @param[in] cert_file    PEM certificate of the key; required if the cache has a CA bundle, else may be NULL.
+ *
+ * @return Returns 0 on success, or -1 if the key is malformed, not an acceptable attestation key, or not
+ *         certified.
+ */
+int ak_cache_add(AK_Cache *cache, const uint8_t *public_blob, size_t public_size, const TPM2B_NAME *parent,
+                 const char *cert_file);
+
+/**
+ * @brief Reads a marshaled TPM2B_PUBLIC, and the raw qualified name of its parent if parent_file is not NULL,
+ *        from files and adds the key with ak_cache_add().
+ */
+int ak_cache_add_file(AK_Cache *cache, const char *public_file, const char *parent_file, const char *cert_file);
+
+/**
+ * @brief Returns the number of keys in the cache.
+ */
+size_t ak_cache_count(const AK_Cache *cache);
+
+/**
+ * @brief Parses a quote. No signature or content is checked.
+ *
+ * @param[in]  quote       Marshaled TPM2B_ATTEST followed by a marshaled TPMT_SIGNATURE.
+ * @param[in]  quote_size  Size of the quote.
+ * @param[out] parsed      Parsed quote; attest_data points into quote.
+ *
+ * @return Returns 0 on success, or -1 on a malformed quote.
+ */
+int quote_parse(const uint8_t *quote, size_t quote_size, TPM_Quote *parsed);
+
+/**
+ * @brief Verifies a parsed quote.
+ *
+ * Checks that the attestation structure was generated by a TPM and is a quote, that it carries the verifier's
+ * nonce, that it was signed by a cached attestation key, and that the signature (RSASSA, RSA-PSS or ECDSA over
+ * SHA-256/384/512) is valid.
+ *
+ * Every call checks one signature. Quotes are not batched across responses: OpenSSL verifies ECDSA signatures one
+ * at a time, so a batch could only share the key's verification context, and each response is verified on its own
+ * worker. What is shared is done once: keys are decoded and certified when they enter the cache.
+ *
+ * @return Returns 0 if the quote verified, or -1 otherwise.
+ */
+int quote_verify(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size);
+
+/**
+ * @brief Verifies a coalesced quote, whose qualifyingData is the root of a tree of nonces rather than one nonce.
+ *
+ * The root is recomputed from the verifier's own nonce and the inclusion proof, and the quote is then verified
+ * against it with quote_verify(). A quote shared by many verifiers thus passes for each of them only if the TPM
+ * committed to that verifier's nonce.
+ *
+ * @return Returns 0 if the quote verified, or -1 otherwise.
+ */
+int quote_verify_coalesced(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size,
+                           const NonceProof *proof);
+
+/**
+ * @brief Checks the quote's PCR digest against replayed PCR values.
+ *
+ * The digest covers the selected PCRs of each bank in selection order, lowest index first, hashed with the hash
+ * algorithm of the quote's signature. The selection must cover every PCR the replayed log extended, in every bank
+ * of the log: PCRs left out of the quote are vouched for by nothing but the attestor's own report.
+ *
+ * @return Returns 0 if the digests match and the selection covers the log, or -1 otherwise.
+ */
+int quote_check_pcr_digest(const TPM_Quote *quote, const PCR_BankSet *pcrs);
+
+#endif // QUOTE_H
@@ -0,0 +1,106 @@
+// rim_store.h
+#ifndef RIM_STORE_H
+#define RIM_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "manifest.h"
+
+// Structures
+
+/**
+ * @struct RimVersion
+ * @brief One published RIM index, immutable once published.
+ */
+typedef struct {
+    RIM_Index index;                /**< The index; read-only */
+    uint64_t version;               /**< Position in the store's history: 1 for the first RIM published */
+    uint64_t serial;                /**< Serial of the compiled image it was mapped from, or 0 for a manifest */
+    uint64_t published_ns;          /**< Wall-clock time it was published (CLOCK_REALTIME) */
+} RimVersion;
+
+/**
+ * @struct RimStoreStats
+ * @brief Counters of a RIM store.
+ */
+typedef struct {
+    uint64_t version;               /**< Version new readers see, or 0 if none was published */
+    uint64_t published;             /**< Versions published */
+    uint64_t retired;               /**< Replaced versions waiting for their last reader */
+    uint64_t reclaimed;             /**< Replaced versions freed */
+    size_t readers;                 /**< Reader slots, one per thread that ever read the store and is alive */
+} RimStoreStats;
+
+/**
+ * @struct RimStore
+ * @brief The current RIM of a running verifier, replaced without stopping it.
+ *
+ * Readers never lock. The current version is one atomic pointer; a thread pins it by announcing the store's
+ * epoch in a reader slot of its own (taken over from an exited thread, or added to a lock-free list) and then
+ * loading the pointer, and unpins it by clearing the slot. Publishing swaps the pointer, advances the epoch and
+ * retires the old version with the new epoch. A retired version is freed once no slot announces an older epoch:
+ * every reader that could still hold it has finished. Publishing and reclaiming are serialized by a mutex that
+ * readers never see.
+ *
+ * A verification pins the store once and uses the same version throughout, so one that is in flight when a new
+ * RIM is published finishes against the old one, and every verification that starts afterwards uses the new one.
+ */
+typedef struct RimStore RimStore;
+
+// Function Prototypes
+
+/**
+ * @brief Creates an empty RIM store.
+ *
+ * @return Pointer to the store, or NULL on failure.
+ */
+RimStore *rim_store_create(void);
+
+/**
+ * @brief Frees a store and every version it holds. No thread may have it pinned.
+ */
+void rim_store_destroy(RimStore *store);
+
+/**
+ * @brief Publishes a new RIM. New pins see it at once; the previous version is retired and reclaimed later.
+ *
+ * @param[in]     store    RIM store.
+ * @param[in,out] index    Built or mapped index; the store takes it over and leaves it empty.
+ * @param[in]     serial   Serial of the image it was mapped from, or 0.
+ * @param[out]    version  Version number given to it, or NULL.
+ *
+ * @return Returns 0 on success, or -1 on failure, in which case index is left to the caller.
+ */
+int rim_store_publish(RimStore *store, RIM_Index *index, uint64_t serial, uint64_t *version);
+
+/**
+ * @brief Pins the current version for the calling thread. Wait-free once the thread has a reader slot.
+ *
+ * Pins nest: a thread that already holds one gets the version it pinned first, and the version stays valid until
+ * the matching number of rim_store_unpin() calls.
+ *
+ * @return The pinned version, or NULL if nothing was published or no reader slot could be allocated; then nothing
+ *         is pinned and rim_store_unpin() must not be called.
+ */
+const RimVersion *rim_store_pin(RimStore *store);
+
+/**
+ * @brief Releases a pin taken by rim_store_pin().
+ */
+void rim_store_unpin(RimStore *store);
+
+/**
+ * @brief Frees the retired versions no reader can still hold.
+ *
+ * Called by rim_store_publish(); call it again later to free versions readers held at the time.
+ *
+ * @return Number of versions still retired.
+ */
+size_t rim_store_reclaim(RimStore *store);
+
+/**
+ * @brief Reads the counters of a store.
+ */
+void rim_store_get_stats(RimStore *store, RimStoreStats *stats);
+
+#endif // RIM_STORE_H
@@ -0,0 +1,65 @@
+// standin_attestor.h
+#ifndef STANDIN_ATTESTOR_H
+#define STANDIN_ATTESTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Structures
+
+/**
+ * @struct StandinAttestors
+ * @brief In-process attestors for load-testing the verifier daemon on one machine.
+ *
+ * Each stand-in sits on one end of a socketpair, or on a connection accepted from a listening socket, and answers
+ * every framed AttestationRequest (pipelined requests in order) with an
+ * AttestationResponse carrying its own attestor ID, the given event log, the SHA-256 PCR values that log replays to,
+ * and a quote over those PCRs and the request's nonce, signed by a software ECDSA P-256 attestation key. All
+ * stand-ins are served by a single epoll thread, so the measured cost is the verifier's.
+ */
+typedef struct StandinAttestors StandinAttestors;
+
+// Function Prototypes
+
+/**
+ * @brief Starts stand-in attestors.
+ *
+ * @param[in]  count         Number of stand-ins.
+ * @param[in]  event_log     Event log every stand-in reports; copied.
+ * @param[in]  log_size      Size of the event log.
+ * @param[out] verifier_fds  Array of count entries receiving the verifier end of each stand-in's connection,
+ *                           for verifier_daemon_add_attestor_fd().
+ *
+ * @return Pointer to the running stand-ins, or NULL on failure.
+ */
+StandinAttestors *standin_attestors_start(size_t count, const uint8_t *event_log, size_t log_size,
+                                          int *verifier_fds);
+
+/**
+ * @brief Starts stand-in attestors behind a listening socket, for benchmarking over loopback TCP or a Unix socket.
+ *
+ * Each accepted connection becomes the next stand-in; connections beyond count are refused.
+ *
+ * @param[in] count      Number of stand-ins.
+ * @param[in] event_log  Event log every stand-in reports; copied.
+ * @param[in] log_size   Size of the event log.
+ * @param[in] address    "unix:<path>" or "<host>:<port>" to listen on.
+ *
+ * @return Pointer to the running stand-ins, or NULL on failure.
+ */
+StandinAttestors *standin_attestors_listen(size_t count, const uint8_t *event_log, size_t log_size,
+                                           const char *address);
+
+/**
+ * @brief Returns the marshaled TPM2B_PUBLIC of the stand-ins' attestation key, for ak_cache_add().
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int standin_attestors_ak_public(const StandinAttestors *attestors, const uint8_t **public_blob, size_t *public_size);
+
+/**
+ * @brief Stops the stand-ins and closes their ends of the connections.
+ */
+void standin_attestors_stop(StandinAttestors *attestors);
+
+#endif // STANDIN_ATTESTOR_H
@@ -0,0 +1,116 @@
+// verdict_cache.h
+#ifndef VERDICT_CACHE_H
+#define VERDICT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "manifest.h"
+#include "pcr.h"
+
+// Constants
+
+#define VERDICT_CACHE_DIGEST_SIZE 32    /**< Size of the log digest in a VerdictKey (SHA-256) */
+
+// Enumerations
+
+/**
+ * @enum LogVerdict
+ * @brief Outcome of the response-independent checks of a measurement log: replay and RIM check.
+ */
+typedef enum {
+    LOG_VERDICT_ACCEPTED,           /**< The log replays and every event matches the RIM */
+    LOG_VERDICT_REJECTED            /**< The log is malformed or an event does not match the RIM */
+} LogVerdict;
+
+// Structures
+
+/**
+ * @struct VerdictKey
+ * @brief Content address of a log verdict: what was checked, against which RIM, under which policy.
+ */
+typedef struct {
+    uint8_t log_digest[VERDICT_CACHE_DIGEST_SIZE];  /**< SHA-256 of the measurement log bytes */
+    uint8_t rim_digest[RIM_INDEX_DIGEST_SIZE];      /**< RIM_Index.content_digest of the RIM checked against */
+    uint32_t policy_version;                        /**< Version of the verification policy */
+} VerdictKey;
+
+/**
+ * @struct VerdictCacheStats
+ * @brief Counters of a verdict cache.
+ */
+typedef struct {
+    uint64_t hits;                  /**< Lookups that found a verdict */
+    uint64_t misses;                /**< Lookups that did not */
+    uint64_t insertions;            /**< Verdicts stored */
+    uint64_t evictions;             /**< Verdicts dropped to make room */
+    size_t entries;                 /**< Verdicts currently held */
+    size_t capacity;                /**< Maximum number of verdicts held */
+} VerdictCacheStats;
+
+/**
+ * @struct VerdictCache
+ * @brief Fleet-wide cache of log verdicts, shared by all attestors.
+ *
+ * Machines booting the same firmware and kernel send byte-identical boot logs, and a log's replayed PCRs and RIM
+ * verdict depend only on its bytes, the RIM and the policy. The cache keeps both for recently seen logs, so
+ * verifying such a log again costs one hash of the log instead of a replay and a RIM check. Quotes and nonces are
+ * never cached: they are checked on every response, and the reported PCRs and quoted PCR digest are compared with
+ * the cached PCR values.
+ *
+ * The cache holds at most capacity verdicts in one preallocated table, each about sizeof(PCR_BankSet) bytes, and
+ * evicts with the CLOCK algorithm. All functions are thread-safe.
+ */
+typedef struct VerdictCache VerdictCache;
+
+// Function Prototypes
+
+/**
+ * @brief Creates a verdict cache.
+ *
+ * @param[in] capacity  Maximum number of verdicts held.
+ *
+ * @return Pointer to the cache, or NULL on failure.
+ */
+VerdictCache *verdict_cache_create(size_t capacity);
+
+/**
+ * @brief Releases a verdict cache.
+ */
+void verdict_cache_destroy(VerdictCache *cache);
+
+/**
+ * @brief Computes the key of a measurement log checked against a RIM under a policy.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verdict_cache_key(VerdictKey *key, const uint8_t *measurement_log, size_t log_size, const RIM_Index *rim_index,
+                      uint32_t policy_version);
+
+/**
+ * @brief Looks up a verdict.
+ *
+ * @param[in]  cache    Verdict cache.
+ * @param[in]  key      Key of the log.
+ * @param[out] verdict  Cached verdict.
+ * @param[out] pcrs     Replayed PCR values of the log; only set if the verdict is LOG_VERDICT_ACCEPTED.
+ *
+ * @return Returns 0 on a hit, or -1 on a miss.
+ */
+int verdict_cache_lookup(VerdictCache *cache, const VerdictKey *key, LogVerdict *verdict, PCR_BankSet *pcrs);
+
+/**
+ * @brief Stores a verdict, replacing any previous verdict for the key and evicting one if the cache is full.
+ *
+ * @param[in] cache    Verdict cache.
+ * @param[in] key      Key of the log.
+ * @param[in] verdict  Verdict of the log.
+ * @param[in] pcrs     Replayed PCR values of the log; required if verdict is LOG_VERDICT_ACCEPTED, else ignored.
+ */
+void verdict_cache_insert(VerdictCache *cache, const VerdictKey *key, LogVerdict verdict, const PCR_BankSet *pcrs);
+
+/**
+ * @brief Returns the counters of a verdict cache.
+ */
+void verdict_cache_get_stats(VerdictCache *cache, VerdictCacheStats *stats);
+
+#endif // VERDICT_CACHE_H
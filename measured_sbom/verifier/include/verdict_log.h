@@ -0,0 +1,141 @@
+// verdict_log.h
+#ifndef VERDICT_LOG_H
+#define VERDICT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "event_log_verifier.h"
+
+// Constants
+
+#define VERDICT_LOG_DEFAULT_CAPACITY 4096   /**< Verdicts queued for the writer before new ones are dropped */
+#define VERDICT_ATTESTOR_ID_MAX 64          /**< Bytes of the attestor ID kept in a verdict, NUL included */
+#define VERDICT_BINARY_MAGIC 0x32445256u    /**< "VRD2", first field of every binary verdict record */
+
+// Enumerations
+
+/**
+ * @enum VerdictLevel
+ * @brief How much of each attestation a verdict log records.
+ */
+typedef enum {
+    VERDICT_LEVEL_SUMMARY,          /**< Result, reason, first failing event and per-PCR counts */
+    VERDICT_LEVEL_FAILURES,         /**< Also every event that did not match the RIM */
+    VERDICT_LEVEL_EVENTS            /**< Also the status of every event */
+} VerdictLevel;
+
+/**
+ * @enum VerdictFormat
+ * @brief Encoding of the records a verdict log writes.
+ */
+typedef enum {
+    VERDICT_FORMAT_JSON,            /**< One JSON object per line */
+    VERDICT_FORMAT_BINARY           /**< Little-endian records; layout in verdict_log.c */
+} VerdictFormat;
+
+/**
+ * @enum VerdictReason
+ * @brief Why an attestation failed.
+ */
+typedef enum {
+    VERDICT_REASON_NONE,            /**< It passed */
+    VERDICT_REASON_MALFORMED,       /**< The response, quote or nonce proof could not be decoded */
+    VERDICT_REASON_QUOTE,           /**< Wrong nonce, unknown key or invalid signature */
+    VERDICT_REASON_LOG_FORMAT,      /**< The measurement log could not be extracted or parsed */
+    VERDICT_REASON_CHECKPOINT,      /**< A delta log does not follow the verifier's checkpoint */
+    VERDICT_REASON_PCR_MISMATCH,    /**< The replayed log does not reproduce the reported or quoted PCRs */
+    VERDICT_REASON_RIM,             /**< An event is unknown to the RIM or does not match it */
+    VERDICT_REASON_COUNT
+} VerdictReason;
+
+// Structures
+
+/**
+ * @struct AttestationVerdict
+ * @brief Structured outcome of one attestation.
+ *
+ * The RIM check report holds the per-event statuses when the level asks for them; a verdict that comes from the
+ * verdict cache or a rejected log before the RIM check has none.
+ */
+typedef struct {
+    uint64_t timestamp_ns;                      /**< Wall-clock time of the verdict (CLOCK_REALTIME) */
+    char attestor_id[VERDICT_ATTESTOR_ID_MAX];  /**< Attestor, empty if the response did not say */
+    int result;                                 /**< 0 = pass, -1 = fail */
+    VerdictReason reason;                       /**< Why it failed */
+    bool rim_cached;                            /**< RIM verdict taken from the verdict cache */
+    uint64_t rim_version;                       /**< RIM store version it was verified against, 0 if none */
+    uint8_t rim_digest[RIM_INDEX_DIGEST_SIZE];  /**< Content digest of that RIM, zero if none */
+    RIM_CheckReport rim;                        /**< RIM check of the events verified this round */
+} AttestationVerdict;
+
+/**
+ * @struct VerdictLogConfig
+ * @brief Where and how a verdict log writes.
+ */
+typedef struct {
+    const char *path;               /**< Output file, appended to; NULL or "-" for stdout */
+    VerdictFormat format;           /**< Encoding of the records */
+    VerdictLevel level;             /**< Detail recorded */
+    size_t capacity;                /**< Ring slots, rounded up to a power of two; 0 for the default */
+} VerdictLogConfig;
+
+/**
+ * @struct VerdictLogStats
+ * @brief Counters of a verdict log.
+ */
+typedef struct {
+    uint64_t submitted;             /**< Verdicts queued */
+    uint64_t dropped;               /**< Verdicts dropped because the ring was full */
+    uint64_t written;               /**< Verdicts written out */
+} VerdictLogStats;
+
+/**
+ * @struct VerdictLog
+ * @brief Asynchronous sink of attestation verdicts.
+ *
+ * Verification threads copy their verdict into a bounded lock-free ring (multiple producers, one consumer) and
+ * return; a background thread encodes and writes them. Nothing on the verification path takes the stdio lock or
+ * waits for I/O. When the writer falls behind and the ring is full, verdicts are dropped and counted rather than
+ * stalling verification. Event detail is copied out of the verifying thread's report only at the levels that
+ * record it.
+ */
+typedef struct VerdictLog VerdictLog;
+
+// Function Prototypes
+
+/**
+ * @brief Opens the output and starts the writer thread.
+ *
+ * @return Pointer to the verdict log, or NULL on failure.
+ */
+VerdictLog *verdict_log_create(const VerdictLogConfig *config);
+
+/**
+ * @brief Writes every queued verdict, stops the writer and closes the output.
+ */
+void verdict_log_destroy(VerdictLog *log);
+
+/**
+ * @brief Returns the level of a verdict log, which decides the event detail verifiers collect for it.
+ */
+VerdictLevel verdict_log_level(const VerdictLog *log);
+
+/**
+ * @brief Queues a verdict for the writer. Never blocks.
+ *
+ * @return Returns 0 if the verdict was queued, or -1 if it was dropped.
+ */
+int verdict_log_submit(VerdictLog *log, const AttestationVerdict *verdict);
+
+/**
+ * @brief Reads the counters of a verdict log.
+ */
+void verdict_log_get_stats(VerdictLog *log, VerdictLogStats *stats);
+
+/**
+ * @brief Returns the name of a reason, as written in JSON records.
+ */
+const char *verdict_reason_str(VerdictReason reason);
+
+#endif // VERDICT_LOG_H
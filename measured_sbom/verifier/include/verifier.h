@@ -1,22 +1,251 @@
+// verifier.h
 #ifndef VERIFIER_H
 #define VERIFIER_H
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "attestation.pb-c.h"  // Protobuf definitions for attestation
+#include "manifest.h"
+#include "pcr.h"
+#include "checkpoint.h"
+#include "quote.h"
+#include "verdict_cache.h"
+#include "verdict_log.h"
+#include "log_pipeline.h"
+#include "log_dictionary.h"
+#include "event_archive.h"
+#include "rim_store.h"
+#include "transport.h"
 
-// Function to send an attestation request to the attestor
-// The request will include a nonce to ensure freshness of the attestation
-void send_attestation_request();
+// Constants
 
-// Function to process the attestation response from the attestor
-// Parameters:
-// - response_buffer: Pointer to the buffer containing the serialized attestation response
-// - response_size: Size of the response buffer
-void process_attestation_response(uint8_t *response_buffer, size_t response_size);
+#define VERIFIER_NONCE_SIZE 32  /**< Size of the random nonce sent with every attestation request */
+#define VERIFIER_RESPONSE_TIMEOUT_MS 30000  /**< Longest wait for the attestor to connect or answer */
+#define VERIFIER_MAX_PENDING 1024  /**< Responses held for pipelined requests not yet asked for */
 
-// Function to verify the received PCR values and measurement logs
-// This function will compare the received logs with expected values
-// Returns: 1 if verification succeeds, 0 otherwise
-int verify_attestation_data();
+// Enumerations
 
-#endif // VERIFIER_H
\ No newline at end of file
+/**
+ * @enum VerifierState
+ * @brief Enumeration of states in the verifier's attestation protocol state machine.
+ */
+typedef enum {
+    VERIFIER_STATE_INIT,            /**< Initial state */
+    VERIFIER_STATE_SEND_REQUEST,    /**< Sending the attestation request */
+    VERIFIER_STATE_WAIT_FOR_RESPONSE,/**< Waiting for the attestation response */
+    VERIFIER_STATE_PROCESS_RESPONSE,/**< Processing the attestation response */
+    VERIFIER_STATE_DONE,            /**< Attestation protocol completed */
+    VERIFIER_STATE_ERROR            /**< An error occurred */
+} VerifierState;
+
+// Structures
+
+/**
+ * @struct VerifierKnownLog
+ * @brief The prefix of its log that a request told the attestor the verifier holds.
+ *
+ * A delta response is accepted only if it follows exactly this prefix, so an attestor cannot pick the base of its
+ * delta itself.
+ */
+typedef struct {
+    uint64_t events;                                /**< Records in the prefix; 0 if the whole log was asked for */
+    uint64_t size;                                  /**< Size of the prefix in bytes */
+    uint8_t digest[PCR_LOG_DIGEST_SIZE];            /**< Rolling digest of the prefix */
+} VerifierKnownLog;
+
+/**
+ * @struct VerifierContext
+ * @brief Context structure for the verifier's attestation protocol state machine.
+ *
+ * run_verifier_protocol() drives one context to completion over the connection opened by verifier_connect(),
+ * waiting for its response. The verifier daemon keeps one
+ * context per attestor session and advances it through the same states itself (see verifier_daemon.h).
+ */
+typedef struct {
+    VerifierState state;            /**< Current state of the verifier's protocol */
+    uint8_t *request_buffer;        /**< Buffer containing the attestation request */
+    size_t request_size;            /**< Size of the request buffer */
+    uint8_t *response_buffer;       /**< Buffer containing the attestation response */
+    size_t response_size;           /**< Size of the response buffer */
+    int attestation_result;         /**< Result of the attestation (0 = pass, -1 = fail) */
+    uint8_t nonce[VERIFIER_NONCE_SIZE];/**< Nonce of the current request, which the quote must carry */
+    VerifierKnownLog known;         /**< Log prefix the current request said the verifier holds */
+    char attestor_id[CHECKPOINT_ID_MAX];/**< Attestor of the last verified response, or empty; selects the checkpoint
+                                             whose log position the next request carries */
+} VerifierContext;
+
+// Function Prototypes
+
+/**
+ * @brief Creates an attestation request carrying a fresh random nonce.
+ *
+ * @param[out] nonce          Buffer receiving the nonce.
+ * @param[in]  nonce_size     Size of the nonce to generate.
+ * @param[out] request_buffer Pointer to the buffer where the serialized request will be stored.
+ * @param[out] request_size   Pointer to a size_t variable where the size of the request will be stored.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int create_attestation_request(uint8_t *nonce, size_t nonce_size, uint8_t **request_buffer, size_t *request_size);
+
+/**
+ * @brief Creates an attestation request that also tells the attestor which prefix of its log the verifier holds.
+ *
+ * The prefix is the one recorded in the checkpoint last stored with the attestor ID; without one the request is the
+ * same as one from create_attestation_request(), and the attestor sends its whole log. The ID only picks the hint:
+ * the response is checked against the checkpoint of the key that signs its quote.
+ *
+ * @param[in]  attestor_id    Attestor the request is for, or NULL if not known yet.
+ * @param[out] nonce          Buffer receiving the nonce.
+ * @param[in]  nonce_size     Size of the nonce to generate.
+ * @param[out] known          Receives the prefix the request offers, for process_attestation_response(); may be
+ *                            NULL if no delta response is to be accepted.
+ * @param[out] request_buffer Pointer to the buffer where the serialized request will be stored.
+ * @param[out] request_size   Pointer to a size_t variable where the size of the request will be stored.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int create_attestation_request_for(const char *attestor_id, uint8_t *nonce, size_t nonce_size, VerifierKnownLog *known,
+                                   uint8_t **request_buffer, size_t *request_size);
+
+/**
+ * @brief Connects to the attestor that send_attestation_request() and receive_attestation_response() talk to,
+ * replacing any previous connection. Not thread-safe; the verifier daemon is the concurrent path.
+ *
+ * @param[in] address  "unix:<path>" or "<host>:<port>".
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_connect(const char *address);
+
+/**
+ * @brief Closes the connection to the attestor.
+ */
+void verifier_disconnect(void);
+
+/**
+ * @brief Sends the attestation request to the attestor without waiting for the response, so further requests can
+ * be pipelined behind it.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int send_attestation_request(uint8_t *request_buffer, size_t request_size);
+
+/**
+ * @brief Receives the response answering the request with the given nonce; responses to other pipelined requests
+ * are held until they are asked for.
+ *
+ * @param[in]  nonce           Nonce of the request.
+ * @param[in]  nonce_size      Size of the nonce.
+ * @param[out] response_buffer Response, to be released with release_attestation_response().
+ * @param[out] response_size   Size of the response.
+ *
+ * @return Returns 0 on success, or -1 on failure or timeout.
+ */
+int receive_attestation_response(const uint8_t *nonce, size_t nonce_size, uint8_t **response_buffer,
+                                 size_t *response_size);
+
+/**
+ * @brief Releases a response obtained from receive_attestation_response(). NULL is ignored.
+ */
+void release_attestation_response(uint8_t *response_buffer);
+
+/**
+ * @brief Processes the attestation response received from the attestor.
+ *
+ * Safe to call from several threads at once, provided the RIM index and checkpoint store are set beforehand.
+ *
+ * @param[in]  response_buffer     Pointer to the buffer containing the serialized response.
+ * @param[in]  response_size       Size of the response buffer.
+ * @param[in]  nonce               Nonce of the request the response answers.
+ * @param[in]  nonce_size          Size of the nonce.
+ * @param[in]  known               Log prefix that request offered, from create_attestation_request_for(); NULL
+ *                                 if it offered none, in which case a delta response fails.
+ * @param[out] attestation_result  Pointer to an integer where the attestation result will be stored (0 = pass, -1 = fail).
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int process_attestation_response(uint8_t *response_buffer, size_t response_size, const uint8_t *nonce,
+                                 size_t nonce_size, const VerifierKnownLog *known, int *attestation_result);
+
+int verify_quote_signature(const uint8_t *quote, size_t quote_size, const uint8_t *nonce, size_t nonce_size,
+                           const NonceProof *proof, TPM_Quote *parsed_quote);
+int replay_measurement_log(const uint8_t *measurement_log, size_t log_size, PCR_BankSet *replayed_pcrs);
+int compare_pcr_values(PCR **pcrs, size_t num_pcrs, const PCR_BankSet *replayed_pcrs);
+int check_measurement_log_against_rim(const uint8_t *measurement_log, size_t log_size);
+int verify_measurement_log(const char *attestor_id, const uint8_t *measurement_log, size_t log_size,
+                           PCR **pcrs, size_t num_pcrs, const TPM_Quote *quote, uint64_t *base_events,
+                           uint64_t *base_size);
+int verify_measurement_log_delta(const char *attestor_id, const VerifierKnownLog *known, uint64_t base_events,
+                                 uint64_t base_size, const ProtobufCBinaryData *base_digest, const uint8_t *log,
+                                 size_t log_size, size_t header_size, PCR **pcrs, size_t num_pcrs,
+                                 const TPM_Quote *quote);
+
+/**
+ * @brief Records in a context the attestor its processed response came from, so the next request for it carries
+ * the position of its checkpoint.
+ */
+void verifier_note_attestor(VerifierContext *ctx);
+
+/**
+ * @brief Sets the RIM index the measurement logs are checked against.
+ */
+void verifier_set_rim_index(const RIM_Index *rim_index);
+
+/**
+ * @brief Sets the store of RIM versions the measurement logs are checked against, in place of a fixed index.
+ */
+void verifier_set_rim_store(RimStore *store);
+
+/**
+ * @brief Sets the attestation keys quotes are verified against.
+ */
+void verifier_set_ak_cache(const AK_Cache *ak_cache);
+
+/**
+ * @brief Sets the checkpoint store used for incremental replay; NULL replays every log in full.
+ */
+void verifier_set_checkpoint_store(CheckpointStore *store);
+
+/**
+ * @brief Sets the verdict cache consulted before a full replay, and the policy version its keys carry; NULL
+ * disables caching.
+ */
+void verifier_set_verdict_cache(VerdictCache *cache, uint32_t policy_version);
+
+/**
+ * @brief Sets the verdict log every processed response's structured verdict is queued to; NULL records none.
+ */
+void verifier_set_verdict_log(VerdictLog *log);
+
+/**
+ * @brief Sets the pipeline that replays and checks large full logs on several threads; NULL verifies every log on
+ * the thread that received it.
+ */
+void verifier_set_log_pipeline(LogPipeline *pipeline);
+
+/**
+ * @brief Sets the dictionary requests advertise, so attestors that share it send their logs compressed; NULL takes
+ * every log uncompressed.
+ */
+void verifier_set_log_dictionary(const LogDictionary *dictionary);
+
+/**
+ * @brief Sets the archive every attestation whose log was verified is appended to. NULL archives nothing.
+ */
+void verifier_set_event_archive(EventArchive *archive);
+
+/**
+ * @brief Reports passed attestations and checkpoint fallbacks on stderr when debug is true; off by default.
+ */
+void verifier_set_debug(bool debug);
+
+/**
+ * @brief Runs the verifier side of the attestation protocol using a state machine.
+ *
+ * @param[in,out] ctx  Pointer to the VerifierContext structure.
+ */
+void run_verifier_protocol(VerifierContext *ctx);
+
+#endif // VERIFIER_H
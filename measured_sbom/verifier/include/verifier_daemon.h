@@ -0,0 +1,117 @@
+// verifier_daemon.h
+#ifndef VERIFIER_DAEMON_H
+#define VERIFIER_DAEMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "transport.h"
+
+// Constants
+
+#define VERIFIER_FRAME_HEADER_SIZE TRANSPORT_FRAME_HEADER_SIZE  /**< Big-endian length prefix of every message */
+#define VERIFIER_MAX_FRAME_SIZE TRANSPORT_MAX_FRAME_SIZE        /**< Largest message accepted from a peer */
+
+// Structures
+
+/**
+ * @struct VerifierDaemonConfig
+ * @brief Settings of a verifier daemon.
+ */
+typedef struct {
+    size_t num_workers;             /**< Verification threads; 0 uses one per online CPU */
+    unsigned int interval_ms;       /**< Delay between the attestation rounds of a session */
+    unsigned int timeout_ms;        /**< Time an attestor has to answer a request; 0 waits indefinitely */
+    uint64_t rounds;                /**< Rounds per session; 0 re-attests until stopped */
+    unsigned int report_interval_s; /**< Seconds between throughput reports on stdout; 0 disables them */
+    double arrival_rate;            /**< Open loop: rounds started per second across all sessions; 0 for closed loop */
+    uint64_t arrival_seed;          /**< Seed of the open-loop arrival process */
+} VerifierDaemonConfig;
+
+/**
+ * @struct VerifierDaemonStats
+ * @brief Counters of a verifier daemon.
+ */
+typedef struct {
+    uint64_t attestations;          /**< Completed attestation rounds */
+    uint64_t passed;                /**< Rounds whose response verified */
+    uint64_t failed;                /**< Rounds whose response did not verify */
+    uint64_t io_errors;             /**< Rounds lost to connection or framing errors */
+    uint64_t dropped;               /**< Open-loop arrivals dropped because their session's backlog was full */
+    uint64_t latency_p50_us;        /**< Median time from a round's start, or its arrival in open loop, to its end */
+    uint64_t latency_p99_us;        /**< 99th percentile of the same */
+    uint64_t latency_p999_us;       /**< 99.9th percentile of the same */
+    uint64_t latency_max_us;        /**< Longest round */
+} VerifierDaemonStats;
+
+/**
+ * @struct VerifierDaemon
+ * @brief Long-running verifier that attests many attestors concurrently.
+ *
+ * Every attestor gets a session holding a VerifierContext, which the daemon advances through the states of
+ * run_verifier_protocol(). One event loop thread does all socket I/O with epoll, so sessions waiting on the network
+ * hold no thread. Once a response has been read the session is handed to a work-stealing pool that runs
+ * process_attestation_response(), and comes back to the event loop when the verdict is in. Messages are framed
+ * with a VERIFIER_FRAME_HEADER_SIZE big-endian length prefix by the transport layer (see transport.h), and every
+ * frame buffer comes from one pool shared by all sessions.
+ *
+ * By default every session runs its next round interval_ms after the last one ended (closed loop). With an
+ * arrival_rate the daemon is driven open loop instead, as a load generator: rounds arrive at exponentially
+ * distributed intervals, each at a random session, whether or not earlier rounds have finished. A session that is
+ * busy queues a few arrivals and drops the rest, and round latency counts from the arrival, so a verifier that
+ * falls behind shows it in its tail latency rather than by slowing the load down. rounds is ignored in open loop.
+ */
+typedef struct VerifierDaemon VerifierDaemon;
+
+// Function Prototypes
+
+/**
+ * @brief Creates a daemon and its worker pool.
+ *
+ * The RIM index and checkpoint store must be set (verifier_set_rim_index, verifier_set_checkpoint_store) before
+ * the daemon runs.
+ *
+ * @return Pointer to the daemon, or NULL on failure.
+ */
+VerifierDaemon *verifier_daemon_create(const VerifierDaemonConfig *config);
+
+/**
+ * @brief Adds an attestor reached at an address, "unix:<path>" or "<host>:<port>".
+ *
+ * The connection is opened on the first round and reopened after errors.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_daemon_add_attestor(VerifierDaemon *daemon, const char *address);
+
+/**
+ * @brief Adds an attestor on an already connected stream socket. The daemon takes ownership of fd.
+ *
+ * The session ends if the connection fails, since it cannot be reopened.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_daemon_add_attestor_fd(VerifierDaemon *daemon, int fd);
+
+/**
+ * @brief Runs the event loop until every session has completed its rounds or verifier_daemon_stop() is called.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_daemon_run(VerifierDaemon *daemon);
+
+/**
+ * @brief Asks a running daemon to finish its in-flight rounds and return. Async-signal-safe.
+ */
+void verifier_daemon_stop(VerifierDaemon *daemon);
+
+/**
+ * @brief Reads the daemon's counters. May be called while the daemon runs.
+ */
+void verifier_daemon_get_stats(const VerifierDaemon *daemon, VerifierDaemonStats *stats);
+
+/**
+ * @brief Closes every session and releases the daemon.
+ */
+void verifier_daemon_destroy(VerifierDaemon *daemon);
+
+#endif // VERIFIER_DAEMON_H
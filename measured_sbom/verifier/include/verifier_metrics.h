@@ -0,0 +1,127 @@
+// verifier_metrics.h
+#ifndef VERIFIER_METRICS_H
+#define VERIFIER_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Constants
+
+#define METRICS_SUB_BUCKET_BITS 4       /**< Latency buckets per power of two: 2^4, so values are within 6.25% */
+#define METRICS_MAGNITUDES 40           /**< Powers of two covered above the linear range: up to ~18 minutes */
+#define METRICS_BUCKETS ((METRICS_MAGNITUDES + 1) << METRICS_SUB_BUCKET_BITS)  /**< Buckets per histogram */
+#define METRICS_DEFAULT_FILE_INTERVAL_S 10  /**< Seconds between rewrites of the metrics file */
+
+// Enumerations
+
+/**
+ * @enum VerifierStage
+ * @brief Timed stages of the verification of one attestation response.
+ */
+typedef enum {
+    VERIFIER_STAGE_DECODE,          /**< Protobuf decoding of the response */
+    VERIFIER_STAGE_PARSE,           /**< Unmarshaling the quote and nonce proof, extracting the measurement log */
+    VERIFIER_STAGE_NONCE,           /**< Quote type, nonce (or nonce proof) and signing key lookup */
+    VERIFIER_STAGE_SIGNATURE,       /**< Quote signature verification */
+    VERIFIER_STAGE_REPLAY,          /**< Log replay (or verdict cache lookup) and PCR comparison */
+    VERIFIER_STAGE_RIM,             /**< Matching the log's events against the RIM */
+    VERIFIER_STAGE_ARCHIVE,         /**< Appending the verified log to the event archive */
+    VERIFIER_STAGE_ATTESTATION,     /**< The whole response, from decoding to verdict */
+    VERIFIER_STAGE_COUNT
+} VerifierStage;
+
+/**
+ * @enum VerifierCounter
+ * @brief Event counters of the verification pipeline.
+ */
+typedef enum {
+    VERIFIER_COUNTER_PASSED,            /**< Attestations that verified */
+    VERIFIER_COUNTER_FAILED,            /**< Attestations that did not */
+    VERIFIER_COUNTER_FULL_REPLAYS,      /**< Logs verified from the first record */
+    VERIFIER_COUNTER_INCREMENTAL,       /**< Logs verified from a checkpoint */
+    VERIFIER_COUNTER_DELTAS,            /**< Delta responses received */
+    VERIFIER_COUNTER_VERDICT_HITS,      /**< Full logs whose verdict came from the verdict cache */
+    VERIFIER_COUNTER_RIM_RECHECKS,      /**< Logs replayed from a checkpoint but checked whole, as the RIM changed */
+    VERIFIER_COUNTER_COUNT
+} VerifierCounter;
+
+// Structures
+
+/**
+ * @struct MetricsExporter
+ * @brief Serves the verifier's metrics in the Prometheus text format and/or writes them to a file periodically.
+ *
+ * Every thread that records metrics owns a shard of counters and log-linear (HDR-style) latency histograms that
+ * only it writes, with relaxed atomic stores and no locks or shared cache lines. A scrape sums the shards. Shards
+ * of exited threads are handed to new threads, so their counts are kept and memory stays bounded by the number of
+ * threads alive at once.
+ */
+typedef struct MetricsExporter MetricsExporter;
+
+// Function Prototypes
+
+/**
+ * @brief Turns metrics recording on. Until then the recording functions return at once, without reading the clock.
+ */
+void verifier_metrics_enable(void);
+
+/**
+ * @brief Returns whether metrics are recorded.
+ */
+bool verifier_metrics_enabled(void);
+
+/**
+ * @brief Starts timing a stage.
+ *
+ * @return Monotonic time in nanoseconds, or 0 if metrics are off.
+ */
+uint64_t verifier_metrics_start(void);
+
+/**
+ * @brief Records the latency of a stage started with verifier_metrics_start(), and an error if it failed.
+ *
+ * @param[in] stage  Stage that ended.
+ * @param[in] start  Value returned by verifier_metrics_start(); 0 records nothing.
+ * @param[in] ok     Whether the stage succeeded.
+ */
+void verifier_metrics_stage_end(VerifierStage stage, uint64_t start, bool ok);
+
+/**
+ * @brief Adds to a counter.
+ */
+void verifier_metrics_count(VerifierCounter counter, uint64_t n);
+
+/**
+ * @brief Writes every metric in the Prometheus text exposition format (version 0.0.4).
+ *
+ * Stage latencies are summaries in seconds with quantiles 0.5, 0.9, 0.99 and 0.999; counters are totals.
+ *
+ * @return Returns 0 on success, or -1 on a write error.
+ */
+int verifier_metrics_write(FILE *out);
+
+/**
+ * @brief Writes the metrics to a file, replacing it atomically, for a node exporter's textfile collector.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_metrics_write_file(const char *path);
+
+/**
+ * @brief Enables metrics and starts exporting them.
+ *
+ * @param[in] address          "unix:<path>" or "<host>:<port>" to answer HTTP scrapes on, or NULL.
+ * @param[in] file             File to rewrite every file_interval_s seconds and when the exporter stops, or NULL.
+ * @param[in] file_interval_s  Seconds between rewrites of the file; 0 for METRICS_DEFAULT_FILE_INTERVAL_S.
+ *
+ * @return Pointer to the exporter, or NULL on failure.
+ */
+MetricsExporter *metrics_exporter_start(const char *address, const char *file, unsigned int file_interval_s);
+
+/**
+ * @brief Stops an exporter, writing the file a last time. Metrics keep being recorded.
+ */
+void metrics_exporter_stop(MetricsExporter *exporter);
+
+#endif // VERIFIER_METRICS_H
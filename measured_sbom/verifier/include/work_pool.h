@@ -0,0 +1,52 @@
+// work_pool.h
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+
+// Structures
+
+/**
+ * @brief Task run by a pool worker.
+ */
+typedef void (*WorkPoolTask)(void *arg);
+
+/**
+ * @struct WorkPool
+ * @brief Fixed-size thread pool with one task deque per worker and work stealing between them.
+ *
+ * A worker runs its own tasks newest first, which keeps the data a task just produced in cache, and steals the
+ * oldest task of another worker when its deque runs dry. Tasks submitted from outside the pool are spread round
+ * robin across the workers. Idle workers sleep until new work arrives.
+ */
+typedef struct WorkPool WorkPool;
+
+// Function Prototypes
+
+/**
+ * @brief Creates a pool and starts its workers.
+ *
+ * @param[in] num_workers  Number of worker threads; 0 uses one per online CPU.
+ *
+ * @return Pointer to the pool, or NULL on failure.
+ */
+WorkPool *work_pool_create(size_t num_workers);
+
+/**
+ * @brief Queues a task. Tasks may submit further tasks.
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int work_pool_submit(WorkPool *pool, WorkPoolTask task, void *arg);
+
+/**
+ * @brief Returns the number of worker threads of a pool.
+ */
+size_t work_pool_worker_count(const WorkPool *pool);
+
+/**
+ * @brief Runs every queued task, stops the workers and releases the pool.
+ */
+void work_pool_destroy(WorkPool *pool);
+
+#endif // WORK_POOL_H
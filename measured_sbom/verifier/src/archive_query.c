@@ -0,0 +1,229 @@
+// archive_query.c
+// Audit queries on an event archive written by verifierd -A: list the archived attestations, rebuild the log of one,
+// or find the devices whose logs held a given event digest.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "event_archive.h"
+
+#define QUERY_DEVICE_BUCKETS 1024
+
+/**
+ * @struct QueryDevice
+ * @brief A device found by a digest query, with the span of its matching attestations.
+ */
+typedef struct QueryDevice {
+    struct QueryDevice *next;
+    char attestor_id[EVENT_ARCHIVE_ID_MAX];
+    uint64_t records;                       /**< Matching attestations */
+    uint64_t first_ns;                      /**< Time of the first */
+    uint64_t last_ns;                       /**< Time of the last */
+    uint64_t last_record;                   /**< ID of the last */
+} QueryDevice;
+
+typedef struct {
+    QueryDevice *buckets[QUERY_DEVICE_BUCKETS];
+    size_t count;
+} QueryDevices;
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s -A <archive> <command>\n"
+            "  list                 List every archived attestation\n"
+            "  stats                Show the size of the archive\n"
+            "  log <record> [file]  Rebuild the log of an attestation into <file> (default: stdout)\n"
+            "  find <alg>:<hex>     List the devices whose logs held an event with this digest, e.g.\n"
+            "                       sha256:9f86d0...; alg is sha1, sha256, sha384, sha512 or sm3_256\n",
+            program);
+}
+
+static int write_file(const char *filename, const uint8_t *data, size_t size) {
+    FILE *file = filename ? fopen(filename, "wb") : stdout;
+    int rc = file && fwrite(data, 1, size, file) == size ? 0 : -1;
+    if (file && file != stdout && fclose(file) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error writing %s\n", filename ? filename : "stdout");
+    }
+    return rc;
+}
+
+static void format_time(uint64_t timestamp_ns, char *text, size_t size) {
+    time_t seconds = (time_t)(timestamp_ns / 1000000000ull);
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    strftime(text, size, "%Y-%m-%dT%H:%M:%SZ", &tm);
+}
+
+static int print_record(const ArchiveRecord *record, void *context) {
+    char time_text[32];
+    (void)context;
+    format_time(record->timestamp_ns, time_text, sizeof(time_text));
+    printf("%12llu  %s  %-4s  %8llu events  %10llu bytes  %4u chunks  ", (unsigned long long)record->id, time_text,
+           record->result == 0 ? "pass" : "FAIL", (unsigned long long)record->event_count,
+           (unsigned long long)record->log_size, record->chunk_count);
+    if (record->parent != EVENT_ARCHIVE_NONE) {
+        printf("after %-12llu  ", (unsigned long long)record->parent);
+    }
+    printf("%s\n", record->attestor_id);
+    return 0;
+}
+
+static uint32_t hash_id(const char *attestor_id) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = attestor_id; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash % QUERY_DEVICE_BUCKETS;
+}
+
+static int collect_device(const ArchiveRecord *record, void *context) {
+    QueryDevices *devices = context;
+    uint32_t bucket = hash_id(record->attestor_id);
+    QueryDevice *device = devices->buckets[bucket];
+    while (device && strcmp(device->attestor_id, record->attestor_id) != 0) {
+        device = device->next;
+    }
+    if (!device) {
+        device = calloc(1, sizeof(*device));
+        if (!device) {
+            fprintf(stderr, "Error allocating memory for query results\n");
+            return -1;
+        }
+        snprintf(device->attestor_id, sizeof(device->attestor_id), "%s", record->attestor_id);
+        device->first_ns = record->timestamp_ns;
+        device->next = devices->buckets[bucket];
+        devices->buckets[bucket] = device;
+        devices->count++;
+    }
+    device->records++;
+    device->last_ns = record->timestamp_ns;
+    device->last_record = record->id;
+    return 0;
+}
+
+/**
+ * @brief Parses "<alg>:<hex>" into an algorithm and digest bytes.
+ */
+static int parse_digest(const char *text, TPM2_ALG_ID *alg, uint8_t *digest, size_t *digest_size) {
+    static const struct {
+        const char *name;
+        TPM2_ALG_ID alg;
+        size_t size;
+    } algs[] = {
+        { "sha1", TPM2_ALG_SHA1, TPM2_SHA1_DIGEST_SIZE },
+        { "sha256", TPM2_ALG_SHA256, TPM2_SHA256_DIGEST_SIZE },
+        { "sha384", TPM2_ALG_SHA384, TPM2_SHA384_DIGEST_SIZE },
+        { "sha512", TPM2_ALG_SHA512, TPM2_SHA512_DIGEST_SIZE },
+        { "sm3_256", TPM2_ALG_SM3_256, TPM2_SM3_256_DIGEST_SIZE },
+    };
+    const char *hex = strchr(text, ':');
+    if (!hex) {
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(algs) / sizeof(algs[0]); i++) {
+        if (strlen(algs[i].name) != (size_t)(hex - text) || strncmp(algs[i].name, text, (size_t)(hex - text)) != 0) {
+            continue;
+        }
+        hex++;
+        if (strlen(hex) != 2 * algs[i].size) {
+            return -1;
+        }
+        for (size_t j = 0; j < algs[i].size; j++) {
+            unsigned int byte;
+            if (sscanf(hex + 2 * j, "%2x", &byte) != 1) {
+                return -1;
+            }
+            digest[j] = (uint8_t)byte;
+        }
+        *alg = algs[i].alg;
+        *digest_size = algs[i].size;
+        return 0;
+    }
+    return -1;
+}
+
+static int find_digest(EventArchive *archive, const char *spec) {
+    TPM2_ALG_ID alg;
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t digest_size;
+    if (parse_digest(spec, &alg, digest, &digest_size) != 0) {
+        fprintf(stderr, "Malformed digest: %s\n", spec);
+        return -1;
+    }
+
+    QueryDevices devices = { 0 };
+    int64_t records = event_archive_find_digest(archive, alg, digest, digest_size, collect_device, &devices);
+    int rc = records < 0 ? -1 : 0;
+    if (rc == 0) {
+        printf("%lld attestations of %zu devices held %s\n", (long long)records, devices.count, spec);
+    }
+    for (size_t i = 0; i < QUERY_DEVICE_BUCKETS; i++) {
+        QueryDevice *device = devices.buckets[i];
+        while (device) {
+            QueryDevice *next = device->next;
+            char first[32], last[32];
+            format_time(device->first_ns, first, sizeof(first));
+            format_time(device->last_ns, last, sizeof(last));
+            printf("%-40s %8llu attestations  %s .. %s  last record %llu\n", device->attestor_id,
+                   (unsigned long long)device->records, first, last, (unsigned long long)device->last_record);
+            free(device);
+            device = next;
+        }
+    }
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *directory = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "A:h")) != -1) {
+        switch (opt) {
+            case 'A': directory = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!directory || optind == argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *command = argv[optind];
+    int arguments = argc - optind - 1;
+
+    EventArchive *archive = event_archive_open(directory);
+    if (!archive) {
+        return EXIT_FAILURE;
+    }
+    int rc = -1;
+    if (strcmp(command, "list") == 0 && arguments == 0) {
+        rc = event_archive_scan(archive, print_record, NULL);
+    } else if (strcmp(command, "stats") == 0 && arguments == 0) {
+        ArchiveStats stats;
+        event_archive_get_stats(archive, &stats);
+        printf("Records: %llu\nChunks: %llu\nIndexed digests: %llu\nArchive size: %llu bytes\n",
+               (unsigned long long)stats.records, (unsigned long long)stats.chunks,
+               (unsigned long long)stats.digests, (unsigned long long)stats.stored_bytes);
+        rc = 0;
+    } else if (strcmp(command, "log") == 0 && (arguments == 1 || arguments == 2)) {
+        uint8_t *log;
+        size_t log_size;
+        rc = event_archive_read_log(archive, strtoull(argv[optind + 1], NULL, 0), &log, &log_size);
+        if (rc == 0) {
+            rc = write_file(arguments == 2 ? argv[optind + 2] : NULL, log, log_size);
+            free(log);
+        }
+    } else if (strcmp(command, "find") == 0 && arguments == 1) {
+        rc = find_digest(archive, argv[optind + 1]);
+    } else {
+        usage(argv[0]);
+    }
+    event_archive_close(archive);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
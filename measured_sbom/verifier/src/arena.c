@@ -0,0 +1,93 @@
+// arena.c
+// Bump allocator for per-request decoding: everything a response needs is carved from one chunk and released in a
+// single reset, so verification threads do not contend on the heap.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+static size_t align_size(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaChunk *chunk_new(size_t size) {
+    // The header is padded so data starts aligned.
+    ArenaChunk *chunk = aligned_alloc(ARENA_ALIGNMENT, align_size(sizeof(ArenaChunk) + size));
+    if (!chunk) {
+        fprintf(stderr, "Error allocating arena chunk\n");
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+void arena_init(Arena *arena, size_t chunk_size) {
+    arena->head = NULL;
+    arena->chunk_size = chunk_size > 0 ? align_size(chunk_size) : ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (!arena || size > SIZE_MAX / 2) {
+        return NULL;
+    }
+    size = align_size(size > 0 ? size : 1);
+
+    ArenaChunk *chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < size) {
+        chunk = chunk_new(size > arena->chunk_size ? size : arena->chunk_size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->head;
+        arena->head = chunk;
+    }
+
+    void *memory = chunk->data + chunk->used;
+    chunk->used += size;
+    return memory;
+}
+
+char *arena_strndup(Arena *arena, const char *data, size_t size) {
+    char *copy = arena_alloc(arena, size + 1);
+    if (copy) {
+        memcpy(copy, data, size);
+        copy[size] = '\0';
+    }
+    return copy;
+}
+
+void arena_reset(Arena *arena) {
+    if (!arena || !arena->head) {
+        return;
+    }
+    if (!arena->head->next && arena->head->size <= ARENA_MAX_RETAINED) {
+        arena->head->used = 0;
+        return;
+    }
+
+    // The last cycle overflowed into several chunks: replace them with one that holds it all.
+    size_t total = 0;
+    for (ArenaChunk *chunk = arena->head; chunk; chunk = chunk->next) {
+        total += chunk->size;
+    }
+    arena_free(arena);
+    if (total <= ARENA_MAX_RETAINED) {
+        arena->head = chunk_new(total);
+    }
+}
+
+void arena_free(Arena *arena) {
+    if (!arena) {
+        return;
+    }
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+}
@@ -0,0 +1,721 @@
+// attestation_decode.c
+// Zero-copy decoder for AttestationResponse. protobuf-c's unpack mallocs every message and copies every bytes
+// field; this decoder fills the same generated structures from an arena and leaves the payload in the receive buffer.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "attestation_decode.h"
+
+#define WIRE_VARINT 0
+#define WIRE_FIXED64 1
+#define WIRE_LENGTH_DELIMITED 2
+#define WIRE_FIXED32 5
+#define WIRE_MAX_FIELD_NUMBER ((1u << 29) - 1)
+
+/**
+ * @struct WireReader
+ * @brief Position in a serialized message.
+ */
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} WireReader;
+
+/**
+ * @struct WireField
+ * @brief One decoded field: its number and wire type, and its varint value or length-delimited payload.
+ */
+typedef struct {
+    uint32_t number;
+    uint32_t wire_type;
+    uint64_t value;
+    const uint8_t *data;
+    size_t length;
+} WireField;
+
+static void reader_init(WireReader *reader, const uint8_t *data, size_t size) {
+    reader->pos = data;
+    reader->end = data + size;
+}
+
+static int read_varint(WireReader *reader, uint64_t *value) {
+    uint64_t result = 0;
+    for (unsigned int shift = 0; shift < 64 && reader->pos < reader->end; shift += 7) {
+        uint8_t byte = *reader->pos++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Reads the next field, skipping over fixed-width payloads.
+ *
+ * @return Returns 1 if a field was read, 0 at the end of the message, or -1 on malformed input.
+ */
+static int next_field(WireReader *reader, WireField *field) {
+    if (reader->pos == reader->end) {
+        return 0;
+    }
+
+    uint64_t key;
+    if (read_varint(reader, &key) != 0 || (key >> 3) == 0 || (key >> 3) > WIRE_MAX_FIELD_NUMBER) {
+        return -1;
+    }
+    field->number = (uint32_t)(key >> 3);
+    field->wire_type = (uint32_t)(key & 7);
+
+    uint64_t length;
+    size_t remaining = (size_t)(reader->end - reader->pos);
+    switch (field->wire_type) {
+        case WIRE_VARINT:
+            return read_varint(reader, &field->value) == 0 ? 1 : -1;
+        case WIRE_FIXED64:
+            if (remaining < 8) {
+                return -1;
+            }
+            reader->pos += 8;
+            return 1;
+        case WIRE_FIXED32:
+            if (remaining < 4) {
+                return -1;
+            }
+            reader->pos += 4;
+            return 1;
+        case WIRE_LENGTH_DELIMITED:
+            if (read_varint(reader, &length) != 0 || length > (uint64_t)(reader->end - reader->pos)) {
+                return -1;
+            }
+            field->data = reader->pos;
+            field->length = (size_t)length;
+            reader->pos += length;
+            return 1;
+        default:
+            return -1;  // Groups are not used by attestation.proto
+    }
+}
+
+static ProtobufCBinaryData bytes_view(const WireField *field) {
+    ProtobufCBinaryData bytes = { field->length, (uint8_t *)field->data };
+    return bytes;
+}
+
+// Submessages
+
+static int decode_pcr(const uint8_t *data, size_t size, PCR *pcr) {
+    PCR init = PCR__INIT;
+    *pcr = init;
+
+    WireReader reader;
+    WireField field;
+    int status;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        if (field.number == PCR_INDEX) {
+            if (field.wire_type != WIRE_VARINT) {
+                return -1;
+            }
+            pcr->index = (int32_t)(uint32_t)field.value;
+        } else if (field.number == PCR_VALUE) {
+            if (field.wire_type != WIRE_LENGTH_DELIMITED) {
+                return -1;
+            }
+            pcr->value = bytes_view(&field);
+        }
+    }
+    return status;
+}
+
+static int decode_event(Arena *arena, const uint8_t *data, size_t size, TCGEvent *event) {
+    TCGEvent init = TCG_EVENT__INIT;
+    *event = init;
+
+    WireReader reader;
+    WireField field;
+    int status;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        bool varint = field.wire_type == WIRE_VARINT;
+        bool delimited = field.wire_type == WIRE_LENGTH_DELIMITED;
+        switch (field.number) {
+            case TCG_EVENT_RECNUM:
+                if (!varint) {
+                    return -1;
+                }
+                event->recnum = (uint32_t)field.value;
+                break;
+            case TCG_EVENT_PCR_INDEX:
+                if (!varint) {
+                    return -1;
+                }
+                event->pcr_index = (uint32_t)field.value;
+                break;
+            case TCG_EVENT_DIGEST:
+                if (!delimited) {
+                    return -1;
+                }
+                event->digest = bytes_view(&field);
+                break;
+            case TCG_EVENT_EVENT_CONTENT:
+                // Strings need a terminator, so they are the one thing copied.
+                if (!delimited || !(event->event_content = arena_strndup(arena, (const char *)field.data,
+                                                                        field.length))) {
+                    return -1;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Counts (and validates the framing of) the events of a TCGEventLog.
+ */
+static int count_events(const uint8_t *data, size_t size, size_t *count) {
+    WireReader reader;
+    WireField field;
+    int status;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        if (field.number == TCG_EVENT_LOG_EVENTS) {
+            if (field.wire_type != WIRE_LENGTH_DELIMITED) {
+                return -1;
+            }
+            (*count)++;
+        }
+    }
+    return status;
+}
+
+static int decode_events(Arena *arena, const uint8_t *data, size_t size, TCGEventLog *event_log,
+                         TCGEvent *events) {
+    WireReader reader;
+    WireField field;
+    int status;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        if (field.number == TCG_EVENT_LOG_EVENTS) {
+            TCGEvent *event = &events[event_log->n_events];
+            if (decode_event(arena, field.data, field.length, event) != 0) {
+                return -1;
+            }
+            event_log->events[event_log->n_events++] = event;
+        }
+    }
+    return status;
+}
+
+static int decode_log_chunk(const uint8_t *data, size_t size, LogChunk *chunk) {
+    LogChunk init = LOG_CHUNK__INIT;
+    *chunk = init;
+
+    WireReader reader;
+    WireField field;
+    int status;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        if (field.number == LOG_CHUNK_OFFSET) {
+            if (field.wire_type != WIRE_VARINT) {
+                return -1;
+            }
+            chunk->offset = field.value;
+        } else if (field.number == LOG_CHUNK_DATA) {
+            if (field.wire_type != WIRE_LENGTH_DELIMITED) {
+                return -1;
+            }
+            chunk->data = bytes_view(&field);
+        }
+    }
+    return status;
+}
+
+static int decode_nonce_proof(Arena *arena, const uint8_t *data, size_t size, NonceInclusionProof *proof) {
+    NonceInclusionProof init = NONCE_INCLUSION_PROOF__INIT;
+    *proof = init;
+
+    WireReader reader;
+    WireField field;
+    int status;
+    size_t n_siblings = 0;
+    reader_init(&reader, data, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        if (field.number == NONCE_INCLUSION_PROOF_SIBLINGS) {
+            if (field.wire_type != WIRE_LENGTH_DELIMITED) {
+                return -1;
+            }
+            n_siblings++;
+        }
+    }
+    if (status != 0) {
+        return -1;
+    }
+    proof->siblings = arena_alloc(arena, n_siblings * sizeof(*proof->siblings));
+    if (!proof->siblings) {
+        return -1;
+    }
+
+    reader_init(&reader, data, size);
+    while (next_field(&reader, &field) == 1) {
+        bool varint = field.wire_type == WIRE_VARINT;
+        switch (field.number) {
+            case NONCE_INCLUSION_PROOF_LEAF_INDEX:
+                if (!varint) {
+                    return -1;
+                }
+                proof->leaf_index = (uint32_t)field.value;
+                break;
+            case NONCE_INCLUSION_PROOF_LEAF_COUNT:
+                if (!varint) {
+                    return -1;
+                }
+                proof->leaf_count = (uint32_t)field.value;
+                break;
+            case NONCE_INCLUSION_PROOF_SIBLINGS:
+                proof->siblings[proof->n_siblings++] = bytes_view(&field);
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Counts the varints of a packed repeated field.
+ */
+static int count_packed_varints(const uint8_t *data, size_t size, size_t *count) {
+    if (size > 0 && (data[size - 1] & 0x80)) {
+        return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        *count += !(data[i] & 0x80);
+    }
+    return 0;
+}
+
+static int decode_packed_uint32(const uint8_t *data, size_t size, uint32_t *values, size_t *count) {
+    WireReader reader;
+    uint64_t value;
+    reader_init(&reader, data, size);
+    while (reader.pos < reader.end) {
+        if (read_varint(&reader, &value) != 0) {
+            return -1;
+        }
+        values[(*count)++] = (uint32_t)value;
+    }
+    return 0;
+}
+
+// Response
+
+AttestationResponse *attestation_response_decode(Arena *arena, const uint8_t *buffer, size_t size) {
+    if (!arena || (!buffer && size > 0)) {
+        return NULL;
+    }
+
+    // First pass: validate the framing and size the arrays, so each is one arena allocation.
+    WireReader reader;
+    WireField field;
+    size_t n_pcrs = 0;
+    size_t n_events = 0;
+    size_t n_log_chunks = 0;
+    size_t n_event_offsets = 0;
+    bool has_event_log = false;
+    int status;
+    reader_init(&reader, buffer, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        bool delimited = field.wire_type == WIRE_LENGTH_DELIMITED;
+        switch (field.number) {
+            case ATTESTATION_RESPONSE_PCRS:
+                n_pcrs++;
+                break;
+            case ATTESTATION_RESPONSE_EVENT_LOG:
+                has_event_log = true;
+                if (delimited && count_events(field.data, field.length, &n_events) != 0) {
+                    return NULL;
+                }
+                break;
+            case ATTESTATION_RESPONSE_LOG_CHUNKS:
+                n_log_chunks++;
+                break;
+            case ATTESTATION_RESPONSE_EVENT_OFFSETS:
+                // Repeated scalars may arrive packed or one per field.
+                if (field.wire_type == WIRE_VARINT) {
+                    n_event_offsets++;
+                    continue;
+                }
+                if (delimited && count_packed_varints(field.data, field.length, &n_event_offsets) != 0) {
+                    return NULL;
+                }
+                break;
+            case ATTESTATION_RESPONSE_PROTOCOL_VERSION:
+            case ATTESTATION_RESPONSE_LOG_BASE_EVENTS:
+            case ATTESTATION_RESPONSE_LOG_BASE_SIZE:
+            case ATTESTATION_RESPONSE_LOG_DICTIONARY_ID:
+                if (field.wire_type != WIRE_VARINT) {
+                    return NULL;
+                }
+                continue;
+            case ATTESTATION_RESPONSE_ATTESTOR_ID:
+            case ATTESTATION_RESPONSE_NONCE:
+            case ATTESTATION_RESPONSE_QUOTE:
+            case ATTESTATION_RESPONSE_MEASUREMENT_LOG:
+            case ATTESTATION_RESPONSE_NONCE_PROOF:
+            case ATTESTATION_RESPONSE_LOG_BASE_DIGEST:
+            case ATTESTATION_RESPONSE_LOG_HEADER:
+            case ATTESTATION_RESPONSE_COMPRESSED_LOG:
+                break;
+            default:
+                continue;
+        }
+        if (!delimited) {
+            return NULL;
+        }
+    }
+    if (status != 0) {
+        return NULL;
+    }
+
+    AttestationResponse init = ATTESTATION_RESPONSE__INIT;
+    AttestationResponse *response = arena_alloc(arena, sizeof(*response));
+    PCR **pcr_list = arena_alloc(arena, n_pcrs * sizeof(*pcr_list));
+    PCR *pcrs = arena_alloc(arena, n_pcrs * sizeof(*pcrs));
+    TCGEventLog *event_log = has_event_log ? arena_alloc(arena, sizeof(*event_log)) : NULL;
+    TCGEvent **event_list = arena_alloc(arena, n_events * sizeof(*event_list));
+    TCGEvent *events = arena_alloc(arena, n_events * sizeof(*events));
+    LogChunk **chunk_list = arena_alloc(arena, n_log_chunks * sizeof(*chunk_list));
+    LogChunk *chunks = arena_alloc(arena, n_log_chunks * sizeof(*chunks));
+    uint32_t *event_offsets = arena_alloc(arena, n_event_offsets * sizeof(*event_offsets));
+    if (!response || !pcr_list || !pcrs || (has_event_log && !event_log) || !event_list || !events ||
+        !chunk_list || !chunks || !event_offsets) {
+        return NULL;
+    }
+    *response = init;
+    response->pcrs = pcr_list;
+    response->log_chunks = chunk_list;
+    response->event_offsets = event_offsets;
+    if (event_log) {
+        TCGEventLog log_init = TCG_EVENT_LOG__INIT;
+        *event_log = log_init;
+        event_log->events = event_list;
+        response->event_log = event_log;
+    }
+
+    // Second pass: fill in. Repeated event_log occurrences merge, as protobuf merges embedded messages.
+    reader_init(&reader, buffer, size);
+    while (next_field(&reader, &field) == 1) {
+        switch (field.number) {
+            case ATTESTATION_RESPONSE_ATTESTOR_ID:
+                response->attestor_id = arena_strndup(arena, (const char *)field.data, field.length);
+                if (!response->attestor_id) {
+                    return NULL;
+                }
+                break;
+            case ATTESTATION_RESPONSE_PCRS:
+                if (decode_pcr(field.data, field.length, &pcrs[response->n_pcrs]) != 0) {
+                    return NULL;
+                }
+                pcr_list[response->n_pcrs] = &pcrs[response->n_pcrs];
+                response->n_pcrs++;
+                break;
+            case ATTESTATION_RESPONSE_EVENT_LOG:
+                if (decode_events(arena, field.data, field.length, event_log, events) != 0) {
+                    return NULL;
+                }
+                break;
+            case ATTESTATION_RESPONSE_NONCE:
+                response->nonce = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_QUOTE:
+                response->quote = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_MEASUREMENT_LOG:
+                response->measurement_log = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_PROTOCOL_VERSION:
+                response->protocol_version = (uint32_t)field.value;
+                break;
+            case ATTESTATION_RESPONSE_LOG_BASE_EVENTS:
+                response->log_base_events = field.value;
+                break;
+            case ATTESTATION_RESPONSE_LOG_BASE_SIZE:
+                response->log_base_size = field.value;
+                break;
+            case ATTESTATION_RESPONSE_LOG_BASE_DIGEST:
+                response->log_base_digest = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_LOG_HEADER:
+                response->log_header = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_LOG_DICTIONARY_ID:
+                response->log_dictionary_id = (uint32_t)field.value;
+                break;
+            case ATTESTATION_RESPONSE_COMPRESSED_LOG:
+                response->compressed_log = bytes_view(&field);
+                break;
+            case ATTESTATION_RESPONSE_LOG_CHUNKS:
+                if (decode_log_chunk(field.data, field.length, &chunks[response->n_log_chunks]) != 0) {
+                    return NULL;
+                }
+                chunk_list[response->n_log_chunks] = &chunks[response->n_log_chunks];
+                response->n_log_chunks++;
+                break;
+            case ATTESTATION_RESPONSE_EVENT_OFFSETS:
+                if (field.wire_type == WIRE_VARINT) {
+                    event_offsets[response->n_event_offsets++] = (uint32_t)field.value;
+                } else if (decode_packed_uint32(field.data, field.length, event_offsets,
+                                                &response->n_event_offsets) != 0) {
+                    return NULL;
+                }
+                break;
+            case ATTESTATION_RESPONSE_NONCE_PROOF:
+                if (!response->nonce_proof) {
+                    response->nonce_proof = arena_alloc(arena, sizeof(*response->nonce_proof));
+                }
+                if (!response->nonce_proof ||
+                    decode_nonce_proof(arena, field.data, field.length, response->nonce_proof) != 0) {
+                    return NULL;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return response;
+}
+
+/**
+ * @brief Finds the last occurrence of a top-level bytes or string field.
+ */
+static int peek_bytes_field(const uint8_t *buffer, size_t size, uint32_t number, const uint8_t **data,
+                            size_t *length) {
+    if (!buffer || !data || !length) {
+        return -1;
+    }
+
+    WireReader reader;
+    WireField field;
+    int status;
+    int found = -1;
+    reader_init(&reader, buffer, size);
+    while ((status = next_field(&reader, &field)) == 1) {
+        // The last occurrence wins, as when decoding.
+        if (field.number == number && field.wire_type == WIRE_LENGTH_DELIMITED) {
+            *data = field.data;
+            *length = field.length;
+            found = 0;
+        }
+    }
+    return status == 0 ? found : -1;
+}
+
+int attestation_response_peek_nonce(const uint8_t *buffer, size_t size, const uint8_t **nonce, size_t *nonce_size) {
+    return peek_bytes_field(buffer, size, ATTESTATION_RESPONSE_NONCE, nonce, nonce_size);
+}
+
+int attestation_response_peek_attestor_id(const uint8_t *buffer, size_t size, char *attestor_id,
+                                          size_t id_capacity) {
+    const uint8_t *id;
+    size_t id_size;
+    if (!attestor_id || id_capacity == 0 ||
+        peek_bytes_field(buffer, size, ATTESTATION_RESPONSE_ATTESTOR_ID, &id, &id_size) != 0 ||
+        id_size >= id_capacity || memchr(id, '\0', id_size)) {
+        return -1;
+    }
+    memcpy(attestor_id, id, id_size);
+    attestor_id[id_size] = '\0';
+    return 0;
+}
+
+// Raw log
+
+#define SPEC_ID_EVENT_DATA_SIZE 33      // Spec ID Event03 with one algorithm and no vendor info
+#define LEGACY_HEADER_SIZE (32 + SPEC_ID_EVENT_DATA_SIZE)
+#define REBUILT_EVENT_FIXED_SIZE (4 + 4 + 4 + 2 + TPM2_SHA256_DIGEST_SIZE + 4)
+
+static uint8_t *put_le16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    return p + 2;
+}
+
+static uint8_t *put_le32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+    return p + 4;
+}
+
+/**
+ * @brief Rebuilds a version 1 event list as a crypto-agile log: a Spec ID header announcing one SHA-256 bank, then
+ *        one TCG_PCR_EVENT2 per event with the event content as its data.
+ */
+static int rebuild_legacy_log(Arena *arena, const TCGEventLog *event_log, const uint8_t **log, size_t *log_size) {
+    size_t size = LEGACY_HEADER_SIZE;
+    for (size_t i = 0; i < event_log->n_events; i++) {
+        const TCGEvent *event = event_log->events[i];
+        if (event->digest.len != TPM2_SHA256_DIGEST_SIZE) {
+            fprintf(stderr, "Event %zu: version 1 events must carry a SHA-256 digest\n", i);
+            return -1;
+        }
+        size += REBUILT_EVENT_FIXED_SIZE + (event->event_content ? strlen(event->event_content) : 0);
+    }
+
+    uint8_t *buffer = arena_alloc(arena, size);
+    if (!buffer) {
+        return -1;
+    }
+
+    // TCG_PCR_EVENT header: PCR 0, EV_NO_ACTION, zero SHA-1 digest, Spec ID Event03 data
+    uint8_t *p = put_le32(buffer, 0);
+    p = put_le32(p, TCG_EV_NO_ACTION);
+    memset(p, 0, TPM2_SHA1_DIGEST_SIZE);
+    p = put_le32(p + TPM2_SHA1_DIGEST_SIZE, SPEC_ID_EVENT_DATA_SIZE);
+    memcpy(p, TCG_SPEC_ID_SIGNATURE, sizeof(TCG_SPEC_ID_SIGNATURE));
+    p += sizeof(TCG_SPEC_ID_SIGNATURE);
+    p = put_le32(p, 0);                 // platformClass
+    *p++ = 0;                           // specVersionMinor
+    *p++ = 2;                           // specVersionMajor
+    *p++ = 0;                           // specErrata
+    *p++ = 2;                           // uintnSize
+    p = put_le32(p, 1);                 // numberOfAlgorithms
+    p = put_le16(p, TPM2_ALG_SHA256);
+    p = put_le16(p, TPM2_SHA256_DIGEST_SIZE);
+    *p++ = 0;                           // vendorInfoSize
+
+    // Version 1 does not carry event types; EV_IPL is extended and checked against the RIM like any other event.
+    for (size_t i = 0; i < event_log->n_events; i++) {
+        const TCGEvent *event = event_log->events[i];
+        size_t content_size = event->event_content ? strlen(event->event_content) : 0;
+        p = put_le32(p, event->pcr_index);
+        p = put_le32(p, TCG_EV_IPL);
+        p = put_le32(p, 1);
+        p = put_le16(p, TPM2_ALG_SHA256);
+        memcpy(p, event->digest.data, TPM2_SHA256_DIGEST_SIZE);
+        p = put_le32(p + TPM2_SHA256_DIGEST_SIZE, (uint32_t)content_size);
+        if (content_size > 0) {
+            memcpy(p, event->event_content, content_size);
+        }
+        p += content_size;
+    }
+
+    *log = buffer;
+    *log_size = size;
+    return 0;
+}
+
+/**
+ * @brief Returns the log of a chunked response, in place if it arrived in one chunk.
+ */
+static int join_log_chunks(Arena *arena, const AttestationResponse *response, const uint8_t **log,
+                           size_t *log_size) {
+    size_t size = 0;
+    for (size_t i = 0; i < response->n_log_chunks; i++) {
+        const LogChunk *chunk = response->log_chunks[i];
+        if (chunk->offset != size || chunk->data.len > SIZE_MAX - size) {
+            fprintf(stderr, "Log chunk %zu is out of order\n", i);
+            return -1;
+        }
+        size += chunk->data.len;
+    }
+
+    if (response->n_log_chunks == 1) {
+        *log = response->log_chunks[0]->data.data;
+        *log_size = size;
+        return 0;
+    }
+
+    uint8_t *buffer = arena_alloc(arena, size);
+    if (!buffer) {
+        return -1;
+    }
+    for (size_t i = 0; i < response->n_log_chunks; i++) {
+        const LogChunk *chunk = response->log_chunks[i];
+        memcpy(buffer + chunk->offset, chunk->data.data, chunk->data.len);
+    }
+    *log = buffer;
+    *log_size = size;
+    return 0;
+}
+
+/**
+ * @brief Decompresses the log of a compressed response into the arena, where it is parsed like one sent as is.
+ */
+static int decompress_log(Arena *arena, const AttestationResponse *response, const LogDictionary *dictionary,
+                          const uint8_t **log, size_t *log_size) {
+    uint64_t size;
+    if (!dictionary || response->log_dictionary_id != dictionary->id) {
+        fprintf(stderr, "Log compressed with dictionary %u, which was not offered\n", response->log_dictionary_id);
+        return -1;
+    }
+    if (log_dictionary_frame_size(response->compressed_log.data, response->compressed_log.len, &size) != 0 ||
+        size == 0 || size > ATTESTATION_MAX_LOG_SIZE) {
+        fprintf(stderr, "Compressed log has no valid size\n");
+        return -1;
+    }
+
+    uint8_t *buffer = arena_alloc(arena, (size_t)size);
+    if (!buffer || log_dictionary_decompress(dictionary, response->compressed_log.data, response->compressed_log.len,
+                                             buffer, (size_t)size) != 0) {
+        return -1;
+    }
+    *log = buffer;
+    *log_size = (size_t)size;
+    return 0;
+}
+
+int attestation_response_log(Arena *arena, const AttestationResponse *response, const LogDictionary *dictionary,
+                             const uint8_t **log, size_t *log_size) {
+    if (!arena || !response || !log || !log_size) {
+        return -1;
+    }
+
+    int status;
+    if (response->compressed_log.len > 0) {
+        if (response->measurement_log.len > 0 || response->n_log_chunks > 0) {
+            fprintf(stderr, "Response carries the log both compressed and uncompressed\n");
+            return -1;
+        }
+        status = decompress_log(arena, response, dictionary, log, log_size);
+    } else if (response->n_log_chunks > 0) {
+        if (response->measurement_log.len > 0) {
+            fprintf(stderr, "Response carries both measurement_log and log_chunks\n");
+            return -1;
+        }
+        status = join_log_chunks(arena, response, log, log_size);
+    } else if (response->measurement_log.len > 0) {
+        *log = response->measurement_log.data;
+        *log_size = response->measurement_log.len;
+        status = 0;
+    } else if (response->event_log && response->event_log->n_events > 0) {
+        status = rebuild_legacy_log(arena, response->event_log, log, log_size);
+    } else if (response->log_base_events > 0) {
+        // A delta with nothing new since the verifier's checkpoint
+        *log = response->log_header.data;
+        *log_size = 0;
+        return response->n_event_offsets == 0 ? 0 : -1;
+    } else {
+        fprintf(stderr, "Response carries no measurement log\n");
+        return -1;
+    }
+    if (status != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < response->n_event_offsets; i++) {
+        uint32_t offset = response->event_offsets[i];
+        if (offset >= *log_size || (i == 0 ? offset != 0 : offset <= response->event_offsets[i - 1])) {
+            fprintf(stderr, "Event offset index does not match the log\n");
+            return -1;
+        }
+    }
+    return 0;
+}
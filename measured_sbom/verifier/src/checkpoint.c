@@ -0,0 +1,358 @@
+// checkpoint.c
+// Per-attestor replay checkpoints for continuous re-attestation. A checkpoint records how much of an attestor's
+// measurement log has been verified and the PCR state it produced, so the next round only replays what was appended.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <openssl/sha.h>
+#include "checkpoint.h"
+
+#define CHECKPOINT_BUCKETS 1024
+#define CHECKPOINT_MAGIC 0x4b435641u    // "AVCK"
+#define CHECKPOINT_VERSION 4
+
+typedef struct CheckpointNode {
+    struct CheckpointNode *next;        // Next in the bucket of its key
+    struct CheckpointNode *next_alias;  // Next in the bucket of its attestor ID
+    VerifierCheckpoint checkpoint;
+} CheckpointNode;
+
+struct CheckpointStore {
+    pthread_mutex_t lock;
+    char *directory;
+    CheckpointNode *buckets[CHECKPOINT_BUCKETS];
+    CheckpointNode *aliases[CHECKPOINT_BUCKETS];
+};
+
+/**
+ * @struct CheckpointFileHeader
+ * @brief Header of a persisted checkpoint. The body is the VerifierCheckpoint as laid out on this host.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t body_size;
+    uint32_t reserved;
+} CheckpointFileHeader;
+
+static uint32_t hash_id(const char *id) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = id; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash % CHECKPOINT_BUCKETS;
+}
+
+/**
+ * @brief Builds the file path of a key's checkpoint. Keys are hashed so any key maps to a safe file name.
+ */
+static int checkpoint_path(const CheckpointStore *store, const char *key, char *path, size_t path_size) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    char hex[2 * SHA256_DIGEST_LENGTH + 1];
+
+    SHA256((const uint8_t *)key, strlen(key), digest);
+    for (size_t i = 0; i < sizeof(digest); i++) {
+        snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    }
+    int len = snprintf(path, path_size, "%s/%s%s", store->directory, hex, CHECKPOINT_FILE_SUFFIX);
+    return (len < 0 || (size_t)len >= path_size) ? -1 : 0;
+}
+
+static int load_checkpoint(const CheckpointStore *store, const char *key, VerifierCheckpoint *checkpoint) {
+    char path[4096];
+    if (!store->directory || checkpoint_path(store, key, path, sizeof(path)) != 0) {
+        return -1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    CheckpointFileHeader header;
+    int rc = -1;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == CHECKPOINT_MAGIC &&
+        header.version == CHECKPOINT_VERSION && header.body_size == sizeof(*checkpoint) &&
+        fread(checkpoint, sizeof(*checkpoint), 1, file) == 1 &&
+        strncmp(checkpoint->key, key, sizeof(checkpoint->key)) == 0 &&
+        memchr(checkpoint->attestor_id, '\0', sizeof(checkpoint->attestor_id)) != NULL) {
+        rc = 0;
+    } else {
+        fprintf(stderr, "Ignoring invalid checkpoint file: %s\n", path);
+    }
+    fclose(file);
+    return rc;
+}
+
+static int save_checkpoint(const CheckpointStore *store, const VerifierCheckpoint *checkpoint) {
+    char path[4096];
+    char tmp_path[4100];
+    if (!store->directory) {
+        return 0;
+    }
+    if (checkpoint_path(store, checkpoint->key, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error creating checkpoint file: %s\n", tmp_path);
+        return -1;
+    }
+
+    CheckpointFileHeader header = { CHECKPOINT_MAGIC, CHECKPOINT_VERSION, sizeof(*checkpoint), 0 };
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(checkpoint, sizeof(*checkpoint), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    // Replace the previous checkpoint atomically so a crash never leaves a torn file behind.
+    if (!ok || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error writing checkpoint file: %s\n", path);
+        remove(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static CheckpointNode *find_node(const CheckpointStore *store, const char *key) {
+    for (CheckpointNode *node = store->buckets[hash_id(key)]; node; node = node->next) {
+        if (strcmp(node->checkpoint.key, key) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void link_alias(CheckpointStore *store, CheckpointNode *node) {
+    uint32_t bucket = hash_id(node->checkpoint.attestor_id);
+    node->next_alias = store->aliases[bucket];
+    store->aliases[bucket] = node;
+}
+
+static void unlink_alias(CheckpointStore *store, CheckpointNode *node) {
+    CheckpointNode **link = &store->aliases[hash_id(node->checkpoint.attestor_id)];
+    while (*link && *link != node) {
+        link = &(*link)->next_alias;
+    }
+    if (*link) {
+        *link = node->next_alias;
+    }
+}
+
+static CheckpointNode *insert_node(CheckpointStore *store, const VerifierCheckpoint *checkpoint) {
+    CheckpointNode *node = malloc(sizeof(*node));
+    if (!node) {
+        fprintf(stderr, "Error allocating memory for checkpoint\n");
+        return NULL;
+    }
+    uint32_t bucket = hash_id(checkpoint->key);
+    node->checkpoint = *checkpoint;
+    node->next = store->buckets[bucket];
+    store->buckets[bucket] = node;
+    link_alias(store, node);
+    return node;
+}
+
+CheckpointStore *checkpoint_store_create(const char *directory) {
+    CheckpointStore *store = calloc(1, sizeof(*store));
+    if (!store) {
+        fprintf(stderr, "Error allocating memory for checkpoint store\n");
+        return NULL;
+    }
+    if (directory && !(store->directory = strdup(directory))) {
+        free(store);
+        return NULL;
+    }
+    pthread_mutex_init(&store->lock, NULL);
+    return store;
+}
+
+void checkpoint_store_destroy(CheckpointStore *store) {
+    if (!store) {
+        return;
+    }
+    for (size_t i = 0; i < CHECKPOINT_BUCKETS; i++) {
+        CheckpointNode *node = store->buckets[i];
+        while (node) {
+            CheckpointNode *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    pthread_mutex_destroy(&store->lock);
+    free(store->directory);
+    free(store);
+}
+
+int checkpoint_store_get(CheckpointStore *store, const char *key, VerifierCheckpoint *checkpoint) {
+    if (!store || !key || !checkpoint) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    CheckpointNode *node = find_node(store, key);
+    if (!node && load_checkpoint(store, key, checkpoint) == 0) {
+        node = insert_node(store, checkpoint);
+    }
+    if (node) {
+        *checkpoint = node->checkpoint;
+    }
+    pthread_mutex_unlock(&store->lock);
+    return node ? 0 : -1;
+}
+
+int checkpoint_store_find_attestor(CheckpointStore *store, const char *attestor_id, VerifierCheckpoint *checkpoint) {
+    if (!store || !attestor_id || attestor_id[0] == '\0' || !checkpoint) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    CheckpointNode *node = store->aliases[hash_id(attestor_id)];
+    while (node && strcmp(node->checkpoint.attestor_id, attestor_id) != 0) {
+        node = node->next_alias;
+    }
+    if (node) {
+        *checkpoint = node->checkpoint;
+    }
+    pthread_mutex_unlock(&store->lock);
+    return node ? 0 : -1;
+}
+
+int checkpoint_store_put(CheckpointStore *store, const VerifierCheckpoint *checkpoint) {
+    if (!store || !checkpoint || checkpoint->key[0] == '\0' ||
+        memchr(checkpoint->key, '\0', sizeof(checkpoint->key)) == NULL ||
+        memchr(checkpoint->attestor_id, '\0', sizeof(checkpoint->attestor_id)) == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    CheckpointNode *node = find_node(store, checkpoint->key);
+    if (node) {
+        // The newest key to present an ID is the one its next request is built for
+        unlink_alias(store, node);
+        node->checkpoint = *checkpoint;
+        link_alias(store, node);
+    } else {
+        node = insert_node(store, checkpoint);
+    }
+    int rc = node ? save_checkpoint(store, checkpoint) : -1;
+    pthread_mutex_unlock(&store->lock);
+    return rc;
+}
+
+void checkpoint_store_remove(CheckpointStore *store, const char *key) {
+    if (!store || !key) {
+        return;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    CheckpointNode **link = &store->buckets[hash_id(key)];
+    while (*link) {
+        if (strcmp((*link)->checkpoint.key, key) == 0) {
+            CheckpointNode *node = *link;
+            *link = node->next;
+            unlink_alias(store, node);
+            free(node);
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    char path[4096];
+    if (store->directory && checkpoint_path(store, key, path, sizeof(path)) == 0) {
+        remove(path);
+    }
+    pthread_mutex_unlock(&store->lock);
+}
+
+int checkpoint_matches_log(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size) {
+    if (!checkpoint || !measurement_log || checkpoint->event_count == 0 ||
+        checkpoint->byte_offset > log_size || checkpoint->last_record_offset >= checkpoint->byte_offset) {
+        return 0;
+    }
+
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(measurement_log + checkpoint->last_record_offset,
+           checkpoint->byte_offset - checkpoint->last_record_offset, digest);
+    return memcmp(digest, checkpoint->last_record_digest, sizeof(digest)) == 0;
+}
+
+int checkpoint_verify_prefix(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size) {
+    if (!checkpoint || !measurement_log || checkpoint->event_count == 0 || checkpoint->byte_offset > log_size) {
+        return 0;
+    }
+
+    TCG_EventLogCursor cursor;
+    if (tcg_log_cursor_init(&cursor, measurement_log, checkpoint->byte_offset) != TCG_LOG_OK ||
+        tcg_log_cursor_seek(&cursor, 0, 0) != TCG_LOG_OK) {
+        return 0;
+    }
+    uint8_t digest[PCR_LOG_DIGEST_SIZE] = {0};
+    if (pcr_log_digest_update(digest, &cursor) != 0 || cursor.record_num != checkpoint->event_count) {
+        return 0;
+    }
+    return memcmp(digest, checkpoint->prefix_digest, sizeof(digest)) == 0;
+}
+
+int checkpoint_seek_suffix(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size,
+                           size_t base_offset, TCG_EventLogCursor *cursor) {
+    if (!checkpoint || !cursor || base_offset > checkpoint->byte_offset ||
+        tcg_log_cursor_init(cursor, measurement_log, log_size) != TCG_LOG_OK) {
+        return -1;
+    }
+    // A fresh checkpoint has no banks yet; it only gets them from the log being accepted
+    if (checkpoint->event_count > 0) {
+        if (cursor->bank_count != checkpoint->pcrs.bank_count) {
+            return -1;
+        }
+        for (uint32_t b = 0; b < cursor->bank_count; b++) {
+            if (cursor->banks[b].alg != checkpoint->pcrs.banks[b].alg ||
+                cursor->banks[b].size != checkpoint->pcrs.banks[b].digest_size) {
+                return -1;
+            }
+        }
+    }
+    return tcg_log_cursor_seek(cursor, base_offset, checkpoint->event_count) == TCG_LOG_OK ? 0 : -1;
+}
+
+int checkpoint_advance_from(VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size,
+                            size_t base_offset) {
+    TCG_EventLogCursor cursor;
+    if (checkpoint_seek_suffix(checkpoint, measurement_log, log_size, base_offset, &cursor) != 0) {
+        return -1;
+    }
+
+    TCG_EventLogCursor digest_cursor = cursor;
+    if (pcr_log_digest_update(checkpoint->prefix_digest, &digest_cursor) != 0) {
+        return -1;
+    }
+
+    // The digest pass already validated every record, so this walk only has to find the last one.
+    TCG_EventView event;
+    size_t last_offset = 0;
+    bool advanced = false;
+    while (tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+        last_offset = event.offset;
+        advanced = true;
+    }
+
+    // Offsets in the buffer are shifted from offsets in the log by where the prefix ends in each
+    uint64_t shift = checkpoint->byte_offset - base_offset;
+    if (advanced) {
+        checkpoint->last_record_offset = last_offset + shift;
+        SHA256(measurement_log + last_offset, cursor.offset - last_offset, checkpoint->last_record_digest);
+    }
+
+    checkpoint->event_count = cursor.record_num;
+    checkpoint->byte_offset = cursor.offset + shift;
+    return 0;
+}
+
+int checkpoint_advance(VerifierCheckpoint *checkpoint, const uint8_t *measurement_log, size_t log_size) {
+    if (!checkpoint) {
+        return -1;
+    }
+    return checkpoint_advance_from(checkpoint, measurement_log, log_size, checkpoint->byte_offset);
+}
@@ -0,0 +1,1057 @@
+// event_archive.c
+// Content-addressed archive of verified measurement logs. Logs are split into chunks of whole events, each unique
+// chunk is stored once, and every attestation is kept as a short record of chunk references and its quote.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include "event_archive.h"
+#include "event_log_parser.h"
+
+#define ARCHIVE_CHUNK_MAGIC 0x4b484341u     // "ACHK"
+#define ARCHIVE_RECORD_MAGIC 0x43455241u    // "AREC"
+#define ARCHIVE_ATTESTOR_BUCKETS 1024
+#define ARCHIVE_TABLE_MIN 1024              // Initial slots of the open-addressing tables; a power of two
+#define ARCHIVE_DIGEST_BATCH 1024           // Digest index entries read at a time when opening
+
+// On-disk layout, as laid out on this host
+
+/**
+ * @struct ArchiveChunkHeader
+ * @brief Header of a chunk in the chunk file; the chunk's bytes follow it.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;                          /**< Bytes of the chunk */
+    uint32_t event_count;                   /**< Records of the chunk */
+    uint32_t reserved;
+    uint8_t digest[SHA256_DIGEST_LENGTH];   /**< SHA-256 of the chunk's bytes */
+} ArchiveChunkHeader;
+
+/**
+ * @struct ArchiveChunkRef
+ * @brief Reference to a stored chunk, as listed in records.
+ */
+typedef struct {
+    uint64_t offset;                        /**< Offset of the chunk's bytes in the chunk file */
+    uint32_t size;                          /**< Bytes of the chunk */
+    uint32_t event_count;                   /**< Records of the chunk */
+} ArchiveChunkRef;
+
+/**
+ * @struct ArchiveDigestEntry
+ * @brief Entry of the digest index: one event digest found in one chunk.
+ */
+typedef struct {
+    uint64_t chunk;                         /**< Offset of the chunk's bytes */
+    uint16_t alg;                           /**< Hash algorithm */
+    uint16_t size;                          /**< Digest size */
+    uint32_t reserved;
+    uint8_t digest[sizeof(TPMU_HA)];        /**< Digest, zero-padded */
+} ArchiveDigestEntry;
+
+/**
+ * @struct ArchiveRecordHeader
+ * @brief Header of a record in the record file; the attestor ID, the chunk references and the quote follow it.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;                          /**< Bytes of the whole record */
+    uint64_t timestamp_ns;
+    uint64_t parent;                        /**< Record holding the first records of the log, or EVENT_ARCHIVE_NONE */
+    uint64_t event_count;                   /**< Records of the whole log */
+    uint64_t log_size;                      /**< Bytes of the whole log */
+    uint32_t chunk_count;                   /**< ArchiveChunkRefs that follow the attestor ID */
+    uint16_t id_size;                       /**< Bytes of the attestor ID, without a terminator */
+    uint16_t depth;                         /**< Parents above this record */
+    uint32_t quote_size;
+    int32_t result;
+} ArchiveRecordHeader;
+
+// In-memory indexes
+
+typedef struct {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    ArchiveChunkRef ref;                    /**< size 0 marks a free slot */
+} ArchiveChunkSlot;
+
+typedef struct {
+    TPM2_ALG_ID alg;
+    uint16_t size;
+    uint8_t digest[sizeof(TPMU_HA)];
+    size_t chunk_count;
+    size_t chunk_capacity;
+    uint64_t *chunks;                       /**< Chunks holding the digest, in the order they were stored */
+} ArchiveDigestNode;
+
+typedef struct ArchiveAttestorNode {
+    struct ArchiveAttestorNode *next;
+    char attestor_id[EVENT_ARCHIVE_ID_MAX];
+    uint64_t record;                        /**< Last record of the attestor */
+    uint64_t event_count;                   /**< Records of that record's log */
+    uint64_t log_size;                      /**< Size of that record's log */
+    uint16_t depth;                         /**< Depth of that record */
+} ArchiveAttestorNode;
+
+/**
+ * @struct ArchiveIdSet
+ * @brief Open-addressing set of offsets; EVENT_ARCHIVE_NONE marks a free slot.
+ */
+typedef struct {
+    uint64_t *slots;
+    size_t capacity;
+    size_t count;
+} ArchiveIdSet;
+
+/**
+ * @struct ArchiveRecordView
+ * @brief A record read into a buffer; the pointers point into it.
+ */
+typedef struct {
+    ArchiveRecordHeader header;
+    const char *attestor_id;
+    const uint8_t *refs;                    /**< header.chunk_count ArchiveChunkRefs, unaligned */
+    const uint8_t *quote;
+} ArchiveRecordView;
+
+struct EventArchive {
+    pthread_mutex_t lock;
+    int chunk_fd;
+    int digest_fd;
+    int record_fd;
+    uint64_t chunk_end;                     /**< Size of each file */
+    uint64_t digest_end;
+    uint64_t record_end;
+    bool failed;                            /**< A write failed; the files may not match the indexes any more */
+
+    ArchiveChunkSlot *chunks;               /**< Chunks by SHA-256 */
+    size_t chunk_capacity;
+    size_t chunk_count;
+    ArchiveDigestNode **digests;            /**< Event digests by algorithm and value */
+    size_t digest_capacity;
+    size_t digest_count;
+    ArchiveAttestorNode *attestors[ARCHIVE_ATTESTOR_BUCKETS];
+
+    uint64_t record_count;
+    uint64_t appended;
+    uint64_t log_bytes;
+    uint64_t chunk_bytes;
+
+    // Scratch of event_archive_append(), under the lock
+    uint8_t *pending_chunks;                /**< New chunks with their headers, written at once */
+    size_t pending_chunks_size;
+    size_t pending_chunks_capacity;
+    ArchiveDigestEntry *pending_digests;    /**< Index entries of the new chunks */
+    size_t pending_digest_count;
+    size_t pending_digest_capacity;
+    ArchiveChunkRef *refs;                  /**< Chunks of the record being built */
+    size_t ref_count;
+    size_t ref_capacity;
+    uint8_t *record_buffer;
+    size_t record_capacity;
+};
+
+// Helpers
+
+static uint64_t load_u64(const uint8_t *bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static uint64_t mix_u64(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    return value;
+}
+
+static uint32_t hash_id(const char *attestor_id) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = attestor_id; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash % ARCHIVE_ATTESTOR_BUCKETS;
+}
+
+static int grow(void **buffer, size_t *capacity, size_t needed, size_t element_size) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t new_capacity = *capacity ? *capacity : 16;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void *grown = realloc(*buffer, new_capacity * element_size);
+    if (!grown) {
+        fprintf(stderr, "Error allocating memory for the event archive\n");
+        return -1;
+    }
+    *buffer = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int read_exact(int fd, void *buffer, size_t size, uint64_t offset) {
+    uint8_t *bytes = buffer;
+    while (size > 0) {
+        ssize_t n = pread(fd, bytes, size, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        bytes += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+static int write_exact(int fd, const void *buffer, size_t size, uint64_t offset) {
+    const uint8_t *bytes = buffer;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, bytes, size, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        bytes += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 0;
+}
+
+// Offset sets
+
+static int id_set_init(ArchiveIdSet *set, size_t expected) {
+    set->capacity = 16;
+    while (set->capacity < 2 * expected) {
+        set->capacity *= 2;
+    }
+    set->count = 0;
+    set->slots = malloc(set->capacity * sizeof(*set->slots));
+    if (!set->slots) {
+        fprintf(stderr, "Error allocating memory for the event archive\n");
+        return -1;
+    }
+    memset(set->slots, 0xff, set->capacity * sizeof(*set->slots));
+    return 0;
+}
+
+static bool id_set_contains(const ArchiveIdSet *set, uint64_t id) {
+    for (size_t i = mix_u64(id) & (set->capacity - 1);; i = (i + 1) & (set->capacity - 1)) {
+        if (set->slots[i] == id) {
+            return true;
+        }
+        if (set->slots[i] == EVENT_ARCHIVE_NONE) {
+            return false;
+        }
+    }
+}
+
+static int id_set_add(ArchiveIdSet *set, uint64_t id) {
+    if (2 * (set->count + 1) > set->capacity) {
+        ArchiveIdSet grown;
+        if (id_set_init(&grown, set->capacity) != 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (set->slots[i] != EVENT_ARCHIVE_NONE) {
+                id_set_add(&grown, set->slots[i]);
+            }
+        }
+        free(set->slots);
+        *set = grown;
+    }
+    size_t i = mix_u64(id) & (set->capacity - 1);
+    while (set->slots[i] != EVENT_ARCHIVE_NONE && set->slots[i] != id) {
+        i = (i + 1) & (set->capacity - 1);
+    }
+    if (set->slots[i] == EVENT_ARCHIVE_NONE) {
+        set->slots[i] = id;
+        set->count++;
+    }
+    return 0;
+}
+
+// Chunk table
+
+static ArchiveChunkSlot *chunk_slot(ArchiveChunkSlot *slots, size_t capacity, const uint8_t *digest) {
+    size_t i = load_u64(digest) & (capacity - 1);
+    while (slots[i].ref.size != 0 && memcmp(slots[i].digest, digest, SHA256_DIGEST_LENGTH) != 0) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+/**
+ * @brief Returns the slot of a chunk digest, free if the chunk is not stored; the table grows to keep it sparse.
+ */
+static ArchiveChunkSlot *chunk_find(EventArchive *archive, const uint8_t *digest) {
+    if (2 * (archive->chunk_count + 1) > archive->chunk_capacity) {
+        size_t capacity = archive->chunk_capacity ? 2 * archive->chunk_capacity : ARCHIVE_TABLE_MIN;
+        ArchiveChunkSlot *slots = calloc(capacity, sizeof(*slots));
+        if (!slots) {
+            fprintf(stderr, "Error allocating memory for the event archive\n");
+            return NULL;
+        }
+        for (size_t i = 0; i < archive->chunk_capacity; i++) {
+            if (archive->chunks[i].ref.size != 0) {
+                *chunk_slot(slots, capacity, archive->chunks[i].digest) = archive->chunks[i];
+            }
+        }
+        free(archive->chunks);
+        archive->chunks = slots;
+        archive->chunk_capacity = capacity;
+    }
+    return chunk_slot(archive->chunks, archive->chunk_capacity, digest);
+}
+
+// Digest index
+
+static size_t digest_slot(ArchiveDigestNode **slots, size_t capacity, TPM2_ALG_ID alg, const uint8_t *digest,
+                          uint16_t size) {
+    uint64_t key = 0;
+    memcpy(&key, digest, size < sizeof(key) ? size : sizeof(key));
+    size_t i = mix_u64(key ^ alg) & (capacity - 1);
+    while (slots[i] &&
+           (slots[i]->alg != alg || slots[i]->size != size || memcmp(slots[i]->digest, digest, size) != 0)) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return i;
+}
+
+static ArchiveDigestNode *digest_find(const EventArchive *archive, TPM2_ALG_ID alg, const uint8_t *digest,
+                                      uint16_t size) {
+    if (archive->digest_capacity == 0) {
+        return NULL;
+    }
+    return archive->digests[digest_slot(archive->digests, archive->digest_capacity, alg, digest, size)];
+}
+
+/**
+ * @brief Records that a chunk holds a digest. A chunk is indexed at once, so a repeat is the last entry.
+ */
+static int digest_add(EventArchive *archive, TPM2_ALG_ID alg, const uint8_t *digest, uint16_t size, uint64_t chunk,
+                      bool *added) {
+    *added = false;
+    if (size == 0 || size > sizeof(TPMU_HA)) {
+        return 0;
+    }
+    if (2 * (archive->digest_count + 1) > archive->digest_capacity) {
+        size_t capacity = archive->digest_capacity ? 2 * archive->digest_capacity : ARCHIVE_TABLE_MIN;
+        ArchiveDigestNode **slots = calloc(capacity, sizeof(*slots));
+        if (!slots) {
+            fprintf(stderr, "Error allocating memory for the event archive\n");
+            return -1;
+        }
+        for (size_t i = 0; i < archive->digest_capacity; i++) {
+            ArchiveDigestNode *node = archive->digests[i];
+            if (node) {
+                slots[digest_slot(slots, capacity, node->alg, node->digest, node->size)] = node;
+            }
+        }
+        free(archive->digests);
+        archive->digests = slots;
+        archive->digest_capacity = capacity;
+    }
+
+    size_t slot = digest_slot(archive->digests, archive->digest_capacity, alg, digest, size);
+    ArchiveDigestNode *node = archive->digests[slot];
+    if (!node) {
+        node = calloc(1, sizeof(*node));
+        if (!node) {
+            fprintf(stderr, "Error allocating memory for the event archive\n");
+            return -1;
+        }
+        node->alg = alg;
+        node->size = size;
+        memcpy(node->digest, digest, size);
+        archive->digests[slot] = node;
+        archive->digest_count++;
+    }
+    if (node->chunk_count > 0 && node->chunks[node->chunk_count - 1] == chunk) {
+        return 0;
+    }
+    if (grow((void **)&node->chunks, &node->chunk_capacity, node->chunk_count + 1, sizeof(*node->chunks)) != 0) {
+        return -1;
+    }
+    node->chunks[node->chunk_count++] = chunk;
+    *added = true;
+    return 0;
+}
+
+// Attestors
+
+static ArchiveAttestorNode *attestor_find(const EventArchive *archive, const char *attestor_id) {
+    for (ArchiveAttestorNode *node = archive->attestors[hash_id(attestor_id)]; node; node = node->next) {
+        if (strcmp(node->attestor_id, attestor_id) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static int attestor_update(EventArchive *archive, const char *attestor_id, uint64_t record,
+                           const ArchiveRecordHeader *header) {
+    ArchiveAttestorNode *node = attestor_find(archive, attestor_id);
+    if (!node) {
+        node = calloc(1, sizeof(*node));
+        if (!node) {
+            fprintf(stderr, "Error allocating memory for the event archive\n");
+            return -1;
+        }
+        snprintf(node->attestor_id, sizeof(node->attestor_id), "%s", attestor_id);
+        uint32_t bucket = hash_id(attestor_id);
+        node->next = archive->attestors[bucket];
+        archive->attestors[bucket] = node;
+    }
+    node->record = record;
+    node->event_count = header->event_count;
+    node->log_size = header->log_size;
+    node->depth = header->depth;
+    return 0;
+}
+
+// Records
+
+/**
+ * @brief Reads the record at an offset into a buffer and checks it lies within the first end bytes of the file.
+ */
+static int read_record(const EventArchive *archive, uint64_t offset, uint64_t end, uint8_t **buffer,
+                       size_t *capacity, ArchiveRecordView *view) {
+    ArchiveRecordHeader *header = &view->header;
+    if (offset + sizeof(*header) > end || read_exact(archive->record_fd, header, sizeof(*header), offset) != 0 ||
+        header->magic != ARCHIVE_RECORD_MAGIC || header->size < sizeof(*header) || offset + header->size > end ||
+        header->id_size >= EVENT_ARCHIVE_ID_MAX ||
+        sizeof(*header) + header->id_size + (uint64_t)header->chunk_count * sizeof(ArchiveChunkRef) +
+                header->quote_size != header->size) {
+        return -1;
+    }
+    if (grow((void **)buffer, capacity, header->size, 1) != 0 ||
+        read_exact(archive->record_fd, *buffer, header->size, offset) != 0) {
+        return -1;
+    }
+    view->attestor_id = (const char *)*buffer + sizeof(*header);
+    view->refs = (const uint8_t *)view->attestor_id + header->id_size;
+    view->quote = view->refs + (size_t)header->chunk_count * sizeof(ArchiveChunkRef);
+    return 0;
+}
+
+static void record_from_view(const ArchiveRecordView *view, uint64_t id, ArchiveRecord *record) {
+    record->id = id;
+    record->parent = view->header.parent;
+    record->timestamp_ns = view->header.timestamp_ns;
+    record->result = view->header.result;
+    record->event_count = view->header.event_count;
+    record->log_size = view->header.log_size;
+    record->chunk_count = view->header.chunk_count;
+    memcpy(record->attestor_id, view->attestor_id, view->header.id_size);
+    record->attestor_id[view->header.id_size] = '\0';
+    record->quote = view->quote;
+    record->quote_size = view->header.quote_size;
+}
+
+static ArchiveChunkRef record_ref(const ArchiveRecordView *view, size_t index) {
+    ArchiveChunkRef ref;
+    memcpy(&ref, view->refs + index * sizeof(ref), sizeof(ref));
+    return ref;
+}
+
+// Opening
+
+static int open_file(const char *directory, const char *name, uint64_t *size) {
+    char path[4096];
+    int len = snprintf(path, sizeof(path), "%s/%s", directory, name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error opening archive file: %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    *size = (uint64_t)st.st_size;
+    return fd;
+}
+
+/**
+ * @brief Cuts a torn tail left by a crash off a file.
+ */
+static int truncate_tail(int fd, const char *name, uint64_t size, uint64_t valid) {
+    if (valid == size) {
+        return 0;
+    }
+    fprintf(stderr, "Truncating %llu bytes of torn or invalid data from the end of %s\n",
+            (unsigned long long)(size - valid), name);
+    return ftruncate(fd, (off_t)valid);
+}
+
+static int load_chunks(EventArchive *archive, uint64_t size) {
+    uint64_t offset = 0;
+    ArchiveChunkHeader header;
+    while (offset + sizeof(header) <= size && read_exact(archive->chunk_fd, &header, sizeof(header), offset) == 0 &&
+           header.magic == ARCHIVE_CHUNK_MAGIC && header.size > 0 && offset + sizeof(header) + header.size <= size) {
+        ArchiveChunkSlot *slot = chunk_find(archive, header.digest);
+        if (!slot) {
+            return -1;
+        }
+        if (slot->ref.size == 0) {
+            memcpy(slot->digest, header.digest, sizeof(header.digest));
+            slot->ref = (ArchiveChunkRef){ offset + sizeof(header), header.size, header.event_count };
+            archive->chunk_count++;
+        }
+        offset += sizeof(header) + header.size;
+    }
+    archive->chunk_end = offset;
+    return truncate_tail(archive->chunk_fd, EVENT_ARCHIVE_CHUNK_FILE, size, offset);
+}
+
+static int load_digests(EventArchive *archive, uint64_t size) {
+    ArchiveDigestEntry *entries = malloc(ARCHIVE_DIGEST_BATCH * sizeof(*entries));
+    uint64_t offset = 0;
+    bool valid = true;
+    if (!entries) {
+        fprintf(stderr, "Error allocating memory for the event archive\n");
+        return -1;
+    }
+    while (valid && offset + sizeof(*entries) <= size) {
+        size_t count = (size_t)((size - offset) / sizeof(*entries));
+        count = count < ARCHIVE_DIGEST_BATCH ? count : ARCHIVE_DIGEST_BATCH;
+        if (read_exact(archive->digest_fd, entries, count * sizeof(*entries), offset) != 0) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            bool added;
+            // Entries are written after their chunk, so one naming a chunk past the end is from a torn append
+            if (entries[i].chunk >= archive->chunk_end) {
+                valid = false;
+                break;
+            }
+            if (digest_add(archive, entries[i].alg, entries[i].digest, entries[i].size, entries[i].chunk,
+                           &added) != 0) {
+                free(entries);
+                return -1;
+            }
+            offset += sizeof(*entries);
+        }
+    }
+    free(entries);
+    archive->digest_end = offset;
+    return truncate_tail(archive->digest_fd, EVENT_ARCHIVE_DIGEST_FILE, size, offset);
+}
+
+static int load_records(EventArchive *archive, uint64_t size) {
+    ArchiveRecordView view;
+    uint64_t offset = 0;
+    int rc = 0;
+    while (rc == 0 && read_record(archive, offset, size, &archive->record_buffer, &archive->record_capacity,
+                                  &view) == 0) {
+        bool valid = true;
+        for (uint32_t i = 0; valid && i < view.header.chunk_count; i++) {
+            ArchiveChunkRef ref = record_ref(&view, i);
+            valid = ref.offset + ref.size <= archive->chunk_end;
+        }
+        if (!valid) {
+            break;
+        }
+        char attestor_id[EVENT_ARCHIVE_ID_MAX];
+        memcpy(attestor_id, view.attestor_id, view.header.id_size);
+        attestor_id[view.header.id_size] = '\0';
+        rc = attestor_update(archive, attestor_id, offset, &view.header);
+        archive->record_count++;
+        offset += view.header.size;
+    }
+    archive->record_end = offset;
+    return rc == 0 ? truncate_tail(archive->record_fd, EVENT_ARCHIVE_RECORD_FILE, size, offset) : -1;
+}
+
+EventArchive *event_archive_open(const char *directory) {
+    if (!directory) {
+        return NULL;
+    }
+    if (mkdir(directory, 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error creating archive directory: %s\n", directory);
+        return NULL;
+    }
+    EventArchive *archive = calloc(1, sizeof(*archive));
+    if (!archive) {
+        fprintf(stderr, "Error allocating memory for the event archive\n");
+        return NULL;
+    }
+    pthread_mutex_init(&archive->lock, NULL);
+    archive->chunk_fd = archive->digest_fd = archive->record_fd = -1;
+
+    uint64_t chunk_size, digest_size, record_size;
+    archive->chunk_fd = open_file(directory, EVENT_ARCHIVE_CHUNK_FILE, &chunk_size);
+    archive->digest_fd = open_file(directory, EVENT_ARCHIVE_DIGEST_FILE, &digest_size);
+    archive->record_fd = open_file(directory, EVENT_ARCHIVE_RECORD_FILE, &record_size);
+    if (archive->chunk_fd < 0 || archive->digest_fd < 0 || archive->record_fd < 0 ||
+        load_chunks(archive, chunk_size) != 0 || load_digests(archive, digest_size) != 0 ||
+        load_records(archive, record_size) != 0) {
+        fprintf(stderr, "Error opening event archive: %s\n", directory);
+        event_archive_close(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+void event_archive_close(EventArchive *archive) {
+    if (!archive) {
+        return;
+    }
+    if (archive->chunk_fd >= 0) {
+        close(archive->chunk_fd);
+    }
+    if (archive->digest_fd >= 0) {
+        close(archive->digest_fd);
+    }
+    if (archive->record_fd >= 0) {
+        close(archive->record_fd);
+    }
+    for (size_t i = 0; i < archive->digest_capacity; i++) {
+        if (archive->digests[i]) {
+            free(archive->digests[i]->chunks);
+            free(archive->digests[i]);
+        }
+    }
+    for (size_t i = 0; i < ARCHIVE_ATTESTOR_BUCKETS; i++) {
+        ArchiveAttestorNode *node = archive->attestors[i];
+        while (node) {
+            ArchiveAttestorNode *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(archive->digests);
+    free(archive->chunks);
+    free(archive->pending_chunks);
+    free(archive->pending_digests);
+    free(archive->refs);
+    free(archive->record_buffer);
+    pthread_mutex_destroy(&archive->lock);
+    free(archive);
+}
+
+// Appending
+
+/**
+ * @brief Adds a run of events to the record being built, staging the chunk and its digests if it is new.
+ *
+ * @param[in] run         Cursor positioned at the first event of the run, for indexing its digests.
+ * @param[in] start       Offset of the run in the log.
+ * @param[in] end         Offset just past the run.
+ * @param[in] run_events  Events of the run.
+ */
+static int add_chunk(EventArchive *archive, TCG_EventLogCursor run, size_t start, size_t end, size_t run_events) {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(run.log + start, end - start, digest);
+    ArchiveChunkSlot *slot = chunk_find(archive, digest);
+    if (!slot || grow((void **)&archive->refs, &archive->ref_capacity, archive->ref_count + 1,
+                      sizeof(*archive->refs)) != 0) {
+        return -1;
+    }
+    if (slot->ref.size != 0) {
+        archive->refs[archive->ref_count++] = slot->ref;
+        return 0;
+    }
+
+    // A new chunk goes after the ones already staged for this record
+    ArchiveChunkHeader header = { ARCHIVE_CHUNK_MAGIC, (uint32_t)(end - start), (uint32_t)run_events, 0, { 0 } };
+    memcpy(header.digest, digest, sizeof(digest));
+    size_t staged = archive->pending_chunks_size;
+    if (grow((void **)&archive->pending_chunks, &archive->pending_chunks_capacity,
+             staged + sizeof(header) + (end - start), 1) != 0) {
+        return -1;
+    }
+    memcpy(archive->pending_chunks + staged, &header, sizeof(header));
+    memcpy(archive->pending_chunks + staged + sizeof(header), run.log + start, end - start);
+    archive->pending_chunks_size += sizeof(header) + (end - start);
+
+    memcpy(slot->digest, digest, sizeof(digest));
+    slot->ref = (ArchiveChunkRef){ archive->chunk_end + staged + sizeof(header), header.size, header.event_count };
+    archive->chunk_count++;
+    archive->chunk_bytes += header.size;
+    archive->refs[archive->ref_count++] = slot->ref;
+
+    // Index every digest of the run's events
+    TCG_EventView event;
+    for (size_t i = 0; i < run_events && tcg_log_cursor_next(&run, &event) == TCG_LOG_OK; i++) {
+        for (uint32_t d = 0; d < event.digest_count; d++) {
+            bool added;
+            if (digest_add(archive, event.digests[d].alg, event.digests[d].digest, event.digests[d].size,
+                           slot->ref.offset, &added) != 0 ||
+                grow((void **)&archive->pending_digests, &archive->pending_digest_capacity,
+                     archive->pending_digest_count + 1, sizeof(*archive->pending_digests)) != 0) {
+                return -1;
+            }
+            if (added) {
+                ArchiveDigestEntry *entry = &archive->pending_digests[archive->pending_digest_count++];
+                memset(entry, 0, sizeof(*entry));
+                entry->chunk = slot->ref.offset;
+                entry->alg = event.digests[d].alg;
+                entry->size = event.digests[d].size;
+                memcpy(entry->digest, event.digests[d].digest, event.digests[d].size);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Splits the records after the cursor into chunks; a run ends where an event's first digest has its low bits
+ *        clear, or at the size limits.
+ */
+static int split_events(EventArchive *archive, TCG_EventLogCursor *cursor) {
+    TCG_EventLogCursor run = *cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    size_t start = cursor->offset;
+    size_t run_events = 0;
+
+    while ((status = tcg_log_cursor_next(cursor, &event)) == TCG_LOG_OK) {
+        run_events++;
+        uint32_t anchor = 1;
+        if (event.digest_count > 0 && event.digests[0].size >= sizeof(anchor)) {
+            memcpy(&anchor, event.digests[0].digest, sizeof(anchor));
+        }
+        if ((anchor & (EVENT_ARCHIVE_CHUNK_AVERAGE_EVENTS - 1)) == 0 ||
+            run_events >= EVENT_ARCHIVE_CHUNK_MAX_EVENTS || cursor->offset - start >= EVENT_ARCHIVE_CHUNK_MAX_SIZE) {
+            if (add_chunk(archive, run, start, cursor->offset, run_events) != 0) {
+                return -1;
+            }
+            run = *cursor;
+            start = cursor->offset;
+            run_events = 0;
+        }
+    }
+    if (status != TCG_LOG_END) {
+        fprintf(stderr, "Archived log is malformed: %s\n", tcg_log_status_str(status));
+        return -1;
+    }
+    return run_events > 0 ? add_chunk(archive, run, start, cursor->offset, run_events) : 0;
+}
+
+/**
+ * @brief Writes the staged chunks and their index entries; chunks go first, so an index entry never names a chunk
+ *        a crash lost.
+ */
+static int flush_chunks(EventArchive *archive) {
+    size_t digest_bytes = archive->pending_digest_count * sizeof(*archive->pending_digests);
+    if (write_exact(archive->chunk_fd, archive->pending_chunks, archive->pending_chunks_size, archive->chunk_end) !=
+            0 ||
+        write_exact(archive->digest_fd, archive->pending_digests, digest_bytes, archive->digest_end) != 0) {
+        fprintf(stderr, "Error writing the event archive; no further attestations are archived\n");
+        archive->failed = true;
+        return -1;
+    }
+    archive->chunk_end += archive->pending_chunks_size;
+    archive->digest_end += digest_bytes;
+    archive->pending_chunks_size = 0;
+    archive->pending_digest_count = 0;
+    return 0;
+}
+
+/**
+ * @brief Lists the chunks of a record and all of its parents, first to last, in the record being built.
+ */
+static int resolve_chunks(EventArchive *archive, uint64_t record_id, uint64_t end) {
+    uint64_t chain[EVENT_ARCHIVE_MAX_DEPTH + 1];
+    size_t depth = 0;
+    ArchiveRecordView view;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    int rc = 0;
+
+    for (uint64_t id = record_id; rc == 0 && id != EVENT_ARCHIVE_NONE; id = view.header.parent) {
+        if (depth == EVENT_ARCHIVE_MAX_DEPTH + 1 || read_record(archive, id, end, &buffer, &capacity, &view) != 0) {
+            rc = -1;
+            break;
+        }
+        chain[depth++] = id;
+    }
+    while (rc == 0 && depth > 0) {
+        rc = read_record(archive, chain[--depth], end, &buffer, &capacity, &view);
+        if (rc == 0) {
+            rc = grow((void **)&archive->refs, &archive->ref_capacity, archive->ref_count + view.header.chunk_count,
+                      sizeof(*archive->refs));
+        }
+        for (uint32_t i = 0; rc == 0 && i < view.header.chunk_count; i++) {
+            archive->refs[archive->ref_count++] = record_ref(&view, i);
+        }
+    }
+    free(buffer);
+    return rc;
+}
+
+int event_archive_append(EventArchive *archive, const ArchiveAttestation *attestation, uint64_t *record_id) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    if (!archive || !attestation || !attestation->attestor_id || !attestation->log ||
+        attestation->base_offset > attestation->log_size ||
+        strlen(attestation->attestor_id) >= EVENT_ARCHIVE_ID_MAX) {
+        fprintf(stderr, "Archiving failed: Invalid input\n");
+        return -1;
+    }
+    if (tcg_log_cursor_init(&cursor, attestation->log, attestation->log_size) != TCG_LOG_OK) {
+        fprintf(stderr, "Archived log has no valid header\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    if (archive->failed) {
+        pthread_mutex_unlock(&archive->lock);
+        return -1;
+    }
+    archive->pending_chunks_size = 0;
+    archive->pending_digest_count = 0;
+    archive->ref_count = 0;
+
+    ArchiveRecordHeader header = { .magic = ARCHIVE_RECORD_MAGIC, .timestamp_ns = attestation->timestamp_ns,
+                                   .parent = EVENT_ARCHIVE_NONE, .id_size = (uint16_t)strlen(attestation->attestor_id),
+                                   .result = attestation->result };
+    int rc = 0;
+    if (attestation->base_events == 0) {
+        // The header record is a chunk of its own: it is the same in every log with the same banks
+        TCG_EventLogCursor header_run = cursor;
+        rc = tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK
+                 ? add_chunk(archive, header_run, 0, cursor.offset, 1)
+                 : -1;
+    } else {
+        // A delta extends the attestor's last record when it starts where that record's log ended
+        const ArchiveAttestorNode *last = attestor_find(archive, attestation->attestor_id);
+        if (tcg_log_cursor_seek(&cursor, attestation->base_offset, attestation->base_events) != TCG_LOG_OK) {
+            rc = -1;
+        } else if (last && last->event_count == attestation->base_events && last->log_size == attestation->base_size) {
+            if (last->depth + 1 < EVENT_ARCHIVE_MAX_DEPTH) {
+                header.parent = last->record;
+                header.depth = (uint16_t)(last->depth + 1);
+            } else {
+                rc = resolve_chunks(archive, last->record, archive->record_end);
+            }
+        }
+    }
+    rc = rc == 0 ? split_events(archive, &cursor) : -1;
+
+    header.event_count = cursor.record_num;
+    header.log_size = attestation->base_size + (attestation->log_size - attestation->base_offset);
+    header.chunk_count = (uint32_t)archive->ref_count;
+    header.quote_size = (uint32_t)attestation->quote_size;
+    size_t record_size = sizeof(header) + header.id_size + archive->ref_count * sizeof(ArchiveChunkRef) +
+                         attestation->quote_size;
+    header.size = (uint32_t)record_size;
+    if (rc == 0 && grow((void **)&archive->record_buffer, &archive->record_capacity, record_size, 1) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        // Chunks staged before the log turned out malformed are already in the table; store them without a record
+        fprintf(stderr, "Error archiving the attestation of %s\n", attestation->attestor_id);
+        flush_chunks(archive);
+        pthread_mutex_unlock(&archive->lock);
+        return -1;
+    }
+    uint8_t *record = archive->record_buffer;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), attestation->attestor_id, header.id_size);
+    memcpy(record + sizeof(header) + header.id_size, archive->refs, archive->ref_count * sizeof(ArchiveChunkRef));
+    if (attestation->quote_size > 0) {
+        memcpy(record + record_size - attestation->quote_size, attestation->quote, attestation->quote_size);
+    }
+
+    // The record goes after the chunks it references
+    if (flush_chunks(archive) != 0) {
+        pthread_mutex_unlock(&archive->lock);
+        return -1;
+    }
+    if (write_exact(archive->record_fd, record, record_size, archive->record_end) != 0) {
+        fprintf(stderr, "Error writing the event archive; no further attestations are archived\n");
+        archive->failed = true;
+        pthread_mutex_unlock(&archive->lock);
+        return -1;
+    }
+    uint64_t id = archive->record_end;
+    archive->record_end += record_size;
+    archive->record_count++;
+    archive->appended++;
+    archive->log_bytes += header.log_size;
+    rc = attestor_update(archive, attestation->attestor_id, id, &header);
+    pthread_mutex_unlock(&archive->lock);
+
+    if (record_id) {
+        *record_id = id;
+    }
+    return rc;
+}
+
+// Reading
+
+int event_archive_read_log(EventArchive *archive, uint64_t record_id, uint8_t **log, size_t *log_size) {
+    uint64_t chain[EVENT_ARCHIVE_MAX_DEPTH + 1];
+    size_t depth = 0;
+    ArchiveRecordView view;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    if (!archive || !log || !log_size) {
+        return -1;
+    }
+
+    // Records are never rewritten, so whatever lies before the current end can be read without the lock
+    pthread_mutex_lock(&archive->lock);
+    uint64_t end = archive->record_end;
+    pthread_mutex_unlock(&archive->lock);
+
+    // The leaf's header gives the size of the whole log; the root's chunks come first in it
+    size_t size = 0;
+    for (uint64_t id = record_id; id != EVENT_ARCHIVE_NONE; id = view.header.parent) {
+        if (depth == EVENT_ARCHIVE_MAX_DEPTH + 1 || read_record(archive, id, end, &buffer, &capacity, &view) != 0) {
+            fprintf(stderr, "No archived record %llu\n", (unsigned long long)id);
+            free(buffer);
+            return -1;
+        }
+        size = depth == 0 ? (size_t)view.header.log_size : size;
+        chain[depth++] = id;
+    }
+    *log = malloc(size ? size : 1);
+    if (!*log) {
+        fprintf(stderr, "Error allocating memory for the archived log\n");
+        free(buffer);
+        return -1;
+    }
+    size_t position = 0;
+    int rc = 0;
+    while (rc == 0 && depth > 0) {
+        rc = read_record(archive, chain[--depth], end, &buffer, &capacity, &view);
+        for (uint32_t i = 0; rc == 0 && i < view.header.chunk_count; i++) {
+            ArchiveChunkRef ref = record_ref(&view, i);
+            rc = position + ref.size <= size ? read_exact(archive->chunk_fd, *log + position, ref.size, ref.offset)
+                                             : -1;
+            position += ref.size;
+        }
+    }
+    free(buffer);
+    if (rc != 0 || position != size) {
+        fprintf(stderr, "Archived record %llu does not hold its whole log\n", (unsigned long long)record_id);
+        free(*log);
+        *log = NULL;
+        return -1;
+    }
+    *log_size = size;
+    return 0;
+}
+
+int event_archive_scan(EventArchive *archive, ArchiveRecordVisitor visitor, void *context) {
+    ArchiveRecordView view;
+    ArchiveRecord record;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    if (!archive || !visitor) {
+        return -1;
+    }
+    pthread_mutex_lock(&archive->lock);
+    uint64_t end = archive->record_end;
+    pthread_mutex_unlock(&archive->lock);
+
+    int rc = 0;
+    for (uint64_t offset = 0; offset < end; offset += view.header.size) {
+        if (read_record(archive, offset, end, &buffer, &capacity, &view) != 0) {
+            rc = -1;
+            break;
+        }
+        record_from_view(&view, offset, &record);
+        if (visitor(&record, context) != 0) {
+            break;
+        }
+    }
+    free(buffer);
+    return rc;
+}
+
+int64_t event_archive_find_digest(EventArchive *archive, TPM2_ALG_ID alg, const uint8_t *digest, size_t digest_size,
+                                  ArchiveRecordVisitor visitor, void *context) {
+    ArchiveIdSet chunks;
+    ArchiveIdSet matches;
+    ArchiveRecordView view;
+    ArchiveRecord record;
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    if (!archive || !digest || digest_size == 0 || digest_size > sizeof(TPMU_HA) || !visitor) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    uint64_t end = archive->record_end;
+    const ArchiveDigestNode *node = digest_find(archive, alg, digest, (uint16_t)digest_size);
+    int rc = id_set_init(&chunks, node ? node->chunk_count : 0);
+    for (size_t i = 0; rc == 0 && node && i < node->chunk_count; i++) {
+        rc = id_set_add(&chunks, node->chunks[i]);
+    }
+    pthread_mutex_unlock(&archive->lock);
+    if (rc != 0) {
+        free(chunks.slots);
+        return -1;
+    }
+    if (chunks.count == 0 || id_set_init(&matches, 0) != 0) {
+        free(chunks.slots);
+        return chunks.count == 0 ? 0 : -1;
+    }
+
+    // Parents come before their children, so one pass sees a parent's match before the child
+    int64_t visited = 0;
+    bool stopped = false;
+    for (uint64_t offset = 0; !stopped && offset < end; offset += view.header.size) {
+        if (read_record(archive, offset, end, &buffer, &capacity, &view) != 0) {
+            visited = -1;
+            break;
+        }
+        bool match = view.header.parent != EVENT_ARCHIVE_NONE && id_set_contains(&matches, view.header.parent);
+        for (uint32_t i = 0; !match && i < view.header.chunk_count; i++) {
+            match = id_set_contains(&chunks, record_ref(&view, i).offset);
+        }
+        if (!match) {
+            continue;
+        }
+        if (id_set_add(&matches, offset) != 0) {
+            visited = -1;
+            break;
+        }
+        record_from_view(&view, offset, &record);
+        visited++;
+        stopped = visitor(&record, context) != 0;
+    }
+    free(buffer);
+    free(chunks.slots);
+    free(matches.slots);
+    return visited;
+}
+
+void event_archive_get_stats(EventArchive *archive, ArchiveStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!archive) {
+        return;
+    }
+    pthread_mutex_lock(&archive->lock);
+    stats->records = archive->record_count;
+    stats->appended = archive->appended;
+    stats->chunks = archive->chunk_count;
+    stats->digests = archive->digest_count;
+    stats->log_bytes = archive->log_bytes;
+    stats->chunk_bytes = archive->chunk_bytes;
+    stats->stored_bytes = archive->chunk_end + archive->digest_end + archive->record_end;
+    pthread_mutex_unlock(&archive->lock);
+}
@@ -0,0 +1,332 @@
+// log_pipeline.c
+// Parallel verification of a single large event log: RIM matching of log chunks and replay of independent per-PCR
+// extend chains run as tasks on a pool, overlapping the scan of the log, and merge into one ordered result.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "log_pipeline.h"
+#include "work_pool.h"
+
+#define PIPELINE_MIN_RECORD_SIZE 16     // TCG_PCR_EVENT2 without digests or event data
+
+struct LogPipeline {
+    WorkPool *pool;
+    size_t helpers;                 // Helper tasks submitted per verification
+    size_t min_log_size;
+};
+
+typedef struct {
+    size_t offset;                  // Offset of the chunk's first record
+    size_t record_num;              // Records before it
+    size_t count;                   // Records in the chunk; SIZE_MAX runs to the end of the log
+} RimChunk;
+
+typedef struct {
+    uint32_t bank;                  // Bank index in the replayed set
+    uint32_t pcr_mask;              // PCRs replayed by the task
+    size_t length;                  // Extends in the task, to start the longest first
+} ReplayChain;
+
+/**
+ * @struct PipelineJob
+ * @brief One verification shared by the calling thread and its helper tasks.
+ *
+ * Everything below the lock is guarded by it. The job is freed by whichever of the caller and the helpers lets go
+ * of it last; a helper that starts after the verification ended finds nothing to do and only drops its reference.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int refs;
+    bool producing;                 // The caller may still publish tasks
+    size_t running;                 // Tasks claimed and not finished
+    RimChunk *chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t next_chunk;
+    ReplayChain chains[TCG_MAX_DIGEST_BANKS * TPM_PCR_COUNT];
+    size_t chain_count;
+    size_t next_chain;
+    bool rim_failed;
+    bool replay_failed;
+
+    // Read-only while tasks run
+    TCG_EventLogCursor cursor;      // Initialized over the log, for chunks to seek from
+    const RIM_Index *rim_index;
+    RIM_CheckReport *reports;       // Partial report of each chunk, or NULL if the caller wants none
+    EventDetail detail;
+    PCR_BankSet *replayed;
+    PCR_ReplaySchedule schedule;
+} PipelineJob;
+
+static void job_release(PipelineJob *job) {
+    pthread_mutex_lock(&job->lock);
+    bool last = --job->refs == 0;
+    pthread_mutex_unlock(&job->lock);
+    if (!last) {
+        return;
+    }
+
+    if (job->reports) {
+        for (size_t i = 0; i < job->chunk_count; i++) {
+            rim_check_report_free(&job->reports[i]);
+        }
+    }
+    pcr_replay_schedule_free(&job->schedule);
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->cond);
+    free(job->reports);
+    free(job->chunks);
+    free(job);
+}
+
+static bool run_rim_chunk(PipelineJob *job, size_t index) {
+    const RimChunk *chunk = &job->chunks[index];
+    TCG_EventLogCursor cursor = job->cursor;
+    if (tcg_log_cursor_seek(&cursor, chunk->offset, chunk->record_num) != TCG_LOG_OK) {
+        return false;
+    }
+    RIM_CheckReport *report = NULL;
+    if (job->reports) {
+        report = &job->reports[index];
+        rim_check_report_reset(report, job->detail);
+    }
+    return process_event_log_range(&cursor, job->rim_index, chunk->count, report);
+}
+
+/**
+ * @brief Runs tasks until none are left and the caller has stopped publishing. Replay chains go first: the longest
+ * chain bounds the verification, while chunks can fill in around it.
+ */
+static void job_work(PipelineJob *job) {
+    pthread_mutex_lock(&job->lock);
+    for (;;) {
+        if (job->next_chain < job->chain_count) {
+            ReplayChain chain = job->chains[job->next_chain++];
+            job->running++;
+            pthread_mutex_unlock(&job->lock);
+            bool ok = pcr_replay_schedule_run(job->replayed, &job->schedule, chain.bank, chain.pcr_mask) == 0;
+            pthread_mutex_lock(&job->lock);
+            job->replay_failed |= !ok;
+        } else if (job->next_chunk < job->chunk_count) {
+            size_t index = job->next_chunk++;
+            job->running++;
+            pthread_mutex_unlock(&job->lock);
+            bool ok = run_rim_chunk(job, index);
+            pthread_mutex_lock(&job->lock);
+            job->rim_failed |= !ok;
+        } else if (job->producing) {
+            pthread_cond_wait(&job->cond, &job->lock);
+            continue;
+        } else {
+            break;
+        }
+        if (--job->running == 0 && !job->producing) {
+            pthread_cond_broadcast(&job->cond);
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void helper_task(void *arg) {
+    PipelineJob *job = arg;
+    job_work(job);
+    job_release(job);
+}
+
+static void publish_chunk(PipelineJob *job, size_t offset, size_t record_num, size_t count) {
+    pthread_mutex_lock(&job->lock);
+    job->chunks[job->chunk_count++] = (RimChunk){ .offset = offset, .record_num = record_num, .count = count };
+    pthread_cond_signal(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * @brief Walks the log once, publishing a RIM chunk every LOG_PIPELINE_CHUNK_EVENTS records.
+ *
+ * @return Returns 0 on success, or -1 on a malformed log.
+ */
+static int cut_chunks(PipelineJob *job) {
+    TCG_EventLogCursor scan = job->cursor;
+    TCG_EventView event;
+    TCG_LogStatus status;
+    size_t start_offset = scan.offset;
+    size_t start_record = scan.record_num;
+    size_t in_chunk = 0;
+    bool last_chunk = false;
+
+    while ((status = tcg_log_cursor_next(&scan, &event)) == TCG_LOG_OK) {
+        if (++in_chunk < LOG_PIPELINE_CHUNK_EVENTS || last_chunk) {
+            continue;
+        }
+        // The capacity covers the densest possible log; the last slot takes whatever remains regardless.
+        last_chunk = job->chunk_count + 2 == job->chunk_capacity;
+        publish_chunk(job, start_offset, start_record, last_chunk ? SIZE_MAX : in_chunk);
+        start_offset = scan.offset;
+        start_record = scan.record_num;
+        in_chunk = 0;
+    }
+    if (status != TCG_LOG_END) {
+        fprintf(stderr, "Event %zu at offset %zu: %s\n", scan.record_num + 1, scan.offset,
+                tcg_log_status_str(status));
+        return -1;
+    }
+    if (in_chunk > 0 && !last_chunk) {
+        publish_chunk(job, start_offset, start_record, in_chunk);
+    }
+    return 0;
+}
+
+static int compare_chain_length(const void *a, const void *b) {
+    size_t x = ((const ReplayChain *)a)->length;
+    size_t y = ((const ReplayChain *)b)->length;
+    return x > y ? -1 : x < y;
+}
+
+/**
+ * @brief Groups the log's digests into chains and publishes a replay task per (bank, PCR) chain.
+ *
+ * The multi-buffer SHA-256 kernel already replays eight chains at once on one thread, so when it is the kernel in
+ * use the SHA-256 bank stays a single task.
+ */
+static int publish_chains(PipelineJob *job) {
+    TCG_EventLogCursor cursor = job->cursor;
+    if (pcr_replay_init(job->replayed, &cursor) != 0 ||
+        pcr_replay_schedule(job->replayed, &cursor, &job->schedule) != 0) {
+        return -1;
+    }
+
+    const PCR_ReplaySchedule *schedule = &job->schedule;
+    ReplayChain chains[TCG_MAX_DIGEST_BANKS * TPM_PCR_COUNT];
+    size_t count = 0;
+    for (uint32_t b = 0; b < job->replayed->bank_count; b++) {
+        if (job->replayed->banks[b].alg == TPM2_ALG_SHA256 && pcr_sha256_kernel() == PCR_SHA256_KERNEL_AVX2) {
+            chains[count++] = (ReplayChain){ .bank = b, .pcr_mask = PCR_ALL_PCRS, .length = schedule->event_count };
+            continue;
+        }
+        for (uint32_t pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+            size_t length = schedule->start[pcr + 1] - schedule->start[pcr];
+            if (length > 0) {
+                chains[count++] = (ReplayChain){ .bank = b, .pcr_mask = 1u << pcr, .length = length };
+            }
+        }
+    }
+    qsort(chains, count, sizeof(chains[0]), compare_chain_length);
+
+    pthread_mutex_lock(&job->lock);
+    memcpy(job->chains, chains, count * sizeof(chains[0]));
+    job->chain_count = count;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+    return 0;
+}
+
+LogPipeline *log_pipeline_create(size_t num_workers, size_t min_log_size) {
+    LogPipeline *pipeline = calloc(1, sizeof(*pipeline));
+    if (!pipeline) {
+        fprintf(stderr, "Error allocating memory for log pipeline\n");
+        return NULL;
+    }
+    pipeline->pool = work_pool_create(num_workers);
+    if (!pipeline->pool) {
+        free(pipeline);
+        return NULL;
+    }
+    pipeline->helpers = work_pool_worker_count(pipeline->pool);
+    pipeline->min_log_size = min_log_size ? min_log_size : LOG_PIPELINE_DEFAULT_MIN_LOG_SIZE;
+    return pipeline;
+}
+
+void log_pipeline_destroy(LogPipeline *pipeline) {
+    if (!pipeline) {
+        return;
+    }
+    work_pool_destroy(pipeline->pool);
+    free(pipeline);
+}
+
+bool log_pipeline_accepts(const LogPipeline *pipeline, size_t log_size) {
+    return pipeline && log_size >= pipeline->min_log_size;
+}
+
+int log_pipeline_verify(LogPipeline *pipeline, const uint8_t *event_log, size_t log_size, const RIM_Index *rim_index,
+                        PCR_BankSet *replayed, RIM_CheckReport *report, bool *rim_accepted) {
+    if (!pipeline || !event_log || log_size == 0 || !rim_index || !replayed || !rim_accepted) {
+        fprintf(stderr, "Log pipeline verification failed: Invalid input\n");
+        return -1;
+    }
+
+    PipelineJob *job = calloc(1, sizeof(*job));
+    if (!job) {
+        fprintf(stderr, "Error allocating memory for log pipeline job\n");
+        return -1;
+    }
+    TCG_LogStatus status = tcg_log_cursor_init(&job->cursor, event_log, log_size);
+    if (status != TCG_LOG_OK) {
+        fprintf(stderr, "Invalid event log header: %s\n", tcg_log_status_str(status));
+        free(job);
+        return -1;
+    }
+    job->chunk_capacity = log_size / (PIPELINE_MIN_RECORD_SIZE * LOG_PIPELINE_CHUNK_EVENTS) + 2;
+    job->chunks = malloc(job->chunk_capacity * sizeof(*job->chunks));
+    job->reports = report ? calloc(job->chunk_capacity, sizeof(*job->reports)) : NULL;
+    if (!job->chunks || (report && !job->reports)) {
+        fprintf(stderr, "Error allocating memory for log pipeline chunks\n");
+        free(job->chunks);
+        free(job->reports);
+        free(job);
+        return -1;
+    }
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->cond, NULL);
+    job->refs = 1;
+    job->producing = true;
+    job->rim_index = rim_index;
+    job->detail = report ? report->detail : EVENT_DETAIL_NONE;
+    job->replayed = replayed;
+
+    for (size_t i = 0; i < pipeline->helpers; i++) {
+        pthread_mutex_lock(&job->lock);
+        job->refs++;
+        pthread_mutex_unlock(&job->lock);
+        if (work_pool_submit(pipeline->pool, helper_task, job) != 0) {
+            job_release(job);
+            break;
+        }
+    }
+
+    int rc = cut_chunks(job) == 0 && publish_chains(job) == 0 ? 0 : -1;
+
+    pthread_mutex_lock(&job->lock);
+    if (rc != 0) {
+        // Nothing is verified on a malformed log; drop what has not started.
+        job->next_chunk = job->chunk_count;
+        job->next_chain = job->chain_count;
+    }
+    job->producing = false;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+
+    job_work(job);
+    pthread_mutex_lock(&job->lock);
+    while (job->running > 0) {
+        pthread_cond_wait(&job->cond, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    if (rc == 0 && job->replay_failed) {
+        fprintf(stderr, "Error replaying event log chains\n");
+        rc = -1;
+    }
+    *rim_accepted = rc == 0 && !job->rim_failed;
+    if (rc == 0 && report) {
+        for (size_t i = 0; i < job->chunk_count; i++) {
+            rim_check_report_merge(report, &job->reports[i]);
+        }
+    }
+    job_release(job);
+    return rc;
+}
@@ -0,0 +1,606 @@
+// quote.c
+// TPM2_Quote verification against a cache of pre-validated attestation keys. Keys are decoded, checked and
+// certified once at enrolment; each quote then costs a hash lookup, one digest and one signature verification.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/ecdsa.h>
+#include <openssl/evp.h>
+#include <openssl/param_build.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509.h>
+#include <tss2/tss2_mu.h>
+#include "quote.h"
+#include "verifier_metrics.h"
+
+#define AK_CACHE_BUCKETS 256
+#define AK_REQUIRED_ATTRIBUTES (TPMA_OBJECT_FIXEDTPM | TPMA_OBJECT_RESTRICTED | TPMA_OBJECT_SIGN_ENCRYPT)
+#define QUOTE_MAX_DER_SIGNATURE 160
+
+// Structures
+
+typedef struct AK_Entry {
+    struct AK_Entry *next;
+    TPM2B_NAME name;                /**< Qualified name: nameAlg || H(parent qualified name || name) */
+    TPM2_ALG_ID type;               /**< TPM2_ALG_RSA or TPM2_ALG_ECC */
+    EVP_PKEY *pkey;
+} AK_Entry;
+
+struct AK_Cache {
+    pthread_rwlock_t lock;
+    X509_STORE *ca_store;           /**< NULL if keys are trusted as enrolled */
+    AK_Entry *buckets[AK_CACHE_BUCKETS];
+    size_t count;
+};
+
+// Algorithms
+
+static const EVP_MD *md_for_alg(TPM2_ALG_ID alg) {
+    switch (alg) {
+        case TPM2_ALG_SHA1:   return EVP_sha1();
+        case TPM2_ALG_SHA256: return EVP_sha256();
+        case TPM2_ALG_SHA384: return EVP_sha384();
+        case TPM2_ALG_SHA512: return EVP_sha512();
+        default:              return NULL;
+    }
+}
+
+/**
+ * @brief Returns the hash algorithm of a signature, or TPM2_ALG_NULL for unsupported schemes.
+ */
+static TPM2_ALG_ID signature_hash_alg(const TPMT_SIGNATURE *signature) {
+    switch (signature->sigAlg) {
+        case TPM2_ALG_RSASSA: return signature->signature.rsassa.hash;
+        case TPM2_ALG_RSAPSS: return signature->signature.rsapss.hash;
+        case TPM2_ALG_ECDSA:  return signature->signature.ecdsa.hash;
+        default:              return TPM2_ALG_NULL;
+    }
+}
+
+/**
+ * @brief Returns the digest for a signature hash algorithm. SHA-1 is not accepted for signatures.
+ */
+static const EVP_MD *signature_md(const TPMT_SIGNATURE *signature) {
+    TPM2_ALG_ID alg = signature_hash_alg(signature);
+    return alg == TPM2_ALG_SHA1 ? NULL : md_for_alg(alg);
+}
+
+// Key decoding
+
+static EVP_PKEY *pkey_from_params(const char *type, OSSL_PARAM_BLD *builder) {
+    EVP_PKEY *pkey = NULL;
+    OSSL_PARAM *params = OSSL_PARAM_BLD_to_param(builder);
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(NULL, type, NULL);
+    if (!params || !ctx || EVP_PKEY_fromdata_init(ctx) <= 0 ||
+        EVP_PKEY_fromdata(ctx, &pkey, EVP_PKEY_PUBLIC_KEY, params) <= 0) {
+        pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    OSSL_PARAM_free(params);
+    return pkey;
+}
+
+static EVP_PKEY *decode_rsa_key(const TPMT_PUBLIC *public_area) {
+    const TPMS_RSA_PARMS *parms = &public_area->parameters.rsaDetail;
+    const TPM2B_PUBLIC_KEY_RSA *modulus = &public_area->unique.rsa;
+    if (parms->keyBits < AK_CACHE_MIN_RSA_BITS || (size_t)modulus->size * 8 != parms->keyBits) {
+        fprintf(stderr, "RSA attestation key must have at least %d bits\n", AK_CACHE_MIN_RSA_BITS);
+        return NULL;
+    }
+
+    EVP_PKEY *pkey = NULL;
+    OSSL_PARAM_BLD *builder = OSSL_PARAM_BLD_new();
+    BIGNUM *n = BN_bin2bn(modulus->buffer, modulus->size, NULL);
+    BIGNUM *e = BN_new();
+    // An exponent of zero stands for the default exponent 2^16 + 1.
+    if (builder && n && e && BN_set_word(e, parms->exponent ? parms->exponent : 65537) &&
+        OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_N, n) &&
+        OSSL_PARAM_BLD_push_BN(builder, OSSL_PKEY_PARAM_RSA_E, e)) {
+        pkey = pkey_from_params("RSA", builder);
+    }
+    BN_free(n);
+    BN_free(e);
+    OSSL_PARAM_BLD_free(builder);
+    return pkey;
+}
+
+static EVP_PKEY *decode_ecc_key(const TPMT_PUBLIC *public_area) {
+    const TPMS_ECC_POINT *point = &public_area->unique.ecc;
+    const char *group;
+    size_t field_size;
+    switch (public_area->parameters.eccDetail.curveID) {
+        case TPM2_ECC_NIST_P256: group = "P-256"; field_size = 32; break;
+        case TPM2_ECC_NIST_P384: group = "P-384"; field_size = 48; break;
+        default:
+            fprintf(stderr, "ECC attestation key must be on NIST P-256 or P-384\n");
+            return NULL;
+    }
+    if (point->x.size > field_size || point->y.size > field_size) {
+        return NULL;
+    }
+
+    // Uncompressed point: 0x04 || x || y, coordinates left-padded to the field size.
+    uint8_t encoded[1 + 2 * 48] = { 0x04 };
+    memcpy(encoded + 1 + field_size - point->x.size, point->x.buffer, point->x.size);
+    memcpy(encoded + 1 + 2 * field_size - point->y.size, point->y.buffer, point->y.size);
+
+    EVP_PKEY *pkey = NULL;
+    OSSL_PARAM_BLD *builder = OSSL_PARAM_BLD_new();
+    if (builder && OSSL_PARAM_BLD_push_utf8_string(builder, OSSL_PKEY_PARAM_GROUP_NAME, group, 0) &&
+        OSSL_PARAM_BLD_push_octet_string(builder, OSSL_PKEY_PARAM_PUB_KEY, encoded, 1 + 2 * field_size)) {
+        pkey = pkey_from_params("EC", builder);
+    }
+    OSSL_PARAM_BLD_free(builder);
+
+    // Reject points that are not on the curve now rather than on every verification.
+    EVP_PKEY_CTX *check = pkey ? EVP_PKEY_CTX_new(pkey, NULL) : NULL;
+    if (pkey && (!check || EVP_PKEY_public_check(check) != 1)) {
+        fprintf(stderr, "ECC attestation key is not a valid curve point\n");
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(check);
+    return pkey;
+}
+
+/**
+ * @brief Checks that a certificate chains to the CA bundle and certifies the key.
+ */
+static int check_certificate(const AK_Cache *cache, const char *cert_file, EVP_PKEY *pkey) {
+    FILE *file = fopen(cert_file, "r");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", cert_file);
+        return -1;
+    }
+    X509 *cert = PEM_read_X509(file, NULL, NULL, NULL);
+    fclose(file);
+    if (!cert) {
+        fprintf(stderr, "Error reading attestation key certificate: %s\n", cert_file);
+        return -1;
+    }
+
+    int rc = -1;
+    if (EVP_PKEY_eq(X509_get0_pubkey(cert), pkey) != 1) {
+        fprintf(stderr, "Certificate %s does not certify the attestation key\n", cert_file);
+    } else if (!cache->ca_store) {
+        rc = 0;
+    } else {
+        X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+        if (ctx && X509_STORE_CTX_init(ctx, cache->ca_store, cert, NULL) == 1 && X509_verify_cert(ctx) == 1) {
+            rc = 0;
+        } else {
+            fprintf(stderr, "Attestation key certificate %s does not chain to a trusted CA: %s\n", cert_file,
+                    ctx ? X509_verify_cert_error_string(X509_STORE_CTX_get_error(ctx)) : "out of memory");
+        }
+        X509_STORE_CTX_free(ctx);
+    }
+    X509_free(cert);
+    return rc;
+}
+
+// Cache
+
+static uint32_t hash_name(const TPM2B_NAME *name) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < name->size; i++) {
+        hash = (hash ^ name->name[i]) * 16777619u;
+    }
+    return hash % AK_CACHE_BUCKETS;
+}
+
+static const AK_Entry *ak_cache_lookup(const AK_Cache *cache, const TPM2B_NAME *name) {
+    const AK_Entry *found = NULL;
+    pthread_rwlock_rdlock((pthread_rwlock_t *)&cache->lock);
+    for (const AK_Entry *entry = cache->buckets[hash_name(name)]; entry; entry = entry->next) {
+        if (entry->name.size == name->size && memcmp(entry->name.name, name->name, name->size) == 0) {
+            found = entry;
+            break;
+        }
+    }
+    pthread_rwlock_unlock((pthread_rwlock_t *)&cache->lock);
+    // Entries are never removed before the cache is destroyed, so the pointer stays valid after unlocking.
+    return found;
+}
+
+AK_Cache *ak_cache_create(const char *ca_file) {
+    AK_Cache *cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        fprintf(stderr, "Error allocating memory for attestation key cache\n");
+        return NULL;
+    }
+    if (ca_file) {
+        cache->ca_store = X509_STORE_new();
+        if (!cache->ca_store || X509_STORE_load_file(cache->ca_store, ca_file) != 1) {
+            fprintf(stderr, "Error loading CA bundle: %s\n", ca_file);
+            X509_STORE_free(cache->ca_store);
+            free(cache);
+            return NULL;
+        }
+    }
+    pthread_rwlock_init(&cache->lock, NULL);
+    return cache;
+}
+
+void ak_cache_destroy(AK_Cache *cache) {
+    if (!cache) {
+        return;
+    }
+    for (size_t i = 0; i < AK_CACHE_BUCKETS; i++) {
+        AK_Entry *entry = cache->buckets[i];
+        while (entry) {
+            AK_Entry *next = entry->next;
+            EVP_PKEY_free(entry->pkey);
+            free(entry);
+            entry = next;
+        }
+    }
+    X509_STORE_free(cache->ca_store);
+    pthread_rwlock_destroy(&cache->lock);
+    free(cache);
+}
+
+int ak_cache_add(AK_Cache *cache, const uint8_t *public_blob, size_t public_size, const TPM2B_NAME *parent,
+                 const char *cert_file) {
+    TPM2B_PUBLIC public_key;
+    size_t offset = 0;
+    if (!cache || !public_blob ||
+        Tss2_MU_TPM2B_PUBLIC_Unmarshal(public_blob, public_size, &offset, &public_key) != TSS2_RC_SUCCESS ||
+        offset != public_size) {
+        fprintf(stderr, "Malformed attestation key\n");
+        return -1;
+    }
+    const TPMT_PUBLIC *public_area = &public_key.publicArea;
+
+    if ((public_area->objectAttributes & AK_REQUIRED_ATTRIBUTES) != AK_REQUIRED_ATTRIBUTES ||
+        (public_area->objectAttributes & TPMA_OBJECT_DECRYPT)) {
+        fprintf(stderr, "Key is not a restricted fixedTPM signing key\n");
+        return -1;
+    }
+    const EVP_MD *name_md = md_for_alg(public_area->nameAlg);
+    if (!name_md) {
+        fprintf(stderr, "Unsupported attestation key name algorithm 0x%04x\n", public_area->nameAlg);
+        return -1;
+    }
+    if (parent && (parent->size < sizeof(TPM2_HANDLE) || parent->size > sizeof(parent->name))) {
+        fprintf(stderr, "Malformed qualified name of the attestation key's parent\n");
+        return -1;
+    }
+    if (!cert_file && cache->ca_store) {
+        fprintf(stderr, "Attestation key has no certificate\n");
+        return -1;
+    }
+
+    AK_Entry *entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        fprintf(stderr, "Error allocating memory for attestation key\n");
+        return -1;
+    }
+    entry->type = public_area->type;
+    if (public_area->type == TPM2_ALG_RSA) {
+        entry->pkey = decode_rsa_key(public_area);
+    } else if (public_area->type == TPM2_ALG_ECC) {
+        entry->pkey = decode_ecc_key(public_area);
+    } else {
+        fprintf(stderr, "Unsupported attestation key type 0x%04x\n", public_area->type);
+    }
+
+    // Quotes name their signer by qualified name, so that is the key the entry is found by. The name hashes the
+    // TPMT_PUBLIC exactly as marshaled, which is the blob after its size field; the qualified name then hashes the
+    // parent's qualified name with it (TPM 2.0 Part 1, 16.6). A hierarchy's qualified name is its handle.
+    static const uint8_t endorsement[sizeof(TPM2_HANDLE)] = {
+        (uint8_t)(TPM2_RH_ENDORSEMENT >> 24), (uint8_t)(TPM2_RH_ENDORSEMENT >> 16),
+        (uint8_t)(TPM2_RH_ENDORSEMENT >> 8), (uint8_t)TPM2_RH_ENDORSEMENT,
+    };
+    const uint8_t *parent_data = parent ? parent->name : endorsement;
+    size_t parent_size = parent ? parent->size : sizeof(endorsement);
+    TPM2B_NAME name = { 0 };
+    unsigned int digest_size = 0;
+    name.name[0] = entry->name.name[0] = (uint8_t)(public_area->nameAlg >> 8);
+    name.name[1] = entry->name.name[1] = (uint8_t)public_area->nameAlg;
+    EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+    bool named = md_ctx &&
+                 EVP_Digest(public_blob + sizeof(UINT16), public_size - sizeof(UINT16), name.name + 2, &digest_size,
+                            name_md, NULL) == 1 &&
+                 EVP_DigestInit_ex(md_ctx, name_md, NULL) == 1 &&
+                 EVP_DigestUpdate(md_ctx, parent_data, parent_size) == 1 &&
+                 EVP_DigestUpdate(md_ctx, name.name, 2 + digest_size) == 1 &&
+                 EVP_DigestFinal_ex(md_ctx, entry->name.name + 2, &digest_size) == 1;
+    EVP_MD_CTX_free(md_ctx);
+    if (!entry->pkey || !named || (cert_file && check_certificate(cache, cert_file, entry->pkey) != 0)) {
+        EVP_PKEY_free(entry->pkey);
+        free(entry);
+        return -1;
+    }
+    entry->name.size = (UINT16)(2 + digest_size);
+
+    pthread_rwlock_wrlock(&cache->lock);
+    uint32_t bucket = hash_name(&entry->name);
+    bool duplicate = false;
+    for (const AK_Entry *existing = cache->buckets[bucket]; existing; existing = existing->next) {
+        duplicate |= existing->name.size == entry->name.size &&
+                     memcmp(existing->name.name, entry->name.name, entry->name.size) == 0;
+    }
+    if (!duplicate) {
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+        cache->count++;
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    if (duplicate) {
+        EVP_PKEY_free(entry->pkey);
+        free(entry);
+    }
+    return 0;
+}
+
+int ak_cache_add_file(AK_Cache *cache, const char *public_file, const char *parent_file, const char *cert_file) {
+    FILE *file = fopen(public_file, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", public_file);
+        return -1;
+    }
+    uint8_t blob[sizeof(TPM2B_PUBLIC)];
+    size_t size = fread(blob, 1, sizeof(blob), file);
+    fclose(file);
+
+    TPM2B_NAME parent = { 0 };
+    if (parent_file) {
+        file = fopen(parent_file, "rb");
+        if (!file) {
+            fprintf(stderr, "Error opening file: %s\n", parent_file);
+            return -1;
+        }
+        // One byte more than fits, so that an oversized file is rejected rather than truncated
+        uint8_t name[sizeof(parent.name) + 1];
+        size_t name_size = fread(name, 1, sizeof(name), file);
+        fclose(file);
+        if (name_size > sizeof(parent.name)) {
+            fprintf(stderr, "Malformed qualified name of the attestation key's parent\n");
+            return -1;
+        }
+        memcpy(parent.name, name, name_size);
+        parent.size = (UINT16)name_size;
+    }
+    return ak_cache_add(cache, blob, size, parent_file ? &parent : NULL, cert_file);
+}
+
+size_t ak_cache_count(const AK_Cache *cache) {
+    if (!cache) {
+        return 0;
+    }
+    pthread_rwlock_rdlock((pthread_rwlock_t *)&cache->lock);
+    size_t count = cache->count;
+    pthread_rwlock_unlock((pthread_rwlock_t *)&cache->lock);
+    return count;
+}
+
+// Quotes
+
+int quote_parse(const uint8_t *quote, size_t quote_size, TPM_Quote *parsed) {
+    TPM2B_ATTEST attest;
+    size_t offset = 0;
+    size_t attest_offset = 0;
+    if (!quote || !parsed ||
+        Tss2_MU_TPM2B_ATTEST_Unmarshal(quote, quote_size, &offset, &attest) != TSS2_RC_SUCCESS) {
+        return -1;
+    }
+    parsed->attest_data = quote + sizeof(UINT16);
+    parsed->attest_size = attest.size;
+    if (Tss2_MU_TPMS_ATTEST_Unmarshal(parsed->attest_data, parsed->attest_size, &attest_offset,
+                                      &parsed->attest) != TSS2_RC_SUCCESS ||
+        attest_offset != parsed->attest_size ||
+        Tss2_MU_TPMT_SIGNATURE_Unmarshal(quote, quote_size, &offset, &parsed->signature) != TSS2_RC_SUCCESS ||
+        offset != quote_size) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks everything about a quote except its signature, and finds its signing key.
+ */
+static const AK_Entry *check_quote_content(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce,
+                                           size_t nonce_size) {
+    const TPMS_ATTEST *attest = &quote->attest;
+    if (attest->magic != TPM2_GENERATED_VALUE || attest->type != TPM2_ST_ATTEST_QUOTE) {
+        fprintf(stderr, "Attestation structure is not a TPM quote\n");
+        return NULL;
+    }
+    if (!nonce || attest->extraData.size != nonce_size ||
+        CRYPTO_memcmp(attest->extraData.buffer, nonce, nonce_size) != 0) {
+        fprintf(stderr, "Quote does not carry the verifier's nonce\n");
+        return NULL;
+    }
+
+    const AK_Entry *key = ak_cache_lookup(cache, &attest->qualifiedSigner);
+    if (!key) {
+        fprintf(stderr, "Quote is signed by an unknown attestation key\n");
+        return NULL;
+    }
+    TPM2_ALG_ID sig_alg = quote->signature.sigAlg;
+    bool scheme_fits_key = key->type == TPM2_ALG_RSA ? (sig_alg == TPM2_ALG_RSASSA || sig_alg == TPM2_ALG_RSAPSS)
+                                                     : sig_alg == TPM2_ALG_ECDSA;
+    if (!scheme_fits_key || !signature_md(&quote->signature)) {
+        fprintf(stderr, "Unsupported quote signature scheme 0x%04x\n", sig_alg);
+        return NULL;
+    }
+    return key;
+}
+
+static EVP_PKEY_CTX *verify_ctx_new(const AK_Entry *key, const TPMT_SIGNATURE *signature) {
+    EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(key->pkey, NULL);
+    if (!ctx || EVP_PKEY_verify_init(ctx) <= 0 || EVP_PKEY_CTX_set_signature_md(ctx, signature_md(signature)) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        return NULL;
+    }
+    int padding_ok = 1;
+    if (signature->sigAlg == TPM2_ALG_RSASSA) {
+        padding_ok = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) > 0;
+    } else if (signature->sigAlg == TPM2_ALG_RSAPSS) {
+        // TPMs use either the digest size or the largest possible salt; the salt length is read from the signature.
+        padding_ok = EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) > 0 &&
+                     EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, RSA_PSS_SALTLEN_AUTO) > 0;
+    }
+    if (!padding_ok) {
+        EVP_PKEY_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/**
+ * @brief Encodes an ECDSA (r, s) pair as the DER structure OpenSSL verifies.
+ */
+static int encode_ecdsa_signature(const TPMS_SIGNATURE_ECC *ecdsa, uint8_t *der, size_t *der_size) {
+    ECDSA_SIG *sig = ECDSA_SIG_new();
+    BIGNUM *r = BN_bin2bn(ecdsa->signatureR.buffer, ecdsa->signatureR.size, NULL);
+    BIGNUM *s = BN_bin2bn(ecdsa->signatureS.buffer, ecdsa->signatureS.size, NULL);
+    if (!sig || !r || !s || ECDSA_SIG_set0(sig, r, s) != 1) {
+        BN_free(r);
+        BN_free(s);
+        ECDSA_SIG_free(sig);
+        return -1;
+    }
+    int len = i2d_ECDSA_SIG(sig, NULL);
+    if (len <= 0 || (size_t)len > *der_size) {
+        ECDSA_SIG_free(sig);
+        return -1;
+    }
+    uint8_t *out = der;
+    *der_size = (size_t)i2d_ECDSA_SIG(sig, &out);
+    ECDSA_SIG_free(sig);
+    return 0;
+}
+
+static int verify_with_ctx(EVP_PKEY_CTX *ctx, const TPM_Quote *quote) {
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size;
+    if (EVP_Digest(quote->attest_data, quote->attest_size, digest, &digest_size, signature_md(&quote->signature),
+                   NULL) != 1) {
+        return -1;
+    }
+
+    const TPMT_SIGNATURE *signature = &quote->signature;
+    const uint8_t *sig;
+    size_t sig_size;
+    uint8_t der[QUOTE_MAX_DER_SIGNATURE];
+    if (signature->sigAlg == TPM2_ALG_ECDSA) {
+        sig_size = sizeof(der);
+        if (encode_ecdsa_signature(&signature->signature.ecdsa, der, &sig_size) != 0) {
+            return -1;
+        }
+        sig = der;
+    } else {
+        const TPM2B_PUBLIC_KEY_RSA *rsa_sig = signature->sigAlg == TPM2_ALG_RSASSA ? &signature->signature.rsassa.sig
+                                                                                   : &signature->signature.rsapss.sig;
+        sig = rsa_sig->buffer;
+        sig_size = rsa_sig->size;
+    }
+    return EVP_PKEY_verify(ctx, sig, sig_size, digest, digest_size) == 1 ? 0 : -1;
+}
+
+/**
+ * @brief Verifies a quote; the nonce stage of the metrics started at nonce_start, before any proof was checked.
+ */
+static int verify_quote_from(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size,
+                             uint64_t nonce_start) {
+    const AK_Entry *key = check_quote_content(cache, quote, nonce, nonce_size);
+    verifier_metrics_stage_end(VERIFIER_STAGE_NONCE, nonce_start, key != NULL);
+    if (!key) {
+        return -1;
+    }
+
+    uint64_t signature_start = verifier_metrics_start();
+    EVP_PKEY_CTX *ctx = verify_ctx_new(key, &quote->signature);
+    int rc = ctx ? verify_with_ctx(ctx, quote) : -1;
+    EVP_PKEY_CTX_free(ctx);
+    verifier_metrics_stage_end(VERIFIER_STAGE_SIGNATURE, signature_start, rc == 0);
+    if (rc != 0) {
+        fprintf(stderr, "Quote signature is invalid\n");
+    }
+    return rc;
+}
+
+int quote_verify(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size) {
+    if (!cache || !quote) {
+        return -1;
+    }
+    return verify_quote_from(cache, quote, nonce, nonce_size, verifier_metrics_start());
+}
+
+int quote_verify_coalesced(const AK_Cache *cache, const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size,
+                           const NonceProof *proof) {
+    uint8_t root[NONCE_TREE_DIGEST_SIZE];
+    uint64_t nonce_start = verifier_metrics_start();
+    if (!proof || nonce_proof_root(nonce, nonce_size, proof, root) != 0) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_NONCE, nonce_start, false);
+        fprintf(stderr, "Nonce inclusion proof is malformed\n");
+        return -1;
+    }
+    if (!cache || !quote) {
+        return -1;
+    }
+    return verify_quote_from(cache, quote, root, sizeof(root), nonce_start);
+}
+
+int quote_check_pcr_digest(const TPM_Quote *quote, const PCR_BankSet *pcrs) {
+    const TPML_PCR_SELECTION *selection = &quote->attest.attested.quote.pcrSelect;
+    const TPM2B_DIGEST *expected = &quote->attest.attested.quote.pcrDigest;
+    const EVP_MD *md = signature_md(&quote->signature);
+    if (!md || selection->count == 0 || selection->count > TPM2_NUM_PCR_BANKS) {
+        fprintf(stderr, "Quote selects no PCR banks\n");
+        return -1;
+    }
+
+    // The attestor reports PCR values itself; only quoted PCRs vouch for the log, so it must quote all it extends
+    for (uint32_t b = 0; b < pcrs->bank_count; b++) {
+        uint32_t covered = 0;
+        for (uint32_t i = 0; i < selection->count; i++) {
+            const TPMS_PCR_SELECTION *bank_selection = &selection->pcrSelections[i];
+            for (uint32_t pcr = 0; bank_selection->hash == pcrs->banks[b].alg && pcr < TPM_PCR_COUNT &&
+                                   pcr < 8u * bank_selection->sizeofSelect && pcr / 8 < TPM2_PCR_SELECT_MAX; pcr++) {
+                if (bank_selection->pcrSelect[pcr / 8] & (1u << (pcr % 8))) {
+                    covered |= 1u << pcr;
+                }
+            }
+        }
+        if ((pcrs->extended_mask & ~covered) != 0) {
+            fprintf(stderr, "Quote does not cover every extended PCR of bank 0x%04x\n", pcrs->banks[b].alg);
+            return -1;
+        }
+    }
+
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    int ok = ctx && EVP_DigestInit_ex(ctx, md, NULL) == 1;
+    for (uint32_t i = 0; ok && i < selection->count; i++) {
+        const TPMS_PCR_SELECTION *bank_selection = &selection->pcrSelections[i];
+        const PCR_Bank *bank = pcr_bankset_find(pcrs, bank_selection->hash);
+        if (!bank || bank_selection->sizeofSelect > TPM2_PCR_SELECT_MAX) {
+            fprintf(stderr, "Quote covers bank 0x%04x, which the measurement log does not\n", bank_selection->hash);
+            ok = 0;
+            break;
+        }
+        for (uint32_t pcr = 0; ok && pcr < 8u * bank_selection->sizeofSelect; pcr++) {
+            if (!(bank_selection->pcrSelect[pcr / 8] & (1u << (pcr % 8)))) {
+                continue;
+            }
+            ok = pcr < TPM_PCR_COUNT &&
+                 EVP_DigestUpdate(ctx, bank->pcrs[pcr].buffer, bank->pcrs[pcr].size) == 1;
+        }
+    }
+
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    ok = ok && EVP_DigestFinal_ex(ctx, digest, &digest_size) == 1 && expected->size == digest_size &&
+         memcmp(expected->buffer, digest, digest_size) == 0;
+    EVP_MD_CTX_free(ctx);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,260 @@
+// rim_store.c
+// Hot-swappable RIM: the current version is published through an atomic pointer and replaced versions are freed
+// by epoch-based reclamation once no verification can still hold them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "rim_store.h"
+
+// Structures
+
+// A thread's announcement of the epoch it pinned the store in. Written only by the thread that holds it, and read
+// by reclaim; aligned so that no two readers write the same cache line.
+typedef struct RimReader {
+    atomic_uint_fast64_t epoch;     /**< Epoch announced while pinned, 0 when not */
+    atomic_bool in_use;             /**< Held by a live thread */
+    unsigned int depth;             /**< Nested pins; owner only */
+    const RimVersion *pinned;       /**< Version pinned; owner only */
+    struct RimReader *next;
+} __attribute__((aligned(64))) RimReader;
+
+typedef struct RimRetired {
+    RimVersion *version;
+    uint64_t epoch;                 /**< Epoch it was retired in: readers announcing it or later never saw it */
+    struct RimRetired *next;
+} RimRetired;
+
+struct RimStore {
+    _Atomic(RimVersion *) current;
+    atomic_uint_fast64_t epoch;
+    _Atomic(RimReader *) readers;
+    pthread_key_t reader_key;
+
+    pthread_mutex_t lock;           // Serializes publishing and reclaiming; readers never take it
+    RimRetired *retired;
+    uint64_t published;
+    uint64_t retired_count;
+    uint64_t reclaimed;
+};
+
+// Readers
+
+static void reader_release(void *reader) {
+    RimReader *slot = reader;
+    atomic_store(&slot->epoch, 0);
+    slot->depth = 0;
+    slot->pinned = NULL;
+    atomic_store(&slot->in_use, false);
+}
+
+/**
+ * @brief Returns the calling thread's reader slot, taking over the slot of an exited thread or adding a new one.
+ */
+static RimReader *thread_reader(RimStore *store) {
+    RimReader *reader = pthread_getspecific(store->reader_key);
+    if (reader) {
+        return reader;
+    }
+
+    for (reader = atomic_load(&store->readers); reader; reader = reader->next) {
+        bool idle = false;
+        if (atomic_compare_exchange_strong(&reader->in_use, &idle, true)) {
+            break;
+        }
+    }
+    if (!reader) {
+        reader = aligned_alloc(64, sizeof(*reader));
+        if (!reader) {
+            fprintf(stderr, "Error allocating memory for RIM reader\n");
+            return NULL;
+        }
+        memset(reader, 0, sizeof(*reader));
+        atomic_store(&reader->in_use, true);
+        reader->next = atomic_load(&store->readers);
+        while (!atomic_compare_exchange_weak(&store->readers, &reader->next, reader)) {
+        }
+    }
+    if (pthread_setspecific(store->reader_key, reader) != 0) {
+        atomic_store(&reader->in_use, false);
+        return NULL;
+    }
+    return reader;
+}
+
+const RimVersion *rim_store_pin(RimStore *store) {
+    RimReader *reader = store ? thread_reader(store) : NULL;
+    if (!reader) {
+        return NULL;
+    }
+    if (reader->depth > 0) {
+        reader->depth++;
+        return reader->pinned;
+    }
+
+    // Announce before loading: a publisher that swaps the pointer after this sees the announcement when it
+    // reclaims, and one that swapped it before has already made the new version visible to the load.
+    atomic_store(&reader->epoch, atomic_load(&store->epoch));
+    RimVersion *version = atomic_load(&store->current);
+    if (!version) {
+        atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+        return NULL;
+    }
+    reader->depth = 1;
+    reader->pinned = version;
+    return version;
+}
+
+void rim_store_unpin(RimStore *store) {
+    RimReader *reader = pthread_getspecific(store->reader_key);
+    if (!reader || reader->depth == 0) {
+        return;
+    }
+    if (--reader->depth == 0) {
+        reader->pinned = NULL;
+        atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+    }
+}
+
+// Publishing
+
+static void version_free(RimVersion *version) {
+    rim_index_free(&version->index);
+    free(version);
+}
+
+RimStore *rim_store_create(void) {
+    RimStore *store = calloc(1, sizeof(*store));
+    if (!store) {
+        fprintf(stderr, "Error allocating memory for RIM store\n");
+        return NULL;
+    }
+    if (pthread_key_create(&store->reader_key, reader_release) != 0) {
+        fprintf(stderr, "Error creating RIM store reader key\n");
+        free(store);
+        return NULL;
+    }
+    pthread_mutex_init(&store->lock, NULL);
+    atomic_init(&store->current, NULL);
+    atomic_init(&store->epoch, 1);
+    atomic_init(&store->readers, NULL);
+    return store;
+}
+
+void rim_store_destroy(RimStore *store) {
+    if (!store) {
+        return;
+    }
+    pthread_key_delete(store->reader_key);
+    RimVersion *current = atomic_load(&store->current);
+    if (current) {
+        version_free(current);
+    }
+    while (store->retired) {
+        RimRetired *next = store->retired->next;
+        version_free(store->retired->version);
+        free(store->retired);
+        store->retired = next;
+    }
+    RimReader *reader = atomic_load(&store->readers);
+    while (reader) {
+        RimReader *next = reader->next;
+        free(reader);
+        reader = next;
+    }
+    pthread_mutex_destroy(&store->lock);
+    free(store);
+}
+
+int rim_store_publish(RimStore *store, RIM_Index *index, uint64_t serial, uint64_t *version) {
+    struct timespec now;
+    if (!store || !index) {
+        fprintf(stderr, "RIM publish failed: Invalid input\n");
+        return -1;
+    }
+    RimVersion *published = malloc(sizeof(*published));
+    RimRetired *retired = malloc(sizeof(*retired));
+    if (!published || !retired) {
+        fprintf(stderr, "Error allocating memory for RIM version\n");
+        free(published);
+        free(retired);
+        return -1;
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    published->index = *index;
+    published->serial = serial;
+    published->published_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    memset(index, 0, sizeof(*index));
+
+    pthread_mutex_lock(&store->lock);
+    published->version = ++store->published;
+    RimVersion *old = atomic_exchange(&store->current, published);
+    uint64_t epoch = atomic_fetch_add(&store->epoch, 1) + 1;
+    if (old) {
+        retired->version = old;
+        retired->epoch = epoch;
+        retired->next = store->retired;
+        store->retired = retired;
+        store->retired_count++;
+    } else {
+        free(retired);
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    if (version) {
+        *version = published->version;
+    }
+    rim_store_reclaim(store);
+    return 0;
+}
+
+size_t rim_store_reclaim(RimStore *store) {
+    size_t remaining = 0;
+    if (!store) {
+        return 0;
+    }
+    pthread_mutex_lock(&store->lock);
+    uint64_t oldest = UINT64_MAX;
+    for (RimReader *reader = atomic_load(&store->readers); reader; reader = reader->next) {
+        uint64_t epoch = atomic_load(&reader->epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    RimRetired **link = &store->retired;
+    while (*link) {
+        RimRetired *retired = *link;
+        if (retired->epoch <= oldest) {
+            *link = retired->next;
+            version_free(retired->version);
+            free(retired);
+            store->retired_count--;
+            store->reclaimed++;
+        } else {
+            link = &retired->next;
+            remaining++;
+        }
+    }
+    pthread_mutex_unlock(&store->lock);
+    return remaining;
+}
+
+void rim_store_get_stats(RimStore *store, RimStoreStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!store) {
+        return;
+    }
+    pthread_mutex_lock(&store->lock);
+    RimVersion *current = atomic_load(&store->current);
+    stats->version = current ? current->version : 0;
+    stats->published = store->published;
+    stats->retired = store->retired_count;
+    stats->reclaimed = store->reclaimed;
+    pthread_mutex_unlock(&store->lock);
+    for (RimReader *reader = atomic_load(&store->readers); reader; reader = reader->next) {
+        stats->readers += atomic_load(&reader->in_use);
+    }
+}
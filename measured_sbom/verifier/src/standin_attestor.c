@@ -0,0 +1,484 @@
+// standin_attestor.c
+// Stand-in attestors served from one thread, so a single Linux box can load-test the verifier daemon without TPMs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "attestation.pb-c.h"  // Protobuf definitions for attestation
+#include "attestation_decode.h"
+#include "pcr.h"
+#include "soft_ak.h"
+#include "standin_attestor.h"
+#include "transport.h"
+
+#define STANDIN_MAX_EVENTS 256
+#define STANDIN_ID_SIZE 32
+
+/**
+ * @struct StandinEndpoint
+ * @brief Attestor end of one stand-in connection.
+ */
+typedef struct {
+    StandinAttestors *attestors;
+    TransportConnection connection;
+    char attestor_id[STANDIN_ID_SIZE];
+} StandinEndpoint;
+
+struct StandinAttestors {
+    StandinEndpoint *endpoints;
+    size_t count;
+    size_t accepted;                    // Endpoints handed to incoming connections in listening mode
+    BufferPool *buffers;                // Request and response frames
+    int listen_fd;
+    uint8_t *event_log;
+    size_t log_size;
+    LogChunk *log_chunks;               // Version 2 encoding of the event log
+    LogChunk **log_chunk_list;
+    size_t log_chunk_count;
+    uint32_t *event_offsets;
+    size_t event_count;
+    size_t header_size;                 // First record, sent ahead of an empty delta
+    uint8_t log_digest[PCR_LOG_DIGEST_SIZE]; // Rolling digest of the whole log
+    TCGEvent *legacy_events;            // Version 1 encoding of the event log
+    TCGEvent **legacy_event_list;
+    char *legacy_content;
+    TCGEventLog legacy_log;
+    PCR pcr_values[TPM_PCR_COUNT];
+    PCR *pcr_list[TPM_PCR_COUNT];
+    uint8_t pcr_digests[TPM_PCR_COUNT][TPM2_SHA256_DIGEST_SIZE];
+    SoftQuoteState quoted;              // Every PCR of the SHA-256 bank and their digest
+    SoftAK ak;                          // Software attestation key shared by the stand-ins
+    int epoll_fd;
+    int stop_fd;
+    pthread_t thread;
+    bool thread_started;
+};
+
+static void endpoint_close(StandinEndpoint *endpoint) {
+    if (endpoint->connection.fd >= 0) {
+        epoll_ctl(endpoint->attestors->epoll_fd, EPOLL_CTL_DEL, endpoint->connection.fd, NULL);
+    }
+    transport_connection_close(&endpoint->connection);
+}
+
+/**
+ * @brief Builds the response to one request and queues it on the endpoint's connection.
+ */
+static int endpoint_answer(StandinEndpoint *endpoint, const uint8_t *request_buffer, size_t request_size) {
+    StandinAttestors *attestors = endpoint->attestors;
+    AttestationRequest *request = attestation_request__unpack(NULL, request_size, request_buffer);
+    if (!request) {
+        fprintf(stderr, "Stand-in %s: error unpacking AttestationRequest\n", endpoint->attestor_id);
+        return -1;
+    }
+
+    uint8_t quote[SOFT_AK_QUOTE_MAX_SIZE];
+    size_t quote_size = soft_ak_quote(&attestors->ak, &attestors->quoted, request->nonce.data, request->nonce.len,
+                                      quote, sizeof(quote));
+    if (quote_size == 0) {
+        fprintf(stderr, "Stand-in %s: error signing quote\n", endpoint->attestor_id);
+        attestation_request__free_unpacked(request, NULL);
+        return -1;
+    }
+
+    AttestationResponse response = ATTESTATION_RESPONSE__INIT;
+    response.attestor_id = endpoint->attestor_id;
+    response.n_pcrs = TPM_PCR_COUNT;
+    response.pcrs = attestors->pcr_list;
+    bool up_to_date = request->known_events == attestors->event_count &&
+                      request->known_log_size == attestors->log_size &&
+                      request->known_log_digest.len == PCR_LOG_DIGEST_SIZE &&
+                      memcmp(request->known_log_digest.data, attestors->log_digest, PCR_LOG_DIGEST_SIZE) == 0;
+    if (request->protocol_version >= ATTESTATION_PROTOCOL_V2 && up_to_date) {
+        // The stand-in log never grows: a verifier holding all of it gets an empty delta
+        response.protocol_version = ATTESTATION_PROTOCOL_V2;
+        response.log_base_events = attestors->event_count;
+        response.log_base_size = attestors->log_size;
+        response.log_base_digest.data = attestors->log_digest;
+        response.log_base_digest.len = PCR_LOG_DIGEST_SIZE;
+        response.log_header.data = attestors->event_log;
+        response.log_header.len = attestors->header_size;
+    } else if (request->protocol_version >= ATTESTATION_PROTOCOL_V2) {
+        response.protocol_version = ATTESTATION_PROTOCOL_V2;
+        response.n_log_chunks = attestors->log_chunk_count;
+        response.log_chunks = attestors->log_chunk_list;
+        response.n_event_offsets = attestors->event_count;
+        response.event_offsets = attestors->event_offsets;
+    } else {
+        response.event_log = &attestors->legacy_log;
+    }
+    response.nonce = request->nonce;
+    response.quote.data = quote;
+    response.quote.len = quote_size;
+
+    size_t size = attestation_response__get_packed_size(&response);
+    uint8_t *out = transport_frame_get(attestors->buffers, size);
+    if (!out) {
+        attestation_request__free_unpacked(request, NULL);
+        return -1;
+    }
+    attestation_response__pack(&response, out);
+    attestation_request__free_unpacked(request, NULL);
+    transport_queue_frame(&endpoint->connection, out, size);
+    return 0;
+}
+
+/**
+ * @brief Writes queued responses; waits for the socket to drain before reading more requests.
+ *
+ * @return Returns 0 while the endpoint is healthy, or -1 if it must be closed.
+ */
+static int endpoint_flush(StandinEndpoint *endpoint) {
+    TransportStatus status = transport_flush(&endpoint->connection);
+    if (status == TRANSPORT_ERROR) {
+        return -1;
+    }
+    struct epoll_event event = { .events = status == TRANSPORT_AGAIN ? EPOLLOUT : EPOLLIN, .data.ptr = endpoint };
+    return epoll_ctl(endpoint->attestors->epoll_fd, EPOLL_CTL_MOD, endpoint->connection.fd, &event);
+}
+
+/**
+ * @brief Answers every whole request that has arrived; pipelined requests are answered in order.
+ *
+ * @return Returns 0 while the endpoint is healthy, or -1 if it must be closed.
+ */
+static int endpoint_on_readable(StandinEndpoint *endpoint) {
+    uint8_t *request;
+    size_t request_size;
+    TransportStatus status;
+    while ((status = transport_read_frame(&endpoint->connection, &request, &request_size)) == TRANSPORT_OK) {
+        int rc = endpoint_answer(endpoint, request, request_size);
+        transport_frame_put(endpoint->attestors->buffers, request);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    if (status != TRANSPORT_AGAIN) {
+        return -1;
+    }
+    return transport_has_pending_writes(&endpoint->connection) ? endpoint_flush(endpoint) : 0;
+}
+
+static void standin_accept(StandinAttestors *attestors) {
+    int fd;
+    while ((fd = transport_accept(attestors->listen_fd)) >= 0) {
+        if (attestors->accepted == attestors->count) {
+            close(fd);
+            continue;
+        }
+        StandinEndpoint *endpoint = &attestors->endpoints[attestors->accepted++];
+        transport_connection_init(&endpoint->connection, fd, attestors->buffers);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = endpoint };
+        if (epoll_ctl(attestors->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            endpoint_close(endpoint);
+        }
+    }
+}
+
+static void *standin_main(void *arg) {
+    StandinAttestors *attestors = arg;
+    struct epoll_event events[STANDIN_MAX_EVENTS];
+
+    for (;;) {
+        int count = epoll_wait(attestors->epoll_fd, events, STANDIN_MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            void *source = events[i].data.ptr;
+            if (!source) {
+                return NULL;
+            }
+            if (source == attestors) {
+                standin_accept(attestors);
+                continue;
+            }
+            StandinEndpoint *endpoint = source;
+            if (endpoint->connection.fd < 0) {
+                continue;
+            }
+            int rc = transport_has_pending_writes(&endpoint->connection) ? endpoint_flush(endpoint)
+                                                                         : endpoint_on_readable(endpoint);
+            if (rc != 0) {
+                endpoint_close(endpoint);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Prepares the event log in both wire encodings: raw chunks with an offset index for version 2 verifiers,
+ *        and a TCGEvent list (SHA-256 digests, EV_NO_ACTION records dropped) for version 1 verifiers.
+ */
+static int standin_build_log_encodings(StandinAttestors *attestors) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    size_t content_size = 0;
+    size_t legacy_count = 0;
+    if (tcg_log_cursor_init(&cursor, attestors->event_log, attestors->log_size) != TCG_LOG_OK) {
+        return -1;
+    }
+    while (tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+        if (attestors->event_count++ == 0) {
+            attestors->header_size = event.length;
+        }
+        if (event.event_type != TCG_EV_NO_ACTION) {
+            legacy_count++;
+            content_size += event.event_size + 1;
+        }
+    }
+
+    tcg_log_cursor_init(&cursor, attestors->event_log, attestors->log_size);
+    if (pcr_log_digest_update(attestors->log_digest, &cursor) != 0) {
+        return -1;
+    }
+
+    attestors->log_chunk_count = (attestors->log_size + ATTESTATION_LOG_CHUNK_SIZE - 1) / ATTESTATION_LOG_CHUNK_SIZE;
+    attestors->log_chunks = calloc(attestors->log_chunk_count, sizeof(*attestors->log_chunks));
+    attestors->log_chunk_list = calloc(attestors->log_chunk_count, sizeof(*attestors->log_chunk_list));
+    attestors->event_offsets = calloc(attestors->event_count, sizeof(*attestors->event_offsets));
+    attestors->legacy_events = calloc(legacy_count ? legacy_count : 1, sizeof(*attestors->legacy_events));
+    attestors->legacy_event_list = calloc(legacy_count ? legacy_count : 1, sizeof(*attestors->legacy_event_list));
+    attestors->legacy_content = malloc(content_size ? content_size : 1);
+    if (!attestors->log_chunks || !attestors->log_chunk_list || !attestors->event_offsets ||
+        !attestors->legacy_events || !attestors->legacy_event_list || !attestors->legacy_content) {
+        fprintf(stderr, "Error allocating memory for stand-in event log\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < attestors->log_chunk_count; i++) {
+        LogChunk chunk = LOG_CHUNK__INIT;
+        chunk.offset = i * ATTESTATION_LOG_CHUNK_SIZE;
+        chunk.data.data = attestors->event_log + chunk.offset;
+        chunk.data.len = attestors->log_size - chunk.offset < ATTESTATION_LOG_CHUNK_SIZE ?
+                         attestors->log_size - chunk.offset : ATTESTATION_LOG_CHUNK_SIZE;
+        attestors->log_chunks[i] = chunk;
+        attestors->log_chunk_list[i] = &attestors->log_chunks[i];
+    }
+
+    TCGEventLog legacy_log = TCG_EVENT_LOG__INIT;
+    char *content = attestors->legacy_content;
+    size_t index = 0;
+    tcg_log_cursor_init(&cursor, attestors->event_log, attestors->log_size);
+    while (tcg_log_cursor_next(&cursor, &event) == TCG_LOG_OK) {
+        attestors->event_offsets[index++] = (uint32_t)event.offset;
+        if (event.event_type == TCG_EV_NO_ACTION) {
+            continue;
+        }
+        const TCG_DigestView *digest = tcg_event_find_digest(&event, TPM2_ALG_SHA256);
+        if (!digest) {
+            fprintf(stderr, "Stand-in event log record %zu has no SHA-256 digest\n", event.record_num);
+            return -1;
+        }
+        TCGEvent legacy = TCG_EVENT__INIT;
+        legacy.recnum = (uint32_t)event.record_num;
+        legacy.pcr_index = event.pcr_index;
+        legacy.digest.data = (uint8_t *)digest->digest;
+        legacy.digest.len = digest->size;
+        legacy.event_content = content;
+        size_t name_len = strnlen((const char *)event.event_data, event.event_size);
+        memcpy(content, event.event_data, name_len);
+        content[name_len] = '\0';
+        content += event.event_size + 1;
+        attestors->legacy_events[legacy_log.n_events] = legacy;
+        attestors->legacy_event_list[legacy_log.n_events] = &attestors->legacy_events[legacy_log.n_events];
+        legacy_log.n_events++;
+    }
+    legacy_log.events = attestors->legacy_event_list;
+    attestors->legacy_log = legacy_log;
+    return 0;
+}
+
+/**
+ * @brief Computes the SHA-256 PCR values every stand-in reports for the event log.
+ */
+static int standin_build_pcrs(StandinAttestors *attestors) {
+    PCR_BankSet replayed;
+    if (pcr_replay_log(attestors->event_log, attestors->log_size, &replayed) != 0) {
+        fprintf(stderr, "Stand-in event log does not replay\n");
+        return -1;
+    }
+    const PCR_Bank *bank = pcr_bankset_find(&replayed, TPM2_ALG_SHA256);
+    if (!bank) {
+        fprintf(stderr, "Stand-in event log has no SHA-256 bank\n");
+        return -1;
+    }
+
+    for (int i = 0; i < TPM_PCR_COUNT; i++) {
+        PCR value = PCR__INIT;
+        memcpy(attestors->pcr_digests[i], bank->pcrs[i].buffer, bank->pcrs[i].size);
+        value.index = i;
+        value.value.data = attestors->pcr_digests[i];
+        value.value.len = bank->pcrs[i].size;
+        attestors->pcr_values[i] = value;
+        attestors->pcr_list[i] = &attestors->pcr_values[i];
+    }
+    return soft_quote_state_init(&attestors->quoted, &replayed);
+}
+
+/**
+ * @brief Creates stand-ins with no connections yet.
+ */
+static StandinAttestors *standin_attestors_create(size_t count, const uint8_t *event_log, size_t log_size) {
+    StandinAttestors *attestors = calloc(1, sizeof(*attestors));
+    if (!attestors) {
+        fprintf(stderr, "Error allocating memory for stand-in attestors\n");
+        return NULL;
+    }
+    attestors->epoll_fd = -1;
+    attestors->stop_fd = -1;
+    attestors->listen_fd = -1;
+    attestors->endpoints = calloc(count, sizeof(*attestors->endpoints));
+    attestors->event_log = malloc(log_size);
+    attestors->buffers = buffer_pool_create();
+    if (!attestors->endpoints || !attestors->event_log || !attestors->buffers) {
+        fprintf(stderr, "Error allocating memory for stand-in attestors\n");
+        standin_attestors_stop(attestors);
+        return NULL;
+    }
+    memcpy(attestors->event_log, event_log, log_size);
+    attestors->log_size = log_size;
+    attestors->count = count;
+    for (size_t i = 0; i < count; i++) {
+        StandinEndpoint *endpoint = &attestors->endpoints[i];
+        endpoint->attestors = attestors;
+        transport_connection_init(&endpoint->connection, -1, attestors->buffers);
+        snprintf(endpoint->attestor_id, sizeof(endpoint->attestor_id), "standin-%06zu", i);
+    }
+
+    attestors->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    attestors->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct epoll_event stop_event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (attestors->epoll_fd < 0 || attestors->stop_fd < 0 ||
+        epoll_ctl(attestors->epoll_fd, EPOLL_CTL_ADD, attestors->stop_fd, &stop_event) != 0 ||
+        standin_build_pcrs(attestors) != 0 || standin_build_log_encodings(attestors) != 0 ||
+        soft_ak_create(&attestors->ak) != 0) {
+        standin_attestors_stop(attestors);
+        return NULL;
+    }
+    return attestors;
+}
+
+static int standin_attestors_run(StandinAttestors *attestors) {
+    if (pthread_create(&attestors->thread, NULL, standin_main, attestors) != 0) {
+        fprintf(stderr, "Error starting stand-in attestor thread\n");
+        return -1;
+    }
+    attestors->thread_started = true;
+    return 0;
+}
+
+StandinAttestors *standin_attestors_start(size_t count, const uint8_t *event_log, size_t log_size,
+                                          int *verifier_fds) {
+    if (count == 0 || !event_log || log_size == 0 || !verifier_fds) {
+        return NULL;
+    }
+    StandinAttestors *attestors = standin_attestors_create(count, event_log, log_size);
+    if (!attestors) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        StandinEndpoint *endpoint = &attestors->endpoints[i];
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) != 0) {
+            perror("socketpair");
+            for (size_t j = 0; j < i; j++) {
+                close(verifier_fds[j]);
+            }
+            standin_attestors_stop(attestors);
+            return NULL;
+        }
+        transport_connection_init(&endpoint->connection, fds[0], attestors->buffers);
+        verifier_fds[i] = fds[1];
+
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = endpoint };
+        epoll_ctl(attestors->epoll_fd, EPOLL_CTL_ADD, fds[0], &event);
+    }
+
+    if (standin_attestors_run(attestors) != 0) {
+        for (size_t i = 0; i < count; i++) {
+            close(verifier_fds[i]);
+        }
+        standin_attestors_stop(attestors);
+        return NULL;
+    }
+    return attestors;
+}
+
+StandinAttestors *standin_attestors_listen(size_t count, const uint8_t *event_log, size_t log_size,
+                                           const char *address) {
+    if (count == 0 || !event_log || log_size == 0 || !address) {
+        return NULL;
+    }
+    StandinAttestors *attestors = standin_attestors_create(count, event_log, log_size);
+    if (!attestors) {
+        return NULL;
+    }
+
+    attestors->listen_fd = transport_listen(address);
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = attestors };
+    if (attestors->listen_fd < 0 ||
+        epoll_ctl(attestors->epoll_fd, EPOLL_CTL_ADD, attestors->listen_fd, &event) != 0 ||
+        standin_attestors_run(attestors) != 0) {
+        standin_attestors_stop(attestors);
+        return NULL;
+    }
+    return attestors;
+}
+
+void standin_attestors_stop(StandinAttestors *attestors) {
+    if (!attestors) {
+        return;
+    }
+    if (attestors->thread_started) {
+        uint64_t one = 1;
+        (void)!write(attestors->stop_fd, &one, sizeof(one));
+        pthread_join(attestors->thread, NULL);
+    }
+    for (size_t i = 0; i < attestors->count; i++) {
+        endpoint_close(&attestors->endpoints[i]);
+    }
+    if (attestors->listen_fd >= 0) {
+        close(attestors->listen_fd);
+    }
+    if (attestors->epoll_fd >= 0) {
+        close(attestors->epoll_fd);
+    }
+    if (attestors->stop_fd >= 0) {
+        close(attestors->stop_fd);
+    }
+    soft_ak_free(&attestors->ak);
+    free(attestors->endpoints);
+    free(attestors->event_log);
+    free(attestors->log_chunks);
+    free(attestors->log_chunk_list);
+    free(attestors->event_offsets);
+    free(attestors->legacy_events);
+    free(attestors->legacy_event_list);
+    free(attestors->legacy_content);
+    buffer_pool_destroy(attestors->buffers);
+    free(attestors);
+}
+
+int standin_attestors_ak_public(const StandinAttestors *attestors, const uint8_t **public_blob, size_t *public_size) {
+    if (!attestors || !public_blob || !public_size) {
+        return -1;
+    }
+    *public_blob = attestors->ak.public_blob;
+    *public_size = attestors->ak.public_size;
+    return 0;
+}
@@ -0,0 +1,201 @@
+// verdict_cache.c
+// Content-addressed cache of measurement log verdicts, so byte-identical boot logs across a fleet are replayed and
+// checked against the RIM once rather than once per machine.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include "verdict_cache.h"
+
+#define VERDICT_CACHE_NONE UINT32_MAX
+
+typedef struct {
+    VerdictKey key;
+    uint32_t next;                  // Next entry in the same bucket, or VERDICT_CACHE_NONE
+    bool referenced;                // CLOCK reference bit, set by every hit
+    LogVerdict verdict;
+    PCR_BankSet pcrs;
+} VerdictEntry;
+
+struct VerdictCache {
+    pthread_mutex_t lock;
+    VerdictEntry *entries;          // Preallocated; the first count entries are in use
+    uint32_t capacity;
+    uint32_t count;
+    uint32_t hand;                  // CLOCK hand
+    uint32_t *buckets;              // Heads of the bucket chains
+    uint32_t bucket_mask;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+};
+
+static uint32_t key_bucket(const VerdictCache *cache, const VerdictKey *key) {
+    // The log digest is already uniformly distributed.
+    uint32_t hash;
+    memcpy(&hash, key->log_digest, sizeof(hash));
+    return (hash ^ key->policy_version) & cache->bucket_mask;
+}
+
+static bool key_equals(const VerdictKey *a, const VerdictKey *b) {
+    return memcmp(a->log_digest, b->log_digest, sizeof(a->log_digest)) == 0 &&
+           memcmp(a->rim_digest, b->rim_digest, sizeof(a->rim_digest)) == 0 &&
+           a->policy_version == b->policy_version;
+}
+
+static uint32_t find_entry(const VerdictCache *cache, const VerdictKey *key) {
+    for (uint32_t i = cache->buckets[key_bucket(cache, key)]; i != VERDICT_CACHE_NONE; i = cache->entries[i].next) {
+        if (key_equals(&cache->entries[i].key, key)) {
+            return i;
+        }
+    }
+    return VERDICT_CACHE_NONE;
+}
+
+static void unlink_entry(VerdictCache *cache, uint32_t index) {
+    uint32_t *link = &cache->buckets[key_bucket(cache, &cache->entries[index].key)];
+    while (*link != index) {
+        link = &cache->entries[*link].next;
+    }
+    *link = cache->entries[index].next;
+}
+
+/**
+ * @brief Picks the entry to reuse: the first one the hand reaches without a reference bit, clearing bits on the way.
+ */
+static uint32_t evict_entry(VerdictCache *cache) {
+    while (cache->entries[cache->hand].referenced) {
+        cache->entries[cache->hand].referenced = false;
+        cache->hand = (cache->hand + 1) % cache->capacity;
+    }
+    uint32_t victim = cache->hand;
+    cache->hand = (cache->hand + 1) % cache->capacity;
+    unlink_entry(cache, victim);
+    cache->evictions++;
+    return victim;
+}
+
+VerdictCache *verdict_cache_create(size_t capacity) {
+    if (capacity == 0 || capacity >= VERDICT_CACHE_NONE / 2) {
+        fprintf(stderr, "Verdict cache create failed: Invalid capacity\n");
+        return NULL;
+    }
+
+    uint32_t bucket_count = 16;
+    while (bucket_count < capacity) {
+        bucket_count *= 2;
+    }
+
+    VerdictCache *cache = calloc(1, sizeof(*cache));
+    if (!cache) {
+        fprintf(stderr, "Error allocating memory for verdict cache\n");
+        return NULL;
+    }
+    cache->entries = malloc(capacity * sizeof(*cache->entries));
+    cache->buckets = malloc(bucket_count * sizeof(*cache->buckets));
+    if (!cache->entries || !cache->buckets) {
+        fprintf(stderr, "Error allocating memory for verdict cache\n");
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+    memset(cache->buckets, 0xff, bucket_count * sizeof(*cache->buckets));
+    cache->capacity = (uint32_t)capacity;
+    cache->bucket_mask = bucket_count - 1;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void verdict_cache_destroy(VerdictCache *cache) {
+    if (!cache) {
+        return;
+    }
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+int verdict_cache_key(VerdictKey *key, const uint8_t *measurement_log, size_t log_size, const RIM_Index *rim_index,
+                      uint32_t policy_version) {
+    if (!key || !measurement_log || !rim_index) {
+        return -1;
+    }
+    memset(key, 0, sizeof(*key));
+    if (EVP_Digest(measurement_log, log_size, key->log_digest, NULL, EVP_sha256(), NULL) != 1) {
+        fprintf(stderr, "Error hashing measurement log\n");
+        return -1;
+    }
+    memcpy(key->rim_digest, rim_index->content_digest, sizeof(key->rim_digest));
+    key->policy_version = policy_version;
+    return 0;
+}
+
+int verdict_cache_lookup(VerdictCache *cache, const VerdictKey *key, LogVerdict *verdict, PCR_BankSet *pcrs) {
+    if (!cache || !key || !verdict || !pcrs) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    uint32_t index = find_entry(cache, key);
+    if (index == VERDICT_CACHE_NONE) {
+        cache->misses++;
+        pthread_mutex_unlock(&cache->lock);
+        return -1;
+    }
+    VerdictEntry *entry = &cache->entries[index];
+    entry->referenced = true;
+    *verdict = entry->verdict;
+    if (entry->verdict == LOG_VERDICT_ACCEPTED) {
+        *pcrs = entry->pcrs;
+    }
+    cache->hits++;
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+void verdict_cache_insert(VerdictCache *cache, const VerdictKey *key, LogVerdict verdict, const PCR_BankSet *pcrs) {
+    if (!cache || !key || (verdict == LOG_VERDICT_ACCEPTED && !pcrs)) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    uint32_t index = find_entry(cache, key);
+    if (index == VERDICT_CACHE_NONE) {
+        index = cache->count < cache->capacity ? cache->count++ : evict_entry(cache);
+        VerdictEntry *entry = &cache->entries[index];
+        entry->key = *key;
+        uint32_t bucket = key_bucket(cache, key);
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = index;
+    }
+
+    // New entries start unreferenced, so a log seen only once is the first to go.
+    VerdictEntry *entry = &cache->entries[index];
+    entry->referenced = false;
+    entry->verdict = verdict;
+    if (verdict == LOG_VERDICT_ACCEPTED) {
+        entry->pcrs = *pcrs;
+    }
+    cache->insertions++;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void verdict_cache_get_stats(VerdictCache *cache, VerdictCacheStats *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+    pthread_mutex_lock(&cache->lock);
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->insertions = cache->insertions;
+    stats->evictions = cache->evictions;
+    stats->entries = cache->count;
+    stats->capacity = cache->capacity;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,360 @@
+// verdict_log.c
+// Asynchronous verdict output: verification threads queue structured verdicts in a lock-free ring and a writer
+// thread encodes them as JSON lines or binary records.
+//
+// Binary records are little-endian:
+//   u32 magic (VERDICT_BINARY_MAGIC), u32 record size in bytes, u64 timestamp_ns,
+//   char attestor_id[VERDICT_ATTESTOR_ID_MAX], i32 result, u32 reason, u8 rim_cached, u8 has_failure, u16 zero,
+//   u64 rim_version, u8 rim_digest[RIM_INDEX_DIGEST_SIZE],
+//   u32 events_checked, u32 status_counts[EVENT_STATUS_COUNT],
+//   first failure: u32 record_num, u32 event_type, u32 pcr_index, u32 status, u32 name_len,
+//   char name[RIM_CHECK_NAME_MAX],
+//   u32 pcr_events[TPM_PCR_COUNT], u32 pcr_failures[TPM_PCR_COUNT],
+//   u32 event_count, then event_count x (u32 record_num, u32 event_type, u32 pcr_index, u32 status).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "verdict_log.h"
+
+#define VERDICT_LOG_IDLE_NS 1000000     // Writer sleep when the ring is empty
+#define VERDICT_BINARY_FIXED_SIZE (4 + 4 + 8 + VERDICT_ATTESTOR_ID_MAX + 4 + 4 + 4 + 8 + RIM_INDEX_DIGEST_SIZE + 4 + \
+                                   4 * EVENT_STATUS_COUNT + 5 * 4 + RIM_CHECK_NAME_MAX + 8 * TPM_PCR_COUNT + 4)
+
+// Structures
+
+typedef struct {
+    atomic_size_t sequence;         /**< Ring position the slot is free for, or that position + 1 once filled */
+    AttestationVerdict verdict;     /**< Event detail points to a copy owned by the slot */
+} VerdictSlot;
+
+struct VerdictLog {
+    VerdictSlot *slots;
+    size_t mask;                    /**< Slot count - 1 */
+    atomic_size_t tail;             /**< Next position producers claim */
+    size_t head;                    /**< Next position the writer reads; writer only */
+    FILE *out;
+    bool close_out;                 /**< out was opened by the log */
+    VerdictFormat format;
+    VerdictLevel level;
+    pthread_t writer;
+    atomic_bool stopping;
+    atomic_uint_fast64_t submitted;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t written;
+};
+
+static const char *const reason_names[VERDICT_REASON_COUNT] = {
+    "none", "malformed", "quote", "log_format", "checkpoint", "pcr_mismatch", "rim",
+};
+
+const char *verdict_reason_str(VerdictReason reason) {
+    return reason < VERDICT_REASON_COUNT ? reason_names[reason] : "invalid";
+}
+
+// Ring
+
+int verdict_log_submit(VerdictLog *log, const AttestationVerdict *verdict) {
+    // Event detail is copied first, so a full ring costs the copy but never a wait.
+    EventRecordStatus *events = NULL;
+    if (log->level != VERDICT_LEVEL_SUMMARY && verdict->rim.event_count > 0) {
+        events = malloc(verdict->rim.event_count * sizeof(*events));
+        if (events) {
+            memcpy(events, verdict->rim.events, verdict->rim.event_count * sizeof(*events));
+        }
+    }
+
+    size_t pos = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    VerdictSlot *slot;
+    for (;;) {
+        slot = &log->slots[pos & log->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&log->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            free(events);
+            atomic_fetch_add(&log->dropped, 1);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&log->tail, memory_order_relaxed);
+        }
+    }
+
+    slot->verdict = *verdict;
+    slot->verdict.rim.events = events;
+    slot->verdict.rim.event_count = events ? verdict->rim.event_count : 0;
+    slot->verdict.rim.event_capacity = slot->verdict.rim.event_count;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    atomic_fetch_add(&log->submitted, 1);
+    return 0;
+}
+
+/**
+ * @brief Takes the oldest verdict off the ring; the caller owns its event detail.
+ */
+static bool ring_take(VerdictLog *log, AttestationVerdict *verdict) {
+    VerdictSlot *slot = &log->slots[log->head & log->mask];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != log->head + 1) {
+        return false;
+    }
+    *verdict = slot->verdict;
+    atomic_store_explicit(&slot->sequence, log->head + log->mask + 1, memory_order_release);
+    log->head++;
+    return true;
+}
+
+// Encoding
+
+static void write_json_string(FILE *out, const char *text, size_t size) {
+    fputc('"', out);
+    for (size_t i = 0; i < size; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20 || c >= 0x7f) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json_event(FILE *out, const EventRecordStatus *event) {
+    fprintf(out, "{\"record\":%u,\"pcr\":%u,\"type\":%u,\"status\":\"%s\"}", event->record_num, event->pcr_index,
+            event->event_type, event_status_str((EventStatus)event->status));
+}
+
+static void write_json(FILE *out, const AttestationVerdict *verdict) {
+    const RIM_CheckReport *rim = &verdict->rim;
+    time_t seconds = (time_t)(verdict->timestamp_ns / 1000000000ull);
+    struct tm utc;
+    char timestamp[32];
+    gmtime_r(&seconds, &utc);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    fprintf(out, "{\"time\":\"%s.%06lluZ\",\"attestor\":", timestamp,
+            (unsigned long long)(verdict->timestamp_ns % 1000000000ull / 1000));
+    write_json_string(out, verdict->attestor_id, strnlen(verdict->attestor_id, sizeof(verdict->attestor_id)));
+    fprintf(out, ",\"result\":\"%s\",\"reason\":\"%s\",\"rim_version\":%llu,\"rim_digest\":\"",
+            verdict->result == 0 ? "pass" : "fail", verdict_reason_str(verdict->reason),
+            (unsigned long long)verdict->rim_version);
+    for (size_t i = 0; i < RIM_INDEX_DIGEST_SIZE; i++) {
+        fprintf(out, "%02x", verdict->rim_digest[i]);
+    }
+    fprintf(out, "\",\"rim_cached\":%s,\"events\":%u,\"status\":{", verdict->rim_cached ? "true" : "false",
+            rim->events_checked);
+    for (int status = 0; status < EVENT_STATUS_COUNT; status++) {
+        fprintf(out, "%s\"%s\":%u", status ? "," : "", event_status_str((EventStatus)status),
+                rim->status_counts[status]);
+    }
+    fputc('}', out);
+
+    if (rim->has_failure) {
+        fputs(",\"first_failure\":", out);
+        fprintf(out, "{\"record\":%u,\"pcr\":%u,\"type\":%u,\"status\":\"%s\",\"name\":",
+                rim->first_failure.record_num, rim->first_failure.pcr_index, rim->first_failure.event_type,
+                event_status_str((EventStatus)rim->first_failure.status));
+        write_json_string(out, rim->first_failure_name, rim->first_failure_name_len);
+        fputc('}', out);
+    }
+
+    fputs(",\"pcrs\":[", out);
+    bool first = true;
+    for (int pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        if (rim->pcr_events[pcr] == 0) {
+            continue;
+        }
+        fprintf(out, "%s{\"pcr\":%d,\"events\":%u,\"failures\":%u}", first ? "" : ",", pcr, rim->pcr_events[pcr],
+                rim->pcr_failures[pcr]);
+        first = false;
+    }
+    fputc(']', out);
+
+    if (rim->event_count > 0) {
+        fputs(",\"event_detail\":[", out);
+        for (size_t i = 0; i < rim->event_count; i++) {
+            if (i > 0) {
+                fputc(',', out);
+            }
+            write_json_event(out, &rim->events[i]);
+        }
+        fputc(']', out);
+    }
+    fputs("}\n", out);
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        *p++ = (uint8_t)(value >> (8 * i));
+    }
+    return p;
+}
+
+static uint8_t *put_event(uint8_t *p, const EventRecordStatus *event) {
+    p = put_u32(p, event->record_num);
+    p = put_u32(p, event->event_type);
+    p = put_u32(p, event->pcr_index);
+    return put_u32(p, event->status);
+}
+
+static void write_binary(FILE *out, const AttestationVerdict *verdict) {
+    const RIM_CheckReport *rim = &verdict->rim;
+    uint8_t record[VERDICT_BINARY_FIXED_SIZE];
+    uint8_t *p = record;
+    uint64_t record_size = VERDICT_BINARY_FIXED_SIZE + rim->event_count * 16;
+    if (record_size > UINT32_MAX) {
+        return;
+    }
+
+    p = put_u32(p, VERDICT_BINARY_MAGIC);
+    p = put_u32(p, (uint32_t)record_size);
+    p = put_u32(p, (uint32_t)verdict->timestamp_ns);
+    p = put_u32(p, (uint32_t)(verdict->timestamp_ns >> 32));
+    memset(p, 0, VERDICT_ATTESTOR_ID_MAX);
+    memcpy(p, verdict->attestor_id, strnlen(verdict->attestor_id, VERDICT_ATTESTOR_ID_MAX));
+    p += VERDICT_ATTESTOR_ID_MAX;
+    p = put_u32(p, (uint32_t)verdict->result);
+    p = put_u32(p, verdict->reason);
+    *p++ = verdict->rim_cached;
+    *p++ = rim->has_failure;
+    *p++ = 0;
+    *p++ = 0;
+    p = put_u32(p, (uint32_t)verdict->rim_version);
+    p = put_u32(p, (uint32_t)(verdict->rim_version >> 32));
+    memcpy(p, verdict->rim_digest, RIM_INDEX_DIGEST_SIZE);
+    p += RIM_INDEX_DIGEST_SIZE;
+    p = put_u32(p, rim->events_checked);
+    for (int status = 0; status < EVENT_STATUS_COUNT; status++) {
+        p = put_u32(p, rim->status_counts[status]);
+    }
+    p = put_event(p, &rim->first_failure);
+    p = put_u32(p, rim->first_failure_name_len);
+    memset(p, 0, RIM_CHECK_NAME_MAX);
+    memcpy(p, rim->first_failure_name, rim->first_failure_name_len);
+    p += RIM_CHECK_NAME_MAX;
+    for (int pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        p = put_u32(p, rim->pcr_events[pcr]);
+    }
+    for (int pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        p = put_u32(p, rim->pcr_failures[pcr]);
+    }
+    p = put_u32(p, (uint32_t)rim->event_count);
+    fwrite(record, 1, (size_t)(p - record), out);
+
+    for (size_t i = 0; i < rim->event_count; i++) {
+        uint8_t event[16];
+        put_event(event, &rim->events[i]);
+        fwrite(event, 1, sizeof(event), out);
+    }
+}
+
+// Writer
+
+static void *writer_main(void *arg) {
+    VerdictLog *log = arg;
+    AttestationVerdict verdict;
+    const struct timespec idle = { .tv_sec = 0, .tv_nsec = VERDICT_LOG_IDLE_NS };
+
+    for (;;) {
+        if (!ring_take(log, &verdict)) {
+            // Producers never signal, so the hot path stays a copy and a store; an idle writer polls.
+            fflush(log->out);
+            if (atomic_load(&log->stopping) && !ring_take(log, &verdict)) {
+                break;
+            }
+            if (!atomic_load(&log->stopping)) {
+                nanosleep(&idle, NULL);
+                continue;
+            }
+        }
+        if (log->format == VERDICT_FORMAT_BINARY) {
+            write_binary(log->out, &verdict);
+        } else {
+            write_json(log->out, &verdict);
+        }
+        free(verdict.rim.events);
+        atomic_fetch_add(&log->written, 1);
+    }
+    fflush(log->out);
+    return NULL;
+}
+
+VerdictLog *verdict_log_create(const VerdictLogConfig *config) {
+    VerdictLog *log = calloc(1, sizeof(*log));
+    if (!log) {
+        fprintf(stderr, "Error allocating memory for verdict log\n");
+        return NULL;
+    }
+    size_t capacity = 1;
+    size_t wanted = config->capacity ? config->capacity : VERDICT_LOG_DEFAULT_CAPACITY;
+    while (capacity < wanted) {
+        capacity <<= 1;
+    }
+    log->slots = calloc(capacity, sizeof(*log->slots));
+    if (!log->slots) {
+        fprintf(stderr, "Error allocating memory for verdict ring\n");
+        free(log);
+        return NULL;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&log->slots[i].sequence, i);
+    }
+    log->mask = capacity - 1;
+    log->format = config->format;
+    log->level = config->level;
+
+    if (!config->path || strcmp(config->path, "-") == 0) {
+        log->out = stdout;
+    } else {
+        log->out = fopen(config->path, config->format == VERDICT_FORMAT_BINARY ? "ab" : "a");
+        log->close_out = true;
+    }
+    if (!log->out) {
+        fprintf(stderr, "Error opening verdict log: %s\n", config->path);
+        free(log->slots);
+        free(log);
+        return NULL;
+    }
+    if (pthread_create(&log->writer, NULL, writer_main, log) != 0) {
+        fprintf(stderr, "Error starting verdict writer thread\n");
+        if (log->close_out) {
+            fclose(log->out);
+        }
+        free(log->slots);
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void verdict_log_destroy(VerdictLog *log) {
+    if (!log) {
+        return;
+    }
+    atomic_store(&log->stopping, true);
+    pthread_join(log->writer, NULL);
+    if (log->close_out) {
+        fclose(log->out);
+    }
+    free(log->slots);
+    free(log);
+}
+
+VerdictLevel verdict_log_level(const VerdictLog *log) {
+    return log->level;
+}
+
+void verdict_log_get_stats(VerdictLog *log, VerdictLogStats *stats) {
+    stats->submitted = atomic_load(&log->submitted);
+    stats->dropped = atomic_load(&log->dropped);
+    stats->written = atomic_load(&log->written);
+}
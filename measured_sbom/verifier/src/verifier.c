@@ -6,72 +6,120 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <openssl/rand.h>
 #include "attestation.pb-c.h"  // Protobuf definitions for attestation
+#include "attestation_decode.h"
 #include "verifier.h"
+#include "verifier_metrics.h"
+#include "event_log_verifier.h"
 
-// Enumerations
-
-/**
- * @enum VerifierState
- * @brief Enumeration of states in the verifier's attestation protocol state machine.
- */
-typedef enum {
-    VERIFIER_STATE_INIT,            /**< Initial state */
-    VERIFIER_STATE_SEND_REQUEST,    /**< Sending the attestation request */
-    VERIFIER_STATE_WAIT_FOR_RESPONSE,/**< Waiting for the attestation response */
-    VERIFIER_STATE_PROCESS_RESPONSE,/**< Processing the attestation response */
-    VERIFIER_STATE_DONE,            /**< Attestation protocol completed */
-    VERIFIER_STATE_ERROR            /**< An error occurred */
-} VerifierState;
+// Function Implementations
 
-// Structures
+// Per-attestor replay checkpoints; NULL disables incremental replay
+static CheckpointStore *verifier_checkpoints = NULL;
 
-/**
- * @struct VerifierContext
- * @brief Context structure for the verifier's attestation protocol state machine.
- */
-typedef struct {
-    VerifierState state;            /**< Current state of the verifier's protocol */
-    uint8_t *request_buffer;        /**< Buffer containing the attestation request */
-    size_t request_size;            /**< Size of the request buffer */
-    uint8_t *response_buffer;       /**< Buffer containing the attestation response */
-    size_t response_size;           /**< Size of the response buffer */
-    int attestation_result;         /**< Result of the attestation (0 = pass, -1 = fail) */
-} VerifierContext;
+// Dictionary attestors may compress logs with; NULL takes them uncompressed
+static const LogDictionary *verifier_dictionary = NULL;
 
-// Function Prototypes
+// Archive every verified attestation is appended to; NULL keeps none
+static EventArchive *verifier_archive = NULL;
 
-int create_attestation_request(uint8_t **request_buffer, size_t *request_size);
-int send_attestation_request(uint8_t *request_buffer, size_t request_size);
-int receive_attestation_response(uint8_t **response_buffer, size_t *response_size);
-int process_attestation_response(uint8_t *response_buffer, size_t response_size, int *attestation_result);
+// Whether passed attestations and checkpoint fallbacks are reported on stderr
+static bool verifier_debug = false;
 
-int verify_quote_signature(const uint8_t *quote, size_t quote_size);
-int replay_measurement_log(const uint8_t *measurement_log, size_t log_size, uint8_t **replayed_pcrs, size_t *num_pcrs);
-int compare_pcr_values(const uint8_t *pcr_values, size_t num_pcrs, const uint8_t *replayed_pcrs);
-int check_measurement_log_against_rim(const uint8_t *measurement_log, size_t log_size);
+// RIM the measurement logs are checked against: the current version of a store, or a fixed index
+static RimStore *verifier_rim_store = NULL;
+static const RIM_Index *verifier_rim_index = NULL;
 
-void run_verifier_protocol(VerifierContext *ctx);
+/**
+ * @brief Pins the RIM for the calling thread.
+ *
+ * Pins nest and return the version pinned first, so a verification pinned once uses one RIM throughout, however
+ * often the store is updated meanwhile. Never locks.
+ *
+ * @param[out] version  Store version of the RIM, 0 for a fixed index; may be NULL.
+ *
+ * @return The RIM index, or NULL if none is loaded. Release it with unpin_rim().
+ */
+static const RIM_Index *pin_rim(uint64_t *version) {
+    if (version) {
+        *version = 0;
+    }
+    if (!verifier_rim_store) {
+        return verifier_rim_index;
+    }
+    const RimVersion *current = rim_store_pin(verifier_rim_store);
+    if (!current) {
+        return NULL;
+    }
+    if (version) {
+        *version = current->version;
+    }
+    return &current->index;
+}
 
-// Function Implementations
+static void unpin_rim(const RIM_Index *rim) {
+    if (verifier_rim_store && rim) {
+        rim_store_unpin(verifier_rim_store);
+    }
+}
 
 /**
  * @brief Creates an attestation request.
  *
  * This function constructs an attestation request message, including a nonce, and serializes it using Protocol Buffers.
+ * The nonce comes from the OpenSSL CSPRNG; the quote in the response must carry it as extraData. When the attestor
+ * has a checkpoint whose prefix was checked against the current RIM, the request says which prefix of its log the
+ * verifier already holds, so the attestor can send only the records after it. After a RIM update the attestor is
+ * asked for its whole log once, so that the prefix is checked against the new RIM. With a log dictionary set, the
+ * request advertises its ID.
  *
+ * @param[in]  attestor_id    Attestor the request is for, or NULL if not known yet.
+ * @param[out] nonce          Buffer receiving the nonce.
+ * @param[in]  nonce_size     Size of the nonce to generate.
+ * @param[out] known          Receives the prefix the request offers (none if events is 0); may be NULL.
  * @param[out] request_buffer Pointer to the buffer where the serialized request will be stored.
  * @param[out] request_size   Pointer to a size_t variable where the size of the request will be stored.
  *
  * @return Returns 0 on success, or -1 on failure.
  */
-int create_attestation_request(uint8_t **request_buffer, size_t *request_size) {
+int create_attestation_request_for(const char *attestor_id, uint8_t *nonce, size_t nonce_size, VerifierKnownLog *known,
+                                   uint8_t **request_buffer, size_t *request_size) {
     AttestationRequest request = ATTESTATION_REQUEST__INIT;  // Initialize the request structure
+    VerifierCheckpoint checkpoint;
+    if (known) {
+        memset(known, 0, sizeof(*known));
+    }
 
-    // Generate a nonce (for demonstration purposes, we'll use dummy data)
-    const char *dummy_nonce = "dummy_nonce";
-    request.nonce.data = (uint8_t *)dummy_nonce;
-    request.nonce.len = strlen(dummy_nonce);
+    // Generate a fresh nonce for every request so a recorded quote cannot be replayed
+    if (RAND_bytes(nonce, (int)nonce_size) != 1) {
+        fprintf(stderr, "Error generating nonce\n");
+        return -1;
+    }
+    request.nonce.data = nonce;
+    request.nonce.len = nonce_size;
+    request.protocol_version = ATTESTATION_PROTOCOL_VERSION;
+    request.log_dictionary_id = verifier_dictionary ? verifier_dictionary->id : LOG_DICTIONARY_NONE;
+    const RIM_Index *rim = pin_rim(NULL);
+    if (verifier_checkpoints && attestor_id && attestor_id[0] != '\0' && rim &&
+        checkpoint_store_find_attestor(verifier_checkpoints, attestor_id, &checkpoint) == 0 &&
+        memcmp(checkpoint.rim_digest, rim->content_digest, sizeof(checkpoint.rim_digest)) == 0) {
+        request.known_events = checkpoint.event_count;
+        request.known_log_size = checkpoint.byte_offset;
+        request.known_log_digest.data = checkpoint.prefix_digest;
+        request.known_log_digest.len = sizeof(checkpoint.prefix_digest);
+        if (known) {
+            known->events = checkpoint.event_count;
+            known->size = checkpoint.byte_offset;
+            memcpy(known->digest, checkpoint.prefix_digest, sizeof(known->digest));
+        }
+    }
+    unpin_rim(rim);
 
     // Serialize the request
     *request_size = attestation_request__get_packed_size(&request);
@@ -85,10 +133,75 @@ int create_attestation_request(uint8_t **request_buffer, size_t *request_size) {
     return 0;  // Success
 }
 
+int create_attestation_request(uint8_t *nonce, size_t nonce_size, uint8_t **request_buffer, size_t *request_size) {
+    return create_attestation_request_for(NULL, nonce, nonce_size, NULL, request_buffer, request_size);
+}
+
+// Connection to the attestor, and responses that arrived ahead of the request they answer
+static TransportConnection verifier_connection = { .fd = -1 };
+static BufferPool *verifier_buffers = NULL;
+static uint8_t *verifier_pending[VERIFIER_MAX_PENDING];
+static size_t verifier_pending_sizes[VERIFIER_MAX_PENDING];
+static size_t verifier_pending_count = 0;
+
+/**
+ * @brief Connects to the attestor the requests are sent to.
+ *
+ * @param[in] address  "unix:<path>" or "<host>:<port>".
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int verifier_connect(const char *address) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    bool in_progress;
+
+    verifier_disconnect();
+    if (transport_parse_address(address, &addr, &addr_len) != 0) {
+        fprintf(stderr, "Invalid attestor address %s\n", address);
+        return -1;
+    }
+    if (!verifier_buffers) {
+        verifier_buffers = buffer_pool_create();
+        if (!verifier_buffers) {
+            fprintf(stderr, "Error allocating memory for buffer pool\n");
+            return -1;
+        }
+    }
+
+    int fd = transport_connect(&addr, addr_len, &in_progress);
+    if (fd < 0) {
+        fprintf(stderr, "Error connecting to attestor %s\n", address);
+        return -1;
+    }
+    if (in_progress) {
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        if (poll(&pfd, 1, VERIFIER_RESPONSE_TIMEOUT_MS) != 1 || transport_connect_result(fd) != 0) {
+            fprintf(stderr, "Error connecting to attestor %s\n", address);
+            close(fd);
+            return -1;
+        }
+    }
+    transport_connection_init(&verifier_connection, fd, verifier_buffers);
+    return 0;
+}
+
+/**
+ * @brief Closes the connection to the attestor and drops responses nobody has asked for yet.
+ */
+void verifier_disconnect(void) {
+    for (size_t i = 0; i < verifier_pending_count; i++) {
+        transport_frame_put(verifier_buffers, verifier_pending[i]);
+    }
+    verifier_pending_count = 0;
+    transport_connection_close(&verifier_connection);
+}
+
 /**
  * @brief Sends the attestation request to the attestor.
  *
- * This function simulates sending the attestation request over the network to the attestor.
+ * The request is queued on the connection and written as far as the socket allows without blocking; the rest goes
+ * out while waiting for responses. Several requests may be sent before any of them is answered.
  *
  * @param[in] request_buffer Pointer to the buffer containing the serialized request.
  * @param[in] request_size   Size of the request buffer.
@@ -96,134 +209,1093 @@ int create_attestation_request(uint8_t **request_buffer, size_t *request_size) {
  * @return Returns 0 on success, or -1 on failure.
  */
 int send_attestation_request(uint8_t *request_buffer, size_t request_size) {
-    // TODO: Implement network sending code
-    // For demonstration purposes, we'll assume the request is sent successfully
-    printf("Attestation request sent (size: %zu bytes)\n", request_size);
+    if (verifier_connection.fd < 0) {
+        fprintf(stderr, "Not connected to an attestor\n");
+        return -1;
+    }
+    if (transport_queue_copy(&verifier_connection, request_buffer, request_size) != 0 ||
+        transport_flush(&verifier_connection) == TRANSPORT_ERROR) {
+        fprintf(stderr, "Error sending attestation request\n");
+        return -1;
+    }
     return 0;
 }
 
+/**
+ * @brief Returns true if a serialized response carries the given nonce.
+ */
+static bool response_matches(const uint8_t *response, size_t response_size, const uint8_t *nonce,
+                             size_t nonce_size) {
+    const uint8_t *response_nonce;
+    size_t response_nonce_size;
+    return attestation_response_peek_nonce(response, response_size, &response_nonce, &response_nonce_size) == 0 &&
+           response_nonce_size == nonce_size && memcmp(response_nonce, nonce, nonce_size) == 0;
+}
+
 /**
  * @brief Receives the attestation response from the attestor.
  *
- * This function simulates receiving the attestation response over the network.
+ * Responses to pipelined requests may arrive in any order; the one answering the given nonce is returned and the
+ * others are held until they are asked for. Queued requests keep being written while waiting.
  *
- * @param[out] response_buffer Pointer to the buffer where the response will be stored.
+ * @param[in]  nonce           Nonce of the request whose response is wanted.
+ * @param[in]  nonce_size      Size of the nonce.
+ * @param[out] response_buffer Pointer to the buffer where the response will be stored; release it with
+ *                             release_attestation_response().
  * @param[out] response_size   Pointer to a size_t variable where the size of the response will be stored.
  *
  * @return Returns 0 on success, or -1 on failure.
  */
-int receive_attestation_response(uint8_t **response_buffer, size_t *response_size) {
-    // TODO: Implement network receiving code
-    // For demonstration purposes, we'll use dummy data
-    const char *dummy_response = "dummy_response_data";
-    *response_size = strlen(dummy_response);
-    *response_buffer = malloc(*response_size);
-    if (*response_buffer == NULL) {
-        fprintf(stderr, "Error allocating memory for response buffer\n");
+int receive_attestation_response(const uint8_t *nonce, size_t nonce_size, uint8_t **response_buffer,
+                                 size_t *response_size) {
+    for (size_t i = 0; i < verifier_pending_count; i++) {
+        if (response_matches(verifier_pending[i], verifier_pending_sizes[i], nonce, nonce_size)) {
+            *response_buffer = verifier_pending[i];
+            *response_size = verifier_pending_sizes[i];
+            verifier_pending_count--;
+            memmove(&verifier_pending[i], &verifier_pending[i + 1],
+                    (verifier_pending_count - i) * sizeof(verifier_pending[0]));
+            memmove(&verifier_pending_sizes[i], &verifier_pending_sizes[i + 1],
+                    (verifier_pending_count - i) * sizeof(verifier_pending_sizes[0]));
+            return 0;
+        }
+    }
+    if (verifier_connection.fd < 0) {
+        fprintf(stderr, "Not connected to an attestor\n");
         return -1;
     }
-    memcpy(*response_buffer, dummy_response, *response_size);
 
-    printf("Attestation response received (size: %zu bytes)\n", *response_size);
-    return 0;
+    for (;;) {
+        uint8_t *frame;
+        size_t frame_size;
+        TransportStatus status = transport_read_frame(&verifier_connection, &frame, &frame_size);
+        if (status == TRANSPORT_OK) {
+            if (response_matches(frame, frame_size, nonce, nonce_size)) {
+                *response_buffer = frame;
+                *response_size = frame_size;
+                return 0;
+            }
+            if (verifier_pending_count == VERIFIER_MAX_PENDING) {
+                fprintf(stderr, "Too many unclaimed attestation responses\n");
+                transport_frame_put(verifier_buffers, frame);
+                return -1;
+            }
+            verifier_pending[verifier_pending_count] = frame;
+            verifier_pending_sizes[verifier_pending_count++] = frame_size;
+            continue;
+        }
+        if (status != TRANSPORT_AGAIN) {
+            fprintf(stderr, "Error receiving attestation response\n");
+            verifier_disconnect();
+            return -1;
+        }
+
+        struct pollfd pfd = { .fd = verifier_connection.fd, .events = POLLIN };
+        if (transport_has_pending_writes(&verifier_connection)) {
+            pfd.events |= POLLOUT;
+        }
+        int ready = poll(&pfd, 1, VERIFIER_RESPONSE_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            fprintf(stderr, "Timed out waiting for attestation response\n");
+            return -1;
+        }
+        if ((pfd.revents & POLLOUT) && transport_flush(&verifier_connection) == TRANSPORT_ERROR) {
+            fprintf(stderr, "Error sending attestation request\n");
+            verifier_disconnect();
+            return -1;
+        }
+    }
 }
 
 /**
- * @brief Processes the attestation response received from the attestor.
+ * @brief Releases a response obtained from receive_attestation_response(). NULL is ignored.
+ */
+void release_attestation_response(uint8_t *response_buffer) {
+    transport_frame_put(verifier_buffers, response_buffer);
+}
+
+// Per-thread arena responses are decoded into; it is reset after every response
+static pthread_key_t response_arena_key;
+static pthread_once_t response_arena_once = PTHREAD_ONCE_INIT;
+
+static void response_arena_destroy(void *arena) {
+    arena_free(arena);
+    free(arena);
+}
+
+static void response_arena_key_create(void) {
+    pthread_key_create(&response_arena_key, response_arena_destroy);
+}
+
+/**
+ * @brief Returns the calling thread's decoding arena, creating it on first use.
  *
- * This function deserializes the attestation response, verifies the signature, replays the measurement log,
- * compares PCR values, and checks the measurement log against the RIM.
+ * Arenas are per thread rather than per session: a thread verifies one response at a time, so the memory held stays
+ * bounded by the number of workers however many sessions are open.
+ */
+static Arena *response_arena(void) {
+    pthread_once(&response_arena_once, response_arena_key_create);
+    Arena *arena = pthread_getspecific(response_arena_key);
+    if (!arena) {
+        arena = malloc(sizeof(*arena));
+        if (!arena) {
+            fprintf(stderr, "Error allocating memory for response arena\n");
+            return NULL;
+        }
+        arena_init(arena, 0);
+        if (pthread_setspecific(response_arena_key, arena) != 0) {
+            free(arena);
+            return NULL;
+        }
+    }
+    return arena;
+}
+
+// Sink of structured verdicts; NULL records none
+static VerdictLog *verifier_verdict_log = NULL;
+
+// Per-thread verdict of the response being verified; its event detail buffer is reused across responses
+static pthread_key_t verdict_key;
+static pthread_once_t verdict_once = PTHREAD_ONCE_INIT;
+
+static void verdict_destroy(void *verdict) {
+    rim_check_report_free(&((AttestationVerdict *)verdict)->rim);
+    free(verdict);
+}
+
+static void verdict_key_create(void) {
+    pthread_key_create(&verdict_key, verdict_destroy);
+}
+
+/**
+ * @brief Sets where structured verdicts are queued.
  *
- * @param[in]  response_buffer     Pointer to the buffer containing the serialized response.
- * @param[in]  response_size       Size of the response buffer.
- * @param[out] attestation_result  Pointer to an integer where the attestation result will be stored (0 = pass, -1 = fail).
+ * @param[in] log  Verdict log; must outlive the verifier. NULL records no verdicts.
+ */
+void verifier_set_verdict_log(VerdictLog *log) {
+    verifier_verdict_log = log;
+}
+
+/**
+ * @brief Returns the calling thread's verdict, or NULL when no verdict log is set.
+ */
+static AttestationVerdict *current_verdict(void) {
+    if (!verifier_verdict_log) {
+        return NULL;
+    }
+    pthread_once(&verdict_once, verdict_key_create);
+    AttestationVerdict *verdict = pthread_getspecific(verdict_key);
+    if (!verdict) {
+        verdict = calloc(1, sizeof(*verdict));
+        if (!verdict) {
+            fprintf(stderr, "Error allocating memory for verdict\n");
+            return NULL;
+        }
+        if (pthread_setspecific(verdict_key, verdict) != 0) {
+            free(verdict);
+            return NULL;
+        }
+    }
+    return verdict;
+}
+
+/**
+ * @brief Records why the current response failed; the first reason given is kept.
+ */
+static void verdict_fail(VerdictReason reason) {
+    AttestationVerdict *verdict = current_verdict();
+    if (verdict && verdict->reason == VERDICT_REASON_NONE) {
+        verdict->reason = reason;
+    }
+}
+
+/**
+ * @brief Returns the RIM check report of the current response, or NULL when no verdict log is set.
+ */
+static RIM_CheckReport *current_rim_report(void) {
+    AttestationVerdict *verdict = current_verdict();
+    return verdict ? &verdict->rim : NULL;
+}
+
+/**
+ * @brief Views a received inclusion proof as a NonceProof; every sibling must be a tree node.
+ */
+static int response_nonce_proof(const NonceInclusionProof *received, NonceProof *proof) {
+    if (received->n_siblings > NONCE_TREE_MAX_DEPTH) {
+        return -1;
+    }
+    proof->leaf_index = received->leaf_index;
+    proof->leaf_count = received->leaf_count;
+    proof->sibling_count = (uint32_t)received->n_siblings;
+    for (size_t i = 0; i < received->n_siblings; i++) {
+        if (received->siblings[i].len != NONCE_TREE_DIGEST_SIZE) {
+            return -1;
+        }
+        proof->siblings[i] = received->siblings[i].data;
+    }
+    return 0;
+}
+
+static int verify_parsed_quote(const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size,
+                               const NonceProof *proof);
+
+/**
+ * @brief Appends an attestation whose log was verified, passed or not, to the archive.
  *
- * @return Returns 0 on success, or -1 on failure.
+ * Only records after a prefix the verifier already holds are archived, as a child of the attestor's previous
+ * record: a prefix that was not verified again this round is not archived again.
+ *
+ * @param[in] response     Decoded response.
+ * @param[in] log          The whole log, or the header followed by the records of a delta.
+ * @param[in] log_size     Size of the log.
+ * @param[in] base_offset  Offset in log of the first record after the prefix; 0 if there is none.
+ * @param[in] base_events  Records in the prefix; 0 if there is none.
+ * @param[in] base_size    Size of the prefix in the whole log.
+ * @param[in] verified     Whether the log verified.
  */
-int process_attestation_response(uint8_t *response_buffer, size_t response_size, int *attestation_result) {
-    // Deserialize the response
-    AttestationResponse *response = attestation_response__unpack(NULL, response_size, response_buffer);
+static void archive_attestation(const AttestationResponse *response, const uint8_t *log, size_t log_size,
+                                size_t base_offset, uint64_t base_events, uint64_t base_size, int verified) {
+    struct timespec now;
+    if (!verifier_archive || !response->attestor_id) {
+        return;
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    ArchiveAttestation attestation = {
+        .attestor_id = response->attestor_id,
+        .log = log,
+        .log_size = log_size,
+        .base_offset = base_offset,
+        .base_events = base_events,
+        .base_size = base_size,
+        .quote = response->quote.data,
+        .quote_size = response->quote.len,
+        .result = verified ? 0 : -1,
+        .timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec,
+    };
+    uint64_t stage_start = verifier_metrics_start();
+    int rc = event_archive_append(verifier_archive, &attestation, NULL);
+    verifier_metrics_stage_end(VERIFIER_STAGE_ARCHIVE, stage_start, rc == 0);
+}
+
+/**
+ * @brief Verifies a response in the calling thread's arena; process_attestation_response() times and counts it.
+ */
+static int verify_attestation_response(uint8_t *response_buffer, size_t response_size, const uint8_t *nonce,
+                                       size_t nonce_size, const VerifierKnownLog *known, int *attestation_result) {
+    TPM_Quote quote;
+
+    Arena *arena = response_arena();
+    if (!arena) {
+        *attestation_result = -1;
+        return -1;
+    }
+
+    // Deserialize the response; its bytes fields point into response_buffer
+    uint64_t stage_start = verifier_metrics_start();
+    AttestationResponse *response = attestation_response_decode(arena, response_buffer, response_size);
     if (!response) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_DECODE, stage_start, false);
+        verdict_fail(VERDICT_REASON_MALFORMED);
         fprintf(stderr, "Error unpacking AttestationResponse\n");
+        arena_reset(arena);
+        *attestation_result = -1;
         return -1;
     }
-
-    // Placeholder: Verify the signature of the quote
-    if (!verify_quote_signature(response->quote.data, response->quote.len)) {
-        fprintf(stderr, "Quote signature verification failed\n");
-        attestation_response__free_unpacked(response, NULL);
+    NonceProof proof;
+    if (response->nonce_proof && response_nonce_proof(response->nonce_proof, &proof) != 0) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_DECODE, stage_start, false);
+        verdict_fail(VERDICT_REASON_MALFORMED);
+        fprintf(stderr, "Malformed nonce inclusion proof\n");
+        arena_reset(arena);
+        *attestation_result = -1;
+        return -1;
+    }
+    if (quote_parse(response->quote.data, response->quote.len, &quote) != 0) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_DECODE, stage_start, false);
+        verdict_fail(VERDICT_REASON_MALFORMED);
+        fprintf(stderr, "Malformed quote\n");
+        arena_reset(arena);
         *attestation_result = -1;
         return -1;
     }
+    verifier_metrics_stage_end(VERIFIER_STAGE_DECODE, stage_start, true);
 
-    // Placeholder: Replay the measurement log
-    uint8_t *replayed_pcrs = NULL;
-    size_t num_replayed_pcrs = 0;
-    if (!replay_measurement_log(response->measurement_log.data, response->measurement_log.len, &replayed_pcrs, &num_replayed_pcrs)) {
-        fprintf(stderr, "Measurement log replay failed\n");
-        attestation_response__free_unpacked(response, NULL);
+    // Verify the signature of the quote and that it answers this request, alone or in a batch
+    if (!verify_parsed_quote(&quote, nonce, nonce_size, response->nonce_proof ? &proof : NULL)) {
+        verdict_fail(VERDICT_REASON_QUOTE);
+        fprintf(stderr, "Quote signature verification failed\n");
+        arena_reset(arena);
         *attestation_result = -1;
         return -1;
     }
 
-    // Placeholder: Compare replayed PCRs with received PCR values
-    if (!compare_pcr_values(response->pcr_values.data, response->pcr_values.len, replayed_pcrs)) {
-        fprintf(stderr, "PCR value comparison failed\n");
-        free(replayed_pcrs);
-        attestation_response__free_unpacked(response, NULL);
+    // Attestors answer in the highest version both sides speak; 0 is a version 1 attestor
+    const uint8_t *measurement_log;
+    size_t log_size;
+    stage_start = verifier_metrics_start();
+    if (response->protocol_version > ATTESTATION_PROTOCOL_VERSION ||
+        attestation_response_log(arena, response, verifier_dictionary, &measurement_log, &log_size) != 0) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_PARSE, stage_start, false);
+        verdict_fail(VERDICT_REASON_LOG_FORMAT);
+        fprintf(stderr, "Unsupported or malformed measurement log (protocol version %u)\n",
+                response->protocol_version);
+        arena_reset(arena);
         *attestation_result = -1;
         return -1;
     }
 
-    // Placeholder: Check measurement log against RIM
-    if (!check_measurement_log_against_rim(response->measurement_log.data, response->measurement_log.len)) {
-        fprintf(stderr, "Measurement log validation against RIM failed\n");
-        free(replayed_pcrs);
-        attestation_response__free_unpacked(response, NULL);
+    // Replay the measurement log, compare with the reported PCRs and check it against the RIM
+    int verified;
+    if (response->log_base_events > 0) {
+        // A delta carries only the records after the verifier's checkpoint; put the header back in front of them
+        size_t header_size = response->log_header.len;
+        uint8_t *delta_log = arena_alloc(arena, header_size + log_size);
+        if (!delta_log || header_size == 0) {
+            verifier_metrics_stage_end(VERIFIER_STAGE_PARSE, stage_start, false);
+            verdict_fail(VERDICT_REASON_LOG_FORMAT);
+            fprintf(stderr, "Delta measurement log without a header\n");
+            arena_reset(arena);
+            *attestation_result = -1;
+            return -1;
+        }
+        memcpy(delta_log, response->log_header.data, header_size);
+        if (log_size > 0) {
+            memcpy(delta_log + header_size, measurement_log, log_size);
+        }
+        verifier_metrics_stage_end(VERIFIER_STAGE_PARSE, stage_start, true);
+        verified = verify_measurement_log_delta(response->attestor_id, known, response->log_base_events,
+                                                response->log_base_size, &response->log_base_digest, delta_log,
+                                                header_size + log_size, header_size, response->pcrs,
+                                                response->n_pcrs, &quote);
+        archive_attestation(response, delta_log, header_size + log_size, header_size, response->log_base_events,
+                            response->log_base_size, verified);
+    } else {
+        verifier_metrics_stage_end(VERIFIER_STAGE_PARSE, stage_start, true);
+        uint64_t base_events;
+        uint64_t base_size;
+        verified = verify_measurement_log(response->attestor_id, measurement_log, log_size, response->pcrs,
+                                          response->n_pcrs, &quote, &base_events, &base_size);
+        archive_attestation(response, measurement_log, log_size, (size_t)base_size, base_events, base_size,
+                            verified);
+    }
+
+    if (!verified) {
+        arena_reset(arena);
         *attestation_result = -1;
         return -1;
     }
 
-    // If all checks pass
-    printf("Attestation successful\n");
+    // If all checks pass; the verdict log records the result, so it is only reported when debugging
+    if (verifier_debug) {
+        fprintf(stderr, "Attestation successful\n");
+    }
     *attestation_result = 0;
 
     // Clean up
-    free(replayed_pcrs);
-    attestation_response__free_unpacked(response, NULL);
+    arena_reset(arena);
 
     return 0;  // Success
 }
 
 /**
- * @brief Placeholder function to verify the signature of the quote.
+ * @brief Processes the attestation response received from the attestor.
+ *
+ * This function deserializes the attestation response, verifies the signature, replays the measurement log,
+ * compares PCR values, and checks the measurement log against the RIM. The response is decoded in place into the
+ * calling thread's arena, so the buffer must stay valid until the function returns. Each stage is timed when
+ * metrics are enabled (see verifier_metrics.h). The RIM is pinned for the whole response: a RIM published while
+ * it is verified applies from the next response on, and the verdict records the version that was used.
  *
- * @param[in] quote       Pointer to the quote data.
- * @param[in] quote_size  Size of the quote data.
+ * @param[in]  response_buffer     Pointer to the buffer containing the serialized response.
+ * @param[in]  response_size       Size of the response buffer.
+ * @param[in]  nonce               Nonce of the request the response answers.
+ * @param[in]  nonce_size          Size of the nonce.
+ * @param[in]  known               Log prefix that request offered, or NULL if it offered none.
+ * @param[out] attestation_result  Pointer to an integer where the attestation result will be stored (0 = pass, -1 = fail).
+ *
+ * @return Returns 0 on success, or -1 on failure.
+ */
+int process_attestation_response(uint8_t *response_buffer, size_t response_size, const uint8_t *nonce,
+                                 size_t nonce_size, const VerifierKnownLog *known, int *attestation_result) {
+    uint64_t rim_version;
+    const RIM_Index *rim = pin_rim(&rim_version);
+    AttestationVerdict *verdict = current_verdict();
+    if (verdict) {
+        VerdictLevel level = verdict_log_level(verifier_verdict_log);
+        rim_check_report_reset(&verdict->rim, level == VERDICT_LEVEL_EVENTS     ? EVENT_DETAIL_ALL
+                                              : level == VERDICT_LEVEL_FAILURES ? EVENT_DETAIL_FAILURES
+                                                                                : EVENT_DETAIL_NONE);
+        verdict->reason = VERDICT_REASON_NONE;
+        verdict->rim_cached = false;
+    }
+
+    uint64_t start = verifier_metrics_start();
+    int rc = verify_attestation_response(response_buffer, response_size, nonce, nonce_size, known,
+                                         attestation_result);
+    bool passed = rc == 0 && *attestation_result == 0;
+    verifier_metrics_stage_end(VERIFIER_STAGE_ATTESTATION, start, passed);
+    verifier_metrics_count(passed ? VERIFIER_COUNTER_PASSED : VERIFIER_COUNTER_FAILED, 1);
+
+    if (verdict) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        verdict->timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+        verdict->result = passed ? 0 : -1;
+        verdict->rim_version = rim_version;
+        if (rim) {
+            memcpy(verdict->rim_digest, rim->content_digest, sizeof(verdict->rim_digest));
+        } else {
+            memset(verdict->rim_digest, 0, sizeof(verdict->rim_digest));
+        }
+        if (attestation_response_peek_attestor_id(response_buffer, response_size, verdict->attestor_id,
+                                                  sizeof(verdict->attestor_id)) != 0) {
+            verdict->attestor_id[0] = '\0';
+        }
+        verdict_log_submit(verifier_verdict_log, verdict);
+    }
+    unpin_rim(rim);
+    return rc;
+}
+
+// Attestation keys the quotes are verified against
+static const AK_Cache *verifier_ak_cache = NULL;
+
+/**
+ * @brief Sets the attestation keys quotes are verified against.
+ *
+ * @param[in] ak_cache  Cache of enrolled attestation keys; must outlive the verifier.
+ */
+void verifier_set_ak_cache(const AK_Cache *ak_cache) {
+    verifier_ak_cache = ak_cache;
+}
+
+/**
+ * @brief Verifies the signature of the quote.
+ *
+ * The quote must be a TPM-generated quote over the request's nonce, signed by an enrolled attestation key. A
+ * coalesced quote is over the root of a tree of nonces instead, and must come with a proof that the tree holds
+ * this request's nonce.
+ *
+ * @param[in]  quote         Pointer to the quote data (TPM2B_ATTEST followed by TPMT_SIGNATURE).
+ * @param[in]  quote_size    Size of the quote data.
+ * @param[in]  nonce         Nonce of the request.
+ * @param[in]  nonce_size    Size of the nonce.
+ * @param[in]  proof         Inclusion proof of the nonce for a coalesced quote, or NULL.
+ * @param[out] parsed_quote  Parsed quote, for checking its PCR digest once the log is replayed.
  *
  * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
  */
-int verify_quote_signature(const uint8_t *quote, size_t quote_size) {
-    // TODO: Implement signature verification
-    // For demonstration purposes, we'll assume the signature is valid
-    return 1;  // Success
+int verify_quote_signature(const uint8_t *quote, size_t quote_size, const uint8_t *nonce, size_t nonce_size,
+                           const NonceProof *proof, TPM_Quote *parsed_quote) {
+    if (quote_parse(quote, quote_size, parsed_quote) != 0) {
+        fprintf(stderr, "Malformed quote\n");
+        return 0;
+    }
+    return verify_parsed_quote(parsed_quote, nonce, nonce_size, proof);
 }
 
 /**
- * @brief Placeholder function to replay the measurement log.
+ * @brief Verifies the signature, nonce and key of a quote already parsed; see verify_quote_signature().
+ */
+static int verify_parsed_quote(const TPM_Quote *quote, const uint8_t *nonce, size_t nonce_size,
+                               const NonceProof *proof) {
+    if (!verifier_ak_cache) {
+        fprintf(stderr, "No attestation keys enrolled\n");
+        return 0;
+    }
+    if (proof) {
+        return quote_verify_coalesced(verifier_ak_cache, quote, nonce, nonce_size, proof) == 0;
+    }
+    return quote_verify(verifier_ak_cache, quote, nonce, nonce_size) == 0;
+}
+
+/**
+ * @brief Replays the measurement log.
+ *
+ * Every PCR is extended in every bank listed in the log's Spec ID header (SHA-1/256/384/512), starting from the
+ * power-on values.
  *
  * @param[in]  measurement_log     Pointer to the measurement log data.
  * @param[in]  log_size            Size of the measurement log data.
- * @param[out] replayed_pcrs       Pointer to the buffer where replayed PCRs will be stored.
- * @param[out] num_pcrs            Pointer to a size_t variable where the number of replayed PCRs will be stored.
+ * @param[out] replayed_pcrs       Bank set receiving the replayed PCR values.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+int replay_measurement_log(const uint8_t *measurement_log, size_t log_size, PCR_BankSet *replayed_pcrs) {
+    if (!measurement_log || log_size == 0 || !replayed_pcrs) {
+        fprintf(stderr, "Measurement log replay failed: Invalid input\n");
+        return 0;
+    }
+    return pcr_replay_log(measurement_log, log_size, replayed_pcrs) == 0;
+}
+
+/**
+ * @brief Compares the PCR values reported by the attestor with the replayed values.
+ *
+ * Reported values are SHA-256 PCRs, as carried by the PCR message.
+ *
+ * @param[in] pcrs           Reported PCR values.
+ * @param[in] num_pcrs       Number of reported PCR values.
+ * @param[in] replayed_pcrs  Replayed PCR values.
+ *
+ * @return Returns non-zero (e.g., 1) if every reported PCR matches, or 0 otherwise.
+ */
+int compare_pcr_values(PCR **pcrs, size_t num_pcrs, const PCR_BankSet *replayed_pcrs) {
+    const PCR_Bank *bank = pcr_bankset_find(replayed_pcrs, TPM2_ALG_SHA256);
+    if (!bank) {
+        fprintf(stderr, "Measurement log has no SHA-256 bank\n");
+        return 0;
+    }
+
+    for (size_t i = 0; i < num_pcrs; i++) {
+        int index = pcrs[i]->index;
+        if (index < 0 || index >= TPM_PCR_COUNT) {
+            fprintf(stderr, "Reported PCR index %d out of range\n", index);
+            return 0;
+        }
+        const TPM2B_DIGEST *expected = &bank->pcrs[index];
+        if (pcrs[i]->value.len != expected->size ||
+            memcmp(pcrs[i]->value.data, expected->buffer, expected->size) != 0) {
+            fprintf(stderr, "PCR %d does not match the replayed measurement log\n", index);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Sets the RIM index used by check_measurement_log_against_rim().
+ *
+ * @param[in] rim_index  Index built from the reference manifest; must outlive the verifier.
+ */
+void verifier_set_rim_index(const RIM_Index *rim_index) {
+    verifier_rim_index = rim_index;
+}
+
+/**
+ * @brief Sets the RIM store whose current version the measurement logs are checked against.
+ *
+ * A store takes precedence over an index set with verifier_set_rim_index(). Versions published to it while the
+ * verifier runs apply to every response verified afterwards.
+ *
+ * @param[in] store  RIM store; must outlive the verifier. NULL goes back to the fixed index.
+ */
+void verifier_set_rim_store(RimStore *store) {
+    verifier_rim_store = store;
+}
+
+/**
+ * @brief Checks every event of the measurement log against a pinned RIM.
+ */
+static int check_log_against_rim(const RIM_Index *rim, const uint8_t *measurement_log, size_t log_size) {
+    TCG_EventLogCursor cursor;
+    if (!rim) {
+        fprintf(stderr, "No RIM loaded\n");
+        return 0;
+    }
+    RIM_CheckReport *report = current_rim_report();
+    if (!report) {
+        return process_event_log(measurement_log, log_size, rim);
+    }
+    if (tcg_log_cursor_init(&cursor, measurement_log, log_size) != TCG_LOG_OK) {
+        return 0;
+    }
+    return process_event_log_report(&cursor, rim, report);
+}
+
+/**
+ * @brief Checks every event of the measurement log against the RIM.
+ *
+ * @param[in] measurement_log     Pointer to the measurement log data.
+ * @param[in] log_size            Size of the measurement log data.
  *
  * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
  */
-int replay_measurement_log(const uint8_t *measurement_log, size_t log_size, uint8_t **replayed_pcrs, size_t *num_pcrs) {
-    // TODO: Implement measurement log replay
-    // For demonstration purposes, we'll create dummy data
-    *num_pcrs = TPM_PCR_COUNT;
-    size_t pcr_data_size = *num_pcrs * sizeof(uint8_t);  // Assuming 1 byte per PCR for simplicity
-    *replayed_pcrs = malloc(pcr_data_size);
-    if (*replayed_pcrs == NULL) {
-        fprintf(stderr, "Error allocating​⬤
\ No newline at end of file
+int check_measurement_log_against_rim(const uint8_t *measurement_log, size_t log_size) {
+    const RIM_Index *rim = pin_rim(NULL);
+    int accepted = check_log_against_rim(rim, measurement_log, log_size);
+    unpin_rim(rim);
+    return accepted;
+}
+
+/**
+ * @brief Sets the checkpoint store used for incremental replay.
+ *
+ * @param[in] store  Checkpoint store; must outlive the verifier. NULL replays every log in full.
+ */
+void verifier_set_checkpoint_store(CheckpointStore *store) {
+    verifier_checkpoints = store;
+}
+
+/**
+ * @brief Names the checkpoint of the attestation key that signed a verified quote: the hex of the qualified name
+ *        in its qualifiedSigner.
+ *
+ * The quote was verified with the key enrolled under that qualified name, which the AK cache derived from the
+ * key's public area and its parent, so unlike the attestor ID in the response it cannot be claimed by another
+ * device.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 if the quote names no key.
+ */
+static int checkpoint_key(const TPM_Quote *quote, char key[CHECKPOINT_KEY_MAX]) {
+    const TPM2B_NAME *qualified_name = &quote->attest.qualifiedSigner;
+    if (qualified_name->size == 0 || 2 * (size_t)qualified_name->size >= CHECKPOINT_KEY_MAX) {
+        return 0;
+    }
+    for (size_t i = 0; i < qualified_name->size; i++) {
+        snprintf(key + 2 * i, 3, "%02x", qualified_name->name[i]);
+    }
+    return 1;
+}
+
+/**
+ * @brief Records the attestor ID a key presented, for the hint in its next request; IDs that do not fit are dropped.
+ */
+static void checkpoint_note_attestor(VerifierCheckpoint *checkpoint, const char *attestor_id) {
+    if (attestor_id && strlen(attestor_id) < sizeof(checkpoint->attestor_id)) {
+        strcpy(checkpoint->attestor_id, attestor_id);
+    } else {
+        checkpoint->attestor_id[0] = '\0';
+    }
+}
+
+/**
+ * @brief Replays only the records appended after a checkpoint, starting from its PCR state.
+ *
+ * The records start at base_offset in the buffer: the checkpoint's byte_offset for a whole log, or the end of the
+ * header record for a delta.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+static int replay_measurement_log_suffix(const VerifierCheckpoint *checkpoint, const uint8_t *measurement_log,
+                                         size_t log_size, size_t base_offset, PCR_BankSet *replayed_pcrs) {
+    TCG_EventLogCursor cursor;
+    if (checkpoint_seek_suffix(checkpoint, measurement_log, log_size, base_offset, &cursor) != 0) {
+        return 0;
+    }
+    *replayed_pcrs = checkpoint->pcrs;
+    return pcr_replay_events(replayed_pcrs, &cursor, NULL) == 0;
+}
+
+/**
+ * @brief Checks only the records appended after a checkpoint against the RIM.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+static int check_measurement_log_suffix_against_rim(const RIM_Index *rim, const VerifierCheckpoint *checkpoint,
+                                                    const uint8_t *measurement_log, size_t log_size,
+                                                    size_t base_offset) {
+    TCG_EventLogCursor cursor;
+    if (!rim) {
+        fprintf(stderr, "No RIM loaded\n");
+        return 0;
+    }
+    if (checkpoint_seek_suffix(checkpoint, measurement_log, log_size, base_offset, &cursor) != 0) {
+        return 0;
+    }
+    return process_event_log_report(&cursor, rim, current_rim_report());
+}
+
+// Fleet-wide verdicts of whole logs; NULL verifies every full log from scratch
+static VerdictCache *verifier_verdicts = NULL;
+static uint32_t verifier_policy_version = 0;
+
+/**
+ * @brief Sets the verdict cache consulted before a full replay.
+ *
+ * @param[in] cache           Verdict cache; must outlive the verifier. NULL disables caching.
+ * @param[in] policy_version  Version of the verification policy, part of every cache key; bump it whenever what
+ *                            makes a log acceptable changes without the RIM changing.
+ */
+void verifier_set_verdict_cache(VerdictCache *cache, uint32_t policy_version) {
+    verifier_verdicts = cache;
+    verifier_policy_version = policy_version;
+}
+
+// Parallel replay and RIM check of large full logs; NULL verifies them on the calling thread
+static LogPipeline *verifier_pipeline = NULL;
+
+/**
+ * @brief Sets the pipeline large full logs are verified on.
+ *
+ * @param[in] pipeline  Log pipeline; must outlive the verifier. NULL disables parallel verification.
+ */
+void verifier_set_log_pipeline(LogPipeline *pipeline) {
+    verifier_pipeline = pipeline;
+}
+
+/**
+ * @brief Sets the dictionary requests advertise and compressed logs are decompressed with.
+ *
+ * @param[in] dictionary  Log dictionary; must outlive the verifier. NULL takes every log uncompressed.
+ */
+void verifier_set_log_dictionary(const LogDictionary *dictionary) {
+    verifier_dictionary = dictionary;
+}
+
+/**
+ * @brief Sets the archive every attestation whose log was verified is appended to.
+ *
+ * @param[in] archive  Event archive; must outlive the verifier. NULL archives nothing.
+ */
+void verifier_set_event_archive(EventArchive *archive) {
+    verifier_archive = archive;
+}
+
+/**
+ * @brief Reports every passed attestation and every checkpoint the verifier falls back from on stderr.
+ *
+ * @param[in] debug  true to report them. They are not reported by default: they happen on every attestation, and
+ *                   the verdict log already records each result.
+ */
+void verifier_set_debug(bool debug) {
+    verifier_debug = debug;
+}
+
+/**
+ * @brief Verifies a whole measurement log: replay, PCR comparison, quoted PCR digest and RIM check.
+ *
+ * The replay and RIM check depend only on the log, the RIM and the policy, so their outcome is taken from the
+ * verdict cache when another attestor already sent the same log. The reported PCRs and the quote are still
+ * checked against the (cached) replayed values for every response.
+ *
+ * Logs the log pipeline accepts are replayed and checked against the RIM together on its threads, before the PCR
+ * comparison; the replay stage then times both.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+static int verify_full_measurement_log(const RIM_Index *rim, const uint8_t *measurement_log, size_t log_size,
+                                       PCR **pcrs, size_t num_pcrs, const TPM_Quote *quote,
+                                       PCR_BankSet *replayed_pcrs) {
+    VerdictKey key;
+    LogVerdict verdict;
+    bool cached = verifier_verdicts && rim &&
+                  verdict_cache_key(&key, measurement_log, log_size, rim, verifier_policy_version) == 0;
+    uint64_t stage_start = verifier_metrics_start();
+    bool hit = cached && verdict_cache_lookup(verifier_verdicts, &key, &verdict, replayed_pcrs) == 0;
+
+    verifier_metrics_count(VERIFIER_COUNTER_FULL_REPLAYS, 1);
+    verifier_metrics_count(VERIFIER_COUNTER_VERDICT_HITS, hit);
+    AttestationVerdict *attestation_verdict = current_verdict();
+    if (attestation_verdict) {
+        attestation_verdict->rim_cached = hit;
+    }
+    if (hit && verdict != LOG_VERDICT_ACCEPTED) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, false);
+        verdict_fail(VERDICT_REASON_RIM);
+        fprintf(stderr, "Measurement log was already rejected\n");
+        return 0;
+    }
+    bool pipelined = !hit && rim && log_pipeline_accepts(verifier_pipeline, log_size);
+    bool rim_accepted = false;
+    bool replayed = hit;
+    if (pipelined) {
+        replayed = log_pipeline_verify(verifier_pipeline, measurement_log, log_size, rim, replayed_pcrs,
+                                       current_rim_report(), &rim_accepted) == 0;
+    } else if (!hit) {
+        replayed = replay_measurement_log(measurement_log, log_size, replayed_pcrs);
+    }
+    if (!replayed) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, false);
+        verdict_fail(VERDICT_REASON_LOG_FORMAT);
+        fprintf(stderr, "Measurement log replay failed\n");
+        if (cached) {
+            verdict_cache_insert(verifier_verdicts, &key, LOG_VERDICT_REJECTED, NULL);
+        }
+        return 0;
+    }
+    if (!compare_pcr_values(pcrs, num_pcrs, replayed_pcrs)) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, false);
+        verdict_fail(VERDICT_REASON_PCR_MISMATCH);
+        fprintf(stderr, "PCR value comparison failed\n");
+        return 0;
+    }
+    if (quote_check_pcr_digest(quote, replayed_pcrs) != 0) {
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, false);
+        verdict_fail(VERDICT_REASON_PCR_MISMATCH);
+        fprintf(stderr, "Quoted PCR digest does not match the replayed measurement log\n");
+        return 0;
+    }
+    verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, true);
+    if (!hit) {
+        int accepted = rim_accepted;
+        if (!pipelined) {
+            stage_start = verifier_metrics_start();
+            accepted = check_log_against_rim(rim, measurement_log, log_size);
+            verifier_metrics_stage_end(VERIFIER_STAGE_RIM, stage_start, accepted);
+        }
+        if (cached) {
+            verdict_cache_insert(verifier_verdicts, &key, accepted ? LOG_VERDICT_ACCEPTED : LOG_VERDICT_REJECTED,
+                                 replayed_pcrs);
+        }
+        if (!accepted) {
+            verdict_fail(VERDICT_REASON_RIM);
+            fprintf(stderr, "Measurement log validation against RIM failed\n");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Verifies a measurement log: replay, PCR comparison and RIM check.
+ *
+ * When the attestor has a checkpoint whose prefix the log extends, only the appended records are replayed and
+ * checked, so the cost of a round is O(new events). If the incremental replay does not reproduce the reported PCRs
+ * (for example after a reboot reset the log) the full log is verified instead, through the verdict cache if one is
+ * set. If the RIM changed since the checkpoint's prefix was checked, the suffix is still replayed alone but the
+ * whole log is checked against the new RIM. A successful verification advances the checkpoint; a failed one drops
+ * it. Checkpoints belong to the attestation key that signed the quote.
+ *
+ * @param[in] attestor_id      Attestor ID the response claims; only a hint for the next request.
+ * @param[in] measurement_log  Pointer to the measurement log data.
+ * @param[in] log_size         Size of the measurement log data.
+ * @param[in] pcrs             PCR values reported by the attestor.
+ * @param[in] num_pcrs         Number of reported PCR values.
+ * @param[in] quote            Verified quote, whose PCR digest the replayed values must produce.
+ * @param[out] base_events     Records of the prefix taken from the checkpoint, or 0 if the whole log was verified.
+ * @param[out] base_size       Size of that prefix, or 0.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+int verify_measurement_log(const char *attestor_id, const uint8_t *measurement_log, size_t log_size,
+                           PCR **pcrs, size_t num_pcrs, const TPM_Quote *quote, uint64_t *base_events,
+                           uint64_t *base_size) {
+    VerifierCheckpoint checkpoint;
+    PCR_BankSet replayed_pcrs;
+    char key[CHECKPOINT_KEY_MAX];
+    const RIM_Index *rim = pin_rim(NULL);
+    bool use_checkpoint = verifier_checkpoints && checkpoint_key(quote, key);
+
+    bool incremental = use_checkpoint &&
+                       checkpoint_store_get(verifier_checkpoints, key, &checkpoint) == 0 &&
+                       checkpoint_matches_log(&checkpoint, measurement_log, log_size);
+    if (incremental) {
+        uint64_t stage_start = verifier_metrics_start();
+        incremental = replay_measurement_log_suffix(&checkpoint, measurement_log, log_size, checkpoint.byte_offset,
+                                                    &replayed_pcrs) &&
+                      compare_pcr_values(pcrs, num_pcrs, &replayed_pcrs) &&
+                      quote_check_pcr_digest(quote, &replayed_pcrs) == 0;
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, incremental);
+        if (!incremental) {
+            if (verifier_debug) {
+                fprintf(stderr, "Checkpoint of key %s does not reproduce the reported PCRs; replaying the full log\n",
+                        key);
+            }
+        }
+    }
+
+    bool rim_unchanged = incremental && rim &&
+                         memcmp(checkpoint.rim_digest, rim->content_digest, sizeof(checkpoint.rim_digest)) == 0;
+    if (incremental && !rim_unchanged && !checkpoint_verify_prefix(&checkpoint, measurement_log, log_size)) {
+        // Rechecking reads the prefix, which the last record check does not authenticate
+        if (verifier_debug) {
+            fprintf(stderr, "Prefix sent by key %s is not the one its checkpoint accepted; replaying the full log\n",
+                    key);
+        }
+        incremental = false;
+    }
+
+    *base_events = incremental ? checkpoint.event_count : 0;
+    *base_size = incremental ? checkpoint.byte_offset : 0;
+
+    int verified;
+    if (incremental) {
+        uint64_t stage_start = verifier_metrics_start();
+        verifier_metrics_count(VERIFIER_COUNTER_INCREMENTAL, 1);
+        if (rim_unchanged) {
+            verified = check_measurement_log_suffix_against_rim(rim, &checkpoint, measurement_log, log_size,
+                                                                checkpoint.byte_offset);
+        } else {
+            // The prefix was accepted by an older RIM, which may have known measurements this one revokes
+            verifier_metrics_count(VERIFIER_COUNTER_RIM_RECHECKS, 1);
+            verified = check_log_against_rim(rim, measurement_log, log_size);
+        }
+        verifier_metrics_stage_end(VERIFIER_STAGE_RIM, stage_start, verified);
+        if (!verified) {
+            verdict_fail(VERDICT_REASON_RIM);
+            fprintf(stderr, "Measurement log validation against RIM failed\n");
+        }
+    } else {
+        verified = verify_full_measurement_log(rim, measurement_log, log_size, pcrs, num_pcrs, quote,
+                                               &replayed_pcrs);
+        if (use_checkpoint) {
+            memset(&checkpoint, 0, sizeof(checkpoint));
+            strcpy(checkpoint.key, key);
+        }
+    }
+
+    if (use_checkpoint) {
+        checkpoint_note_attestor(&checkpoint, attestor_id);
+        checkpoint.pcrs = replayed_pcrs;
+        if (verified) {
+            memcpy(checkpoint.rim_digest, rim->content_digest, sizeof(checkpoint.rim_digest));
+        }
+        if (!verified || checkpoint_advance(&checkpoint, measurement_log, log_size) != 0 ||
+            checkpoint_store_put(verifier_checkpoints, &checkpoint) != 0) {
+            checkpoint_store_remove(verifier_checkpoints, key);
+        }
+    }
+    unpin_rim(rim);
+    return verified;
+}
+
+/**
+ * @brief Verifies a delta response: the records an attestor appended after the prefix the verifier holds.
+ *
+ * Nothing the attestor says about the prefix is trusted. The base it names must be the prefix the request offered,
+ * and that offer must still be the checkpoint of the key that signed the quote: same record count, size and rolling
+ * digest, so a delta cannot be grafted onto a prefix the verifier never offered, or onto one that has since been
+ * replaced. The checkpoint's prefix must also have been checked against the pinned RIM, since only the new records
+ * are checked against it; a delta that crosses a RIM update fails, which drops the checkpoint so the next request
+ * asks for the whole log. The new records are replayed from the checkpoint's PCR state, so the quote still vouches
+ * for the whole log. On any failure the checkpoint is dropped, and the next request asks for the whole log.
+ *
+ * @param[in] attestor_id   Attestor ID the response claims; only a hint for the next request.
+ * @param[in] known         Prefix the request offered, or NULL if it offered none.
+ * @param[in] base_events   Records in the prefix the delta says it follows.
+ * @param[in] base_size     Size of that prefix in bytes.
+ * @param[in] base_digest   Rolling digest of that prefix.
+ * @param[in] log           Header record of the log followed by the new records.
+ * @param[in] log_size      Size of log.
+ * @param[in] header_size   Size of the header record.
+ * @param[in] pcrs          PCR values reported by the attestor.
+ * @param[in] num_pcrs      Number of reported PCR values.
+ * @param[in] quote         Verified quote, whose PCR digest the replayed values must produce.
+ *
+ * @return Returns non-zero (e.g., 1) on success, or 0 on failure.
+ */
+int verify_measurement_log_delta(const char *attestor_id, const VerifierKnownLog *known, uint64_t base_events,
+                                 uint64_t base_size, const ProtobufCBinaryData *base_digest, const uint8_t *log,
+                                 size_t log_size, size_t header_size, PCR **pcrs, size_t num_pcrs,
+                                 const TPM_Quote *quote) {
+    VerifierCheckpoint checkpoint;
+    PCR_BankSet replayed_pcrs;
+    char key[CHECKPOINT_KEY_MAX];
+    if (!verifier_checkpoints || !checkpoint_key(quote, key)) {
+        verdict_fail(VERDICT_REASON_CHECKPOINT);
+        fprintf(stderr, "Delta measurement log received without a checkpoint store\n");
+        return 0;
+    }
+
+    verifier_metrics_count(VERIFIER_COUNTER_DELTAS, 1);
+    const RIM_Index *rim = pin_rim(NULL);
+    int verified = known && known->events > 0 && known->events == base_events && known->size == base_size &&
+                   base_digest->len == sizeof(known->digest) &&
+                   memcmp(base_digest->data, known->digest, sizeof(known->digest)) == 0 &&
+                   checkpoint_store_get(verifier_checkpoints, key, &checkpoint) == 0 &&
+                   checkpoint.event_count == known->events && checkpoint.byte_offset == known->size &&
+                   memcmp(checkpoint.prefix_digest, known->digest, sizeof(known->digest)) == 0;
+    if (!verified) {
+        verdict_fail(VERDICT_REASON_CHECKPOINT);
+        fprintf(stderr, "Delta measurement log of key %s does not follow the prefix its request offered\n", key);
+    } else if (!rim || memcmp(checkpoint.rim_digest, rim->content_digest, sizeof(checkpoint.rim_digest)) != 0) {
+        verified = 0;
+        verdict_fail(VERDICT_REASON_CHECKPOINT);
+        fprintf(stderr, "Checkpoint of key %s was checked against another RIM; its whole log is needed\n", key);
+    } else {
+        uint64_t stage_start = verifier_metrics_start();
+        verified = replay_measurement_log_suffix(&checkpoint, log, log_size, header_size, &replayed_pcrs) &&
+                   compare_pcr_values(pcrs, num_pcrs, &replayed_pcrs) &&
+                   quote_check_pcr_digest(quote, &replayed_pcrs) == 0;
+        verifier_metrics_stage_end(VERIFIER_STAGE_REPLAY, stage_start, verified);
+        if (!verified) {
+            verdict_fail(VERDICT_REASON_PCR_MISMATCH);
+            fprintf(stderr, "Delta measurement log of key %s does not reproduce the reported PCRs\n", key);
+        } else {
+            stage_start = verifier_metrics_start();
+            verified = check_measurement_log_suffix_against_rim(rim, &checkpoint, log, log_size, header_size);
+            verifier_metrics_stage_end(VERIFIER_STAGE_RIM, stage_start, verified);
+            if (!verified) {
+                verdict_fail(VERDICT_REASON_RIM);
+                fprintf(stderr, "Measurement log validation against RIM failed\n");
+            }
+        }
+    }
+
+    if (verified) {
+        checkpoint_note_attestor(&checkpoint, attestor_id);
+        checkpoint.pcrs = replayed_pcrs;
+        verified = checkpoint_advance_from(&checkpoint, log, log_size, header_size) == 0 &&
+                   checkpoint_store_put(verifier_checkpoints, &checkpoint) == 0;
+    }
+    if (!verified) {
+        checkpoint_store_remove(verifier_checkpoints, key);
+    }
+    unpin_rim(rim);
+    return verified;
+}
+
+void verifier_note_attestor(VerifierContext *ctx) {
+    if (attestation_response_peek_attestor_id(ctx->response_buffer, ctx->response_size, ctx->attestor_id,
+                                              sizeof(ctx->attestor_id)) != 0) {
+        ctx->attestor_id[0] = '\0';
+    }
+}
+
+/**
+ * @brief Runs the verifier side of the attestation protocol using a state machine.
+ *
+ * @param[in,out] ctx  Pointer to the VerifierContext structure.
+ */
+void run_verifier_protocol(VerifierContext *ctx) {
+    while (ctx->state != VERIFIER_STATE_DONE) {
+        switch (ctx->state) {
+            case VERIFIER_STATE_INIT:
+                ctx->request_buffer = NULL;
+                ctx->response_buffer = NULL;
+                ctx->attestation_result = -1;
+                ctx->state = VERIFIER_STATE_SEND_REQUEST;
+                break;
+
+            case VERIFIER_STATE_SEND_REQUEST:
+                if (create_attestation_request_for(ctx->attestor_id, ctx->nonce, sizeof(ctx->nonce), &ctx->known,
+                                                   &ctx->request_buffer, &ctx->request_size) == 0 &&
+                    send_attestation_request(ctx->request_buffer, ctx->request_size) == 0) {
+                    ctx->state = VERIFIER_STATE_WAIT_FOR_RESPONSE;
+                } else {
+                    ctx->state = VERIFIER_STATE_ERROR;
+                }
+                break;
+
+            case VERIFIER_STATE_WAIT_FOR_RESPONSE:
+                if (receive_attestation_response(ctx->nonce, sizeof(ctx->nonce), &ctx->response_buffer,
+                                                 &ctx->response_size) == 0) {
+                    ctx->state = VERIFIER_STATE_PROCESS_RESPONSE;
+                } else {
+                    ctx->state = VERIFIER_STATE_ERROR;
+                }
+                break;
+
+            case VERIFIER_STATE_PROCESS_RESPONSE:
+                if (process_attestation_response(ctx->response_buffer, ctx->response_size, ctx->nonce,
+                                                 sizeof(ctx->nonce), &ctx->known, &ctx->attestation_result) == 0) {
+                    verifier_note_attestor(ctx);
+                    ctx->state = VERIFIER_STATE_DONE;
+                } else {
+                    ctx->state = VERIFIER_STATE_ERROR;
+                }
+                break;
+
+            case VERIFIER_STATE_ERROR:
+                fprintf(stderr, "An error occurred during the attestation protocol\n");
+                ctx->attestation_result = -1;
+                ctx->state = VERIFIER_STATE_DONE;
+                break;
+
+            default:
+                fprintf(stderr, "Unknown state\n");
+                ctx->state = VERIFIER_STATE_ERROR;
+                break;
+        }
+    }
+
+    // Clean up
+    free(ctx->request_buffer);
+    ctx->request_buffer = NULL;
+    release_attestation_response(ctx->response_buffer);
+    ctx->response_buffer = NULL;
+}
@@ -0,0 +1,724 @@
+// verifier_daemon.c
+// Concurrent verifier service. A single epoll event loop owns every socket and timer, and the CPU-bound part of
+// each attestation runs on a work-stealing pool, so thousands of attestor sessions share a handful of threads.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "transport.h"
+#include "verifier.h"
+#include "verifier_daemon.h"
+#include "work_pool.h"
+
+#define DAEMON_MAX_EVENTS 256
+#define DAEMON_NOT_QUEUED ((size_t)-1)
+#define DAEMON_RETRY_DELAY_MS 1000
+#define DAEMON_MAX_BACKLOG 8                // Open-loop arrivals a busy session queues
+#define DAEMON_LATENCY_SUB_BUCKETS 8        // Latency histogram buckets per power of two, about 12% resolution
+#define DAEMON_LATENCY_BUCKETS (64 * DAEMON_LATENCY_SUB_BUCKETS)
+
+// Structures
+
+/**
+ * @struct VerifierSession
+ * @brief One attestor as seen by the daemon: its connection, its protocol context and its place on the timer heap.
+ */
+typedef struct VerifierSession {
+    VerifierContext ctx;                    /**< Protocol state, advanced as in run_verifier_protocol() */
+    VerifierDaemon *daemon;
+    struct sockaddr_storage address;        /**< Attestor address, if the session can reconnect */
+    socklen_t address_len;                  /**< 0 for sessions added by file descriptor */
+    TransportConnection connection;         /**< Framed connection; its fd is -1 while closed */
+    bool connecting;                        /**< Non-blocking connect in progress */
+    bool registered;                        /**< fd is in the epoll set */
+    bool finished;                          /**< Session has ended */
+    bool on_pool;                           /**< A worker owns ctx; set and cleared by the event loop only */
+    uint64_t rounds_done;
+    uint64_t due_ms;                        /**< Next round (INIT) or I/O deadline (SEND/WAIT) */
+    size_t heap_index;                      /**< Position on the timer heap, or DAEMON_NOT_QUEUED */
+    uint64_t round_start_us;                /**< Start of the current round, or its arrival in open loop */
+    uint64_t backlog[DAEMON_MAX_BACKLOG];   /**< Arrival times of open-loop rounds not yet started, oldest first */
+    uint32_t backlog_head;                  /**< Oldest entry of backlog */
+    uint32_t backlog_count;                 /**< Entries in backlog */
+    struct VerifierSession *next_completed; /**< Link on the completion stack */
+} VerifierSession;
+
+struct VerifierDaemon {
+    VerifierDaemonConfig config;
+    WorkPool *pool;
+    BufferPool *buffers;                    /**< Frame buffers shared by every session */
+    int epoll_fd;
+    int wake_fd;                            /**< eventfd signalled by workers and verifier_daemon_stop() */
+    VerifierSession **sessions;
+    size_t num_sessions;
+    size_t capacity;
+    VerifierSession **timers;               /**< Min-heap on due_ms */
+    size_t num_timers;
+    size_t active_sessions;
+    _Atomic(VerifierSession *) completed;   /**< Sessions whose verdict is in, pushed by workers */
+    atomic_bool stop_requested;
+    atomic_uint_fast64_t attestations;
+    atomic_uint_fast64_t passed;
+    atomic_uint_fast64_t failed;
+    atomic_uint_fast64_t io_errors;
+    atomic_uint_fast64_t dropped;
+    atomic_uint_fast64_t latency[DAEMON_LATENCY_BUCKETS]; /**< Round latencies, log-linear in microseconds */
+    atomic_uint_fast64_t latency_max_us;
+    uint64_t next_arrival_us;               /**< Next open-loop arrival */
+    uint64_t arrival_state;                 /**< PRNG state of the arrival process */
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Latency histogram
+
+/**
+ * @brief Maps a latency to its bucket: exact below DAEMON_LATENCY_SUB_BUCKETS microseconds, then
+ * DAEMON_LATENCY_SUB_BUCKETS buckets per power of two.
+ */
+static size_t latency_bucket(uint64_t us) {
+    if (us < DAEMON_LATENCY_SUB_BUCKETS) {
+        return (size_t)us;
+    }
+    int msb = 63 - __builtin_clzll(us);
+    size_t sub = (size_t)(us >> (msb - 3)) & (DAEMON_LATENCY_SUB_BUCKETS - 1);
+    return (size_t)(msb - 2) * DAEMON_LATENCY_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief Returns the smallest latency of a bucket.
+ */
+static uint64_t latency_bucket_floor(size_t bucket) {
+    if (bucket < DAEMON_LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    int msb = (int)(bucket / DAEMON_LATENCY_SUB_BUCKETS) + 2;
+    return (uint64_t)(DAEMON_LATENCY_SUB_BUCKETS + bucket % DAEMON_LATENCY_SUB_BUCKETS) << (msb - 3);
+}
+
+static void latency_record(VerifierDaemon *daemon, uint64_t us) {
+    atomic_fetch_add_explicit(&daemon->latency[latency_bucket(us)], 1, memory_order_relaxed);
+    uint_fast64_t max = atomic_load_explicit(&daemon->latency_max_us, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak(&daemon->latency_max_us, &max, us)) {
+    }
+}
+
+/**
+ * @brief Returns the latency below which a fraction of the recorded rounds fall, as the floor of its bucket.
+ */
+static uint64_t latency_percentile(const uint64_t *counts, uint64_t total, double fraction) {
+    uint64_t rank = (uint64_t)ceil(fraction * (double)total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < DAEMON_LATENCY_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank && seen > 0) {
+            return latency_bucket_floor(i);
+        }
+    }
+    return 0;
+}
+
+// Timer heap
+
+static void timer_swap(VerifierDaemon *daemon, size_t a, size_t b) {
+    VerifierSession *tmp = daemon->timers[a];
+    daemon->timers[a] = daemon->timers[b];
+    daemon->timers[b] = tmp;
+    daemon->timers[a]->heap_index = a;
+    daemon->timers[b]->heap_index = b;
+}
+
+static void timer_sift_up(VerifierDaemon *daemon, size_t i) {
+    while (i > 0 && daemon->timers[(i - 1) / 2]->due_ms > daemon->timers[i]->due_ms) {
+        timer_swap(daemon, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void timer_sift_down(VerifierDaemon *daemon, size_t i) {
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < daemon->num_timers && daemon->timers[left]->due_ms < daemon->timers[smallest]->due_ms) {
+            smallest = left;
+        }
+        if (right < daemon->num_timers && daemon->timers[right]->due_ms < daemon->timers[smallest]->due_ms) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        timer_swap(daemon, i, smallest);
+        i = smallest;
+    }
+}
+
+static void timer_remove(VerifierSession *session) {
+    VerifierDaemon *daemon = session->daemon;
+    size_t i = session->heap_index;
+    if (i == DAEMON_NOT_QUEUED) {
+        return;
+    }
+    daemon->num_timers--;
+    if (i != daemon->num_timers) {
+        timer_swap(daemon, i, daemon->num_timers);
+        timer_sift_down(daemon, i);
+        timer_sift_up(daemon, i);
+    }
+    session->heap_index = DAEMON_NOT_QUEUED;
+}
+
+/**
+ * @brief Arms the session's single timer, replacing any earlier deadline.
+ */
+static void timer_set(VerifierSession *session, uint64_t due_ms) {
+    VerifierDaemon *daemon = session->daemon;
+    timer_remove(session);
+    session->due_ms = due_ms;
+    session->heap_index = daemon->num_timers;
+    daemon->timers[daemon->num_timers++] = session;
+    timer_sift_up(daemon, session->heap_index);
+}
+
+// Sessions
+
+static int session_watch(VerifierSession *session, uint32_t events) {
+    struct epoll_event event = { .events = events, .data.ptr = session };
+    int op = session->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(session->daemon->epoll_fd, op, session->connection.fd, &event) != 0) {
+        return -1;
+    }
+    session->registered = true;
+    return 0;
+}
+
+static void session_unwatch(VerifierSession *session) {
+    if (session->registered) {
+        epoll_ctl(session->daemon->epoll_fd, EPOLL_CTL_DEL, session->connection.fd, NULL);
+        session->registered = false;
+    }
+}
+
+static void session_close(VerifierSession *session) {
+    session_unwatch(session);
+    transport_connection_close(&session->connection);
+    session->connecting = false;
+}
+
+static void session_free_buffers(VerifierSession *session) {
+    free(session->ctx.request_buffer);
+    session->ctx.request_buffer = NULL;
+    transport_frame_put(session->daemon->buffers, session->ctx.response_buffer);
+    session->ctx.response_buffer = NULL;
+}
+
+static void session_finish(VerifierSession *session) {
+    timer_remove(session);
+    session_close(session);
+    session_free_buffers(session);
+    session->finished = true;
+    session->daemon->active_sessions--;
+}
+
+/**
+ * @brief Books a finished round and schedules the next one.
+ *
+ * @param[in,out] session   Session whose round ended.
+ * @param[in]     io_error  Round was lost to a connection or framing error rather than decided.
+ */
+static void session_end_round(VerifierSession *session, bool io_error) {
+    VerifierDaemon *daemon = session->daemon;
+
+    if (io_error) {
+        atomic_fetch_add(&daemon->io_errors, 1);
+        session_close(session);
+    } else {
+        atomic_fetch_add(&daemon->attestations, 1);
+        atomic_fetch_add(session->ctx.attestation_result == 0 ? &daemon->passed : &daemon->failed, 1);
+        latency_record(daemon, now_us() - session->round_start_us);
+    }
+    session_free_buffers(session);
+    session->ctx.state = VERIFIER_STATE_INIT;
+    session->rounds_done++;
+
+    bool can_continue = session->connection.fd >= 0 || session->address_len > 0;
+    bool open_loop = daemon->config.arrival_rate > 0;
+    if (!can_continue || atomic_load(&daemon->stop_requested) ||
+        (!open_loop && daemon->config.rounds && session->rounds_done >= daemon->config.rounds)) {
+        session_finish(session);
+    } else if (open_loop) {
+        // The next round waits for its arrival, unless one is queued already
+        if (session->backlog_count > 0) {
+            timer_set(session, io_error ? now_ms() + DAEMON_RETRY_DELAY_MS : now_ms());
+        }
+    } else {
+        // Unreachable attestors are retried no faster than DAEMON_RETRY_DELAY_MS.
+        uint64_t delay = daemon->config.interval_ms;
+        if (io_error && delay < DAEMON_RETRY_DELAY_MS) {
+            delay = DAEMON_RETRY_DELAY_MS;
+        }
+        timer_set(session, now_ms() + delay);
+    }
+}
+
+/**
+ * @brief Worker side of a session: verifies the response that the event loop has read.
+ */
+static void session_process_task(void *arg) {
+    VerifierSession *session = arg;
+    VerifierDaemon *daemon = session->daemon;
+
+    if (process_attestation_response(session->ctx.response_buffer, session->ctx.response_size, session->ctx.nonce,
+                                     sizeof(session->ctx.nonce), &session->ctx.known,
+                                     &session->ctx.attestation_result) == 0) {
+        verifier_note_attestor(&session->ctx);
+    } else {
+        session->ctx.attestation_result = -1;
+    }
+
+    // Hand the session back to the event loop, which owns everything but the result.
+    VerifierSession *head = atomic_load(&daemon->completed);
+    do {
+        session->next_completed = head;
+    } while (!atomic_compare_exchange_weak(&daemon->completed, &head, session));
+    uint64_t one = 1;
+    if (write(daemon->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("eventfd write");
+    }
+}
+
+static void session_on_response(VerifierSession *session) {
+    VerifierDaemon *daemon = session->daemon;
+
+    // The session holds no socket interest while a worker owns it.
+    timer_remove(session);
+    session_unwatch(session);
+    session->ctx.state = VERIFIER_STATE_PROCESS_RESPONSE;
+    session->on_pool = true;
+    if (work_pool_submit(daemon->pool, session_process_task, session) != 0) {
+        session_process_task(session);
+    }
+}
+
+static void session_on_readable(VerifierSession *session) {
+    uint8_t *message;
+    size_t size;
+    TransportStatus status = transport_read_frame(&session->connection, &message, &size);
+    if (status == TRANSPORT_AGAIN) {
+        return;
+    }
+    if (status != TRANSPORT_OK) {
+        session_end_round(session, true);
+        return;
+    }
+    session->ctx.response_buffer = message;
+    session->ctx.response_size = size;
+    session_on_response(session);
+}
+
+static void session_on_writable(VerifierSession *session) {
+    if (session->connecting) {
+        if (transport_connect_result(session->connection.fd) != 0) {
+            session_end_round(session, true);
+            return;
+        }
+        session->connecting = false;
+    }
+
+    TransportStatus status = transport_flush(&session->connection);
+    if (status == TRANSPORT_AGAIN) {
+        if (session_watch(session, EPOLLOUT) != 0) {
+            session_end_round(session, true);
+        }
+        return;
+    }
+    if (status != TRANSPORT_OK) {
+        session_end_round(session, true);
+        return;
+    }
+
+    session->ctx.state = VERIFIER_STATE_WAIT_FOR_RESPONSE;
+    if (session_watch(session, EPOLLIN) != 0) {
+        session_end_round(session, true);
+    }
+}
+
+/**
+ * @brief Starts a round: the INIT and SEND_REQUEST states of run_verifier_protocol().
+ */
+static void session_start_round(VerifierSession *session) {
+    VerifierDaemon *daemon = session->daemon;
+
+    session->ctx.request_buffer = NULL;
+    session->ctx.response_buffer = NULL;
+    session->ctx.attestation_result = -1;
+    session->ctx.state = VERIFIER_STATE_SEND_REQUEST;
+    if (session->backlog_count > 0) {
+        session->round_start_us = session->backlog[session->backlog_head];
+        session->backlog_head = (session->backlog_head + 1) % DAEMON_MAX_BACKLOG;
+        session->backlog_count--;
+    } else {
+        session->round_start_us = now_us();
+    }
+
+    if (session->connection.fd < 0) {
+        int fd = transport_connect(&session->address, session->address_len, &session->connecting);
+        if (fd < 0) {
+            session_end_round(session, true);
+            return;
+        }
+        transport_connection_init(&session->connection, fd, daemon->buffers);
+    }
+
+    if (create_attestation_request_for(session->ctx.attestor_id, session->ctx.nonce, sizeof(session->ctx.nonce),
+                                       &session->ctx.known, &session->ctx.request_buffer,
+                                       &session->ctx.request_size) != 0 ||
+        transport_queue_copy(&session->connection, session->ctx.request_buffer, session->ctx.request_size) != 0) {
+        session->ctx.state = VERIFIER_STATE_ERROR;
+        session_end_round(session, false);
+        return;
+    }
+
+    if (daemon->config.timeout_ms) {
+        timer_set(session, now_ms() + daemon->config.timeout_ms);
+    }
+    if (session->connecting) {
+        if (session_watch(session, EPOLLOUT) != 0) {
+            session_end_round(session, true);
+        }
+        return;
+    }
+    session_on_writable(session);
+}
+
+static void session_on_timer(VerifierSession *session) {
+    if (session->ctx.state == VERIFIER_STATE_INIT) {
+        session_start_round(session);
+    } else {
+        fprintf(stderr, "Attestor did not respond within %u ms\n", session->daemon->config.timeout_ms);
+        session_end_round(session, true);
+    }
+}
+
+static VerifierSession *session_add(VerifierDaemon *daemon) {
+    if (daemon->num_sessions == daemon->capacity) {
+        size_t capacity = daemon->capacity ? 2 * daemon->capacity : 64;
+        VerifierSession **sessions = realloc(daemon->sessions, capacity * sizeof(*sessions));
+        if (!sessions) {
+            return NULL;
+        }
+        daemon->sessions = sessions;
+        VerifierSession **timers = realloc(daemon->timers, capacity * sizeof(*timers));
+        if (!timers) {
+            return NULL;
+        }
+        daemon->timers = timers;
+        daemon->capacity = capacity;
+    }
+
+    VerifierSession *session = calloc(1, sizeof(*session));
+    if (!session) {
+        return NULL;
+    }
+    session->daemon = daemon;
+    transport_connection_init(&session->connection, -1, daemon->buffers);
+    session->ctx.state = VERIFIER_STATE_INIT;
+    session->heap_index = DAEMON_NOT_QUEUED;
+    daemon->sessions[daemon->num_sessions++] = session;
+    daemon->active_sessions++;
+    return session;
+}
+
+// Open loop
+
+static double next_uniform(VerifierDaemon *daemon) {
+    // xorshift64*, top 53 bits as a double in (0, 1]
+    daemon->arrival_state ^= daemon->arrival_state >> 12;
+    daemon->arrival_state ^= daemon->arrival_state << 25;
+    daemon->arrival_state ^= daemon->arrival_state >> 27;
+    uint64_t bits = (daemon->arrival_state * 0x2545F4914F6CDD1DULL) >> 11;
+    return ((double)bits + 1.0) / 9007199254740992.0;
+}
+
+/**
+ * @brief Draws the gap to the next arrival of a Poisson process at the configured rate.
+ */
+static uint64_t next_arrival_gap_us(VerifierDaemon *daemon) {
+    return (uint64_t)(-log(next_uniform(daemon)) * 1e6 / daemon->config.arrival_rate);
+}
+
+/**
+ * @brief Hands one arrival to a random session: it starts a round if the session is idle, and waits in the
+ * session's backlog otherwise.
+ */
+static void dispatch_arrival(VerifierDaemon *daemon, uint64_t arrival_us) {
+    VerifierSession *session = daemon->sessions[(size_t)(next_uniform(daemon) * (double)daemon->num_sessions) %
+                                                daemon->num_sessions];
+    if (session->finished || session->backlog_count == DAEMON_MAX_BACKLOG) {
+        atomic_fetch_add(&daemon->dropped, 1);
+        return;
+    }
+    session->backlog[(session->backlog_head + session->backlog_count++) % DAEMON_MAX_BACKLOG] = arrival_us;
+    if (session->ctx.state == VERIFIER_STATE_INIT && session->heap_index == DAEMON_NOT_QUEUED) {
+        session_start_round(session);
+    }
+}
+
+/**
+ * @brief Dispatches every arrival that is due.
+ *
+ * @return Milliseconds until the next arrival.
+ */
+static uint64_t dispatch_arrivals(VerifierDaemon *daemon) {
+    uint64_t now = now_us();
+    while (daemon->next_arrival_us <= now) {
+        dispatch_arrival(daemon, daemon->next_arrival_us);
+        daemon->next_arrival_us += next_arrival_gap_us(daemon);
+    }
+    return (daemon->next_arrival_us - now + 999) / 1000;
+}
+
+// Event loop
+
+static void drain_completions(VerifierDaemon *daemon) {
+    VerifierSession *session = atomic_exchange(&daemon->completed, NULL);
+    while (session) {
+        VerifierSession *next = session->next_completed;
+        session->on_pool = false;
+        session_end_round(session, false);
+        session = next;
+    }
+}
+
+static void report_stats(VerifierDaemon *daemon, uint64_t *last_count, uint64_t *last_ms) {
+    VerifierDaemonStats stats;
+    uint64_t now = now_ms();
+    verifier_daemon_get_stats(daemon, &stats);
+    double minutes = (double)(now - *last_ms) / 60000.0;
+    printf("Attestations: %llu (%llu passed, %llu failed, %llu I/O errors), %.0f/min, p50 %.1f ms, p99 %.1f ms\n",
+           (unsigned long long)stats.attestations, (unsigned long long)stats.passed,
+           (unsigned long long)stats.failed, (unsigned long long)stats.io_errors,
+           minutes > 0 ? (double)(stats.attestations - *last_count) / minutes : 0.0,
+           stats.latency_p50_us / 1000.0, stats.latency_p99_us / 1000.0);
+    fflush(stdout);
+    *last_count = stats.attestations;
+    *last_ms = now;
+}
+
+// Function Implementations
+
+VerifierDaemon *verifier_daemon_create(const VerifierDaemonConfig *config) {
+    VerifierDaemon *daemon = calloc(1, sizeof(*daemon));
+    if (!daemon) {
+        fprintf(stderr, "Error allocating memory for verifier daemon\n");
+        return NULL;
+    }
+    if (config) {
+        daemon->config = *config;
+    }
+    daemon->arrival_state = daemon->config.arrival_seed ? daemon->config.arrival_seed : 0x9E3779B97F4A7C15ULL;
+    daemon->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    daemon->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    daemon->pool = work_pool_create(daemon->config.num_workers);
+    daemon->buffers = buffer_pool_create();
+    atomic_init(&daemon->completed, NULL);
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (daemon->epoll_fd < 0 || daemon->wake_fd < 0 || !daemon->pool || !daemon->buffers ||
+        epoll_ctl(daemon->epoll_fd, EPOLL_CTL_ADD, daemon->wake_fd, &event) != 0) {
+        fprintf(stderr, "Error creating verifier daemon\n");
+        verifier_daemon_destroy(daemon);
+        return NULL;
+    }
+    return daemon;
+}
+
+int verifier_daemon_add_attestor(VerifierDaemon *daemon, const char *address) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    if (!daemon || !address || transport_parse_address(address, &addr, &addr_len) != 0) {
+        return -1;
+    }
+
+    VerifierSession *session = session_add(daemon);
+    if (!session) {
+        fprintf(stderr, "Error allocating memory for attestor session\n");
+        return -1;
+    }
+    session->address = addr;
+    session->address_len = addr_len;
+    if (daemon->config.arrival_rate <= 0) {
+        timer_set(session, now_ms());
+    }
+    return 0;
+}
+
+int verifier_daemon_add_attestor_fd(VerifierDaemon *daemon, int fd) {
+    if (!daemon || fd < 0) {
+        return -1;
+    }
+
+    VerifierSession *session = session_add(daemon);
+    if (!session) {
+        fprintf(stderr, "Error allocating memory for attestor session\n");
+        return -1;
+    }
+    transport_connection_init(&session->connection, fd, daemon->buffers);
+    if (daemon->config.arrival_rate <= 0) {
+        timer_set(session, now_ms());
+    }
+    return 0;
+}
+
+int verifier_daemon_run(VerifierDaemon *daemon) {
+    struct epoll_event events[DAEMON_MAX_EVENTS];
+    uint64_t last_count = 0;
+    uint64_t last_report_ms = now_ms();
+    bool stopping = false;
+    bool open_loop = daemon->config.arrival_rate > 0 && daemon->num_sessions > 0;
+    if (open_loop) {
+        daemon->next_arrival_us = now_us() + next_arrival_gap_us(daemon);
+    }
+
+    // Sessions on the pool finish their round; everything else ends as soon as a stop is seen.
+    while (daemon->active_sessions > 0) {
+        if (!stopping && atomic_load(&daemon->stop_requested)) {
+            stopping = true;
+            for (size_t i = 0; i < daemon->num_sessions; i++) {
+                VerifierSession *session = daemon->sessions[i];
+                if (!session->finished && !session->on_pool) {
+                    session_finish(session);
+                }
+            }
+            continue;
+        }
+
+        uint64_t now = now_ms();
+        while (daemon->num_timers > 0 && daemon->timers[0]->due_ms <= now) {
+            VerifierSession *session = daemon->timers[0];
+            timer_remove(session);
+            session_on_timer(session);
+        }
+
+        int timeout = -1;
+        if (daemon->num_timers > 0) {
+            uint64_t wait = daemon->timers[0]->due_ms > now ? daemon->timers[0]->due_ms - now : 0;
+            timeout = wait > 1000 ? 1000 : (int)wait;
+        }
+        if (open_loop && !stopping) {
+            uint64_t wait = dispatch_arrivals(daemon);
+            if (timeout < 0 || wait < (uint64_t)timeout) {
+                timeout = wait > 1000 ? 1000 : (int)wait;
+            }
+        }
+        if (daemon->config.report_interval_s) {
+            uint64_t report_due = last_report_ms + 1000ull * daemon->config.report_interval_s;
+            if (report_due <= now) {
+                report_stats(daemon, &last_count, &last_report_ms);
+                report_due = last_report_ms + 1000ull * daemon->config.report_interval_s;
+            }
+            if (timeout < 0 || report_due - now < (uint64_t)timeout) {
+                timeout = (int)(report_due - now);
+            }
+        }
+
+        int count = epoll_wait(daemon->epoll_fd, events, DAEMON_MAX_EVENTS, timeout);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            return -1;
+        }
+
+        for (int i = 0; i < count; i++) {
+            VerifierSession *session = events[i].data.ptr;
+            if (!session) {
+                uint64_t value;
+                (void)!read(daemon->wake_fd, &value, sizeof(value));
+                drain_completions(daemon);
+                continue;
+            }
+            // Errors and hang-ups surface through the read or write they interrupt.
+            if (session->ctx.state == VERIFIER_STATE_SEND_REQUEST) {
+                session_on_writable(session);
+            } else if (session->ctx.state == VERIFIER_STATE_WAIT_FOR_RESPONSE) {
+                session_on_readable(session);
+            }
+        }
+    }
+
+    if (daemon->config.report_interval_s) {
+        report_stats(daemon, &last_count, &last_report_ms);
+    }
+    return 0;
+}
+
+void verifier_daemon_stop(VerifierDaemon *daemon) {
+    uint64_t one = 1;
+    atomic_store(&daemon->stop_requested, true);
+    // EAGAIN means the loop has a wake-up pending already.
+    (void)!write(daemon->wake_fd, &one, sizeof(one));
+}
+
+void verifier_daemon_get_stats(const VerifierDaemon *daemon, VerifierDaemonStats *stats) {
+    stats->attestations = atomic_load(&daemon->attestations);
+    stats->passed = atomic_load(&daemon->passed);
+    stats->failed = atomic_load(&daemon->failed);
+    stats->io_errors = atomic_load(&daemon->io_errors);
+    stats->dropped = atomic_load(&daemon->dropped);
+
+    uint64_t counts[DAEMON_LATENCY_BUCKETS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < DAEMON_LATENCY_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&daemon->latency[i], memory_order_relaxed);
+        total += counts[i];
+    }
+    stats->latency_p50_us = latency_percentile(counts, total, 0.50);
+    stats->latency_p99_us = latency_percentile(counts, total, 0.99);
+    stats->latency_p999_us = latency_percentile(counts, total, 0.999);
+    stats->latency_max_us = atomic_load(&daemon->latency_max_us);
+}
+
+void verifier_daemon_destroy(VerifierDaemon *daemon) {
+    if (!daemon) {
+        return;
+    }
+    // Waits for rounds still on the pool before their sessions are freed.
+    work_pool_destroy(daemon->pool);
+    for (size_t i = 0; i < daemon->num_sessions; i++) {
+        VerifierSession *session = daemon->sessions[i];
+        transport_connection_close(&session->connection);
+        session_free_buffers(session);
+        free(session);
+    }
+    if (daemon->epoll_fd >= 0) {
+        close(daemon->epoll_fd);
+    }
+    if (daemon->wake_fd >= 0) {
+        close(daemon->wake_fd);
+    }
+    buffer_pool_destroy(daemon->buffers);
+    free(daemon->sessions);
+    free(daemon->timers);
+    free(daemon);
+}
@@ -0,0 +1,496 @@
+// verifier_metrics.c
+// Per-thread counters and latency histograms of the verification pipeline, merged on scrape and exported in the
+// Prometheus text format over HTTP or to a file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "transport.h"
+#include "verifier_metrics.h"
+
+#define METRICS_LINEAR_BUCKETS (1u << METRICS_SUB_BUCKET_BITS)
+#define METRICS_IO_TIMEOUT_MS 1000
+#define METRICS_REQUEST_MAX 4096
+
+// Structures
+
+typedef struct {
+    atomic_uint_fast64_t buckets[METRICS_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t sum_ns;
+    atomic_uint_fast64_t max_ns;
+    atomic_uint_fast64_t errors;
+} StageHistogram;
+
+// Written only by the thread that holds it; aligned so that no two threads write the same cache line.
+typedef struct MetricsShard {
+    StageHistogram stages[VERIFIER_STAGE_COUNT];
+    atomic_uint_fast64_t counters[VERIFIER_COUNTER_COUNT];
+    atomic_bool in_use;
+    struct MetricsShard *next;
+} __attribute__((aligned(64))) MetricsShard;
+
+struct MetricsExporter {
+    pthread_t thread;
+    int listen_fd;                  /**< HTTP socket, or -1 */
+    int stop_pipe[2];               /**< Written by metrics_exporter_stop() */
+    char *file;                     /**< Metrics file, or NULL */
+    unsigned int file_interval_s;
+};
+
+static const char *const stage_names[VERIFIER_STAGE_COUNT] = {
+    "decode", "parse", "nonce", "signature", "replay", "rim", "archive", "attestation",
+};
+
+static const double summary_quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+static atomic_bool metrics_on = false;
+static _Atomic(MetricsShard *) metrics_shards = NULL;
+static pthread_key_t shard_key;
+static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+
+// Shards
+
+static void shard_release(void *shard) {
+    atomic_store(&((MetricsShard *)shard)->in_use, false);
+}
+
+static void shard_key_create(void) {
+    pthread_key_create(&shard_key, shard_release);
+}
+
+/**
+ * @brief Returns the calling thread's shard, taking over the shard of an exited thread or adding a new one.
+ */
+static MetricsShard *thread_shard(void) {
+    pthread_once(&shard_key_once, shard_key_create);
+    MetricsShard *shard = pthread_getspecific(shard_key);
+    if (shard) {
+        return shard;
+    }
+
+    for (shard = atomic_load(&metrics_shards); shard; shard = shard->next) {
+        bool idle = false;
+        if (atomic_compare_exchange_strong(&shard->in_use, &idle, true)) {
+            break;
+        }
+    }
+    if (!shard) {
+        shard = aligned_alloc(64, sizeof(*shard));
+        if (!shard) {
+            fprintf(stderr, "Error allocating memory for metrics shard\n");
+            return NULL;
+        }
+        memset(shard, 0, sizeof(*shard));
+        atomic_store(&shard->in_use, true);
+        shard->next = atomic_load(&metrics_shards);
+        while (!atomic_compare_exchange_weak(&metrics_shards, &shard->next, shard)) {
+        }
+    }
+    if (pthread_setspecific(shard_key, shard) != 0) {
+        atomic_store(&shard->in_use, false);
+        return NULL;
+    }
+    return shard;
+}
+
+// Only the owning thread writes a shard, so a relaxed load and store replace a locked read-modify-write.
+static inline void shard_add(atomic_uint_fast64_t *value, uint64_t n) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Histograms
+
+/**
+ * @brief Maps a latency to its bucket: exact below 2^METRICS_SUB_BUCKET_BITS ns, then METRICS_LINEAR_BUCKETS
+ * buckets per power of two.
+ */
+static size_t latency_bucket(uint64_t ns) {
+    if (ns < METRICS_LINEAR_BUCKETS) {
+        return (size_t)ns;
+    }
+    unsigned int magnitude = 63u - (unsigned int)__builtin_clzll(ns);
+    unsigned int shift = magnitude - METRICS_SUB_BUCKET_BITS;
+    if (shift >= METRICS_MAGNITUDES) {
+        return METRICS_BUCKETS - 1;
+    }
+    size_t sub_bucket = (size_t)(ns >> shift) - METRICS_LINEAR_BUCKETS;
+    return METRICS_LINEAR_BUCKETS + (size_t)shift * METRICS_LINEAR_BUCKETS + sub_bucket;
+}
+
+static uint64_t latency_bucket_floor(size_t bucket) {
+    if (bucket < METRICS_LINEAR_BUCKETS) {
+        return bucket;
+    }
+    size_t shift = (bucket - METRICS_LINEAR_BUCKETS) / METRICS_LINEAR_BUCKETS;
+    size_t sub_bucket = (bucket - METRICS_LINEAR_BUCKETS) % METRICS_LINEAR_BUCKETS;
+    return (uint64_t)(METRICS_LINEAR_BUCKETS + sub_bucket) << shift;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void verifier_metrics_enable(void) {
+    atomic_store(&metrics_on, true);
+}
+
+bool verifier_metrics_enabled(void) {
+    return atomic_load_explicit(&metrics_on, memory_order_relaxed);
+}
+
+uint64_t verifier_metrics_start(void) {
+    return verifier_metrics_enabled() ? now_ns() : 0;
+}
+
+void verifier_metrics_stage_end(VerifierStage stage, uint64_t start, bool ok) {
+    if (start == 0 || stage >= VERIFIER_STAGE_COUNT) {
+        return;
+    }
+    uint64_t elapsed = now_ns() - start;
+    MetricsShard *shard = thread_shard();
+    if (!shard) {
+        return;
+    }
+    StageHistogram *histogram = &shard->stages[stage];
+    shard_add(&histogram->buckets[latency_bucket(elapsed)], 1);
+    shard_add(&histogram->count, 1);
+    shard_add(&histogram->sum_ns, elapsed);
+    if (elapsed > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max_ns, elapsed, memory_order_relaxed);
+    }
+    if (!ok) {
+        shard_add(&histogram->errors, 1);
+    }
+}
+
+void verifier_metrics_count(VerifierCounter counter, uint64_t n) {
+    if (!verifier_metrics_enabled() || counter >= VERIFIER_COUNTER_COUNT) {
+        return;
+    }
+    MetricsShard *shard = thread_shard();
+    if (shard) {
+        shard_add(&shard->counters[counter], n);
+    }
+}
+
+// Exposition
+
+typedef struct {
+    uint64_t buckets[METRICS_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t errors;
+} StageTotals;
+
+static void merge_stage(VerifierStage stage, StageTotals *totals) {
+    memset(totals, 0, sizeof(*totals));
+    for (MetricsShard *shard = atomic_load(&metrics_shards); shard; shard = shard->next) {
+        const StageHistogram *histogram = &shard->stages[stage];
+        for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+            totals->buckets[i] += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        }
+        totals->count += atomic_load_explicit(&histogram->count, memory_order_relaxed);
+        totals->sum_ns += atomic_load_explicit(&histogram->sum_ns, memory_order_relaxed);
+        totals->errors += atomic_load_explicit(&histogram->errors, memory_order_relaxed);
+        uint64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+        if (max_ns > totals->max_ns) {
+            totals->max_ns = max_ns;
+        }
+    }
+}
+
+static uint64_t merge_counter(VerifierCounter counter) {
+    uint64_t total = 0;
+    for (MetricsShard *shard = atomic_load(&metrics_shards); shard; shard = shard->next) {
+        total += atomic_load_explicit(&shard->counters[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Returns the floor of the bucket holding a quantile. Buckets are counted from the merged totals, which
+ * may trail the count by the values recorded during the merge, so the rank is taken from the buckets' sum.
+ */
+static uint64_t stage_quantile_ns(const StageTotals *totals, double quantile) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+        total += totals->buckets[i];
+    }
+    uint64_t rank = (uint64_t)(quantile * (double)total + 0.5);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+        seen += totals->buckets[i];
+        if (seen >= rank && seen > 0) {
+            return latency_bucket_floor(i);
+        }
+    }
+    return 0;
+}
+
+int verifier_metrics_write(FILE *out) {
+    StageTotals *totals = malloc(VERIFIER_STAGE_COUNT * sizeof(*totals));
+    if (!totals) {
+        fprintf(stderr, "Error allocating memory for metrics totals\n");
+        return -1;
+    }
+    for (int stage = 0; stage < VERIFIER_STAGE_COUNT; stage++) {
+        merge_stage((VerifierStage)stage, &totals[stage]);
+    }
+
+    fprintf(out, "# HELP verifier_stage_duration_seconds Latency of each verification stage; stage=\"attestation\" "
+                 "is the whole response.\n"
+                 "# TYPE verifier_stage_duration_seconds summary\n");
+    for (int stage = 0; stage < VERIFIER_STAGE_COUNT; stage++) {
+        for (size_t q = 0; q < sizeof(summary_quantiles) / sizeof(summary_quantiles[0]); q++) {
+            fprintf(out, "verifier_stage_duration_seconds{stage=\"%s\",quantile=\"%g\"} %.9g\n", stage_names[stage],
+                    summary_quantiles[q], (double)stage_quantile_ns(&totals[stage], summary_quantiles[q]) / 1e9);
+        }
+        fprintf(out, "verifier_stage_duration_seconds_sum{stage=\"%s\"} %.9g\n", stage_names[stage],
+                (double)totals[stage].sum_ns / 1e9);
+        fprintf(out, "verifier_stage_duration_seconds_count{stage=\"%s\"} %llu\n", stage_names[stage],
+                (unsigned long long)totals[stage].count);
+    }
+    fprintf(out, "# HELP verifier_stage_duration_max_seconds Longest run of each verification stage.\n"
+                 "# TYPE verifier_stage_duration_max_seconds gauge\n");
+    for (int stage = 0; stage < VERIFIER_STAGE_COUNT; stage++) {
+        fprintf(out, "verifier_stage_duration_max_seconds{stage=\"%s\"} %.9g\n", stage_names[stage],
+                (double)totals[stage].max_ns / 1e9);
+    }
+    fprintf(out, "# HELP verifier_stage_errors_total Runs of each verification stage that failed.\n"
+                 "# TYPE verifier_stage_errors_total counter\n");
+    for (int stage = 0; stage < VERIFIER_STAGE_COUNT; stage++) {
+        fprintf(out, "verifier_stage_errors_total{stage=\"%s\"} %llu\n", stage_names[stage],
+                (unsigned long long)totals[stage].errors);
+    }
+    free(totals);
+
+    fprintf(out, "# HELP verifier_attestations_total Attestation responses verified, by result.\n"
+                 "# TYPE verifier_attestations_total counter\n"
+                 "verifier_attestations_total{result=\"passed\"} %llu\n"
+                 "verifier_attestations_total{result=\"failed\"} %llu\n",
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_PASSED),
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_FAILED));
+    fprintf(out, "# HELP verifier_log_replays_total Measurement logs verified, by where the replay started.\n"
+                 "# TYPE verifier_log_replays_total counter\n"
+                 "verifier_log_replays_total{mode=\"full\"} %llu\n"
+                 "verifier_log_replays_total{mode=\"checkpoint\"} %llu\n"
+                 "verifier_log_replays_total{mode=\"delta\"} %llu\n",
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_FULL_REPLAYS),
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_INCREMENTAL),
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_DELTAS));
+    fprintf(out, "# HELP verifier_verdict_cache_hits_total Full logs whose replay and RIM verdict were cached.\n"
+                 "# TYPE verifier_verdict_cache_hits_total counter\n"
+                 "verifier_verdict_cache_hits_total %llu\n",
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_VERDICT_HITS));
+    fprintf(out, "# HELP verifier_rim_rechecks_total Checkpointed logs checked whole against a newer RIM.\n"
+                 "# TYPE verifier_rim_rechecks_total counter\n"
+                 "verifier_rim_rechecks_total %llu\n",
+            (unsigned long long)merge_counter(VERIFIER_COUNTER_RIM_RECHECKS));
+    return ferror(out) ? -1 : 0;
+}
+
+int verifier_metrics_write_file(const char *path) {
+    size_t tmp_size = strlen(path) + sizeof(".tmp");
+    char *tmp_path = malloc(tmp_size);
+    if (!tmp_path) {
+        fprintf(stderr, "Error allocating memory for metrics file name\n");
+        return -1;
+    }
+    snprintf(tmp_path, tmp_size, "%s.tmp", path);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file) {
+        fprintf(stderr, "Error opening metrics file: %s\n", tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    int rc = verifier_metrics_write(file);
+    if (fclose(file) != 0 || rc != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error writing metrics file: %s\n", path);
+        unlink(tmp_path);
+        rc = -1;
+    }
+    free(tmp_path);
+    return rc;
+}
+
+// Exporter
+
+static int write_all(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written > 0) {
+            data += written;
+            size -= (size_t)written;
+            continue;
+        }
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return -1;
+        }
+        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+        if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) <= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads one HTTP request head and answers it: GET gets the metrics, anything else 405. Scrapes are
+ * served one at a time, and a client that does not send its request within a second is dropped.
+ */
+static void serve_scrape(int fd) {
+    char request[METRICS_REQUEST_MAX];
+    size_t received = 0;
+    while (received < sizeof(request) - 1) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, METRICS_IO_TIMEOUT_MS) <= 0) {
+            return;
+        }
+        ssize_t n = read(fd, request + received, sizeof(request) - 1 - received);
+        if (n <= 0) {
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            return;
+        }
+        received += (size_t)n;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            break;
+        }
+    }
+    request[received] = '\0';
+
+    char header[160];
+    if (strncmp(request, "GET ", 4) != 0) {
+        const char *refusal = "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\n\r\n";
+        write_all(fd, refusal, strlen(refusal));
+        return;
+    }
+    char *body = NULL;
+    size_t body_size = 0;
+    FILE *out = open_memstream(&body, &body_size);
+    if (!out) {
+        return;
+    }
+    int rc = verifier_metrics_write(out);
+    if (fclose(out) == 0 && rc == 0) {
+        int header_size = snprintf(header, sizeof(header),
+                                   "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                   "Content-Length: %zu\r\n\r\n", body_size);
+        if (write_all(fd, header, (size_t)header_size) == 0) {
+            write_all(fd, body, body_size);
+        }
+    }
+    free(body);
+}
+
+static void *exporter_main(void *arg) {
+    MetricsExporter *exporter = arg;
+    struct pollfd pfds[2] = {
+        { .fd = exporter->stop_pipe[0], .events = POLLIN },
+        { .fd = exporter->listen_fd, .events = POLLIN },
+    };
+    nfds_t nfds = exporter->listen_fd >= 0 ? 2 : 1;
+    uint64_t next_write = now_ns();
+
+    for (;;) {
+        int timeout_ms = -1;
+        if (exporter->file) {
+            uint64_t now = now_ns();
+            if (now >= next_write) {
+                verifier_metrics_write_file(exporter->file);
+                next_write = now + (uint64_t)exporter->file_interval_s * 1000000000ull;
+            }
+            timeout_ms = (int)((next_write - now + 999999) / 1000000);
+        }
+        if (poll(pfds, nfds, timeout_ms) < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (pfds[0].revents) {
+            break;
+        }
+        if (nfds > 1 && (pfds[1].revents & POLLIN)) {
+            int fd;
+            while ((fd = transport_accept(exporter->listen_fd)) >= 0) {
+                serve_scrape(fd);
+                close(fd);
+            }
+        }
+    }
+    if (exporter->file) {
+        verifier_metrics_write_file(exporter->file);
+    }
+    return NULL;
+}
+
+MetricsExporter *metrics_exporter_start(const char *address, const char *file, unsigned int file_interval_s) {
+    MetricsExporter *exporter = calloc(1, sizeof(*exporter));
+    if (!exporter) {
+        fprintf(stderr, "Error allocating memory for metrics exporter\n");
+        return NULL;
+    }
+    exporter->listen_fd = -1;
+    exporter->stop_pipe[0] = exporter->stop_pipe[1] = -1;
+    exporter->file_interval_s = file_interval_s ? file_interval_s : METRICS_DEFAULT_FILE_INTERVAL_S;
+    if (file && !(exporter->file = strdup(file))) {
+        fprintf(stderr, "Error allocating memory for metrics file name\n");
+        goto fail;
+    }
+    if (address && (exporter->listen_fd = transport_listen(address)) < 0) {
+        goto fail;
+    }
+    if (pipe(exporter->stop_pipe) != 0) {
+        perror("pipe");
+        goto fail;
+    }
+
+    verifier_metrics_enable();
+    if (pthread_create(&exporter->thread, NULL, exporter_main, exporter) != 0) {
+        fprintf(stderr, "Error starting metrics exporter thread\n");
+        goto fail;
+    }
+    return exporter;
+
+fail:
+    if (exporter->listen_fd >= 0) {
+        close(exporter->listen_fd);
+    }
+    if (exporter->stop_pipe[0] >= 0) {
+        close(exporter->stop_pipe[0]);
+        close(exporter->stop_pipe[1]);
+    }
+    free(exporter->file);
+    free(exporter);
+    return NULL;
+}
+
+void metrics_exporter_stop(MetricsExporter *exporter) {
+    if (!exporter) {
+        return;
+    }
+    char byte = 0;
+    if (write(exporter->stop_pipe[1], &byte, 1) != 1) {
+        perror("write");
+    }
+    pthread_join(exporter->thread, NULL);
+    if (exporter->listen_fd >= 0) {
+        close(exporter->listen_fd);
+    }
+    close(exporter->stop_pipe[0]);
+    close(exporter->stop_pipe[1]);
+    free(exporter->file);
+    free(exporter);
+}
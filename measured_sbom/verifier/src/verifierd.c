@@ -0,0 +1,519 @@
+// verifierd.c
+// Long-running verifier service. Attests a set of attestors continuously with a VerifierDaemon, or, with -L,
+// a fleet of in-process stand-in attestors for load testing on one machine.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "verifier.h"
+#include "verifier_daemon.h"
+#include "verifier_metrics.h"
+#include "standin_attestor.h"
+#include "rim_image.h"
+
+#define VERIFIERD_DEFAULT_VERDICTS 4096
+
+/**
+ * @struct RimReloader
+ * @brief Thread that reloads the RIM on SIGHUP, or when its file changes, and publishes it to the verifier.
+ */
+typedef struct {
+    RimStore *store;
+    const char *rim_file;
+    const char *rim_key_file;
+    unsigned int poll_interval_s;   /**< Seconds between checks of the file; 0 reloads on SIGHUP only */
+    struct stat loaded;             /**< The file as it was when last loaded */
+    uint64_t serial;                /**< Serial of the image the current version came from, 0 for a manifest */
+    atomic_bool stopping;
+    pthread_t thread;
+    bool started;
+} RimReloader;
+
+static VerifierDaemon *running_daemon = NULL;
+
+static void handle_stop_signal(int signum) {
+    (void)signum;
+    if (running_daemon) {
+        verifier_daemon_stop(running_daemon);
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s -r <rim manifest> [options] [attestor address ...]\n"
+            "  -r <file>   Reference integrity manifest or compiled RIM image the measurement logs are checked against\n"
+            "  -K <file>   Public key compiled RIM images must be signed with (required for images)\n"
+            "  -R <secs>   Reload the RIM when its file changes, checked every <secs> (default: on SIGHUP only)\n"
+            "  -w <count>  Verification threads (default: one per CPU)\n"
+            "  -i <ms>     Delay between rounds of a session (default: 0)\n"
+            "  -t <ms>     Response timeout (default: 30000)\n"
+            "  -n <count>  Rounds per session (default: until interrupted)\n"
+            "  -c <dir>    Directory for replay checkpoints (default: in memory)\n"
+            "  -V <count>  Log verdicts cached across attestors (default: 4096, 0 disables)\n"
+            "  -P <ver>    Verification policy version; bump to invalidate cached verdicts (default: 0)\n"
+            "  -s <secs>   Seconds between throughput reports (default: 10, 0 disables)\n"
+            "  -L <count>  Attest <count> local stand-in attestors\n"
+            "  -e <file>   Event log the stand-in attestors report (required with -L)\n"
+            "  -T <addr>   Reach the stand-ins through a socket listening on <addr> instead of socketpairs\n"
+            "  -k <public>[,[<cert>][,<parent>]]\n"
+            "              Trust the attestation key in <public> (a TPM2B_PUBLIC), certified by <cert>, whose\n"
+            "              parent's qualified name is in <parent> (as tpm2_readpublic -q writes it; default: the key\n"
+            "              is a primary key of the endorsement hierarchy); repeatable\n"
+            "  -a <file>   CA bundle that must certify every attestation key given with -k\n"
+            "  -M <addr>   Serve per-stage metrics in the Prometheus text format over HTTP on <addr>\n"
+            "  -m <file>   Write the metrics to <file> every -s seconds (default: 10) and on exit\n"
+            "  -v <file>   Append a structured verdict per attestation to <file> ('-' for stdout)\n"
+            "  -F <fmt>    Verdict format: json (one object per line, default) or binary\n"
+            "  -l <level>  Verdict detail: summary (default), failures (every failing event) or events (every event)\n"
+            "  -p <count>  Replay and check large logs on <count> extra threads (0: one per CPU; default: disabled)\n"
+            "  -b <bytes>  Smallest log verified on those threads (default: 1 MiB)\n"
+            "  -D <file>   Zstd dictionary attestors may compress their logs with (see log_dict_train)\n"
+            "  -A <dir>    Archive every verified log and quote in <dir>, deduplicated (see archive_query)\n"
+            "  -d          Report every passed attestation and checkpoint fallback on stderr\n"
+            "Attestor addresses are unix:<path> or <host>:<port>. The stand-ins' key is always trusted.\n",
+            program);
+}
+
+static uint8_t *read_file(const char *filename, size_t *size) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+
+    uint8_t *buffer = file_size > 0 ? malloc((size_t)file_size) : NULL;
+    if (!buffer || fread(buffer, 1, (size_t)file_size, file) != (size_t)file_size) {
+        fprintf(stderr, "Error reading file: %s\n", filename);
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *size = (size_t)file_size;
+    return buffer;
+}
+
+/**
+ * @brief Loads the RIM: compiled images are mapped after their signature is checked, manifests are indexed.
+ */
+static int load_rim(RIM_Index *rim_index, const char *rim_file, const char *rim_key_file, uint64_t *serial) {
+    *serial = 0;
+    if (rim_image_probe(rim_file)) {
+        EVP_PKEY *rim_key = rim_key_file ? rim_image_read_key(rim_key_file, false) : NULL;
+        if (!rim_key) {
+            fprintf(stderr, "A compiled RIM image needs the key it is signed with (-K)\n");
+            return -1;
+        }
+        RIM_ImageHeader header;
+        int rc = rim_index_map_image(rim_index, rim_file, rim_key, &header);
+        EVP_PKEY_free(rim_key);
+        if (rc == 0) {
+            *serial = header.serial;
+        }
+        return rc;
+    }
+
+    if (rim_index_init(rim_index, 0) != 0) {
+        return -1;
+    }
+    if (rim_index_load_manifest_file(rim_index, rim_file) < 0) {
+        rim_index_free(rim_index);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Loads the RIM file and publishes it, unless it is the RIM already in use or an older image.
+ *
+ * Loading and checking happen on the calling thread; verification threads only see the new version once it is
+ * published, and keep the current one if anything fails.
+ *
+ * @return Returns 0 if the file was published or is already current, or -1 on failure.
+ */
+static int reload_rim(RimReloader *reloader) {
+    struct stat info;
+    RIM_Index index;
+    uint64_t serial;
+    uint64_t version;
+
+    if (stat(reloader->rim_file, &info) != 0 ||
+        load_rim(&index, reloader->rim_file, reloader->rim_key_file, &serial) != 0) {
+        fprintf(stderr, "Error loading RIM: %s\n", reloader->rim_file);
+        return -1;
+    }
+    reloader->loaded = info;
+    if (reloader->serial != 0 && serial <= reloader->serial) {
+        fprintf(stderr, "RIM image %s has serial %llu, not newer than %llu; keeping the current RIM\n",
+                reloader->rim_file, (unsigned long long)serial, (unsigned long long)reloader->serial);
+        rim_index_free(&index);
+        return -1;
+    }
+    const RimVersion *current = rim_store_pin(reloader->store);
+    bool unchanged = current && memcmp(current->index.content_digest, index.content_digest,
+                                       sizeof(index.content_digest)) == 0;
+    if (current) {
+        rim_store_unpin(reloader->store);
+    }
+    if (unchanged) {
+        rim_index_free(&index);
+        return 0;
+    }
+
+    uint32_t entries = index.entry_count;
+    if (rim_store_publish(reloader->store, &index, serial, &version) != 0) {
+        rim_index_free(&index);
+        return -1;
+    }
+    reloader->serial = serial;
+    printf("RIM version %llu: %u entries from %s", (unsigned long long)version, entries, reloader->rim_file);
+    if (serial != 0) {
+        printf(", image serial %llu", (unsigned long long)serial);
+    }
+    printf("\n");
+    return 0;
+}
+
+static bool rim_file_changed(const RimReloader *reloader) {
+    struct stat info;
+    return stat(reloader->rim_file, &info) == 0 &&
+           (info.st_ino != reloader->loaded.st_ino || info.st_size != reloader->loaded.st_size ||
+            info.st_mtim.tv_sec != reloader->loaded.st_mtim.tv_sec ||
+            info.st_mtim.tv_nsec != reloader->loaded.st_mtim.tv_nsec);
+}
+
+/**
+ * @brief Waits for SIGHUP, which every other thread blocks, or for the file to change, and reloads the RIM.
+ * Versions replaced earlier are reclaimed on every wakeup once their last verification has finished.
+ */
+static void *rim_reloader_main(void *arg) {
+    RimReloader *reloader = arg;
+    sigset_t hangup;
+    sigemptyset(&hangup);
+    sigaddset(&hangup, SIGHUP);
+
+    while (!atomic_load(&reloader->stopping)) {
+        struct timespec timeout = { .tv_sec = reloader->poll_interval_s > 0 ? reloader->poll_interval_s : 1 };
+        int signum = sigtimedwait(&hangup, NULL, &timeout);
+        if (atomic_load(&reloader->stopping)) {
+            break;
+        }
+        if (signum == SIGHUP || (reloader->poll_interval_s > 0 && rim_file_changed(reloader))) {
+            reload_rim(reloader);
+        }
+        rim_store_reclaim(reloader->store);
+    }
+    return NULL;
+}
+
+static void rim_reloader_stop(RimReloader *reloader) {
+    if (reloader->started) {
+        atomic_store(&reloader->stopping, true);
+        pthread_kill(reloader->thread, SIGHUP);
+        pthread_join(reloader->thread, NULL);
+        reloader->started = false;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    VerifierDaemonConfig config = { .timeout_ms = 30000, .report_interval_s = 10 };
+    const char *rim_file = NULL;
+    const char *rim_key_file = NULL;
+    unsigned int rim_poll_interval_s = 0;
+    const char *checkpoint_dir = NULL;
+    const char *event_log_file = NULL;
+    const char *ca_file = NULL;
+    const char *standin_address = NULL;
+    const char *metrics_address = NULL;
+    const char *metrics_file = NULL;
+    const char *dictionary_file = NULL;
+    const char *archive_dir = NULL;
+    VerdictLogConfig verdict_config = { .format = VERDICT_FORMAT_JSON, .level = VERDICT_LEVEL_SUMMARY };
+    size_t verdict_capacity = VERIFIERD_DEFAULT_VERDICTS;
+    uint32_t policy_version = 0;
+    char **ak_specs = calloc((size_t)argc, sizeof(*ak_specs));
+    size_t ak_count = 0;
+    size_t standin_count = 0;
+    bool pipelined = false;
+    size_t pipeline_threads = 0;
+    size_t pipeline_min_log_size = 0;
+    int opt;
+
+    if (!ak_specs) {
+        return EXIT_FAILURE;
+    }
+    while ((opt = getopt(argc, argv, "r:K:R:w:i:t:n:c:V:P:s:L:e:T:k:a:M:m:v:F:l:p:b:D:A:dh")) != -1) {
+        switch (opt) {
+            case 'r': rim_file = optarg; break;
+            case 'K': rim_key_file = optarg; break;
+            case 'R': rim_poll_interval_s = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'w': config.num_workers = strtoul(optarg, NULL, 10); break;
+            case 'i': config.interval_ms = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 't': config.timeout_ms = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'n': config.rounds = strtoull(optarg, NULL, 10); break;
+            case 'c': checkpoint_dir = optarg; break;
+            case 'V': verdict_capacity = strtoul(optarg, NULL, 10); break;
+            case 'P': policy_version = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': config.report_interval_s = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'L': standin_count = strtoul(optarg, NULL, 10); break;
+            case 'e': event_log_file = optarg; break;
+            case 'T': standin_address = optarg; break;
+            case 'k': ak_specs[ak_count++] = optarg; break;
+            case 'a': ca_file = optarg; break;
+            case 'M': metrics_address = optarg; break;
+            case 'm': metrics_file = optarg; break;
+            case 'v': verdict_config.path = optarg; break;
+            case 'F':
+                verdict_config.format = strcmp(optarg, "binary") == 0 ? VERDICT_FORMAT_BINARY : VERDICT_FORMAT_JSON;
+                break;
+            case 'l':
+                verdict_config.level = strcmp(optarg, "events") == 0     ? VERDICT_LEVEL_EVENTS
+                                     : strcmp(optarg, "failures") == 0 ? VERDICT_LEVEL_FAILURES
+                                                                       : VERDICT_LEVEL_SUMMARY;
+                break;
+            case 'p':
+                pipelined = true;
+                pipeline_threads = strtoul(optarg, NULL, 10);
+                break;
+            case 'b': pipeline_min_log_size = strtoul(optarg, NULL, 10); break;
+            case 'D': dictionary_file = optarg; break;
+            case 'A': archive_dir = optarg; break;
+            case 'd': verifier_set_debug(true); break;
+            default:
+                usage(argv[0]);
+                free(ak_specs);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (!rim_file || (standin_count > 0 && !event_log_file) || (standin_count == 0 && optind == argc)) {
+        usage(argv[0]);
+        free(ak_specs);
+        return EXIT_FAILURE;
+    }
+
+    // SIGHUP reloads the RIM; only the reloader thread takes it, so it is blocked before any thread starts.
+    sigset_t hangup;
+    sigemptyset(&hangup);
+    sigaddset(&hangup, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &hangup, NULL);
+
+    RimReloader reloader = { .rim_file = rim_file, .rim_key_file = rim_key_file,
+                             .poll_interval_s = rim_poll_interval_s };
+    reloader.store = rim_store_create();
+    if (!reloader.store || reload_rim(&reloader) != 0) {
+        rim_store_destroy(reloader.store);
+        free(ak_specs);
+        return EXIT_FAILURE;
+    }
+    CheckpointStore *checkpoints = checkpoint_store_create(checkpoint_dir);
+    if (!checkpoints) {
+        rim_store_destroy(reloader.store);
+        free(ak_specs);
+        return EXIT_FAILURE;
+    }
+    verifier_set_rim_store(reloader.store);
+    verifier_set_checkpoint_store(checkpoints);
+
+    int rc = EXIT_FAILURE;
+    StandinAttestors *standins = NULL;
+    int *standin_fds = NULL;
+    VerifierDaemon *daemon = NULL;
+    VerdictCache *verdicts = NULL;
+    MetricsExporter *metrics = NULL;
+    VerdictLog *verdict_log = NULL;
+    LogPipeline *pipeline = NULL;
+    LogDictionary dictionary = { 0 };
+    EventArchive *archive = NULL;
+    // The stand-ins' key is generated on the spot and has no certificate, so it is trusted without a CA.
+    AK_Cache *ak_cache = ak_cache_create(standin_count > 0 ? NULL : ca_file);
+    if (!ak_cache) {
+        goto cleanup;
+    }
+    if (standin_count > 0 && ca_file) {
+        fprintf(stderr, "Warning: -a is ignored with -L\n");
+    }
+    for (size_t i = 0; i < ak_count; i++) {
+        char *cert_file = strchr(ak_specs[i], ',');
+        char *parent_file = NULL;
+        if (cert_file) {
+            *cert_file++ = '\0';
+            parent_file = strchr(cert_file, ',');
+            if (parent_file) {
+                *parent_file++ = '\0';
+            }
+        }
+        if (ak_cache_add_file(ak_cache, ak_specs[i], parent_file && *parent_file ? parent_file : NULL,
+                              cert_file && *cert_file ? cert_file : NULL) != 0) {
+            fprintf(stderr, "Error adding attestation key: %s\n", ak_specs[i]);
+            goto cleanup;
+        }
+    }
+    verifier_set_ak_cache(ak_cache);
+
+    if (verdict_capacity > 0) {
+        verdicts = verdict_cache_create(verdict_capacity);
+        if (!verdicts) {
+            goto cleanup;
+        }
+        verifier_set_verdict_cache(verdicts, policy_version);
+    }
+
+    if (metrics_address || metrics_file) {
+        metrics = metrics_exporter_start(metrics_address, metrics_file, config.report_interval_s);
+        if (!metrics) {
+            goto cleanup;
+        }
+    }
+
+    if (verdict_config.path) {
+        verdict_log = verdict_log_create(&verdict_config);
+        if (!verdict_log) {
+            goto cleanup;
+        }
+        verifier_set_verdict_log(verdict_log);
+    }
+
+    if (pipelined) {
+        pipeline = log_pipeline_create(pipeline_threads, pipeline_min_log_size);
+        if (!pipeline) {
+            goto cleanup;
+        }
+        verifier_set_log_pipeline(pipeline);
+    }
+
+    if (dictionary_file) {
+        if (log_dictionary_load(&dictionary, dictionary_file, LOG_DICTIONARY_DEFAULT_LEVEL) != 0) {
+            goto cleanup;
+        }
+        verifier_set_log_dictionary(&dictionary);
+        printf("Loaded log dictionary %u from %s\n", dictionary.id, dictionary_file);
+    }
+
+    if (archive_dir) {
+        archive = event_archive_open(archive_dir);
+        if (!archive) {
+            goto cleanup;
+        }
+        verifier_set_event_archive(archive);
+    }
+
+    if (pthread_create(&reloader.thread, NULL, rim_reloader_main, &reloader) != 0) {
+        fprintf(stderr, "Error starting RIM reloader thread\n");
+        goto cleanup;
+    }
+    reloader.started = true;
+
+    daemon = verifier_daemon_create(&config);
+    if (!daemon) {
+        goto cleanup;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        if (verifier_daemon_add_attestor(daemon, argv[i]) != 0) {
+            goto cleanup;
+        }
+    }
+
+    if (standin_count > 0) {
+        size_t log_size;
+        uint8_t *event_log = read_file(event_log_file, &log_size);
+        standin_fds = calloc(standin_count, sizeof(*standin_fds));
+        if (!event_log || !standin_fds) {
+            free(event_log);
+            goto cleanup;
+        }
+        standins = standin_address ? standin_attestors_listen(standin_count, event_log, log_size, standin_address)
+                                   : standin_attestors_start(standin_count, event_log, log_size, standin_fds);
+        free(event_log);
+        const uint8_t *ak_public;
+        size_t ak_public_size;
+        if (!standins || standin_attestors_ak_public(standins, &ak_public, &ak_public_size) != 0 ||
+            ak_cache_add(ak_cache, ak_public, ak_public_size, NULL, NULL) != 0) {
+            goto cleanup;
+        }
+        for (size_t i = 0; i < standin_count && standin_address; i++) {
+            if (verifier_daemon_add_attestor(daemon, standin_address) != 0) {
+                goto cleanup;
+            }
+        }
+        for (size_t i = 0; i < standin_count && !standin_address; i++) {
+            if (verifier_daemon_add_attestor_fd(daemon, standin_fds[i]) != 0) {
+                // The daemon owns only the descriptors it accepted.
+                for (size_t j = i; j < standin_count; j++) {
+                    close(standin_fds[j]);
+                }
+                goto cleanup;
+            }
+        }
+    }
+
+    running_daemon = daemon;
+    struct sigaction action = { .sa_handler = handle_stop_signal };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (verifier_daemon_run(daemon) == 0) {
+        rc = EXIT_SUCCESS;
+    }
+    running_daemon = NULL;
+
+    if (verdict_log) {
+        VerdictLogStats stats;
+        verdict_log_get_stats(verdict_log, &stats);
+        printf("Verdict log: %llu queued, %llu dropped\n", (unsigned long long)stats.submitted,
+               (unsigned long long)stats.dropped);
+    }
+    if (verdicts) {
+        VerdictCacheStats stats;
+        verdict_cache_get_stats(verdicts, &stats);
+        printf("Verdict cache: %llu hits, %llu misses, %llu evictions, %zu/%zu entries\n",
+               (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+               (unsigned long long)stats.evictions, stats.entries, stats.capacity);
+    }
+    RimStoreStats rim_stats;
+    rim_store_get_stats(reloader.store, &rim_stats);
+    printf("RIM: version %llu in use, %llu published, %llu reclaimed\n", (unsigned long long)rim_stats.version,
+           (unsigned long long)rim_stats.published, (unsigned long long)rim_stats.reclaimed);
+    if (archive) {
+        ArchiveStats stats;
+        event_archive_get_stats(archive, &stats);
+        printf("Event archive: %llu attestations this run, %llu bytes of logs stored as %llu bytes of new chunks\n",
+               (unsigned long long)stats.appended, (unsigned long long)stats.log_bytes,
+               (unsigned long long)stats.chunk_bytes);
+    }
+
+cleanup:
+    verifier_daemon_destroy(daemon);
+    rim_reloader_stop(&reloader);
+    metrics_exporter_stop(metrics);
+    verifier_set_verdict_log(NULL);
+    verdict_log_destroy(verdict_log);
+    verifier_set_log_pipeline(NULL);
+    log_pipeline_destroy(pipeline);
+    verifier_set_log_dictionary(NULL);
+    log_dictionary_free(&dictionary);
+    verifier_set_event_archive(NULL);
+    event_archive_close(archive);
+    standin_attestors_stop(standins);
+    free(standin_fds);
+    verifier_set_verdict_cache(NULL, 0);
+    verdict_cache_destroy(verdicts);
+    verifier_set_ak_cache(NULL);
+    ak_cache_destroy(ak_cache);
+    checkpoint_store_destroy(checkpoints);
+    verifier_set_rim_store(NULL);
+    rim_store_destroy(reloader.store);
+    free(ak_specs);
+    return rc;
+}
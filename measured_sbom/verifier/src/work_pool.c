@@ -0,0 +1,267 @@
+// work_pool.c
+// Work-stealing thread pool for the CPU-bound part of attestation (parse, replay, RIM matching, signature checks).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "work_pool.h"
+
+#define WORK_DEQUE_MIN_CAPACITY 256
+
+typedef struct {
+    WorkPoolTask task;
+    void *arg;
+} WorkItem;
+
+/**
+ * @struct WorkDeque
+ * @brief Growable ring of tasks. The owner pushes and pops at the bottom, thieves take from the top.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    WorkItem *items;
+    size_t capacity;            // Power of two
+    size_t top;                 // Index of the oldest task
+    size_t bottom;              // Index one past the newest task
+} WorkDeque;
+
+typedef struct {
+    WorkPool *pool;
+    pthread_t thread;
+    WorkDeque deque;
+    unsigned int steal_seed;
+} Worker;
+
+struct WorkPool {
+    Worker *workers;
+    size_t num_workers;
+    atomic_size_t pending;      // Tasks queued and not yet taken
+    atomic_size_t next_worker;  // Round robin cursor for external submissions
+    atomic_int sleepers;
+    atomic_bool stopping;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+};
+
+// Worker the calling thread belongs to, so tasks submitted from tasks stay on the local deque
+static __thread Worker *current_worker = NULL;
+
+static int deque_init(WorkDeque *deque) {
+    deque->items = malloc(WORK_DEQUE_MIN_CAPACITY * sizeof(*deque->items));
+    if (!deque->items) {
+        return -1;
+    }
+    deque->capacity = WORK_DEQUE_MIN_CAPACITY;
+    deque->top = 0;
+    deque->bottom = 0;
+    pthread_mutex_init(&deque->lock, NULL);
+    return 0;
+}
+
+static void deque_free(WorkDeque *deque) {
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->items);
+}
+
+static int deque_push(WorkDeque *deque, WorkPoolTask task, void *arg) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        WorkItem *items = malloc(2 * deque->capacity * sizeof(*items));
+        if (!items) {
+            pthread_mutex_unlock(&deque->lock);
+            return -1;
+        }
+        for (size_t i = deque->top; i != deque->bottom; i++) {
+            items[i & (2 * deque->capacity - 1)] = deque->items[i & (deque->capacity - 1)];
+        }
+        free(deque->items);
+        deque->items = items;
+        deque->capacity *= 2;
+    }
+    deque->items[deque->bottom & (deque->capacity - 1)] = (WorkItem){ task, arg };
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+static bool deque_pop_bottom(WorkDeque *deque, WorkItem *item) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom != deque->top) {
+        deque->bottom--;
+        *item = deque->items[deque->bottom & (deque->capacity - 1)];
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool deque_steal_top(WorkDeque *deque, WorkItem *item) {
+    bool found = false;
+    // A busy victim is skipped rather than waited for; the thief moves on to the next one.
+    if (pthread_mutex_trylock(&deque->lock) != 0) {
+        return false;
+    }
+    if (deque->bottom != deque->top) {
+        *item = deque->items[deque->top & (deque->capacity - 1)];
+        deque->top++;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/**
+ * @brief Takes the next task for a worker: its own newest task, else the oldest task of another worker.
+ */
+static bool take_task(Worker *worker, WorkItem *item) {
+    WorkPool *pool = worker->pool;
+    if (deque_pop_bottom(&worker->deque, item)) {
+        return true;
+    }
+    size_t start = rand_r(&worker->steal_seed) % pool->num_workers;
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        Worker *victim = &pool->workers[(start + i) % pool->num_workers];
+        if (victim != worker && deque_steal_top(&victim->deque, item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    WorkPool *pool = worker->pool;
+    current_worker = worker;
+
+    for (;;) {
+        WorkItem item;
+        if (atomic_load(&pool->pending) > 0 && take_task(worker, &item)) {
+            atomic_fetch_sub(&pool->pending, 1);
+            item.task(item.arg);
+            continue;
+        }
+        if (atomic_load(&pool->pending) > 0) {
+            // Tasks exist but their deques were busy; try again rather than sleep.
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+        atomic_fetch_add(&pool->sleepers, 1);
+        while (atomic_load(&pool->pending) == 0 && !atomic_load(&pool->stopping)) {
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+        }
+        atomic_fetch_sub(&pool->sleepers, 1);
+        bool done = atomic_load(&pool->pending) == 0 && atomic_load(&pool->stopping);
+        pthread_mutex_unlock(&pool->idle_lock);
+        if (done) {
+            break;
+        }
+    }
+
+    current_worker = NULL;
+    return NULL;
+}
+
+WorkPool *work_pool_create(size_t num_workers) {
+    if (num_workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_workers = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    WorkPool *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        fprintf(stderr, "Error allocating memory for work pool\n");
+        return NULL;
+    }
+    pool->workers = calloc(num_workers, sizeof(*pool->workers));
+    if (!pool->workers) {
+        fprintf(stderr, "Error allocating memory for work pool\n");
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->next_worker, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stopping, false);
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+
+    for (size_t i = 0; i < num_workers; i++) {
+        Worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->steal_seed = (unsigned int)(i * 2654435761u + 1);
+        if (deque_init(&worker->deque) != 0) {
+            fprintf(stderr, "Error allocating memory for work pool\n");
+            work_pool_destroy(pool);
+            return NULL;
+        }
+        pool->num_workers++;
+    }
+
+    for (size_t i = 0; i < num_workers; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            fprintf(stderr, "Error starting work pool thread %zu\n", i);
+            // The threads started so far drain nothing and exit; their deques are freed by destroy.
+            work_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+int work_pool_submit(WorkPool *pool, WorkPoolTask task, void *arg) {
+    if (!pool || !task || pool->num_workers == 0) {
+        return -1;
+    }
+
+    Worker *worker = current_worker;
+    if (!worker || worker->pool != pool) {
+        worker = &pool->workers[atomic_fetch_add(&pool->next_worker, 1) % pool->num_workers];
+    }
+    if (deque_push(&worker->deque, task, arg) != 0) {
+        fprintf(stderr, "Error queueing work pool task\n");
+        return -1;
+    }
+
+    atomic_fetch_add(&pool->pending, 1);
+    if (atomic_load(&pool->sleepers) > 0) {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+    return 0;
+}
+
+size_t work_pool_worker_count(const WorkPool *pool) {
+    return pool ? pool->num_workers : 0;
+}
+
+void work_pool_destroy(WorkPool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->stopping, true);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        if (pool->workers[i].thread) {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+    }
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        deque_free(&pool->workers[i].deque);
+    }
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    free(pool->workers);
+    free(pool);
+}
@@ -0,0 +1,681 @@
+// verifier.i
+// Python bindings for event log parsing, PCR replay and RIM checks. Logs are read in place through the buffer
+// protocol (bytes, bytearray, memoryview, mmap) and the GIL is released while a log is replayed and checked.
+//
+// Build:
+//   swig -python -o verifier_wrap.c verifier/swig/verifier.i
+//   cc -shared -fPIC -O2 $(python3-config --includes) -Iinclude -Iverifier -Iverifier/include verifier_wrap.c \
+//      <event_log_parsing, pcr, manifest, rim_image, event_log_verifier, ima_log_verifier, work_pool and
+//      verdict_log sources> -ltss2-mu -lprotobuf-c -lcrypto -lpthread -o _verifier.so
+
+%module verifier
+
+%{
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "event_log_parser.h"
+#include "event_log_verifier.h"
+#include "ima_log_verifier.h"
+#include "manifest.h"
+#include "pcr.h"
+#include "rim_image.h"
+#include "verdict_log.h"
+#include "work_pool.h"
+
+// Structures
+
+/**
+ * @struct Rim
+ * @brief A RIM index owned by Python.
+ *
+ * Verifications read the index with the GIL released, so it must not change while one runs; users counts them and
+ * is only touched with the GIL held.
+ */
+typedef struct {
+    RIM_Index index;
+    unsigned int users;             /**< Verifications running against the index */
+} Rim;
+
+/**
+ * @struct LogVerification
+ * @brief One event log replayed and checked against a RIM, on whichever thread runs it.
+ */
+typedef struct {
+    const uint8_t *log;             /**< Log, inside a buffer held by the caller */
+    size_t log_size;                /**< Size of the log */
+    const RIM_Index *rim;           /**< RIM to check the events against */
+    bool replayed;                  /**< banks holds the replayed PCRs */
+    bool passed;                    /**< Every event matched the RIM */
+    PCR_BankSet banks;              /**< Replayed PCRs */
+    RIM_CheckReport report;         /**< Result of the RIM check */
+} LogVerification;
+
+static const struct {
+    const char *name;
+    TPM2_ALG_ID alg;
+} verifier_algs[] = {
+    { "sha1", TPM2_ALG_SHA1 },
+    { "sha256", TPM2_ALG_SHA256 },
+    { "sha384", TPM2_ALG_SHA384 },
+    { "sha512", TPM2_ALG_SHA512 },
+    { "sm3_256", TPM2_ALG_SM3_256 },
+};
+
+static const char *const verifier_details[] = { "none", "failures", "all" };
+
+// Conversions
+
+static PyObject *alg_key(TPM2_ALG_ID alg) {
+    for (size_t i = 0; i < sizeof(verifier_algs) / sizeof(verifier_algs[0]); i++) {
+        if (verifier_algs[i].alg == alg) {
+            return PyUnicode_FromString(verifier_algs[i].name);
+        }
+    }
+    return PyUnicode_FromFormat("0x%04x", (unsigned int)alg);
+}
+
+static int parse_alg(const char *name, TPM2_ALG_ID *alg) {
+    for (size_t i = 0; i < sizeof(verifier_algs) / sizeof(verifier_algs[0]); i++) {
+        if (strcmp(verifier_algs[i].name, name) == 0) {
+            *alg = verifier_algs[i].alg;
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown hash algorithm '%s'; expected sha1, sha256, sha384, sha512 or sm3_256",
+                 name);
+    return -1;
+}
+
+static int parse_detail(const char *name, EventDetail *detail) {
+    for (size_t i = 0; i < sizeof(verifier_details) / sizeof(verifier_details[0]); i++) {
+        if (strcmp(verifier_details[i], name) == 0) {
+            *detail = (EventDetail)i;
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown event detail '%s'; expected none, failures or all", name);
+    return -1;
+}
+
+/**
+ * @brief Sets key to a new reference, consuming it. Returns -1 with the exception set if value is NULL.
+ */
+static int dict_steal(PyObject *dict, const char *key, PyObject *value) {
+    if (!value) {
+        return -1;
+    }
+    int rc = PyDict_SetItemString(dict, key, value);
+    Py_DECREF(value);
+    return rc;
+}
+
+static PyObject *bank_values(const PCR_Bank *bank) {
+    PyObject *values = PyList_New(TPM_PCR_COUNT);
+    for (int pcr = 0; values && pcr < TPM_PCR_COUNT; pcr++) {
+        PyObject *value = PyBytes_FromStringAndSize((const char *)bank->pcrs[pcr].buffer, bank->pcrs[pcr].size);
+        if (!value) {
+            Py_CLEAR(values);
+            break;
+        }
+        PyList_SET_ITEM(values, pcr, value);
+    }
+    return values;
+}
+
+/**
+ * @brief Converts replayed banks to {alg: [PCR 0 .. PCR 23 as bytes]}.
+ */
+static PyObject *bankset_dict(const PCR_Bank *banks, uint32_t bank_count) {
+    PyObject *dict = PyDict_New();
+    for (uint32_t i = 0; dict && i < bank_count; i++) {
+        PyObject *key = alg_key(banks[i].alg);
+        PyObject *values = key ? bank_values(&banks[i]) : NULL;
+        if (!values || PyDict_SetItem(dict, key, values) != 0) {
+            Py_CLEAR(dict);
+        }
+        Py_XDECREF(key);
+        Py_XDECREF(values);
+    }
+    return dict;
+}
+
+static PyObject *event_record_dict(const EventRecordStatus *event) {
+    return Py_BuildValue("{s:I,s:I,s:I,s:s}", "record", event->record_num, "pcr", event->pcr_index, "type",
+                         event->event_type, "status", event_status_str((EventStatus)event->status));
+}
+
+/**
+ * @brief Adds the fields of a RIM check report under the keys of the JSON verdict log.
+ */
+static int report_fill(PyObject *dict, const RIM_CheckReport *report) {
+    if (dict_steal(dict, "events", PyLong_FromUnsignedLong(report->events_checked)) != 0) {
+        return -1;
+    }
+
+    PyObject *status = PyDict_New();
+    if (dict_steal(dict, "status", status) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < EVENT_STATUS_COUNT; i++) {
+        if (dict_steal(status, event_status_str((EventStatus)i), PyLong_FromUnsignedLong(report->status_counts[i]))
+            != 0) {
+            return -1;
+        }
+    }
+
+    if (report->has_failure) {
+        PyObject *failure = event_record_dict(&report->first_failure);
+        if (dict_steal(dict, "first_failure", failure) != 0 ||
+            dict_steal(failure, "name", PyUnicode_DecodeUTF8(report->first_failure_name,
+                                                             report->first_failure_name_len, "replace")) != 0) {
+            return -1;
+        }
+    }
+
+    PyObject *pcrs = PyList_New(0);
+    if (dict_steal(dict, "pcrs", pcrs) != 0) {
+        return -1;
+    }
+    for (int pcr = 0; pcr < TPM_PCR_COUNT; pcr++) {
+        if (report->pcr_events[pcr] > 0) {
+            PyObject *entry = Py_BuildValue("{s:i,s:I,s:I}", "pcr", pcr, "events", report->pcr_events[pcr],
+                                            "failures", report->pcr_failures[pcr]);
+            if (!entry || PyList_Append(pcrs, entry) != 0) {
+                Py_XDECREF(entry);
+                return -1;
+            }
+            Py_DECREF(entry);
+        }
+    }
+
+    if (report->detail != EVENT_DETAIL_NONE) {
+        PyObject *events = PyList_New((Py_ssize_t)report->event_count);
+        if (dict_steal(dict, "event_detail", events) != 0) {
+            return -1;
+        }
+        for (size_t i = 0; i < report->event_count; i++) {
+            PyObject *event = event_record_dict(&report->events[i]);
+            if (!event) {
+                return -1;
+            }
+            PyList_SET_ITEM(events, (Py_ssize_t)i, event);
+        }
+    }
+    return 0;
+}
+
+static PyObject *result_dict(bool passed, VerdictReason reason, const RIM_Index *rim) {
+    PyObject *result = Py_BuildValue("{s:s,s:s}", "result", passed ? "pass" : "fail", "reason",
+                                     verdict_reason_str(reason));
+    if (rim && result &&
+        dict_steal(result, "rim_digest", PyBytes_FromStringAndSize((const char *)rim->content_digest,
+                                                                   RIM_INDEX_DIGEST_SIZE)) != 0) {
+        Py_CLEAR(result);
+    }
+    return result;
+}
+
+// Verification
+
+/**
+ * @brief Replays a log and checks its events against the RIM. Runs without the GIL; touches no Python object.
+ */
+static void verify_log(LogVerification *job) {
+    TCG_EventLogCursor cursor;
+    job->replayed = pcr_replay_log(job->log, job->log_size, &job->banks) == 0;
+    job->passed = job->replayed && tcg_log_cursor_init(&cursor, job->log, job->log_size) == TCG_LOG_OK &&
+                  process_event_log_report(&cursor, job->rim, &job->report);
+}
+
+static void verify_log_task(void *arg) {
+    verify_log(arg);
+}
+
+/**
+ * @brief Builds the verdict of a finished verification.
+ */
+static PyObject *verification_result(const LogVerification *job) {
+    VerdictReason reason = VERDICT_REASON_NONE;
+    if (!job->replayed || job->report.status_counts[EVENT_STATUS_MALFORMED] > 0) {
+        reason = VERDICT_REASON_LOG_FORMAT;
+    } else if (!job->passed) {
+        reason = VERDICT_REASON_RIM;
+    }
+
+    PyObject *result = result_dict(reason == VERDICT_REASON_NONE, reason, job->rim);
+    if (!result) {
+        return NULL;
+    }
+    if (report_fill(result, &job->report) != 0 ||
+        (job->replayed && dict_steal(result, "banks", bankset_dict(job->banks.banks, job->banks.bank_count)) != 0)) {
+        Py_DECREF(result);
+        return NULL;
+    }
+    return result;
+}
+
+static size_t online_cpus(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+
+// Module functions
+
+static PyObject *parse_event_log(const uint8_t *log, size_t log_size) {
+    TCG_EventLogCursor cursor;
+    TCG_EventView event;
+    TCG_LogStatus status = tcg_log_cursor_init(&cursor, log, log_size);
+    if (status != TCG_LOG_OK) {
+        PyErr_Format(PyExc_ValueError, "Invalid event log header: %s", tcg_log_status_str(status));
+        return NULL;
+    }
+
+    PyObject *events = PyList_New(0);
+    while (events && (status = tcg_log_cursor_next(&cursor, &event)) == TCG_LOG_OK) {
+        PyObject *digests = PyDict_New();
+        for (uint32_t i = 0; digests && i < event.digest_count; i++) {
+            PyObject *key = alg_key(event.digests[i].alg);
+            PyObject *value = PyBytes_FromStringAndSize((const char *)event.digests[i].digest, event.digests[i].size);
+            if (!key || !value || PyDict_SetItem(digests, key, value) != 0) {
+                Py_CLEAR(digests);
+            }
+            Py_XDECREF(key);
+            Py_XDECREF(value);
+        }
+        // The event data is given as an offset into the log, so callers slice their own buffer without a copy
+        size_t data_offset = event.event_data ? (size_t)(event.event_data - log) : event.offset + event.length;
+        PyObject *record = digests ? Py_BuildValue("{s:n,s:n,s:n,s:I,s:I,s:N,s:n,s:I}", "record",
+                                                   (Py_ssize_t)event.record_num, "offset", (Py_ssize_t)event.offset,
+                                                   "length", (Py_ssize_t)event.length, "pcr", event.pcr_index, "type",
+                                                   event.event_type, "digests", digests, "data_offset",
+                                                   (Py_ssize_t)data_offset, "data_size",
+                                                   event.event_size)
+                                   : NULL;
+        if (record && event.template_name &&
+            dict_steal(record, "template", PyUnicode_DecodeUTF8(event.template_name, event.template_name_len,
+                                                                "replace")) != 0) {
+            Py_CLEAR(record);
+        }
+        if (!record || PyList_Append(events, record) != 0) {
+            Py_CLEAR(events);
+        }
+        Py_XDECREF(record);
+    }
+    if (events && status != TCG_LOG_END) {
+        PyErr_Format(PyExc_ValueError, "Malformed event log at offset %zu: %s", cursor.offset,
+                     tcg_log_status_str(status));
+        Py_CLEAR(events);
+    }
+    return events;
+}
+
+static PyObject *replay_event_log(const uint8_t *log, size_t log_size) {
+    PCR_BankSet *banks = PyMem_Malloc(sizeof(*banks));
+    int rc;
+    if (!banks) {
+        return PyErr_NoMemory();
+    }
+    Py_BEGIN_ALLOW_THREADS
+    rc = pcr_replay_log(log, log_size, banks);
+    Py_END_ALLOW_THREADS
+    PyObject *result = rc == 0 ? bankset_dict(banks->banks, banks->bank_count) : NULL;
+    if (rc != 0) {
+        PyErr_SetString(PyExc_ValueError, "Event log could not be replayed");
+    }
+    PyMem_Free(banks);
+    return result;
+}
+
+static PyObject *verify_event_log(Rim *rim, const uint8_t *log, size_t log_size, const char *detail) {
+    EventDetail event_detail;
+    if (parse_detail(detail, &event_detail) != 0) {
+        return NULL;
+    }
+    LogVerification *job = PyMem_Calloc(1, sizeof(*job));
+    if (!job) {
+        return PyErr_NoMemory();
+    }
+    job->log = log;
+    job->log_size = log_size;
+    job->rim = &rim->index;
+    rim_check_report_reset(&job->report, event_detail);
+
+    rim->users++;
+    Py_BEGIN_ALLOW_THREADS
+    verify_log(job);
+    Py_END_ALLOW_THREADS
+    rim->users--;
+
+    PyObject *result = verification_result(job);
+    rim_check_report_free(&job->report);
+    PyMem_Free(job);
+    return result;
+}
+
+/**
+ * @brief Verifies a list of logs on a work pool, one task per log, with the GIL released until the last finishes.
+ *
+ * Every buffer is acquired before the GIL is released and held until the results are built, so a bytearray
+ * cannot be resized nor an mmap closed under a running task.
+ */
+static PyObject *verify_event_logs(Rim *rim, PyObject *logs, size_t threads, const char *detail) {
+    EventDetail event_detail;
+    if (parse_detail(detail, &event_detail) != 0) {
+        return NULL;
+    }
+    PyObject *sequence = PySequence_Fast(logs, "logs must be a sequence of buffers");
+    if (!sequence) {
+        return NULL;
+    }
+    size_t count = (size_t)PySequence_Fast_GET_SIZE(sequence);
+    Py_buffer *views = PyMem_Calloc(count ? count : 1, sizeof(*views));
+    LogVerification *jobs = PyMem_Calloc(count ? count : 1, sizeof(*jobs));
+    PyObject *results = NULL;
+    size_t acquired = 0;
+    if (!views || !jobs) {
+        PyErr_NoMemory();
+        goto cleanup;
+    }
+    for (; acquired < count; acquired++) {
+        if (PyObject_GetBuffer(PySequence_Fast_GET_ITEM(sequence, acquired), &views[acquired], PyBUF_SIMPLE) != 0) {
+            goto cleanup;
+        }
+        jobs[acquired].log = views[acquired].buf;
+        jobs[acquired].log_size = (size_t)views[acquired].len;
+        jobs[acquired].rim = &rim->index;
+        rim_check_report_reset(&jobs[acquired].report, event_detail);
+    }
+
+    size_t workers = threads ? threads : online_cpus();
+    rim->users++;
+    Py_BEGIN_ALLOW_THREADS
+    WorkPool *pool = workers > 1 && count > 1 ? work_pool_create(workers < count ? workers : count) : NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (!pool || work_pool_submit(pool, verify_log_task, &jobs[i]) != 0) {
+            verify_log(&jobs[i]);
+        }
+    }
+    work_pool_destroy(pool);
+    Py_END_ALLOW_THREADS
+    rim->users--;
+
+    results = PyList_New((Py_ssize_t)count);
+    for (size_t i = 0; results && i < count; i++) {
+        PyObject *result = verification_result(&jobs[i]);
+        if (!result) {
+            Py_CLEAR(results);
+            break;
+        }
+        PyList_SET_ITEM(results, (Py_ssize_t)i, result);
+    }
+
+cleanup:
+    for (size_t i = 0; i < acquired; i++) {
+        PyBuffer_Release(&views[i]);
+        rim_check_report_free(&jobs[i].report);
+    }
+    PyMem_Free(views);
+    PyMem_Free(jobs);
+    Py_DECREF(sequence);
+    return results;
+}
+
+static PyObject *verify_ima_log(Rim *rim, const uint8_t *log, size_t log_size, const char *alg, const char *detail) {
+    TPM2_ALG_ID bank;
+    EventDetail event_detail;
+    if (parse_alg(alg, &bank) != 0 || parse_detail(detail, &event_detail) != 0) {
+        return NULL;
+    }
+    IMA_VerifyResult *ima = PyMem_Calloc(1, sizeof(*ima));
+    RIM_CheckReport report = { 0 };
+    bool passed;
+    if (!ima) {
+        return PyErr_NoMemory();
+    }
+    rim_check_report_reset(&report, event_detail);
+
+    if (rim) {
+        rim->users++;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    passed = process_ima_log(log, log_size, bank, rim ? &rim->index : NULL, ima, &report);
+    Py_END_ALLOW_THREADS
+    if (rim) {
+        rim->users--;
+    }
+
+    VerdictReason reason = VERDICT_REASON_NONE;
+    if (ima->status != IMA_LOG_END || ima->template_mismatches > 0) {
+        reason = VERDICT_REASON_LOG_FORMAT;
+    } else if (!passed) {
+        reason = VERDICT_REASON_RIM;
+    }
+    PyObject *result = result_dict(reason == VERDICT_REASON_NONE, reason, rim ? &rim->index : NULL);
+    if (result && (dict_steal(result, "entries", PyLong_FromUnsignedLong(ima->entries)) != 0 ||
+                   dict_steal(result, "template_mismatches", PyLong_FromUnsignedLong(ima->template_mismatches)) != 0 ||
+                   dict_steal(result, "violations", PyLong_FromUnsignedLong(ima->violations)) != 0 ||
+                   dict_steal(result, "log_status", PyUnicode_FromString(ima_log_status_str(ima->status))) != 0 ||
+                   report_fill(result, &report) != 0 ||
+                   dict_steal(result, "banks", bankset_dict(&ima->pcrs, 1)) != 0)) {
+        Py_CLEAR(result);
+    }
+    rim_check_report_free(&report);
+    PyMem_Free(ima);
+    return result;
+}
+
+static Rim *map_rim_image(const char *filename, const char *key_filename) {
+    Rim *rim = calloc(1, sizeof(*rim));
+    if (!rim) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    EVP_PKEY *key = rim_image_read_key(key_filename, false);
+    if (!key) {
+        PyErr_Format(PyExc_OSError, "Cannot read RIM image key %s", key_filename);
+        free(rim);
+        return NULL;
+    }
+    int rc;
+    Py_BEGIN_ALLOW_THREADS
+    rc = rim_index_map_image(&rim->index, filename, key, NULL);
+    Py_END_ALLOW_THREADS
+    EVP_PKEY_free(key);
+    if (rc != 0) {
+        PyErr_Format(PyExc_ValueError, "Cannot map RIM image %s", filename);
+        free(rim);
+        return NULL;
+    }
+    return rim;
+}
+%}
+
+%feature("kwargs");
+
+// Buffers are borrowed for the length of the call: any object with the buffer protocol, never copied
+%typemap(in) (const uint8_t *buffer, size_t buffer_size) (Py_buffer view, int have_view = 0) {
+    if (PyObject_GetBuffer($input, &view, PyBUF_SIMPLE) != 0) {
+        SWIG_fail;
+    }
+    have_view = 1;
+    $1 = (uint8_t *)view.buf;
+    $2 = (size_t)view.len;
+}
+%typemap(freearg) (const uint8_t *buffer, size_t buffer_size) {
+    if (have_view$argnum) {
+        PyBuffer_Release(&view$argnum);
+    }
+}
+%typemap(typecheck, precedence=SWIG_TYPECHECK_POINTER) (const uint8_t *buffer, size_t buffer_size) {
+    $1 = PyObject_CheckBuffer($input);
+}
+%apply (const uint8_t *buffer, size_t buffer_size) {
+    (const uint8_t *log, size_t log_size),
+    (const uint8_t *digest, size_t digest_size),
+    (const uint8_t *manifest, size_t manifest_size)
+};
+
+// A RIM is required wherever the parameter is named rim; verify_ima_log clears this to accept None
+%typemap(check) Rim *rim {
+    if (!$1) {
+        PyErr_SetString(PyExc_TypeError, "rim must be a Rim, not None");
+        SWIG_fail;
+    }
+}
+
+// Constructors and mapping report failures through the Python exception they set
+%exception Rim::Rim {
+    $action
+    if (!result) {
+        SWIG_fail;
+    }
+}
+%exception map_rim_image {
+    $action
+    if (!result) {
+        SWIG_fail;
+    }
+}
+
+%rename("__len__") Rim::entry_count;
+
+/**
+ * @brief Reference integrity manifest: payload names and digests the events of a log are checked against.
+ */
+typedef struct {
+} Rim;
+
+%extend Rim {
+    Rim(size_t expected_entries = 0) {
+        Rim *rim = calloc(1, sizeof(*rim));
+        if (!rim || rim_index_init(&rim->index, expected_entries) != 0) {
+            free(rim);
+            PyErr_NoMemory();
+            return NULL;
+        }
+        return rim;
+    }
+
+    ~Rim() {
+        rim_index_free(&$self->index);
+        free($self);
+    }
+
+    /**
+     * @brief Adds a reference digest for a payload name.
+     */
+    PyObject *add(const char *name, const char *alg, const uint8_t *digest, size_t digest_size) {
+        TPM2_ALG_ID hash_alg;
+        if ($self->users > 0) {
+            PyErr_SetString(PyExc_RuntimeError, "RIM is in use by a running verification");
+            return NULL;
+        }
+        if (parse_alg(alg, &hash_alg) != 0) {
+            return NULL;
+        }
+        if (rim_index_add(&$self->index, name, strlen(name), hash_alg, digest, digest_size) != 0) {
+            PyErr_SetString(PyExc_ValueError, "Cannot add RIM entry");
+            return NULL;
+        }
+        Py_RETURN_NONE;
+    }
+
+    /**
+     * @brief Adds the payload of a serialized RIMManifest, e.g. rim_pb2.RIMManifest.SerializeToString().
+     *
+     * @return Number of entries added.
+     */
+    PyObject *load_manifest(const uint8_t *manifest, size_t manifest_size) {
+        int added;
+        if ($self->users > 0) {
+            PyErr_SetString(PyExc_RuntimeError, "RIM is in use by a running verification");
+            return NULL;
+        }
+        added = rim_index_load_manifest(&$self->index, manifest, manifest_size);
+        if (added < 0) {
+            PyErr_SetString(PyExc_ValueError, "Cannot load RIM manifest");
+            return NULL;
+        }
+        return PyLong_FromLong(added);
+    }
+
+    /**
+     * @brief Adds the payload of a serialized RIMManifest file.
+     *
+     * @return Number of entries added.
+     */
+    PyObject *load_manifest_file(const char *filename) {
+        int added;
+        if ($self->users > 0) {
+            PyErr_SetString(PyExc_RuntimeError, "RIM is in use by a running verification");
+            return NULL;
+        }
+        added = rim_index_load_manifest_file(&$self->index, filename);
+        if (added < 0) {
+            PyErr_Format(PyExc_OSError, "Cannot load RIM manifest %s", filename);
+            return NULL;
+        }
+        return PyLong_FromLong(added);
+    }
+
+    size_t entry_count() {
+        return $self->index.entry_count;
+    }
+
+    /**
+     * @brief Rolling SHA-256 of every entry added, as recorded in verdicts.
+     */
+    PyObject *content_digest() {
+        return PyBytes_FromStringAndSize((const char *)$self->index.content_digest, RIM_INDEX_DIGEST_SIZE);
+    }
+}
+
+// Function Prototypes
+
+/**
+ * @brief Maps a compiled RIM image (rim_compile) signed by the PEM public key in key_filename. The Rim is read-only.
+ */
+%newobject map_rim_image;
+Rim *map_rim_image(const char *filename, const char *key_filename);
+
+/**
+ * @brief Parses a TCG event log or CEL stream into a list of records:
+ *        {record, offset, length, pcr, type, digests: {alg: bytes}, data_offset, data_size[, template]}.
+ *
+ * Offsets are into the buffer passed in, so event data is read with memoryview(log)[data_offset:...] unchanged.
+ */
+PyObject *parse_event_log(const uint8_t *log, size_t log_size);
+
+/**
+ * @brief Replays a log into {alg: [PCR 0 .. PCR 23]}, without the GIL.
+ */
+PyObject *replay_event_log(const uint8_t *log, size_t log_size);
+
+/**
+ * @brief Replays a log and checks every event against a RIM, without the GIL.
+ *
+ * The result has the keys of a JSON verdict record (result, reason, rim_digest, events, status, first_failure,
+ * pcrs, event_detail) and the replayed PCRs under banks. detail is "none", "failures" or "all".
+ */
+PyObject *verify_event_log(Rim *rim, const uint8_t *log, size_t log_size, const char *detail = "failures");
+
+/**
+ * @brief Verifies a sequence of logs on native threads, without the GIL; results are in the order of the logs.
+ *
+ * threads is the number of workers, 0 for one per online CPU.
+ */
+PyObject *verify_event_logs(Rim *rim, PyObject *logs, size_t threads = 0, const char *detail = "failures");
+
+%clear Rim *rim;
+
+/**
+ * @brief Verifies an IMA runtime measurement log, without the GIL. rim may be None to check template digests only.
+ *
+ * alg selects the log: "sha1" for binary_runtime_measurements, or the bank of a
+ * binary_runtime_measurements_<alg> log.
+ */
+PyObject *verify_ima_log(Rim *rim, const uint8_t *log, size_t log_size, const char *alg = "sha1",
+                         const char *detail = "failures");